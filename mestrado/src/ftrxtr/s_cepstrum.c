@@ -39,9 +39,9 @@ scep_f_mel_to_hz (cmp_real f_mel)
 /*
  * scep_mel_scale
  *
- * Constructs and returns values from a look-up table,
- * containing the frequencies in Hz obtained from
- * the conversion of a series of equally spaced mel frequencies.
+ * Returns the frequencies in Hz of the given filter of a bank of
+ * filters with equally spaced mel frequencies. The frequencies are
+ * evaluated on each call, so the function keeps no state.
  *
  * Parameters:
  * - delta_mel: mel frequency interval between filters
@@ -57,31 +57,6 @@ scep_mel_scale (const cmp_real delta_mel,
                 const smp_num_samples filter,
                 cmp_real * low_freq, cmp_real * mid_freq, cmp_real * hi_freq)
 {
-  /* Internal mel frequency interval */
-  static cmp_real int_delta_mel = 0.0;
-
-  /* Internal current number of filters */
-  static smp_num_samples int_total_filters = 0;
-
-  /* Internal Hz frequency series */
-  static sample_list_type *mel_list = NULL;
-
-  /* Auxiliary internal filter counter */
-  smp_num_samples cur_filter;
-
-  /* Auxiliary first filter to create */
-  smp_num_samples aux_first_filter, aux_last_filter;
-
-  /* Auxiliary list element value */
-  cmp_complex aux_z;
-
-  /* Auxiliary frequencies */
-  cmp_complex aux_low_freq, aux_mid_freq, aux_hi_freq;
-
-  /* Auxiliary function return status */
-  int exit_status;
-
-
   /* Checks the input parameters domains */
   if (delta_mel < DBL_EPSILON)
     {
@@ -90,15 +65,6 @@ scep_mel_scale (const cmp_real delta_mel,
       return EXIT_FAILURE;
     }
 
-  /*
-  if (total_filters < 0)
-    {
-      fprintf (stderr,
-               "scep_mel_scale: negative number of filters requested\n");
-      return EXIT_FAILURE;
-    }
-   */
-
   if (filter > total_filters)
     {
       fprintf (stderr,
@@ -107,155 +73,24 @@ scep_mel_scale (const cmp_real delta_mel,
       return EXIT_FAILURE;
     }
 
-  /* If 'delta_mel' changed, then the table needs to be reconstructed */
-  if (fabs (delta_mel - int_delta_mel) > DBL_EPSILON)
-    {
-      /* Look-up table has to be reconstructed */
-
-      /* If there is a reminder list, destroy it */
-      if (int_total_filters > 0)
-        {
-          exit_status = destroy_list (&mel_list);
-          if (exit_status != EXIT_SUCCESS)
-            {
-              fprintf (stderr,
-                       "scep_mel_scale: error destroyin old look-up mel-frequencies table\n");
-              return EXIT_FAILURE;
-            }
-        }
-
-      /*
-       * Recreates the list, if the total number of filters
-       * is greater than zero
-       */
-      if (total_filters > 0)
-        {
-          /* Creates the new list */
-          exit_status = create_list (&mel_list, SMP_REAL, 0.0, delta_mel, 0);
-          if (exit_status != EXIT_SUCCESS)
-            {
-              fprintf (stderr,
-                       "scep_mel_scale: error creating new frequency list\n");
-              return EXIT_FAILURE;
-            }
-        }
-
-      /*
-       * All the elements should be reconstructed
-       * One aditional value must be created for the return of the high
-       * frequency associated to the last filter
-       */
-      aux_first_filter = 1;
-      aux_last_filter = total_filters + 1;
-
-      /* Updates the internal 'delta_mel' and 'total_filters' */
-      int_delta_mel = delta_mel;
-    }                           /* Table reconstruction */
-
-  else
-    {
-      /* 'delta_mel' hasn't changed. Check if the table must be resized */
-      if (total_filters > int_total_filters)
-        {
-          /*
-           * Table must grow
-           * One aditional value must be created for the return of the high
-           * frequency associated to the last filter
-           */
-          aux_first_filter = int_total_filters + 1;
-          aux_last_filter = total_filters + 1;
-        }
-      else
-        {
-          /* No elements should be created */
-          aux_first_filter = 1;
-          aux_last_filter = 0;
-        }
-    }
-
-  /* Resizes the list if necessary */
-  if (total_filters != int_total_filters)
-    {
-      exit_status = resize_list (&mel_list, total_filters + 1);
-      if (exit_status != EXIT_SUCCESS)
-        {
-          fprintf (stderr,
-                   "scep_mel_scale: error resizing list from %ld to %ld elements\n",
-                   int_total_filters, total_filters);
-          return EXIT_FAILURE;
-        }
-    }
-
-
-  for (cur_filter = aux_first_filter; cur_filter <= aux_last_filter;
-       ++cur_filter)
-    {
-      /* Calculates the element value */
-      aux_z.re = scep_f_mel_to_hz ((cmp_real) cur_filter * delta_mel);
-      aux_z.im = 0.0;
-
-      /* Includes the value in the list */
-      exit_status = set_list_value (mel_list, cur_filter, aux_z);
-      if (exit_status != EXIT_SUCCESS)
-        {
-          fprintf (stderr,
-                   "scep_mel_scale: error including value %f in filter %ld of the mel-frequency filter\n",
-                   aux_z.re, cur_filter);
-          return EXIT_FAILURE;
-        }
-    }                           /* inclusion loop */
-
-  /* Updates the internal 'total_filters' */
-  if (total_filters != int_total_filters)
-    int_total_filters = total_filters;
-
   /* Gets the requested frequencies */
-
   if (total_filters > 0)
     {
       /* Low frequency */
       if (filter <= 1)
-        aux_low_freq.re = 0.0;
+        *low_freq = 0.0;
       else
-        {
-          exit_status = get_list_value (*mel_list, filter - 1, &aux_low_freq);
-          if (exit_status != EXIT_SUCCESS)
-            {
-              fprintf (stderr,
-                       "scep_mel_scale: error getting low frequency for filter %ld\n",
-                       filter);
-              return EXIT_FAILURE;
-            }
-        }
+        *low_freq = scep_f_mel_to_hz ((cmp_real) (filter - 1) * delta_mel);
 
       /* Mid frequency */
-      exit_status = get_list_value (*mel_list, filter, &aux_mid_freq);
-      if (exit_status != EXIT_SUCCESS)
-        {
-          fprintf (stderr,
-                   "scep_mel_scale: error getting mid frequency for filter %ld\n",
-                   filter);
-          return EXIT_FAILURE;
-        }
+      *mid_freq = scep_f_mel_to_hz ((cmp_real) filter * delta_mel);
 
       /* High frequency */
-      exit_status = get_list_value (*mel_list, filter + 1, &aux_hi_freq);
-      if (exit_status != EXIT_SUCCESS)
-        {
-          fprintf (stderr,
-                   "scep_mel_scale: error getting high frequency for filter %ld\n",
-                   filter);
-          return EXIT_FAILURE;
-        }
-
-      /* Sets the return values */
-      *low_freq = aux_low_freq.re;
-      *mid_freq = aux_mid_freq.re;
-      *hi_freq = aux_hi_freq.re;
+      *hi_freq = scep_f_mel_to_hz ((cmp_real) (filter + 1) * delta_mel);
     }
   else
     {
-      /* List was destroyed */
+      /* Empty filter bank */
       *low_freq = 0.0;
       *mid_freq = 0.0;
       *hi_freq = 0.0;
@@ -550,22 +385,16 @@ int scep_mfcc_index
 
 
 /*
- * scep_mfcc_file
- *
- * Calculates the MFCC's (Mel Frequency Cepstral Coefficients)
- * for the given input file, according to the given parameter structure.
- * The resulting lists are stored in the output 'mfcc_index'
+ * scep_mfcc_signal
  *
- * Parameters:
- * - in_file_name: the input file name
- * - param: the parameters structure
- * - file_index: index where the file entry will be appended
- * - mfcc_index: index where the MFCC's lists will be stored
+ * Calculates the MFCC's of the current list of the given index, holding a
+ * signal read from a file or given in memory, storing the resulting lists
+ * in the output 'mfcc_index'
  */
 int
-scep_mfcc_file (const char *in_file_name,
-                const scep_parameter_type param,
-                index_list_type * file_index, index_list_type * mfcc_index)
+scep_mfcc_signal (index_list_type * signal_index,
+                  const scep_parameter_type param,
+                  index_list_type * mfcc_index)
 {
   /* Auxiliary function exit status */
   int exit_status;
@@ -573,42 +402,13 @@ scep_mfcc_file (const char *in_file_name,
   /* Generated frames index */
   index_list_type frames_index;
 
-  /* Position of the input file on index */
-  smp_index_pos file_entry_position;
-
   /* Just to make clear */
-  const index_entry_type NO_PARENT_ENTRY = NULL;
   const smp_entries_type COMPLEX_FRAMES = SMP_COMPLEX;
   const smp_entries_type REAL_WINDOWING_OPERATIONS = SMP_REAL;
 
 
-  /* Adds an entry to the new index */
-  exit_status = add_index_entry (file_index,
-                                 "Input file index entry",
-                                 in_file_name,
-                                 NO_PARENT_ENTRY,
-                                 SMP_REAL, 0.0, 0.0, 0,
-                                 &file_entry_position, SMP_SET_CURRENT);
-
-  if (exit_status != EXIT_SUCCESS)
-    {
-      /* DESTROY INDEX !!! */
-      fprintf (stderr,
-               "scep_mfcc_file: error adding index entry for the file list\n");
-      return EXIT_FAILURE;
-    }
-
-  /* Reads the input file */
-  exit_status = read_samples_file (file_index, file_entry_position);
-  if (exit_status != EXIT_SUCCESS)
-    {
-      /* DESTROY INDEX AND ENTRIES!!! */
-      fprintf (stderr, "scep_mfcc_file: error reading input file\n");
-      return EXIT_FAILURE;
-    }
-
   /* Windowing of the input signal */
-  exit_status = swin_window (file_index,
+  exit_status = swin_window (signal_index,
                              param.in_preemphasis,
                              param.alpha_preemphasis,
                              param.frame_width,
@@ -626,7 +426,7 @@ scep_mfcc_file (const char *in_file_name,
   if (exit_status != EXIT_SUCCESS)
     {
       fprintf (stderr,
-               "scep_mfcc_file: error performing windowing of the input file\n");
+               "scep_mfcc_signal: error performing windowing of the input signal\n");
       return EXIT_FAILURE;
     }
 
@@ -637,7 +437,7 @@ scep_mfcc_file (const char *in_file_name,
 
   if (exit_status != EXIT_SUCCESS)
     {
-      fprintf (stderr, "scep_mfcc_file: error executing FFT\n");
+      fprintf (stderr, "scep_mfcc_signal: error executing FFT\n");
       return EXIT_FAILURE;
     }
 
@@ -647,7 +447,7 @@ scep_mfcc_file (const char *in_file_name,
 
   if (exit_status != EXIT_SUCCESS)
     {
-      fprintf (stderr, "scep_mfcc_file: error calculating PSD\n");
+      fprintf (stderr, "scep_mfcc_signal: error calculating PSD\n");
       return EXIT_FAILURE;
     }
 
@@ -658,7 +458,7 @@ scep_mfcc_file (const char *in_file_name,
 
   if (exit_status != EXIT_SUCCESS)
     {
-      fprintf (stderr, "scep_mfcc_file: error calcutating MFCC's\n");
+      fprintf (stderr, "scep_mfcc_signal: error calcutating MFCC's\n");
       return EXIT_FAILURE;
     }
 
@@ -668,7 +468,7 @@ scep_mfcc_file (const char *in_file_name,
 
   if (exit_status != EXIT_SUCCESS)
     {
-      fprintf (stderr, "scep_mfcc_file: error applying log function\n");
+      fprintf (stderr, "scep_mfcc_signal: error applying log function\n");
       return EXIT_FAILURE;
     }
 
@@ -677,7 +477,7 @@ scep_mfcc_file (const char *in_file_name,
   if (exit_status != EXIT_SUCCESS)
     {
       fprintf (stderr,
-               "scep_mfcc_file: error releasing auxiliary frames index\n");
+               "scep_mfcc_signal: error releasing auxiliary frames index\n");
       return EXIT_FAILURE;
     }
 
@@ -687,7 +487,74 @@ scep_mfcc_file (const char *in_file_name,
                      SFFT_DIRECT, SFFT_REAL);
   if (exit_status != EXIT_SUCCESS)
     {
-      fprintf (stderr, "scep_mfcc_file: error executing the DCT\n");
+      fprintf (stderr, "scep_mfcc_signal: error executing the DCT\n");
+      return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * scep_mfcc_file
+ *
+ * Calculates the MFCC's (Mel Frequency Cepstral Coefficients)
+ * for the given input file, according to the given parameter structure.
+ * The resulting lists are stored in the output 'mfcc_index'
+ *
+ * Parameters:
+ * - in_file_name: the input file name
+ * - param: the parameters structure
+ * - file_index: index where the file entry will be appended
+ * - mfcc_index: index where the MFCC's lists will be stored
+ */
+int
+scep_mfcc_file (const char *in_file_name,
+                const scep_parameter_type param,
+                index_list_type * file_index, index_list_type * mfcc_index)
+{
+  /* Auxiliary function exit status */
+  int exit_status;
+
+  /* Position of the input file on index */
+  smp_index_pos file_entry_position;
+
+  /* Just to make clear */
+  const index_entry_type NO_PARENT_ENTRY = NULL;
+
+
+  /* Adds an entry to the new index */
+  exit_status = add_index_entry (file_index,
+                                 "Input file index entry",
+                                 in_file_name,
+                                 NO_PARENT_ENTRY,
+                                 SMP_REAL, 0.0, 0.0, 0,
+                                 &file_entry_position, SMP_SET_CURRENT);
+
+  if (exit_status != EXIT_SUCCESS)
+    {
+      /* DESTROY INDEX !!! */
+      fprintf (stderr,
+               "scep_mfcc_file: error adding index entry for the file list\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Reads the input file */
+  exit_status = read_samples_file (file_index, file_entry_position);
+  if (exit_status != EXIT_SUCCESS)
+    {
+      /* DESTROY INDEX AND ENTRIES!!! */
+      fprintf (stderr, "scep_mfcc_file: error reading input file\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Calculates the MFCC's of the signal read */
+  exit_status = scep_mfcc_signal (file_index, param, mfcc_index);
+
+  if (exit_status != EXIT_SUCCESS)
+    {
+      fprintf (stderr, "scep_mfcc_file: error calculating MFCC's\n");
       return EXIT_FAILURE;
     }
 
@@ -778,3 +645,116 @@ scep_mfcc_file_write (const char *in_file_name,
 
   return EXIT_SUCCESS;
 }
+
+
+
+/*
+ * scep_mfcc_samples
+ *
+ * Calculates the MFCC's of the given samples of a signal sampled at
+ * 'samples_per_second', storing the resulting lists in the output
+ * 'mfcc_index'
+ */
+int
+scep_mfcc_samples (const cmp_real * samples,
+                   const smp_num_samples nu_samples,
+                   const cmp_real samples_per_second,
+                   const scep_parameter_type param,
+                   index_list_type * mfcc_index)
+{
+  /* Auxiliary function return status */
+  int exit_status;
+
+  /* Index holding the signal */
+  index_list_type signal_index;
+
+  /* Position of the signal on the index */
+  smp_index_pos signal_entry_position;
+
+  /* Current sample */
+  smp_num_samples cur_sample;
+
+  /* Auxiliary sample value */
+  cmp_complex aux_z;
+
+
+  if (samples == NULL || samples_per_second <= 0.0)
+    {
+      fprintf (stderr, "scep_mfcc_samples: no valid signal passed\n");
+      return EXIT_FAILURE;
+    }
+
+  exit_status = create_index (&signal_index, NULL);
+
+  if (exit_status != EXIT_SUCCESS)
+    {
+      fprintf (stderr, "scep_mfcc_samples: error creating signal index\n");
+      return EXIT_FAILURE;
+    }
+
+  exit_status = add_index_entry (&signal_index, "Input samples index entry",
+                                 "samples", NULL, SMP_REAL, 0.0,
+                                 1.0 / samples_per_second, 0,
+                                 &signal_entry_position, SMP_SET_CURRENT);
+
+  if (exit_status == EXIT_SUCCESS)
+    exit_status = resize_list (&(signal_index.current->list), nu_samples);
+
+  /* Sample lists start at 1 */
+  aux_z.im = 0.0;
+
+  for (cur_sample = 1;
+       cur_sample <= nu_samples && exit_status == EXIT_SUCCESS; cur_sample++)
+    {
+      aux_z.re = samples[cur_sample - 1];
+      exit_status =
+        set_list_value (signal_index.current->list, cur_sample, aux_z);
+    }
+
+  if (exit_status != EXIT_SUCCESS)
+    fprintf (stderr, "scep_mfcc_samples: error storing the samples\n");
+  else
+    exit_status = scep_mfcc_signal (&signal_index, param, mfcc_index);
+
+  if (destroy_index (&signal_index) != EXIT_SUCCESS)
+    {
+      fprintf (stderr, "scep_mfcc_samples: error releasing signal index\n");
+      return EXIT_FAILURE;
+    }
+
+  return exit_status;
+}
+
+
+
+/*
+ * scep_default_parameters
+ *
+ * Fills the parameter structure with the default feature extraction
+ * parameters
+ */
+void
+scep_default_parameters (scep_parameter_type * param)
+{
+  param->in_preemphasis = SWIN_YES;
+  param->alpha_preemphasis = 0.95;
+  param->frame_width = 512;
+  param->superposing_samples = 64;
+  param->windowing_function = SWIN_HAMMING;
+  param->triangular_window_low = 0.0;
+  param->triangular_window_center = 0.0;
+  param->triangular_window_high = 0.0;
+  param->triangular_window_central_value = 0.0;
+  param->kaiser_window_B = 0.0;
+  param->purge_zero_power = SWIN_PURGE_ZERO_POWER;
+  param->log_basis = 10.0;
+  param->delta_mel = 100.0;
+  param->total_filters = 16;
+  param->write_index = SMP_DONT_WRITE_INDEX;
+  param->write_lists = SMP_WRITE_LISTS;
+  param->write_time = SMP_WRITE_NORM_TIME;
+  param->write_files = SMP_WRITE_SINGLE_FILE;
+  param->write_break_lines = SMP_BREAK_LINES;
+  param->write_real_part = SMP_YES;
+  param->write_img_part = SMP_NO;
+}
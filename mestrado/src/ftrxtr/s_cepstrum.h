@@ -80,9 +80,8 @@ extern cmp_real scep_f_mel_to_hz (cmp_real f_mel);
 /*
  * scep_mel_scale
  *
- * Constructs and returns values from a look-up table,
- * containing the frequencies in Hz obtained from
- * the conversion of a series of equally spaced mel frequencies.
+ * Returns the frequencies in Hz of the given filter of a bank of
+ * filters with equally spaced mel frequencies.
  *
  * Parameters:
  * - delta_mel: mel frequency interval between filters
@@ -143,6 +142,21 @@ scep_mfcc_index (const index_list_type in_index,
 
 
 
+/*
+ * scep_mfcc_signal
+ *
+ * Calculates the MFCC's of the current list of the given index, holding a
+ * signal read from a file or given in memory, according to the given
+ * parameter structure. The resulting lists are stored in the output
+ * 'mfcc_index'
+ */
+extern int
+scep_mfcc_signal (index_list_type * signal_index,
+                  const scep_parameter_type param,
+                  index_list_type * mfcc_index);
+
+
+
 /*
  * scep_mfcc_file
  *
@@ -180,4 +194,39 @@ scep_mfcc_file_write (const char *in_file_name,
 
 
 
+/*
+ * scep_mfcc_samples
+ *
+ * Calculates the MFCC's of the given samples of a signal, as
+ * scep_mfcc_file does for the samples read from a file
+ *
+ * Parameters:
+ * - samples: the signal samples
+ * - nu_samples: number of samples
+ * - samples_per_second: sampling rate of the signal
+ * - param: parameters structure
+ * - mfcc_index: index where the MFCC's lists will be stored
+ */
+extern int
+scep_mfcc_samples (const cmp_real * samples,
+                   const smp_num_samples nu_samples,
+                   const cmp_real samples_per_second,
+                   const scep_parameter_type param,
+                   index_list_type * mfcc_index);
+
+
+
+/*
+ * scep_default_parameters
+ *
+ * Fills the parameter structure with the default feature extraction
+ * parameters: 512-sample Hamming frames overlapping by 64 samples, with
+ * pre-emphasis (0.95), zero power frames purged and 16 filters 100 mel
+ * apart. The lists are written to a single file, one value per line,
+ * with the frame and sample numbers.
+ */
+extern void scep_default_parameters (scep_parameter_type * param);
+
+
+
 #endif /* __S_CEPSTRUM_H_ */
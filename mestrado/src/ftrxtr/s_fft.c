@@ -7,7 +7,6 @@
 #include "s_complex.h"
 #include "s_smptypes.h"
 #include "s_fft.h"
-#include "../incstat/incstat.h"
 
 /*
  * sfft_sup_power
@@ -169,15 +168,9 @@ sfft_next_index (smp_bit_vector * bit_vector,
  * - reversed_index: N-bit-reversed sample index
  */
 int
-sfft_bit_reverse (const smp_num_samples index,
+sfft_bit_reverse (sfft_tables_type * tables, const smp_num_samples index,
                   const smp_num_samples N, smp_num_samples * reversed_index)
 {
-  /* The N-bit reversed indexes vector is implemented as a static list */
-  static sample_list_type *R_indexes = NULL;
-
-  /* The last N used for the vector construction is also stored statically */
-  static smp_num_samples N_internal = 0;
-
   /* Internal bit-vector */
   smp_bit_vector bit_vector;
 
@@ -218,14 +211,11 @@ sfft_bit_reverse (const smp_num_samples index,
    */
 
   /* If a different N was requested, the list needs reconstruction */
-  if (N != N_internal)
+  if (N != tables->R_exponent)
     {
       /* Frees the old list */
-      if (N_internal > 0)
-        destroy_list (&R_indexes);
-
-      /* Clears the statistics */
-      istt_clear_stat ();
+      if (tables->R_exponent > 0)
+        destroy_list (&(tables->R_indexes));
 
       /* If N = 0, no list should be created */
       if (N > 0)
@@ -260,7 +250,8 @@ sfft_bit_reverse (const smp_num_samples index,
             }
 
           /* Create the new look-up table N-bit-reversed indexes */
-          exit_status = create_list (&R_indexes, SMP_REAL, 0.0, 0.0, 0);
+          exit_status =
+            create_list (&(tables->R_indexes), SMP_REAL, 0.0, 0.0, 0);
           if (exit_status != EXIT_SUCCESS)
             {
               fprintf (stderr,
@@ -271,7 +262,7 @@ sfft_bit_reverse (const smp_num_samples index,
             }
 
           /* Allocates memory for the list */
-          exit_status = resize_list (&R_indexes, aux_power);
+          exit_status = resize_list (&(tables->R_indexes), aux_power);
           if (exit_status != EXIT_SUCCESS)
             {
               fprintf (stderr,
@@ -290,7 +281,8 @@ sfft_bit_reverse (const smp_num_samples index,
               aux_z.im = 0.0;
 
               /* Sets the value in the look-up table */
-              exit_status = set_list_value (R_indexes, aux_index + 1, aux_z);
+              exit_status =
+                set_list_value (tables->R_indexes, aux_index + 1, aux_z);
               if (exit_status != EXIT_SUCCESS)
                 {
                   fprintf (stderr,
@@ -309,20 +301,18 @@ sfft_bit_reverse (const smp_num_samples index,
                 }
             }                   /* Look-up table construction */
 
+          free (bit_vector);
         }                       /* End of the list creation */
 
-      /* Update internal N value */
-      N_internal = N;
-
-      /* Clear the statistics */
-      istt_clear_stat ();
-
-    }                           /* N != N_internal */
+      /* Update the table exponent */
+      tables->R_exponent = N;
+    }                           /* N != R_exponent */
 
   /* Get the return value from the look-up table */
   if (N > 0)
     {
-      exit_status = get_list_value (*R_indexes, index + 1, &aux_z);
+      exit_status =
+        get_list_value (*(tables->R_indexes), index + 1, &aux_z);
       if (exit_status != EXIT_SUCCESS)
         {
           fprintf (stderr,
@@ -358,14 +348,9 @@ sfft_bit_reverse (const smp_num_samples index,
  * - W: the complex twiddle factor W at frequency k
  */
 int
-sfft_W (const smp_num_samples k, const smp_num_samples N, cmp_complex * W)
+sfft_W (sfft_tables_type * tables,
+        const smp_num_samples k, const smp_num_samples N, cmp_complex * W)
 {
-  /* The twiddle factors vector is implemented as a static list */
-  static sample_list_type *W_factors = NULL;
-
-  /* The last N used for the vector construction is also stored statically */
-  static smp_num_samples N_internal = 0;
-
   /* Auxiliary internal exponent of N */
   smp_num_samples Nexp;
 
@@ -392,24 +377,22 @@ sfft_W (const smp_num_samples k, const smp_num_samples N, cmp_complex * W)
     }
    */
 
-  if (N > N_internal)
+  if (N > tables->W_samples || N == 0)
     {
       /* The vector needs reconstruction */
-      exit_status = destroy_list (&W_factors);
+      exit_status = destroy_list (&(tables->W_factors));
       if (exit_status != EXIT_SUCCESS)
         {
           fprintf (stderr, "sfft_W: error destroying old W-factors list\n");
           return EXIT_FAILURE;
         }
 
-      /* Clear the statistics */
-      istt_clear_stat ();
-
       /* If N = 0, no list should be created */
       if (N > 0)
         {
           /* Creates the new list */
-          exit_status = create_list (&W_factors, SMP_COMPLEX, 0.0, 0.0, 0);
+          exit_status =
+            create_list (&(tables->W_factors), SMP_COMPLEX, 0.0, 0.0, 0);
           if (exit_status != EXIT_SUCCESS)
             {
               fprintf (stderr,
@@ -423,7 +406,7 @@ sfft_W (const smp_num_samples k, const smp_num_samples N, cmp_complex * W)
             Nexp++;
 
           /* Resizes the list */
-          exit_status = resize_list (&W_factors, N);
+          exit_status = resize_list (&(tables->W_factors), N);
           if (exit_status != EXIT_SUCCESS)
             {
               fprintf (stderr, "sfft_W: error allocating memory space\n");
@@ -438,7 +421,8 @@ sfft_W (const smp_num_samples k, const smp_num_samples N, cmp_complex * W)
               aux_W.im = (cmp_real) - sin (2 * PI * aux_k / N);
 
               /* Add the current value to the list */
-              exit_status = set_list_value (W_factors, aux_k + 1, aux_W);
+              exit_status =
+                set_list_value (tables->W_factors, aux_k + 1, aux_W);
               if (exit_status != EXIT_SUCCESS)
                 {
                   fprintf (stderr, "sfft_W: error setting %ld-th factor\n",
@@ -448,20 +432,18 @@ sfft_W (const smp_num_samples k, const smp_num_samples N, cmp_complex * W)
             }
         }
 
-      /* Update the internal value of N */
-      N_internal = N;
-
-      /* Clear the statistics */
-      istt_clear_stat ();
+      /* Update the table size */
+      tables->W_samples = N;
     }
 
 
   /* Get the list value at the transposed position */
   if (N > 0)
     {
-      k_transp = (k * (N_internal / N)) % N_internal;
+      k_transp = (k * (tables->W_samples / N)) % tables->W_samples;
 
-      exit_status = get_list_value (*W_factors, k_transp + 1, &return_W);
+      exit_status =
+        get_list_value (*(tables->W_factors), k_transp + 1, &return_W);
       if (exit_status != EXIT_SUCCESS)
         {
           fprintf (stderr, "sfft_W: error retrieving twiddle factor\n");
@@ -498,7 +480,8 @@ sfft_W (const smp_num_samples k, const smp_num_samples N, cmp_complex * W)
  * otherwise ('SMP_COMPLEX') the complex transform will be computed.
  */
 int
-sfft_exec (index_list_type * in_index,
+sfft_exec (sfft_tables_type * tables,
+           index_list_type * in_index,
            index_list_type * out_index,
            smp_index_pos * out_pos,
            const sfft_place_type place,
@@ -730,7 +713,8 @@ sfft_exec (index_list_type * in_index,
     {
       /* Get the N-bit-reversed index */
       exit_status =
-        sfft_bit_reverse (aux_index, N_exponent, &aux_reversed_index);
+        sfft_bit_reverse (tables, aux_index, N_exponent,
+                          &aux_reversed_index);
       if (exit_status != EXIT_SUCCESS)
         {
           fprintf (stderr, "sfft_exec: error reverting bits of index %ld\n",
@@ -808,7 +792,7 @@ sfft_exec (index_list_type * in_index,
    * 4. Create the twiddle vector list for the number of samples 'N'
    */
 
-  exit_status = sfft_W (0, N, &aux_W);
+  exit_status = sfft_W (tables, 0, N, &aux_W);
   if (exit_status != EXIT_SUCCESS)
     {
       fprintf (stderr, "sfft_exec: error creating twiddle vector\n");
@@ -872,7 +856,7 @@ sfft_exec (index_list_type * in_index,
                 }
 
               /* Get the twiddle factor */
-              exit_status = sfft_W (cur_bfly, points, &aux_W);
+              exit_status = sfft_W (tables, cur_bfly, points, &aux_W);
               if (exit_status != EXIT_SUCCESS)
                 {
                   fprintf (stderr,
@@ -1144,7 +1128,8 @@ sfft_dct_coefficient (const smp_num_samples N, const smp_num_samples k,
  * will be rescaled by a 1/N factor
  */
 int
-sfft_dct_exec (index_list_type * in_index,
+sfft_dct_exec (sfft_tables_type * tables,
+               index_list_type * in_index,
                index_list_type * out_index, smp_index_pos * out_pos,
                const sfft_place_type place,
                const sfft_direction_type direction)
@@ -1186,7 +1171,8 @@ sfft_dct_exec (index_list_type * in_index,
 
   /* Executes the FFT of the extended list */
   exit_status =
-    sfft_exec (in_index, out_index, out_pos, place, direction, SFFT_REAL);
+    sfft_exec (tables, in_index, out_index, out_pos, place, direction,
+               SFFT_REAL);
   if (exit_status != EXIT_SUCCESS)
     {
       fprintf (stderr,
@@ -1258,6 +1244,8 @@ sfft_dct_exec (index_list_type * in_index,
  * Executes the FFT for all the signal lists
  * in the given input index 'in_index'.
  * A new index 'out_index' is created with the transformed signals.
+ * The bit-reversion and twiddle factor look-up tables live for the
+ * duration of the call.
  */
 int
 sfft_exec_index (index_list_type * in_index, index_list_type * out_index,
@@ -1272,6 +1260,9 @@ sfft_exec_index (index_list_type * in_index, index_list_type * out_index,
   /* Auxiliary out list position */
   smp_index_pos out_pos;
 
+  /* Look-up tables of the transforms of this call */
+  sfft_tables_type tables = { NULL, 0, NULL, 0 };
+
   /* Auxiliary reversed index */
   smp_num_samples aux_reversed_index;
 
@@ -1279,7 +1270,7 @@ sfft_exec_index (index_list_type * in_index, index_list_type * out_index,
   cmp_complex aux_z;
 
   /* Auxiliary function return status flag */
-  int exit_status;
+  int exit_status = EXIT_SUCCESS;
 
 
   /*
@@ -1300,26 +1291,30 @@ sfft_exec_index (index_list_type * in_index, index_list_type * out_index,
   in_index->current = in_index->head;
 
   /* List transform loop */
-  for (cur_list = 1; cur_list <= in_index->num_entries; cur_list++)
+  for (cur_list = 1;
+       cur_list <= in_index->num_entries && exit_status == EXIT_SUCCESS;
+       cur_list++)
     {
       /* Executes the requested transform for the current list */
       switch (transform)
         {
         case SFFT_FFT:
           exit_status =
-            sfft_exec (in_index, out_index, &out_pos, place, direction,
-                       domain);
+            sfft_exec (&tables, in_index, out_index, &out_pos, place,
+                       direction, domain);
           break;
 
         case SFFT_FCT:
           exit_status =
-            sfft_dct_exec (in_index, out_index, &out_pos, place, direction);
+            sfft_dct_exec (&tables, in_index, out_index, &out_pos, place,
+                           direction);
           break;
 
         default:
           {
             fprintf (stderr, "sfft_exec_index: invalid transform domain\n");
-            return EXIT_FAILURE;
+            exit_status = EXIT_FAILURE;
+            continue;
           }
         }
 
@@ -1328,7 +1323,7 @@ sfft_exec_index (index_list_type * in_index, index_list_type * out_index,
           fprintf (stderr,
                    "sfft_exec_index: error executing FFT of list %ld\n",
                    cur_list);
-          return EXIT_FAILURE;
+          continue;
         }
 
       /* Moves to the next entry */
@@ -1337,22 +1332,20 @@ sfft_exec_index (index_list_type * in_index, index_list_type * out_index,
     }
 
   /* Releases memory allocated for bit-reversion */
-  exit_status = sfft_bit_reverse (0, 0, &aux_reversed_index);
-  if (exit_status != EXIT_SUCCESS)
+  if (sfft_bit_reverse (&tables, 0, 0, &aux_reversed_index) != EXIT_SUCCESS)
     {
       fprintf (stderr,
                "sfft_exec_index: error releasing memory for bit-reversion look-up table\n");
       return EXIT_FAILURE;
     }
 
-  /* Releases memory allocated for bit-reversion */
-  exit_status = sfft_W (0, 0, &aux_z);
-  if (exit_status != EXIT_SUCCESS)
+  /* Releases memory allocated for the twiddle factors */
+  if (sfft_W (&tables, 0, 0, &aux_z) != EXIT_SUCCESS)
     {
       fprintf (stderr,
                "sfft_exec_index: error releasing memory for W-factors look-up table\n");
       return EXIT_FAILURE;
     }
 
-  return EXIT_SUCCESS;
+  return exit_status;
 }
@@ -45,6 +45,23 @@ typedef enum
 { SFFT_DIRECT, SFFT_INVERSE }
 sfft_direction_type;
 
+/*
+ * FFT look-up tables
+ * - R_indexes: N-bit-reversed indexes for the exponent 'R_exponent'
+ * - W_factors: twiddle factors for 'W_samples' samples
+ * The tables are built on demand by sfft_bit_reverse and sfft_W, and
+ * released by calling them with N = 0. Each caller keeps its own tables,
+ * so transforms may run concurrently in several threads.
+ */
+typedef struct
+{
+  sample_list_type *R_indexes;
+  smp_num_samples R_exponent;
+  sample_list_type *W_factors;
+  smp_num_samples W_samples;
+}
+sfft_tables_type;
+
 
 
 /*
@@ -63,6 +80,7 @@ sfft_sup_power (const smp_num_samples basis, const smp_num_samples x,
  *
  * Returns the N bit-reversed sample index, required for the
  * initialization of the FFT algorithm.
+ * - tables: look-up tables of the caller
  * - index: is the sample index
  * - N: integer positive exponent, representing the sample size as two to the
  *      N-th power
@@ -70,7 +88,8 @@ sfft_sup_power (const smp_num_samples basis, const smp_num_samples x,
  *   sample index
  */
 int
-sfft_bit_reverse (const smp_num_samples index, const smp_num_samples N,
+sfft_bit_reverse (sfft_tables_type * tables,
+                  const smp_num_samples index, const smp_num_samples N,
                   smp_num_samples * reversed_index);
 
 
@@ -84,13 +103,15 @@ sfft_bit_reverse (const smp_num_samples index, const smp_num_samples N,
  * Note that the twiddle factors are N-periodic. So W(k+N,N) = W(k,N).
  *
  * Input values
+ * - tables: look-up tables of the caller
  * - k: discrete frequency value
  * - N: the number of samples
  *
  * Output value
  * - W: the complex twiddle factor W at frequency k
  */
-int sfft_W (const smp_num_samples k, const smp_num_samples N,
+int sfft_W (sfft_tables_type * tables,
+            const smp_num_samples k, const smp_num_samples N,
             cmp_complex * W);
 
 
@@ -111,7 +132,8 @@ int sfft_W (const smp_num_samples k, const smp_num_samples N,
  * otherwise ('SMP_COMPLEX'), the complex transform will be computed.
  */
 int
-sfft_exec (index_list_type * in_index,
+sfft_exec (sfft_tables_type * tables,
+           index_list_type * in_index,
            index_list_type * out_index, smp_index_pos * out_pos,
            const sfft_place_type place, const sfft_direction_type direction,
            const sfft_domain_type domain);
@@ -133,7 +155,8 @@ sfft_exec (index_list_type * in_index,
  * will be rescaled by a 1/N factor
  */
 int
-sfft_dct_exec (index_list_type * in_index,
+sfft_dct_exec (sfft_tables_type * tables,
+               index_list_type * in_index,
                index_list_type * out_index, smp_index_pos * out_pos,
                const sfft_place_type place,
                const sfft_direction_type direction);
@@ -339,6 +339,34 @@ write_list (const sample_list_type smp_list,
 
 
 
+/*
+ * read_raw_token
+ *
+ * Returns the next token of a line, as strtok does, keeping its position
+ * in 'cursor' instead of a static variable
+ */
+static char *
+read_raw_token (char **cursor, const char *delimiters)
+{
+  char *token;                  /* token start */
+
+
+  *cursor += strspn (*cursor, delimiters);
+
+  if (**cursor == '\0')
+    return NULL;
+
+  token = *cursor;
+  *cursor += strcspn (*cursor, delimiters);
+
+  if (**cursor != '\0')
+    *(*cursor)++ = '\0';
+
+  return token;
+}
+
+
+
 /*
  * read_raw_file
  *
@@ -351,6 +379,7 @@ read_raw_file (FILE * fp, sample_list_type * smp_list)
   const char delimiters[] = " ,;()ijIJ[]{}";    /* characters to be parsed */
   cmp_complex aux_z;            /* auxiliary complex number read */
   char *cp;                     /* auxiliary character */
+  char *cursor;                 /* parsing position in the buffer */
   int exit_status;              /* auxiliary function return status */
 
 
@@ -362,7 +391,8 @@ read_raw_file (FILE * fp, sample_list_type * smp_list)
           /* Avoid empty lines */
           if (*buf != '\0')
             {
-              cp = (char *) strtok (buf, delimiters);
+              cursor = buf;
+              cp = read_raw_token (&cursor, delimiters);
 
               /* Reads the real part - supposed to be first */
               if (cp != NULL)
@@ -375,7 +405,7 @@ read_raw_file (FILE * fp, sample_list_type * smp_list)
                 {
                   if (cp != NULL)
                     {
-                      cp = (char *) strtok (NULL, delimiters);
+                      cp = read_raw_token (&cursor, delimiters);
 
                       if (cp != NULL)
                         aux_z.im = strtod (cp, NULL);
@@ -583,9 +613,6 @@ read_samples_file (index_list_type * index, const smp_index_pos pos)
       return EXIT_FAILURE;
     }
 
-  /* Initialize the list's statistics */
-  istt_clear_stat ();
-
   /* Reads the samples file according to its type */
   switch (entry->file_type)
     {
@@ -3,11 +3,20 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <pthread.h>
 #include "s_complex.h"
 #include "s_smptypes.h"
 #include "../incstat/incstat.h"
 #include "s_samples.h"
 
+/*
+ * Sequence of index identifiers, shared by all the threads
+ */
+static smp_index_pos index_seq = 0;
+static pthread_mutex_t index_seq_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+
 /*
  * get_new_index_id
  *
@@ -16,12 +25,15 @@
 static smp_index_pos
 get_new_index_id (void)
 {
-  static smp_index_pos index_seq = 0;
+  smp_index_pos index_id;       /* new index identifier */
+
 
   /* Returns the current value of index_seq */
-  ++index_seq;
+  pthread_mutex_lock (&index_seq_lock);
+  index_id = index_seq++;
+  pthread_mutex_unlock (&index_seq_lock);
 
-  return (smp_index_pos) index_seq - 1;
+  return index_id;
 }
 
 
@@ -593,6 +605,10 @@ create_list (sample_list_type ** smp_list, const smp_entries_type data_type,
              const cmp_real ini_time, const cmp_real inc_time,
              const smp_num_samples ini_norm_time)
 {
+  /* Statistics of the empty list */
+  istt_stat_type stat;
+
+
   /* Allocates memory space for the new list */
   (*smp_list) = (sample_list_type *) malloc (sizeof (sample_list_type));
   if ((*smp_list) == NULL)
@@ -620,10 +636,10 @@ create_list (sample_list_type ** smp_list, const smp_entries_type data_type,
   (*smp_list)->ini_norm_time = ini_norm_time;
 
   /* Initialize the statistics */
-  istt_clear_stat ();
+  istt_clear_stat (&stat);
 
   /* Update the statistics */
-  update_list_statistics (smp_list);
+  update_list_statistics (smp_list, &stat);
 
   /* Marks the list's statistics status as valid */
   (*smp_list)->valid_stats = SMP_YES;
@@ -898,21 +914,21 @@ add_list_value (sample_list_type ** smp_list, const cmp_complex value)
  * Update the list's statistics
  */
 void
-update_list_statistics (sample_list_type ** smp_list)
+update_list_statistics (sample_list_type ** smp_list, const IncStat stat)
 {
   /* Update the list's statistics */
-  (*smp_list)->sum.re = (cmp_real) istt_sum_x ();
-  (*smp_list)->sum.im = (cmp_real) istt_sum_y ();
-  (*smp_list)->avg.re = (cmp_real) istt_average_x ();
-  (*smp_list)->avg.im = (cmp_real) istt_average_y ();
-  (*smp_list)->var.re = (cmp_real) istt_variance_x ();
-  (*smp_list)->var.im = (cmp_real) istt_variance_y ();
-  (*smp_list)->std.re = (cmp_real) istt_stddev_x ();
-  (*smp_list)->std.im = (cmp_real) istt_stddev_y ();
-  (*smp_list)->max.re = (cmp_real) istt_max_x ();
-  (*smp_list)->max.im = (cmp_real) istt_max_y ();
-  (*smp_list)->min.re = (cmp_real) istt_min_x ();
-  (*smp_list)->min.im = (cmp_real) istt_min_y ();
+  (*smp_list)->sum.re = (cmp_real) istt_sum_x (stat);
+  (*smp_list)->sum.im = (cmp_real) istt_sum_y (stat);
+  (*smp_list)->avg.re = (cmp_real) istt_average_x (stat);
+  (*smp_list)->avg.im = (cmp_real) istt_average_y (stat);
+  (*smp_list)->var.re = (cmp_real) istt_variance_x (stat);
+  (*smp_list)->var.im = (cmp_real) istt_variance_y (stat);
+  (*smp_list)->std.re = (cmp_real) istt_stddev_x (stat);
+  (*smp_list)->std.im = (cmp_real) istt_stddev_y (stat);
+  (*smp_list)->max.re = (cmp_real) istt_max_x (stat);
+  (*smp_list)->max.im = (cmp_real) istt_max_y (stat);
+  (*smp_list)->min.re = (cmp_real) istt_min_x (stat);
+  (*smp_list)->min.im = (cmp_real) istt_min_y (stat);
 }
 
 
@@ -932,6 +948,9 @@ calculate_list_statistics (sample_list_type ** smp_list)
   /* Auxiliary sample value */
   cmp_complex aux_z;
 
+  /* Statistics of the list values */
+  istt_stat_type stat;
+
   /* Auxiliary function return status */
   int exit_status;
 
@@ -940,7 +959,7 @@ calculate_list_statistics (sample_list_type ** smp_list)
   if ((*smp_list)->valid_stats != SMP_YES)
     {
       /* Clear the statistics */
-      istt_clear_stat ();
+      istt_clear_stat (&stat);
 
       /* Sets the number of samples */
       samples = (*smp_list)->samples;
@@ -959,17 +978,14 @@ calculate_list_statistics (sample_list_type ** smp_list)
             }
 
           /* Increments the statistics */
-          istt_add_stat (aux_z.re, aux_z.im);
+          istt_add_stat (&stat, aux_z.re, aux_z.im);
         }
 
       /* Update the list's statistics */
-      update_list_statistics (smp_list);
+      update_list_statistics (smp_list, &stat);
 
       /* Set the 'valid_stats' flag to yes */
       (*smp_list)->valid_stats = SMP_YES;
-
-      /* Clear the statistics again for future use */
-      istt_clear_stat ();
     }
 
   return EXIT_SUCCESS;
@@ -2,6 +2,7 @@
 #define __SMP_SAMPLES_ 1
 
 #include "s_smptypes.h"
+#include "../incstat/incstat.h"
 
 /******************************************************************************
  *                                                                            *
@@ -186,9 +187,10 @@ int add_list_value (sample_list_type ** smp_list, const cmp_complex value);
 /*
  * update_list_statistics
  *
- * Update the list's statistics
+ * Update the list's statistics from the given accumulated statistics
  */
-void update_list_statistics (sample_list_type ** smp_list);
+void update_list_statistics (sample_list_type ** smp_list,
+                             const IncStat stat);
 
 
 /*
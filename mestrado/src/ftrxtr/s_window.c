@@ -216,9 +216,8 @@ static int
 swin_win_kaiser_bessel (const long int i, const smp_num_samples N,
                         const spre_real B, spre_real * value)
 {
-  /* Auxiliary variables, defined to avoid re-calculation of I_0 (B) */
-  static spre_real last_B = 0.0;
-  static spre_real i0_B = 0.0;
+  /* Value of the denominator, I_0 (B) */
+  spre_real i0_B;
 
   /* Value of the numerator */
   spre_real num;
@@ -231,18 +230,13 @@ swin_win_kaiser_bessel (const long int i, const smp_num_samples N,
 
 
 
-  /* Checks if i0_B needs to be re-calculated */
-  if (fabs (last_B - B) > DBL_EPSILON)
+  /* Calculates the denominator: a closed form, cheaper than caching it */
+  exit_status = swin_win_zero_order_bessel_function (B, &i0_B);
+  if (exit_status != EXIT_SUCCESS)
     {
-      /* B changed. Re-calculate i0_B */
-      exit_status = swin_win_zero_order_bessel_function (B, &i0_B);
-      if (exit_status != EXIT_SUCCESS)
-        {
-          fprintf (stderr,
-                   "swin_win_kaiser_bessel: error calculating zero order bessel function\n");
-          return EXIT_FAILURE;
-        }
-      last_B = B;
+      fprintf (stderr,
+               "swin_win_kaiser_bessel: error calculating zero order bessel function\n");
+      return EXIT_FAILURE;
     }
 
   /* Calculates the numerator of the expression */
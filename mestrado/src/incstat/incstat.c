@@ -8,46 +8,29 @@
 
 #define __ISTT_SQR_(x) (x)*(x)
 
-/*
- * Internal static statistic parameters
- */
-static UsLgIntValue int_samples = 0;
-static RValue int_sum_x = 0.0, int_sum_y = 0.0;
-static RValue int_avg_x = 0.0, int_avg_x_old = 0.0;
-static RValue int_avg_y = 0.0, int_avg_y_old = 0.0;
-static RValue int_sqr_diff_x = 0.0, int_sqr_diff_y = 0.0;
-static RValue int_max_x = 0.0, int_min_x = 0.0;
-static RValue int_max_y = 0.0, int_min_y = 0.0;
-static RValue int_sum_sqr_x = 0.0, int_sum_sqr_y = 0.0;
-static RValue int_sum_sqr_diff_xy = 0.0;
-static RValue int_sum_xy = 0.0;
-
-
 /*
  * istt_clear_stat
  *
- * Initializes all the internal statistics
+ * Initializes all the statistics of the accumulator
  */
 void
-istt_clear_stat (void)
+istt_clear_stat (IncStat stat)
 {
-  int_samples = 0;
-  int_sum_x = 0.0;
-  int_sum_y = 0.0;
-  int_avg_x = 0.0;
-  int_avg_x_old = 0.0;
-  int_avg_y = 0.0;
-  int_avg_y_old = 0.0;
-  int_sqr_diff_x = 0.0;
-  int_sqr_diff_y = 0.0;
-  int_sum_sqr_x = 0.0;
-  int_sum_sqr_y = 0.0;
-  int_sum_sqr_diff_xy = 0.0;
-  int_sum_xy = 0.0;
-  int_max_x = 0.0;
-  int_min_x = 0.0;
-  int_max_y = 0.0;
-  int_min_y = 0.0;
+  stat->samples = 0;
+  stat->sum_x = 0.0;
+  stat->sum_y = 0.0;
+  stat->avg_x = 0.0;
+  stat->avg_y = 0.0;
+  stat->sqr_diff_x = 0.0;
+  stat->sqr_diff_y = 0.0;
+  stat->sum_sqr_x = 0.0;
+  stat->sum_sqr_y = 0.0;
+  stat->sum_sqr_diff_xy = 0.0;
+  stat->sum_xy = 0.0;
+  stat->max_x = 0.0;
+  stat->min_x = 0.0;
+  stat->max_y = 0.0;
+  stat->min_y = 0.0;
 }
 
 
@@ -57,59 +40,63 @@ istt_clear_stat (void)
  * Adds a new observation
  */
 void
-istt_add_stat (RValue x, RValue y)
+istt_add_stat (IncStat stat, const RValue x, const RValue y)
 {
+  RValue avg_x_old;             /* x average before the observation */
+  RValue avg_y_old;             /* y average before the observation */
+
+
   /*
    * Averages
    */
-  int_avg_x_old = int_avg_x;
-  int_avg_y_old = int_avg_y;
-  int_avg_x = (int_samples * int_avg_x + x) / (int_samples + 1);
-  int_avg_y = (int_samples * int_avg_y + y) / (int_samples + 1);
+  avg_x_old = stat->avg_x;
+  avg_y_old = stat->avg_y;
+  stat->avg_x = (stat->samples * stat->avg_x + x) / (stat->samples + 1);
+  stat->avg_y = (stat->samples * stat->avg_y + y) / (stat->samples + 1);
 
   /*
    * Accumulators
    */
-  int_sum_x += x;
-  int_sum_y += y;
-  int_sum_sqr_x += __ISTT_SQR_ (x);
-  int_sum_sqr_y += __ISTT_SQR_ (y);
-  int_sum_xy += x * y;
-  int_sum_sqr_diff_xy += __ISTT_SQR_ (x - y);
+  stat->sum_x += x;
+  stat->sum_y += y;
+  stat->sum_sqr_x += __ISTT_SQR_ (x);
+  stat->sum_sqr_y += __ISTT_SQR_ (y);
+  stat->sum_xy += x * y;
+  stat->sum_sqr_diff_xy += __ISTT_SQR_ (x - y);
 
   /*
    * Square Differences
    */
-  int_sqr_diff_x +=
-    int_samples / __ISTT_SQR_ (int_samples + 1)
-    * __ISTT_SQR_ (int_avg_x_old - x) + __ISTT_SQR_ (int_avg_x - x);
+  stat->sqr_diff_x +=
+    stat->samples / __ISTT_SQR_ (stat->samples + 1)
+    * __ISTT_SQR_ (avg_x_old - x) + __ISTT_SQR_ (stat->avg_x - x);
 
-  int_sqr_diff_y +=
-    +int_samples / __ISTT_SQR_ (int_samples + 1)
-    * __ISTT_SQR_ (int_avg_y_old - y) + __ISTT_SQR_ (int_avg_y - y);
+  stat->sqr_diff_y +=
+    +stat->samples / __ISTT_SQR_ (stat->samples + 1)
+    * __ISTT_SQR_ (avg_y_old - y) + __ISTT_SQR_ (stat->avg_y - y);
 
   /*
    * Maxima and minima
    */
-  if (int_samples == 0)
+  if (stat->samples == 0)
     {
-      int_min_x = x;
-      int_max_x = x;
-      int_min_y = y;
-      int_max_y = y;
+      stat->min_x = x;
+      stat->max_x = x;
+      stat->min_y = y;
+      stat->max_y = y;
     }
   else
     {
-      int_min_x = (int_min_x - x < DBL_EPSILON ? int_min_x : x);
-      int_max_x = (int_max_x - x > DBL_EPSILON ? int_max_x : x);
-      int_min_y = (int_min_y - y < DBL_EPSILON ? int_min_y : y);
-      int_max_y = (int_max_y - y > DBL_EPSILON ? int_max_y : y);
+      stat->min_x = (stat->min_x - x < DBL_EPSILON ? stat->min_x : x);
+      stat->max_x = (stat->max_x - x > DBL_EPSILON ? stat->max_x : x);
+      stat->min_y = (stat->min_y - y < DBL_EPSILON ? stat->min_y : y);
+      stat->max_y = (stat->max_y - y > DBL_EPSILON ? stat->max_y : y);
     }
 
   /*
    * Number of observations
    */
-  int_samples++;
+  stat->samples++;
 }
 
 
@@ -120,9 +107,9 @@ istt_add_stat (RValue x, RValue y)
  * Returns the current number of observations
  */
 UsLgIntValue
-istt_samples (void)
+istt_samples (const IncStat stat)
 {
-  return int_samples;
+  return stat->samples;
 }
 
 
@@ -133,9 +120,9 @@ istt_samples (void)
  * Returns the average of the x observations
  */
 RValue
-istt_average_x (void)
+istt_average_x (const IncStat stat)
 {
-  return int_avg_x;
+  return stat->avg_x;
 }
 
 
@@ -146,9 +133,9 @@ istt_average_x (void)
  * Returns the average of the y observations
  */
 RValue
-istt_average_y (void)
+istt_average_y (const IncStat stat)
 {
-  return int_avg_y;
+  return stat->avg_y;
 }
 
 
@@ -159,10 +146,10 @@ istt_average_y (void)
  * Returns the variance of the x observations
  */
 RValue
-istt_variance_x (void)
+istt_variance_x (const IncStat stat)
 {
-  if (int_samples > 0)
-    return int_sqr_diff_x / int_samples;
+  if (stat->samples > 0)
+    return stat->sqr_diff_x / stat->samples;
   else
     return 0.0;
 }
@@ -175,10 +162,10 @@ istt_variance_x (void)
  * Returns the variance of the y observations
  */
 RValue
-istt_variance_y (void)
+istt_variance_y (const IncStat stat)
 {
-  if (int_samples > 0)
-    return int_sqr_diff_y / int_samples;
+  if (stat->samples > 0)
+    return stat->sqr_diff_y / stat->samples;
   else
     return 0.0;
 }
@@ -191,10 +178,10 @@ istt_variance_y (void)
  * Returns the standard deviation of the x observations
  */
 RValue
-istt_stddev_x (void)
+istt_stddev_x (const IncStat stat)
 {
-  if (int_samples > 0)
-    return sqrt (int_sqr_diff_x / int_samples);
+  if (stat->samples > 0)
+    return sqrt (stat->sqr_diff_x / stat->samples);
   else
     return 0.0;
 }
@@ -207,10 +194,10 @@ istt_stddev_x (void)
  * Returns the standard deviation of the y observations
  */
 RValue
-istt_stddev_y (void)
+istt_stddev_y (const IncStat stat)
 {
-  if (int_samples > 0)
-    return sqrt (int_sqr_diff_y / int_samples);
+  if (stat->samples > 0)
+    return sqrt (stat->sqr_diff_y / stat->samples);
   else
     return 0.0;
 }
@@ -223,9 +210,9 @@ istt_stddev_y (void)
  * Returns the maximum value of the x observations
  */
 RValue
-istt_max_x (void)
+istt_max_x (const IncStat stat)
 {
-  return int_max_x;
+  return stat->max_x;
 }
 
 
@@ -236,9 +223,9 @@ istt_max_x (void)
  * Returns the minimum value of the x observations
  */
 RValue
-istt_min_x (void)
+istt_min_x (const IncStat stat)
 {
-  return int_min_x;
+  return stat->min_x;
 }
 
 
@@ -249,9 +236,9 @@ istt_min_x (void)
  * Returns the maximum value of the y observations
  */
 RValue
-istt_max_y (void)
+istt_max_y (const IncStat stat)
 {
-  return int_max_y;
+  return stat->max_y;
 }
 
 
@@ -262,9 +249,9 @@ istt_max_y (void)
  * Returns the minimum value of the y observations
  */
 RValue
-istt_min_y (void)
+istt_min_y (const IncStat stat)
 {
-  return int_min_y;
+  return stat->min_y;
 }
 
 
@@ -275,9 +262,9 @@ istt_min_y (void)
  * Returns the sum of all the x observations
  */
 RValue
-istt_sum_x (void)
+istt_sum_x (const IncStat stat)
 {
-  return int_sum_x;
+  return stat->sum_x;
 }
 
 
@@ -288,9 +275,9 @@ istt_sum_x (void)
  * Returns the sum of all the y observations
  */
 RValue
-istt_sum_y (void)
+istt_sum_y (const IncStat stat)
 {
-  return int_sum_y;
+  return stat->sum_y;
 }
 
 
@@ -301,9 +288,9 @@ istt_sum_y (void)
  * Returns the sum of the squared x observations
  */
 RValue
-istt_sum_sqr_x (void)
+istt_sum_sqr_x (const IncStat stat)
 {
-  return int_sum_sqr_x;
+  return stat->sum_sqr_x;
 }
 
 
@@ -314,9 +301,9 @@ istt_sum_sqr_x (void)
  * Returns the sum of the squared y observations
  */
 RValue
-istt_sum_sqr_y (void)
+istt_sum_sqr_y (const IncStat stat)
 {
-  return int_sum_sqr_y;
+  return stat->sum_sqr_y;
 }
 
 
@@ -327,9 +314,9 @@ istt_sum_sqr_y (void)
  * Returns the sum of the squared (x - y) for all observations
  */
 RValue
-istt_sum_sqr_diff_xy (void)
+istt_sum_sqr_diff_xy (const IncStat stat)
 {
-  return int_sum_sqr_diff_xy;
+  return stat->sum_sqr_diff_xy;
 }
 
 
@@ -340,9 +327,9 @@ istt_sum_sqr_diff_xy (void)
  * Returns the sum of the x*y products for all observations
  */
 RValue
-istt_sum_xy (void)
+istt_sum_xy (const IncStat stat)
 {
-  return int_sum_xy;
+  return stat->sum_xy;
 }
 
 
@@ -354,15 +341,18 @@ istt_sum_xy (void)
  * for the current sample
  */
 void
-istt_linear_regression (RValue * lin_coeff, RValue * ang_coeff)
+istt_linear_regression (const IncStat stat,
+                        RValue * lin_coeff, RValue * ang_coeff)
 {
   /* Linear regression linear coefficient */
-  *lin_coeff = ((int_sum_y * int_sum_sqr_x) - (int_sum_x * int_sum_xy)) /
-    ((int_samples * int_sum_sqr_x) - __ISTT_SQR_ (int_sum_x));
+  *lin_coeff =
+    ((stat->sum_y * stat->sum_sqr_x) - (stat->sum_x * stat->sum_xy)) /
+    ((stat->samples * stat->sum_sqr_x) - __ISTT_SQR_ (stat->sum_x));
 
   /* Linear regression angular coefficient */
-  *ang_coeff = ((int_sum_x * int_sum_y) - (int_samples * int_sum_xy)) /
-    (__ISTT_SQR_ (int_sum_x) - (int_samples * int_sum_sqr_x));
+  *ang_coeff =
+    ((stat->sum_x * stat->sum_y) - (stat->samples * stat->sum_xy)) /
+    (__ISTT_SQR_ (stat->sum_x) - (stat->samples * stat->sum_sqr_x));
 }
 
 
@@ -373,11 +363,11 @@ istt_linear_regression (RValue * lin_coeff, RValue * ang_coeff)
  * Returns the linear correlation coefficient between the x and y observations
  */
 RValue
-istt_linear_correlation_coeff (void)
+istt_linear_correlation_coeff (const IncStat stat)
 {
-  return ((int_samples * int_sum_xy) - (int_sum_x * int_sum_y)) /
-    sqrt (((int_samples * int_sum_sqr_x) - __ISTT_SQR_ (int_sum_x)) *
-          ((int_samples * int_sum_sqr_y) - __ISTT_SQR_ (int_sum_y)));
+  return ((stat->samples * stat->sum_xy) - (stat->sum_x * stat->sum_y)) /
+    sqrt (((stat->samples * stat->sum_sqr_x) - __ISTT_SQR_ (stat->sum_x)) *
+          ((stat->samples * stat->sum_sqr_y) - __ISTT_SQR_ (stat->sum_y)));
 }
 
 
@@ -8,12 +8,38 @@
  * STATISTIC PARAMETERS
  */
 
+/*
+ * istt_stat_type
+ *
+ * Incremental statistics of a sequence of (x, y) observations.
+ * Each caller keeps its own accumulator (usually on the stack), so
+ * independent sequences may be accumulated concurrently by several
+ * threads.
+ */
+typedef struct
+{
+  UsLgIntValue samples;         /* number of observations */
+  RValue sum_x, sum_y;          /* sums */
+  RValue avg_x, avg_y;          /* averages */
+  RValue sqr_diff_x, sqr_diff_y;        /* sums of squared differences */
+  RValue max_x, min_x;          /* x maximum and minimum */
+  RValue max_y, min_y;          /* y maximum and minimum */
+  RValue sum_sqr_x, sum_sqr_y;  /* sums of squares */
+  RValue sum_sqr_diff_xy;       /* sum of the squared (x - y) */
+  RValue sum_xy;                /* sum of the x*y products */
+}
+istt_stat_type;
+
+/* Symbolic type */
+typedef istt_stat_type *IncStat;
+
+
 /*
  * istt_clear_stat
  *
- * Initializes all the internal statistics
+ * Initializes all the statistics of the accumulator
  */
-extern void istt_clear_stat (void);
+extern void istt_clear_stat (IncStat stat);
 
 
 /*
@@ -21,7 +47,7 @@ extern void istt_clear_stat (void);
  *
  * Adds a new observation
  */
-extern void istt_add_stat (RValue x, RValue y);
+extern void istt_add_stat (IncStat stat, const RValue x, const RValue y);
 
 
 /*
@@ -29,7 +55,7 @@ extern void istt_add_stat (RValue x, RValue y);
  *
  * Returns the current number of observations
  */
-extern UsLgIntValue istt_samples (void);
+extern UsLgIntValue istt_samples (const IncStat stat);
 
 
 /*
@@ -37,7 +63,7 @@ extern UsLgIntValue istt_samples (void);
  *
  * Returns the average of the x observations
  */
-extern RValue istt_average_x (void);
+extern RValue istt_average_x (const IncStat stat);
 
 
 /*
@@ -45,7 +71,7 @@ extern RValue istt_average_x (void);
  *
  * Returns the average of the y observations
  */
-extern RValue istt_average_y (void);
+extern RValue istt_average_y (const IncStat stat);
 
 
 /*
@@ -53,7 +79,7 @@ extern RValue istt_average_y (void);
  *
  * Returns the variance of the x observations
  */
-extern RValue istt_variance_x (void);
+extern RValue istt_variance_x (const IncStat stat);
 
 
 /*
@@ -61,7 +87,7 @@ extern RValue istt_variance_x (void);
  *
  * Returns the variance of the y observations
  */
-extern RValue istt_variance_y (void);
+extern RValue istt_variance_y (const IncStat stat);
 
 
 /*
@@ -69,7 +95,7 @@ extern RValue istt_variance_y (void);
  *
  * Returns the standard deviation of the x observations
  */
-extern RValue istt_stddev_x (void);
+extern RValue istt_stddev_x (const IncStat stat);
 
 
 /*
@@ -77,7 +103,7 @@ extern RValue istt_stddev_x (void);
  *
  * Returns the standard deviation of the y observations
  */
-extern RValue istt_stddev_y (void);
+extern RValue istt_stddev_y (const IncStat stat);
 
 
 /*
@@ -85,7 +111,7 @@ extern RValue istt_stddev_y (void);
  *
  * Returns the maximum value of the x observations
  */
-extern RValue istt_max_x (void);
+extern RValue istt_max_x (const IncStat stat);
 
 
 /*
@@ -93,7 +119,7 @@ extern RValue istt_max_x (void);
  *
  * Returns the minimum value of the x observations
  */
-extern RValue istt_min_x (void);
+extern RValue istt_min_x (const IncStat stat);
 
 
 /*
@@ -101,7 +127,7 @@ extern RValue istt_min_x (void);
  *
  * Returns the maximum value of the y observations
  */
-extern RValue istt_max_y (void);
+extern RValue istt_max_y (const IncStat stat);
 
 
 /*
@@ -109,7 +135,7 @@ extern RValue istt_max_y (void);
  *
  * Returns the minimum value of the y observations
  */
-extern RValue istt_min_y (void);
+extern RValue istt_min_y (const IncStat stat);
 
 
 /*
@@ -117,7 +143,7 @@ extern RValue istt_min_y (void);
  *
  * Returns the sum of all the x observations
  */
-extern RValue istt_sum_x (void);
+extern RValue istt_sum_x (const IncStat stat);
 
 
 /*
@@ -125,7 +151,7 @@ extern RValue istt_sum_x (void);
  *
  * Returns the sum of all the y observations
  */
-extern RValue istt_sum_y (void);
+extern RValue istt_sum_y (const IncStat stat);
 
 
 /*
@@ -133,7 +159,7 @@ extern RValue istt_sum_y (void);
  *
  * Returns the sum of the squared x observations
  */
-extern RValue istt_sum_sqr_x (void);
+extern RValue istt_sum_sqr_x (const IncStat stat);
 
 
 /*
@@ -141,7 +167,7 @@ extern RValue istt_sum_sqr_x (void);
  *
  * Returns the sum of the squared y observations
  */
-extern RValue istt_sum_sqr_y (void);
+extern RValue istt_sum_sqr_y (const IncStat stat);
 
 
 /*
@@ -149,7 +175,7 @@ extern RValue istt_sum_sqr_y (void);
  *
  * Returns the sum of the squared (x - y) for all observations
  */
-extern RValue istt_sum_sqr_diff_xy (void);
+extern RValue istt_sum_sqr_diff_xy (const IncStat stat);
 
 
 /*
@@ -157,7 +183,7 @@ extern RValue istt_sum_sqr_diff_xy (void);
  *
  * Returns the sum of the x*y products for all observations
  */
-extern RValue istt_sum_xy (void);
+extern RValue istt_sum_xy (const IncStat stat);
 
 
 /*
@@ -166,7 +192,9 @@ extern RValue istt_sum_xy (void);
  * Returns the linear and angular coefficients of the linear regression
  * for the current sample
  */
-extern void istt_linear_regression (RValue * lin_coeff, RValue * ang_coeff);
+extern void
+istt_linear_regression (const IncStat stat,
+                        RValue * lin_coeff, RValue * ang_coeff);
 
 
 /*
@@ -174,7 +202,7 @@ extern void istt_linear_regression (RValue * lin_coeff, RValue * ang_coeff);
  *
  * Returns the linear correlation coefficient between the x and y observations
  */
-extern RValue istt_linear_correlation_coeff (void);
+extern RValue istt_linear_correlation_coeff (const IncStat stat);
 
 
 
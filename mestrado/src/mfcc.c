@@ -144,27 +144,7 @@ main (int argc, char **argv)
     }
 
   /* Initializes parameter structure */
-  param.in_preemphasis = SWIN_YES;
-  param.alpha_preemphasis = 0.95;
-  param.frame_width = 512;
-  param.superposing_samples = 64;
-  param.windowing_function = SWIN_HAMMING;
-  param.triangular_window_low = 0.0;
-  param.triangular_window_center = 0.0;
-  param.triangular_window_high = 0.0;
-  param.triangular_window_central_value = 0.0;
-  param.kaiser_window_B = 0.0;
-  param.purge_zero_power = SWIN_PURGE_ZERO_POWER;
-  param.log_basis = 10.0;
-  param.delta_mel = 100.0;
-  param.total_filters = 16;
-  param.write_index = SMP_DONT_WRITE_INDEX;
-  param.write_lists = SMP_WRITE_LISTS;
-  param.write_time = SMP_WRITE_NORM_TIME;
-  param.write_files = SMP_WRITE_SINGLE_FILE;
-  param.write_break_lines = SMP_BREAK_LINES;
-  param.write_real_part = SMP_YES;
-  param.write_img_part = SMP_NO;
+  scep_default_parameters (&param);
 
 
 
@@ -1,8 +1,11 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "nnet_lvq.h"
 #include "nnet_lvq_window.h"
 #include "../../errorh/errorh.h"
+#include "../../strutils/strutils.h"
+#include "../../vector/vector.h"
 #include "../nnet_train.h"
 #include "../nnet_nnet.h"
 #include "../nnet_layers.h"
@@ -10,6 +13,265 @@
 #include "../nnet_actv.h"
 #include "../nnet_conns.h"
 #include "../nnet_metrics.h"
+#include "../nnet_codebook.h"
+#include "../nnet_sets.h"
+#include "../nnet_tstream.h"
+#include "../nnet_files_bin.h"
+
+/******************************************************************************
+ *                                                                            *
+ *                             PRIVATE OPERATIONS                             *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * nnet_lvq_reset_rates
+ *
+ * Sets the OLVQ1 learning rate of every codebook row to the initial value
+ * of the learning rate function, which also bounds them
+ */
+static int
+nnet_lvq_reset_rates (const LvqAttributes lvq_attr)
+{
+  UnitIndex cur_row;            /* current codebook row */
+
+
+  lvq_attr->max_rate =
+    nnet_train_lrate_value (lvq_attr->lrate_function, 0.0);
+
+  /* Rates must stay below 1 for the increments to converge */
+  if (lvq_attr->lvq_algorithm == OLVQ_1 &&
+      (lvq_attr->max_rate <= 0.0 || lvq_attr->max_rate >= 1.0))
+    return error_failure ("nnet_lvq_reset_rates",
+                          "invalid initial OLVQ1 learning rate: %f\n",
+                          lvq_attr->max_rate);
+
+  for (cur_row = 0; cur_row < lvq_attr->codebook->nu_units; cur_row++)
+    lvq_attr->rates[cur_row] = lvq_attr->max_rate;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_lvq_codebook
+ *
+ * Returns the codebook of the output layer weights, creating it along
+ * with the learning rates of its rows if it doesn't exist yet or if the
+ * output layer has changed
+ */
+static Codebook
+nnet_lvq_codebook (const LvqNNetwork lvq_nnet)
+{
+  LvqAttributes lvq_attr;       /* LVQ attributes */
+  Layer output_layer;           /* LVQ output layer */
+
+
+  lvq_attr = (LvqAttributes) lvq_nnet->attr;
+  output_layer = lvq_nnet->nnet->last_layer;
+
+  if (lvq_attr->codebook != NULL &&
+      (lvq_attr->codebook->layer != output_layer ||
+       lvq_attr->codebook->nu_units != output_layer->nu_units))
+    {
+      nnet_cbook_destroy (&(lvq_attr->codebook));
+      free (lvq_attr->rates);
+      lvq_attr->rates = NULL;
+    }
+
+  if (lvq_attr->codebook != NULL)
+    return lvq_attr->codebook;
+
+  if ((lvq_attr->codebook = nnet_cbook_create (output_layer)) == NULL)
+    return NULL;
+
+  lvq_attr->rates = (RValue *)
+    malloc (lvq_attr->codebook->nu_units * sizeof (RValue));
+
+  if (lvq_attr->rates == NULL)
+    {
+      fprintf (stderr, "nnet_lvq_codebook: virtual memory exhausted\n");
+      nnet_cbook_destroy (&(lvq_attr->codebook));
+      return NULL;
+    }
+
+  if (nnet_lvq_reset_rates (lvq_attr) != EXIT_SUCCESS)
+    {
+      nnet_cbook_destroy (&(lvq_attr->codebook));
+      free (lvq_attr->rates);
+      lvq_attr->rates = NULL;
+      return NULL;
+    }
+
+  return lvq_attr->codebook;
+}
+
+
+
+/*
+ * nnet_lvq_unit_class
+ *
+ * Returns the class of the output unit of the given codebook row. Without
+ * explicit classes, the units are assigned to the element classes in turns.
+ */
+static UsLgIntValue
+nnet_lvq_unit_class (const LvqAttributes lvq_attr, const UnitIndex row,
+                     const UnitIndex nu_classes)
+{
+  if (lvq_attr->classes != NULL)
+    return (UsLgIntValue) lvq_attr->classes->value[row];
+
+  return (UsLgIntValue) (row % nu_classes) + 1;
+}
+
+
+
+/*
+ * nnet_lvq_element_class
+ *
+ * Returns the class of a training element: the position (starting at 1)
+ * of its largest output
+ */
+static UsLgIntValue
+nnet_lvq_element_class (const TElement element)
+{
+  const RValue *output;         /* element output values */
+  UnitIndex cur_comp;           /* current output component */
+  UnitIndex best_comp = 0;      /* largest output component */
+
+
+  output = element->output->value;
+
+  for (cur_comp = 1; cur_comp < element->output->dimension; cur_comp++)
+    if (output[cur_comp] > output[best_comp])
+      best_comp = cur_comp;
+
+  return (UsLgIntValue) best_comp + 1;
+}
+
+
+
+/*
+ * nnet_lvq_class_error
+ *
+ * Error function for nnet_cbook_mean_error: 1 if the winner row doesn't
+ * belong to the element's class, 0 otherwise
+ */
+static RValue
+nnet_lvq_class_error (const Codebook codebook, const UnitIndex row,
+                      const TElement element, void *data)
+{
+  (void) codebook;
+
+  return nnet_lvq_unit_class ((LvqAttributes) data, row,
+                              element->output->dimension) ==
+    nnet_lvq_element_class (element) ? 0.0 : 1.0;
+}
+
+
+
+/*
+ * nnet_lvq_move_row
+ *
+ * Moves a codebook row towards the input values by the given fraction of
+ * their difference, or away from them if the fraction is negative
+ */
+static void
+nnet_lvq_move_row (RValue * weight, const RValue * input,
+                   const UnitIndex dimension, const RValue rate)
+{
+  UnitIndex cur_col;            /* current column */
+
+
+  for (cur_col = 0; cur_col < dimension; cur_col++)
+    weight[cur_col] += rate * (input[cur_col] - weight[cur_col]);
+}
+
+
+
+/*
+ * nnet_lvq_train_pass
+ *
+ * Trains all the elements of the given set with the given learning rate,
+ * following the set's training order, if any, or reading the elements
+ * from the set's stream
+ */
+static int
+nnet_lvq_train_pass (LvqNNetwork lvq_nnet, const TSet training_set,
+                     const RValue etha, const DTime t)
+{
+  TElement element = NULL;      /* current element */
+  ElementIndex position;        /* current training order position */
+
+
+  /* Streamed sets: elements are read chunk by chunk */
+  if (training_set->stream != NULL)
+    {
+      if (error_if_failure (nnet_tstream_rewind (training_set->stream, t),
+                            "nnet_lvq_train_set",
+                            "error rewinding training stream\n"))
+        return EXIT_FAILURE;
+
+      do
+        {
+          if (error_if_failure
+              (nnet_tstream_next (training_set->stream, &element),
+               "nnet_lvq_train_set", "error reading training stream\n"))
+            return EXIT_FAILURE;
+
+          /* Trains the current element */
+          if (element != NULL &&
+              error_if_failure (nnet_lvq_train_element (lvq_nnet, element, etha),
+                                "nnet_lvq_train_set",
+                                "error training element\n") == EXIT_FAILURE)
+            return EXIT_FAILURE;
+        }
+      while (element != NULL);
+
+      return EXIT_SUCCESS;
+    }
+
+  /* Training elements loop, in a new order for each epoch */
+  if (training_set->training_order != NULL)
+    {
+      if (error_if_failure (nnet_tset_shuffle_order (training_set, t),
+                            "nnet_lvq_train_set",
+                            "error shuffling training order\n"))
+        return EXIT_FAILURE;
+
+      for (position = 1; position <= training_set->nu_elements; position++)
+        {
+          element = nnet_tset_order_element (training_set, position);
+
+          /* Trains the current element */
+          if (error_if_failure (nnet_lvq_train_element (lvq_nnet, element, etha),
+                                "nnet_lvq_train_set",
+                                "error training element\n") == EXIT_FAILURE)
+            return EXIT_FAILURE;
+        }
+
+      return EXIT_SUCCESS;
+    }
+
+  /* Training elements loop */
+  element = training_set->first_element;
+  while (element != NULL)
+    {
+      /* Trains the current element */
+      if (error_if_failure (nnet_lvq_train_element (lvq_nnet, element, etha),
+                            "nnet_lvq_train_set",
+                            "error training element\n") == EXIT_FAILURE)
+        return EXIT_FAILURE;
+
+      /* On to the next element */
+      element = element->next;
+    }
+
+  return EXIT_SUCCESS;
+}
+
+
 
 /******************************************************************************
  *                                                                            *
@@ -54,7 +316,7 @@ nnet_lvq_create (const NNetwork nnet,
     {
       fprintf (stderr,
                "nnet_lvq_create: error creating learning rate function\n");
-      free (new_lvq);
+      free (lvq_attr);
       return NULL;
     }
 
@@ -86,6 +348,23 @@ nnet_lvq_create (const NNetwork nnet,
       return NULL;
     }
 
+  /* Single thread by default */
+  lvq_attr->nu_threads = 1;
+
+  /* The codebook is created on the first training pass */
+  lvq_attr->codebook = NULL;
+  lvq_attr->classes = NULL;
+  lvq_attr->rates = NULL;
+  lvq_attr->max_rate = 0.0;
+
+  /* The schedule is created on training */
+  lvq_attr->schedule = NULL;
+  lvq_attr->time = 0;
+
+  /* Default window */
+  lvq_attr->window_width = NNET_LVQ_WINDOW_WIDTH;
+  lvq_attr->epsilon = NNET_LVQ_EPSILON;
+
   /* Creates the LVQ extension */
   new_lvq = (LvqNNetwork) malloc (sizeof (nnet_extension_type));
   if (new_lvq == NULL)
@@ -169,7 +448,7 @@ nnet_lvq_create_nnetwork (LvqNNetwork lvq_nnet,
     }
 
   /* Creates the new generic neural network */
-  new_nnet = nnet_nnetwork_create (nnet_name, lvq_nnet);
+  new_nnet = nnet_nnetwork_create (nnet_name, NULL);
 
   if (new_nnet == NULL)
     {
@@ -253,6 +532,219 @@ nnet_lvq_create_nnetwork (LvqNNetwork lvq_nnet,
 
 
 
+/*
+ * nnet_lvq_create_from_model
+ *
+ * Creates a new LVQ neural network from the given binary model
+ */
+LvqNNetwork
+nnet_lvq_create_from_model (const NNetModel model)
+{
+  NNetwork new_nnet = NULL;     /* new generic neural network */
+  LvqNNetwork new_lvq = NULL;   /* new LVQ extension */
+  const nnet_bin_function_type *lrate;  /* stored learning rate function */
+  Name lrate_name;              /* learning rate class name */
+  RValue lrate_parameters[RFUNC_MAX_PARAMETERS];        /* its parameters */
+  Vector classes = NULL;        /* output unit classes */
+  UsIntValue cur_parm;          /* current parameter */
+
+
+  /* Checks if the model was passed */
+  if (error_if_null (model, "nnet_lvq_create_from_model",
+                     "no model passed\n"))
+    return NULL;
+
+  if (model->header->extension != NNEXT_LVQ)
+    {
+      error_failure ("nnet_lvq_create_from_model", "not an LVQ model\n");
+      return NULL;
+    }
+
+  /* Creates the generic network */
+  if (error_if_null (new_nnet = nnet_bin_create_nnetwork (model),
+                     "nnet_lvq_create_from_model",
+                     "error creating neural network\n"))
+    return NULL;
+
+  /* Creates the LVQ extension */
+  lrate = &(model->header->functions[0]);
+  memcpy (lrate_name, lrate->class_name, NAME_SIZE);
+  lrate_name[NAME_SIZE] = '\0';
+
+  for (cur_parm = 0; cur_parm < RFUNC_MAX_PARAMETERS; cur_parm++)
+    lrate_parameters[cur_parm] = lrate->parameters[cur_parm];
+
+  if (error_if_null
+      (new_lvq = nnet_lvq_create
+       (new_nnet, (LvqAlgorithmType) model->header->lvq_algorithm,
+        nnet_train_lrate_class_by_name (lrate_name),
+        (VectorMetric) model->header->lvq_metric, lrate_parameters),
+       "nnet_lvq_create_from_model", "error creating LVQ extension\n"))
+    {
+      nnet_nnetwork_destroy (&new_nnet, TRUE, TRUE, TRUE, TRUE);
+      return NULL;
+    }
+
+  /* Output unit classes */
+  if (model->header->nu_classes > 0)
+    {
+      if (error_if_null
+          (classes = vector_create (model->header->nu_classes),
+           "nnet_lvq_create_from_model", "error creating classes vector\n"))
+        {
+          nnet_lvq_destroy (&new_lvq, TRUE, TRUE, TRUE, TRUE);
+          return NULL;
+        }
+
+      memcpy (classes->value,
+              (const char *) model->address + model->header->classes_offset,
+              model->header->nu_classes * sizeof (RValue));
+
+      if (error_if_failure (nnet_lvq_set_classes (new_lvq, classes),
+                            "nnet_lvq_create_from_model",
+                            "error setting unit classes\n"))
+        {
+          vector_destroy (&classes);
+          nnet_lvq_destroy (&new_lvq, TRUE, TRUE, TRUE, TRUE);
+          return NULL;
+        }
+
+      vector_destroy (&classes);
+    }
+
+  return new_lvq;
+}
+
+
+
+/*
+ * nnet_lvq_set_threads
+ *
+ * Sets the number of threads used by nnet_lvq_propagate_set
+ */
+int
+nnet_lvq_set_threads (LvqNNetwork lvq_nnet, const UsIntValue nu_threads)
+{
+  /* Checks if the LVQ extension was passed */
+  if (lvq_nnet == NULL)
+    return error_failure ("nnet_lvq_set_threads",
+                          "no LVQ neural network passed\n");
+
+  /* Checks the number of threads */
+  if (nu_threads == 0)
+    return error_failure ("nnet_lvq_set_threads",
+                          "at least one thread is required\n");
+
+  ((LvqAttributes) lvq_nnet->attr)->nu_threads = nu_threads;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_lvq_set_classes
+ *
+ * Sets the class of each output unit: component 'i' of the given vector
+ * holds the class of the i-th output unit. The class of a training
+ * element is the position (starting at 1) of its largest output.
+ */
+int
+nnet_lvq_set_classes (LvqNNetwork lvq_nnet, const Vector classes)
+{
+  LvqAttributes lvq_attr;       /* LVQ attributes */
+  Vector new_classes = NULL;    /* copy of the classes vector */
+  UnitIndex cur_comp;           /* current component */
+
+
+  /* Checks if the LVQ extension was passed */
+  if (lvq_nnet == NULL)
+    return error_failure ("nnet_lvq_set_classes",
+                          "no LVQ neural network passed\n");
+
+  /* Checks if the classes vector was passed */
+  if (classes == NULL)
+    return error_failure ("nnet_lvq_set_classes",
+                          "no classes vector passed\n");
+
+  /* Checks the number of output units */
+  if (lvq_nnet->nnet != NULL &&
+      classes->dimension != lvq_nnet->nnet->last_layer->nu_units)
+    return error_failure
+      ("nnet_lvq_set_classes",
+       "classes vector dimension (%ld) differs from the number of output units (%ld)\n",
+       classes->dimension, lvq_nnet->nnet->last_layer->nu_units);
+
+  /* Classes are counted from 1 */
+  for (cur_comp = 0; cur_comp < classes->dimension; cur_comp++)
+    if (classes->value[cur_comp] < 1.0)
+      return error_failure ("nnet_lvq_set_classes",
+                            "invalid class for output unit %ld\n",
+                            cur_comp + 1);
+
+  if (error_if_null (new_classes = vector_create (classes->dimension),
+                     "nnet_lvq_set_classes",
+                     "error creating classes vector\n"))
+    return EXIT_FAILURE;
+
+  if (error_if_failure (vector_copy (classes, new_classes),
+                        "nnet_lvq_set_classes",
+                        "error copying classes vector\n"))
+    {
+      vector_destroy (&new_classes);
+      return EXIT_FAILURE;
+    }
+
+  lvq_attr = (LvqAttributes) lvq_nnet->attr;
+
+  if (lvq_attr->classes != NULL)
+    vector_destroy (&(lvq_attr->classes));
+
+  lvq_attr->classes = new_classes;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_lvq_set_window
+ *
+ * Sets the relative width of the window LVQ2.1 and LVQ3 updates require
+ * the input to fall in, and the factor applied by LVQ3 to the learning
+ * rate when both winners belong to the input class
+ */
+int
+nnet_lvq_set_window (LvqNNetwork lvq_nnet,
+                     const RValue window_width, const RValue epsilon)
+{
+  LvqAttributes lvq_attr;       /* LVQ attributes */
+
+
+  /* Checks if the LVQ extension was passed */
+  if (lvq_nnet == NULL)
+    return error_failure ("nnet_lvq_set_window",
+                          "no LVQ neural network passed\n");
+
+  /* Checks the window width interval */
+  if (window_width <= 0.0 || window_width >= 1.0)
+    return error_failure ("nnet_lvq_set_window",
+                          "invalid window width: %f\n", window_width);
+
+  /* Checks the LVQ3 rate factor */
+  if (epsilon <= 0.0 || epsilon > 1.0)
+    return error_failure ("nnet_lvq_set_window",
+                          "invalid LVQ3 rate factor: %f\n", epsilon);
+
+  lvq_attr = (LvqAttributes) lvq_nnet->attr;
+  lvq_attr->window_width = window_width;
+  lvq_attr->epsilon = epsilon;
+
+  return EXIT_SUCCESS;
+}
+
+
+
 /*
  * nnet_lvq_destroy
  *
@@ -299,6 +791,19 @@ nnet_lvq_destroy (LvqNNetwork * lvq_nnet,
   if (lvq_attr->lrate_function != NULL)
     function_destroy (&(lvq_attr->lrate_function));
 
+  /* Destroys the codebook and the unit classes */
+  if (lvq_attr->codebook != NULL)
+    nnet_cbook_destroy (&(lvq_attr->codebook));
+
+  if (lvq_attr->classes != NULL)
+    vector_destroy (&(lvq_attr->classes));
+
+  if (lvq_attr->schedule != NULL)
+    nnet_train_schedule_destroy (&(lvq_attr->schedule));
+
+  free (lvq_attr->rates);
+  free (lvq_attr);
+
   /* Destroys the LVQ network itself */
   free (*lvq_nnet);
 
@@ -392,21 +897,22 @@ nnet_lvq_propagate_element (const LvqNNetwork lvq_nnet,
 /*
  * nnet_lvq_propagate_set
  *
- * Loads and propagates all elements in the given set, returning a list
- * of winner indexes
+ * Propagates all elements in the given set, returning a list of winner
+ * indexes. The winners are searched on a snapshot of the output layer
+ * weights, split among the threads set in the attributes, so the
+ * activations and outputs of the network units are left untouched.
  */
 Vector
 nnet_lvq_propagate_set (const LvqNNetwork lvq_nnet, const TSet set)
 {
-  TElement cur_element = NULL;  /* current training element */
-  ElementIndex cur_index = 1;   /* current element counter */
-  Unit winner1 = NULL;          /* current winner unit */
-  Unit winner2 = NULL;          /* current 2nd place unit */
+  LvqAttributes lvq_attr = NULL;        /* LVQ attributes */
+  Codebook codebook = NULL;     /* output layer codebook */
   Vector winners = NULL;        /* list of winners indexes */
+  int exit_status;              /* auxiliary function return status */
 
 
   /* checks if the LVQ was actually passed */
-  if (lvq_nnet == NULL)
+  if (lvq_nnet == NULL || lvq_nnet->nnet == NULL)
     {
       error_failure ("nnet_lvq_propagate_set",
                      "no LVQ neural network passed\n");
@@ -420,37 +926,35 @@ nnet_lvq_propagate_set (const LvqNNetwork lvq_nnet, const TSet set)
       return NULL;
     }
 
+  lvq_attr = (LvqAttributes) lvq_nnet->attr;
+
   /* creates the unit index list */
   if (error_if_null
       (winners = vector_create (set->nu_elements), "nnet_lvq_propagate_set",
        "error creating list of winner indexes\n"))
     return NULL;
 
-  /* propagates all elements in the set */
-  cur_element = set->first_element;
-
-  while (cur_element != NULL)
+  /* takes a snapshot of the output layer weights */
+  if (error_if_null
+      (codebook = nnet_cbook_create (lvq_nnet->nnet->last_layer),
+       "nnet_lvq_propagate_set", "error creating output layer codebook\n"))
     {
-      /* propagates current element */
-      if (error_if_failure
-          (nnet_lvq_propagate_element
-           (lvq_nnet, cur_element, &winner1, &winner2),
-           "nnet_lvq_propagate_set", "error propagating element %ld\n",
-           cur_element->element_index))
-        return NULL;
+      vector_destroy (&winners);
+      return NULL;
+    }
 
-      /* sets the winner index in the unit index list */
-      if (error_if_failure
-          (vector_set_value
-           (winners, cur_index, (RValue) winner1->unit_index),
-           "nnet_lvq_propagate_set",
-           "error setting winner index for element %ld\n",
-           cur_element->element_index))
-        return NULL;
+  /* determines the winners of all elements in the set */
+  exit_status = nnet_cbook_winners
+    (codebook, set, lvq_attr->activation_metric, lvq_attr->nu_threads,
+     winners);
 
-      /* goes to the next element */
-      ++cur_index;
-      cur_element = cur_element->next;
+  nnet_cbook_destroy (&codebook);
+
+  if (error_if_failure (exit_status, "nnet_lvq_propagate_set",
+                        "error propagating set elements\n"))
+    {
+      vector_destroy (&winners);
+      return NULL;
     }
 
   return winners;
@@ -458,25 +962,94 @@ nnet_lvq_propagate_set (const LvqNNetwork lvq_nnet, const TSet set)
 
 
 
+/*
+ * nnet_lvq_classification_error
+ *
+ * Returns the fraction of the elements in the given set whose winner
+ * unit doesn't belong to the element's class, searching the winners on a
+ * snapshot of the output layer weights with the threads set in the
+ * attributes
+ */
+int
+nnet_lvq_classification_error (const LvqNNetwork lvq_nnet, const TSet set,
+                               RValue * error)
+{
+  LvqAttributes lvq_attr = NULL;        /* LVQ attributes */
+  Codebook codebook = NULL;     /* output layer codebook */
+  TElement cur_element = NULL;  /* current element */
+  int exit_status;              /* auxiliary function return status */
+
+
+  /* checks if the LVQ was actually passed */
+  if (lvq_nnet == NULL || lvq_nnet->nnet == NULL)
+    return error_failure ("nnet_lvq_classification_error",
+                          "no LVQ neural network passed\n");
+
+  /* checks if the set was actually passed */
+  if (set == NULL)
+    return error_failure ("nnet_lvq_classification_error",
+                          "no set passed\n");
+
+  lvq_attr = (LvqAttributes) lvq_nnet->attr;
+
+  /* every element must have a class */
+  for (cur_element = set->first_element; cur_element != NULL;
+       cur_element = cur_element->next)
+    if (cur_element->output == NULL || cur_element->output->dimension == 0)
+      return error_failure ("nnet_lvq_classification_error",
+                            "element %lu has no outputs\n",
+                            cur_element->element_index);
+
+  /* takes a snapshot of the output layer weights */
+  if (error_if_null
+      (codebook = nnet_cbook_create (lvq_nnet->nnet->last_layer),
+       "nnet_lvq_classification_error",
+       "error creating output layer codebook\n"))
+    return EXIT_FAILURE;
+
+  if (lvq_attr->classes != NULL &&
+      lvq_attr->classes->dimension != codebook->nu_units)
+    {
+      nnet_cbook_destroy (&codebook);
+      return error_failure ("nnet_lvq_classification_error",
+                            "classes vector doesn't match the output units\n");
+    }
+
+  exit_status = nnet_cbook_mean_error
+    (codebook, set, lvq_attr->activation_metric, lvq_attr->nu_threads,
+     nnet_lvq_class_error, lvq_attr, error);
+
+  nnet_cbook_destroy (&codebook);
+
+  return error_if_failure (exit_status, "nnet_lvq_classification_error",
+                           "error classifying set elements\n");
+}
+
+
+
 /*
  * nnet_lvq_train_element
  *
- * Executes training for one element
+ * Executes training for one element. The winner and the 2nd place are
+ * searched in a single scan of the LVQ codebook, whose rows are adapted
+ * in place; the weights of the output units are updated from the
+ * codebook at the end of each nnet_lvq_train_set pass.
  */
 int
 nnet_lvq_train_element (LvqNNetwork lvq_nnet,
                         const TElement element, const RValue learning_rate)
 {
-  Layer input_layer = NULL;     /* LVQ input layer */
-  Layer output_layer = NULL;    /* LVQ output layer */
-  Unit winner1 = NULL;          /* winning unit */
-  Unit winner2 = NULL;          /* 2nd place unit */
-  Unit cur_unit = NULL;         /* current output unit */
-  UsLgIntValue cur_comp;        /* current neighborhood vector component */
-  Vector weight_vector = NULL;  /* auxiliary weight vector */
-  Vector error_vector = NULL;   /* current unit error vector */
-  RValue rate;                  /* fraction of the error vector */
-  int exit_status;              /* auxiliary function return status */
+  LvqAttributes lvq_attr = NULL;        /* LVQ attributes */
+  Codebook codebook = NULL;     /* output layer codebook */
+  const RValue *input;          /* element input values */
+  UnitIndex dimension;          /* codebook columns */
+  UnitIndex nu_classes;         /* number of element classes */
+  UnitIndex winner1, winner2;   /* winner and 2nd place rows */
+  RValue d1, d2;                /* winner and 2nd place activations */
+  UsLgIntValue x_class;         /* element class */
+  UsLgIntValue class1, class2;  /* winner and 2nd place classes */
+  BoolValue inside;             /* flag: input inside the window */
+  RValue rate;                  /* winner's signed OLVQ1 learning rate */
 
 
   /*************************************************************************
@@ -498,170 +1071,132 @@ nnet_lvq_train_element (LvqNNetwork lvq_nnet,
     return error_failure ("nnet_lvq_train_element",
                           "a LVQ must have two layers\n");
 
+  /* Checks if the element was actually passed */
+  if (element == NULL)
+    return error_failure ("nnet_lvq_train_element",
+                          "no training element passed\n");
+
+  /* Checks if the element has a class */
+  if (element->output == NULL || element->output->dimension == 0)
+    return error_failure ("nnet_lvq_train_element",
+                          "training element has no outputs\n");
+
 
   /*************************************************************************
    *                             INITIALIZATION                            *
    *************************************************************************/
 
-  /* Sets the auxiliary layer pointers */
-  input_layer = lvq_nnet->nnet->first_layer;
-  output_layer = lvq_nnet->nnet->last_layer;
+  lvq_attr = (LvqAttributes) lvq_nnet->attr;
 
-  /* Creates the auxiliary weight vector */
-  weight_vector = vector_create (input_layer->nu_units);
+  /* Gets the output layer codebook */
+  if (error_if_null (codebook = nnet_lvq_codebook (lvq_nnet),
+                     "nnet_lvq_train_element",
+                     "error creating output layer codebook\n"))
+    return EXIT_FAILURE;
 
-  if (weight_vector == NULL)
-    return error_failure ("nnet_lvq_train_element",
-                          "error creating auxiliary weight vector\n");
+  /* Checks dimensional compatibility */
+  dimension = codebook->dimension;
+  if (element->input->dimension != dimension)
+    return error_failure
+      ("nnet_lvq_train_element",
+       "incompatible dimensions between input vector (%ld) and output unit inputs (%ld)\n",
+       element->input->dimension, dimension);
 
-  /* Creates the auxiliary error vector */
-  error_vector = vector_create (input_layer->nu_units);
-  if (error_vector == NULL)
+  if (lvq_attr->classes != NULL &&
+      lvq_attr->classes->dimension != codebook->nu_units)
     return error_failure ("nnet_lvq_train_element",
-                          "error creating auxiliary error vector\n");
+                          "classes vector doesn't match the output units\n");
+
+  input = element->input->value;
+  nu_classes = element->output->dimension;
+  x_class = nnet_lvq_element_class (element);
 
 
   /*************************************************************************
    *                               COMPETITION                             *
    *************************************************************************/
 
-  /* Loads the training element, activates the network and find the winner */
-  exit_status =
-    nnet_lvq_propagate_element (lvq_nnet, element, &winner1, &winner2);
+  /* Finds the winner and the 2nd place in one pass over the codebook */
+  if (error_if_failure
+      (nnet_cbook_scan_2 (codebook, input, lvq_attr->activation_metric,
+                          &winner1, &d1, &winner2, &d2),
+       "nnet_lvq_train_element", "error performing competition\n"))
+    return EXIT_FAILURE;
 
-  if (exit_status != EXIT_SUCCESS)
-    return error_failure ("nnet_lvq_train_element",
-                          "error performing competition\n");
+  class1 = nnet_lvq_unit_class (lvq_attr, winner1, nu_classes);
 
 
   /*************************************************************************
    *                                ADAPTION                               *
    *************************************************************************/
 
-  /*
-   * 1. atualizar os pesos das vencedoras
-   * 2. switch do algoritmo LVQ
-   * 2.1 atualizar os pesos da 2.a colocada
-   * 2.2 atualizar a funcao de aprendizado da vencedora
-   */
-
-  /* Updates the weights of the output units */
-  cur_unit = output_layer->first_unit;
-  cur_comp = 1;
-
-  while (cur_unit != NULL)
+  /* LVQ2.1 and LVQ3: the two winners are adapted together */
+  if ((lvq_attr->lvq_algorithm == LVQ_2_1 ||
+       lvq_attr->lvq_algorithm == LVQ_3) && winner2 < codebook->nu_units)
     {
-      /* Gets the weight vector for the current output unit */
-      exit_status = nnet_unit_get_weight_vector (cur_unit, weight_vector);
-
-      if (exit_status != EXIT_SUCCESS)
-        {
-          fprintf (stderr,
-                   "nnet_lvq_train_element: error getting current unit weight vector\n");
-          return EXIT_FAILURE;
-        }
-
-      /* Calculates the error vector */
-      exit_status =
-        vector_subtract (element->input, weight_vector, error_vector);
-
-      if (exit_status != EXIT_SUCCESS)
-        {
-          fprintf (stderr,
-                   "nnet_lvq_train_element: error calculating error vector\n");
-          return EXIT_FAILURE;
-        }
-
-      /* Gets the neighborhood value */
-      exit_status = vector_get_value (ngb_vector, cur_comp, &ngb_value);
+      class2 = nnet_lvq_unit_class (lvq_attr, winner2, nu_classes);
 
-      if (exit_status != EXIT_SUCCESS)
-        {
-          fprintf (stderr,
-                   "nnet_lvq_train_element: error getting neighborhood value from vector at component %ld\n",
-                   cur_comp);
-          return EXIT_FAILURE;
-        }
-
-      /* Calculates the correction rate */
-      rate = ngb_value * learning_rate;
-
-      /* Selects the units to update */
-      if (rate > DBL_EPSILON)
+      /* Only one of them is of the input class */
+      if ((class1 == x_class) != (class2 == x_class))
         {
-          /* Multiplies the error vector by the correction rate */
-          exit_status =
-            vector_scalar_multiply (error_vector, rate, error_vector);
-
-          if (exit_status != EXIT_SUCCESS)
-            {
-              fprintf (stderr,
-                       "nnet_lvq_train_element: error calculating weight correction vector\n");
-              return EXIT_FAILURE;
-            }
-
-          /* Calculates the new weights */
-          exit_status =
-            vector_sum (weight_vector, error_vector, weight_vector);
-
-          if (exit_status != EXIT_SUCCESS)
+          /* The window is defined by euclidean distances */
+          if (lvq_attr->activation_metric == VECTOR_METR_EUCLIDEAN)
+            inside = nnet_lvq_winfunction (d1, d2, lvq_attr->window_width);
+          else if (error_if_failure
+                   (nnet_lvq_window (codebook, input, winner1, winner2,
+                                     lvq_attr->window_width, &inside),
+                    "nnet_lvq_train_element",
+                    "error evaluating the window\n"))
+            return EXIT_FAILURE;
+
+          if (inside == TRUE)
             {
-              fprintf (stderr,
-                       "nnet_lvq_train_element: error calculating new weight vector\n");
-              return EXIT_FAILURE;
+              nnet_lvq_move_row (nnet_cbook_row (codebook, winner1), input,
+                                 dimension, class1 == x_class ?
+                                 learning_rate : -learning_rate);
+              nnet_lvq_move_row (nnet_cbook_row (codebook, winner2), input,
+                                 dimension, class2 == x_class ?
+                                 learning_rate : -learning_rate);
             }
 
-          /* Updates the weights */
-          exit_status = nnet_unit_set_weight_vector (cur_unit, weight_vector);
+          return EXIT_SUCCESS;
+        }
 
-          if (exit_status != EXIT_SUCCESS)
-            {
-              fprintf (stderr,
-                       "nnet_lvq_train_element: error updating current unit's weights\n");
-              return EXIT_FAILURE;
-            }
+      /* LVQ3: both of them are of the input class */
+      if (lvq_attr->lvq_algorithm == LVQ_3 && class1 == x_class)
+        {
+          nnet_lvq_move_row (nnet_cbook_row (codebook, winner1), input,
+                             dimension, lvq_attr->epsilon * learning_rate);
+          nnet_lvq_move_row (nnet_cbook_row (codebook, winner2), input,
+                             dimension, lvq_attr->epsilon * learning_rate);
         }
 
-      /* Goes to the next output unit */
-      cur_unit = cur_unit->next;
-      ++cur_comp;
+      return EXIT_SUCCESS;
     }
 
-
-  /*************************************************************************
-   *                              FINALIZATION                             *
-   *************************************************************************/
-
-  /* Destroys the neighborhood vector */
-  exit_status = vector_destroy (&ngb_vector);
-
-  if (exit_status != EXIT_SUCCESS)
+  /* OLVQ1: LVQ1 with a rate for each row, which decreases while the row
+     wins inputs of its class and increases when it wins the others */
+  if (lvq_attr->lvq_algorithm == OLVQ_1)
     {
-      fprintf (stderr,
-               "nnet_lvq_train_element: error destroying neighborhood vector\n");
-      return EXIT_FAILURE;
-    }
+      rate = lvq_attr->rates[winner1];
+      if (class1 != x_class)
+        rate = -rate;
 
-  /* Destroys the auxiliary weight vector */
-  exit_status = vector_destroy (&weight_vector);
+      nnet_lvq_move_row (nnet_cbook_row (codebook, winner1), input,
+                         dimension, rate);
 
-  if (exit_status != EXIT_SUCCESS)
-    {
-      fprintf (stderr,
-               "nnet_lvq_train_element: error destroying auxiliary weight vector\n");
-      return EXIT_FAILURE;
-    }
-
-  /* Destroys the error vector */
-  exit_status = vector_destroy (&error_vector);
+      rate = lvq_attr->rates[winner1] / (1.0 + rate);
+      lvq_attr->rates[winner1] =
+        (rate < lvq_attr->max_rate ? rate : lvq_attr->max_rate);
 
-  if (exit_status != EXIT_SUCCESS)
-    {
-      fprintf (stderr,
-               "nnet_lvq_train_element: error destroying error vector\n");
-      return EXIT_FAILURE;
+      return EXIT_SUCCESS;
     }
 
+  /* LVQ1: the winner approaches inputs of its class and moves away from
+     the others */
+  nnet_lvq_move_row (nnet_cbook_row (codebook, winner1), input, dimension,
+                     class1 == x_class ? learning_rate : -learning_rate);
+
   return EXIT_SUCCESS;
 }
 
@@ -671,27 +1206,27 @@ nnet_lvq_train_element (LvqNNetwork lvq_nnet,
  * nnet_lvq_train_set
  *
  * Executes one training pass through all the elements in the given
- * training set
+ * training set, following the set's training order, if any, or reading
+ * the elements from the set's stream
  */
 int
 nnet_lvq_train_set (LvqNNetwork lvq_nnet,
                     const TSet training_set,
+                    const DTime first_epoch,
                     const DTime max_epochs,
                     const BoolValue reset_time,
                     const BoolValue output_progress,
                     const size_t progress_width,
                     const char progress_character)
 {
-  static DTime t = 0;           /* current training time */
-  TElement element = NULL;      /* current element */
   LvqAttributes lvqatt = NULL;  /* LVQ attributes */
-  LRateFunction lfunc = NULL;   /* learning rate function */
-  NgbFunction nfunc = NULL;     /* neighborhood function */
-  RValue etha = 0.0;            /* current learning rate */
+  Codebook codebook = NULL;     /* output layer codebook */
+  const RValue *etha = NULL;    /* current learning rate */
+  DTime t;                      /* current training time */
 
 
   /* Checks if the network was actually passed */
-  if (lvq_nnet == NULL)
+  if (lvq_nnet == NULL || lvq_nnet->nnet == NULL)
     return error_failure ("nnet_lvq_train_set",
                           "no LVQ neural network passed\n");
 
@@ -699,22 +1234,38 @@ nnet_lvq_train_set (LvqNNetwork lvq_nnet,
   if (training_set == NULL)
     return error_failure ("nnet_lvq_train_set", "no training set passed\n");
 
+  /* Initialization */
+  lvqatt = (LvqAttributes) lvq_nnet->attr;
+
   /* Checks if internal time should be reset */
   if (reset_time == TRUE)
-    t = first_epoch;
+    lvqatt->time = first_epoch;
+
+  t = lvqatt->time;
 
   /* Checks if the maximum epochs has been reached */
   if (t >= max_epochs)
     return error_failure ("nnet_lvq_train_set",
                           "maximum epochs (%ld) reached\n", max_epochs);
 
-  /* Initialization */
-  lvqatt = (LvqAttributes) lvq_nnet->attr;
-  lfunc = lvqatt->lrate_function;
-  nfunc = lvqatt->ngb_function;
+  /* Schedules the learning rate of the whole horizon, once */
+  if (lvqatt->schedule != NULL &&
+      (reset_time == TRUE || lvqatt->schedule->first_epoch != first_epoch ||
+       lvqatt->schedule->max_epochs != max_epochs ||
+       lvqatt->schedule->lrate_function != lvqatt->lrate_function))
+    nnet_train_schedule_destroy (&(lvqatt->schedule));
+
+  if (lvqatt->schedule == NULL &&
+      error_if_null (lvqatt->schedule = nnet_train_schedule_create
+                     (lvqatt->lrate_function, NULL, NULL, first_epoch,
+                      max_epochs, 1), "nnet_lvq_train_set",
+                     "error creating training schedule\n"))
+    return EXIT_FAILURE;
 
-  /* Calculates the current learning rate */
-  etha = nnet_train_lrate_value (lfunc, (RValue) t);
+  if (error_if_failure
+      (nnet_train_schedule_epoch (lvqatt->schedule, t, &etha, NULL),
+       "nnet_lvq_train_set", "error reading training schedule\n"))
+    return EXIT_FAILURE;
 
   /* Updates progress bar */
   if (output_progress == TRUE)
@@ -727,22 +1278,33 @@ nnet_lvq_train_set (LvqNNetwork lvq_nnet,
         return EXIT_FAILURE;
     }
 
-  /* Training elements loop */
-  element = training_set->first_element;
-  while (element != NULL)
-    {
-      /* Trains the current element */
-      if (error_if_failure (nnet_lvq_train_element (lvq_nnet, element, etha),
-                            "nnet_lvq_train_set",
-                            "error training element\n") == EXIT_FAILURE)
-        return EXIT_FAILURE;
+  /* The pass adapts a codebook of the current output layer weights */
+  if (error_if_null (codebook = nnet_lvq_codebook (lvq_nnet),
+                     "nnet_lvq_train_set",
+                     "error creating output layer codebook\n"))
+    return EXIT_FAILURE;
 
-      /* On to the next element */
-      element = element->next;
-    }
+  if (error_if_failure (nnet_cbook_load (codebook), "nnet_lvq_train_set",
+                        "error loading output layer weights\n"))
+    return EXIT_FAILURE;
+
+  /* Restarts the OLVQ1 learning rates along with the time */
+  if (reset_time == TRUE &&
+      error_if_failure (nnet_lvq_reset_rates (lvqatt), "nnet_lvq_train_set",
+                        "error resetting the learning rates\n"))
+    return EXIT_FAILURE;
+
+  if (nnet_lvq_train_pass (lvq_nnet, training_set, etha[0], t) !=
+      EXIT_SUCCESS)
+    return EXIT_FAILURE;
+
+  /* Copies the adapted codebook back into the output units */
+  if (error_if_failure (nnet_cbook_store (codebook), "nnet_lvq_train_set",
+                        "error storing output layer weights\n"))
+    return EXIT_FAILURE;
 
   /* Increment time and epoch counters */
-  t++;
+  lvqatt->time++;
 
   return EXIT_SUCCESS;
 }
@@ -761,19 +1323,12 @@ nnet_lvq_info (const LvqNNetwork lvq_nnet,
                const BoolValue include_in_connections,
                const BoolValue include_out_connections, FILE * output_fd)
 {
-  LvqAttributes lvq_attr;       /* LVQ attributes */
-
-
   if (output_fd == NULL)
     return;
 
   if (lvq_nnet == NULL)
     return;
 
-
-  /* Initialization */
-  lvq_attr = (LvqAttributes) lvq_nnet->attr;
-
   /* LVQ specific information */
   /*
      if (include_ngb_function_info == TRUE)
@@ -2,6 +2,8 @@
 #define __NNET_LVQ_H_ 1
 
 #include "../nnet_types.h"
+#include "../nnet_codebook.h"
+#include "../nnet_files_bin.h"
 #include "nnet_lvq_window.h"
 
 /******************************************************************************
@@ -26,6 +28,14 @@ LvqAlgorithmType;
 
 
 
+/* Default relative width of the LVQ2.1 and LVQ3 window */
+#define NNET_LVQ_WINDOW_WIDTH 0.3
+
+/* Default LVQ3 learning rate factor for winners of the input class */
+#define NNET_LVQ_EPSILON 0.1
+
+
+
 /*
  * nnet_lvq_type
  *
@@ -33,12 +43,27 @@ LvqAlgorithmType;
  * - learning rate function
  * - LVQ training algorithm
  * - unit activation vector metric
+ * - number of threads used by the parallel operations
+ * - codebook of the output layer weights adapted by the training
+ * - class of each output unit (NULL: assigned in turns on training)
+ * - LVQ2.1 and LVQ3 window width and LVQ3 rate factor
+ * - OLVQ1 learning rate of each codebook row, bounded by the initial one
+ * - learning rate schedule of the training and current training time
  */
 typedef struct
 {
   LRateFunction lrate_function;
   LvqAlgorithmType lvq_algorithm;
   VectorMetric activation_metric;
+  UsIntValue nu_threads;
+  Codebook codebook;
+  Vector classes;
+  RValue window_width;
+  RValue epsilon;
+  RValue *rates;
+  RValue max_rate;
+  TSchedule schedule;
+  DTime time;
 }
 nnet_lvq_attr_type;
 
@@ -96,6 +121,52 @@ nnet_lvq_create_nnetwork (LvqNNetwork lvq_nnet,
 
 
 
+/*
+ * nnet_lvq_create_from_model
+ *
+ * Creates a new LVQ neural network from the given binary model, with the
+ * learning rate function, algorithm, metric and unit classes it was
+ * written with
+ */
+extern LvqNNetwork nnet_lvq_create_from_model (const NNetModel model);
+
+
+
+/*
+ * nnet_lvq_set_threads
+ *
+ * Sets the number of threads used by nnet_lvq_propagate_set
+ */
+extern int
+nnet_lvq_set_threads (LvqNNetwork lvq_nnet, const UsIntValue nu_threads);
+
+
+
+/*
+ * nnet_lvq_set_classes
+ *
+ * Sets the class of each output unit: component 'i' of the given vector
+ * holds the class of the i-th output unit. The class of a training
+ * element is the position (starting at 1) of its largest output.
+ */
+extern int
+nnet_lvq_set_classes (LvqNNetwork lvq_nnet, const Vector classes);
+
+
+
+/*
+ * nnet_lvq_set_window
+ *
+ * Sets the relative width of the window LVQ2.1 and LVQ3 updates require
+ * the input to fall in, and the factor applied by LVQ3 to the learning
+ * rate when both winners belong to the input class
+ */
+extern int
+nnet_lvq_set_window (LvqNNetwork lvq_nnet,
+                     const RValue window_width, const RValue epsilon);
+
+
+
 /*
  * nnet_lvq_destroy
  *
@@ -125,18 +196,39 @@ nnet_lvq_propagate_element (const LvqNNetwork lvq_nnet,
 /*
  * nnet_lvq_propagate_set
  *
- * Loads and propagates all elements in the given set, returning a list
- * of winner indexes
+ * Propagates all elements in the given set, returning a list of winner
+ * indexes. The winners are searched on a snapshot of the output layer
+ * weights, split among the threads set in the attributes, so the
+ * activations and outputs of the network units are left untouched.
  */
 extern Vector
 nnet_lvq_propagate_set (const LvqNNetwork lvq_nnet, const TSet set);
 
 
 
+/*
+ * nnet_lvq_classification_error
+ *
+ * Returns the fraction of the elements in the given set whose winner
+ * unit doesn't belong to the element's class, searching the winners on a
+ * snapshot of the output layer weights with the threads set in the
+ * attributes
+ */
+extern int
+nnet_lvq_classification_error (const LvqNNetwork lvq_nnet, const TSet set,
+                               RValue * error);
+
+
+
 /*
  * nnet_lvq_train_element
  *
- * Executes training for one element
+ * Executes training for one element. The winner and the 2nd place are
+ * searched in a single scan of the LVQ codebook, whose rows are adapted
+ * in place; the weights of the output units are updated from the
+ * codebook at the end of each nnet_lvq_train_set pass.
+ * OLVQ1 ignores the given learning rate and adapts each row with its own
+ * rate, starting at the initial value of the learning rate function.
  */
 extern int
 nnet_lvq_train_element (LvqNNetwork lvq_nnet,
@@ -148,11 +240,14 @@ nnet_lvq_train_element (LvqNNetwork lvq_nnet,
  * nnet_lvq_train_set
  *
  * Executes one training pass through all the elements in the given
- * training set
+ * training set, following the set's training order, if any, or reading
+ * the elements from the set's stream. Resetting the time also restarts
+ * the OLVQ1 learning rates.
  */
 extern int
 nnet_lvq_train_set (LvqNNetwork lvq_nnet,
                     const TSet training_set,
+                    const DTime first_epoch,
                     const DTime max_epochs,
                     const BoolValue reset_time,
                     const BoolValue output_progress,
@@ -3,6 +3,7 @@
 
 #include "../../common/types.h"
 #include "../nnet_types.h"
+#include "../nnet_codebook.h"
 
 /******************************************************************************
  *                                                                            *
@@ -10,21 +11,26 @@
  *                                                                            *
  ******************************************************************************/
 
+/*
+ * nnet_lvq_winfunction
+ *
+ * Evaluates if an input at the euclidean distances d1 and d2 from the two
+ * winners is inside the window of width w defined between them
+ */
 extern BoolValue
-nnet_lvq_winfunction (const Vector x, const Vector w1, const Vector w2,
-                      const RValue w);
+nnet_lvq_winfunction (const RValue d1, const RValue d2, const RValue w);
 
 
 
 /*
  * nnet_lvq_window
  *
- * Evaluates if the input vector is inside the window defined
- * between the two winners, according to the window width
+ * Evaluates if the input values are inside the window defined between
+ * two codebook rows, according to the window width
  */
 extern int
-nnet_lvq_window (const Vector input_vector,
-                 const Unit winner1, const Unit winner2,
+nnet_lvq_window (const Codebook codebook, const RValue * input,
+                 const UnitIndex row1, const UnitIndex row2,
                  const RValue window_width, BoolValue * result);
 
 
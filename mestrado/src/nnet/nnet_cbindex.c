@@ -0,0 +1,1044 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "nnet_types.h"
+#include "nnet_actv.h"
+#include "nnet_codebook.h"
+#include "nnet_cbindex.h"
+
+/******************************************************************************
+ *                                                                            *
+ *                             PRIVATE OPERATIONS                             *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * nnet_cbidx_pair_compare
+ *
+ * Orders pairs by distance, then by row
+ */
+static int
+nnet_cbidx_pair_compare (const void *p1, const void *p2)
+{
+  const nnet_cbidx_pair_type *a = (const nnet_cbidx_pair_type *) p1;
+  const nnet_cbidx_pair_type *b = (const nnet_cbidx_pair_type *) p2;
+
+  if (a->distance < b->distance)
+    return -1;
+  if (a->distance > b->distance)
+    return 1;
+  if (a->row < b->row)
+    return -1;
+  if (a->row > b->row)
+    return 1;
+  return 0;
+}
+
+
+
+/*
+ * nnet_cbidx_distance
+ *
+ * Euclidean distance between the given values and one codebook row
+ */
+static RValue
+nnet_cbidx_distance (const Codebook codebook, const UnitIndex row,
+                     const RValue * values)
+{
+  const RValue *weight;         /* row weights */
+  RValue sum = 0.0;             /* sum of square differences */
+  RValue diff;                  /* component difference */
+  UnitIndex cur_col;            /* current column */
+
+
+  weight = nnet_cbook_row (codebook, row);
+
+  for (cur_col = 0; cur_col < codebook->dimension; cur_col++)
+    {
+      diff = values[cur_col] - weight[cur_col];
+      sum += diff * diff;
+    }
+
+  return sqrt (sum);
+}
+
+
+
+/*
+ * nnet_cbidx_lower_bound
+ *
+ * Lower bound of the distance between the query and any row whose
+ * distance to the vantage point lies in [lo, hi], given the distance
+ * between the query and the vantage point
+ */
+static RValue
+nnet_cbidx_lower_bound (const RValue d, const RValue lo, const RValue hi)
+{
+  if (d < lo)
+    return lo - d;
+
+  if (d > hi)
+    return d - hi;
+
+  return 0.0;
+}
+
+
+
+/*
+ * nnet_cbidx_vp_bounds
+ *
+ * Computes the distance bounds of the halves of the node starting at the
+ * given position, recursing into its children
+ */
+static void
+nnet_cbidx_vp_bounds (CodebookIndex index, const Codebook codebook,
+                      const UnitIndex start)
+{
+  const RValue *vantage;        /* vantage point weights */
+  UnitIndex pos;                /* current position */
+  RValue d;                     /* current distance */
+
+
+  vantage = nnet_cbook_row (codebook, index->rows[start]);
+
+  index->in_lo[start] = index->out_lo[start] = HUGE_VAL;
+  index->in_hi[start] = index->out_hi[start] = 0.0;
+
+  for (pos = start + 1; pos < index->node_end[start]; pos++)
+    {
+      d = nnet_cbidx_distance (codebook, index->rows[pos], vantage);
+
+      if (pos < index->node_mid[start])
+        {
+          if (d < index->in_lo[start])
+            index->in_lo[start] = d;
+          if (d > index->in_hi[start])
+            index->in_hi[start] = d;
+        }
+      else
+        {
+          if (d < index->out_lo[start])
+            index->out_lo[start] = d;
+          if (d > index->out_hi[start])
+            index->out_hi[start] = d;
+        }
+    }
+
+  if (start + 1 < index->node_mid[start])
+    nnet_cbidx_vp_bounds (index, codebook, start + 1);
+
+  if (index->node_mid[start] < index->node_end[start])
+    nnet_cbidx_vp_bounds (index, codebook, index->node_mid[start]);
+
+  return;
+}
+
+
+
+/*
+ * nnet_cbidx_vp_build
+ *
+ * Builds the vantage point tree node covering the positions
+ * [start, end) of the index rows
+ */
+static void
+nnet_cbidx_vp_build (CodebookIndex index, const Codebook codebook,
+                     const UnitIndex start, const UnitIndex end,
+                     nnet_cbidx_pair_type * pairs)
+{
+  const RValue *vantage;        /* vantage point weights */
+  UnitIndex pos;                /* current position */
+  UnitIndex far_pos;            /* position of the farthest row */
+  UnitIndex aux_row;            /* auxiliary row for swapping */
+  RValue d, far_d;              /* distances */
+
+
+  index->node_end[start] = end;
+  index->node_mid[start] = end;
+
+  if (end - start == 1)
+    return;
+
+  /* the vantage point is the row farthest from the first one */
+  vantage = nnet_cbook_row (codebook, index->rows[start]);
+  far_pos = start;
+  far_d = -1.0;
+
+  for (pos = start; pos < end; pos++)
+    {
+      d = nnet_cbidx_distance (codebook, index->rows[pos], vantage);
+      if (d > far_d)
+        {
+          far_d = d;
+          far_pos = pos;
+        }
+    }
+
+  aux_row = index->rows[start];
+  index->rows[start] = index->rows[far_pos];
+  index->rows[far_pos] = aux_row;
+
+  /* sorts the other rows by distance to the vantage point */
+  vantage = nnet_cbook_row (codebook, index->rows[start]);
+
+  for (pos = start + 1; pos < end; pos++)
+    {
+      pairs[pos].row = index->rows[pos];
+      pairs[pos].distance =
+        nnet_cbidx_distance (codebook, index->rows[pos], vantage);
+    }
+
+  qsort (&pairs[start + 1], end - start - 1, sizeof (nnet_cbidx_pair_type),
+         nnet_cbidx_pair_compare);
+
+  for (pos = start + 1; pos < end; pos++)
+    index->rows[pos] = pairs[pos].row;
+
+  /* the closest half is the inner one */
+  index->node_mid[start] = start + 1 + (end - start) / 2;
+
+  nnet_cbidx_vp_build (index, codebook, start + 1, index->node_mid[start],
+                       pairs);
+
+  if (index->node_mid[start] < end)
+    nnet_cbidx_vp_build (index, codebook, index->node_mid[start], end,
+                         pairs);
+
+  return;
+}
+
+
+
+/*
+ * nnet_cbidx_vp_search
+ *
+ * Searches the node starting at the given position for rows closer than
+ * the current best one
+ */
+static void
+nnet_cbidx_vp_search (const CodebookIndex index, const Codebook codebook,
+                      const UnitIndex start, const RValue * input,
+                      UnitIndex * best_row, RValue * best_d,
+                      UsLgIntValue * evaluations)
+{
+  UnitIndex row;                /* vantage point row */
+  UnitIndex mid, end;           /* node half limits */
+  RValue d;                     /* distance to the vantage point */
+  RValue lb_in, lb_out;         /* lower bounds for the halves */
+
+
+  row = index->rows[start];
+  mid = index->node_mid[start];
+  end = index->node_end[start];
+
+  d = nnet_cbidx_distance (codebook, row, input);
+  ++(*evaluations);
+
+  if (d < *best_d || (d == *best_d && row < *best_row))
+    {
+      *best_d = d;
+      *best_row = row;
+    }
+
+  lb_in = HUGE_VAL;
+  lb_out = HUGE_VAL;
+
+  if (start + 1 < mid)
+    lb_in = nnet_cbidx_lower_bound (d, index->in_lo[start],
+                                    index->in_hi[start]);
+
+  if (mid < end)
+    lb_out = nnet_cbidx_lower_bound (d, index->out_lo[start],
+                                     index->out_hi[start]);
+
+  /* visits the most promising half first */
+  if (lb_in <= lb_out)
+    {
+      if (start + 1 < mid && lb_in <= *best_d)
+        nnet_cbidx_vp_search (index, codebook, start + 1, input, best_row,
+                              best_d, evaluations);
+      if (mid < end && lb_out <= *best_d)
+        nnet_cbidx_vp_search (index, codebook, mid, input, best_row, best_d,
+                              evaluations);
+    }
+  else
+    {
+      if (mid < end && lb_out <= *best_d)
+        nnet_cbidx_vp_search (index, codebook, mid, input, best_row, best_d,
+                              evaluations);
+      if (start + 1 < mid && lb_in <= *best_d)
+        nnet_cbidx_vp_search (index, codebook, start + 1, input, best_row,
+                              best_d, evaluations);
+    }
+
+  return;
+}
+
+
+
+/*
+ * nnet_cbidx_graph_build
+ *
+ * Links each row to its nearest rows and chooses the row closest to the
+ * codebook mean as the search entry point
+ */
+static int
+nnet_cbidx_graph_build (CodebookIndex index, const Codebook codebook)
+{
+  nnet_cbidx_pair_type *pairs;  /* distances to the current row */
+  RValue *mean;                 /* codebook mean */
+  UnitIndex cur_row, other;     /* rows */
+  UnitIndex cur_col;            /* current column */
+  UnitIndex nu_pairs;           /* number of other rows */
+  RValue d, best_d;             /* distances */
+
+
+  pairs = (nnet_cbidx_pair_type *)
+    malloc (index->nu_units * sizeof (nnet_cbidx_pair_type));
+  mean = (RValue *) calloc (index->dimension, sizeof (RValue));
+
+  if (pairs == NULL || mean == NULL)
+    {
+      fprintf (stderr, "nnet_cbidx_graph_build: virtual memory exhausted\n");
+      free (pairs);
+      free (mean);
+      return EXIT_FAILURE;
+    }
+
+  for (cur_row = 0; cur_row < index->nu_units; cur_row++)
+    {
+      /* sorts the other rows by distance */
+      nu_pairs = 0;
+      for (other = 0; other < index->nu_units; other++)
+        {
+          if (other == cur_row)
+            continue;
+
+          pairs[nu_pairs].row = other;
+          pairs[nu_pairs].distance =
+            nnet_cbidx_distance (codebook, other,
+                                 nnet_cbook_row (codebook, cur_row));
+          ++nu_pairs;
+        }
+
+      qsort (pairs, nu_pairs, sizeof (nnet_cbidx_pair_type),
+             nnet_cbidx_pair_compare);
+
+      for (other = 0; other < index->degree; other++)
+        index->neighbors[cur_row * index->degree + other] =
+          pairs[other].row;
+
+      /* accumulates the mean */
+      for (cur_col = 0; cur_col < index->dimension; cur_col++)
+        mean[cur_col] += nnet_cbook_row (codebook, cur_row)[cur_col];
+    }
+
+  for (cur_col = 0; cur_col < index->dimension; cur_col++)
+    mean[cur_col] /= (RValue) index->nu_units;
+
+  /* entry point */
+  index->entry_row = 0;
+  best_d = HUGE_VAL;
+
+  for (cur_row = 0; cur_row < index->nu_units; cur_row++)
+    {
+      d = nnet_cbidx_distance (codebook, cur_row, mean);
+      if (d < best_d)
+        {
+          best_d = d;
+          index->entry_row = cur_row;
+        }
+    }
+
+  free (pairs);
+  free (mean);
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_cbidx_graph_search
+ *
+ * Beam search over the neighbor graph: the closest unexpanded candidate
+ * is expanded until none of them is closer than the worst of the
+ * 'beam_width' best rows found so far
+ */
+static int
+nnet_cbidx_graph_search (const CodebookIndex index, const Codebook codebook,
+                         const RValue * input, CodebookIndexScratch scratch,
+                         UnitIndex * best_row, RValue * best_d,
+                         UsLgIntValue * evaluations)
+{
+  UsLgIntValue *visited;        /* generation of each row's last visit */
+  nnet_cbidx_pair_type *cand;   /* rows waiting expansion */
+  nnet_cbidx_pair_type *beam;   /* best rows, by increasing distance */
+  nnet_cbidx_pair_type cur;     /* current candidate */
+  UsLgIntValue generation;      /* this search's visit mark */
+  UnitIndex nu_cand = 0;        /* number of candidates */
+  UnitIndex nu_beam = 0;        /* number of best rows */
+  UnitIndex cur_cand, min_cand; /* candidate positions */
+  UnitIndex cur_ngb;            /* current neighbor */
+  UnitIndex pos;                /* beam insertion position */
+  UnitIndex row;                /* neighbor row */
+  RValue d;                     /* neighbor distance */
+
+
+  if (scratch->nu_units != index->nu_units ||
+      scratch->beam_width != index->beam_width)
+    {
+      fprintf (stderr,
+               "nnet_cbidx_graph_search: working memory created for another index\n");
+      return EXIT_FAILURE;
+    }
+
+  visited = scratch->visited;
+  cand = scratch->cand;
+  beam = scratch->beam;
+
+  /* a new generation unmarks all rows; the marks are only cleared when
+     the counter wraps around */
+  if (++(scratch->generation) == 0)
+    {
+      memset (visited, 0, scratch->nu_units * sizeof (UsLgIntValue));
+      scratch->generation = 1;
+    }
+
+  generation = scratch->generation;
+
+  /* starts from the entry point */
+  cur.row = index->entry_row;
+  cur.distance = nnet_cbidx_distance (codebook, cur.row, input);
+  ++(*evaluations);
+  visited[cur.row] = generation;
+  cand[nu_cand++] = cur;
+  beam[nu_beam++] = cur;
+
+  while (nu_cand > 0)
+    {
+      /* takes the closest candidate */
+      min_cand = 0;
+      for (cur_cand = 1; cur_cand < nu_cand; cur_cand++)
+        if (nnet_cbidx_pair_compare (&cand[cur_cand], &cand[min_cand]) < 0)
+          min_cand = cur_cand;
+
+      cur = cand[min_cand];
+      cand[min_cand] = cand[--nu_cand];
+
+      if (nu_beam == index->beam_width &&
+          cur.distance > beam[nu_beam - 1].distance)
+        break;
+
+      /* evaluates its neighbors */
+      for (cur_ngb = 0; cur_ngb < index->degree; cur_ngb++)
+        {
+          row = index->neighbors[cur.row * index->degree + cur_ngb];
+
+          if (visited[row] == generation)
+            continue;
+
+          visited[row] = generation;
+          d = nnet_cbidx_distance (codebook, row, input);
+          ++(*evaluations);
+
+          if (nu_beam == index->beam_width && d >= beam[nu_beam - 1].distance)
+            continue;
+
+          /* inserts the row in the beam, keeping it sorted */
+          pos = (nu_beam < index->beam_width) ? nu_beam++ : nu_beam - 1;
+          while (pos > 0 &&
+                 (beam[pos - 1].distance > d ||
+                  (beam[pos - 1].distance == d && beam[pos - 1].row > row)))
+            {
+              beam[pos] = beam[pos - 1];
+              --pos;
+            }
+          beam[pos].row = row;
+          beam[pos].distance = d;
+
+          cand[nu_cand].row = row;
+          cand[nu_cand].distance = d;
+          ++nu_cand;
+        }
+    }
+
+  *best_row = beam[0].row;
+  *best_d = beam[0].distance;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_cbidx_check_codebook
+ *
+ * Checks if the codebook matches the index and if its units share the
+ * same increasing activation function, so that the smallest distance
+ * also gives the smallest output
+ */
+static int
+nnet_cbidx_check_codebook (const CodebookIndex index,
+                           const Codebook codebook, const char *caller)
+{
+  if (codebook == NULL)
+    {
+      fprintf (stderr, "%s: no codebook passed\n", caller);
+      return EXIT_FAILURE;
+    }
+
+  if (index != NULL && (index->nu_units != codebook->nu_units ||
+                        index->dimension != codebook->dimension))
+    {
+      fprintf (stderr,
+               "%s: index built for %ld rows of dimension %ld, codebook has %ld rows of dimension %ld\n",
+               caller, index->nu_units, index->dimension,
+               codebook->nu_units, codebook->dimension);
+      return EXIT_FAILURE;
+    }
+
+  if (nnet_cbook_is_monotone (codebook) != TRUE)
+    {
+      fprintf (stderr,
+               "%s: units don't share an increasing activation function\n",
+               caller);
+      return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                            STRUCTURAL OPERATIONS                           *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * nnet_cbidx_create
+ *
+ * Creates and builds a new search index of the given class over the rows
+ * of the given codebook
+ */
+CodebookIndex
+nnet_cbidx_create (const Codebook codebook,
+                   const CodebookIndexType index_type,
+                   const DTime rebuild_epochs,
+                   const UnitIndex degree, const UnitIndex beam_width)
+{
+  CodebookIndex new_index = NULL;       /* new search index */
+  UnitIndex nu_units;           /* number of rows */
+
+
+  /* Checks the codebook */
+  if (nnet_cbidx_check_codebook (NULL, codebook, "nnet_cbidx_create") !=
+      EXIT_SUCCESS)
+    return NULL;
+
+  /* Checks the index class */
+  if (index_type != CBIDX_VPTREE && index_type != CBIDX_GRAPH)
+    {
+      fprintf (stderr, "nnet_cbidx_create: invalid index class (%d)\n",
+               (int) index_type);
+      return NULL;
+    }
+
+  if (index_type == CBIDX_GRAPH && (degree == 0 || beam_width == 0))
+    {
+      fprintf (stderr,
+               "nnet_cbidx_create: graph degree and beam width must be positive\n");
+      return NULL;
+    }
+
+  /* Allocates the new index */
+  new_index = (CodebookIndex) calloc (1, sizeof (nnet_cbindex_type));
+
+  if (new_index == NULL)
+    {
+      fprintf (stderr, "nnet_cbidx_create: virtual memory exhausted\n");
+      return NULL;
+    }
+
+  nu_units = codebook->nu_units;
+  new_index->index_type = index_type;
+  new_index->nu_units = nu_units;
+  new_index->dimension = codebook->dimension;
+  new_index->rebuild_epochs = rebuild_epochs;
+  new_index->age = 0;
+
+  if (index_type == CBIDX_VPTREE)
+    {
+      new_index->rows = (UnitIndex *) malloc (nu_units * sizeof (UnitIndex));
+      new_index->node_end =
+        (UnitIndex *) malloc (nu_units * sizeof (UnitIndex));
+      new_index->node_mid =
+        (UnitIndex *) malloc (nu_units * sizeof (UnitIndex));
+      new_index->in_lo = (RValue *) malloc (nu_units * sizeof (RValue));
+      new_index->in_hi = (RValue *) malloc (nu_units * sizeof (RValue));
+      new_index->out_lo = (RValue *) malloc (nu_units * sizeof (RValue));
+      new_index->out_hi = (RValue *) malloc (nu_units * sizeof (RValue));
+
+      if (new_index->rows == NULL || new_index->node_end == NULL ||
+          new_index->node_mid == NULL || new_index->in_lo == NULL ||
+          new_index->in_hi == NULL || new_index->out_lo == NULL ||
+          new_index->out_hi == NULL)
+        {
+          fprintf (stderr, "nnet_cbidx_create: virtual memory exhausted\n");
+          nnet_cbidx_destroy (&new_index);
+          return NULL;
+        }
+    }
+  else
+    {
+      /* a row can't have more neighbors than the other rows */
+      new_index->degree = degree < nu_units ? degree : nu_units - 1;
+      new_index->beam_width = beam_width;
+      new_index->neighbors = (UnitIndex *)
+        malloc ((nu_units * new_index->degree + 1) * sizeof (UnitIndex));
+
+      if (new_index->neighbors == NULL)
+        {
+          fprintf (stderr, "nnet_cbidx_create: virtual memory exhausted\n");
+          nnet_cbidx_destroy (&new_index);
+          return NULL;
+        }
+    }
+
+  /* Builds the index */
+  if (nnet_cbidx_rebuild (new_index, codebook) != EXIT_SUCCESS)
+    {
+      fprintf (stderr, "nnet_cbidx_create: error building index\n");
+      nnet_cbidx_destroy (&new_index);
+      return NULL;
+    }
+
+  return new_index;
+}
+
+
+
+/*
+ * nnet_cbidx_destroy
+ *
+ * Destroys a previously created search index
+ */
+int
+nnet_cbidx_destroy (CodebookIndex * index)
+{
+  /* Checks if the index was actually passed */
+  if (index == NULL || *index == NULL)
+    {
+      fprintf (stderr, "nnet_cbidx_destroy: no index to destroy\n");
+      return EXIT_FAILURE;
+    }
+
+  free ((*index)->rows);
+  free ((*index)->node_end);
+  free ((*index)->node_mid);
+  free ((*index)->in_lo);
+  free ((*index)->in_hi);
+  free ((*index)->out_lo);
+  free ((*index)->out_hi);
+  free ((*index)->neighbors);
+  free (*index);
+
+  /* Makes it point to NULL */
+  *index = NULL;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_cbidx_scratch_create
+ *
+ * Creates the working memory of the searches of one thread over the
+ * given index
+ */
+CodebookIndexScratch
+nnet_cbidx_scratch_create (const CodebookIndex index)
+{
+  CodebookIndexScratch new_scratch;     /* new working memory */
+
+
+  /* Checks if the index was actually passed */
+  if (index == NULL)
+    {
+      fprintf (stderr, "nnet_cbidx_scratch_create: no index passed\n");
+      return NULL;
+    }
+
+  new_scratch = (CodebookIndexScratch)
+    malloc (sizeof (nnet_cbidx_scratch_type));
+
+  if (new_scratch == NULL)
+    {
+      fprintf (stderr,
+               "nnet_cbidx_scratch_create: virtual memory exhausted\n");
+      return NULL;
+    }
+
+  new_scratch->nu_units = index->nu_units;
+  new_scratch->beam_width = index->beam_width;
+  new_scratch->generation = 0;
+  new_scratch->visited = (UsLgIntValue *)
+    calloc (index->nu_units, sizeof (UsLgIntValue));
+  new_scratch->cand = (nnet_cbidx_pair_type *)
+    malloc (index->nu_units * sizeof (nnet_cbidx_pair_type));
+  new_scratch->beam = (nnet_cbidx_pair_type *)
+    malloc ((index->beam_width + 1) * sizeof (nnet_cbidx_pair_type));
+
+  if (new_scratch->visited == NULL || new_scratch->cand == NULL ||
+      new_scratch->beam == NULL)
+    {
+      fprintf (stderr,
+               "nnet_cbidx_scratch_create: virtual memory exhausted\n");
+      nnet_cbidx_scratch_destroy (&new_scratch);
+      return NULL;
+    }
+
+  return new_scratch;
+}
+
+
+
+/*
+ * nnet_cbidx_scratch_destroy
+ *
+ * Destroys a previously created search working memory
+ */
+int
+nnet_cbidx_scratch_destroy (CodebookIndexScratch * scratch)
+{
+  /* Checks if the working memory was actually passed */
+  if (scratch == NULL || *scratch == NULL)
+    {
+      fprintf (stderr,
+               "nnet_cbidx_scratch_destroy: no working memory to destroy\n");
+      return EXIT_FAILURE;
+    }
+
+  free ((*scratch)->visited);
+  free ((*scratch)->cand);
+  free ((*scratch)->beam);
+  free (*scratch);
+
+  /* Makes it point to NULL */
+  *scratch = NULL;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_cbidx_rebuild
+ *
+ * Rebuilds the index structure over the current codebook rows
+ */
+int
+nnet_cbidx_rebuild (CodebookIndex index, const Codebook codebook)
+{
+  nnet_cbidx_pair_type *pairs;  /* sorting workspace */
+  UnitIndex cur_row;            /* current row */
+
+
+  /* Checks the parameters */
+  if (index == NULL)
+    {
+      fprintf (stderr, "nnet_cbidx_rebuild: no index passed\n");
+      return EXIT_FAILURE;
+    }
+
+  if (nnet_cbidx_check_codebook (index, codebook, "nnet_cbidx_rebuild") !=
+      EXIT_SUCCESS)
+    return EXIT_FAILURE;
+
+  index->age = 0;
+
+  /* Graph */
+  if (index->index_type == CBIDX_GRAPH)
+    return nnet_cbidx_graph_build (index, codebook);
+
+  /* Vantage point tree */
+  pairs = (nnet_cbidx_pair_type *)
+    malloc (index->nu_units * sizeof (nnet_cbidx_pair_type));
+
+  if (pairs == NULL)
+    {
+      fprintf (stderr, "nnet_cbidx_rebuild: virtual memory exhausted\n");
+      return EXIT_FAILURE;
+    }
+
+  for (cur_row = 0; cur_row < index->nu_units; cur_row++)
+    index->rows[cur_row] = cur_row;
+
+  nnet_cbidx_vp_build (index, codebook, 0, index->nu_units, pairs);
+  nnet_cbidx_vp_bounds (index, codebook, 0);
+
+  free (pairs);
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_cbidx_refresh
+ *
+ * Adapts the index to the current codebook rows without changing its
+ * structure
+ */
+int
+nnet_cbidx_refresh (CodebookIndex index, const Codebook codebook)
+{
+  /* Checks the parameters */
+  if (index == NULL)
+    {
+      fprintf (stderr, "nnet_cbidx_refresh: no index passed\n");
+      return EXIT_FAILURE;
+    }
+
+  if (nnet_cbidx_check_codebook (index, codebook, "nnet_cbidx_refresh") !=
+      EXIT_SUCCESS)
+    return EXIT_FAILURE;
+
+  /* The graph links are kept as they are: its search is approximate */
+  if (index->index_type == CBIDX_VPTREE)
+    nnet_cbidx_vp_bounds (index, codebook, 0);
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_cbidx_update
+ *
+ * Called once per training epoch: rebuilds the index if the rebuild
+ * interval has elapsed, refreshes it otherwise
+ */
+int
+nnet_cbidx_update (CodebookIndex index, const Codebook codebook)
+{
+  /* Checks if the index was actually passed */
+  if (index == NULL)
+    {
+      fprintf (stderr, "nnet_cbidx_update: no index passed\n");
+      return EXIT_FAILURE;
+    }
+
+  ++index->age;
+
+  if (index->rebuild_epochs > 0 && index->age >= index->rebuild_epochs)
+    return nnet_cbidx_rebuild (index, codebook);
+
+  return nnet_cbidx_refresh (index, codebook);
+}
+
+
+
+/*
+ * nnet_cbidx_attach
+ *
+ * Attaches the index to the given codebook, so that nnet_cbook_winner
+ * uses it for euclidean competition
+ */
+int
+nnet_cbidx_attach (CodebookIndex index, Codebook codebook)
+{
+  if (nnet_cbidx_check_codebook (index, codebook, "nnet_cbidx_attach") !=
+      EXIT_SUCCESS)
+    return EXIT_FAILURE;
+
+  codebook->index = index;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                            FUNCTIONAL OPERATIONS                           *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * nnet_cbidx_winner
+ *
+ * Searches the winner row for the given input values through the index,
+ * using the calling thread's working memory (if NULL, the search creates
+ * its own). If 'evaluations' is passed, the number of distances computed
+ * is added to it.
+ */
+int
+nnet_cbidx_winner (const CodebookIndex index, const Codebook codebook,
+                   const RValue * input, CodebookIndexScratch scratch,
+                   UnitIndex * winner, RValue * winner_output,
+                   UsLgIntValue * evaluations)
+{
+  CodebookIndexScratch own_scratch = NULL;      /* this search's memory */
+  UsLgIntValue nu_evaluations = 0;      /* distances computed */
+  UnitIndex best_row = 0;       /* winner row */
+  RValue best_d = HUGE_VAL;     /* winner distance */
+  int exit_status;              /* auxiliary function return status */
+
+
+  /* Checks the parameters */
+  if (index == NULL || codebook == NULL || input == NULL)
+    {
+      fprintf (stderr,
+               "nnet_cbidx_winner: missing index, codebook or input\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Dispatches the search */
+  if (index->index_type == CBIDX_VPTREE)
+    {
+      nnet_cbidx_vp_search (index, codebook, 0, input, &best_row, &best_d,
+                            &nu_evaluations);
+    }
+  else
+    {
+      if (scratch == NULL &&
+          (scratch = own_scratch = nnet_cbidx_scratch_create (index)) ==
+          NULL)
+        return EXIT_FAILURE;
+
+      exit_status = nnet_cbidx_graph_search
+        (index, codebook, input, scratch, &best_row, &best_d,
+         &nu_evaluations);
+
+      if (own_scratch != NULL)
+        nnet_cbidx_scratch_destroy (&own_scratch);
+
+      if (exit_status != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+    }
+
+  *winner = best_row;
+
+  if (winner_output != NULL)
+    *winner_output = nnet_cbook_row_output (codebook, best_row, best_d);
+
+  if (evaluations != NULL)
+    *evaluations += nu_evaluations;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_cbidx_recall
+ *
+ * Compares the index search with the exact linear scan over all the
+ * elements of the given set, returning the fraction of elements with the
+ * same winner and the mean number of distances computed per search
+ */
+int
+nnet_cbidx_recall (const CodebookIndex index, const Codebook codebook,
+                   const TSet set, RValue * recall,
+                   RValue * mean_evaluations)
+{
+  TElement cur_element;         /* current element */
+  CodebookIndexScratch scratch; /* search working memory */
+  UsLgIntValue evaluations = 0; /* distances computed by the index */
+  UsLgIntValue nu_hits = 0;     /* elements with the exact winner */
+  UnitIndex exact_row;          /* exact winner */
+  UnitIndex index_row;          /* index winner */
+
+
+  /* Checks the parameters */
+  if (index == NULL || codebook == NULL || set == NULL)
+    {
+      fprintf (stderr,
+               "nnet_cbidx_recall: missing index, codebook or set\n");
+      return EXIT_FAILURE;
+    }
+
+  *recall = 1.0;
+  *mean_evaluations = 0.0;
+
+  if (set->nu_elements == 0)
+    return EXIT_SUCCESS;
+
+  if ((scratch = nnet_cbidx_scratch_create (index)) == NULL)
+    return EXIT_FAILURE;
+
+  for (cur_element = set->first_element; cur_element != NULL;
+       cur_element = cur_element->next)
+    {
+      if (cur_element->input->dimension != codebook->dimension)
+        {
+          fprintf (stderr,
+                   "nnet_cbidx_recall: element %ld has incompatible input dimension\n",
+                   cur_element->element_index);
+          nnet_cbidx_scratch_destroy (&scratch);
+          return EXIT_FAILURE;
+        }
+
+      if (nnet_cbook_scan
+          (codebook, cur_element->input->value, VECTOR_METR_EUCLIDEAN,
+           &exact_row, NULL) != EXIT_SUCCESS ||
+          nnet_cbidx_winner (index, codebook, cur_element->input->value,
+                             scratch, &index_row, NULL,
+                             &evaluations) != EXIT_SUCCESS)
+        {
+          fprintf (stderr,
+                   "nnet_cbidx_recall: error searching winner of element %ld\n",
+                   cur_element->element_index);
+          nnet_cbidx_scratch_destroy (&scratch);
+          return EXIT_FAILURE;
+        }
+
+      if (exact_row == index_row)
+        ++nu_hits;
+    }
+
+  nnet_cbidx_scratch_destroy (&scratch);
+
+  *recall = (RValue) nu_hits / (RValue) set->nu_elements;
+  *mean_evaluations = (RValue) evaluations / (RValue) set->nu_elements;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_cbidx_type_by_name
+ *
+ * Gets the index class with the given name: "linear", "vptree" or "graph"
+ */
+int
+nnet_cbidx_type_by_name (const char *name, CodebookIndexType * index_type)
+{
+  if (name == NULL)
+    {
+      fprintf (stderr, "nnet_cbidx_type_by_name: no name passed\n");
+      return EXIT_FAILURE;
+    }
+
+  if (strcmp (name, "linear") == 0)
+    *index_type = CBIDX_LINEAR;
+  else if (strcmp (name, "vptree") == 0)
+    *index_type = CBIDX_VPTREE;
+  else if (strcmp (name, "graph") == 0)
+    *index_type = CBIDX_GRAPH;
+  else
+    {
+      fprintf (stderr, "nnet_cbidx_type_by_name: unknown index class '%s'\n",
+               name);
+      return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,254 @@
+#ifndef __NNET_CBINDEX_H_
+#define __NNET_CBINDEX_H_ 1
+
+#include "nnet_types.h"
+#include "nnet_codebook.h"
+
+
+/******************************************************************************
+ *                                                                            *
+ *                        PUBLIC DATATYPES AND VARIABLES                      *
+ *                                                                            *
+ ******************************************************************************/
+
+/* Default number of neighbors of each row in the graph index */
+#define NNET_CBIDX_GRAPH_DEGREE 8
+
+/* Default number of candidates kept by the graph index search */
+#define NNET_CBIDX_BEAM_WIDTH 16
+
+
+/*
+ * CodebookIndexType
+ *
+ * Codebook search index class
+ * - CBIDX_LINEAR: no index, every row is compared (exact)
+ * - CBIDX_VPTREE: vantage point tree with per-node distance bounds (exact)
+ * - CBIDX_GRAPH: k-nearest-prototype graph with beam search (approximate)
+ */
+typedef enum
+{
+  CBIDX_LINEAR = 0,
+  CBIDX_VPTREE = 1,
+  CBIDX_GRAPH = 2
+}
+CodebookIndexType;
+
+
+
+/*
+ * nnet_cbindex_type
+ *
+ * Search index over the rows of a codebook, for euclidean competition.
+ * The vantage point tree keeps, for each node, the rows of its subtree
+ * in a contiguous range of 'rows' (the vantage point first, then the
+ * inner and the outer halves) and the distance bounds of each half to
+ * the vantage point. Refreshing recomputes only the bounds, so the tree
+ * remains exact for any codebook contents; rebuilding also chooses new
+ * vantage points.
+ * The graph links each row to its 'degree' nearest rows, as of the
+ * last rebuild.
+ */
+typedef struct nnet_cbindex_struct
+{
+  CodebookIndexType index_type; /* index class */
+  UnitIndex nu_units;           /* number of indexed rows */
+  UnitIndex dimension;          /* row dimension */
+  DTime rebuild_epochs;         /* epochs between rebuilds (0: never) */
+  DTime age;                    /* epochs since the last rebuild */
+
+  /* vantage point tree */
+  UnitIndex *rows;              /* rows in tree order */
+  UnitIndex *node_end;          /* one past the last position of the node */
+  UnitIndex *node_mid;          /* first position of the outer half */
+  RValue *in_lo, *in_hi;        /* inner half distance bounds */
+  RValue *out_lo, *out_hi;      /* outer half distance bounds */
+
+  /* graph */
+  UnitIndex degree;             /* neighbors per row */
+  UnitIndex beam_width;         /* candidates kept by the search */
+  UnitIndex entry_row;          /* search starting row */
+  UnitIndex *neighbors;         /* nu_units x degree neighbor rows */
+}
+nnet_cbindex_type;
+
+
+/* Symbolic type */
+typedef nnet_cbindex_type *CodebookIndex;
+
+
+
+/*
+ * nnet_cbidx_pair_type
+ *
+ * Row and distance pair used to sort rows by distance
+ */
+typedef struct
+{
+  RValue distance;
+  UnitIndex row;
+}
+nnet_cbidx_pair_type;
+
+
+
+/*
+ * nnet_cbidx_scratch_type
+ *
+ * Working memory of the graph searches of one thread, so that the searches
+ * allocate nothing. A row has been visited by the current search when its
+ * mark equals the search generation, so the marks are not cleared between
+ * searches.
+ */
+typedef struct nnet_cbidx_scratch_struct
+{
+  UnitIndex nu_units;           /* number of indexed rows */
+  UnitIndex beam_width;         /* candidates kept by the search */
+  UsLgIntValue generation;      /* current search */
+  UsLgIntValue *visited;        /* generation of each row's last visit */
+  nnet_cbidx_pair_type *cand;   /* rows waiting expansion */
+  nnet_cbidx_pair_type *beam;   /* best rows, by increasing distance */
+}
+nnet_cbidx_scratch_type;
+
+
+/* Symbolic type */
+typedef nnet_cbidx_scratch_type *CodebookIndexScratch;
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                            STRUCTURAL OPERATIONS                           *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * nnet_cbidx_create
+ *
+ * Creates and builds a new search index of the given class over the rows
+ * of the given codebook
+ */
+extern CodebookIndex
+nnet_cbidx_create (const Codebook codebook,
+                   const CodebookIndexType index_type,
+                   const DTime rebuild_epochs,
+                   const UnitIndex degree, const UnitIndex beam_width);
+
+
+
+/*
+ * nnet_cbidx_destroy
+ *
+ * Destroys a previously created search index
+ */
+extern int nnet_cbidx_destroy (CodebookIndex * index);
+
+
+
+/*
+ * nnet_cbidx_scratch_create
+ *
+ * Creates the working memory of the searches of one thread over the
+ * given index
+ */
+extern CodebookIndexScratch
+nnet_cbidx_scratch_create (const CodebookIndex index);
+
+
+
+/*
+ * nnet_cbidx_scratch_destroy
+ *
+ * Destroys a previously created search working memory
+ */
+extern int nnet_cbidx_scratch_destroy (CodebookIndexScratch * scratch);
+
+
+
+/*
+ * nnet_cbidx_rebuild
+ *
+ * Rebuilds the index structure over the current codebook rows
+ */
+extern int nnet_cbidx_rebuild (CodebookIndex index, const Codebook codebook);
+
+
+
+/*
+ * nnet_cbidx_refresh
+ *
+ * Adapts the index to the current codebook rows without changing its
+ * structure
+ */
+extern int nnet_cbidx_refresh (CodebookIndex index, const Codebook codebook);
+
+
+
+/*
+ * nnet_cbidx_update
+ *
+ * Called once per training epoch: rebuilds the index if the rebuild
+ * interval has elapsed, refreshes it otherwise
+ */
+extern int nnet_cbidx_update (CodebookIndex index, const Codebook codebook);
+
+
+
+/*
+ * nnet_cbidx_attach
+ *
+ * Attaches the index to the given codebook, so that nnet_cbook_winner
+ * uses it for euclidean competition
+ */
+extern int nnet_cbidx_attach (CodebookIndex index, Codebook codebook);
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                            FUNCTIONAL OPERATIONS                           *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * nnet_cbidx_winner
+ *
+ * Searches the winner row for the given input values through the index,
+ * using the calling thread's working memory (if NULL, the search creates
+ * its own). If 'evaluations' is passed, the number of distances computed
+ * is added to it.
+ */
+extern int
+nnet_cbidx_winner (const CodebookIndex index, const Codebook codebook,
+                   const RValue * input, CodebookIndexScratch scratch,
+                   UnitIndex * winner, RValue * winner_output,
+                   UsLgIntValue * evaluations);
+
+
+
+/*
+ * nnet_cbidx_recall
+ *
+ * Compares the index search with the exact linear scan over all the
+ * elements of the given set, returning the fraction of elements with the
+ * same winner and the mean number of distances computed per search
+ */
+extern int
+nnet_cbidx_recall (const CodebookIndex index, const Codebook codebook,
+                   const TSet set, RValue * recall,
+                   RValue * mean_evaluations);
+
+
+
+/*
+ * nnet_cbidx_type_by_name
+ *
+ * Gets the index class with the given name: "linear", "vptree" or "graph"
+ */
+extern int
+nnet_cbidx_type_by_name (const char *name, CodebookIndexType * index_type);
+
+
+
+#endif /* __NNET_CBINDEX_H_ */
@@ -0,0 +1,595 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include "nnet_types.h"
+#include "nnet_ckpt.h"
+#include "nnet_nnet.h"
+#include "nnet_codebook.h"
+#include "nnet_files_nnet.h"
+#include "nnet_files_bin.h"
+#include "som/nnet_som.h"
+
+/******************************************************************************
+ *                                                                            *
+ *                             PRIVATE OPERATIONS                             *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * nnet_ckpt_write
+ *
+ * Thread body: stores the snapshots into the private copy of the network,
+ * writes it to the temporary file and renames it over the checkpoint file
+ */
+static void *
+nnet_ckpt_write (void *checkpoint_ptr)
+{
+  NNetCheckpoint checkpoint = (NNetCheckpoint) checkpoint_ptr;
+  FILE *output_fd = NULL;       /* temporary file */
+  LayerIndex cur_layer;         /* current layer */
+
+
+  checkpoint->status = EXIT_SUCCESS;
+
+  for (cur_layer = 0; cur_layer < checkpoint->nu_layers &&
+       checkpoint->status == EXIT_SUCCESS; cur_layer++)
+    if (checkpoint->copies[cur_layer] != NULL)
+      checkpoint->status = nnet_cbook_store (checkpoint->copies[cur_layer]);
+
+  if (checkpoint->status != EXIT_SUCCESS)
+    {
+      fprintf (stderr, "nnet_ckpt_write: error storing weights snapshot\n");
+      return NULL;
+    }
+
+  if (checkpoint->binary == TRUE && checkpoint->state_size > 0)
+    checkpoint->status =
+      nnet_bin_write_checkpoint (checkpoint->copy, checkpoint->state_block,
+                                 checkpoint->state_size,
+                                 checkpoint->temp_name);
+  else if (checkpoint->binary == TRUE)
+    checkpoint->status =
+      nnet_bin_write_nnetwork (checkpoint->copy, checkpoint->temp_name);
+  else
+    {
+      output_fd = fopen (checkpoint->temp_name, "w");
+
+      if (output_fd == NULL)
+        {
+          fprintf (stderr, "nnet_ckpt_write: '%s': %s\n",
+                   checkpoint->temp_name, strerror (errno));
+          checkpoint->status = EXIT_FAILURE;
+          return NULL;
+        }
+
+      nnet_file_write_nnetwork (checkpoint->copy, TRUE, TRUE, TRUE, TRUE,
+                                TRUE, output_fd);
+
+      if (ferror (output_fd) || fclose (output_fd) != 0)
+        checkpoint->status = EXIT_FAILURE;
+    }
+
+  if (checkpoint->status != EXIT_SUCCESS)
+    {
+      fprintf (stderr, "nnet_ckpt_write: error writing '%s'\n",
+               checkpoint->temp_name);
+      remove (checkpoint->temp_name);
+      return NULL;
+    }
+
+  /* Replaces the checkpoint file at once */
+  if (rename (checkpoint->temp_name, checkpoint->file_name) != 0)
+    {
+      fprintf (stderr, "nnet_ckpt_write: '%s': %s\n",
+               checkpoint->file_name, strerror (errno));
+      remove (checkpoint->temp_name);
+      checkpoint->status = EXIT_FAILURE;
+    }
+
+  return NULL;
+}
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                              PUBLIC OPERATIONS                             *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * nnet_ckpt_create
+ *
+ * Creates the checkpoints of the given network, written as text
+ * configuration files or as binary models
+ */
+NNetCheckpoint
+nnet_ckpt_create (const NNetwork nnet, const BoolValue binary)
+{
+  NNetCheckpoint new_checkpoint = NULL; /* new checkpoints */
+  Layer cur_layer = NULL;       /* current layer of the network */
+  Layer copy_layer = NULL;      /* current layer of the copy */
+  LayerIndex cur_index;         /* current layer position */
+
+
+  /* Checks if the network was passed */
+  if (nnet == NULL)
+    {
+      fprintf (stderr, "nnet_ckpt_create: no neural network passed\n");
+      return NULL;
+    }
+
+  new_checkpoint = (NNetCheckpoint) malloc (sizeof (nnet_ckpt_type));
+
+  if (new_checkpoint == NULL)
+    {
+      fprintf (stderr, "nnet_ckpt_create: virtual memory exhausted\n");
+      return NULL;
+    }
+
+  new_checkpoint->nnet = nnet;
+  new_checkpoint->nu_layers = nnet->nu_layers;
+  new_checkpoint->binary = binary;
+  new_checkpoint->file_name = NULL;
+  new_checkpoint->temp_name = NULL;
+  new_checkpoint->writing = FALSE;
+  new_checkpoint->status = EXIT_SUCCESS;
+  new_checkpoint->positions = NULL;
+  new_checkpoint->nu_positions = 0;
+  new_checkpoint->best = NULL;
+  new_checkpoint->state_block = NULL;
+  new_checkpoint->state_size = 0;
+
+  new_checkpoint->snapshots =
+    (Codebook *) calloc (nnet->nu_layers, sizeof (Codebook));
+  new_checkpoint->copies =
+    (Codebook *) calloc (nnet->nu_layers, sizeof (Codebook));
+
+  if (new_checkpoint->snapshots == NULL || new_checkpoint->copies == NULL)
+    {
+      fprintf (stderr, "nnet_ckpt_create: virtual memory exhausted\n");
+      free (new_checkpoint->snapshots);
+      free (new_checkpoint->copies);
+      free (new_checkpoint);
+      return NULL;
+    }
+
+  /* The private copy shares nothing with the network */
+  new_checkpoint->copy = nnet_nnetwork_copy (nnet);
+
+  if (new_checkpoint->copy == NULL)
+    {
+      fprintf (stderr, "nnet_ckpt_create: error copying neural network\n");
+      nnet_ckpt_destroy (&new_checkpoint);
+      return NULL;
+    }
+
+  /* Codebooks of the layers with inputs */
+  cur_layer = nnet->first_layer;
+  copy_layer = new_checkpoint->copy->first_layer;
+
+  for (cur_index = 0; cur_index < nnet->nu_layers; cur_index++)
+    {
+      if (cur_layer->first_unit != NULL &&
+          cur_layer->first_unit->nu_inputs > 0)
+        {
+          new_checkpoint->snapshots[cur_index] =
+            nnet_cbook_create (cur_layer);
+          new_checkpoint->copies[cur_index] = nnet_cbook_create (copy_layer);
+
+          if (new_checkpoint->snapshots[cur_index] == NULL ||
+              new_checkpoint->copies[cur_index] == NULL)
+            {
+              fprintf (stderr,
+                       "nnet_ckpt_create: error creating weights snapshot\n");
+              nnet_ckpt_destroy (&new_checkpoint);
+              return NULL;
+            }
+        }
+
+      cur_layer = cur_layer->next;
+      copy_layer = copy_layer->next;
+    }
+
+  return new_checkpoint;
+}
+
+
+
+/*
+ * nnet_ckpt_destroy
+ *
+ * Waits for the pending checkpoint, if any, and destroys the checkpoints
+ */
+int
+nnet_ckpt_destroy (NNetCheckpoint * checkpoint)
+{
+  LayerIndex cur_layer;         /* current layer */
+  int exit_status;              /* status of the pending write */
+
+
+  if (checkpoint == NULL || *checkpoint == NULL)
+    {
+      fprintf (stderr, "nnet_ckpt_destroy: no checkpoints passed\n");
+      return EXIT_FAILURE;
+    }
+
+  exit_status = nnet_ckpt_wait (*checkpoint);
+
+  for (cur_layer = 0; cur_layer < (*checkpoint)->nu_layers; cur_layer++)
+    {
+      if ((*checkpoint)->snapshots[cur_layer] != NULL)
+        nnet_cbook_destroy (&((*checkpoint)->snapshots[cur_layer]));
+
+      if ((*checkpoint)->copies[cur_layer] != NULL)
+        nnet_cbook_destroy (&((*checkpoint)->copies[cur_layer]));
+    }
+
+  if ((*checkpoint)->copy != NULL)
+    nnet_nnetwork_destroy (&((*checkpoint)->copy), TRUE, TRUE, TRUE, TRUE);
+
+  free ((*checkpoint)->snapshots);
+  free ((*checkpoint)->copies);
+  free ((*checkpoint)->file_name);
+  free ((*checkpoint)->temp_name);
+  free ((*checkpoint)->positions);
+  free ((*checkpoint)->state_block);
+  free (*checkpoint);
+
+  *checkpoint = NULL;
+
+  return exit_status;
+}
+
+
+
+/*
+ * nnet_ckpt_set_training
+ *
+ * Registers the initial order of the training set and the codebook of the
+ * best validated weights (if any), saved with the training state
+ */
+int
+nnet_ckpt_set_training (NNetCheckpoint checkpoint,
+                        const ElementIndex * positions,
+                        const ElementIndex nu_positions, const Codebook best)
+{
+  if (checkpoint == NULL)
+    {
+      fprintf (stderr, "nnet_ckpt_set_training: no checkpoints passed\n");
+      return EXIT_FAILURE;
+    }
+
+  if (nu_positions > 0 && positions == NULL)
+    {
+      fprintf (stderr, "nnet_ckpt_set_training: no positions passed\n");
+      return EXIT_FAILURE;
+    }
+
+  free (checkpoint->positions);
+  checkpoint->positions = NULL;
+  checkpoint->nu_positions = 0;
+
+  if (nu_positions > 0)
+    {
+      checkpoint->positions =
+        (ElementIndex *) malloc (nu_positions * sizeof (ElementIndex));
+
+      if (checkpoint->positions == NULL)
+        {
+          fprintf (stderr,
+                   "nnet_ckpt_set_training: virtual memory exhausted\n");
+          return EXIT_FAILURE;
+        }
+
+      memcpy (checkpoint->positions, positions,
+              nu_positions * sizeof (ElementIndex));
+      checkpoint->nu_positions = nu_positions;
+    }
+
+  checkpoint->best = best;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_ckpt_save
+ *
+ * Snapshots the current weights of the network and starts writing them to
+ * the given file in the background, with the given training state (if
+ * passed: binary checkpoints only)
+ */
+int
+nnet_ckpt_save (NNetCheckpoint checkpoint, const char *file_name,
+                const nnet_ckpt_state_type * state)
+{
+  nnet_ckpt_state_type *block_state;    /* state at the start of the block */
+  size_t nu_best_weights;       /* best weights saved */
+  LayerIndex cur_layer;         /* current layer */
+  Codebook snapshot;            /* current layer snapshot */
+  SomAttributes som_attr;       /* SOM attributes of the network */
+  SomAttributes copy_attr;      /* SOM attributes of the copy */
+  int exit_status;              /* auxiliary function return status */
+
+
+  if (checkpoint == NULL)
+    {
+      fprintf (stderr, "nnet_ckpt_save: no checkpoints passed\n");
+      return EXIT_FAILURE;
+    }
+
+  if (file_name == NULL)
+    {
+      fprintf (stderr, "nnet_ckpt_save: no file name passed\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Text files round the weights */
+  if (state != NULL && checkpoint->binary != TRUE)
+    {
+      fprintf (stderr,
+               "nnet_ckpt_save: training states need binary checkpoints\n");
+      return EXIT_FAILURE;
+    }
+
+  /* The previous checkpoint owns the copy until it is written (no file
+     name: the last save failed before writing, and was reported then) */
+  if (nnet_ckpt_wait (checkpoint) != EXIT_SUCCESS &&
+      checkpoint->file_name != NULL)
+    fprintf (stderr, "nnet_ckpt_save: previous checkpoint '%s' failed\n",
+             checkpoint->file_name);
+
+  /* File names */
+  free (checkpoint->file_name);
+  free (checkpoint->temp_name);
+
+  checkpoint->file_name = (char *) malloc (strlen (file_name) + 1);
+  checkpoint->temp_name = (char *)
+    malloc (strlen (file_name) + strlen (NNET_CKPT_TEMP_SUFFIX) + 1);
+
+  if (checkpoint->file_name == NULL || checkpoint->temp_name == NULL)
+    {
+      fprintf (stderr, "nnet_ckpt_save: virtual memory exhausted\n");
+      free (checkpoint->file_name);
+      free (checkpoint->temp_name);
+      checkpoint->file_name = NULL;
+      checkpoint->temp_name = NULL;
+      return EXIT_FAILURE;
+    }
+
+  strcpy (checkpoint->file_name, file_name);
+  sprintf (checkpoint->temp_name, "%s%s", file_name, NNET_CKPT_TEMP_SUFFIX);
+
+  /* Snapshots the weights */
+  for (cur_layer = 0; cur_layer < checkpoint->nu_layers; cur_layer++)
+    {
+      snapshot = checkpoint->snapshots[cur_layer];
+
+      if (snapshot == NULL)
+        continue;
+
+      if (nnet_cbook_load (snapshot) != EXIT_SUCCESS)
+        {
+          fprintf (stderr, "nnet_ckpt_save: error taking weights snapshot\n");
+          return EXIT_FAILURE;
+        }
+
+      memcpy (checkpoint->copies[cur_layer]->weights, snapshot->weights,
+              snapshot->nu_units * snapshot->dimension * sizeof (RValue));
+    }
+
+  /* Training state block */
+  free (checkpoint->state_block);
+  checkpoint->state_block = NULL;
+  checkpoint->state_size = 0;
+
+  if (state != NULL)
+    {
+      nu_best_weights = (checkpoint->best != NULL) ?
+        checkpoint->best->nu_units * checkpoint->best->dimension : 0;
+
+      checkpoint->state_size = sizeof (nnet_ckpt_state_type) +
+        checkpoint->nu_positions * sizeof (ElementIndex) +
+        nu_best_weights * sizeof (RValue);
+
+      checkpoint->state_block = (char *) malloc (checkpoint->state_size);
+
+      if (checkpoint->state_block == NULL)
+        {
+          fprintf (stderr, "nnet_ckpt_save: virtual memory exhausted\n");
+          checkpoint->state_size = 0;
+          return EXIT_FAILURE;
+        }
+
+      block_state = (nnet_ckpt_state_type *) checkpoint->state_block;
+      memcpy (block_state, state, sizeof (nnet_ckpt_state_type));
+      block_state->version = NNET_CKPT_STATE_VERSION;
+      block_state->nu_positions = checkpoint->nu_positions;
+      block_state->nu_best_weights = nu_best_weights;
+
+      memcpy (checkpoint->state_block + sizeof (nnet_ckpt_state_type),
+              checkpoint->positions,
+              checkpoint->nu_positions * sizeof (ElementIndex));
+
+      if (nu_best_weights > 0)
+        memcpy (checkpoint->state_block + sizeof (nnet_ckpt_state_type) +
+                checkpoint->nu_positions * sizeof (ElementIndex),
+                checkpoint->best->weights, nu_best_weights * sizeof (RValue));
+    }
+
+  /* The neighborhood width and learning rate decay during training */
+  if (checkpoint->nnet->extension != NULL &&
+      checkpoint->nnet->extension->index == NNEXT_SOM)
+    {
+      som_attr = (SomAttributes) checkpoint->nnet->extension->attr;
+      copy_attr = (SomAttributes) checkpoint->copy->extension->attr;
+
+      memcpy (copy_attr->ngb_function->function->parameters,
+              som_attr->ngb_function->function->parameters,
+              som_attr->ngb_function->function->function_class->
+              nu_parameters * sizeof (RValue));
+      memcpy (copy_attr->lrate_function->parameters,
+              som_attr->lrate_function->parameters,
+              som_attr->lrate_function->function_class->nu_parameters *
+              sizeof (RValue));
+    }
+
+  /* Writes in the background */
+  exit_status = pthread_create (&(checkpoint->thread), NULL,
+                                nnet_ckpt_write, checkpoint);
+
+  if (exit_status != 0)
+    {
+      fprintf (stderr, "nnet_ckpt_save: error creating thread: %s\n",
+               strerror (exit_status));
+      return EXIT_FAILURE;
+    }
+
+  checkpoint->writing = TRUE;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_ckpt_wait
+ *
+ * Waits for the pending checkpoint, if any, returning the status of the
+ * last write
+ */
+int
+nnet_ckpt_wait (NNetCheckpoint checkpoint)
+{
+  if (checkpoint == NULL)
+    {
+      fprintf (stderr, "nnet_ckpt_wait: no checkpoints passed\n");
+      return EXIT_FAILURE;
+    }
+
+  if (checkpoint->writing == TRUE)
+    {
+      pthread_join (checkpoint->thread, NULL);
+      checkpoint->writing = FALSE;
+    }
+
+  return checkpoint->status;
+}
+
+
+
+/*
+ * nnet_ckpt_resume_create
+ *
+ * Reads the training state of the given binary checkpoint
+ */
+NNetResume
+nnet_ckpt_resume_create (const NNetModel model)
+{
+  NNetResume new_resume = NULL; /* new training state */
+  const char *block = NULL;     /* training state block */
+  size_t block_size;            /* training state block size */
+  const nnet_ckpt_state_type *state;    /* state at the start of the block */
+
+
+  if (model == NULL)
+    {
+      fprintf (stderr, "nnet_ckpt_resume_create: no model passed\n");
+      return NULL;
+    }
+
+  block = (const char *) nnet_bin_state (model, &block_size);
+
+  if (block == NULL)
+    {
+      fprintf (stderr,
+               "nnet_ckpt_resume_create: model has no training state\n");
+      return NULL;
+    }
+
+  state = (const nnet_ckpt_state_type *) block;
+
+  if (block_size < sizeof (nnet_ckpt_state_type) ||
+      state->version != NNET_CKPT_STATE_VERSION ||
+      state->nu_positions > block_size / sizeof (ElementIndex) ||
+      state->nu_best_weights > block_size / sizeof (RValue) ||
+      block_size != sizeof (nnet_ckpt_state_type) +
+      state->nu_positions * sizeof (ElementIndex) +
+      state->nu_best_weights * sizeof (RValue))
+    {
+      fprintf (stderr,
+               "nnet_ckpt_resume_create: invalid training state block\n");
+      return NULL;
+    }
+
+  new_resume = (NNetResume) malloc (sizeof (nnet_ckpt_resume_type));
+
+  if (new_resume == NULL)
+    {
+      fprintf (stderr, "nnet_ckpt_resume_create: virtual memory exhausted\n");
+      return NULL;
+    }
+
+  memcpy (&(new_resume->state), state, sizeof (nnet_ckpt_state_type));
+  new_resume->positions = NULL;
+  new_resume->best_weights = NULL;
+
+  if (state->nu_positions > 0)
+    new_resume->positions = (ElementIndex *)
+      malloc (state->nu_positions * sizeof (ElementIndex));
+
+  if (state->nu_best_weights > 0)
+    new_resume->best_weights = (RValue *)
+      malloc (state->nu_best_weights * sizeof (RValue));
+
+  if ((state->nu_positions > 0 && new_resume->positions == NULL) ||
+      (state->nu_best_weights > 0 && new_resume->best_weights == NULL))
+    {
+      fprintf (stderr, "nnet_ckpt_resume_create: virtual memory exhausted\n");
+      nnet_ckpt_resume_destroy (&new_resume);
+      return NULL;
+    }
+
+  block += sizeof (nnet_ckpt_state_type);
+
+  if (state->nu_positions > 0)
+    memcpy (new_resume->positions, block,
+            state->nu_positions * sizeof (ElementIndex));
+
+  block += state->nu_positions * sizeof (ElementIndex);
+
+  if (state->nu_best_weights > 0)
+    memcpy (new_resume->best_weights, block,
+            state->nu_best_weights * sizeof (RValue));
+
+  return new_resume;
+}
+
+
+
+/*
+ * nnet_ckpt_resume_destroy
+ *
+ * Destroys a previously read training state
+ */
+int
+nnet_ckpt_resume_destroy (NNetResume * resume)
+{
+  if (resume == NULL || *resume == NULL)
+    {
+      fprintf (stderr, "nnet_ckpt_resume_destroy: no training state passed\n");
+      return EXIT_FAILURE;
+    }
+
+  free ((*resume)->positions);
+  free ((*resume)->best_weights);
+  free (*resume);
+
+  *resume = NULL;
+
+  return EXIT_SUCCESS;
+}
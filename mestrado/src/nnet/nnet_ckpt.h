@@ -0,0 +1,211 @@
+#ifndef __NNET_CKPT_H_
+#define __NNET_CKPT_H_ 1
+
+#include <pthread.h>
+#include "nnet_types.h"
+#include "nnet_codebook.h"
+#include "nnet_files_bin.h"
+
+
+/******************************************************************************
+ *                                                                            *
+ *                        PUBLIC DATATYPES AND VARIABLES                      *
+ *                                                                            *
+ ******************************************************************************/
+
+/* Suffix of the temporary file a checkpoint is written to */
+#define NNET_CKPT_TEMP_SUFFIX ".tmp"
+
+/* Training state block version */
+#define NNET_CKPT_STATE_VERSION 1
+
+
+
+/*
+ * nnet_ckpt_state_type
+ *
+ * Training state of a SOM training run, stored in binary checkpoints.
+ * Together with the exact weights of the model, it holds everything a
+ * resumed run needs to continue as if it was never interrupted: the next
+ * epoch (the learning rate and neighborhood width are functions of it),
+ * the options that shape the training trajectory, the early stopping
+ * state, and the initial order of the training set, whose shuffle
+ * depends on the state of rand (). The per-epoch training order and the
+ * stream chunk order are functions of the seed and the epoch only.
+ * Winner search indexes are rebuilt on resume, so batch runs using the
+ * approximate graph index may take a different path. The block holds
+ * this record followed by 'nu_positions' element positions (see
+ * nnet_tset_randomize_positions) and 'nu_best_weights' weights of the
+ * best validated output codebook.
+ */
+typedef struct
+{
+  UsLgIntValue version;         /* NNET_CKPT_STATE_VERSION */
+  UsLgIntValue time;            /* next epoch to train */
+  UsLgIntValue algorithm;       /* SOM training algorithm */
+  UsLgIntValue nu_threads;      /* batch training threads */
+  UsLgIntValue index_type;      /* winner search index */
+  UsLgIntValue index_rebuild;   /* index rebuild epochs */
+  UsLgIntValue step_decay;      /* decay after each element */
+  UsLgIntValue shuffle;         /* new training order each epoch */
+  UsLgIntValue shuffle_seed;    /* training order seed */
+  UsLgIntValue shuffle_block;   /* training order block size */
+  UsLgIntValue stream;          /* streamed input list */
+  UsLgIntValue stream_chunk;    /* elements read at a time */
+  UsLgIntValue validation_size; /* held out elements */
+  UsLgIntValue validation_epochs;       /* epochs between checks */
+  UsLgIntValue patience;        /* checks without improvement */
+  RValue min_improvement;       /* minimum relative improvement */
+  RValue best_error;            /* best validation error so far */
+  UsLgIntValue best_epoch;      /* epoch of the best error */
+  UsLgIntValue bad_checks;      /* checks since the last improvement */
+  UsLgIntValue nu_positions;    /* initial order of the training set */
+  UsLgIntValue nu_best_weights; /* best validated weights */
+}
+nnet_ckpt_state_type;
+
+
+
+/*
+ * nnet_ckpt_resume_type
+ *
+ * Training state read back from a binary checkpoint
+ */
+typedef struct
+{
+  nnet_ckpt_state_type state;   /* training state */
+  ElementIndex *positions;      /* initial order of the training set */
+  RValue *best_weights;         /* best validated weights */
+}
+nnet_ckpt_resume_type;
+
+
+/* Symbolic type */
+typedef nnet_ckpt_resume_type *NNetResume;
+
+
+
+/*
+ * nnet_ckpt_type
+ *
+ * Background checkpoints of a network under training.
+ * Saving a checkpoint only snapshots the input weights of each layer
+ * into dense codebooks (and the current SOM function parameters); a
+ * background thread then copies them into a private copy of the network,
+ * writes it to a temporary file and renames it over the checkpoint file,
+ * so an interrupted write never leaves a partial checkpoint behind. A new
+ * checkpoint waits for the previous one to be written. The structure of
+ * the network must not change while the checkpoints are in use.
+ * Binary checkpoints saved with a training state can be resumed exactly:
+ * the state block is built when the checkpoint is saved, from the given
+ * state, the initial order of the training set and the current contents
+ * of the best weights codebook, if registered.
+ */
+typedef struct
+{
+  NNetwork nnet;                /* network under training */
+  NNetwork copy;                /* private copy written to the files */
+  LayerIndex nu_layers;         /* number of layers */
+  Codebook *snapshots;          /* weights of each layer (NULL: no inputs) */
+  Codebook *copies;             /* same codebooks on the private copy */
+  BoolValue binary;             /* write binary models */
+  char *file_name;              /* checkpoint file being written */
+  char *temp_name;              /* temporary file being written */
+  pthread_t thread;             /* writing thread */
+  BoolValue writing;            /* the thread is running */
+  int status;                   /* status of the last write */
+  ElementIndex *positions;      /* initial order of the training set */
+  ElementIndex nu_positions;    /* training set size */
+  Codebook best;                /* best weights codebook (NULL: none) */
+  char *state_block;            /* training state block being written */
+  size_t state_size;            /* training state block size (0: none) */
+}
+nnet_ckpt_type;
+
+
+/* Symbolic type */
+typedef nnet_ckpt_type *NNetCheckpoint;
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                              PUBLIC OPERATIONS                             *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * nnet_ckpt_create
+ *
+ * Creates the checkpoints of the given network, written as text
+ * configuration files or as binary models
+ */
+extern NNetCheckpoint
+nnet_ckpt_create (const NNetwork nnet, const BoolValue binary);
+
+
+
+/*
+ * nnet_ckpt_destroy
+ *
+ * Waits for the pending checkpoint, if any, and destroys the checkpoints
+ */
+extern int nnet_ckpt_destroy (NNetCheckpoint * checkpoint);
+
+
+
+/*
+ * nnet_ckpt_set_training
+ *
+ * Registers the initial order of the training set and the codebook of the
+ * best validated weights (if any), saved with the training state
+ */
+extern int
+nnet_ckpt_set_training (NNetCheckpoint checkpoint,
+                        const ElementIndex * positions,
+                        const ElementIndex nu_positions, const Codebook best);
+
+
+
+/*
+ * nnet_ckpt_save
+ *
+ * Snapshots the current weights of the network and starts writing them to
+ * the given file in the background, with the given training state (if
+ * passed: binary checkpoints only)
+ */
+extern int
+nnet_ckpt_save (NNetCheckpoint checkpoint, const char *file_name,
+                const nnet_ckpt_state_type * state);
+
+
+
+/*
+ * nnet_ckpt_wait
+ *
+ * Waits for the pending checkpoint, if any, returning the status of the
+ * last write
+ */
+extern int nnet_ckpt_wait (NNetCheckpoint checkpoint);
+
+
+
+/*
+ * nnet_ckpt_resume_create
+ *
+ * Reads the training state of the given binary checkpoint
+ */
+extern NNetResume nnet_ckpt_resume_create (const NNetModel model);
+
+
+
+/*
+ * nnet_ckpt_resume_destroy
+ *
+ * Destroys a previously read training state
+ */
+extern int nnet_ckpt_resume_destroy (NNetResume * resume);
+
+
+
+#endif /* __NNET_CKPT_H_ */
@@ -0,0 +1,1451 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+#include "nnet_types.h"
+#include "nnet_actv.h"
+#include "nnet_codebook.h"
+#include "nnet_cbindex.h"
+
+/******************************************************************************
+ *                                                                            *
+ *                             PRIVATE OPERATIONS                             *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * nnet_cbook_job_type
+ *
+ * Work assigned to one thread of nnet_cbook_winners: a range of elements
+ * and the positions of the winners vector it fills
+ */
+typedef struct
+{
+  Codebook codebook;            /* shared codebook (read only) */
+  VectorMetric metric;          /* competition metric */
+  TElement *elements;           /* shared array of elements */
+  ElementIndex first;           /* first element of the range */
+  ElementIndex last;            /* one past the last element of the range */
+  RValue *winners;              /* winners vector values (may be NULL) */
+  CodebookErrorFunction error_function;     /* winner error (may be NULL) */
+  void *error_data;             /* error function data */
+  RValue error;                 /* sum of the errors of the range */
+  int exit_status;              /* job return status */
+}
+nnet_cbook_job_type;
+
+
+
+/*
+ * nnet_cbook_winners_worker
+ *
+ * Determines the winners of one range of elements, adding up their errors
+ */
+static void *
+nnet_cbook_winners_worker (void *job_ptr)
+{
+  nnet_cbook_job_type *job;     /* this thread's job */
+  CodebookIndexScratch scratch = NULL;  /* index search working memory */
+  ElementIndex cur_element;     /* current element */
+  UnitIndex winner;             /* winner row */
+  BoolValue track;              /* flag: track the previous winner */
+  int exit_status = EXIT_SUCCESS;       /* auxiliary function return status */
+
+
+  job = (nnet_cbook_job_type *) job_ptr;
+  job->exit_status = EXIT_SUCCESS;
+
+  if (job->codebook->index != NULL &&
+      (scratch = nnet_cbidx_scratch_create (job->codebook->index)) == NULL)
+    {
+      job->exit_status = EXIT_FAILURE;
+      return job_ptr;
+    }
+
+  track = (job->codebook->grid != NULL &&
+           job->metric == VECTOR_METR_EUCLIDEAN) ? TRUE : FALSE;
+
+  /* no previous winner at the start of the range */
+  winner = job->codebook->nu_units;
+
+  for (cur_element = job->first; cur_element < job->last; cur_element++)
+    {
+      if (track == TRUE)
+        exit_status = nnet_cbook_track
+          (job->codebook, job->elements[cur_element]->input->value, winner,
+           &winner, NULL, NULL);
+      else
+        exit_status = nnet_cbook_winner
+          (job->codebook, job->elements[cur_element]->input->value,
+           job->metric, scratch, &winner, NULL);
+
+      if (exit_status != EXIT_SUCCESS)
+        {
+          job->exit_status = EXIT_FAILURE;
+          break;
+        }
+
+      if (job->winners != NULL)
+        job->winners[cur_element] =
+          (RValue) nnet_cbook_unit_index (job->codebook, winner);
+
+      if (job->error_function != NULL)
+        job->error += job->error_function
+          (job->codebook, winner, job->elements[cur_element],
+           job->error_data);
+    }
+
+  if (scratch != NULL)
+    nnet_cbidx_scratch_destroy (&scratch);
+
+  return job_ptr;
+}
+
+
+
+/*
+ * nnet_cbook_partial_distance
+ *
+ * Accumulates the squared euclidean distance between the input values and
+ * one row, visiting the columns in the codebook order. The sum is checked
+ * against the bound after each block of NNET_CBOOK_PDS_BLOCK columns,
+ * whose differences are independent and can be computed side by side, and
+ * the accumulation stops as soon as it exceeds the bound. Returns the
+ * (partial) sum and adds the number of squared differences computed to
+ * 'components'.
+ */
+static RValue
+nnet_cbook_partial_distance (const Codebook codebook, const RValue * input,
+                             const UnitIndex row, const RValue bound,
+                             UsLgIntValue * components)
+{
+  const RValue *weight;         /* row weights */
+  const UnitIndex *col;         /* columns in visiting order */
+  UnitIndex dimension;          /* number of columns */
+  UnitIndex cur_pos = 0;        /* current position in the column order */
+  RValue d0, d1, d2, d3;        /* block differences */
+  RValue sum = 0.0;             /* sum of squared differences */
+
+
+  weight = nnet_cbook_row (codebook, row);
+  col = codebook->order;
+  dimension = codebook->dimension;
+
+  /* full blocks */
+  while (cur_pos + NNET_CBOOK_PDS_BLOCK <= dimension)
+    {
+      d0 = input[col[cur_pos]] - weight[col[cur_pos]];
+      d1 = input[col[cur_pos + 1]] - weight[col[cur_pos + 1]];
+      d2 = input[col[cur_pos + 2]] - weight[col[cur_pos + 2]];
+      d3 = input[col[cur_pos + 3]] - weight[col[cur_pos + 3]];
+      sum += (d0 * d0 + d1 * d1) + (d2 * d2 + d3 * d3);
+      cur_pos += NNET_CBOOK_PDS_BLOCK;
+
+      if (sum > bound)
+        {
+          *components += cur_pos;
+          return sum;
+        }
+    }
+
+  /* remaining columns */
+  while (cur_pos < dimension)
+    {
+      d0 = input[col[cur_pos]] - weight[col[cur_pos]];
+      sum += d0 * d0;
+      ++cur_pos;
+    }
+
+  *components += cur_pos;
+
+  return sum;
+}
+
+
+
+/*
+ * nnet_cbook_activation
+ *
+ * Returns the activation the unit of the given row would have for the
+ * given input values: the euclidean distance or the inner product between
+ * the input and the row
+ */
+static RValue
+nnet_cbook_activation (const Codebook codebook, const UnitIndex row,
+                       const RValue * input, const VectorMetric metric)
+{
+  const RValue *weight;         /* row weights */
+  RValue activation = 0.0;      /* unit activation */
+  RValue diff;                  /* component difference */
+  UnitIndex cur_col;            /* current column */
+
+
+  weight = nnet_cbook_row (codebook, row);
+
+  /* Same activation nnet_unit_vector_activation would compute */
+  switch (metric)
+    {
+    case VECTOR_METR_EUCLIDEAN:
+      for (cur_col = 0; cur_col < codebook->dimension; cur_col++)
+        {
+          diff = input[cur_col] - weight[cur_col];
+          activation += diff * diff;
+        }
+      activation = sqrt (activation);
+      break;
+
+    case VECTOR_METR_INNER_PRODUCT:
+      for (cur_col = 0; cur_col < codebook->dimension; cur_col++)
+        activation += input[cur_col] * weight[cur_col];
+      break;
+    }
+
+  return activation;
+}
+
+
+
+/*
+ * nnet_cbook_run
+ *
+ * Determines the winner of every element of the given set, splitting the
+ * elements in contiguous ranges among the given number of threads. The
+ * winners are stored in 'winners' and the errors of the winners are added
+ * to 'error', when passed.
+ */
+static int
+nnet_cbook_run (const Codebook codebook, const TSet set,
+                const VectorMetric metric, const UsIntValue nu_threads,
+                RValue * winners, const CodebookErrorFunction error_function,
+                void *error_data, RValue * error)
+{
+  TElement *elements = NULL;    /* elements by position */
+  TElement cur_element = NULL;  /* current element */
+  ElementIndex cur_index;       /* current element position */
+  nnet_cbook_job_type *jobs = NULL;     /* thread jobs */
+  pthread_t *threads = NULL;    /* worker threads */
+  UsIntValue nu_jobs;           /* number of jobs actually used */
+  UsIntValue nu_started;        /* number of threads actually started */
+  UsIntValue cur_job;           /* current job */
+  int exit_status = EXIT_SUCCESS;       /* function return status */
+
+
+  /* Checks the number of threads */
+  if (nu_threads == 0)
+    {
+      fprintf (stderr, "nnet_cbook_run: at least one thread is required\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Trivial case */
+  if (set->nu_elements == 0)
+    return EXIT_SUCCESS;
+
+  /* Allocates the workspace */
+  nu_jobs = nu_threads;
+  if ((ElementIndex) nu_jobs > set->nu_elements)
+    nu_jobs = (UsIntValue) set->nu_elements;
+
+  elements = (TElement *) malloc (set->nu_elements * sizeof (TElement));
+  jobs = (nnet_cbook_job_type *) malloc (nu_jobs * sizeof (nnet_cbook_job_type));
+  threads = (pthread_t *) malloc (nu_jobs * sizeof (pthread_t));
+
+  if (elements == NULL || jobs == NULL || threads == NULL)
+    {
+      fprintf (stderr, "nnet_cbook_run: virtual memory exhausted\n");
+      free (elements);
+      free (jobs);
+      free (threads);
+      return EXIT_FAILURE;
+    }
+
+  /* Indexes the elements, checking their dimensions */
+  cur_element = set->first_element;
+  cur_index = 0;
+
+  while (cur_element != NULL && cur_index < set->nu_elements)
+    {
+      if (cur_element->input == NULL ||
+          cur_element->input->dimension != codebook->dimension)
+        {
+          fprintf (stderr,
+                   "nnet_cbook_run: element %ld has incompatible input dimension\n",
+                   cur_element->element_index);
+          exit_status = EXIT_FAILURE;
+          break;
+        }
+
+      elements[cur_index++] = cur_element;
+      cur_element = cur_element->next;
+    }
+
+  if (exit_status == EXIT_SUCCESS && cur_index != set->nu_elements)
+    {
+      fprintf (stderr,
+               "nnet_cbook_run: set has less elements than expected\n");
+      exit_status = EXIT_FAILURE;
+    }
+
+  /* Splits the elements in contiguous ranges, one per job */
+  for (cur_job = 0; cur_job < nu_jobs; cur_job++)
+    {
+      jobs[cur_job].codebook = codebook;
+      jobs[cur_job].metric = metric;
+      jobs[cur_job].elements = elements;
+      jobs[cur_job].first = set->nu_elements * cur_job / nu_jobs;
+      jobs[cur_job].last = set->nu_elements * (cur_job + 1) / nu_jobs;
+      jobs[cur_job].winners = winners;
+      jobs[cur_job].error_function = error_function;
+      jobs[cur_job].error_data = error_data;
+      jobs[cur_job].error = 0.0;
+      jobs[cur_job].exit_status = EXIT_SUCCESS;
+    }
+
+  /* Runs the jobs: the single one on the calling thread */
+  if (exit_status == EXIT_SUCCESS)
+    {
+      if (nu_jobs == 1)
+        {
+          nnet_cbook_winners_worker (&jobs[0]);
+        }
+      else
+        {
+          for (nu_started = 0; nu_started < nu_jobs; nu_started++)
+            if (pthread_create
+                (&threads[nu_started], NULL, nnet_cbook_winners_worker,
+                 &jobs[nu_started]) != 0)
+              break;
+
+          for (cur_job = 0; cur_job < nu_started; cur_job++)
+            pthread_join (threads[cur_job], NULL);
+
+          if (nu_started < nu_jobs)
+            {
+              fprintf (stderr,
+                       "nnet_cbook_run: error creating worker thread %d\n",
+                       nu_started);
+              exit_status = EXIT_FAILURE;
+            }
+        }
+
+      for (cur_job = 0; cur_job < nu_jobs; cur_job++)
+        if (jobs[cur_job].exit_status != EXIT_SUCCESS)
+          exit_status = EXIT_FAILURE;
+    }
+
+  /* Adds up the errors of the ranges in set order */
+  if (exit_status == EXIT_SUCCESS && error != NULL)
+    for (cur_job = 0; cur_job < nu_jobs; cur_job++)
+      *error += jobs[cur_job].error;
+
+  free (elements);
+  free (jobs);
+  free (threads);
+
+  return exit_status;
+}
+
+
+
+/*
+ * nnet_cbook_column_type
+ *
+ * Column and expected squared difference pair, used to sort the columns
+ */
+typedef struct
+{
+  RValue spread;
+  UnitIndex column;
+}
+nnet_cbook_column_type;
+
+
+
+/*
+ * nnet_cbook_column_compare
+ *
+ * Orders columns by decreasing spread, then by increasing index
+ */
+static int
+nnet_cbook_column_compare (const void *p1, const void *p2)
+{
+  const nnet_cbook_column_type *a = (const nnet_cbook_column_type *) p1;
+  const nnet_cbook_column_type *b = (const nnet_cbook_column_type *) p2;
+
+  if (a->spread > b->spread)
+    return -1;
+  if (a->spread < b->spread)
+    return 1;
+  if (a->column < b->column)
+    return -1;
+  if (a->column > b->column)
+    return 1;
+  return 0;
+}
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                            STRUCTURAL OPERATIONS                           *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * nnet_cbook_create
+ *
+ * Creates a new codebook for the given layer, loading the current weights
+ * of its units
+ */
+Codebook
+nnet_cbook_create (const Layer layer)
+{
+  Codebook new_codebook = NULL; /* new codebook */
+  Unit cur_unit = NULL;         /* current layer unit */
+  UnitIndex cur_row;            /* current codebook row */
+  UnitIndex cur_col;            /* current codebook column */
+
+
+  /* Checks if the layer was actually passed */
+  if (layer == NULL)
+    {
+      fprintf (stderr, "nnet_cbook_create: no layer passed\n");
+      return NULL;
+    }
+
+  /* Checks if the layer has units */
+  if (layer->nu_units == 0 || layer->first_unit == NULL)
+    {
+      fprintf (stderr, "nnet_cbook_create: layer has no units\n");
+      return NULL;
+    }
+
+  /* Allocates the new codebook */
+  new_codebook = (Codebook) malloc (sizeof (nnet_codebook_type));
+
+  if (new_codebook == NULL)
+    {
+      fprintf (stderr, "nnet_cbook_create: virtual memory exhausted\n");
+      return NULL;
+    }
+
+  new_codebook->layer = layer;
+  new_codebook->nu_units = layer->nu_units;
+  new_codebook->dimension = layer->first_unit->nu_inputs;
+  new_codebook->index = NULL;
+  new_codebook->grid_degree = 0;
+  new_codebook->grid = NULL;
+  new_codebook->order = NULL;
+  new_codebook->mapped = FALSE;
+
+  /* Checks if the units have inputs */
+  if (new_codebook->dimension == 0)
+    {
+      fprintf (stderr, "nnet_cbook_create: layer units have no inputs\n");
+      free (new_codebook);
+      return NULL;
+    }
+
+  /* Allocates the unit pointers and the weights matrix */
+  new_codebook->units =
+    (Unit *) malloc (new_codebook->nu_units * sizeof (Unit));
+
+  new_codebook->weights = (RValue *)
+    malloc (new_codebook->nu_units * new_codebook->dimension *
+            sizeof (RValue));
+
+  if (new_codebook->units == NULL || new_codebook->weights == NULL)
+    {
+      fprintf (stderr, "nnet_cbook_create: virtual memory exhausted\n");
+      free (new_codebook->units);
+      free (new_codebook->weights);
+      free (new_codebook);
+      return NULL;
+    }
+
+  /* Indexes the layer units by row */
+  cur_unit = layer->first_unit;
+  cur_row = 0;
+
+  while (cur_unit != NULL && cur_row < new_codebook->nu_units)
+    {
+      new_codebook->units[cur_row] = cur_unit;
+      cur_unit = cur_unit->next;
+      ++cur_row;
+    }
+
+  if (cur_unit != NULL || cur_row != new_codebook->nu_units)
+    {
+      fprintf (stderr,
+               "nnet_cbook_create: layer unit count is inconsistent with its unit list\n");
+      nnet_cbook_destroy (&new_codebook);
+      return NULL;
+    }
+
+  /* Columns are visited in their natural order until told otherwise */
+  new_codebook->order = (UnitIndex *)
+    malloc (new_codebook->dimension * sizeof (UnitIndex));
+
+  if (new_codebook->order == NULL)
+    {
+      fprintf (stderr, "nnet_cbook_create: virtual memory exhausted\n");
+      nnet_cbook_destroy (&new_codebook);
+      return NULL;
+    }
+
+  for (cur_col = 0; cur_col < new_codebook->dimension; cur_col++)
+    new_codebook->order[cur_col] = cur_col;
+
+  /* Distances may replace outputs in euclidean competition */
+  new_codebook->monotone = nnet_cbook_is_monotone (new_codebook);
+
+  /* Loads the current weights */
+  if (nnet_cbook_load (new_codebook) != EXIT_SUCCESS)
+    {
+      fprintf (stderr, "nnet_cbook_create: error loading layer weights\n");
+      nnet_cbook_destroy (&new_codebook);
+      return NULL;
+    }
+
+  return new_codebook;
+}
+
+
+
+/*
+ * nnet_cbook_destroy
+ *
+ * Destroys a previously created codebook
+ */
+int
+nnet_cbook_destroy (Codebook * codebook)
+{
+  /* Checks if the codebook was actually passed */
+  if (codebook == NULL || *codebook == NULL)
+    {
+      fprintf (stderr, "nnet_cbook_destroy: no codebook to destroy\n");
+      return EXIT_FAILURE;
+    }
+
+  if ((*codebook)->mapped == FALSE)
+    free ((*codebook)->weights);
+
+  free ((*codebook)->units);
+  free ((*codebook)->grid);
+  free ((*codebook)->order);
+  free (*codebook);
+
+  /* Makes it point to NULL */
+  *codebook = NULL;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_cbook_load
+ *
+ * Copies the current weights of the layer units into the codebook
+ */
+int
+nnet_cbook_load (Codebook codebook)
+{
+  Connection cur_conn;          /* current input connection */
+  RValue *cur_weight;           /* current codebook position */
+  UnitIndex cur_row;            /* current codebook row */
+  UnitIndex cur_col;            /* current codebook column */
+
+
+  /* Checks if the codebook was actually passed */
+  if (codebook == NULL)
+    {
+      fprintf (stderr, "nnet_cbook_load: no codebook passed\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Mapped codebooks have no units to copy weights from or to */
+  if (codebook->units == NULL)
+    {
+      fprintf (stderr, "nnet_cbook_load: codebook has no units\n");
+      return EXIT_FAILURE;
+    }
+
+  for (cur_row = 0; cur_row < codebook->nu_units; cur_row++)
+    {
+      /* Checks dimensional compatibility */
+      if (codebook->units[cur_row]->nu_inputs != codebook->dimension)
+        {
+          fprintf (stderr,
+                   "nnet_cbook_load: unit %ld has %ld inputs while codebook has dimension %ld\n",
+                   codebook->units[cur_row]->unit_index,
+                   codebook->units[cur_row]->nu_inputs, codebook->dimension);
+          return EXIT_FAILURE;
+        }
+
+      /* Copies the input connection weights */
+      cur_weight = &(codebook->weights[cur_row * codebook->dimension]);
+      cur_conn = codebook->units[cur_row]->first_orig;
+
+      for (cur_col = 0; cur_col < codebook->dimension; cur_col++)
+        {
+          if (cur_conn == NULL)
+            {
+              fprintf (stderr,
+                       "nnet_cbook_load: unit %ld has %ld input connections while codebook has dimension %ld\n",
+                       codebook->units[cur_row]->unit_index, cur_col,
+                       codebook->dimension);
+              return EXIT_FAILURE;
+            }
+
+          cur_weight[cur_col] = cur_conn->weight;
+          cur_conn = cur_conn->next_orig;
+        }
+    }
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_cbook_store
+ *
+ * Copies the codebook rows back into the weights of the layer units
+ */
+int
+nnet_cbook_store (const Codebook codebook)
+{
+  Connection cur_conn;          /* current input connection */
+  RValue *cur_weight;           /* current codebook position */
+  UnitIndex cur_row;            /* current codebook row */
+  UnitIndex cur_col;            /* current codebook column */
+
+
+  /* Checks if the codebook was actually passed */
+  if (codebook == NULL)
+    {
+      fprintf (stderr, "nnet_cbook_store: no codebook passed\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Mapped codebooks have no units to copy weights from or to */
+  if (codebook->units == NULL)
+    {
+      fprintf (stderr, "nnet_cbook_store: codebook has no units\n");
+      return EXIT_FAILURE;
+    }
+
+  for (cur_row = 0; cur_row < codebook->nu_units; cur_row++)
+    {
+      cur_weight = &(codebook->weights[cur_row * codebook->dimension]);
+      cur_conn = codebook->units[cur_row]->first_orig;
+
+      for (cur_col = 0; cur_col < codebook->dimension && cur_conn != NULL;
+           cur_col++)
+        {
+          cur_conn->weight = cur_weight[cur_col];
+          cur_conn = cur_conn->next_orig;
+        }
+    }
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_cbook_set_grid
+ *
+ * Links each row to the 'degree' rows whose units are the closest ones in
+ * the layer's coordinate space, enabling winner tracking. A degree of 0
+ * disables it.
+ */
+int
+nnet_cbook_set_grid (Codebook codebook, const UnitIndex degree)
+{
+  Vector coord, other_coord;    /* unit coordinates */
+  RValue *distance = NULL;      /* grid distances to the current row */
+  UnitIndex cur_row, other;     /* rows */
+  UnitIndex cur_ngb;            /* current neighbor */
+  UnitIndex pos;                /* insertion position */
+  UnitIndex *ngb;               /* neighbors of the current row */
+  UsLgIntValue cur_comp;        /* current coordinate */
+  RValue diff, d;               /* grid distance */
+
+
+  /* Checks if the codebook was actually passed */
+  if (codebook == NULL)
+    {
+      fprintf (stderr, "nnet_cbook_set_grid: no codebook passed\n");
+      return EXIT_FAILURE;
+    }
+
+  free (codebook->grid);
+  codebook->grid = NULL;
+  codebook->grid_degree = 0;
+
+  if (degree == 0)
+    return EXIT_SUCCESS;
+
+  /* Tracking compares distances instead of outputs */
+  if (nnet_cbook_is_monotone (codebook) != TRUE)
+    {
+      fprintf (stderr,
+               "nnet_cbook_set_grid: units don't share an increasing activation function\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Checks the unit coordinates */
+  if (codebook->units == NULL)
+    {
+      fprintf (stderr, "nnet_cbook_set_grid: codebook has no units\n");
+      return EXIT_FAILURE;
+    }
+
+  coord = codebook->units[0]->coord;
+
+  for (cur_row = 0; cur_row < codebook->nu_units; cur_row++)
+    {
+      other_coord = codebook->units[cur_row]->coord;
+
+      if (other_coord == NULL || coord == NULL ||
+          other_coord->dimension != coord->dimension)
+        {
+          fprintf (stderr,
+                   "nnet_cbook_set_grid: unit %ld has no compatible coordinates\n",
+                   codebook->units[cur_row]->unit_index);
+          return EXIT_FAILURE;
+        }
+    }
+
+  /* A row can't have more neighbors than the other rows */
+  codebook->grid_degree =
+    degree < codebook->nu_units ? degree : codebook->nu_units - 1;
+
+  codebook->grid = (UnitIndex *)
+    malloc ((codebook->nu_units * codebook->grid_degree + 1) *
+            sizeof (UnitIndex));
+  distance = (RValue *)
+    malloc ((codebook->grid_degree + 1) * sizeof (RValue));
+
+  if (codebook->grid == NULL || distance == NULL)
+    {
+      fprintf (stderr, "nnet_cbook_set_grid: virtual memory exhausted\n");
+      free (codebook->grid);
+      free (distance);
+      codebook->grid = NULL;
+      codebook->grid_degree = 0;
+      return EXIT_FAILURE;
+    }
+
+  for (cur_row = 0; cur_row < codebook->nu_units; cur_row++)
+    {
+      coord = codebook->units[cur_row]->coord;
+      ngb = &(codebook->grid[cur_row * codebook->grid_degree]);
+      cur_ngb = 0;
+
+      /* keeps the closest rows sorted by grid distance */
+      for (other = 0; other < codebook->nu_units; other++)
+        {
+          if (other == cur_row)
+            continue;
+
+          other_coord = codebook->units[other]->coord;
+          d = 0.0;
+
+          for (cur_comp = 0; cur_comp < coord->dimension; cur_comp++)
+            {
+              diff = coord->value[cur_comp] - other_coord->value[cur_comp];
+              d += diff * diff;
+            }
+
+          if (cur_ngb == codebook->grid_degree &&
+              d >= distance[cur_ngb - 1])
+            continue;
+
+          pos = (cur_ngb < codebook->grid_degree) ? cur_ngb++ : cur_ngb - 1;
+
+          while (pos > 0 && distance[pos - 1] > d)
+            {
+              distance[pos] = distance[pos - 1];
+              ngb[pos] = ngb[pos - 1];
+              --pos;
+            }
+
+          distance[pos] = d;
+          ngb[pos] = other;
+        }
+    }
+
+  free (distance);
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_cbook_set_order
+ *
+ * Sorts the columns visited by the partial distance searches by decreasing
+ * expected squared difference between an input and a row, so that the
+ * searches give up on losing rows as early as possible. For column 'c',
+ * it is the input variance plus the mean squared difference between the
+ * input average and the rows, taken from the given input statistics (or
+ * the column spread around its mean, without them).
+ */
+int
+nnet_cbook_set_order (Codebook codebook, const VectorStats stats)
+{
+  nnet_cbook_column_type *columns;      /* columns to sort */
+  RValue center;                /* column center */
+  RValue diff;                  /* difference to the center */
+  UnitIndex cur_col;            /* current column */
+  UnitIndex cur_row;            /* current row */
+
+
+  /* Checks if the codebook was actually passed */
+  if (codebook == NULL)
+    {
+      fprintf (stderr, "nnet_cbook_set_order: no codebook passed\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Checks the statistics dimension */
+  if (stats != NULL && (stats->dimension != codebook->dimension ||
+                        stats->average == NULL || stats->variance == NULL))
+    {
+      fprintf (stderr,
+               "nnet_cbook_set_order: statistics incompatible with codebook dimension %ld\n",
+               codebook->dimension);
+      return EXIT_FAILURE;
+    }
+
+  columns = (nnet_cbook_column_type *)
+    malloc (codebook->dimension * sizeof (nnet_cbook_column_type));
+
+  if (columns == NULL)
+    {
+      fprintf (stderr, "nnet_cbook_set_order: virtual memory exhausted\n");
+      return EXIT_FAILURE;
+    }
+
+  for (cur_col = 0; cur_col < codebook->dimension; cur_col++)
+    {
+      columns[cur_col].column = cur_col;
+      columns[cur_col].spread = 0.0;
+
+      /* input average, or the rows mean */
+      if (stats != NULL)
+        center = stats->average->value[cur_col];
+      else
+        {
+          center = 0.0;
+          for (cur_row = 0; cur_row < codebook->nu_units; cur_row++)
+            center += nnet_cbook_row (codebook, cur_row)[cur_col];
+          center /= (RValue) codebook->nu_units;
+        }
+
+      for (cur_row = 0; cur_row < codebook->nu_units; cur_row++)
+        {
+          diff = center - nnet_cbook_row (codebook, cur_row)[cur_col];
+          columns[cur_col].spread += diff * diff;
+        }
+
+      columns[cur_col].spread /= (RValue) codebook->nu_units;
+
+      if (stats != NULL)
+        columns[cur_col].spread += stats->variance->value[cur_col];
+    }
+
+  qsort (columns, codebook->dimension, sizeof (nnet_cbook_column_type),
+         nnet_cbook_column_compare);
+
+  for (cur_col = 0; cur_col < codebook->dimension; cur_col++)
+    codebook->order[cur_col] = columns[cur_col].column;
+
+  free (columns);
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                            FUNCTIONAL OPERATIONS                           *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * nnet_cbook_row
+ *
+ * Returns a pointer to the weights of the given codebook row
+ */
+RValue *
+nnet_cbook_row (const Codebook codebook, const UnitIndex row)
+{
+  return &(codebook->weights[row * codebook->dimension]);
+}
+
+
+
+/*
+ * nnet_cbook_output
+ *
+ * Returns the output the unit of the given row would have for the given
+ * input values, without changing the unit's activation or output
+ */
+RValue
+nnet_cbook_output (const Codebook codebook, const UnitIndex row,
+                   const RValue * input, const VectorMetric metric)
+{
+  return nnet_cbook_row_output
+    (codebook, row, nnet_cbook_activation (codebook, row, input, metric));
+}
+
+
+
+/*
+ * nnet_cbook_unit_index
+ *
+ * Returns the index of the unit of the given row
+ */
+UnitIndex
+nnet_cbook_unit_index (const Codebook codebook, const UnitIndex row)
+{
+  if (codebook->units == NULL)
+    return row + 1;
+
+  return codebook->units[row]->unit_index;
+}
+
+
+
+/*
+ * nnet_cbook_row_output
+ *
+ * Returns the output the unit of the given row gives for the given
+ * activation
+ */
+RValue
+nnet_cbook_row_output (const Codebook codebook, const UnitIndex row,
+                       const RValue activation)
+{
+  if (codebook->units == NULL)
+    return activation;
+
+  return nnet_actv_value (codebook->units[row]->activation_function,
+                          activation);
+}
+
+
+
+/*
+ * nnet_cbook_is_monotone
+ *
+ * Checks if all units share the same increasing activation function, so
+ * that the smallest distance also gives the smallest output
+ */
+BoolValue
+nnet_cbook_is_monotone (const Codebook codebook)
+{
+  ActivationFunction f;         /* current unit activation function */
+  RValue f0, f1;                /* first unit's function at 0 and 1 */
+  UnitIndex cur_row;            /* current row */
+
+
+  /* Mapped codebooks keep the property of the units they came from */
+  if (codebook->units == NULL)
+    return codebook->monotone;
+
+  f = codebook->units[0]->activation_function;
+  f0 = nnet_actv_value (f, 0.0);
+  f1 = nnet_actv_value (f, 1.0);
+
+  if (f1 <= f0)
+    return FALSE;
+
+  for (cur_row = 1; cur_row < codebook->nu_units; cur_row++)
+    {
+      f = codebook->units[cur_row]->activation_function;
+
+      if (nnet_actv_value (f, 0.0) != f0 || nnet_actv_value (f, 1.0) != f1)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+
+
+/*
+ * nnet_cbook_scan
+ *
+ * Determines the row of the winner unit for the given input values by
+ * scanning all rows, with the same criterion used by
+ * nnet_metr_layer_winner: smallest output for euclidean distances and
+ * largest output for inner products. If the activation is increasing,
+ * euclidean distances are compared directly and each row is abandoned as
+ * soon as its partial distance exceeds the winner's.
+ */
+int
+nnet_cbook_scan (const Codebook codebook, const RValue * input,
+                 const VectorMetric metric, UnitIndex * winner,
+                 RValue * winner_output)
+{
+  UnitIndex cur_row;            /* current codebook row */
+  UnitIndex best_row;           /* current winner row */
+  RValue cur_output;            /* current unit output */
+  RValue best_output;           /* current winner output */
+  UsLgIntValue components = 0;  /* squared differences computed */
+
+
+  /* Checks if the codebook was actually passed */
+  if (codebook == NULL)
+    {
+      fprintf (stderr, "nnet_cbook_scan: no codebook passed\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Checks the metric */
+  if (metric != VECTOR_METR_EUCLIDEAN && metric != VECTOR_METR_INNER_PRODUCT)
+    {
+      fprintf (stderr, "nnet_cbook_scan: unknown vector metrics\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Euclidean competition over distances, with early termination */
+  if (metric == VECTOR_METR_EUCLIDEAN && codebook->monotone == TRUE)
+    {
+      best_row = 0;
+      best_output = nnet_cbook_partial_distance
+        (codebook, input, 0, HUGE_VAL, &components);
+
+      for (cur_row = 1; cur_row < codebook->nu_units; cur_row++)
+        {
+          cur_output = nnet_cbook_partial_distance
+            (codebook, input, cur_row, best_output, &components);
+
+          if (cur_output < best_output)
+            {
+              best_row = cur_row;
+              best_output = cur_output;
+            }
+        }
+
+      *winner = best_row;
+
+      if (winner_output != NULL)
+        *winner_output =
+          nnet_cbook_row_output (codebook, best_row, sqrt (best_output));
+
+      return EXIT_SUCCESS;
+    }
+
+  /* First unit is the initial winner */
+  best_row = 0;
+  best_output = nnet_cbook_output (codebook, 0, input, metric);
+
+  /* Search for the winner in the remaining rows */
+  for (cur_row = 1; cur_row < codebook->nu_units; cur_row++)
+    {
+      cur_output = nnet_cbook_output (codebook, cur_row, input, metric);
+
+      if ((metric == VECTOR_METR_EUCLIDEAN && cur_output < best_output) ||
+          (metric == VECTOR_METR_INNER_PRODUCT && cur_output > best_output))
+        {
+          best_row = cur_row;
+          best_output = cur_output;
+        }
+    }
+
+  *winner = best_row;
+
+  if (winner_output != NULL)
+    *winner_output = best_output;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_cbook_scan_2
+ *
+ * Determines the rows of the winner and of the 2nd place units for the
+ * given input values in a single scan of all rows, returning their
+ * activations: euclidean distances or inner products. The units are
+ * ranked by their outputs, as in nnet_cbook_scan; if the activation is
+ * increasing, euclidean distances are compared directly and each row is
+ * abandoned as soon as its partial distance exceeds the 2nd place's.
+ * With a single row, 'winner2' is set to the number of rows.
+ */
+int
+nnet_cbook_scan_2 (const Codebook codebook, const RValue * input,
+                   const VectorMetric metric,
+                   UnitIndex * winner1, RValue * activation1,
+                   UnitIndex * winner2, RValue * activation2)
+{
+  UnitIndex cur_row;            /* current codebook row */
+  UnitIndex row1, row2;         /* current winner and 2nd place rows */
+  RValue cur_value;             /* current row ranking value */
+  RValue value1, value2;        /* winner and 2nd place ranking values */
+  RValue cur_actv;              /* current row activation */
+  RValue actv1, actv2;          /* winner and 2nd place activations */
+  BoolValue distances;          /* flag: rank by squared distances */
+  UsLgIntValue components = 0;  /* squared differences computed */
+
+
+  /* Checks if the codebook was actually passed */
+  if (codebook == NULL)
+    {
+      fprintf (stderr, "nnet_cbook_scan_2: no codebook passed\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Checks the metric */
+  if (metric != VECTOR_METR_EUCLIDEAN && metric != VECTOR_METR_INNER_PRODUCT)
+    {
+      fprintf (stderr, "nnet_cbook_scan_2: unknown vector metrics\n");
+      return EXIT_FAILURE;
+    }
+
+  distances = (metric == VECTOR_METR_EUCLIDEAN && codebook->monotone == TRUE)
+    ? TRUE : FALSE;
+
+  /* No rows ranked yet: the 2nd place bound is open */
+  row1 = row2 = codebook->nu_units;
+  value1 = value2 = (metric == VECTOR_METR_EUCLIDEAN) ? HUGE_VAL : -HUGE_VAL;
+  actv1 = actv2 = 0.0;
+
+  for (cur_row = 0; cur_row < codebook->nu_units; cur_row++)
+    {
+      /* Ranking value: squared distance or unit output */
+      if (distances == TRUE)
+        {
+          cur_value = nnet_cbook_partial_distance
+            (codebook, input, cur_row, value2, &components);
+
+          if (cur_value >= value2)
+            continue;
+
+          cur_actv = sqrt (cur_value);
+        }
+      else
+        {
+          cur_actv = nnet_cbook_activation (codebook, cur_row, input, metric);
+          cur_value = nnet_cbook_row_output (codebook, cur_row, cur_actv);
+
+          if ((metric == VECTOR_METR_EUCLIDEAN && cur_value >= value2) ||
+              (metric == VECTOR_METR_INNER_PRODUCT && cur_value <= value2))
+            continue;
+        }
+
+      /* The row beats the 2nd place: it may beat the winner too */
+      if ((metric == VECTOR_METR_EUCLIDEAN && cur_value < value1) ||
+          (metric == VECTOR_METR_INNER_PRODUCT && cur_value > value1))
+        {
+          row2 = row1;
+          value2 = value1;
+          actv2 = actv1;
+          row1 = cur_row;
+          value1 = cur_value;
+          actv1 = cur_actv;
+        }
+      else
+        {
+          row2 = cur_row;
+          value2 = cur_value;
+          actv2 = cur_actv;
+        }
+    }
+
+  *winner1 = row1;
+  *winner2 = row2;
+
+  if (activation1 != NULL)
+    *activation1 = actv1;
+
+  if (activation2 != NULL)
+    *activation2 = actv2;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_cbook_winner
+ *
+ * Determines the row of the winner unit for the given input values,
+ * through the attached search index for euclidean metrics or by scanning
+ * all rows otherwise. Index searches use the calling thread's working
+ * memory, or their own if it is NULL.
+ * Does not change any field of the network, so it is safe to call it
+ * concurrently over the same codebook.
+ */
+int
+nnet_cbook_winner (const Codebook codebook, const RValue * input,
+                   const VectorMetric metric, CodebookScratchPtr scratch,
+                   UnitIndex * winner, RValue * winner_output)
+{
+  /* Checks if the codebook was actually passed */
+  if (codebook == NULL)
+    {
+      fprintf (stderr, "nnet_cbook_winner: no codebook passed\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Indexed search */
+  if (codebook->index != NULL && metric == VECTOR_METR_EUCLIDEAN)
+    return nnet_cbidx_winner (codebook->index, codebook, input, scratch,
+                              winner, winner_output, NULL);
+
+  return nnet_cbook_scan (codebook, input, metric, winner, winner_output);
+}
+
+
+
+/*
+ * nnet_cbook_track
+ *
+ * Determines the euclidean winner row for the given input values knowing
+ * the winner of the previous frame (or none, if 'previous' is not a valid
+ * row). The previous winner and its grid neighbors are evaluated first,
+ * and their best distance bounds a partial distance scan of the other
+ * rows.
+ */
+int
+nnet_cbook_track (const Codebook codebook, const RValue * input,
+                  const UnitIndex previous, UnitIndex * winner,
+                  RValue * winner_output, UsLgIntValue * components)
+{
+  UsLgIntValue nu_components = 0;       /* squared differences computed */
+  const UnitIndex *seeds = NULL;        /* previous winner's neighbors */
+  UnitIndex nu_seeds = 0;       /* number of neighbors */
+  UnitIndex cur_seed;           /* current neighbor */
+  UnitIndex cur_row;            /* current row */
+  UnitIndex best_row;           /* current winner row */
+  RValue best_sum;              /* current winner squared distance */
+  RValue sum;                   /* current row squared distance */
+
+
+  /* Checks the parameters */
+  if (codebook == NULL || input == NULL)
+    {
+      fprintf (stderr, "nnet_cbook_track: missing codebook or input\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Without a previous winner, the first row sets the initial bound */
+  best_row = previous < codebook->nu_units ? previous : 0;
+  best_sum = nnet_cbook_partial_distance
+    (codebook, input, best_row, HUGE_VAL, &nu_components);
+
+  /* Previous winner's grid neighborhood */
+  if (previous < codebook->nu_units && codebook->grid != NULL)
+    {
+      seeds = &(codebook->grid[previous * codebook->grid_degree]);
+      nu_seeds = codebook->grid_degree;
+    }
+
+  for (cur_seed = 0; cur_seed < nu_seeds; cur_seed++)
+    {
+      cur_row = seeds[cur_seed];
+      sum = nnet_cbook_partial_distance
+        (codebook, input, cur_row, best_sum, &nu_components);
+
+      if (sum < best_sum || (sum == best_sum && cur_row < best_row))
+        {
+          best_row = cur_row;
+          best_sum = sum;
+        }
+    }
+
+  /* Bounded scan of the remaining rows */
+  for (cur_row = 0; cur_row < codebook->nu_units; cur_row++)
+    {
+      if (cur_row == previous || (previous >= codebook->nu_units &&
+                                  cur_row == 0))
+        continue;
+
+      for (cur_seed = 0; cur_seed < nu_seeds; cur_seed++)
+        if (seeds[cur_seed] == cur_row)
+          break;
+
+      if (cur_seed < nu_seeds)
+        continue;
+
+      sum = nnet_cbook_partial_distance
+        (codebook, input, cur_row, best_sum, &nu_components);
+
+      if (sum < best_sum || (sum == best_sum && cur_row < best_row))
+        {
+          best_row = cur_row;
+          best_sum = sum;
+        }
+    }
+
+  *winner = best_row;
+
+  if (winner_output != NULL)
+    *winner_output =
+      nnet_cbook_row_output (codebook, best_row, sqrt (best_sum));
+
+  if (components != NULL)
+    *components += nu_components;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_cbook_track_cost
+ *
+ * Tracks the winners of the elements of the given set in order, returning
+ * the mean number of full distance computations they cost
+ */
+int
+nnet_cbook_track_cost (const Codebook codebook, const TSet set,
+                       RValue * mean_distances)
+{
+  TElement cur_element;         /* current element */
+  UsLgIntValue components = 0;  /* squared differences computed */
+  UnitIndex winner;             /* current winner row */
+
+
+  /* Checks the parameters */
+  if (codebook == NULL || set == NULL)
+    {
+      fprintf (stderr, "nnet_cbook_track_cost: missing codebook or set\n");
+      return EXIT_FAILURE;
+    }
+
+  *mean_distances = 0.0;
+
+  if (set->nu_elements == 0)
+    return EXIT_SUCCESS;
+
+  /* no previous winner for the first element */
+  winner = codebook->nu_units;
+
+  for (cur_element = set->first_element; cur_element != NULL;
+       cur_element = cur_element->next)
+    {
+      if (cur_element->input->dimension != codebook->dimension)
+        {
+          fprintf (stderr,
+                   "nnet_cbook_track_cost: element %ld has incompatible input dimension\n",
+                   cur_element->element_index);
+          return EXIT_FAILURE;
+        }
+
+      if (nnet_cbook_track (codebook, cur_element->input->value, winner,
+                            &winner, NULL, &components) != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+    }
+
+  *mean_distances = (RValue) components /
+    ((RValue) codebook->dimension * (RValue) set->nu_elements);
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_cbook_winners
+ *
+ * Determines the winner of every element of the given set, splitting the
+ * elements among the given number of threads, and stores the index of
+ * each winner unit in the corresponding component of the winners vector.
+ * The layer units are never touched, so the same network may be used by
+ * several callers at once.
+ */
+int
+nnet_cbook_winners (const Codebook codebook, const TSet set,
+                    const VectorMetric metric, const UsIntValue nu_threads,
+                    Vector winners)
+{
+  /* Checks the parameters */
+  if (codebook == NULL || set == NULL || winners == NULL)
+    {
+      fprintf (stderr,
+               "nnet_cbook_winners: missing codebook, set or winners vector\n");
+      return EXIT_FAILURE;
+    }
+
+  if (winners->dimension != set->nu_elements)
+    {
+      fprintf (stderr,
+               "nnet_cbook_winners: winners vector has dimension %ld while set has %ld elements\n",
+               winners->dimension, set->nu_elements);
+      return EXIT_FAILURE;
+    }
+
+  return nnet_cbook_run (codebook, set, metric, nu_threads, winners->value,
+                         NULL, NULL, NULL);
+}
+
+
+
+/*
+ * nnet_cbook_mean_error
+ *
+ * Returns the mean, over the elements of the given set, of the error
+ * function evaluated at each element's winner row. The elements are split
+ * among the given number of threads as in nnet_cbook_winners, and the
+ * errors are added up in set order.
+ */
+int
+nnet_cbook_mean_error (const Codebook codebook, const TSet set,
+                       const VectorMetric metric, const UsIntValue nu_threads,
+                       const CodebookErrorFunction error_function,
+                       void *error_data, RValue * mean_error)
+{
+  RValue error = 0.0;           /* sum of the element errors */
+
+
+  /* Checks the parameters */
+  if (codebook == NULL || set == NULL || error_function == NULL)
+    {
+      fprintf (stderr,
+               "nnet_cbook_mean_error: missing codebook, set or error function\n");
+      return EXIT_FAILURE;
+    }
+
+  if (set->nu_elements == 0)
+    {
+      fprintf (stderr, "nnet_cbook_mean_error: set has no elements\n");
+      return EXIT_FAILURE;
+    }
+
+  if (nnet_cbook_run (codebook, set, metric, nu_threads, NULL,
+                      error_function, error_data, &error) != EXIT_SUCCESS)
+    return EXIT_FAILURE;
+
+  *mean_error = error / (RValue) set->nu_elements;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_cbook_distance_error
+ *
+ * Error function for nnet_cbook_mean_error: euclidean distance between the
+ * element input and the winner row (quantization error)
+ */
+RValue
+nnet_cbook_distance_error (const Codebook codebook, const UnitIndex row,
+                           const TElement element, void *data)
+{
+  (void) data;
+
+  return nnet_cbook_activation (codebook, row, element->input->value,
+                                VECTOR_METR_EUCLIDEAN);
+}
@@ -0,0 +1,337 @@
+#ifndef __NNET_CODEBOOK_H_
+#define __NNET_CODEBOOK_H_ 1
+
+#include "nnet_types.h"
+#include "../vector/vector.h"
+#include "../vector/vectorstat.h"
+
+
+/******************************************************************************
+ *                                                                            *
+ *                        PUBLIC DATATYPES AND VARIABLES                      *
+ *                                                                            *
+ ******************************************************************************/
+
+/* Pointer to Codebook Search Index */
+typedef struct nnet_cbindex_struct *CodebookIndexPtr;
+
+/* Pointer to Codebook Search Index working memory */
+typedef struct nnet_cbidx_scratch_struct *CodebookScratchPtr;
+
+/* Default number of grid neighbors of each row (a square ring in 2-D) */
+#define NNET_CBOOK_GRID_NEIGHBORS 8
+
+/* Columns accumulated between bound checks in partial distance searches */
+#define NNET_CBOOK_PDS_BLOCK 4
+
+
+
+/*
+ * nnet_codebook_type
+ *
+ * Dense snapshot of the input weights of the units of one layer.
+ * Row 'i' (starting at 0) holds the weights of the i-th unit of the layer,
+ * in the same order as the unit's input connections. Once loaded, the
+ * codebook is only read by the winner search functions, so it may be
+ * shared by several threads as long as nobody reloads it meanwhile.
+ * An optional search index may be attached to speed up winner searches.
+ * When the grid neighbors of each row are set, the winner searches over
+ * ordered sets track the previous winner instead (see nnet_cbook_track).
+ * Euclidean searches accumulate distances in 'order' and abandon a row as
+ * soon as it can't beat the current winner.
+ * Codebooks of mapped model files (see nnet_bin_codebook) have no layer
+ * nor units: their weights belong to the mapping, units are numbered by
+ * row and outputs are the activations themselves, which rank the rows the
+ * same way since their units were monotone.
+ */
+typedef struct
+{
+  Layer layer;                  /* layer whose weights are represented */
+  UnitIndex nu_units;           /* number of rows */
+  UnitIndex dimension;          /* number of columns (unit inputs) */
+  RValue *weights;              /* nu_units x dimension, row by row */
+  Unit *units;                  /* units of the layer by row */
+  CodebookIndexPtr index;       /* search index (NULL: linear scan) */
+  UnitIndex grid_degree;        /* grid neighbors per row */
+  UnitIndex *grid;              /* nu_units x grid_degree neighbor rows */
+  UnitIndex *order;             /* columns in distance accumulation order */
+  BoolValue monotone;           /* units share an increasing activation */
+  BoolValue mapped;             /* weights belong to a mapped model */
+}
+nnet_codebook_type;
+
+
+/* Symbolic type */
+typedef nnet_codebook_type *Codebook;
+
+
+
+/*
+ * CodebookErrorFunction
+ *
+ * Error of the winner row of one element, averaged over a set by
+ * nnet_cbook_mean_error. It may be called concurrently by several threads.
+ */
+typedef RValue (*CodebookErrorFunction) (const Codebook codebook,
+                                         const UnitIndex row,
+                                         const TElement element,
+                                         void *data);
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                            STRUCTURAL OPERATIONS                           *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * nnet_cbook_create
+ *
+ * Creates a new codebook for the given layer, loading the current weights
+ * of its units
+ */
+extern Codebook nnet_cbook_create (const Layer layer);
+
+
+
+/*
+ * nnet_cbook_destroy
+ *
+ * Destroys a previously created codebook
+ */
+extern int nnet_cbook_destroy (Codebook * codebook);
+
+
+
+/*
+ * nnet_cbook_load
+ *
+ * Copies the current weights of the layer units into the codebook
+ */
+extern int nnet_cbook_load (Codebook codebook);
+
+
+
+/*
+ * nnet_cbook_store
+ *
+ * Copies the codebook rows back into the weights of the layer units
+ */
+extern int nnet_cbook_store (const Codebook codebook);
+
+
+
+/*
+ * nnet_cbook_set_grid
+ *
+ * Links each row to the 'degree' rows whose units are the closest ones in
+ * the layer's coordinate space, enabling winner tracking. A degree of 0
+ * disables it.
+ */
+extern int nnet_cbook_set_grid (Codebook codebook, const UnitIndex degree);
+
+
+
+/*
+ * nnet_cbook_set_order
+ *
+ * Sorts the columns visited by the partial distance searches by decreasing
+ * expected squared difference between an input and a row, estimated from
+ * the given input statistics (may be NULL) and the current rows
+ */
+extern int
+nnet_cbook_set_order (Codebook codebook, const VectorStats stats);
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                            FUNCTIONAL OPERATIONS                           *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * nnet_cbook_row
+ *
+ * Returns a pointer to the weights of the given codebook row
+ */
+extern RValue *nnet_cbook_row (const Codebook codebook, const UnitIndex row);
+
+
+
+/*
+ * nnet_cbook_unit_index
+ *
+ * Returns the index of the unit of the given row
+ */
+extern UnitIndex
+nnet_cbook_unit_index (const Codebook codebook, const UnitIndex row);
+
+
+
+/*
+ * nnet_cbook_row_output
+ *
+ * Returns the output the unit of the given row gives for the given
+ * activation
+ */
+extern RValue
+nnet_cbook_row_output (const Codebook codebook, const UnitIndex row,
+                       const RValue activation);
+
+
+
+/*
+ * nnet_cbook_output
+ *
+ * Returns the output the unit of the given row would have for the given
+ * input values, without changing the unit's activation or output
+ */
+extern RValue
+nnet_cbook_output (const Codebook codebook, const UnitIndex row,
+                   const RValue * input, const VectorMetric metric);
+
+
+
+/*
+ * nnet_cbook_is_monotone
+ *
+ * Checks if all units share the same increasing activation function, so
+ * that the smallest distance also gives the smallest output
+ */
+extern BoolValue nnet_cbook_is_monotone (const Codebook codebook);
+
+
+
+/*
+ * nnet_cbook_scan
+ *
+ * Determines the row of the winner unit for the given input values by
+ * scanning all rows, with the same criterion used by
+ * nnet_metr_layer_winner: smallest output for euclidean distances and
+ * largest output for inner products. If the activation is increasing,
+ * euclidean distances are compared directly and each row is abandoned as
+ * soon as its partial distance exceeds the winner's.
+ */
+extern int
+nnet_cbook_scan (const Codebook codebook, const RValue * input,
+                 const VectorMetric metric, UnitIndex * winner,
+                 RValue * winner_output);
+
+
+
+/*
+ * nnet_cbook_scan_2
+ *
+ * Determines the rows of the winner and of the 2nd place units for the
+ * given input values in a single scan of all rows, returning their
+ * activations: euclidean distances or inner products. The units are
+ * ranked by their outputs, as in nnet_cbook_scan; if the activation is
+ * increasing, euclidean distances are compared directly and each row is
+ * abandoned as soon as its partial distance exceeds the 2nd place's.
+ * With a single row, 'winner2' is set to the number of rows.
+ */
+extern int
+nnet_cbook_scan_2 (const Codebook codebook, const RValue * input,
+                   const VectorMetric metric,
+                   UnitIndex * winner1, RValue * activation1,
+                   UnitIndex * winner2, RValue * activation2);
+
+
+
+/*
+ * nnet_cbook_winner
+ *
+ * Determines the row of the winner unit for the given input values,
+ * through the attached search index for euclidean metrics or by scanning
+ * all rows otherwise. Index searches use the calling thread's working
+ * memory (see nnet_cbidx_scratch_create), or their own if it is NULL.
+ * Does not change any field of the network, so it is safe to call it
+ * concurrently over the same codebook.
+ */
+extern int
+nnet_cbook_winner (const Codebook codebook, const RValue * input,
+                   const VectorMetric metric, CodebookScratchPtr scratch,
+                   UnitIndex * winner, RValue * winner_output);
+
+
+
+/*
+ * nnet_cbook_track
+ *
+ * Determines the euclidean winner row for the given input values knowing
+ * the winner of the previous frame (or none, if 'previous' is not a valid
+ * row). The previous winner and its grid neighbors are evaluated first,
+ * and their best distance bounds a partial distance scan of the other
+ * rows, which stops accumulating a row as soon as it exceeds the bound.
+ * The result is the same as nnet_cbook_scan's. If 'components' is passed,
+ * the number of squared differences computed is added to it.
+ */
+extern int
+nnet_cbook_track (const Codebook codebook, const RValue * input,
+                  const UnitIndex previous, UnitIndex * winner,
+                  RValue * winner_output, UsLgIntValue * components);
+
+
+
+/*
+ * nnet_cbook_track_cost
+ *
+ * Tracks the winners of the elements of the given set in order, returning
+ * the mean number of full distance computations they cost
+ */
+extern int
+nnet_cbook_track_cost (const Codebook codebook, const TSet set,
+                       RValue * mean_distances);
+
+
+
+/*
+ * nnet_cbook_winners
+ *
+ * Determines the winner of every element of the given set, splitting the
+ * elements among the given number of threads, and stores the index of
+ * each winner unit in the corresponding component of the winners vector.
+ * The layer units are never touched, so the same network may be used by
+ * several callers at once.
+ * If the grid neighbors are set and the metric is euclidean, each thread
+ * tracks the winners of its range in order, so the set should keep the
+ * elements in temporal order.
+ */
+extern int
+nnet_cbook_winners (const Codebook codebook, const TSet set,
+                    const VectorMetric metric, const UsIntValue nu_threads,
+                    Vector winners);
+
+
+
+/*
+ * nnet_cbook_mean_error
+ *
+ * Returns the mean, over the elements of the given set, of the error
+ * function evaluated at each element's winner row. The elements are split
+ * among the given number of threads as in nnet_cbook_winners, and the
+ * errors are added up in set order.
+ */
+extern int
+nnet_cbook_mean_error (const Codebook codebook, const TSet set,
+                       const VectorMetric metric, const UsIntValue nu_threads,
+                       const CodebookErrorFunction error_function,
+                       void *error_data, RValue * mean_error);
+
+
+
+/*
+ * nnet_cbook_distance_error
+ *
+ * Error function for nnet_cbook_mean_error: euclidean distance between the
+ * element input and the winner row (quantization error)
+ */
+extern RValue
+nnet_cbook_distance_error (const Codebook codebook, const UnitIndex row,
+                           const TElement element, void *data);
+
+
+
+#endif /* __NNET_CODEBOOK_H_ */
@@ -13,22 +13,27 @@
 
 /******************************************************************************
  *                                                                            *
- *                               PUBLIC VARIABLES                             *
+ *                              PUBLIC OPERATIONS                             *
  *                                                                            *
  ******************************************************************************/
 
-FILE *input_fd;                 /* input file descriptor */
-int cur_section = -1;           /* current section being processed */
-UsIntValue cur_attr = 0;        /* current section attribute */
-char buf[NNET_BUF_SIZE];        /* read buffer */
+/*
+ * nnet_file_parser_init
+ *
+ * Starts the parsing of the given input stream
+ */
+void
+nnet_file_parser_init (NFileParser parser, FILE * input_fd)
+{
+  parser->input_fd = input_fd;
+  parser->cur_section = -1;
+  parser->cur_attr = 0;
+  parser->buf[0] = '\0';
 
+  return;
+}
 
 
-/******************************************************************************
- *                                                                            *
- *                              PUBLIC OPERATIONS                             *
- *                                                                            *
- ******************************************************************************/
 
 /*
  * nnet_file_read_line
@@ -36,18 +41,20 @@ char buf[NNET_BUF_SIZE];        /* read buffer */
  * Reads one line to the input buffer
  */
 int
-nnet_file_read_buffer (const char ignore_char, const char *stdin_prompt)
+nnet_file_read_buffer (NFileParser parser,
+                       const char ignore_char, const char *stdin_prompt)
 {
   int exit_status;              /* auxiliary function return status */
 
 
   /* If reading from standard input, displays the prompt */
-  if (input_fd == stdin)
+  if (parser->input_fd == stdin)
     printf ("%s", stdin_prompt);
 
   /* Reads one line from the input stream */
   exit_status =
-    read_valid_file_line (input_fd, NNET_BUF_SIZE, ignore_char, 0, buf);
+    read_valid_file_line (parser->input_fd, NNET_BUF_SIZE, ignore_char, 0,
+                          parser->buf);
 
   if (exit_status != EXIT_SUCCESS)
     {
@@ -102,9 +109,10 @@ nnet_file_parse_vector (char *line)
   int exit_status;              /* auxiliary function return status */
 
 
-  /* Reads the dimension */
-  word = (char *) strtok (line, delim);
-  if (word == NULL)
+  /* Reads the dimension (words are split by hand: strtok isn't reentrant) */
+  word = line + strspn (line, delim);
+
+  if (*word == '\0')
     {
       fprintf (stderr,
                "nnet_file_parse_vector: error parsing vector dimension\n");
@@ -112,20 +120,22 @@ nnet_file_parse_vector (char *line)
     }
 
   dim = (UsLgIntValue) strtol (word, NULL, 10);
+  word += strcspn (word, delim);
 
   /* Creates the vector */
   new_vector = vector_create (dim);
 
   /* Populates the vector */
-  while (word != NULL && cur_comp <= dim)
+  while (*word != '\0' && cur_comp <= dim)
     {
       /* Reads the component value */
-      word = (char *) strtok (NULL, delim);
+      word += strspn (word, delim);
 
-      if (word != NULL)
+      if (*word != '\0')
         {
           /* Converts into real */
           cur_value = strtod (word, NULL);
+          word += strcspn (word, delim);
 
           /* Sets the vector component */
           exit_status = vector_set_value (new_vector, cur_comp, cur_value);
@@ -162,38 +172,37 @@ nnet_file_parse_vector (char *line)
  * Parses the current buffer and extracts the attribute value
  */
 void
-nnet_file_parse_attribute (NFile nfile, CompositeUnion * value)
+nnet_file_parse_attribute (NFileParser parser,
+                           NFile nfile, CompositeUnion * value)
 {
-/*  char line[NNET_BUF_SIZE]; *//* auxiliar line */
+  NFileAttribute *attribute;    /* current attribute */
+  char *line;                   /* parsed line */
   size_t start_pos;             /* buffer start position */
   CompositeDataType datatype;   /* current attribute data type */
 
 
   /* Initialization */
-  start_pos = strlen (nfile[cur_section].attr[cur_attr].name);
-  datatype = nfile[cur_section].attr[cur_attr].datatype;
+  attribute = &(nfile[parser->cur_section].attr[parser->cur_attr]);
+  start_pos = strlen (attribute->name);
+  datatype = attribute->datatype;
+  line = parser->buf;
 
-  /* Copies the buffer to the line starting from the given position */
-  if ((strcpy (buf, buf + start_pos) == NULL))
-    {
-      fprintf (stderr,
-               "nnet_file_parse_attribute: error parsing attribute\n");
-      return;
-    }
+  /* Moves the attribute value to the start of the line */
+  memmove (line, line + start_pos, strlen (line + start_pos) + 1);
 
   /* Wipes off left empty spaces */
-  ltrim (buf);
+  ltrim (line);
 
   /* Converts to the correct datatype */
   switch (datatype)
     {
     case BOOL:
-      if (strcmp (buf, "TRUE") == 0 || strcmp (buf, "true") == 0 ||
-          strcmp (buf, "True") == 0)
+      if (strcmp (line, "TRUE") == 0 || strcmp (line, "true") == 0 ||
+          strcmp (line, "True") == 0)
         value->boolvalue = TRUE;
       else
-        if (strcmp (buf, "FALSE") == 0 || strcmp (buf, "false") == 0 ||
-            strcmp (buf, "False") == 0)
+        if (strcmp (line, "FALSE") == 0 || strcmp (line, "false") == 0 ||
+            strcmp (line, "False") == 0)
         value->boolvalue = FALSE;
       else
         {
@@ -204,23 +213,23 @@ nnet_file_parse_attribute (NFile nfile, CompositeUnion * value)
       break;
 
     case UNSIGNED_INT:
-      value->usintvalue = (UsIntValue) strtol (buf, NULL, 10);
+      value->usintvalue = (UsIntValue) strtol (line, NULL, 10);
       break;
 
     case LONG_INT:
-      value->lgintvalue = (LgIntValue) strtol (buf, NULL, 10);
+      value->lgintvalue = (LgIntValue) strtol (line, NULL, 10);
       break;
 
     case UNSIGNED_LONG_INT:
-      value->uslgintvalue = (UsLgIntValue) strtol (buf, NULL, 10);
+      value->uslgintvalue = (UsLgIntValue) strtol (line, NULL, 10);
       break;
 
     case REAL:
-      value->realvalue = (RValue) strtod (buf, NULL);
+      value->realvalue = (RValue) strtod (line, NULL);
       break;
 
     case STRING:
-      if ((strncpy (value->stringvalue, buf, strlen (buf) + 1)) == NULL)
+      if (strcpy (value->stringvalue, line) == NULL)
         {
           fprintf (stderr,
                    "nnet_file_parse_attribute: error copying string attribute\n");
@@ -229,7 +238,7 @@ nnet_file_parse_attribute (NFile nfile, CompositeUnion * value)
       break;
 
     case REAL_VECTOR:
-      value->rvectorvalue = nnet_file_parse_vector (buf);
+      value->rvectorvalue = nnet_file_parse_vector (line);
 
       if (value->rvectorvalue == NULL)
         {
@@ -255,17 +264,19 @@ nnet_file_parse_attribute (NFile nfile, CompositeUnion * value)
  * Searches a section start in the configuration file and returns its ID
  */
 int
-nnet_file_read_section (NFile nfile, const UsIntValue nu_sections,
+nnet_file_read_section (NFileParser parser,
+                        NFile nfile, const UsIntValue nu_sections,
                         const char ignore_char, const char *stdin_prompt)
 {
   BoolValue section_found = FALSE;      /* section found flag */
 
 
   /* Reads the input file until a valid section tag is found */
-  while (section_found == FALSE && !feof (input_fd))
+  while (section_found == FALSE && !feof (parser->input_fd))
     {
       /* Reads one line */
-      if (nnet_file_read_buffer (ignore_char, stdin_prompt) != EXIT_SUCCESS)
+      if (nnet_file_read_buffer (parser, ignore_char, stdin_prompt)
+          != EXIT_SUCCESS)
         {
           fprintf (stderr,
                    "nnet_file_read_section: error reading valid line\n");
@@ -273,27 +284,28 @@ nnet_file_read_section (NFile nfile, const UsIntValue nu_sections,
         }
 
       /* Checks if it is a section start tag */
-      if (!feof (input_fd))
+      if (!feof (parser->input_fd))
         {
-          cur_section = 0;
-          while (cur_section < (int) nu_sections && section_found == FALSE)
+          parser->cur_section = 0;
+          while (parser->cur_section < (int) nu_sections &&
+                 section_found == FALSE)
             {
-              if (strcmp (nfile[cur_section].begin, buf) == 0)
+              if (strcmp (nfile[parser->cur_section].begin, parser->buf) == 0)
                 section_found = TRUE;
               else
-                ++cur_section;
+                ++parser->cur_section;
             }
         }
 
       /* Displays an error for invalid section */
-      if (section_found == FALSE && *buf != '\0')
+      if (section_found == FALSE && *parser->buf != '\0')
         fprintf (stderr, "nnet_file_read_section: invalid section: '%s'\n",
-                 buf);
+                 parser->buf);
     }
 
   /* Section start tag not found */
   if (section_found == FALSE)
-    cur_section = -1;
+    parser->cur_section = -1;
 
   return EXIT_SUCCESS;
 }
@@ -306,17 +318,19 @@ nnet_file_read_section (NFile nfile, const UsIntValue nu_sections,
  * Reads one of the possible attributes of the current session
  */
 int
-nnet_file_read_attribute (NFile nfile,
+nnet_file_read_attribute (NFileParser parser,
+                          NFile nfile,
                           UsIntValue * attribute_id,
                           BoolValue * end_of_section,
                           const char ignore_char, const char *stdin_prompt)
 {
   BoolValue attribute_found = FALSE;    /* attribute found flag */
   BoolValue end_section_found = FALSE;  /* end of section flag */
+  const char *attribute_name;           /* current attribute name */
 
 
   /* Checks if parsing is within a session */
-  if (cur_section == -1)
+  if (parser->cur_section == -1)
     {
       fprintf (stderr,
                "nnet_file_read_attribute: no current section defined\n");
@@ -324,14 +338,15 @@ nnet_file_read_attribute (NFile nfile,
     }
 
   /* Reinitializes the current attribute */
-  cur_attr = 0;
+  parser->cur_attr = 0;
 
   /* Reads the input file until a valid attribute tag is found */
   while (attribute_found == FALSE && end_section_found == FALSE
-         && !feof (input_fd))
+         && !feof (parser->input_fd))
     {
       /* Reads one line */
-      if (nnet_file_read_buffer (ignore_char, stdin_prompt) != EXIT_SUCCESS)
+      if (nnet_file_read_buffer (parser, ignore_char, stdin_prompt)
+          != EXIT_SUCCESS)
         {
           fprintf (stderr,
                    "nnet_file_read_attribute: error reading valid line\n");
@@ -339,38 +354,40 @@ nnet_file_read_attribute (NFile nfile,
         }
 
       /* Checks if it is a section start tag */
-      if (!feof (input_fd))
+      if (!feof (parser->input_fd))
         {
           /* Checks if the attribute was found */
-          while (cur_attr < nfile[cur_section].nu_attr
+          while (parser->cur_attr < nfile[parser->cur_section].nu_attr
                  && attribute_found == FALSE)
             {
-              if (strncmp
-                  (nfile[cur_section].attr[cur_attr].name, buf,
-                   strlen (nfile[cur_section].attr[cur_attr].name)) == 0)
+              attribute_name =
+                nfile[parser->cur_section].attr[parser->cur_attr].name;
+
+              if (strncmp (attribute_name, parser->buf,
+                           strlen (attribute_name)) == 0)
                 attribute_found = TRUE;
               else
-                ++cur_attr;
+                ++parser->cur_attr;
             }
 
           /* Checks if the end of the current section was found */
-          if (strcmp (nfile[cur_section].end, buf) == 0)
+          if (strcmp (nfile[parser->cur_section].end, parser->buf) == 0)
             end_section_found = TRUE;
 
           /* Invalid line */
           if (attribute_found == FALSE && end_section_found == FALSE &&
-              *buf != '\0')
+              *parser->buf != '\0')
             {
               fprintf (stderr,
                        "nnet_file_read_attribute: invalid attribute: '%s'\n",
-                       buf);
+                       parser->buf);
             }
         }
     }
 
   /* Sets the attribute ID found */
   if (attribute_found == TRUE)
-    *attribute_id = cur_attr;
+    *attribute_id = parser->cur_attr;
   else
     *attribute_id = -1;
 
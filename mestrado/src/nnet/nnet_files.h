@@ -60,16 +60,25 @@ typedef NFileSection NFile[];
 
 
 
-/******************************************************************************
- *                                                                            *
- *                               PUBLIC VARIABLES                             *
- *                                                                            *
- ******************************************************************************/
+/*
+ * nnet_file_parser_type
+ *
+ * State of the parsing of one configuration file. Each file being read
+ * needs its own parser, so different threads can read files at the same
+ * time.
+ */
+typedef struct
+{
+  FILE *input_fd;               /* input file descriptor */
+  int cur_section;              /* current section being processed */
+  UsIntValue cur_attr;          /* current section attribute */
+  char buf[NNET_BUF_SIZE];      /* read buffer */
+}
+nnet_file_parser_type;
+
 
-extern FILE *input_fd;              /* input file descriptor */
-extern int cur_section;             /* current section being processed */
-extern UsIntValue cur_attr;         /* current section attribute */
-extern char buf[NNET_BUF_SIZE];     /* read buffer */
+/* Symbolic type */
+typedef nnet_file_parser_type *NFileParser;
 
 
 
@@ -79,13 +88,23 @@ extern char buf[NNET_BUF_SIZE];     /* read buffer */
  *                                                                            *
  ******************************************************************************/
 
+/*
+ * nnet_file_parser_init
+ *
+ * Starts the parsing of the given input stream
+ */
+extern void nnet_file_parser_init (NFileParser parser, FILE * input_fd);
+
+
+
 /*
  * nnet_file_read_line
  *
  * Reads one line to the input buffer
  */
 extern int
-nnet_file_read_buffer (const char ignore_char, const char *stdin_prompt);
+nnet_file_read_buffer (NFileParser parser,
+                       const char ignore_char, const char *stdin_prompt);
 
 
 
@@ -114,7 +133,9 @@ extern Vector nnet_file_parse_vector (char *line);
  *
  * Parses the current buffer and extracts the attribute value
  */
-extern void nnet_file_parse_attribute (NFile nfile, CompositeUnion * value);
+extern void
+nnet_file_parse_attribute (NFileParser parser,
+                           NFile nfile, CompositeUnion * value);
 
 
 
@@ -124,7 +145,8 @@ extern void nnet_file_parse_attribute (NFile nfile, CompositeUnion * value);
  * Searches a section start in the configuration file and returns its ID
  */
 extern int
-nnet_file_read_section (NFile nfile,
+nnet_file_read_section (NFileParser parser,
+                        NFile nfile,
                         const UsIntValue nu_sections,
                         const char ignore_char, const char *stdin_prompt);
 
@@ -136,7 +158,8 @@ nnet_file_read_section (NFile nfile,
  * Reads one of the possible attributes of the current session
  */
 extern int
-nnet_file_read_attribute (NFile nfile,
+nnet_file_read_attribute (NFileParser parser,
+                          NFile nfile,
                           UsIntValue * attribute_id,
                           BoolValue * end_of_section,
                           const char ignore_char, const char *stdin_prompt);
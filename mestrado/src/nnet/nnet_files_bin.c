@@ -0,0 +1,1199 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "nnet_types.h"
+#include "nnet_files_bin.h"
+#include "nnet_nnet.h"
+#include "nnet_layers.h"
+#include "nnet_units.h"
+#include "nnet_conns.h"
+#include "nnet_actv.h"
+#include "nnet_weights.h"
+#include "nnet_train.h"
+#include "nnet_codebook.h"
+#include "som/nnet_som.h"
+#include "som/nnet_som_ngb.h"
+#include "lvq/nnet_lvq.h"
+#include "../vector/vector.h"
+#include "../common/types.h"
+
+/******************************************************************************
+ *                                                                            *
+ *                             PRIVATE OPERATIONS                             *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * nnet_bin_align
+ *
+ * Rounds the given offset up to the next block boundary
+ */
+static UsLgIntValue
+nnet_bin_align (const UsLgIntValue offset)
+{
+  return (offset + NNET_BIN_ALIGN - 1) / NNET_BIN_ALIGN * NNET_BIN_ALIGN;
+}
+
+
+
+/*
+ * nnet_bin_store_function
+ *
+ * Stores the class name and the parameters of a function
+ */
+static void
+nnet_bin_store_function (const RFunctionClass function_class,
+                         const RFunctionParameters parameters,
+                         nnet_bin_function_type * stored)
+{
+  UsLgIntValue cur_parm;        /* current parameter */
+
+
+  strcpy (stored->class_name, function_class->name);
+  stored->nu_parameters = function_class->nu_parameters;
+
+  for (cur_parm = 0; cur_parm < stored->nu_parameters &&
+       cur_parm < RFUNC_MAX_PARAMETERS; cur_parm++)
+    stored->parameters[cur_parm] = parameters[cur_parm];
+
+  return;
+}
+
+
+
+/*
+ * nnet_bin_load_function
+ *
+ * Copies the class name and the parameters of a stored function
+ */
+static void
+nnet_bin_load_function (const nnet_bin_function_type * stored,
+                        Name class_name, RValue * parameters)
+{
+  UsLgIntValue cur_parm;        /* current parameter */
+
+
+  memcpy (class_name, stored->class_name, NAME_SIZE);
+  class_name[NAME_SIZE] = '\0';
+
+  for (cur_parm = 0; cur_parm < RFUNC_MAX_PARAMETERS; cur_parm++)
+    parameters[cur_parm] = stored->parameters[cur_parm];
+
+  return;
+}
+
+
+
+/*
+ * nnet_bin_describe_layer
+ *
+ * Fills the descriptor of the given layer, except for its block offsets,
+ * checking that the layer fits the binary format
+ */
+static int
+nnet_bin_describe_layer (const Layer layer, nnet_bin_layer_type * desc)
+{
+  Unit first_unit = NULL;       /* first unit of the layer */
+  Unit cur_unit = NULL;         /* current unit */
+  Layer origin = NULL;          /* origin layer */
+  Connection cur_conn = NULL;   /* current input connection */
+  ActivationFunction f;         /* activation function */
+  UnitIndex cur_row;            /* current unit position */
+  UnitIndex cur_input;          /* current input position */
+  UsLgIntValue cur_parm;        /* current parameter */
+  UnitIndex coord_dimension;    /* unit coordinates dimension */
+
+
+  first_unit = layer->first_unit;
+
+  if (first_unit == NULL)
+    {
+      fprintf (stderr, "nnet_bin_describe_layer: layer '%s' has no units\n",
+               layer->name);
+      return EXIT_FAILURE;
+    }
+
+  strcpy (desc->name, layer->name);
+  desc->position = (UsLgIntValue) layer->layer_class->position;
+  desc->nu_units = layer->nu_units;
+  desc->coord_dimension =
+    (first_unit->coord != NULL) ? first_unit->coord->dimension : 0;
+  desc->nu_inputs = first_unit->nu_inputs;
+
+  f = first_unit->activation_function;
+  nnet_bin_store_function (f->function_class, f->parameters,
+                           &(desc->activation));
+
+  desc->monotone =
+    (nnet_actv_value (f, 1.0) > nnet_actv_value (f, 0.0)) ? TRUE : FALSE;
+
+  /* The origin layer is the one of the first input */
+  if (first_unit->first_orig != NULL)
+    {
+      origin = first_unit->first_orig->orig->layer;
+
+      if (origin->layer_index >= layer->layer_index)
+        {
+          fprintf (stderr,
+                   "nnet_bin_describe_layer: layer '%s' has inputs from a later layer\n",
+                   layer->name);
+          return EXIT_FAILURE;
+        }
+
+      desc->origin_layer = origin->layer_index;
+
+      nnet_bin_store_function
+        (first_unit->first_orig->wght_function->function_class,
+         first_unit->first_orig->wght_function->parameters,
+         &(desc->weight_init));
+    }
+
+  /* Checks the units */
+  cur_unit = first_unit;
+  cur_row = 0;
+
+  while (cur_unit != NULL)
+    {
+      if (cur_unit->unit_index != cur_row + 1)
+        {
+          fprintf (stderr,
+                   "nnet_bin_describe_layer: units of layer '%s' are out of order\n",
+                   layer->name);
+          return EXIT_FAILURE;
+        }
+
+      /* Same activation function */
+      f = cur_unit->activation_function;
+
+      if (strcmp (f->function_class->name, desc->activation.class_name) != 0)
+        {
+          fprintf (stderr,
+                   "nnet_bin_describe_layer: units of layer '%s' have different activation classes\n",
+                   layer->name);
+          return EXIT_FAILURE;
+        }
+
+      for (cur_parm = 0; cur_parm < desc->activation.nu_parameters;
+           cur_parm++)
+        if (f->parameters[cur_parm] != desc->activation.parameters[cur_parm])
+          {
+            fprintf (stderr,
+                     "nnet_bin_describe_layer: units of layer '%s' have different activation parameters\n",
+                     layer->name);
+            return EXIT_FAILURE;
+          }
+
+      /* Same coordinates dimension */
+      coord_dimension =
+        (cur_unit->coord != NULL) ? cur_unit->coord->dimension : 0;
+
+      if (coord_dimension != desc->coord_dimension)
+        {
+          fprintf (stderr,
+                   "nnet_bin_describe_layer: units of layer '%s' have different coordinate dimensions\n",
+                   layer->name);
+          return EXIT_FAILURE;
+        }
+
+      /* Dense inputs from the origin layer, in order */
+      cur_conn = cur_unit->first_orig;
+      cur_input = 0;
+
+      while (cur_conn != NULL)
+        {
+          if (cur_conn->orig->layer != origin ||
+              cur_conn->orig->unit_index != cur_input + 1)
+            {
+              fprintf (stderr,
+                       "nnet_bin_describe_layer: inputs of layer '%s' are not in origin layer order\n",
+                       layer->name);
+              return EXIT_FAILURE;
+            }
+
+          ++cur_input;
+          cur_conn = cur_conn->next_orig;
+        }
+
+      if (cur_input != desc->nu_inputs ||
+          (origin != NULL && cur_input != origin->nu_units))
+        {
+          fprintf (stderr,
+                   "nnet_bin_describe_layer: layer '%s' is not fully connected\n",
+                   layer->name);
+          return EXIT_FAILURE;
+        }
+
+      ++cur_row;
+      cur_unit = cur_unit->next;
+    }
+
+  if (cur_row != layer->nu_units)
+    {
+      fprintf (stderr,
+               "nnet_bin_describe_layer: unit count of layer '%s' is inconsistent with its unit list\n",
+               layer->name);
+      return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_bin_write_block
+ *
+ * Writes zeros up to the given offset, then the given block
+ */
+static int
+nnet_bin_write_block (FILE * output_fd, UsLgIntValue * position,
+                      const UsLgIntValue offset,
+                      const void *block, const size_t size)
+{
+  while (*position < offset)
+    {
+      if (fputc (0, output_fd) == EOF)
+        return EXIT_FAILURE;
+
+      ++(*position);
+    }
+
+  if (size > 0 && fwrite (block, 1, size, output_fd) != size)
+    return EXIT_FAILURE;
+
+  *position += size;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_bin_write_layer_blocks
+ *
+ * Writes the coordinates and the input weights of the units of a layer
+ */
+static int
+nnet_bin_write_layer_blocks (FILE * output_fd, UsLgIntValue * position,
+                             const Layer layer,
+                             const nnet_bin_layer_type * desc)
+{
+  Unit cur_unit = NULL;         /* current unit */
+  Connection cur_conn = NULL;   /* current input connection */
+  RValue *row = NULL;           /* current weights row */
+  UnitIndex cur_col;            /* current column */
+  UsLgIntValue offset;          /* current row offset */
+
+
+  /* Coordinates */
+  offset = desc->coords_offset;
+
+  for (cur_unit = layer->first_unit;
+       cur_unit != NULL && desc->coord_dimension > 0;
+       cur_unit = cur_unit->next)
+    {
+      if (nnet_bin_write_block (output_fd, position, offset,
+                                cur_unit->coord->value,
+                                desc->coord_dimension * sizeof (RValue))
+          != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+
+      offset = *position;
+    }
+
+  if (desc->nu_inputs == 0)
+    return EXIT_SUCCESS;
+
+  /* Input weights */
+  row = (RValue *) malloc (desc->nu_inputs * sizeof (RValue));
+
+  if (row == NULL)
+    {
+      fprintf (stderr,
+               "nnet_bin_write_layer_blocks: virtual memory exhausted\n");
+      return EXIT_FAILURE;
+    }
+
+  offset = desc->weights_offset;
+
+  for (cur_unit = layer->first_unit; cur_unit != NULL;
+       cur_unit = cur_unit->next)
+    {
+      cur_conn = cur_unit->first_orig;
+
+      for (cur_col = 0; cur_col < desc->nu_inputs; cur_col++)
+        {
+          row[cur_col] = cur_conn->weight;
+          cur_conn = cur_conn->next_orig;
+        }
+
+      if (nnet_bin_write_block (output_fd, position, offset, row,
+                                desc->nu_inputs * sizeof (RValue))
+          != EXIT_SUCCESS)
+        {
+          free (row);
+          return EXIT_FAILURE;
+        }
+
+      offset = *position;
+    }
+
+  free (row);
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_bin_valid_block
+ *
+ * Checks if a block of rows x columns values of the given size at the
+ * given offset is aligned and lies within the mapping
+ */
+static BoolValue
+nnet_bin_valid_block (const NNetModel model, const UsLgIntValue offset,
+                      const UsLgIntValue rows, const UsLgIntValue columns,
+                      const size_t size)
+{
+  UsLgIntValue available;       /* values available after the offset */
+
+
+  if (rows == 0 || columns == 0)
+    return TRUE;
+
+  if (offset % NNET_BIN_ALIGN != 0 || offset > model->length)
+    return FALSE;
+
+  available = (model->length - offset) / size;
+
+  if (columns > available / rows)
+    return FALSE;
+
+  return TRUE;
+}
+
+
+
+/*
+ * nnet_bin_check_model
+ *
+ * Checks the header of a mapped model and the bounds of its blocks
+ */
+static int
+nnet_bin_check_model (const NNetModel model, const char *file_name)
+{
+  const nnet_bin_header_type *header;   /* file header */
+  const nnet_bin_layer_type *desc;      /* current layer descriptor */
+  UsLgIntValue cur_layer;               /* current layer */
+
+
+  header = model->header;
+
+  if (memcmp (header->magic, NNET_BIN_MAGIC, NNET_BIN_MAGIC_SIZE) != 0)
+    {
+      fprintf (stderr, "nnet_bin_map: '%s' is not a binary model file\n",
+               file_name);
+      return EXIT_FAILURE;
+    }
+
+  if (header->version != NNET_BIN_VERSION)
+    {
+      fprintf (stderr, "nnet_bin_map: '%s' has unknown version %lu\n",
+               file_name, header->version);
+      return EXIT_FAILURE;
+    }
+
+  if (header->order_mark != NNET_BIN_ORDER_MARK ||
+      header->value_size != sizeof (RValue) ||
+      header->index_size != sizeof (UsLgIntValue) ||
+      header->header_size != sizeof (nnet_bin_header_type) ||
+      header->layer_size != sizeof (nnet_bin_layer_type))
+    {
+      fprintf (stderr,
+               "nnet_bin_map: '%s' was written by a different architecture\n",
+               file_name);
+      return EXIT_FAILURE;
+    }
+
+  if (header->file_size != model->length)
+    {
+      fprintf (stderr, "nnet_bin_map: '%s' is truncated\n", file_name);
+      return EXIT_FAILURE;
+    }
+
+  if (header->extension > NNEXT_MLP || header->nu_layers == 0 ||
+      nnet_bin_valid_block (model, header->layers_offset, header->nu_layers,
+                            1, sizeof (nnet_bin_layer_type)) != TRUE)
+    {
+      fprintf (stderr, "nnet_bin_map: '%s' has an invalid header\n",
+               file_name);
+      return EXIT_FAILURE;
+    }
+
+  model->layers = (const nnet_bin_layer_type *)
+    ((const char *) model->address + header->layers_offset);
+
+  /* Checks the layers */
+  for (cur_layer = 0; cur_layer < header->nu_layers; cur_layer++)
+    {
+      desc = &(model->layers[cur_layer]);
+
+      if (desc->position > NNET_LAYER_OUTPUT ||
+          desc->origin_layer > cur_layer ||
+          (desc->origin_layer == 0 && desc->nu_inputs != 0) ||
+          (desc->origin_layer > 0 &&
+           desc->nu_inputs != model->layers[desc->origin_layer - 1].nu_units)
+          || nnet_bin_valid_block (model, desc->coords_offset,
+                                   desc->nu_units, desc->coord_dimension,
+                                   sizeof (RValue)) != TRUE
+          || nnet_bin_valid_block (model, desc->weights_offset,
+                                   desc->nu_units, desc->nu_inputs,
+                                   sizeof (RValue)) != TRUE)
+        {
+          fprintf (stderr,
+                   "nnet_bin_map: '%s' has an invalid descriptor for layer %lu\n",
+                   file_name, cur_layer + 1);
+          return EXIT_FAILURE;
+        }
+    }
+
+  /* Checks the training state */
+  if (header->state_size > 0 &&
+      nnet_bin_valid_block (model, header->state_offset, 1,
+                            header->state_size, 1) != TRUE)
+    {
+      fprintf (stderr, "nnet_bin_map: '%s' has an invalid training state\n",
+               file_name);
+      return EXIT_FAILURE;
+    }
+
+  /* Checks the classes */
+  if (header->nu_classes > 0 &&
+      (header->nu_classes != model->layers[header->nu_layers - 1].nu_units ||
+       nnet_bin_valid_block (model, header->classes_offset,
+                             header->nu_classes, 1,
+                             sizeof (RValue)) != TRUE))
+    {
+      fprintf (stderr, "nnet_bin_map: '%s' has invalid unit classes\n",
+               file_name);
+      return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_bin_write
+ *
+ * Writes the given neural network to the given binary model file, followed
+ * by the given training state block (if any)
+ */
+static int
+nnet_bin_write (const NNetwork nnet, const void *state,
+                const size_t state_size, const char *file_name)
+{
+  nnet_bin_header_type header;  /* file header */
+  nnet_bin_layer_type *descs = NULL;    /* layer descriptors */
+  SomAttributes som_attr = NULL;        /* SOM attributes */
+  LvqAttributes lvq_attr = NULL;        /* LVQ attributes */
+  Layer cur_layer = NULL;       /* current layer */
+  LayerIndex cur_index;         /* current layer position */
+  UsLgIntValue offset;          /* current block offset */
+  UsLgIntValue position = 0;    /* current file position */
+  FILE *output_fd = NULL;       /* output file */
+  int exit_status = EXIT_SUCCESS;       /* auxiliary function return status */
+
+
+  /* Checks if the network was passed */
+  if (nnet == NULL || nnet->nu_layers == 0)
+    {
+      fprintf (stderr, "nnet_bin_write: no neural network passed\n");
+      return EXIT_FAILURE;
+    }
+
+  if (state_size > 0 && state == NULL)
+    {
+      fprintf (stderr, "nnet_bin_write: no training state passed\n");
+      return EXIT_FAILURE;
+    }
+
+  if (file_name == NULL)
+    {
+      fprintf (stderr, "nnet_bin_write: no file name passed\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Header */
+  memset (&header, 0, sizeof (nnet_bin_header_type));
+
+  memcpy (header.magic, NNET_BIN_MAGIC, NNET_BIN_MAGIC_SIZE);
+  header.version = NNET_BIN_VERSION;
+  header.order_mark = NNET_BIN_ORDER_MARK;
+  header.value_size = sizeof (RValue);
+  header.index_size = sizeof (UsLgIntValue);
+  header.header_size = sizeof (nnet_bin_header_type);
+  header.layer_size = sizeof (nnet_bin_layer_type);
+  strcpy (header.name, nnet->name);
+  header.extension = NNEXT_GEN;
+  header.nu_layers = nnet->nu_layers;
+
+  if (nnet->extension != NULL)
+    {
+      header.extension = nnet->extension->index;
+
+      switch (nnet->extension->index)
+        {
+        case NNEXT_GEN:
+          break;
+
+        case NNEXT_SOM:
+          som_attr = (SomAttributes) nnet->extension->attr;
+          nnet_bin_store_function
+            (som_attr->ngb_function->function_class->ngb_class,
+             som_attr->ngb_function->function->parameters,
+             &(header.functions[0]));
+          nnet_bin_store_function
+            (som_attr->lrate_function->function_class,
+             som_attr->lrate_function->parameters, &(header.functions[1]));
+          break;
+
+        case NNEXT_LVQ:
+          lvq_attr = (LvqAttributes) nnet->extension->attr;
+          nnet_bin_store_function
+            (lvq_attr->lrate_function->function_class,
+             lvq_attr->lrate_function->parameters, &(header.functions[0]));
+          header.lvq_algorithm = lvq_attr->lvq_algorithm;
+          header.lvq_metric = lvq_attr->activation_metric;
+          if (lvq_attr->classes != NULL)
+            header.nu_classes = lvq_attr->classes->dimension;
+          break;
+
+        default:
+          fprintf (stderr,
+                   "nnet_bin_write: extension '%s' not supported\n",
+                   nnet_extension_name[nnet->extension->index]);
+          return EXIT_FAILURE;
+        }
+    }
+
+  /* Layer descriptors */
+  descs = (nnet_bin_layer_type *)
+    calloc (nnet->nu_layers, sizeof (nnet_bin_layer_type));
+
+  if (descs == NULL)
+    {
+      fprintf (stderr, "nnet_bin_write: virtual memory exhausted\n");
+      return EXIT_FAILURE;
+    }
+
+  cur_layer = nnet->first_layer;
+  cur_index = 0;
+
+  while (cur_layer != NULL && cur_index < nnet->nu_layers)
+    {
+      if (cur_layer->layer_index != cur_index + 1)
+        {
+          fprintf (stderr,
+                   "nnet_bin_write: layers are out of order\n");
+          free (descs);
+          return EXIT_FAILURE;
+        }
+
+      if (nnet_bin_describe_layer (cur_layer, &(descs[cur_index]))
+          != EXIT_SUCCESS)
+        {
+          fprintf (stderr,
+                   "nnet_bin_write: layer '%s' can't be written as a binary model\n",
+                   cur_layer->name);
+          free (descs);
+          return EXIT_FAILURE;
+        }
+
+      ++cur_index;
+      cur_layer = cur_layer->next;
+    }
+
+  if (cur_layer != NULL || cur_index != nnet->nu_layers)
+    {
+      fprintf (stderr,
+               "nnet_bin_write: layer count is inconsistent with the layer list\n");
+      free (descs);
+      return EXIT_FAILURE;
+    }
+
+  if (header.nu_classes > 0 &&
+      header.nu_classes != descs[nnet->nu_layers - 1].nu_units)
+    {
+      fprintf (stderr,
+               "nnet_bin_write: classes differ from the output units\n");
+      free (descs);
+      return EXIT_FAILURE;
+    }
+
+  /* Block layout */
+  offset = nnet_bin_align (sizeof (nnet_bin_header_type));
+  header.layers_offset = offset;
+  offset += nnet->nu_layers * sizeof (nnet_bin_layer_type);
+
+  for (cur_index = 0; cur_index < nnet->nu_layers; cur_index++)
+    {
+      if (descs[cur_index].coord_dimension > 0)
+        {
+          offset = nnet_bin_align (offset);
+          descs[cur_index].coords_offset = offset;
+          offset += descs[cur_index].nu_units *
+            descs[cur_index].coord_dimension * sizeof (RValue);
+        }
+
+      if (descs[cur_index].nu_inputs > 0)
+        {
+          offset = nnet_bin_align (offset);
+          descs[cur_index].weights_offset = offset;
+          offset += descs[cur_index].nu_units *
+            descs[cur_index].nu_inputs * sizeof (RValue);
+        }
+    }
+
+  if (header.nu_classes > 0)
+    {
+      offset = nnet_bin_align (offset);
+      header.classes_offset = offset;
+      offset += header.nu_classes * sizeof (RValue);
+    }
+
+  if (state_size > 0)
+    {
+      offset = nnet_bin_align (offset);
+      header.state_offset = offset;
+      header.state_size = state_size;
+      offset += state_size;
+    }
+
+  header.file_size = offset;
+
+  /* Writes the file */
+  output_fd = fopen (file_name, "wb");
+
+  if (output_fd == NULL)
+    {
+      fprintf (stderr, "nnet_bin_write: '%s': %s\n", file_name,
+               strerror (errno));
+      free (descs);
+      return EXIT_FAILURE;
+    }
+
+  exit_status = nnet_bin_write_block (output_fd, &position, 0, &header,
+                                      sizeof (nnet_bin_header_type));
+
+  if (exit_status == EXIT_SUCCESS)
+    exit_status = nnet_bin_write_block
+      (output_fd, &position, header.layers_offset, descs,
+       nnet->nu_layers * sizeof (nnet_bin_layer_type));
+
+  cur_layer = nnet->first_layer;
+  cur_index = 0;
+
+  while (exit_status == EXIT_SUCCESS && cur_layer != NULL)
+    {
+      exit_status = nnet_bin_write_layer_blocks
+        (output_fd, &position, cur_layer, &(descs[cur_index]));
+
+      ++cur_index;
+      cur_layer = cur_layer->next;
+    }
+
+  if (exit_status == EXIT_SUCCESS && header.nu_classes > 0)
+    exit_status = nnet_bin_write_block
+      (output_fd, &position, header.classes_offset, lvq_attr->classes->value,
+       header.nu_classes * sizeof (RValue));
+
+  if (exit_status == EXIT_SUCCESS && state_size > 0)
+    exit_status = nnet_bin_write_block
+      (output_fd, &position, header.state_offset, state, state_size);
+
+  free (descs);
+
+  if (fclose (output_fd) != 0 || exit_status != EXIT_SUCCESS ||
+      position != header.file_size)
+    {
+      fprintf (stderr, "nnet_bin_write: error writing '%s'\n",
+               file_name);
+      return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                              PUBLIC OPERATIONS                             *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * nnet_bin_write_nnetwork
+ *
+ * Writes the given neural network to the given binary model file
+ */
+int
+nnet_bin_write_nnetwork (const NNetwork nnet, const char *file_name)
+{
+  return nnet_bin_write (nnet, NULL, 0, file_name);
+}
+
+
+
+/*
+ * nnet_bin_write_checkpoint
+ *
+ * Writes the given neural network to the given binary model file, followed
+ * by the given training state block
+ */
+int
+nnet_bin_write_checkpoint (const NNetwork nnet,
+                           const void *state, const size_t state_size,
+                           const char *file_name)
+{
+  if (state == NULL || state_size == 0)
+    {
+      fprintf (stderr, "nnet_bin_write_checkpoint: no training state passed\n");
+      return EXIT_FAILURE;
+    }
+
+  return nnet_bin_write (nnet, state, state_size, file_name);
+}
+
+
+
+/*
+ * nnet_bin_is_model
+ *
+ * Checks if the given file starts as a binary model file
+ */
+BoolValue
+nnet_bin_is_model (const char *file_name)
+{
+  char magic[NNET_BIN_MAGIC_SIZE];      /* file magic */
+  FILE *input_fd = NULL;                /* input file */
+  size_t magic_size;                    /* bytes read */
+
+
+  if (file_name == NULL)
+    return FALSE;
+
+  input_fd = fopen (file_name, "rb");
+
+  if (input_fd == NULL)
+    return FALSE;
+
+  magic_size = fread (magic, 1, NNET_BIN_MAGIC_SIZE, input_fd);
+  fclose (input_fd);
+
+  if (magic_size != NNET_BIN_MAGIC_SIZE ||
+      memcmp (magic, NNET_BIN_MAGIC, NNET_BIN_MAGIC_SIZE) != 0)
+    return FALSE;
+
+  return TRUE;
+}
+
+
+
+/*
+ * nnet_bin_map
+ *
+ * Maps the given binary model file into memory, checking its header and
+ * the bounds of its blocks
+ */
+NNetModel
+nnet_bin_map (const char *file_name)
+{
+  NNetModel new_model = NULL;   /* new mapped model */
+  struct stat file_stat;        /* file status */
+  int fd;                       /* file descriptor */
+
+
+  if (file_name == NULL)
+    {
+      fprintf (stderr, "nnet_bin_map: no file name passed\n");
+      return NULL;
+    }
+
+  fd = open (file_name, O_RDONLY);
+
+  if (fd < 0)
+    {
+      fprintf (stderr, "nnet_bin_map: '%s': %s\n", file_name,
+               strerror (errno));
+      return NULL;
+    }
+
+  if (fstat (fd, &file_stat) != 0)
+    {
+      fprintf (stderr, "nnet_bin_map: '%s': %s\n", file_name,
+               strerror (errno));
+      close (fd);
+      return NULL;
+    }
+
+  if ((size_t) file_stat.st_size < sizeof (nnet_bin_header_type))
+    {
+      fprintf (stderr, "nnet_bin_map: '%s' is not a binary model file\n",
+               file_name);
+      close (fd);
+      return NULL;
+    }
+
+  new_model = (NNetModel) malloc (sizeof (nnet_bin_model_type));
+
+  if (new_model == NULL)
+    {
+      fprintf (stderr, "nnet_bin_map: virtual memory exhausted\n");
+      close (fd);
+      return NULL;
+    }
+
+  /* Private writable mapping: weights may be changed in memory */
+  new_model->length = (size_t) file_stat.st_size;
+  new_model->address = mmap (NULL, new_model->length,
+                             PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close (fd);
+
+  if (new_model->address == MAP_FAILED)
+    {
+      fprintf (stderr, "nnet_bin_map: '%s': %s\n", file_name,
+               strerror (errno));
+      free (new_model);
+      return NULL;
+    }
+
+  new_model->header = (const nnet_bin_header_type *) new_model->address;
+  new_model->layers = NULL;
+
+  if (nnet_bin_check_model (new_model, file_name) != EXIT_SUCCESS)
+    {
+      nnet_bin_unmap (&new_model);
+      return NULL;
+    }
+
+  return new_model;
+}
+
+
+
+/*
+ * nnet_bin_unmap
+ *
+ * Unmaps a previously mapped model. Codebooks of the model must be
+ * destroyed before.
+ */
+int
+nnet_bin_unmap (NNetModel * model)
+{
+  if (model == NULL || *model == NULL)
+    {
+      fprintf (stderr, "nnet_bin_unmap: no model passed\n");
+      return EXIT_FAILURE;
+    }
+
+  if (munmap ((*model)->address, (*model)->length) != 0)
+    {
+      fprintf (stderr, "nnet_bin_unmap: %s\n", strerror (errno));
+      return EXIT_FAILURE;
+    }
+
+  free (*model);
+  *model = NULL;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_bin_codebook
+ *
+ * Creates a codebook of the input weights of the given layer (starting at
+ * 1) that reads them straight from the mapping, with no layer nor units
+ */
+Codebook
+nnet_bin_codebook (const NNetModel model, const LayerIndex layer_index)
+{
+  Codebook new_codebook = NULL; /* new codebook */
+  const nnet_bin_layer_type *desc;      /* layer descriptor */
+  UnitIndex cur_col;            /* current column */
+
+
+  if (model == NULL)
+    {
+      fprintf (stderr, "nnet_bin_codebook: no model passed\n");
+      return NULL;
+    }
+
+  if (layer_index < 1 || layer_index > model->header->nu_layers)
+    {
+      fprintf (stderr, "nnet_bin_codebook: layer %u out of range\n",
+               layer_index);
+      return NULL;
+    }
+
+  desc = &(model->layers[layer_index - 1]);
+
+  if (desc->nu_inputs == 0)
+    {
+      fprintf (stderr, "nnet_bin_codebook: layer units have no inputs\n");
+      return NULL;
+    }
+
+  /* Outputs are not computed, so they must rank as the activations */
+  if (desc->monotone != TRUE)
+    {
+      fprintf (stderr,
+               "nnet_bin_codebook: layer activation function is not increasing\n");
+      return NULL;
+    }
+
+  new_codebook = (Codebook) malloc (sizeof (nnet_codebook_type));
+
+  if (new_codebook == NULL)
+    {
+      fprintf (stderr, "nnet_bin_codebook: virtual memory exhausted\n");
+      return NULL;
+    }
+
+  new_codebook->layer = NULL;
+  new_codebook->nu_units = desc->nu_units;
+  new_codebook->dimension = desc->nu_inputs;
+  new_codebook->weights =
+    (RValue *) ((char *) model->address + desc->weights_offset);
+  new_codebook->units = NULL;
+  new_codebook->index = NULL;
+  new_codebook->grid_degree = 0;
+  new_codebook->grid = NULL;
+  new_codebook->monotone = TRUE;
+  new_codebook->mapped = TRUE;
+
+  /* Columns are visited in their natural order until told otherwise */
+  new_codebook->order = (UnitIndex *)
+    malloc (new_codebook->dimension * sizeof (UnitIndex));
+
+  if (new_codebook->order == NULL)
+    {
+      fprintf (stderr, "nnet_bin_codebook: virtual memory exhausted\n");
+      free (new_codebook);
+      return NULL;
+    }
+
+  for (cur_col = 0; cur_col < new_codebook->dimension; cur_col++)
+    new_codebook->order[cur_col] = cur_col;
+
+  return new_codebook;
+}
+
+
+
+/*
+ * nnet_bin_state
+ *
+ * Returns the training state block of the given model, and its size in
+ * 'state_size', or NULL if the model has none
+ */
+const void *
+nnet_bin_state (const NNetModel model, size_t * state_size)
+{
+  if (model == NULL)
+    {
+      fprintf (stderr, "nnet_bin_state: no model passed\n");
+      return NULL;
+    }
+
+  *state_size = (size_t) model->header->state_size;
+
+  if (*state_size == 0)
+    return NULL;
+
+  return (const char *) model->address + model->header->state_offset;
+}
+
+
+
+/*
+ * nnet_bin_create_nnetwork
+ *
+ * Creates a new neural network from the given model. SOM networks get
+ * their extension back; LVQ networks are rebuilt by
+ * nnet_lvq_create_from_model.
+ */
+NNetwork
+nnet_bin_create_nnetwork (const NNetModel model)
+{
+  NNetwork new_nnet = NULL;     /* new neural network */
+  const nnet_bin_layer_type *desc;      /* current layer descriptor */
+  const RValue *block;          /* current coordinates or weights */
+  Layer layer = NULL;           /* current layer */
+  Layer origin = NULL;          /* current origin layer */
+  Unit cur_unit = NULL;         /* current unit */
+  Unit cur_orig = NULL;         /* current origin unit */
+  Vector coord = NULL;          /* current unit coordinates */
+  LayerClass layer_class;       /* current layer class */
+  ActivationClass actv_class;   /* current activation class */
+  WeightInitClass wght_class;   /* current weight initialization class */
+  NgbFunctionClass ngb_class;   /* neighborhood function class */
+  LRateFunctionClass lrate_class;       /* learning rate function class */
+  Name class_name;              /* current class name */
+  Name name;                    /* current network or layer name */
+  RValue parameters[RFUNC_MAX_PARAMETERS];      /* function parameters */
+  RValue parameters_2[RFUNC_MAX_PARAMETERS];    /* function parameters */
+  LayerIndex cur_layer;         /* current layer position */
+  UnitIndex cur_row;            /* current unit position */
+  UnitIndex cur_col;            /* current input position */
+
+
+  if (model == NULL)
+    {
+      fprintf (stderr, "nnet_bin_create_nnetwork: no model passed\n");
+      return NULL;
+    }
+
+  memcpy (name, model->header->name, NAME_SIZE);
+  name[NAME_SIZE] = '\0';
+
+  new_nnet = nnet_nnetwork_create (name, NULL);
+
+  if (new_nnet == NULL)
+    {
+      fprintf (stderr,
+               "nnet_bin_create_nnetwork: error creating neural network\n");
+      return NULL;
+    }
+
+  for (cur_layer = 0; cur_layer < model->header->nu_layers; cur_layer++)
+    {
+      desc = &(model->layers[cur_layer]);
+
+      /* Creates the layer */
+      strcpy (class_name, nnet_layer_class_name[desc->position]);
+      layer_class = nnet_layer_class_by_name (class_name);
+
+      memcpy (name, desc->name, NAME_SIZE);
+      name[NAME_SIZE] = '\0';
+
+      layer = nnet_layer_create (new_nnet, NULL, layer_class, name);
+
+      if (layer == NULL)
+        {
+          fprintf (stderr,
+                   "nnet_bin_create_nnetwork: error creating layer '%s'\n",
+                   name);
+          nnet_nnetwork_destroy (&new_nnet, TRUE, TRUE, TRUE, TRUE);
+          return NULL;
+        }
+
+      /* Creates the units */
+      nnet_bin_load_function (&(desc->activation), class_name, parameters);
+      actv_class = nnet_actv_class_by_name (class_name);
+
+      block = (const RValue *)
+        ((const char *) model->address + desc->coords_offset);
+
+      for (cur_row = 0; cur_row < desc->nu_units; cur_row++)
+        {
+          coord = NULL;
+
+          if (desc->coord_dimension > 0)
+            {
+              coord = vector_create (desc->coord_dimension);
+
+              if (coord == NULL)
+                {
+                  fprintf (stderr,
+                           "nnet_bin_create_nnetwork: error creating unit coordinates\n");
+                  nnet_nnetwork_destroy (&new_nnet, TRUE, TRUE, TRUE, TRUE);
+                  return NULL;
+                }
+
+              memcpy (coord->value, &(block[cur_row * desc->coord_dimension]),
+                      desc->coord_dimension * sizeof (RValue));
+            }
+
+          if (nnet_unit_create (layer, NULL, actv_class, parameters,
+                                FALSE, FALSE, coord) == NULL)
+            {
+              fprintf (stderr,
+                       "nnet_bin_create_nnetwork: error creating unit\n");
+              nnet_nnetwork_destroy (&new_nnet, TRUE, TRUE, TRUE, TRUE);
+              return NULL;
+            }
+        }
+
+      if (desc->nu_inputs == 0)
+        continue;
+
+      /* Connects the units, copying the weights */
+      origin = nnet_layer_by_index (new_nnet, desc->origin_layer);
+
+      nnet_bin_load_function (&(desc->weight_init), class_name, parameters);
+      wght_class = nnet_wght_class_by_name (class_name);
+
+      block = (const RValue *)
+        ((const char *) model->address + desc->weights_offset);
+
+      cur_unit = layer->first_unit;
+
+      for (cur_row = 0; cur_unit != NULL; cur_row++)
+        {
+          cur_orig = origin->first_unit;
+
+          for (cur_col = 0; cur_col < desc->nu_inputs; cur_col++)
+            {
+              if (nnet_conn_create
+                  (cur_orig, cur_unit, block[cur_row * desc->nu_inputs +
+                                             cur_col], wght_class,
+                   parameters) == NULL)
+                {
+                  fprintf (stderr,
+                           "nnet_bin_create_nnetwork: error connecting units\n");
+                  nnet_nnetwork_destroy (&new_nnet, TRUE, TRUE, TRUE, TRUE);
+                  return NULL;
+                }
+
+              cur_orig = cur_orig->next;
+            }
+
+          cur_unit = cur_unit->next;
+        }
+    }
+
+  /* SOM extension */
+  if (model->header->extension == NNEXT_SOM)
+    {
+      nnet_bin_load_function (&(model->header->functions[0]), class_name,
+                              parameters);
+      ngb_class = nnet_som_ngb_class_by_name (class_name);
+
+      nnet_bin_load_function (&(model->header->functions[1]), class_name,
+                              parameters_2);
+      lrate_class = nnet_train_lrate_class_by_name (class_name);
+
+      if (nnet_som_create (new_nnet, ngb_class, parameters, lrate_class,
+                           parameters_2) == NULL)
+        {
+          fprintf (stderr,
+                   "nnet_bin_create_nnetwork: error creating SOM extension\n");
+          nnet_nnetwork_destroy (&new_nnet, TRUE, TRUE, TRUE, TRUE);
+          return NULL;
+        }
+    }
+
+  return new_nnet;
+}
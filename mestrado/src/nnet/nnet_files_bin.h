@@ -0,0 +1,230 @@
+#ifndef __NNET_FILES_BIN_H_
+#define __NNET_FILES_BIN_H_ 1
+
+#include <stddef.h>
+#include "nnet_types.h"
+#include "nnet_codebook.h"
+#include "../function/function.h"
+
+
+/******************************************************************************
+ *                                                                            *
+ *                        PUBLIC DATATYPES AND VARIABLES                      *
+ *                                                                            *
+ ******************************************************************************/
+
+/* File identification */
+#define NNET_BIN_MAGIC "NNETBIN"
+#define NNET_BIN_MAGIC_SIZE 8
+#define NNET_BIN_VERSION 2
+
+/* Written as is: reads back as another value on other byte orders */
+#define NNET_BIN_ORDER_MARK 0x01020304UL
+
+/* Alignment of the blocks of the file */
+#define NNET_BIN_ALIGN 64
+
+
+
+/*
+ * nnet_bin_function_type
+ *
+ * Function class name and parameters stored in a model file
+ */
+typedef struct
+{
+  Name class_name;
+  UsLgIntValue nu_parameters;
+  RValue parameters[RFUNC_MAX_PARAMETERS];
+}
+nnet_bin_function_type;
+
+
+
+/*
+ * nnet_bin_header_type
+ *
+ * Header at the start of a binary model file.
+ * Binary models keep the memory layout of the machine that wrote them:
+ * the byte order mark and the sizes of the basic types and of the file
+ * records are checked before a file is mapped. All offsets count bytes
+ * from the start of the file and are multiples of NNET_BIN_ALIGN.
+ * The extension functions are the neighborhood and learning rate
+ * functions of SOM networks, and the learning rate function of LVQ
+ * networks, which also store the class of each output unit (if set).
+ * Checkpoints written during training may carry a training state block,
+ * which the binary format keeps as opaque bytes.
+ */
+typedef struct
+{
+  char magic[NNET_BIN_MAGIC_SIZE];      /* NNET_BIN_MAGIC */
+  UsLgIntValue version;                 /* NNET_BIN_VERSION */
+  UsLgIntValue order_mark;              /* NNET_BIN_ORDER_MARK */
+  UsLgIntValue value_size;              /* sizeof (RValue) */
+  UsLgIntValue index_size;              /* sizeof (UsLgIntValue) */
+  UsLgIntValue header_size;             /* sizeof (nnet_bin_header_type) */
+  UsLgIntValue layer_size;              /* sizeof (nnet_bin_layer_type) */
+  UsLgIntValue file_size;               /* total bytes in the file */
+
+  /* network */
+  Name name;                            /* network name */
+  UsLgIntValue extension;               /* NExtensionIndex */
+  UsLgIntValue nu_layers;               /* number of layer descriptors */
+  UsLgIntValue layers_offset;           /* layer descriptors */
+
+  /* extension */
+  nnet_bin_function_type functions[2];  /* extension functions */
+  UsLgIntValue lvq_algorithm;           /* LVQ training algorithm */
+  UsLgIntValue lvq_metric;              /* LVQ activation metric */
+  UsLgIntValue nu_classes;              /* LVQ output unit classes */
+  UsLgIntValue classes_offset;          /* nu_classes class values */
+
+  /* training state */
+  UsLgIntValue state_offset;            /* training state block */
+  UsLgIntValue state_size;              /* bytes in the block (0: none) */
+}
+nnet_bin_header_type;
+
+
+
+/*
+ * nnet_bin_layer_type
+ *
+ * Layer descriptor of a binary model file.
+ * All the units of a layer share one activation function and, if they
+ * have inputs, are fully connected to the units of one earlier layer
+ * (the origin layer) in the order of the origin units, so the input
+ * weights of the layer make a dense nu_units x nu_inputs block. The
+ * coordinates of the units make a nu_units x coord_dimension block.
+ */
+typedef struct
+{
+  Name name;                            /* layer name */
+  UsLgIntValue position;                /* LayerPosition */
+  nnet_bin_function_type activation;    /* units activation function */
+  UsLgIntValue nu_units;                /* number of units */
+  UsLgIntValue coord_dimension;         /* unit coordinates (0: none) */
+  UsLgIntValue coords_offset;           /* unit coordinates block */
+  UsLgIntValue origin_layer;            /* origin layer index (0: none) */
+  UsLgIntValue nu_inputs;               /* inputs of each unit */
+  nnet_bin_function_type weight_init;   /* weight initialization function */
+  UsLgIntValue weights_offset;          /* input weights block */
+  UsLgIntValue monotone;                /* increasing activation function */
+}
+nnet_bin_layer_type;
+
+
+
+/*
+ * nnet_bin_model_type
+ *
+ * Binary model file mapped into memory. The mapping is private: writing
+ * to its weights doesn't change the file.
+ */
+typedef struct
+{
+  void *address;                        /* mapping address */
+  size_t length;                        /* mapping length */
+  const nnet_bin_header_type *header;   /* file header */
+  const nnet_bin_layer_type *layers;    /* layer descriptors */
+}
+nnet_bin_model_type;
+
+
+/* Symbolic type */
+typedef nnet_bin_model_type *NNetModel;
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                              PUBLIC OPERATIONS                             *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * nnet_bin_write_nnetwork
+ *
+ * Writes the given neural network to the given binary model file
+ */
+extern int
+nnet_bin_write_nnetwork (const NNetwork nnet, const char *file_name);
+
+
+
+/*
+ * nnet_bin_write_checkpoint
+ *
+ * Writes the given neural network to the given binary model file, followed
+ * by the given training state block
+ */
+extern int
+nnet_bin_write_checkpoint (const NNetwork nnet,
+                           const void *state, const size_t state_size,
+                           const char *file_name);
+
+
+
+/*
+ * nnet_bin_is_model
+ *
+ * Checks if the given file starts as a binary model file
+ */
+extern BoolValue nnet_bin_is_model (const char *file_name);
+
+
+
+/*
+ * nnet_bin_map
+ *
+ * Maps the given binary model file into memory, checking its header and
+ * the bounds of its blocks
+ */
+extern NNetModel nnet_bin_map (const char *file_name);
+
+
+
+/*
+ * nnet_bin_unmap
+ *
+ * Unmaps a previously mapped model. Codebooks of the model must be
+ * destroyed before.
+ */
+extern int nnet_bin_unmap (NNetModel * model);
+
+
+
+/*
+ * nnet_bin_codebook
+ *
+ * Creates a codebook of the input weights of the given layer (starting at
+ * 1) that reads them straight from the mapping, with no layer nor units
+ */
+extern Codebook
+nnet_bin_codebook (const NNetModel model, const LayerIndex layer_index);
+
+
+
+/*
+ * nnet_bin_state
+ *
+ * Returns the training state block of the given model, and its size in
+ * 'state_size', or NULL if the model has none
+ */
+extern const void *
+nnet_bin_state (const NNetModel model, size_t * state_size);
+
+
+
+/*
+ * nnet_bin_create_nnetwork
+ *
+ * Creates a new neural network from the given model. SOM networks get
+ * their extension back; LVQ networks are rebuilt by
+ * nnet_lvq_create_from_model.
+ */
+extern NNetwork nnet_bin_create_nnetwork (const NNetModel model);
+
+
+
+#endif /* __NNET_FILES_BIN_H_ */
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "nnet_files.h"
 #include "nnet_files_nnet.h"
 #include "nnet_nnet.h"
@@ -22,17 +23,31 @@
  *                                                                            *
  ******************************************************************************/
 
-static NNetwork nnet = NULL;    /* new neural network */
-static NExtensionIndex ext_index = NNEXT_GEN;   /* extension index */
-static NExtension extension = NULL;     /* neural network extension */
-static Layer layer = NULL;      /* last layer created */
-static SomNNetwork som_nnet = NULL;     /* SOM extension */
-static char stdin_prompt[60] = __STDIN_PROMPT_; /* standard input prompt */
+/*
+ * nnet_file_context_type
+ *
+ * State of the reading of one configuration file, so different threads
+ * can read files at the same time
+ */
+typedef struct
+{
+  nnet_file_parser_type parser; /* configuration file parser */
+  NNetwork nnet;                /* new neural network */
+  NExtensionIndex ext_index;    /* extension index */
+  NExtension extension;         /* neural network extension */
+  Layer layer;                  /* last layer created */
+  SomNNetwork som_nnet;         /* SOM extension */
+  char stdin_prompt[60];        /* standard input prompt */
+}
+nnet_file_context_type;
+
+
 
 /*
  * NNetFile
  *
- * Set of sections and attributes that compound a configuration file
+ * Set of sections and attributes that compound a configuration file.
+ * Read only.
  */
 static NFile nnetfile = {
 
@@ -161,8 +176,10 @@ static NFile nnetfile = {
  * Creates the neural network according to the section attributes
  */
 static int
-nnet_file_process_nnetwork ()
+nnet_file_process_nnetwork (nnet_file_context_type * context)
 {
+  NFileParser parser = &(context->parser);      /* file parser */
+  UsIntValue cur_attr;          /* current attribute */
   BoolValue end_of_section = FALSE;     /* end of section found */
   CompositeUnion value;                 /* current attribute value */
   int exit_status;                      /* auxiliary function return status */
@@ -174,8 +191,8 @@ nnet_file_process_nnetwork ()
     {
       /* Reads a new attribute */
       exit_status =
-        nnet_file_read_attribute (nnetfile, &cur_attr, &end_of_section,
-                                  __NNIGNORE_, stdin_prompt);
+        nnet_file_read_attribute (parser, nnetfile, &cur_attr, &end_of_section,
+                                  __NNIGNORE_, context->stdin_prompt);
 
       if (exit_status != EXIT_SUCCESS)
         {
@@ -191,13 +208,13 @@ nnet_file_process_nnetwork ()
             {
             case __NNATT_NNET_NAME_:
               value.stringvalue = nnet_name;
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               break;
 
             case __NNATT_NNET_EXT_:
               value.stringvalue = ext_name;
-              nnet_file_parse_attribute (nnetfile, &value);
-              ext_index = nnet_extension_by_name (ext_name);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
+              context->ext_index = nnet_extension_by_name (ext_name);
               break;
 
             default:
@@ -209,8 +226,8 @@ nnet_file_process_nnetwork ()
       else
         {
           /* Creates the neural network */
-          nnet = nnet_nnetwork_create (nnet_name, extension);
-          if (nnet == NULL)
+          context->nnet = nnet_nnetwork_create (nnet_name, context->extension);
+          if (context->nnet == NULL)
             {
               fprintf (stderr,
                        "nnet_file_process_nnetwork: error creating neural network\n");
@@ -230,8 +247,10 @@ nnet_file_process_nnetwork ()
  * Creates a new SOM extension according to the section attributes
  */
 static int
-nnet_file_process_som ()
+nnet_file_process_som (nnet_file_context_type * context)
 {
+  NFileParser parser = &(context->parser);      /* file parser */
+  UsIntValue cur_attr;          /* current attribute */
   BoolValue end_of_section = FALSE;     /* end of section found */
   CompositeUnion value;         /* current attribute value */
   int exit_status;              /* auxiliary function return status */
@@ -250,8 +269,8 @@ nnet_file_process_som ()
     {
       /* Reads a new attribute */
       exit_status =
-        nnet_file_read_attribute (nnetfile, &cur_attr, &end_of_section,
-                                  __NNIGNORE_, stdin_prompt);
+        nnet_file_read_attribute (parser, nnetfile, &cur_attr, &end_of_section,
+                                  __NNIGNORE_, context->stdin_prompt);
 
       if (exit_status != EXIT_SUCCESS)
         {
@@ -267,23 +286,23 @@ nnet_file_process_som ()
             {
             case __NNATT_XSOM_NGB_CLASS_:
               value.stringvalue = ngb_name;
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               ngb_class = nnet_som_ngb_class_by_name (ngb_name);
               break;
 
             case __NNATT_XSOM_NGB_PARM_:
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               ngb_parm = value.rvectorvalue->value;
               break;
 
             case __NNATT_XSOM_LRATE_CLASS_:
               value.stringvalue = lrate_name;
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               lrate_class = nnet_train_lrate_class_by_name (lrate_name);
               break;
 
             case __NNATT_XSOM_LRATE_PARM_:
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               lrate_parm = value.rvectorvalue->value;
               break;
 
@@ -296,10 +315,10 @@ nnet_file_process_som ()
       else
         {
           /* Creates the SOM extension */
-          som_nnet = nnet_som_create
-            (nnet, ngb_class, ngb_parm, lrate_class, lrate_parm);
+          context->som_nnet = nnet_som_create
+            (context->nnet, ngb_class, ngb_parm, lrate_class, lrate_parm);
 
-          if (som_nnet == NULL)
+          if (context->som_nnet == NULL)
             {
               fprintf (stderr,
                        "nnet_file_process_som: error creating SOM extension\n");
@@ -308,7 +327,7 @@ nnet_file_process_som ()
             }
 
           /* Sets the global extension */
-          extension = som_nnet;
+          context->extension = context->som_nnet;
         }
     }
 
@@ -323,8 +342,10 @@ nnet_file_process_som ()
  * Creates a new layer according to the section attributes
  */
 static int
-nnet_file_process_layer ()
+nnet_file_process_layer (nnet_file_context_type * context)
 {
+  NFileParser parser = &(context->parser);      /* file parser */
+  UsIntValue cur_attr;          /* current attribute */
   BoolValue end_of_section = FALSE;     /* end of section found */
   CompositeUnion value;         /* current attribute value */
   int exit_status;              /* auxiliary function return status */
@@ -347,8 +368,8 @@ nnet_file_process_layer ()
     {
       /* Reads a new attribute */
       exit_status =
-        nnet_file_read_attribute (nnetfile, &cur_attr, &end_of_section,
-                                  __NNIGNORE_, stdin_prompt);
+        nnet_file_read_attribute (parser, nnetfile, &cur_attr, &end_of_section,
+                                  __NNIGNORE_, context->stdin_prompt);
 
       if (exit_status != EXIT_SUCCESS)
         {
@@ -363,46 +384,46 @@ nnet_file_process_layer ()
           switch (cur_attr)
             {
             case __NNATT_LAYR_INDEX_:
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               index = value.usintvalue;
               break;
 
             case __NNATT_LAYR_NAME_:
               value.stringvalue = name;
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               break;
 
             case __NNATT_LAYR_CLASS_:
               value.stringvalue = class_name;
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               layer_class = nnet_layer_class_by_name (class_name);
               break;
 
             case __NNATT_LAYR_NU_UNITS_:
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               nu_units = value.uslgintvalue;
               break;
 
             case __NNATT_LAYR_ACTV_CLASS_:
               value.stringvalue = actv_name;
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               actv_class = nnet_actv_class_by_name (actv_name);
               dft_actv_class = FALSE;
               break;
 
             case __NNATT_LAYR_ACTV_PARM_:
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               actv_parm = value.rvectorvalue->value;
               dft_actv_parm = FALSE;
               break;
 
             case __NNATT_LAYR_DIST_VECTOR_:
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               dist_vector = value.rvectorvalue;
               break;
 
             case __NNATT_LAYR_INCR_VECTOR_:
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               incr_vector = value.rvectorvalue;
               break;
 
@@ -415,9 +436,10 @@ nnet_file_process_layer ()
       else
         {
           /* Creates the layer */
-          layer = nnet_layer_create (nnet, &index, layer_class, name);
+          context->layer =
+            nnet_layer_create (context->nnet, &index, layer_class, name);
 
-          if (layer == NULL)
+          if (context->layer == NULL)
             {
               fprintf (stderr,
                        "nnet_file_process_layer: error creating layer\n");
@@ -428,8 +450,8 @@ nnet_file_process_layer ()
           if (nu_units > 0)
             {
               exit_status = nnet_unit_create_multiple
-                (nu_units, layer, actv_class, actv_parm, dft_actv_class,
-                 dft_actv_parm, dist_vector, incr_vector);
+                (nu_units, context->layer, actv_class, actv_parm,
+                 dft_actv_class, dft_actv_parm, dist_vector, incr_vector);
 
               if (exit_status != EXIT_SUCCESS)
                 {
@@ -453,8 +475,10 @@ nnet_file_process_layer ()
  * Creates a new layer according to the section attributes
  */
 static int
-nnet_file_process_unit ()
+nnet_file_process_unit (nnet_file_context_type * context)
 {
+  NFileParser parser = &(context->parser);      /* file parser */
+  UsIntValue cur_attr;          /* current attribute */
   BoolValue end_of_section = FALSE;     /* end of section found */
   CompositeUnion value;         /* current attribute value */
   int exit_status;              /* auxiliary function return status */
@@ -475,8 +499,8 @@ nnet_file_process_unit ()
     {
       /* Reads a new attribute */
       exit_status =
-        nnet_file_read_attribute (nnetfile, &cur_attr, &end_of_section,
-                                  __NNIGNORE_, stdin_prompt);
+        nnet_file_read_attribute (parser, nnetfile, &cur_attr, &end_of_section,
+                                  __NNIGNORE_, context->stdin_prompt);
 
       if (exit_status != EXIT_SUCCESS)
         {
@@ -491,33 +515,33 @@ nnet_file_process_unit ()
           switch (cur_attr)
             {
             case __NNATT_UNIT_LINDEX_:
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               lindex = value.usintvalue;
-              int_layer = nnet_layer_by_index (nnet, lindex);
+              int_layer = nnet_layer_by_index (context->nnet, lindex);
               if (int_layer == NULL)
-                int_layer = layer;
+                int_layer = context->layer;
               break;
 
             case __NNATT_UNIT_INDEX_:
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               index = value.uslgintvalue;
               break;
 
             case __NNATT_UNIT_ACTV_CLASS_:
               value.stringvalue = actv_name;
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               actv_class = nnet_actv_class_by_name (actv_name);
               dft_actv_class = FALSE;
               break;
 
             case __NNATT_UNIT_ACTV_PARM_:
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               actv_parm = value.rvectorvalue->value;
               dft_actv_parm = FALSE;
               break;
 
             case __NNATT_UNIT_COORD_:
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               coord = value.rvectorvalue;
               break;
 
@@ -552,8 +576,10 @@ nnet_file_process_unit ()
  * Connects two units according to the section attributes
  */
 static int
-nnet_file_process_connection ()
+nnet_file_process_connection (nnet_file_context_type * context)
 {
+  NFileParser parser = &(context->parser);      /* file parser */
+  UsIntValue cur_attr;          /* current attribute */
   BoolValue end_of_section = FALSE;     /* end of section found */
   CompositeUnion value;         /* current attribute value */
   int exit_status;              /* auxiliary function return status */
@@ -575,8 +601,8 @@ nnet_file_process_connection ()
     {
       /* Reads a new attribute */
       exit_status =
-        nnet_file_read_attribute (nnetfile, &cur_attr, &end_of_section,
-                                  __NNIGNORE_, stdin_prompt);
+        nnet_file_read_attribute (parser, nnetfile, &cur_attr, &end_of_section,
+                                  __NNIGNORE_, context->stdin_prompt);
 
       if (exit_status != EXIT_SUCCESS)
         {
@@ -591,58 +617,58 @@ nnet_file_process_connection ()
           switch (cur_attr)
             {
             case __NNATT_CONN_OLAYER_:
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               orig_layer_index = value.usintvalue;
               if (orig_unit_index != -1)
                 {
                   orig_unit = nnet_unit_by_index
-                    (nnet, orig_layer_index, orig_unit_index);
+                    (context->nnet, orig_layer_index, orig_unit_index);
                 }
               break;
 
             case __NNATT_CONN_DLAYER_:
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               dest_layer_index = value.usintvalue;
               if (dest_unit_index != -1)
                 {
                   dest_unit = nnet_unit_by_index
-                    (nnet, dest_layer_index, dest_unit_index);
+                    (context->nnet, dest_layer_index, dest_unit_index);
                 }
               break;
 
             case __NNATT_CONN_OUNIT_:
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               orig_unit_index = value.uslgintvalue;
               if (orig_layer_index != -1)
                 {
                   orig_unit = nnet_unit_by_index
-                    (nnet, orig_layer_index, orig_unit_index);
+                    (context->nnet, orig_layer_index, orig_unit_index);
                 }
               break;
 
             case __NNATT_CONN_DUNIT_:
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               dest_unit_index = value.uslgintvalue;
               if (dest_layer_index != -1)
                 {
                   dest_unit = nnet_unit_by_index
-                    (nnet, dest_layer_index, dest_unit_index);
+                    (context->nnet, dest_layer_index, dest_unit_index);
                 }
               break;
 
             case __NNATT_CONN_WEIGHT_:
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               weight = value.realvalue;
               break;
 
             case __NNATT_CONN_WEIGHT_CLASS_:
               value.stringvalue = wght_name;
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               wght_class = nnet_wght_class_by_name (wght_name);
               break;
 
             case __NNATT_CONN_WEIGHT_PARM_:
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               wght_parm = value.rvectorvalue->value;
               break;
 
@@ -678,8 +704,10 @@ nnet_file_process_connection ()
  * Connects layers according to section attributes
  */
 static int
-nnet_file_process_layer_connection ()
+nnet_file_process_layer_connection (nnet_file_context_type * context)
 {
+  NFileParser parser = &(context->parser);      /* file parser */
+  UsIntValue cur_attr;          /* current attribute */
   BoolValue end_of_section = FALSE;     /* end of section found */
   CompositeUnion value;         /* current attribute value */
   int exit_status;              /* auxiliary function return status */
@@ -698,8 +726,8 @@ nnet_file_process_layer_connection ()
     {
       /* Reads a new attribute */
       exit_status =
-        nnet_file_read_attribute (nnetfile, &cur_attr, &end_of_section,
-                                  __NNIGNORE_, stdin_prompt);
+        nnet_file_read_attribute (parser, nnetfile, &cur_attr, &end_of_section,
+                                  __NNIGNORE_, context->stdin_prompt);
 
       if (exit_status != EXIT_SUCCESS)
         {
@@ -714,30 +742,32 @@ nnet_file_process_layer_connection ()
           switch (cur_attr)
             {
             case __NNATT_LCNN_ORIGIN_:
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               orig_layer_index = value.usintvalue;
-              orig_layer = nnet_layer_by_index (nnet, orig_layer_index);
+              orig_layer =
+                nnet_layer_by_index (context->nnet, orig_layer_index);
               break;
 
             case __NNATT_LCNN_DESTINATION_:
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               dest_layer_index = value.usintvalue;
-              dest_layer = nnet_layer_by_index (nnet, dest_layer_index);
+              dest_layer =
+                nnet_layer_by_index (context->nnet, dest_layer_index);
               break;
 
             case __NNATT_LCNN_INITIAL_WEIGHT_:
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               initial_weight = value.realvalue;
               break;
 
             case __NNATT_LCNN_WEIGHT_CLASS_:
               value.stringvalue = wginit_name;
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               wginit_class = nnet_wght_class_by_name (wginit_name);
               break;
 
             case __NNATT_LCNN_WEIGHT_PARM_:
-              nnet_file_parse_attribute (nnetfile, &value);
+              nnet_file_parse_attribute (parser, nnetfile, &value);
               wginit_parm = value.rvectorvalue->value;
               break;
 
@@ -775,7 +805,8 @@ nnet_file_process_layer_connection ()
  * Processes one section according to its ID
  */
 static int
-nnet_file_process_section (int section_id)
+nnet_file_process_section (nnet_file_context_type * context,
+                           int section_id)
 {
   int exit_status;              /* auxiliary function return status */
 
@@ -787,7 +818,7 @@ nnet_file_process_section (int section_id)
   switch (section_id)
     {
     case __NNSEC_NNET_:
-      exit_status = nnet_file_process_nnetwork ();
+      exit_status = nnet_file_process_nnetwork (context);
 
       if (exit_status != EXIT_SUCCESS)
         {
@@ -799,7 +830,7 @@ nnet_file_process_section (int section_id)
 
 
     case __NNSEC_XSOM_:
-      exit_status = nnet_file_process_som ();
+      exit_status = nnet_file_process_som (context);
 
       if (exit_status != EXIT_SUCCESS)
         {
@@ -811,7 +842,7 @@ nnet_file_process_section (int section_id)
 
 
     case __NNSEC_LAYR_:
-      exit_status = nnet_file_process_layer ();
+      exit_status = nnet_file_process_layer (context);
 
       if (exit_status != EXIT_SUCCESS)
         {
@@ -823,7 +854,7 @@ nnet_file_process_section (int section_id)
 
 
     case __NNSEC_UNIT_:
-      exit_status = nnet_file_process_unit ();
+      exit_status = nnet_file_process_unit (context);
 
       if (exit_status != EXIT_SUCCESS)
         {
@@ -835,7 +866,7 @@ nnet_file_process_section (int section_id)
 
 
     case __NNSEC_CONN_:
-      exit_status = nnet_file_process_connection ();
+      exit_status = nnet_file_process_connection (context);
 
       if (exit_status != EXIT_SUCCESS)
         {
@@ -847,7 +878,7 @@ nnet_file_process_section (int section_id)
 
 
     case __NNSEC_LCNN_:
-      exit_status = nnet_file_process_layer_connection ();
+      exit_status = nnet_file_process_layer_connection (context);
 
       if (exit_status != EXIT_SUCCESS)
         {
@@ -862,8 +893,8 @@ nnet_file_process_section (int section_id)
       return EXIT_FAILURE;
     }
 
-  cur_section = -1;
-  cur_attr = 0;
+  context->parser.cur_section = -1;
+  context->parser.cur_attr = 0;
 
   return EXIT_SUCCESS;
 }
@@ -1057,6 +1088,7 @@ nnet_file_write_connection_section (Connection connection, FILE * output_fd)
 NNetwork
 nnet_file_create_nnetwork (FILE * in_fd)
 {
+  nnet_file_context_type context;       /* parsing context */
   int exit_status;              /* auxiliary function return status */
 
 
@@ -1067,17 +1099,24 @@ nnet_file_create_nnetwork (FILE * in_fd)
       return NULL;
     }
 
-  /* Sets the global input file descriptor */
-  input_fd = in_fd;
+  /* Initializes the parsing context */
+  nnet_file_parser_init (&(context.parser), in_fd);
+  context.nnet = NULL;
+  context.ext_index = NNEXT_GEN;
+  context.extension = NULL;
+  context.layer = NULL;
+  context.som_nnet = NULL;
+  strcpy (context.stdin_prompt, __STDIN_PROMPT_);
 
   /* Reads and parses the file */
-  while (!feof (input_fd))
+  while (!feof (in_fd))
     {
       /* Searches a section start tag */
-      exit_status = nnet_file_read_section (nnetfile, __NNSECTIONS_,
-                                            __NNIGNORE_, stdin_prompt);
+      exit_status = nnet_file_read_section (&(context.parser), nnetfile,
+                                            __NNSECTIONS_, __NNIGNORE_,
+                                            context.stdin_prompt);
 
-      if (exit_status != EXIT_SUCCESS && !feof (input_fd))
+      if (exit_status != EXIT_SUCCESS && !feof (in_fd))
         {
           fprintf (stderr,
                    "nnet_file_create_nnetwork: error searching section start tag\n");
@@ -1085,36 +1124,37 @@ nnet_file_create_nnetwork (FILE * in_fd)
         }
 
       /* Processes the section */
-      if (!feof (input_fd))
+      if (!feof (in_fd))
         {
           /* Sets the standard input prompt */
-          if (input_fd == stdin)
-            sprintf (stdin_prompt, "%s%s ",
-                     __STDIN_PROMPT_, nnetfile[cur_section].begin);
+          if (in_fd == stdin)
+            sprintf (context.stdin_prompt, "%s%s ", __STDIN_PROMPT_,
+                     nnetfile[context.parser.cur_section].begin);
 
-          exit_status = nnet_file_process_section (cur_section);
+          exit_status = nnet_file_process_section
+            (&context, context.parser.cur_section);
           if (exit_status != EXIT_SUCCESS)
             {
               fprintf (stderr,
                        "nnet_file_create_nnetwork: error processing section %s\n",
-                       nnetfile[cur_section].begin);
+                       nnetfile[context.parser.cur_section].begin);
               return NULL;
             }
           /* Resets the standard input prompt */
-          if (input_fd == stdin)
-            sprintf (stdin_prompt, "%s", __STDIN_PROMPT_);
+          if (in_fd == stdin)
+            sprintf (context.stdin_prompt, "%s", __STDIN_PROMPT_);
         }
     }
 
 
-  if (nnet == NULL)
+  if (context.nnet == NULL)
     {
       fprintf (stderr,
                "nnet_file_create_nnetwork: invalid neural network configuration file\n");
       return NULL;
     }
 
-  return nnet;
+  return context.nnet;
 }
 
 
@@ -1159,7 +1199,7 @@ nnet_file_write_nnetwork (const NNetwork nnet,
 
         case NNEXT_SOM:
           fprintf (output_fd, "\n");
-          nnet_file_write_som_section (som_nnet, output_fd);
+          nnet_file_write_som_section (nnet->extension, output_fd);
           break;
 
         case NNEXT_LVQ:
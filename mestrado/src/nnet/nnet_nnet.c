@@ -3,6 +3,8 @@
 #include <string.h>
 #include "nnet_nnet.h"
 #include "nnet_layers.h"
+#include "nnet_units.h"
+#include "nnet_conns.h"
 #include "nnet_actv.h"
 #include "nnet_weights.h"
 #include "nnet_train.h"
@@ -253,6 +255,180 @@ nnet_nnetwork_destroy (NNetwork * nnet,
 
 
 
+/*
+ * nnet_nnetwork_copy
+ *
+ * Creates a new neural network with the same layers, units, connections,
+ * weights and extension as the given one
+ */
+NNetwork
+nnet_nnetwork_copy (const NNetwork nnet)
+{
+  NNetwork new_nnet = NULL;     /* copy of the neural network */
+  SomAttributes som_attr = NULL;        /* SOM attributes */
+  Layer cur_layer = NULL;       /* current original layer */
+  Layer new_layer = NULL;       /* current copied layer */
+  Layer orig_layer = NULL;      /* copied origin layer */
+  Unit cur_unit = NULL;         /* current original unit */
+  Unit new_unit = NULL;         /* current copied unit */
+  Unit orig_unit = NULL;        /* copied origin unit */
+  Connection cur_conn = NULL;   /* current original connection */
+  Vector coord = NULL;          /* copied unit coordinates */
+
+
+  /* Checks if the network was passed */
+  if (nnet == NULL)
+    {
+      fprintf (stderr, "nnet_nnetwork_copy: no neural network passed\n");
+      return NULL;
+    }
+
+  new_nnet = nnet_nnetwork_create (nnet->name, NULL);
+
+  if (new_nnet == NULL)
+    {
+      fprintf (stderr, "nnet_nnetwork_copy: error creating neural network\n");
+      return NULL;
+    }
+
+  /* Copies the layers and their units */
+  for (cur_layer = nnet->first_layer; cur_layer != NULL;
+       cur_layer = cur_layer->next)
+    {
+      new_layer = nnet_layer_create (new_nnet, NULL, cur_layer->layer_class,
+                                     cur_layer->name);
+
+      if (new_layer == NULL)
+        {
+          fprintf (stderr, "nnet_nnetwork_copy: error copying layer\n");
+          nnet_nnetwork_destroy (&new_nnet, TRUE, TRUE, TRUE, TRUE);
+          return NULL;
+        }
+
+      for (cur_unit = cur_layer->first_unit; cur_unit != NULL;
+           cur_unit = cur_unit->next)
+        {
+          coord = NULL;
+
+          if (cur_unit->coord != NULL)
+            {
+              coord = vector_create (cur_unit->coord->dimension);
+
+              if (coord == NULL || vector_copy (cur_unit->coord, coord)
+                  != EXIT_SUCCESS)
+                {
+                  fprintf (stderr,
+                           "nnet_nnetwork_copy: error copying unit coordinates\n");
+                  nnet_nnetwork_destroy (&new_nnet, TRUE, TRUE, TRUE, TRUE);
+                  return NULL;
+                }
+            }
+
+          if (nnet_unit_create
+              (new_layer, NULL,
+               cur_unit->activation_function->function_class,
+               cur_unit->activation_function->parameters, FALSE, FALSE,
+               coord) == NULL)
+            {
+              fprintf (stderr, "nnet_nnetwork_copy: error copying unit\n");
+              nnet_nnetwork_destroy (&new_nnet, TRUE, TRUE, TRUE, TRUE);
+              return NULL;
+            }
+        }
+    }
+
+  /* Copies the connections, in the same order */
+  new_layer = new_nnet->first_layer;
+
+  for (cur_layer = nnet->first_layer; cur_layer != NULL;
+       cur_layer = cur_layer->next)
+    {
+      new_unit = new_layer->first_unit;
+
+      for (cur_unit = cur_layer->first_unit; cur_unit != NULL;
+           cur_unit = cur_unit->next)
+        {
+          orig_layer = NULL;
+          orig_unit = NULL;
+
+          for (cur_conn = cur_unit->first_orig; cur_conn != NULL;
+               cur_conn = cur_conn->next_orig)
+            {
+              /* Inputs usually come in origin order: looks ahead first */
+              if (orig_layer == NULL ||
+                  orig_layer->layer_index != cur_conn->orig->layer->layer_index)
+                {
+                  orig_layer = nnet_layer_by_index
+                    (new_nnet, cur_conn->orig->layer->layer_index);
+                  orig_unit = NULL;
+                }
+
+              if (orig_unit == NULL || orig_unit->next == NULL ||
+                  orig_unit->next->unit_index != cur_conn->orig->unit_index)
+                orig_unit = orig_layer->first_unit;
+              else
+                orig_unit = orig_unit->next;
+
+              while (orig_unit != NULL &&
+                     orig_unit->unit_index != cur_conn->orig->unit_index)
+                orig_unit = orig_unit->next;
+
+              if (orig_unit == NULL || nnet_conn_create
+                  (orig_unit, new_unit, cur_conn->weight,
+                   cur_conn->wght_function->function_class,
+                   cur_conn->wght_function->parameters) == NULL)
+                {
+                  fprintf (stderr,
+                           "nnet_nnetwork_copy: error copying connection\n");
+                  nnet_nnetwork_destroy (&new_nnet, TRUE, TRUE, TRUE, TRUE);
+                  return NULL;
+                }
+            }
+
+          new_unit = new_unit->next;
+        }
+
+      new_layer = new_layer->next;
+    }
+
+  /* Copies the extension */
+  if (nnet->extension != NULL)
+    {
+      switch (nnet->extension->index)
+        {
+        case NNEXT_GEN:
+          break;
+
+        case NNEXT_SOM:
+          som_attr = (SomAttributes) nnet->extension->attr;
+
+          if (nnet_som_create
+              (new_nnet, som_attr->ngb_function->function_class,
+               som_attr->ngb_function->function->parameters,
+               som_attr->lrate_function->function_class,
+               som_attr->lrate_function->parameters) == NULL)
+            {
+              fprintf (stderr,
+                       "nnet_nnetwork_copy: error copying SOM extension\n");
+              nnet_nnetwork_destroy (&new_nnet, TRUE, TRUE, TRUE, TRUE);
+              return NULL;
+            }
+          break;
+
+        default:
+          fprintf (stderr,
+                   "nnet_nnetwork_copy: %s extensions can't be copied\n",
+                   nnet_extension_name[nnet->extension->index]);
+          nnet_nnetwork_destroy (&new_nnet, TRUE, TRUE, TRUE, TRUE);
+          return NULL;
+        }
+    }
+
+  return new_nnet;
+}
+
+
+
 /*
  * nnet_nnetwork_activate
  *
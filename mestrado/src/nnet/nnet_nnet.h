@@ -47,6 +47,16 @@ nnet_nnetwork_destroy (NNetwork * nnet,
 
 
 
+/*
+ * nnet_nnetwork_copy
+ *
+ * Creates a new neural network with the same layers, units, connections,
+ * weights and extension as the given one
+ */
+extern NNetwork nnet_nnetwork_copy (const NNetwork nnet);
+
+
+
 /******************************************************************************
  *                                                                            *
  *                            FUNCTIONAL OPERATIONS                           *
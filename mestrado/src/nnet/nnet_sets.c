@@ -2,14 +2,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <pthread.h>
 #include "nnet_types.h"
 #include "nnet_sets.h"
+#include "nnet_tstream.h"
 #include "../common/types.h"
 #include "../errorh/errorh.h"
 #include "../vector/vector.h"
 #include "../vector/vectorstat.h"
 #include "../strutils/strutils.h"
-#include "../incstat/incstat.h"
 
 /******************************************************************************
  *                                                                            *
@@ -46,213 +47,266 @@ nnet_tset_element_correct_indexes (TElement first_element,
 
 
 
-/******************************************************************************
- *                                                                            *
- *                              PUBLIC OPERATIONS                             *
- *                                                                            *
- ******************************************************************************/
+/*
+ * nnet_tset_random_index
+ *
+ * Returns a random index between 0 and 'range' - 1, from the same
+ * generator used by the incstat module
+ */
+static ElementIndex
+nnet_tset_random_index (const ElementIndex range)
+{
+  ElementIndex index;           /* random index */
+
+
+  index = (ElementIndex) (((RValue) rand () / ((RValue) RAND_MAX + 1.0)) *
+                          (RValue) range);
+
+  return (index < range) ? index : range - 1;
+}
+
+
 
 /*
- * nnet_tset_create
+ * nnet_tset_order_random
  *
- * Creates a new training set
+ * Returns the next 32 bit value of the training order generator
+ * (xorshift), which keeps its whole state in 'state'
  */
-TSet
-nnet_tset_create (const Name name,
-                  const UnitIndex input_dimension,
-                  const UnitIndex output_dimension)
+static UsLgIntValue
+nnet_tset_order_random (UsLgIntValue * state)
 {
-  TSet new_set;                 /* new training set */
-  int exit_status;              /* auxiliary function return status */
+  UsLgIntValue x = *state;      /* generator state */
 
 
-  /* Validates the number of inputs and outputs */
-  if (input_dimension < 1)
-    {
-      fprintf (stderr, "nnet_tset_create: invalid number of inputs: %ld\n",
-               input_dimension);
-      return NULL;
-    }
+  x ^= (x << 13) & 0xFFFFFFFFUL;
+  x ^= x >> 17;
+  x ^= (x << 5) & 0xFFFFFFFFUL;
 
-  /*
-  if (output_dimension < 0)
+  *state = x;
+
+  return x;
+}
+
+
+
+/*
+ * nnet_tset_order_index
+ *
+ * Returns a random index between 0 and 'range' - 1 from the training
+ * order generator
+ */
+static ElementIndex
+nnet_tset_order_index (UsLgIntValue * state, const ElementIndex range)
+{
+  ElementIndex index;           /* random index */
+
+
+  index = (ElementIndex) (((RValue) nnet_tset_order_random (state) /
+                           4294967296.0) * (RValue) range);
+
+  return (index < range) ? index : range - 1;
+}
+
+
+
+/*
+ * nnet_tset_order_shuffle_range
+ *
+ * Shuffles the given range of positions (Fisher-Yates)
+ */
+static void
+nnet_tset_order_shuffle_range (ElementIndex * positions,
+                               const ElementIndex nu_positions,
+                               UsLgIntValue * state)
+{
+  ElementIndex cur_pos;         /* current position */
+  ElementIndex pick_pos;        /* picked position */
+  ElementIndex aux_pos;         /* auxiliary position */
+
+
+  for (cur_pos = nu_positions; cur_pos > 1; cur_pos--)
     {
-      fprintf (stderr, "nnet_tset_create: invalid number of outputs: %ld\n",
-               output_dimension);
-      return NULL;
+      pick_pos = nnet_tset_order_index (state, cur_pos);
+
+      aux_pos = positions[pick_pos];
+      positions[pick_pos] = positions[cur_pos - 1];
+      positions[cur_pos - 1] = aux_pos;
     }
-   */
 
-  /* Allocates the new training set */
-  new_set = (TSet) malloc (sizeof (nnet_training_set_type));
+  return;
+}
 
-  if (new_set == NULL)
+
+
+/*
+ * nnet_tset_relink
+ *
+ * Makes the given array of elements the element list of the set, in the
+ * array order
+ */
+static void
+nnet_tset_relink (TSet set, TElement * elements,
+                  const ElementIndex nu_elements)
+{
+  ElementIndex cur_pos;         /* current element position */
+
+
+  for (cur_pos = 0; cur_pos < nu_elements; cur_pos++)
     {
-      fprintf (stderr, "nnet_tset_create: virtual memory exhausted\n");
-      return NULL;
+      elements[cur_pos]->set = set;
+      elements[cur_pos]->element_index = cur_pos + 1;
+      elements[cur_pos]->next =
+        (cur_pos + 1 < nu_elements) ? elements[cur_pos + 1] : NULL;
     }
 
-  /* Initializes the new set */
-  if (name != NULL)
-    strcpy (new_set->name, name);
-  new_set->nu_elements = 0;
-  new_set->input_dimension = input_dimension;
-  new_set->output_dimension = output_dimension;
-  new_set->first_element = NULL;
-  new_set->last_element = NULL;
+  set->nu_elements = nu_elements;
+  set->first_element = (nu_elements > 0) ? elements[0] : NULL;
+  set->last_element = (nu_elements > 0) ? elements[nu_elements - 1] : NULL;
+  set->table_valid = (elements == set->element_table) ? TRUE : FALSE;
 
-  /* Creates the statistics vectors */
-  if (input_dimension > 0)
-    {
-      new_set->input_vector_stats = vcst_stats_create (input_dimension);
+  return;
+}
 
-      if (new_set->input_vector_stats == NULL)
-        {
-          fprintf (stderr,
-                   "nnet_tset_create: error creating input statistic vectors set\n");
-          free (new_set);
-          return NULL;
-        }
-    }
-  else
-    new_set->input_vector_stats = NULL;
 
-  if (output_dimension > 0)
-    {
-      new_set->output_vector_stats = vcst_stats_create (output_dimension);
 
-      if (new_set->output_vector_stats == NULL)
-        {
-          fprintf (stderr,
-                   "nnet_tset_create: error creating output statistic vectors set\n");
+/*
+ * nnet_tset_aligned_block
+ *
+ * Allocates room for the given number of values, returning a pointer
+ * aligned to NNET_TSET_ARENA_ALIGN bytes. The allocated block, which must
+ * be passed to free, is returned in 'block'.
+ */
+static RValue *
+nnet_tset_aligned_block (const size_t nu_values, void **block)
+{
+  size_t misalignment;          /* bytes past the last aligned address */
 
-          exit_status = vcst_stats_destroy (&(new_set->input_vector_stats));
 
-          if (exit_status != EXIT_SUCCESS)
-            {
-              fprintf (stderr,
-                       "nnet_tset_create: error destroying input statistic vectors set\n");
-              return NULL;
-            }
+  *block = malloc (nu_values * sizeof (RValue) + NNET_TSET_ARENA_ALIGN);
 
-          free (new_set);
-          return NULL;
-        }
-    }
-  else
-    new_set->output_vector_stats = NULL;
+  if (*block == NULL)
+    return NULL;
 
-  return new_set;
+  misalignment = (size_t) *block % NNET_TSET_ARENA_ALIGN;
+
+  if (misalignment == 0)
+    return (RValue *) *block;
+
+  return (RValue *) ((char *) *block + NNET_TSET_ARENA_ALIGN - misalignment);
 }
 
 
 
 /*
- * nnet_tset_destroy
+ * nnet_tset_arena_create
  *
- * Destroys a previously created training set
+ * Allocates an arena for the given number of elements
  */
-int
-nnet_tset_destroy (TSet * set, const BoolValue cascade_elements)
+static TSetArenaPtr
+nnet_tset_arena_create (const ElementIndex nu_elements,
+                        const UnitIndex input_dimension,
+                        const UnitIndex output_dimension)
 {
-  TSet aux_set = *set;          /* auxiliary pointer to the actual set */
-  TElement cur_element = NULL;  /* auxiliary current element */
-  TElement next_element = NULL; /* auxiliary next element */
-  Vector aux_vector = NULL;     /* auxiliary vector */
-  int exit_status;              /* auxiliary function return status */
+  TSetArenaPtr new_arena;       /* new arena */
 
 
-  /* Checks if the training set was actually passed */
-  if (set == NULL || aux_set == NULL)
-    {
-      fprintf (stderr, "nnet_tset_destroy: no training set to destroy\n");
-      return EXIT_FAILURE;
-    }
+  new_arena = (TSetArenaPtr) malloc (sizeof (nnet_tset_arena_type));
 
-  /* Deletes the elements of the set */
-  if (aux_set->nu_elements > 0)
-    {
-      if (cascade_elements == TRUE)
-        {
-          cur_element = aux_set->first_element;
+  if (new_arena == NULL)
+    return NULL;
 
-          while (cur_element != NULL)
-            {
-              /* Destroys input and output vectors */
-              if (cur_element->input != NULL)
-                {
-                  aux_vector = cur_element->input;
+  new_arena->nu_elements = nu_elements;
+  new_arena->nu_references = 0;
+  new_arena->input_dimension = input_dimension;
+  new_arena->output_dimension = output_dimension;
+  new_arena->outputs = NULL;
+  new_arena->output_block = NULL;
 
-                  exit_status = vector_destroy (&aux_vector);
-                  if (exit_status != EXIT_SUCCESS)
-                    {
-                      fprintf (stderr,
-                               "nnet_tset_element_destroy: error destroying input vector\n");
-                      return EXIT_FAILURE;
-                    }
-                }
+  new_arena->elements = (nnet_training_element_type *)
+    malloc (nu_elements * sizeof (nnet_training_element_type));
+  new_arena->vectors = (vector_type *)
+    malloc (2 * nu_elements * sizeof (vector_type));
+  new_arena->inputs = nnet_tset_aligned_block
+    (nu_elements * input_dimension, &(new_arena->input_block));
 
-              if (cur_element->output != NULL)
-                {
-                  aux_vector = cur_element->output;
+  if (output_dimension > 0)
+    new_arena->outputs = nnet_tset_aligned_block
+      (nu_elements * output_dimension, &(new_arena->output_block));
+
+  if (new_arena->elements == NULL || new_arena->vectors == NULL ||
+      new_arena->inputs == NULL ||
+      (output_dimension > 0 && new_arena->outputs == NULL))
+    {
+      free (new_arena->elements);
+      free (new_arena->vectors);
+      free (new_arena->input_block);
+      free (new_arena->output_block);
+      free (new_arena);
+      return NULL;
+    }
 
-                  exit_status = vector_destroy (&aux_vector);
-                  if (exit_status != EXIT_SUCCESS)
-                    {
-                      fprintf (stderr,
-                               "nnet_tset_element_destroy: error destroying output vector\n");
-                      return EXIT_FAILURE;
-                    }
-                }
+  return new_arena;
+}
 
-              /* If the element is attached to a set, dettaches it */
-              aux_set->nu_elements--;
 
-              /* Saves next element */
-              next_element = cur_element->next;
 
-              /* Destroys the current element */
-              free (cur_element);
+/*
+ * nnet_tset_element_free
+ *
+ * Releases the storage of an element that no longer belongs to a set:
+ * its vectors and record, or its reference to the arena that holds them
+ */
+static int
+nnet_tset_element_free (TElement element)
+{
+  TSetArenaPtr arena;           /* element's arena */
+  Vector aux_vector;            /* auxiliary vector */
 
-              /* On to the next element */
-              cur_element = next_element;
-            }
-        }
-      else
+
+  /* Arena element: the last one out releases the arena */
+  if (element->arena != NULL)
+    {
+      arena = element->arena;
+
+      if (--arena->nu_references == 0)
         {
-          fprintf (stderr,
-                   "nnet_tset_destroy: set still has %ld elements\n",
-                   aux_set->nu_elements);
-          return EXIT_FAILURE;
+          free (arena->elements);
+          free (arena->vectors);
+          free (arena->input_block);
+          free (arena->output_block);
+          free (arena);
         }
+
+      return EXIT_SUCCESS;
     }
 
-  /* Destroys the statistic vectors sets */
-  if (aux_set->input_vector_stats != NULL)
+  /* Destroys input and output vectors */
+  if (element->input != NULL)
     {
-      exit_status = vcst_stats_destroy (&(aux_set->input_vector_stats));
-      if (exit_status != EXIT_SUCCESS)
+      aux_vector = element->input;
+
+      if (vector_destroy (&aux_vector) != EXIT_SUCCESS)
         {
           fprintf (stderr,
-                   "nnet_tset_destroy: error destroying input statistic vectors set\n");
+                   "nnet_tset_element_free: error destroying input vector\n");
           return EXIT_FAILURE;
         }
     }
 
-  if (aux_set->output_vector_stats != NULL)
+  if (element->output != NULL)
     {
-      exit_status = vcst_stats_destroy (&(aux_set->output_vector_stats));
-      if (exit_status != EXIT_SUCCESS)
+      aux_vector = element->output;
+
+      if (vector_destroy (&aux_vector) != EXIT_SUCCESS)
         {
           fprintf (stderr,
-                   "nnet_tset_destroy: error destroying output statistic vectors set\n");
+                   "nnet_tset_element_free: error destroying output vector\n");
           return EXIT_FAILURE;
         }
     }
 
-  /* Releases the memory of the training set */
-  free (*set);
-  *set = NULL;
+  free (element);
 
   return EXIT_SUCCESS;
 }
@@ -260,564 +314,577 @@ nnet_tset_destroy (TSet * set, const BoolValue cascade_elements)
 
 
 /*
- * nnet_tset_merge
+ * nnet_tset_next_word
  *
- * Transfers all elements from origin set to destination set.
- * Both sets must have been previously created.
- * Origin set will be empty after merging.
+ * Returns the next blank delimited word of a line, as strtok does, keeping
+ * its position in 'cursor' instead of a static variable
  */
-int
-nnet_tset_merge (TSet orig_set, TSet dest_set)
+static char *
+nnet_tset_next_word (char **cursor)
 {
-  TElement cur_element = NULL;  /* current origin element being transferred */
-  TElement next_element = NULL; /* element next to current */
-
-
-  /* Checks if both sets were passed */
-  if (error_if_null (orig_set, "nnet_tset_merge", "no origin set\n"))
-    return EXIT_FAILURE;
-
-  if (error_if_null (orig_set, "nnet_tset_merge", "no destination set\n"))
-    return EXIT_FAILURE;
+  char *word;                   /* word start */
 
-  /* Trivial case */
-  if (orig_set->nu_elements == 0)
-    return EXIT_SUCCESS;
 
-  /* Transfers all elements from origin set to destination set */
-  cur_element = orig_set->first_element;
+  while (**cursor == ' ')
+    (*cursor)++;
 
-  while (cur_element != NULL)
-    {
-      next_element = cur_element->next;
+  if (**cursor == '\0')
+    return NULL;
 
-      if (error_if_failure
-          (nnet_tset_element_transfer_to_set
-           (cur_element, dest_set, (ElementIndex *) NULL, FALSE),
-           "nnet_tset_merge",
-           "error transferring element %ld\n", cur_element->element_index))
-        return EXIT_FAILURE;
+  word = *cursor;
 
-      cur_element = next_element;
-    }
+  while (**cursor != ' ' && **cursor != '\0')
+    (*cursor)++;
 
-  /* Corrects the element indexes on the destination set */
-  nnet_tset_element_correct_indexes (dest_set->first_element, 1);
+  if (**cursor == ' ')
+    *(*cursor)++ = '\0';
 
-  return EXIT_SUCCESS;
+  return word;
 }
 
 
 
 /*
- * nnet_tset_divide
+ * nnet_tset_update_read_stats
  *
- * Creates a new training set by the division of an original training set,
- * transferring 'nu_elements' to the new set.
- * The elements can be picked from the beggining of the original set, from
- * the end of the original set or at random.
+ * Updates the vector statistics of a set just read from a file and
+ * optionally regularizes its elements by them
  */
-int
-nnet_tset_divide (TSet orig_set,
-                  TSet * dest_set,
-                  const Name new_set_name,
-                  const ElementIndex nu_elements,
-                  const TSetDivisionCriterion division_criterion)
+static int
+nnet_tset_update_read_stats (TSet set,
+                             const BoolValue update_vector_stats,
+                             const BoolValue regularize_inputs,
+                             const BoolValue regularize_outputs)
 {
-  TSet new_set;                 /* new training set */
-  TElement cur_element;         /* element being currently transferred */
-  TElement next_element;        /* element next of current */
-  ElementIndex cur_index;       /* current element index */
-  ElementIndex first_element;   /* index of the first element to transfer */
-  ElementIndex elements_done;   /* transferred elements counter */
-  int exit_status;              /* auxiliary function return status */
-
-
-  /* Checks if the parameters were actually passed */
-  if (orig_set == NULL)
-    {
-      fprintf (stderr, "nnet_tset_divide: no origin set\n");
-      return EXIT_FAILURE;
-    }
+  if (update_vector_stats == FALSE)
+    return EXIT_SUCCESS;
 
-  /* Checks the number of elements to transfer */
-  /*if (nu_elements < 0 || nu_elements > orig_set->nu_elements)*/
-  if (nu_elements > orig_set->nu_elements)
+  if (nnet_tset_update_vector_stats (set, 1) != EXIT_SUCCESS)
     {
       fprintf (stderr,
-               "nnet_tset_divide: invalid number of elements to transfer: %ld\n",
-               nu_elements);
-      return EXIT_FAILURE;
-    }
-
-  /* Creates the new training set */
-  new_set = nnet_tset_create
-    (new_set_name, orig_set->input_dimension, orig_set->output_dimension);
-
-  if (new_set == NULL)
-    {
-      fprintf (stderr, "nnet_tset_divide: error creating new set\n");
+               "nnet_tset_update_read_stats: error updating vector statistics\n");
       return EXIT_FAILURE;
     }
 
-  /* Trivial case: no elements to transfer */
-  if (nu_elements == 0)
-    return EXIT_SUCCESS;
-
-  /* Defines the first element to transfer: beggining and end cases */
-  if (division_criterion == PICK_FROM_BEGGINING)
-    first_element = 1;
-  else if (division_criterion == PICK_FROM_END)
-    first_element = orig_set->nu_elements - nu_elements;
-  else
-    first_element = 0;
-
-  /* Goes to the first element: beggining and end cases */
-  if (division_criterion == PICK_FROM_BEGGINING ||
-      division_criterion == PICK_FROM_END)
+  /* Optionally regularizes the set elements */
+  if (regularize_inputs == TRUE || regularize_outputs == TRUE)
     {
-      cur_element = nnet_tset_goto_element (orig_set, first_element);
-
-      if (cur_element == NULL)
+      if (nnet_tset_regularize (set, regularize_inputs, regularize_outputs)
+          != EXIT_SUCCESS)
         {
           fprintf (stderr,
-                   "nnet_tset_divide: error moving to first element to transfer\n");
+                   "nnet_tset_update_read_stats: error ponderating training set\n");
           return EXIT_FAILURE;
         }
     }
-  else
-    {
-      /* Picks an index at random */
-      cur_index = istt_uniform_random (1, orig_set->nu_elements);
 
-      /* Goes to the element at this index */
-      cur_element = nnet_tset_goto_element (orig_set, cur_index);
-      if (cur_element == NULL)
-        {
-          fprintf (stderr,
-                   "nnet_tset_divide: error moving to element %ld\n",
-                   cur_index);
-          return EXIT_FAILURE;
-        }
+  /* Updates the vector statistics again */
+  if (nnet_tset_update_vector_stats (set, 1) != EXIT_SUCCESS)
+    {
+      fprintf (stderr,
+               "nnet_tset_update_read_stats: error updating vector statistics after ponderation\n");
+      return EXIT_FAILURE;
     }
 
-  /* Transfers the elements according to the division criterion */
-  for (elements_done = 0; elements_done < nu_elements; elements_done++)
-    {
-      /* Stores the next element */
-      next_element = cur_element->next;
+  return EXIT_SUCCESS;
+}
 
-      /* Transfers the current element */
-      exit_status =
-        nnet_tset_element_transfer_to_set (cur_element, new_set, NULL, FALSE);
-      if (exit_status != EXIT_SUCCESS)
-        {
-          fprintf (stderr,
-                   "nnet_tset_divide: error transferring element %ld/%ld to the new set\n",
-                   elements_done + 1, nu_elements);
-          return EXIT_FAILURE;
-        }
 
-      if (orig_set->nu_elements > 0)
-        {
-          switch (division_criterion)
-            {
-            case PICK_FROM_BEGGINING:
-            case PICK_FROM_END:
 
-              /* Goes to the next element */
-              cur_element = next_element;
-              break;
+/*
+ * nnet_tset_load_type
+ *
+ * Files of a list being read by a pool of threads. Each thread takes the
+ * next unread file and reads it into that file's own set.
+ */
+typedef struct
+{
+  char **file_names;            /* files to read */
+  TSet *sets;                   /* set of each file */
+  int *status;                  /* read status of each file */
+  UsIntValue nu_files;          /* number of files */
+  UsIntValue next_file;         /* next unread file */
+  pthread_mutex_t lock;         /* protects next_file */
+  BoolValue normalize_input;    /* normalize input vectors */
+  BoolValue normalize_output;   /* normalize output vectors */
+  BoolValue update_vector_stats;        /* update each file's statistics */
+  BoolValue regularize_inputs;  /* regularize inputs by them */
+  BoolValue regularize_outputs; /* regularize outputs by them */
+}
+nnet_tset_load_type;
 
 
-            case PICK_AT_RANDOM:
 
-              /* Picks an index at random */
-              cur_index = istt_uniform_random (1, orig_set->nu_elements);
+/*
+ * nnet_tset_load_worker
+ *
+ * Reads files of the list until there are none left
+ */
+static void *
+nnet_tset_load_worker (void *arg)
+{
+  nnet_tset_load_type *load = (nnet_tset_load_type *) arg;
+  UsIntValue cur_file;          /* file being read */
 
-              /* Goes to the element at this index */
-              cur_element = nnet_tset_goto_element (orig_set, cur_index);
 
-              if (cur_element == NULL)
-                {
-                  fprintf (stderr,
-                           "nnet_tset_divide: error moving to element %ld\n",
-                           cur_index);
-                  return EXIT_FAILURE;
-                }
+  for (;;)
+    {
+      pthread_mutex_lock (&load->lock);
+      cur_file = load->next_file++;
+      pthread_mutex_unlock (&load->lock);
 
-              break;
-            }
-        }
+      if (cur_file >= load->nu_files)
+        break;
+
+      load->status[cur_file] =
+        nnet_tset_read_from_file (load->sets[cur_file],
+                                  load->file_names[cur_file],
+                                  load->normalize_input,
+                                  load->normalize_output,
+                                  load->update_vector_stats,
+                                  load->regularize_inputs,
+                                  load->regularize_outputs);
     }
 
-  /* Corrects the element indexes */
-  nnet_tset_element_correct_indexes (orig_set->first_element, 1);
-  nnet_tset_element_correct_indexes (new_set->first_element, 1);
+  return NULL;
+}
 
-  /* Defines the new set */
-  *dest_set = new_set;
 
-  return EXIT_SUCCESS;
+
+/*
+ * nnet_tset_stats_job_type
+ *
+ * Range of element blocks whose statistics are accumulated by one thread
+ */
+typedef struct
+{
+  TElement *elements;           /* set element table */
+  ElementIndex nu_elements;     /* number of elements */
+  BoolValue outputs;            /* accumulate outputs instead of inputs */
+  VectorAccum *partials;        /* accumulator of each block */
+  ElementIndex first_block;     /* first block of the range */
+  ElementIndex last_block;      /* one past the last block of the range */
 }
+nnet_tset_stats_job_type;
 
 
 
 /*
- * nnet_tset_randomize
+ * nnet_tset_stats_worker
  *
- * Shuffles the elements in the given set
+ * Accumulates the statistics of each block of the range
  */
-int
-nnet_tset_randomize (TSet set)
+static void *
+nnet_tset_stats_worker (void *arg)
 {
-  TSet aux_set = NULL;          /* auxiliary training set */
-  int exit_status;              /* auxiliary function return status */
+  nnet_tset_stats_job_type *job = (nnet_tset_stats_job_type *) arg;
+  ElementIndex cur_block;       /* current block */
+  ElementIndex cur_elmt;        /* current element */
+  ElementIndex last_elmt;       /* one past the last element of the block */
+  TElement element;             /* current element */
 
 
-  /* checks if the training set was actually passed */
-  if (set == NULL)
-    {
-      fprintf (stderr, "nnet_tset_randomize: no training set passed\n");
-      return EXIT_FAILURE;
-    }
-
-  /* creates the auxiliary training set */
-  aux_set =
-    nnet_tset_create (NULL, set->input_dimension, set->output_dimension);
-  if (aux_set == NULL)
+  for (cur_block = job->first_block; cur_block < job->last_block;
+       cur_block++)
     {
-      fprintf (stderr,
-               "nnet_tset_randomize: error creating auxiliary training set\n");
-      return EXIT_FAILURE;
-    }
+      cur_elmt = cur_block * NNET_TSET_STATS_BLOCK;
+      last_elmt = cur_elmt + NNET_TSET_STATS_BLOCK;
 
-  /* randomly transfers all elements to the auxiliary set */
-  exit_status =
-    nnet_tset_divide (set, &aux_set, NULL, set->nu_elements, PICK_AT_RANDOM);
-  if (exit_status != EXIT_SUCCESS)
-    {
-      fprintf (stderr,
-               "nnet_tset_randomize: error transferring elements to auxiliary training set\n");
-      return EXIT_FAILURE;
-    }
+      if (last_elmt > job->nu_elements)
+        last_elmt = job->nu_elements;
 
-  /* transfers the elements back into the original set */
-  exit_status = nnet_tset_merge (aux_set, set);
-  if (exit_status != EXIT_SUCCESS)
-    {
-      fprintf (stderr,
-               "nnet_tset_randomize: error transferring elements back to the original set\n");
-      return EXIT_FAILURE;
-    }
+      vcst_accum_reset (job->partials[cur_block]);
 
-  /* destroys the auxiliary training set */
-  exit_status = nnet_tset_destroy (&aux_set, TRUE);
-  if (exit_status != EXIT_SUCCESS)
-    {
-      fprintf (stderr,
-               "nnet_tset_randomize: error destroying auxiliary training set\n");
-      return EXIT_FAILURE;
+      for (; cur_elmt < last_elmt; cur_elmt++)
+        {
+          element = job->elements[cur_elmt];
+          vcst_accum_add (job->partials[cur_block],
+                          job->outputs == TRUE ? element->output->value :
+                          element->input->value);
+        }
     }
 
-  return EXIT_SUCCESS;
+  return NULL;
 }
 
 
 
 /*
- * nnet_tset_element_create
+ * nnet_tset_reduce_stats
  *
- * Creates a new training element
+ * Computes the statistics of the inputs (or outputs) of the set elements
+ * by blocks, merging the blocks in set order
  */
-TElement
-nnet_tset_element_create (TSet set, ElementIndex * index,
-                          const Vector input,
-                          const Vector output,
-                          const BoolValue normalize_input,
-                          const BoolValue normalize_output,
-                          const BoolValue correct_indexes)
+static int
+nnet_tset_reduce_stats (const TSet set, const BoolValue outputs,
+                        const UsIntValue nu_threads, VectorStats vstats)
 {
-  TElement new_elmt;            /* new element that will be returned */
-  Vector norm1, norm2;          /* auxiliary vectors for normalization */
-  int exit_status;              /* auxiliary function return status */
+  UnitIndex dimension;          /* statistics dimension */
+  VectorAccum *partials;        /* accumulator of each block */
+  nnet_tset_stats_job_type *jobs;       /* block range of each thread */
+  pthread_t *threads;           /* worker threads */
+  ElementIndex nu_blocks;       /* number of blocks */
+  ElementIndex cur_block;       /* current block */
+  ElementIndex cur_elmt;        /* current element */
+  UsIntValue nu_jobs;           /* number of jobs */
+  UsIntValue nu_started = 0;    /* worker threads started */
+  UsIntValue cur_job;           /* current job */
+  TElement element;             /* current element */
+  int exit_status = EXIT_SUCCESS;       /* function return status */
+
+
+  dimension = (outputs == TRUE) ? set->output_dimension :
+    set->input_dimension;
+
+  /* An empty set has no blocks to accumulate: the statistics are kept */
+  if (set->nu_elements == 0)
+    return EXIT_SUCCESS;
 
+  /* The element table gives each thread direct access to its blocks */
+  if (nnet_tset_index (set) != EXIT_SUCCESS)
+    return EXIT_FAILURE;
 
-  /* Checks if the input was passed */
-  if (input == NULL)
+  /* Checks the vector dimensions beforehand */
+  for (cur_elmt = 0; cur_elmt < set->nu_elements; cur_elmt++)
     {
-      fprintf (stderr, "nnet_tset_element_create: no input vector passed\n");
-      return NULL;
+      element = set->element_table[cur_elmt];
+
+      if ((outputs == TRUE ? element->output : element->input) == NULL ||
+          (outputs == TRUE ? element->output->dimension :
+           element->input->dimension) != dimension)
+        {
+          fprintf (stderr,
+                   "nnet_tset_reduce_stats: element %ld has an incompatible vector\n",
+                   cur_elmt + 1);
+          return EXIT_FAILURE;
+        }
     }
 
-  /* Allocates the new training element */
-  new_elmt = (TElement) malloc (sizeof (nnet_training_element_type));
+  nu_blocks = (set->nu_elements + NNET_TSET_STATS_BLOCK - 1) /
+    NNET_TSET_STATS_BLOCK;
+  nu_jobs = (nu_threads < 1) ? 1 : nu_threads;
 
-  if (new_elmt == NULL)
+  if (nu_jobs > nu_blocks)
+    nu_jobs = (UsIntValue) nu_blocks;
+
+  partials = (VectorAccum *) calloc (nu_blocks, sizeof (VectorAccum));
+  jobs = (nnet_tset_stats_job_type *)
+    malloc (nu_jobs * sizeof (nnet_tset_stats_job_type));
+  threads = (pthread_t *) malloc (nu_jobs * sizeof (pthread_t));
+
+  if (partials == NULL || jobs == NULL || threads == NULL)
     {
-      fprintf (stderr,
-               "nnet_tset_element_create: virtual memory exhausted\n");
-      return NULL;
+      fprintf (stderr, "nnet_tset_reduce_stats: virtual memory exhausted\n");
+      exit_status = EXIT_FAILURE;
     }
 
-  /* Initializes the new training element */
-  new_elmt->set = NULL;
-  new_elmt->element_index = 0;
-  new_elmt->input = input;
-  new_elmt->output = output;
-  new_elmt->next = NULL;
+  for (cur_block = 0; cur_block < nu_blocks && exit_status == EXIT_SUCCESS;
+       cur_block++)
+    if ((partials[cur_block] = vcst_accum_create (dimension)) == NULL)
+      exit_status = EXIT_FAILURE;
 
-  /* Normalization */
-  if (normalize_input == TRUE || normalize_output == TRUE)
+  if (exit_status == EXIT_SUCCESS)
     {
-      if (normalize_input == TRUE)
-        norm1 = new_elmt->input;
-      else
-        norm1 = NULL;
+      /* Splits the blocks in contiguous ranges */
+      for (cur_job = 0; cur_job < nu_jobs; cur_job++)
+        {
+          jobs[cur_job].elements = set->element_table;
+          jobs[cur_job].nu_elements = set->nu_elements;
+          jobs[cur_job].outputs = outputs;
+          jobs[cur_job].partials = partials;
+          jobs[cur_job].first_block = nu_blocks * cur_job / nu_jobs;
+          jobs[cur_job].last_block = nu_blocks * (cur_job + 1) / nu_jobs;
+        }
 
-      if (normalize_output == TRUE)
-        norm2 = new_elmt->output;
-      else
-        norm2 = NULL;
+      if (nu_jobs > 1)
+        for (nu_started = 0; nu_started < nu_jobs; nu_started++)
+          if (pthread_create (&threads[nu_started], NULL,
+                              nnet_tset_stats_worker, &jobs[nu_started]) != 0)
+            break;
 
-      exit_status = vector_normalize (norm1, norm2);
+      for (cur_job = 0; cur_job < nu_started; cur_job++)
+        pthread_join (threads[cur_job], NULL);
 
-      if (exit_status != EXIT_SUCCESS)
-        {
-          free (new_elmt);
-          fprintf (stderr,
-                   "nnet_tset_element_create: error normalizing element\n");
-          return NULL;
-        }
-    }
+      /* The ranges of the threads that could not be started are done here */
+      for (cur_job = nu_started; cur_job < nu_jobs; cur_job++)
+        nnet_tset_stats_worker (&jobs[cur_job]);
 
-  /* If a training set was passed, attach the element to it */
-  if (set != NULL)
-    {
-      exit_status =
-        nnet_tset_element_attach_to_set (new_elmt, set, index,
-                                         correct_indexes);
+      /* Merges the blocks in order */
+      for (cur_block = 1;
+           cur_block < nu_blocks && exit_status == EXIT_SUCCESS; cur_block++)
+        exit_status = vcst_accum_merge (partials[0], partials[cur_block]);
 
-      if (exit_status != EXIT_SUCCESS)
-        {
-          free (new_elmt);
-          fprintf (stderr,
-                   "nnet_tset_element_create: error attaching new training element to training set\n");
-          return NULL;
-        }
+      if (exit_status == EXIT_SUCCESS)
+        exit_status = vcst_accum_store (partials[0], vstats);
     }
 
-  return new_elmt;
+  if (partials != NULL)
+    for (cur_block = 0; cur_block < nu_blocks; cur_block++)
+      if (partials[cur_block] != NULL)
+        vcst_accum_destroy (&(partials[cur_block]));
+
+  free (partials);
+  free (jobs);
+  free (threads);
+
+  return exit_status;
 }
 
 
 
 /*
- * nnet_tset_element_destroy
+ * nnet_tset_regularize_vectors
  *
- * Destroys a previously created traning element
- * Cascades input and output vectors
+ * Subtracts the averages from the inputs (or outputs) of all elements and
+ * multiplies them by the inverse standard deviations
  */
-int
-nnet_tset_element_destroy (TElement * element,
-                           const BoolValue correct_indexes)
+static int
+nnet_tset_regularize_vectors (TSet set, const BoolValue outputs,
+                              const VectorStats vstats)
 {
-  Vector aux_vector;            /* auxiliary vector */
-  int exit_status;              /* auxiliary function return status */
+  TElement cur_element;         /* current element */
+  const RValue *average;        /* averages */
+  const RValue *invstddev;      /* inverse standard deviations */
+  RValue *values;               /* current element values */
+  UnitIndex dimension;          /* vector dimension */
+  UnitIndex cur_comp;           /* current component */
+  Vector vector;                /* current element vector */
 
 
-  /* Checks if an element was actually passed */
-  if (element == NULL || *element == NULL)
-    {
-      fprintf (stderr, "nnet_tset_element_destroy: no element to destroy\n");
-      return EXIT_FAILURE;
-    }
-
-  /* Destroys input and output vectors */
-  if ((*element)->input != NULL)
-    {
-      aux_vector = (*element)->input;
-      exit_status = vector_destroy (&aux_vector);
-
-      if (exit_status != EXIT_SUCCESS)
-        {
-          fprintf (stderr,
-                   "nnet_tset_element_destroy: error destroying input vector\n");
-          return EXIT_FAILURE;
-        }
-    }
+  dimension = vstats->dimension;
+  average = vstats->average->value;
+  invstddev = vstats->invstddev->value;
 
-  if ((*element)->output != NULL)
+  for (cur_element = set->first_element; cur_element != NULL;
+       cur_element = cur_element->next)
     {
-      aux_vector = (*element)->output;
-      exit_status = vector_destroy (&aux_vector);
+      vector = (outputs == TRUE) ? cur_element->output : cur_element->input;
 
-      if (exit_status != EXIT_SUCCESS)
+      if (vector == NULL || vector->dimension != dimension)
         {
           fprintf (stderr,
-                   "nnet_tset_element_destroy: error destroying output vector\n");
+                   "nnet_tset_regularize_vectors: element %ld has an incompatible vector\n",
+                   cur_element->element_index);
           return EXIT_FAILURE;
         }
-    }
 
-  /* If the element is attached to a set, dettaches it */
-  if ((*element)->set != NULL)
-    {
-      exit_status =
-        nnet_tset_element_remove_from_set (*element, correct_indexes);
+      values = vector->value;
 
-      if (exit_status != EXIT_SUCCESS)
-        {
-          fprintf (stderr,
-                   "nnet_tset_element_destroy: error removing element from set\n");
-          return EXIT_FAILURE;
-        }
+      for (cur_comp = 0; cur_comp < dimension; cur_comp++)
+        values[cur_comp] = (values[cur_comp] - average[cur_comp]) *
+          invstddev[cur_comp];
     }
 
-  /* Destroys the element */
-  free (*element);
-
-  /* Makes it point to NULL */
-  *element = NULL;
-
   return EXIT_SUCCESS;
 }
 
 
 
+/******************************************************************************
+ *                                                                            *
+ *                              PUBLIC OPERATIONS                             *
+ *                                                                            *
+ ******************************************************************************/
+
 /*
- * nnet_tset_element_attach_to_set
+ * nnet_tset_create
  *
- * Attaches a training element to a training set
+ * Creates a new training set
  */
-int
-nnet_tset_element_attach_to_set (TElement element,
-                                 TSet set, ElementIndex * index,
-                                 BoolValue correct_indexes)
-{
-  ElementIndex new_index;       /* index to attach the element */
-  ElementIndex cur_elmt;        /* element position counter */
-  TElement aux_elmt;            /* pointer to auxiliary element */
+TSet
+nnet_tset_create (const Name name,
+                  const UnitIndex input_dimension,
+                  const UnitIndex output_dimension)
+{
+  TSet new_set;                 /* new training set */
   int exit_status;              /* auxiliary function return status */
 
 
-  /* Checks if an element was actually passed */
-  if (element == NULL)
+  /* Validates the number of inputs and outputs */
+  if (input_dimension < 1)
     {
-      fprintf (stderr,
-               "nnet_tset_element_attach_to_set: no element to attach\n");
-      return EXIT_FAILURE;
+      fprintf (stderr, "nnet_tset_create: invalid number of inputs: %ld\n",
+               input_dimension);
+      return NULL;
     }
 
-  /* Checks if a training set was actually passed */
-  if (set == NULL)
+  /*
+  if (output_dimension < 0)
     {
-      fprintf (stderr,
-               "nnet_tset_element_attach_to_set: no destination set\n");
-      return EXIT_FAILURE;
+      fprintf (stderr, "nnet_tset_create: invalid number of outputs: %ld\n",
+               output_dimension);
+      return NULL;
     }
+   */
 
-  /* Checks if the element has an input vector */
-  if (element->input == NULL)
+  /* Allocates the new training set */
+  new_set = (TSet) malloc (sizeof (nnet_training_set_type));
+
+  if (new_set == NULL)
     {
-      fprintf (stderr,
-               "nnet_tset_element_attach_to_set: element has no input vector\n");
-      return EXIT_FAILURE;
+      fprintf (stderr, "nnet_tset_create: virtual memory exhausted\n");
+      return NULL;
     }
 
-  /* Checks the compatibility between the element and the set dimensions */
-  if (element->input->dimension != set->input_dimension)
+  /* Initializes the new set */
+  if (name != NULL)
+    strcpy (new_set->name, name);
+  new_set->nu_elements = 0;
+  new_set->input_dimension = input_dimension;
+  new_set->output_dimension = output_dimension;
+  new_set->first_element = NULL;
+  new_set->last_element = NULL;
+  new_set->element_table = NULL;
+  new_set->table_size = 0;
+  new_set->table_valid = FALSE;
+  new_set->training_order = NULL;
+  new_set->stream = NULL;
+
+  /* Creates the statistics vectors */
+  if (input_dimension > 0)
     {
-      fprintf (stderr,
-               "nnet_tset_element_attach_to_set: incompatible dimension of inputs\n");
-      return EXIT_FAILURE;
+      new_set->input_vector_stats = vcst_stats_create (input_dimension);
+
+      if (new_set->input_vector_stats == NULL)
+        {
+          fprintf (stderr,
+                   "nnet_tset_create: error creating input statistic vectors set\n");
+          free (new_set);
+          return NULL;
+        }
     }
+  else
+    new_set->input_vector_stats = NULL;
 
-  if (element->output != NULL)
-    if (element->output->dimension != set->output_dimension)
-      {
-        fprintf (stderr,
-                 "nnet_tset_element_attach_to_set: incompatible dimension of outputs\n");
-        return EXIT_FAILURE;
-      }
+  if (output_dimension > 0)
+    {
+      new_set->output_vector_stats = vcst_stats_create (output_dimension);
 
-  /* If the index was passed NULL, attach the element to the end of the set */
-  if (index == NULL)
-    new_index = set->nu_elements + 1;
+      if (new_set->output_vector_stats == NULL)
+        {
+          fprintf (stderr,
+                   "nnet_tset_create: error creating output statistic vectors set\n");
+
+          exit_status = vcst_stats_destroy (&(new_set->input_vector_stats));
+
+          if (exit_status != EXIT_SUCCESS)
+            {
+              fprintf (stderr,
+                       "nnet_tset_create: error destroying input statistic vectors set\n");
+              return NULL;
+            }
+
+          free (new_set);
+          return NULL;
+        }
+    }
   else
-    new_index = *index;
+    new_set->output_vector_stats = NULL;
 
-  /* Validates the new index: 1's logic */
-  if (new_index < 1 || new_index > set->nu_elements + 1)
+  return new_set;
+}
+
+
+
+/*
+ * nnet_tset_destroy
+ *
+ * Destroys a previously created training set
+ */
+int
+nnet_tset_destroy (TSet * set, const BoolValue cascade_elements)
+{
+  TSet aux_set = *set;          /* auxiliary pointer to the actual set */
+  TElement cur_element = NULL;  /* auxiliary current element */
+  TElement next_element = NULL; /* auxiliary next element */
+  int exit_status;              /* auxiliary function return status */
+
+
+  /* Checks if the training set was actually passed */
+  if (set == NULL || aux_set == NULL)
     {
-      fprintf (stderr,
-               "nnet_tset_element_attach_to_set: invalid position requested: %ld\n",
-               new_index);
+      fprintf (stderr, "nnet_tset_destroy: no training set to destroy\n");
       return EXIT_FAILURE;
     }
 
-  /* If the element was attached to another set, dettaches from it */
-  if (element->set != NULL)
+  /* Deletes the elements of the set */
+  if (aux_set->nu_elements > 0)
     {
-      if (element->set != set || element->element_index != new_index)
+      if (cascade_elements == TRUE)
         {
-          /* Removes from the old set */
-          exit_status =
-            nnet_tset_element_remove_from_set (element, correct_indexes);
+          cur_element = aux_set->first_element;
 
-          if (exit_status != EXIT_SUCCESS)
+          while (cur_element != NULL)
             {
-              fprintf (stderr,
-                       "nnet_tset_element_attach_to_set: error removing from old set\n");
-              return EXIT_FAILURE;
+              /* If the element is attached to a set, dettaches it */
+              aux_set->nu_elements--;
+
+              /* Saves next element */
+              next_element = cur_element->next;
+
+              /* Destroys the current element */
+              if (nnet_tset_element_free (cur_element) != EXIT_SUCCESS)
+                {
+                  fprintf (stderr,
+                           "nnet_tset_destroy: error destroying element\n");
+                  return EXIT_FAILURE;
+                }
+
+              /* On to the next element */
+              cur_element = next_element;
             }
         }
       else
         {
-          /* Attaching to the same set: nothing to do */
-          return EXIT_SUCCESS;
+          fprintf (stderr,
+                   "nnet_tset_destroy: set still has %ld elements\n",
+                   aux_set->nu_elements);
+          return EXIT_FAILURE;
         }
     }
 
-  /* Attaches the element */
-  if (new_index == 1)
+  /* Destroys the statistic vectors sets */
+  if (aux_set->input_vector_stats != NULL)
     {
-      /* Inserts at the head */
-      element->next = set->first_element;
-      set->first_element = element;
+      exit_status = vcst_stats_destroy (&(aux_set->input_vector_stats));
+      if (exit_status != EXIT_SUCCESS)
+        {
+          fprintf (stderr,
+                   "nnet_tset_destroy: error destroying input statistic vectors set\n");
+          return EXIT_FAILURE;
+        }
     }
-  else
+
+  if (aux_set->output_vector_stats != NULL)
     {
-      /* Goes to the element before the requested position */
-      if (new_index == set->nu_elements + 1)
-        aux_elmt = set->last_element;
-      else
+      exit_status = vcst_stats_destroy (&(aux_set->output_vector_stats));
+      if (exit_status != EXIT_SUCCESS)
         {
-          aux_elmt = set->first_element;
-
-          for (cur_elmt = 1; cur_elmt < new_index - 1; cur_elmt++)
-            aux_elmt = aux_elmt->next;
+          fprintf (stderr,
+                   "nnet_tset_destroy: error destroying output statistic vectors set\n");
+          return EXIT_FAILURE;
         }
-
-      /* Inserts the new element */
-      element->next = aux_elmt->next;
-      aux_elmt->next = element;
     }
 
-  /* Increments the number of elements in the set */
-  ++set->nu_elements;
-
-  /* Keeps track of the last element */
-  if (new_index == set->nu_elements)
-    set->last_element = element;
+  /* Destroys the element stream */
+  if (aux_set->stream != NULL)
+    {
+      exit_status = nnet_tstream_destroy (&(aux_set->stream));
+      if (exit_status != EXIT_SUCCESS)
+        {
+          fprintf (stderr, "nnet_tset_destroy: error destroying stream\n");
+          return EXIT_FAILURE;
+        }
+    }
 
-  /* If not inserted at the tail, corrects the other elements' indexes */
-  if (new_index != set->nu_elements && correct_indexes == TRUE)
-    nnet_tset_element_correct_indexes (element, new_index);
+  /* Releases the memory of the training set */
+  if (aux_set->training_order != NULL)
+    free (aux_set->training_order->positions);
 
-  /* Sets the element's set attributes */
-  element->set = set;
-  element->element_index = new_index;
+  free (aux_set->training_order);
+  free (aux_set->element_table);
+  free (*set);
+  *set = NULL;
 
   return EXIT_SUCCESS;
 }
@@ -825,75 +892,78 @@ nnet_tset_element_attach_to_set (TElement element,
 
 
 /*
- * nnet_tset_element_remove_from_set
+ * nnet_tset_create_view
  *
- * Removes a training element from its training set
+ * Creates a view of the given set: a set that shares its elements and
+ * statistics, with its own element table and training order
  */
-int
-nnet_tset_element_remove_from_set (TElement element,
-                                   const BoolValue correct_indexes)
+TSet
+nnet_tset_create_view (const Name name, const TSet set)
 {
-  TSet set;                     /* auxiliary set */
-  TElement aux_elmt;            /* auxiliary pointer to element */
+  TSet new_view;                /* new view */
 
 
-  /* Check if an element was passed */
-  if (element == NULL)
+  /* Check if the set was passed */
+  if (set == NULL)
     {
-      fprintf (stderr,
-               "nnet_tset_element_remove_from_set: no element to remove\n");
-      return EXIT_FAILURE;
+      fprintf (stderr, "nnet_tset_create_view: no set passed\n");
+      return NULL;
     }
 
-  /* Verifies if the element is attached to a set */
-  if (element->set == NULL)
+  /* Streamed sets hold no elements to share */
+  if (set->stream != NULL)
     {
-      /* The element is not attached to a set: nothing to do */
-      return EXIT_SUCCESS;
+      fprintf (stderr, "nnet_tset_create_view: can't view a streamed set\n");
+      return NULL;
     }
-  else
-    set = element->set;
 
-  /* Goes to the element before */
-  if (element == set->first_element)
+  new_view = (TSet) malloc (sizeof (nnet_training_set_type));
+
+  if (new_view == NULL)
     {
-      set->first_element = element->next;
-      aux_elmt = NULL;
+      fprintf (stderr, "nnet_tset_create_view: virtual memory exhausted\n");
+      return NULL;
     }
-  else
-    {
-      aux_elmt = set->first_element;
 
-      while (aux_elmt->next != element && aux_elmt != NULL)
-        aux_elmt = aux_elmt->next;
+  /* Shares the elements and the statistics */
+  *new_view = *set;
 
-      /* Checks if the element is actually in the set */
-      if (aux_elmt == NULL)
-        {
-          fprintf (stderr,
-                   "nnet_tset_element_remove_from_set: element not found in set\n");
-          return EXIT_FAILURE;
-        }
+  if (name != NULL)
+    strcpy (new_view->name, name);
 
-      /* Removes the element */
-      aux_elmt->next = element->next;
-    }
+  /* Private element table and training order */
+  new_view->element_table = NULL;
+  new_view->table_size = 0;
+  new_view->table_valid = FALSE;
+  new_view->training_order = NULL;
 
-  /* Keeps track of the last element in the set */
-  if (element == set->last_element)
-    set->last_element = aux_elmt;
+  return new_view;
+}
 
-  /* Corrects the indexes of the other elements */
-  if (element->element_index != set->nu_elements && correct_indexes == TRUE)
-    nnet_tset_element_correct_indexes (element->next, element->element_index);
 
-  /* Decrements the number of elements in the set */
-  set->nu_elements--;
 
-  /* Unsets the element's set attributes */
-  element->set = NULL;
-  element->element_index = 0;
-  element->next = NULL;
+/*
+ * nnet_tset_destroy_view
+ *
+ * Destroys a previously created view, leaving the viewed set untouched
+ */
+int
+nnet_tset_destroy_view (TSet * view)
+{
+  /* Checks if the view was actually passed */
+  if (view == NULL || *view == NULL)
+    {
+      fprintf (stderr, "nnet_tset_destroy_view: no view to destroy\n");
+      return EXIT_FAILURE;
+    }
+
+  if ((*view)->training_order != NULL)
+    free ((*view)->training_order->positions);
+
+  free ((*view)->training_order);
+  free ((*view)->element_table);
+  free (*view);
+  *view = NULL;
 
   return EXIT_SUCCESS;
 }
@@ -901,181 +971,203 @@ nnet_tset_element_remove_from_set (TElement element,
 
 
 /*
- * nnet_tset_element_transfer_to_set
+ * nnet_tset_merge
  *
- * Transfers a training element from its current set to the given set
+ * Transfers all elements from origin set to destination set.
+ * Both sets must have been previously created.
+ * Origin set will be empty after merging.
  */
 int
-nnet_tset_element_transfer_to_set (TElement element,
-                                   TSet new_set, ElementIndex * index,
-                                   const BoolValue correct_indexes)
+nnet_tset_merge (TSet orig_set, TSet dest_set)
 {
-  TSet old_set = NULL;          /* element's old set */
-  ElementIndex old_index;       /* element's old set index */
-  int exit_status;              /* auxiliary function return status */
-
-
-  /* Checks if the parameters were actually passed */
-  if (element == NULL)
-    {
-      fprintf (stderr,
-               "nnet_tset_element_transfer_to_set: no element passed\n");
-      return EXIT_FAILURE;
-    }
+  TElement cur_element = NULL;  /* current origin element being transferred */
+  TElement next_element = NULL; /* element next to current */
 
-  if (new_set == NULL)
-    {
-      fprintf (stderr,
-               "nnet_tset_element_transfer_to_set: no destination set\n");
-      return EXIT_FAILURE;
-    }
 
-  /* If the element is already attached to a set, removes from it */
-  if (element->set != NULL)
-    {
-      /* Stores the element's old set and index */
-      old_set = element->set;
-      old_index = element->element_index;
+  /* Checks if both sets were passed */
+  if (error_if_null (orig_set, "nnet_tset_merge", "no origin set\n"))
+    return EXIT_FAILURE;
 
-      exit_status =
-        nnet_tset_element_remove_from_set (element, correct_indexes);
+  if (error_if_null (orig_set, "nnet_tset_merge", "no destination set\n"))
+    return EXIT_FAILURE;
 
-      if (exit_status != EXIT_SUCCESS)
-        {
-          fprintf (stderr,
-                   "nnet_tset_element_transfer_to_set: error dettaching element from its original set\n");
-          return EXIT_FAILURE;
-        }
-    }
+  /* Trivial case */
+  if (orig_set->nu_elements == 0)
+    return EXIT_SUCCESS;
 
-  /* Attaches the element to the new set */
-  exit_status =
-    nnet_tset_element_attach_to_set (element, new_set, index,
-                                     correct_indexes);
+  /* Transfers all elements from origin set to destination set */
+  cur_element = orig_set->first_element;
 
-  if (exit_status != EXIT_SUCCESS)
+  while (cur_element != NULL)
     {
-      fprintf (stderr,
-               "nnet_tset_element_transfer_to_set: error attaching element to its destination set\n");
+      next_element = cur_element->next;
 
-      /* Tries to undo the dettachment */
-      if (old_set != NULL)
-        {
-          exit_status =
-            nnet_tset_element_attach_to_set (element, old_set, &old_index,
-                                             correct_indexes);
-          if (exit_status != EXIT_SUCCESS)
-            {
-              fprintf (stderr,
-                       "nnet_tset_element_transfer_to_set: error trying to re-attach element to its old set\n");
-              return EXIT_FAILURE;
-            }
-        }
+      if (error_if_failure
+          (nnet_tset_element_transfer_to_set
+           (cur_element, dest_set, (ElementIndex *) NULL, FALSE),
+           "nnet_tset_merge",
+           "error transferring element %ld\n", cur_element->element_index))
+        return EXIT_FAILURE;
 
-      return EXIT_FAILURE;
+      cur_element = next_element;
     }
 
+  /* Corrects the element indexes on the destination set */
+  nnet_tset_element_correct_indexes (dest_set->first_element, 1);
+
   return EXIT_SUCCESS;
 }
 
 
 
 /*
- * nnet_tset_update_vector_stats
+ * nnet_tset_divide
  *
- * Updates the input and output vector statistics
+ * Creates a new training set by the division of an original training set,
+ * transferring 'nu_elements' to the new set.
+ * The elements can be picked from the beggining of the original set, from
+ * the end of the original set or at random. Random picks take linear time
+ * and keep the order of the elements left in the original set.
  */
 int
-nnet_tset_update_vector_stats (const TSet set)
+nnet_tset_divide (TSet orig_set,
+                  TSet * dest_set,
+                  const Name new_set_name,
+                  const ElementIndex nu_elements,
+                  const TSetDivisionCriterion division_criterion)
 {
-  TElement cur_element;         /* current training element */
+  TSet new_set;                 /* new training set */
+  TElement cur_element;         /* element being currently transferred */
+  TElement next_element;        /* element next of current */
+  TElement *table;              /* origin set element table */
+  ElementIndex cur_index;       /* current table position */
+  ElementIndex pick_index;      /* table position of the picked element */
+  ElementIndex first_element;   /* index of the first element to transfer */
+  ElementIndex elements_done;   /* transferred elements counter */
   int exit_status;              /* auxiliary function return status */
 
 
-  /* Checks if the training set was actually passed */
-  if (set == NULL)
+  /* Checks if the parameters were actually passed */
+  if (orig_set == NULL)
     {
-      fprintf (stderr, "nnet_tset_update_vector_stats: no set passed\n");
+      fprintf (stderr, "nnet_tset_divide: no origin set\n");
       return EXIT_FAILURE;
     }
 
-  /* Checks if the set has elements */
-  if (set->nu_elements < 1)
+  /* Checks the number of elements to transfer */
+  /*if (nu_elements < 0 || nu_elements > orig_set->nu_elements)*/
+  if (nu_elements > orig_set->nu_elements)
     {
-      fprintf (stderr, "nnet_tset_update_vector_stats: empty set\n");
+      fprintf (stderr,
+               "nnet_tset_divide: invalid number of elements to transfer: %ld\n",
+               nu_elements);
       return EXIT_FAILURE;
     }
 
-  /* Calculates the input statistics */
-  if (set->input_dimension > 0)
-    {
-      vcst_init_stat (set->input_dimension);
-      cur_element = set->first_element;
-
-      while (cur_element != NULL)
-        {
-          /* Adds the input vector of the current element */
-          exit_status = vcst_add_stat (cur_element->input);
-
-          if (exit_status != EXIT_SUCCESS)
-            {
-              fprintf (stderr,
-                       "nnet_tset_update_vector_stats: error adding input vector to statistics\n");
-              vcst_init_stat (0);
-              return EXIT_FAILURE;
-            }
+  /* Creates the new training set */
+  new_set = nnet_tset_create
+    (new_set_name, orig_set->input_dimension, orig_set->output_dimension);
 
-          /* Goes to the next element */
-          cur_element = cur_element->next;
-        }
+  if (new_set == NULL)
+    {
+      fprintf (stderr, "nnet_tset_divide: error creating new set\n");
+      return EXIT_FAILURE;
+    }
 
-      /* Gets the resulting statistics vector set */
-      exit_status = vcst_stats_update (set->input_vector_stats);
+  /* Trivial case: no elements to transfer */
+  if (nu_elements == 0)
+    {
+      *dest_set = new_set;
+      return EXIT_SUCCESS;
+    }
 
-      if (exit_status != EXIT_SUCCESS)
+  /* Random case: partial shuffle of the element table */
+  if (division_criterion == PICK_AT_RANDOM)
+    {
+      if (nnet_tset_index (orig_set) != EXIT_SUCCESS)
         {
-          fprintf (stderr,
-                   "nnet_tset_update_vector_stats: error getting input statistic vectors set\n");
+          fprintf (stderr, "nnet_tset_divide: error indexing origin set\n");
           return EXIT_FAILURE;
         }
-    }
 
-  /* Calculates the output statistics */
-  if (set->output_dimension > 0)
-    {
-      vcst_init_stat (set->output_dimension);
-      cur_element = set->first_element;
+      table = orig_set->element_table;
 
-      while (cur_element != NULL)
+      /* Picks the elements to transfer into the first table positions */
+      for (cur_index = 0; cur_index < nu_elements; cur_index++)
         {
-          /* Adds the output vector of the current element */
-          exit_status = vcst_add_stat (cur_element->output);
+          pick_index = cur_index + nnet_tset_random_index
+            (orig_set->nu_elements - cur_index);
 
-          if (exit_status != EXIT_SUCCESS)
-            {
-              fprintf (stderr,
-                       "nnet_tset_update_vector_stats: error adding output vector to statistics\n");
-              vcst_init_stat (0);
-              return EXIT_FAILURE;
-            }
+          cur_element = table[pick_index];
+          table[pick_index] = table[cur_index];
+          table[cur_index] = cur_element;
 
-          /* Goes to the next element */
-          cur_element = cur_element->next;
+          cur_element->set = new_set;
         }
 
-      /* Gets the resulting statistics vector set */
-      exit_status = vcst_stats_update (set->output_vector_stats);
+      /* Collects the remaining elements, keeping their order */
+      pick_index = nu_elements;
+
+      for (cur_element = orig_set->first_element; cur_element != NULL;
+           cur_element = cur_element->next)
+        if (cur_element->set == orig_set)
+          table[pick_index++] = cur_element;
+
+      /* Relinks both sets */
+      nnet_tset_relink (new_set, table, nu_elements);
+
+      memmove (table, table + nu_elements,
+               (orig_set->nu_elements - nu_elements) * sizeof (TElement));
+      nnet_tset_relink (orig_set, table, orig_set->nu_elements - nu_elements);
+
+      *dest_set = new_set;
+
+      return EXIT_SUCCESS;
+    }
+
+  /* Defines the first element to transfer */
+  if (division_criterion == PICK_FROM_BEGGINING)
+    first_element = 1;
+  else
+    first_element = orig_set->nu_elements - nu_elements + 1;
+
+  /* Goes to the first element */
+  cur_element = nnet_tset_goto_element (orig_set, first_element);
+
+  if (cur_element == NULL)
+    {
+      fprintf (stderr,
+               "nnet_tset_divide: error moving to first element to transfer\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Transfers the elements */
+  for (elements_done = 0; elements_done < nu_elements; elements_done++)
+    {
+      /* Stores the next element */
+      next_element = cur_element->next;
 
+      /* Transfers the current element */
+      exit_status =
+        nnet_tset_element_transfer_to_set (cur_element, new_set, NULL, FALSE);
       if (exit_status != EXIT_SUCCESS)
         {
           fprintf (stderr,
-                   "nnet_tset_update_vector_stats: error getting output statistic vectors set\n");
+                   "nnet_tset_divide: error transferring element %ld/%ld to the new set\n",
+                   elements_done + 1, nu_elements);
           return EXIT_FAILURE;
         }
+
+      /* Goes to the next element */
+      cur_element = next_element;
     }
 
-  /* Cleans up the statistics */
-  vcst_init_stat (0);
+  /* Corrects the element indexes */
+  nnet_tset_element_correct_indexes (orig_set->first_element, 1);
+  nnet_tset_element_correct_indexes (new_set->first_element, 1);
+
+  /* Defines the new set */
+  *dest_set = new_set;
 
   return EXIT_SUCCESS;
 }
@@ -1083,132 +1175,159 @@ nnet_tset_update_vector_stats (const TSet set)
 
 
 /*
- * nnet_tset_regularize
+ * nnet_tset_randomize
  *
- * Subtracts the averages and regularizes the training set input and output
- * vectors according to the inverse standard deviations vectors
+ * Shuffles the elements in the given set, in linear time
  */
 int
-nnet_tset_regularize (TSet set,
-                      const BoolValue regularize_inputs,
-                      const BoolValue regularize_outputs)
+nnet_tset_randomize (TSet set)
 {
-  TElement cur_element = NULL;  /* current training set element */
-  Vector input_avg_vector = NULL;       /* input average vector */
-  Vector output_avg_vector = NULL;      /* output average vector */
-  Vector input_pond_vector = NULL;      /* input ponderation vector */
-  Vector output_pond_vector = NULL;     /* output ponderation vector */
-  int exit_status;              /* auxiliary function return status */
+  return nnet_tset_randomize_positions (set, NULL);
+}
 
 
-  /* Checks if the training set was actually passed */
+
+/*
+ * nnet_tset_randomize_positions
+ *
+ * Shuffles the elements in the given set like nnet_tset_randomize, also
+ * returning in 'positions' (if passed) the former table position of the
+ * element now at each table position
+ */
+int
+nnet_tset_randomize_positions (TSet set, ElementIndex * positions)
+{
+  TElement *table;              /* element table */
+  TElement aux_element;         /* auxiliary element */
+  ElementIndex aux_position;    /* auxiliary former position */
+  ElementIndex cur_pos;         /* current table position */
+  ElementIndex pick_pos;        /* table position of the picked element */
+
+
+  /* checks if the training set was actually passed */
   if (set == NULL)
     {
-      fprintf (stderr, "nnet_tset_regularize: no training set passed\n");
+      fprintf (stderr,
+               "nnet_tset_randomize_positions: no training set passed\n");
       return EXIT_FAILURE;
     }
 
-  /* Checks if the set is not empty */
-  if (set->nu_elements == 0)
+  if (positions != NULL)
+    for (cur_pos = 0; cur_pos < set->nu_elements; cur_pos++)
+      positions[cur_pos] = cur_pos;
+
+  /* trivial case */
+  if (set->nu_elements < 2)
+    return EXIT_SUCCESS;
+
+  /* shuffles the element table (Fisher-Yates) */
+  if (nnet_tset_index (set) != EXIT_SUCCESS)
     {
-      fprintf (stderr, "nnet_tset_regularize: empty set passed\n");
+      fprintf (stderr,
+               "nnet_tset_randomize_positions: error indexing training set\n");
       return EXIT_FAILURE;
     }
 
-  /* Trivial case: nothing to do */
-  if (regularize_inputs == FALSE && regularize_outputs == FALSE)
-    return EXIT_SUCCESS;
+  table = set->element_table;
 
-  /* Initialization of the ponderation vectors */
-  if (set->input_vector_stats != NULL)
+  for (cur_pos = set->nu_elements - 1; cur_pos > 0; cur_pos--)
     {
-      input_avg_vector = set->input_vector_stats->average;
-      input_pond_vector = set->input_vector_stats->invstddev;
-    }
+      pick_pos = nnet_tset_random_index (cur_pos + 1);
 
-  if (set->output_vector_stats != NULL)
-    {
-      output_avg_vector = set->output_vector_stats->average;
-      output_pond_vector = set->output_vector_stats->invstddev;
+      aux_element = table[pick_pos];
+      table[pick_pos] = table[cur_pos];
+      table[cur_pos] = aux_element;
+
+      if (positions != NULL)
+        {
+          aux_position = positions[pick_pos];
+          positions[pick_pos] = positions[cur_pos];
+          positions[cur_pos] = aux_position;
+        }
     }
 
-  /* Checks if the statistic vectors are valid */
-  if (regularize_inputs == TRUE && set->input_dimension > 0 &&
-      (input_avg_vector == NULL || input_pond_vector == NULL))
+  /* relinks the elements in the new order */
+  nnet_tset_relink (set, table, set->nu_elements);
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_tset_permute
+ *
+ * Rearranges the elements in the given set so the element at each table
+ * position comes from the given former table position, repeating an order
+ * returned by nnet_tset_randomize_positions
+ */
+int
+nnet_tset_permute (TSet set, const ElementIndex * positions)
+{
+  TElement *new_table;          /* elements in the new order */
+  BoolValue *picked;            /* former positions already picked */
+  ElementIndex cur_pos;         /* current table position */
+
+
+  /* checks if the training set was actually passed */
+  if (set == NULL)
     {
-      fprintf (stderr,
-               "nnet_tset_regularize: input statistics are out of date\n");
+      fprintf (stderr, "nnet_tset_permute: no training set passed\n");
       return EXIT_FAILURE;
     }
 
-  if (regularize_outputs == TRUE && set->output_dimension > 0 &&
-      (output_avg_vector == NULL || output_pond_vector == NULL))
+  if (positions == NULL)
     {
-      fprintf (stderr,
-               "nnet_tset_regularize: output statistics are out of date\n");
+      fprintf (stderr, "nnet_tset_permute: no positions passed\n");
       return EXIT_FAILURE;
     }
 
-  /* Regularizes the training set */
-  cur_element = set->first_element;
+  /* trivial case */
+  if (set->nu_elements < 2)
+    return EXIT_SUCCESS;
 
-  while (cur_element != NULL)
+  if (nnet_tset_index (set) != EXIT_SUCCESS)
     {
-      /* Input */
-      if (regularize_inputs == TRUE && set->input_dimension > 0)
-        {
-          /* Subtracts the average */
-          exit_status = vector_subtract
-            (cur_element->input, input_avg_vector, cur_element->input);
-
-          if (exit_status != EXIT_SUCCESS)
-            {
-              fprintf (stderr,
-                       "nnet_tset_regularize: error subtracting input average vector\n");
-              return EXIT_FAILURE;
-            }
+      fprintf (stderr, "nnet_tset_permute: error indexing training set\n");
+      return EXIT_FAILURE;
+    }
 
-          /* Multiplies by the inverse standard deviation */
-          exit_status = vector_multiply
-            (cur_element->input, input_pond_vector, cur_element->input);
+  new_table = (TElement *) malloc (set->nu_elements * sizeof (TElement));
+  picked = (BoolValue *) calloc (set->nu_elements, sizeof (BoolValue));
 
-          if (exit_status != EXIT_SUCCESS)
-            {
-              fprintf (stderr,
-                       "nnet_tset_regularize: error ponderating input element\n");
-              return EXIT_FAILURE;
-            }
-        }
+  if (new_table == NULL || picked == NULL)
+    {
+      fprintf (stderr, "nnet_tset_permute: virtual memory exhausted\n");
+      free (new_table);
+      free (picked);
+      return EXIT_FAILURE;
+    }
 
-      /* Output */
-      if (regularize_outputs == TRUE && set->output_dimension > 0)
+  /* the positions must be a permutation of the table */
+  for (cur_pos = 0; cur_pos < set->nu_elements; cur_pos++)
+    {
+      if (positions[cur_pos] >= set->nu_elements ||
+          picked[positions[cur_pos]] == TRUE)
         {
-          /* Subtracts the average */
-          exit_status = vector_subtract
-            (cur_element->output, output_avg_vector, cur_element->output);
+          fprintf (stderr,
+                   "nnet_tset_permute: positions are not a permutation of the set\n");
+          free (new_table);
+          free (picked);
+          return EXIT_FAILURE;
+        }
 
-          if (exit_status != EXIT_SUCCESS)
-            {
-              fprintf (stderr,
-                       "nnet_tset_regularize: error subtracting output average vector\n");
-              return EXIT_FAILURE;
-            }
+      picked[positions[cur_pos]] = TRUE;
+      new_table[cur_pos] = set->element_table[positions[cur_pos]];
+    }
 
-          /* Multiplies by the inverse standard deviation */
-          exit_status = vector_multiply
-            (cur_element->output, output_pond_vector, cur_element->output);
+  memcpy (set->element_table, new_table,
+          set->nu_elements * sizeof (TElement));
 
-          if (exit_status != EXIT_SUCCESS)
-            {
-              fprintf (stderr,
-                       "nnet_tset_regularize: error ponderating output element\n");
-              return EXIT_FAILURE;
-            }
-        }
+  free (new_table);
+  free (picked);
 
-      /* Goes to the next element */
-      cur_element = cur_element->next;
-    }
+  /* relinks the elements in the new order */
+  nnet_tset_relink (set, set->element_table, set->nu_elements);
 
   return EXIT_SUCCESS;
 }
@@ -1216,420 +1335,1680 @@ nnet_tset_regularize (TSet set,
 
 
 /*
- * nnet_tset_read_from_file
+ * nnet_tset_element_create
  *
- * Reads a training set from a file
+ * Creates a new training element
  */
-int
-nnet_tset_read_from_file (TSet set,
-                          const char *file_name,
+TElement
+nnet_tset_element_create (TSet set, ElementIndex * index,
+                          const Vector input,
+                          const Vector output,
                           const BoolValue normalize_input,
                           const BoolValue normalize_output,
-                          const BoolValue update_vector_stats,
-                          const BoolValue regularize_inputs,
-                          const BoolValue regularize_outputs)
+                          const BoolValue correct_indexes)
 {
-  FILE *fp;                     /* pointer to file descriptor */
-  char buf[NNET_BUF_SIZE];      /* read buffer */
-  char *word;                   /* auxiliar character */
-  const char delim[] = " ";     /* number delim in a line */
-
-  TElement new_element = NULL;  /* new training element */
-  Vector new_input = NULL;      /* new training element's input vector */
-  Vector new_output = NULL;     /* new training element's output vector */
-  Vector old_input = NULL;      /* old training element's input vector */
-  Vector old_output = NULL;     /* old training element's output vector */
-  Vector aux_vector = NULL;     /* auxiliary vector */
+  TElement new_elmt;            /* new element that will be returned */
+  Vector norm1, norm2;          /* auxiliary vectors for normalization */
+  int exit_status;              /* auxiliary function return status */
 
-  ElementIndex new_index;       /* new element index */
-  ElementIndex old_index;       /* old element index */
-  UnitIndex new_pos;            /* new value position */
-  RValue new_value;             /* new value */
-  UnitIndex dim_cnt;            /* vector dimension counter */
 
-  int exit_status;              /* auxiliary function return status */
+  /* Checks if the input was passed */
+  if (input == NULL)
+    {
+      fprintf (stderr, "nnet_tset_element_create: no input vector passed\n");
+      return NULL;
+    }
 
+  /* Allocates the new training element */
+  new_elmt = (TElement) malloc (sizeof (nnet_training_element_type));
 
-  /* Checks if the training set was actually passed */
-  if (set == NULL)
+  if (new_elmt == NULL)
     {
-      fprintf (stderr, "nnet_tset_read_from_file: no training set passed \n");
-      return EXIT_FAILURE;
+      fprintf (stderr,
+               "nnet_tset_element_create: virtual memory exhausted\n");
+      return NULL;
     }
 
-  /* Checks if a file name was passed */
-  if (file_name == NULL)
+  /* Initializes the new training element */
+  new_elmt->set = NULL;
+  new_elmt->element_index = 0;
+  new_elmt->input = input;
+  new_elmt->output = output;
+  new_elmt->next = NULL;
+  new_elmt->arena = NULL;
+
+  /* Normalization */
+  if (normalize_input == TRUE || normalize_output == TRUE)
     {
-      fprintf (stderr, "nnet_tset_read_from_file: no file name\n");
-      return EXIT_FAILURE;
+      if (normalize_input == TRUE)
+        norm1 = new_elmt->input;
+      else
+        norm1 = NULL;
+
+      if (normalize_output == TRUE)
+        norm2 = new_elmt->output;
+      else
+        norm2 = NULL;
+
+      exit_status = vector_normalize (norm1, norm2);
+
+      if (exit_status != EXIT_SUCCESS)
+        {
+          free (new_elmt);
+          fprintf (stderr,
+                   "nnet_tset_element_create: error normalizing element\n");
+          return NULL;
+        }
     }
 
-  /* Checks flag consistency */
-  if (update_vector_stats == FALSE &&
-      (regularize_inputs == TRUE || regularize_outputs == TRUE))
+  /* If a training set was passed, attach the element to it */
+  if (set != NULL)
     {
-      fprintf (stderr,
-               "nnet_tset_read_from_file: unable to regularize set without updating vector statistics\n");
-      return EXIT_FAILURE;
+      exit_status =
+        nnet_tset_element_attach_to_set (new_elmt, set, index,
+                                         correct_indexes);
+
+      if (exit_status != EXIT_SUCCESS)
+        {
+          free (new_elmt);
+          fprintf (stderr,
+                   "nnet_tset_element_create: error attaching new training element to training set\n");
+          return NULL;
+        }
     }
 
-  /* Opens the file for reading */
-  errno = 0;
-  fp = fopen (file_name, "r");
+  return new_elmt;
+}
 
-  if (fp == NULL)
+
+
+/*
+ * nnet_tset_element_destroy
+ *
+ * Destroys a previously created traning element
+ * Cascades input and output vectors
+ */
+int
+nnet_tset_element_destroy (TElement * element,
+                           const BoolValue correct_indexes)
+{
+  int exit_status;              /* auxiliary function return status */
+
+
+  /* Checks if an element was actually passed */
+  if (element == NULL || *element == NULL)
     {
-      fprintf (stderr, "nnet_tset_read_from_file: %s\n", strerror (errno));
+      fprintf (stderr, "nnet_tset_element_destroy: no element to destroy\n");
       return EXIT_FAILURE;
     }
 
-  /* Initializes the auxiliary element indexes */
-  new_index = 1;
-  old_index = 1;
-  new_pos = 1;
-  new_value = 0.0;
-  dim_cnt = 0;
-
-  /* Reads the file */
-  while (!feof (fp))
+  /* If the element is attached to a set, dettaches it */
+  if ((*element)->set != NULL)
     {
-      /* Reads one line */
-      exit_status = read_valid_file_line (fp, NNET_BUF_SIZE, '#', 1, buf);
+      exit_status =
+        nnet_tset_element_remove_from_set (*element, correct_indexes);
+
       if (exit_status != EXIT_SUCCESS)
         {
-          fprintf (stderr, "nnet_tset_read_from_file: error reading file\n");
+          fprintf (stderr,
+                   "nnet_tset_element_destroy: error removing element from set\n");
           return EXIT_FAILURE;
         }
+    }
 
-      if (!feof (fp))
-        {
-          /* The first word is the element index */
-          if ((word = (char *) strtok (buf, delim)) != NULL)
-            {
-              new_index = ((ElementIndex) strtod (word, NULL)) + 1;
-            }
-          else
-            {
-              fprintf (stderr, "nnet_tset_read_from_file: '%s'\n", buf);
-              fprintf (stderr,
-                       "nnet_tset_read_from_file: error reading element index\n");
-              return EXIT_FAILURE;
-            }
+  /* Destroys the element and its vectors */
+  exit_status = nnet_tset_element_free (*element);
 
-          /* The second word is the vector component */
-          if ((word = (char *) strtok (NULL, delim)) != NULL)
-            {
-              new_pos = ((UnitIndex) strtod (word, NULL)) + 1;
-            }
-          else
-            {
-              fprintf (stderr, "nnet_tset_read_from_file: '%s'\n", buf);
-              fprintf (stderr,
-                       "nnet_tset_read_from_file: error reading vector component\n");
-              return EXIT_FAILURE;
-            }
+  if (exit_status != EXIT_SUCCESS)
+    {
+      fprintf (stderr,
+               "nnet_tset_element_destroy: error destroying element\n");
+      return EXIT_FAILURE;
+    }
 
-          /* The third word is the value */
-          if ((word = (char *) strtok (NULL, delim)) != NULL)
-            {
-              new_value = (RValue) strtod (word, NULL);
-            }
-          else
+  /* Makes it point to NULL */
+  *element = NULL;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_tset_element_attach_to_set
+ *
+ * Attaches a training element to a training set
+ */
+int
+nnet_tset_element_attach_to_set (TElement element,
+                                 TSet set, ElementIndex * index,
+                                 BoolValue correct_indexes)
+{
+  ElementIndex new_index;       /* index to attach the element */
+  ElementIndex cur_elmt;        /* element position counter */
+  TElement aux_elmt;            /* pointer to auxiliary element */
+  int exit_status;              /* auxiliary function return status */
+
+
+  /* Checks if an element was actually passed */
+  if (element == NULL)
+    {
+      fprintf (stderr,
+               "nnet_tset_element_attach_to_set: no element to attach\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Checks if a training set was actually passed */
+  if (set == NULL)
+    {
+      fprintf (stderr,
+               "nnet_tset_element_attach_to_set: no destination set\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Checks if the element has an input vector */
+  if (element->input == NULL)
+    {
+      fprintf (stderr,
+               "nnet_tset_element_attach_to_set: element has no input vector\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Checks the compatibility between the element and the set dimensions */
+  if (element->input->dimension != set->input_dimension)
+    {
+      fprintf (stderr,
+               "nnet_tset_element_attach_to_set: incompatible dimension of inputs\n");
+      return EXIT_FAILURE;
+    }
+
+  if (element->output != NULL)
+    if (element->output->dimension != set->output_dimension)
+      {
+        fprintf (stderr,
+                 "nnet_tset_element_attach_to_set: incompatible dimension of outputs\n");
+        return EXIT_FAILURE;
+      }
+
+  /* If the index was passed NULL, attach the element to the end of the set */
+  if (index == NULL)
+    new_index = set->nu_elements + 1;
+  else
+    new_index = *index;
+
+  /* Validates the new index: 1's logic */
+  if (new_index < 1 || new_index > set->nu_elements + 1)
+    {
+      fprintf (stderr,
+               "nnet_tset_element_attach_to_set: invalid position requested: %ld\n",
+               new_index);
+      return EXIT_FAILURE;
+    }
+
+  /* If the element was attached to another set, dettaches from it */
+  if (element->set != NULL)
+    {
+      if (element->set != set || element->element_index != new_index)
+        {
+          /* Removes from the old set */
+          exit_status =
+            nnet_tset_element_remove_from_set (element, correct_indexes);
+
+          if (exit_status != EXIT_SUCCESS)
             {
-              fprintf (stderr, "nnet_tset_read_from_file: '%s'\n", buf);
               fprintf (stderr,
-                       "nnet_tset_read_from_file: error reading component value\n");
+                       "nnet_tset_element_attach_to_set: error removing from old set\n");
               return EXIT_FAILURE;
             }
+        }
+      else
+        {
+          /* Attaching to the same set: nothing to do */
+          return EXIT_SUCCESS;
+        }
+    }
 
-          /* Increments the dimension counter */
-          ++dim_cnt;
+  /* Attaches the element */
+  if (new_index == 1)
+    {
+      /* Inserts at the head */
+      element->next = set->first_element;
+      set->first_element = element;
+    }
+  else
+    {
+      /* Goes to the element before the requested position */
+      if (new_index == set->nu_elements + 1)
+        aux_elmt = set->last_element;
+      else
+        {
+          aux_elmt = set->first_element;
 
-          /* Creates or not a new vector */
-          if (dim_cnt == 1 && !feof (fp))
-            {
-              /* Switches between input and output */
-              if (aux_vector == new_output || set->output_dimension == 0)
-                {
-                  /* Creates a new input element */
-                  new_input = vector_create (set->input_dimension);
-                  if (new_input == NULL)
-                    {
-                      fclose (fp);
-                      fprintf (stderr,
-                               "nnet_tset_read_from_file: error creating input vector\n");
-                      return EXIT_FAILURE;
-                    }
+          for (cur_elmt = 1; cur_elmt < new_index - 1; cur_elmt++)
+            aux_elmt = aux_elmt->next;
+        }
 
-                  /* Switches to input */
-                  aux_vector = new_input;
+      /* Inserts the new element */
+      element->next = aux_elmt->next;
+      aux_elmt->next = element;
+    }
 
-                  if (old_input == NULL)
-                    old_input = new_input;
-                }
-              else
-                {
-                  if (set->output_dimension > 0)
-                    {
-                      /* Creates a new output element */
-                      new_output = vector_create (set->output_dimension);
-                      if (new_output == NULL)
-                        {
-                          fclose (fp);
-                          fprintf (stderr,
-                                   "nnet_tset_read_from_file: error creating output vector\n");
-                          return EXIT_FAILURE;
-                        }
-                      aux_vector = new_output;
+  /* Increments the number of elements in the set */
+  ++set->nu_elements;
 
-                      if (old_output == NULL)
-                        old_output = new_output;
-                    }
-                }
-            }
+  /* Keeps track of the last element */
+  if (new_index == set->nu_elements)
+    set->last_element = element;
 
-          /* Creation of a new element */
-          if (new_index != old_index || feof (fp))
-            {
-              /* Creates a new element with the old input and output  */
-              new_element = nnet_tset_element_create
-                (set, NULL, old_input, old_output,
-                 normalize_input, normalize_output, FALSE);
+  /* If not inserted at the tail, corrects the other elements' indexes */
+  if (new_index != set->nu_elements && correct_indexes == TRUE)
+    nnet_tset_element_correct_indexes (element, new_index);
 
-              if (new_element == NULL)
-                {
-                  fclose (fp);
-                  fprintf (stderr,
-                           "nnet_tset_read_from_file: error creating new training element\n");
-                  return EXIT_FAILURE;
-                }
+  /* Sets the element's set attributes */
+  element->set = set;
+  element->element_index = new_index;
+
+  /* The element table no longer matches the list */
+  set->table_valid = FALSE;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_tset_element_remove_from_set
+ *
+ * Removes a training element from its training set
+ */
+int
+nnet_tset_element_remove_from_set (TElement element,
+                                   const BoolValue correct_indexes)
+{
+  TSet set;                     /* auxiliary set */
+  TElement aux_elmt;            /* auxiliary pointer to element */
+
+
+  /* Check if an element was passed */
+  if (element == NULL)
+    {
+      fprintf (stderr,
+               "nnet_tset_element_remove_from_set: no element to remove\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Verifies if the element is attached to a set */
+  if (element->set == NULL)
+    {
+      /* The element is not attached to a set: nothing to do */
+      return EXIT_SUCCESS;
+    }
+  else
+    set = element->set;
+
+  /* Goes to the element before */
+  if (element == set->first_element)
+    {
+      set->first_element = element->next;
+      aux_elmt = NULL;
+    }
+  else
+    {
+      aux_elmt = set->first_element;
+
+      while (aux_elmt->next != element && aux_elmt != NULL)
+        aux_elmt = aux_elmt->next;
+
+      /* Checks if the element is actually in the set */
+      if (aux_elmt == NULL)
+        {
+          fprintf (stderr,
+                   "nnet_tset_element_remove_from_set: element not found in set\n");
+          return EXIT_FAILURE;
+        }
+
+      /* Removes the element */
+      aux_elmt->next = element->next;
+    }
+
+  /* Keeps track of the last element in the set */
+  if (element == set->last_element)
+    set->last_element = aux_elmt;
+
+  /* Corrects the indexes of the other elements */
+  if (element->element_index != set->nu_elements && correct_indexes == TRUE)
+    nnet_tset_element_correct_indexes (element->next, element->element_index);
+
+  /* Decrements the number of elements in the set */
+  set->nu_elements--;
+
+  /* The element table no longer matches the list */
+  set->table_valid = FALSE;
+
+  /* Unsets the element's set attributes */
+  element->set = NULL;
+  element->element_index = 0;
+  element->next = NULL;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_tset_element_transfer_to_set
+ *
+ * Transfers a training element from its current set to the given set
+ */
+int
+nnet_tset_element_transfer_to_set (TElement element,
+                                   TSet new_set, ElementIndex * index,
+                                   const BoolValue correct_indexes)
+{
+  TSet old_set = NULL;          /* element's old set */
+  ElementIndex old_index;       /* element's old set index */
+  int exit_status;              /* auxiliary function return status */
+
+
+  /* Checks if the parameters were actually passed */
+  if (element == NULL)
+    {
+      fprintf (stderr,
+               "nnet_tset_element_transfer_to_set: no element passed\n");
+      return EXIT_FAILURE;
+    }
+
+  if (new_set == NULL)
+    {
+      fprintf (stderr,
+               "nnet_tset_element_transfer_to_set: no destination set\n");
+      return EXIT_FAILURE;
+    }
+
+  /* If the element is already attached to a set, removes from it */
+  if (element->set != NULL)
+    {
+      /* Stores the element's old set and index */
+      old_set = element->set;
+      old_index = element->element_index;
+
+      exit_status =
+        nnet_tset_element_remove_from_set (element, correct_indexes);
+
+      if (exit_status != EXIT_SUCCESS)
+        {
+          fprintf (stderr,
+                   "nnet_tset_element_transfer_to_set: error dettaching element from its original set\n");
+          return EXIT_FAILURE;
+        }
+    }
+
+  /* Attaches the element to the new set */
+  exit_status =
+    nnet_tset_element_attach_to_set (element, new_set, index,
+                                     correct_indexes);
+
+  if (exit_status != EXIT_SUCCESS)
+    {
+      fprintf (stderr,
+               "nnet_tset_element_transfer_to_set: error attaching element to its destination set\n");
+
+      /* Tries to undo the dettachment */
+      if (old_set != NULL)
+        {
+          exit_status =
+            nnet_tset_element_attach_to_set (element, old_set, &old_index,
+                                             correct_indexes);
+          if (exit_status != EXIT_SUCCESS)
+            {
+              fprintf (stderr,
+                       "nnet_tset_element_transfer_to_set: error trying to re-attach element to its old set\n");
+              return EXIT_FAILURE;
+            }
+        }
+
+      return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_tset_update_vector_stats
+ *
+ * Updates the input and output vector statistics in a single pass over
+ * the elements, accumulating blocks of elements in parallel
+ */
+int
+nnet_tset_update_vector_stats (const TSet set, const UsIntValue nu_threads)
+{
+  /* Checks if the training set was actually passed */
+  if (set == NULL)
+    {
+      fprintf (stderr, "nnet_tset_update_vector_stats: no set passed\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Checks if the set has elements */
+  if (set->nu_elements < 1)
+    {
+      fprintf (stderr, "nnet_tset_update_vector_stats: empty set\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Calculates the input statistics */
+  if (set->input_dimension > 0)
+    {
+      if (nnet_tset_reduce_stats (set, FALSE, nu_threads,
+                                  set->input_vector_stats) != EXIT_SUCCESS)
+        {
+          fprintf (stderr,
+                   "nnet_tset_update_vector_stats: error getting input statistic vectors set\n");
+          return EXIT_FAILURE;
+        }
+    }
+
+  /* Calculates the output statistics */
+  if (set->output_dimension > 0)
+    {
+      if (nnet_tset_reduce_stats (set, TRUE, nu_threads,
+                                  set->output_vector_stats) != EXIT_SUCCESS)
+        {
+          fprintf (stderr,
+                   "nnet_tset_update_vector_stats: error getting output statistic vectors set\n");
+          return EXIT_FAILURE;
+        }
+    }
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_tset_regularize
+ *
+ * Subtracts the averages and regularizes the training set input and output
+ * vectors according to the inverse standard deviations vectors
+ */
+int
+nnet_tset_regularize (TSet set,
+                      const BoolValue regularize_inputs,
+                      const BoolValue regularize_outputs)
+{
+  Vector input_avg_vector = NULL;       /* input average vector */
+  Vector output_avg_vector = NULL;      /* output average vector */
+  Vector input_pond_vector = NULL;      /* input ponderation vector */
+  Vector output_pond_vector = NULL;     /* output ponderation vector */
+
+
+  /* Checks if the training set was actually passed */
+  if (set == NULL)
+    {
+      fprintf (stderr, "nnet_tset_regularize: no training set passed\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Checks if the set is not empty */
+  if (set->nu_elements == 0)
+    {
+      fprintf (stderr, "nnet_tset_regularize: empty set passed\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Trivial case: nothing to do */
+  if (regularize_inputs == FALSE && regularize_outputs == FALSE)
+    return EXIT_SUCCESS;
+
+  /* Initialization of the ponderation vectors */
+  if (set->input_vector_stats != NULL)
+    {
+      input_avg_vector = set->input_vector_stats->average;
+      input_pond_vector = set->input_vector_stats->invstddev;
+    }
+
+  if (set->output_vector_stats != NULL)
+    {
+      output_avg_vector = set->output_vector_stats->average;
+      output_pond_vector = set->output_vector_stats->invstddev;
+    }
+
+  /* Checks if the statistic vectors are valid */
+  if (regularize_inputs == TRUE && set->input_dimension > 0 &&
+      (input_avg_vector == NULL || input_pond_vector == NULL))
+    {
+      fprintf (stderr,
+               "nnet_tset_regularize: input statistics are out of date\n");
+      return EXIT_FAILURE;
+    }
+
+  if (regularize_outputs == TRUE && set->output_dimension > 0 &&
+      (output_avg_vector == NULL || output_pond_vector == NULL))
+    {
+      fprintf (stderr,
+               "nnet_tset_regularize: output statistics are out of date\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Regularizes the training set */
+  if (regularize_inputs == TRUE && set->input_dimension > 0 &&
+      nnet_tset_regularize_vectors (set, FALSE, set->input_vector_stats) !=
+      EXIT_SUCCESS)
+    {
+      fprintf (stderr,
+               "nnet_tset_regularize: error ponderating input elements\n");
+      return EXIT_FAILURE;
+    }
+
+  if (regularize_outputs == TRUE && set->output_dimension > 0 &&
+      nnet_tset_regularize_vectors (set, TRUE, set->output_vector_stats) !=
+      EXIT_SUCCESS)
+    {
+      fprintf (stderr,
+               "nnet_tset_regularize: error ponderating output elements\n");
+      return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_tset_read_from_file
+ *
+ * Reads a training set from a file
+ */
+int
+nnet_tset_read_from_file (TSet set,
+                          const char *file_name,
+                          const BoolValue normalize_input,
+                          const BoolValue normalize_output,
+                          const BoolValue update_vector_stats,
+                          const BoolValue regularize_inputs,
+                          const BoolValue regularize_outputs)
+{
+  FILE *fp;                     /* pointer to file descriptor */
+  char buf[NNET_BUF_SIZE];      /* read buffer */
+  char *word;                   /* auxiliar character */
+  char *cursor;                 /* position in the line */
+
+  TElement new_element = NULL;  /* new training element */
+  Vector new_input = NULL;      /* new training element's input vector */
+  Vector new_output = NULL;     /* new training element's output vector */
+  Vector old_input = NULL;      /* old training element's input vector */
+  Vector old_output = NULL;     /* old training element's output vector */
+  Vector aux_vector = NULL;     /* auxiliary vector */
+
+  ElementIndex new_index;       /* new element index */
+  ElementIndex old_index;       /* old element index */
+  UnitIndex new_pos;            /* new value position */
+  RValue new_value;             /* new value */
+  UnitIndex dim_cnt;            /* vector dimension counter */
+
+  int exit_status;              /* auxiliary function return status */
+
+
+  /* Checks if the training set was actually passed */
+  if (set == NULL)
+    {
+      fprintf (stderr, "nnet_tset_read_from_file: no training set passed \n");
+      return EXIT_FAILURE;
+    }
+
+  /* Checks if a file name was passed */
+  if (file_name == NULL)
+    {
+      fprintf (stderr, "nnet_tset_read_from_file: no file name\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Checks flag consistency */
+  if (update_vector_stats == FALSE &&
+      (regularize_inputs == TRUE || regularize_outputs == TRUE))
+    {
+      fprintf (stderr,
+               "nnet_tset_read_from_file: unable to regularize set without updating vector statistics\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Opens the file for reading */
+  errno = 0;
+  fp = fopen (file_name, "r");
+
+  if (fp == NULL)
+    {
+      fprintf (stderr, "nnet_tset_read_from_file: %s\n", strerror (errno));
+      return EXIT_FAILURE;
+    }
+
+  /* Initializes the auxiliary element indexes */
+  new_index = 1;
+  old_index = 1;
+  new_pos = 1;
+  new_value = 0.0;
+  dim_cnt = 0;
+
+  /* Reads the file */
+  while (!feof (fp))
+    {
+      /* Reads one line */
+      exit_status = read_valid_file_line (fp, NNET_BUF_SIZE, '#', 1, buf);
+      if (exit_status != EXIT_SUCCESS)
+        {
+          fprintf (stderr, "nnet_tset_read_from_file: error reading file\n");
+          return EXIT_FAILURE;
+        }
+
+      if (!feof (fp))
+        {
+          /* The first word is the element index */
+          cursor = buf;
+
+          if ((word = nnet_tset_next_word (&cursor)) != NULL)
+            {
+              new_index = ((ElementIndex) strtod (word, NULL)) + 1;
+            }
+          else
+            {
+              fprintf (stderr, "nnet_tset_read_from_file: '%s'\n", buf);
+              fprintf (stderr,
+                       "nnet_tset_read_from_file: error reading element index\n");
+              return EXIT_FAILURE;
+            }
+
+          /* The second word is the vector component */
+          if ((word = nnet_tset_next_word (&cursor)) != NULL)
+            {
+              new_pos = ((UnitIndex) strtod (word, NULL)) + 1;
+            }
+          else
+            {
+              fprintf (stderr, "nnet_tset_read_from_file: '%s'\n", buf);
+              fprintf (stderr,
+                       "nnet_tset_read_from_file: error reading vector component\n");
+              return EXIT_FAILURE;
+            }
+
+          /* The third word is the value */
+          if ((word = nnet_tset_next_word (&cursor)) != NULL)
+            {
+              new_value = (RValue) strtod (word, NULL);
+            }
+          else
+            {
+              fprintf (stderr, "nnet_tset_read_from_file: '%s'\n", buf);
+              fprintf (stderr,
+                       "nnet_tset_read_from_file: error reading component value\n");
+              return EXIT_FAILURE;
+            }
+
+          /* Increments the dimension counter */
+          ++dim_cnt;
+
+          /* Creates or not a new vector */
+          if (dim_cnt == 1 && !feof (fp))
+            {
+              /* Switches between input and output */
+              if (aux_vector == new_output || set->output_dimension == 0)
+                {
+                  /* Creates a new input element */
+                  new_input = vector_create (set->input_dimension);
+                  if (new_input == NULL)
+                    {
+                      fclose (fp);
+                      fprintf (stderr,
+                               "nnet_tset_read_from_file: error creating input vector\n");
+                      return EXIT_FAILURE;
+                    }
+
+                  /* Switches to input */
+                  aux_vector = new_input;
+
+                  if (old_input == NULL)
+                    old_input = new_input;
+                }
+              else
+                {
+                  if (set->output_dimension > 0)
+                    {
+                      /* Creates a new output element */
+                      new_output = vector_create (set->output_dimension);
+                      if (new_output == NULL)
+                        {
+                          fclose (fp);
+                          fprintf (stderr,
+                                   "nnet_tset_read_from_file: error creating output vector\n");
+                          return EXIT_FAILURE;
+                        }
+                      aux_vector = new_output;
+
+                      if (old_output == NULL)
+                        old_output = new_output;
+                    }
+                }
+            }
+
+          /* A new element must start with a new vector */
+          if (new_index != old_index && dim_cnt != 1)
+            {
+              fclose (fp);
+              fprintf (stderr,
+                       "nnet_tset_read_from_file: element %ld of '%s' is incomplete\n",
+                       old_index - 1, file_name);
+              vector_destroy (&old_input);
+              if (old_output != NULL)
+                vector_destroy (&old_output);
+              return EXIT_FAILURE;
+            }
+
+          /* Creation of a new element */
+          if (new_index != old_index || feof (fp))
+            {
+              /* Creates a new element with the old input and output  */
+              new_element = nnet_tset_element_create
+                (set, NULL, old_input, old_output,
+                 normalize_input, normalize_output, FALSE);
+
+              if (new_element == NULL)
+                {
+                  fclose (fp);
+                  fprintf (stderr,
+                           "nnet_tset_read_from_file: error creating new training element\n");
+                  return EXIT_FAILURE;
+                }
+
+              /* Refreshes the old index */
+              old_index = new_index;
+              old_input = new_input;
+              old_output = new_output;
+            }
+
+          /* Sets the value of the dimension */
+          exit_status = vector_set_value (aux_vector, new_pos, new_value);
+
+          if (exit_status != EXIT_SUCCESS)
+            {
+              fclose (fp);
+              fprintf (stderr,
+                       "nnet_tset_read_from_file: error setting value\n");
+              return EXIT_FAILURE;
+            }
+
+          /* Resets the dimension counter */
+          if (dim_cnt == aux_vector->dimension)
+            dim_cnt = 0;
+        }
+    }
+
+  /* Creates the last element */
+  if (old_input != NULL)
+    {
+      if (dim_cnt != 0 ||
+          (set->output_dimension > 0 && aux_vector != new_output))
+        {
+          fclose (fp);
+          fprintf (stderr,
+                   "nnet_tset_read_from_file: element %ld of '%s' is incomplete\n",
+                   old_index - 1, file_name);
+          vector_destroy (&old_input);
+          if (old_output != NULL)
+            vector_destroy (&old_output);
+          return EXIT_FAILURE;
+        }
+
+      new_element = nnet_tset_element_create
+        (set, NULL, old_input, old_output,
+         normalize_input, normalize_output, FALSE);
+
+      if (new_element == NULL)
+        {
+          fclose (fp);
+          fprintf (stderr,
+                   "nnet_tset_read_from_file: error creating new training element\n");
+          return EXIT_FAILURE;
+        }
+    }
+
+  /* Closes the file */
+  errno = 0;
+  if (fclose (fp) == EOF)
+    {
+      fprintf (stderr, "nnet_tset_read_from_file: %s\n", strerror (errno));
+      return EXIT_FAILURE;
+    }
+
+  /* Optionally update vector statistics */
+  if (nnet_tset_update_read_stats (set, update_vector_stats,
+                                   regularize_inputs, regularize_outputs)
+      != EXIT_SUCCESS)
+    {
+      fprintf (stderr,
+               "nnet_tset_read_from_file: error updating vector statistics\n");
+      return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_tset_create_from_file
+ *
+ * Creates a new training set and reads its contents from a file
+ */
+TSet
+nnet_tset_create_from_file (const Name name,
+                            const UnitIndex input_dimension,
+                            const UnitIndex output_dimension,
+                            const BoolValue normalize_input,
+                            const BoolValue normalize_output,
+                            const BoolValue update_vector_stats,
+                            const BoolValue regularize_inputs,
+                            const BoolValue regularize_outputs,
+                            const char *file_name)
+{
+  TSet new_set;                 /* new training set */
+  int exit_status;              /* auxiliary function return status */
+
+  /* Creates the new training set */
+  new_set = nnet_tset_create (name, input_dimension, output_dimension);
+
+  if (new_set == NULL)
+    {
+      fprintf (stderr,
+               "nnet_tset_create_from_file: error creating new training set\n");
+      return NULL;
+    }
+
+  /* Reads its contents from the given file */
+  exit_status = nnet_tset_read_from_file (new_set,
+                                          file_name,
+                                          normalize_input,
+                                          normalize_output,
+                                          update_vector_stats,
+                                          regularize_inputs,
+                                          regularize_outputs);
+
+  if (exit_status != EXIT_SUCCESS)
+    {
+      fprintf (stderr,
+               "nnet_tset_create_from_file: error reading training set file\n");
+
+      exit_status = nnet_tset_destroy (&new_set, TRUE);
+
+      if (exit_status != EXIT_SUCCESS)
+        fprintf (stderr,
+                 "nnet_tset_create_from_file: error destroying set\n");
+
+      return NULL;
+    }
+
+  /* Moves the elements into contiguous storage */
+  if (nnet_tset_compact (new_set) != EXIT_SUCCESS)
+    {
+      fprintf (stderr,
+               "nnet_tset_create_from_file: error compacting training set\n");
+      nnet_tset_destroy (&new_set, TRUE);
+      return NULL;
+    }
+
+  return new_set;
+}
+
+
+
+/*
+ * nnet_tset_prepare
+ *
+ * Prepares a set whose elements were created in memory the way sets read
+ * from files are: updates its vector statistics, optionally regularizes
+ * its elements by them, and compacts it
+ */
+int
+nnet_tset_prepare (TSet set,
+                   const BoolValue update_vector_stats,
+                   const BoolValue regularize_inputs,
+                   const BoolValue regularize_outputs)
+{
+  /* Checks if the set was actually passed */
+  if (set == NULL)
+    {
+      fprintf (stderr, "nnet_tset_prepare: no training set passed\n");
+      return EXIT_FAILURE;
+    }
+
+  if (nnet_tset_update_read_stats (set, update_vector_stats,
+                                   regularize_inputs, regularize_outputs)
+      != EXIT_SUCCESS)
+    {
+      fprintf (stderr,
+               "nnet_tset_prepare: error updating vector statistics\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Moves the elements into contiguous storage */
+  if (nnet_tset_compact (set) != EXIT_SUCCESS)
+    {
+      fprintf (stderr, "nnet_tset_prepare: error compacting training set\n");
+      return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_tset_read_file_list
+ *
+ * Reads the names of the files listed in the given file, skipping blank
+ * lines and comments
+ */
+int
+nnet_tset_read_file_list (const char *list_file_name,
+                          char ***file_names, UsIntValue * nu_files)
+{
+  FILE *inlist_fd;              /* input list file descriptor */
+  FileName buf = "";            /* input buffer */
+  char **new_names;             /* enlarged file name list */
+  UsIntValue capacity = 0;      /* file name list capacity */
+  int exit_status = EXIT_SUCCESS;       /* auxiliary function return status */
+
+
+  /* checks if the list file name was actually passed */
+  if (list_file_name == NULL || file_names == NULL || nu_files == NULL)
+    {
+      fprintf (stderr,
+               "nnet_tset_read_file_list: no input list file name passed\n");
+      return EXIT_FAILURE;
+    }
+
+  *file_names = NULL;
+  *nu_files = 0;
+
+  if (error_if_null (inlist_fd = fopen (list_file_name, "r"),
+                     "nnet_tset_read_file_list", strerror (errno)))
+    return EXIT_FAILURE;
+
+  while (!feof (inlist_fd) && exit_status == EXIT_SUCCESS)
+    {
+      /* Reads the input file name */
+      if (error_if_failure (read_valid_file_line
+                            (inlist_fd, FILE_NAME_SIZE, IGNORE_TOKEN, 1, buf),
+                            "nnet_tset_read_file_list",
+                            "error reading input file name from list '%s'\n",
+                            list_file_name))
+        {
+          exit_status = EXIT_FAILURE;
+          continue;
+        }
+
+      if (feof (inlist_fd))
+        continue;
+
+      /* Enlarges the list, doubling it to amortize the growth */
+      if (*nu_files == capacity)
+        {
+          new_names = (char **)
+            realloc (*file_names, 2 * (capacity + 1) * sizeof (char *));
+
+          if (new_names == NULL)
+            {
+              fprintf (stderr,
+                       "nnet_tset_read_file_list: virtual memory exhausted\n");
+              exit_status = EXIT_FAILURE;
+              continue;
+            }
+
+          *file_names = new_names;
+          capacity = 2 * (capacity + 1);
+        }
+
+      (*file_names)[*nu_files] = (char *) malloc (strlen (buf) + 1);
+
+      if ((*file_names)[*nu_files] == NULL)
+        {
+          fprintf (stderr,
+                   "nnet_tset_read_file_list: virtual memory exhausted\n");
+          exit_status = EXIT_FAILURE;
+          continue;
+        }
+
+      strcpy ((*file_names)[*nu_files], buf);
+      ++(*nu_files);
+    }
+
+  fclose (inlist_fd);
+
+  if (exit_status != EXIT_SUCCESS)
+    nnet_tset_free_file_list (file_names, nu_files);
+
+  return exit_status;
+}
+
+
+
+/*
+ * nnet_tset_free_file_list
+ *
+ * Releases a list of file names read by nnet_tset_read_file_list
+ */
+void
+nnet_tset_free_file_list (char ***file_names, UsIntValue * nu_files)
+{
+  UsIntValue cur_file;          /* current file */
+
+
+  if (file_names == NULL || *file_names == NULL)
+    return;
+
+  for (cur_file = 0; cur_file < *nu_files; cur_file++)
+    free ((*file_names)[cur_file]);
+
+  free (*file_names);
+
+  *file_names = NULL;
+  *nu_files = 0;
+
+  return;
+}
+
+
+
+/*
+ * nnet_tset_create_from_list
+ *
+ * Creates a new training set and reads its contents from a file
+ * containint a list of files.
+ * The files are read by a pool of 'nu_threads' threads, each into its
+ * own set, with its own statistics and regularization. The sets are then
+ * merged into the new set in list order, so the result does not depend
+ * on the number of threads.
+ */
+TSet
+nnet_tset_create_from_list (const Name name,
+                            const UnitIndex input_dimension,
+                            const UnitIndex output_dimension,
+                            const BoolValue normalize_input,
+                            const BoolValue normalize_output,
+                            const BoolValue update_vector_stats,
+                            const BoolValue regularize_inputs,
+                            const BoolValue regularize_outputs,
+                            const UsIntValue nu_threads,
+                            const char *list_file_name)
+{
+  TSet t_set = NULL;            /* new training set */
+  nnet_tset_load_type load;     /* files being read */
+  pthread_t *threads = NULL;    /* worker threads */
+  UsIntValue nu_workers;        /* number of worker threads */
+  UsIntValue nu_started = 0;    /* worker threads started */
+  UsIntValue cur_file;          /* current file */
+  int exit_status = EXIT_SUCCESS;       /* auxiliary function return status */
+
+
+  /* reads the file names */
+  load.file_names = NULL;
+  load.nu_files = 0;
+
+  if (error_if_failure (nnet_tset_read_file_list
+                        (list_file_name, &load.file_names, &load.nu_files),
+                        "nnet_tset_create_from_list",
+                        "error reading input list '%s'\n",
+                        list_file_name != NULL ? list_file_name : ""))
+    return NULL;
+
+  /* creates the new training set */
+  if (error_if_null
+      (t_set = nnet_tset_create (name, input_dimension, output_dimension),
+       "nnet_tset_create_from_list", "error creating training set\n"))
+    {
+      nnet_tset_free_file_list (&load.file_names, &load.nu_files);
+      return NULL;
+    }
+
+  /* creates one auxiliary training set for each file */
+  load.sets = (TSet *) calloc (load.nu_files + 1, sizeof (TSet));
+  load.status = (int *) malloc ((load.nu_files + 1) * sizeof (int));
+  load.next_file = 0;
+  load.normalize_input = normalize_input;
+  load.normalize_output = normalize_output;
+  load.update_vector_stats = update_vector_stats;
+  load.regularize_inputs = regularize_inputs;
+  load.regularize_outputs = regularize_outputs;
+
+  if (load.sets == NULL || load.status == NULL)
+    {
+      fprintf (stderr,
+               "nnet_tset_create_from_list: virtual memory exhausted\n");
+      exit_status = EXIT_FAILURE;
+    }
+
+  for (cur_file = 0;
+       cur_file < load.nu_files && exit_status == EXIT_SUCCESS; cur_file++)
+    {
+      load.status[cur_file] = EXIT_FAILURE;
+      load.sets[cur_file] =
+        nnet_tset_create (NULL, input_dimension, output_dimension);
+
+      if (load.sets[cur_file] == NULL)
+        {
+          fprintf (stderr,
+                   "nnet_tset_create_from_list: error creating temporary training set\n");
+          exit_status = EXIT_FAILURE;
+        }
+    }
+
+  /* parses the files */
+  if (exit_status == EXIT_SUCCESS)
+    {
+      nu_workers = (nu_threads < load.nu_files) ? nu_threads : load.nu_files;
+
+      if (nu_workers > 1)
+        threads = (pthread_t *) malloc (nu_workers * sizeof (pthread_t));
+
+      pthread_mutex_init (&load.lock, NULL);
+
+      if (threads != NULL)
+        for (nu_started = 0; nu_started < nu_workers; nu_started++)
+          if (pthread_create (&threads[nu_started], NULL,
+                              nnet_tset_load_worker, &load) != 0)
+            break;
+
+      /* Without workers the files are read here */
+      if (nu_started == 0)
+        nnet_tset_load_worker (&load);
+
+      for (cur_file = 0; cur_file < nu_started; cur_file++)
+        pthread_join (threads[cur_file], NULL);
+
+      pthread_mutex_destroy (&load.lock);
+      free (threads);
+    }
+
+  /* merges the files into the new set in list order */
+  for (cur_file = 0;
+       cur_file < load.nu_files && exit_status == EXIT_SUCCESS; cur_file++)
+    {
+      if (load.status[cur_file] != EXIT_SUCCESS)
+        {
+          fprintf (stderr,
+                   "nnet_tset_create_from_list: error reading training set from file '%s'\n",
+                   load.file_names[cur_file]);
+          exit_status = EXIT_FAILURE;
+          continue;
+        }
+
+      if (nnet_tset_merge (load.sets[cur_file], t_set) != EXIT_SUCCESS)
+        {
+          fprintf (stderr,
+                   "nnet_tset_create_from_list: error merging training set with file '%s'\n",
+                   load.file_names[cur_file]);
+          exit_status = EXIT_FAILURE;
+          continue;
+        }
+
+      nnet_tset_destroy (&(load.sets[cur_file]), TRUE);
+    }
+
+  /* destroys the auxiliary training sets */
+  if (load.sets != NULL)
+    for (cur_file = 0; cur_file < load.nu_files; cur_file++)
+      if (load.sets[cur_file] != NULL)
+        nnet_tset_destroy (&(load.sets[cur_file]), TRUE);
+
+  free (load.sets);
+  free (load.status);
+  nnet_tset_free_file_list (&load.file_names, &load.nu_files);
+
+  if (exit_status != EXIT_SUCCESS)
+    {
+      nnet_tset_destroy (&t_set, TRUE);
+      return NULL;
+    }
+
+  /* moves the elements of all files into contiguous storage */
+  if (error_if_failure (nnet_tset_compact (t_set),
+                        "nnet_tset_create_from_list",
+                        "error compacting training set\n"))
+    {
+      nnet_tset_destroy (&t_set, TRUE);
+      return NULL;
+    }
+
+  return t_set;
+}
+
+
+
+/*
+ * nnet_tset_index
+ *
+ * Rebuilds the element table, if the element list has changed since it
+ * was last built
+ */
+int
+nnet_tset_index (TSet set)
+{
+  TElement *new_table;          /* enlarged element table */
+  TElement cur_element;         /* current element */
+  ElementIndex cur_pos;         /* current table position */
 
-              /* Refreshes the old index */
-              old_index = new_index;
-              old_input = new_input;
-              old_output = new_output;
-            }
 
-          /* Sets the value of the dimension */
-          exit_status = vector_set_value (aux_vector, new_pos, new_value);
+  /* Check if the set was passed */
+  if (set == NULL)
+    {
+      fprintf (stderr, "nnet_tset_index: no set passed\n");
+      return EXIT_FAILURE;
+    }
 
-          if (exit_status != EXIT_SUCCESS)
-            {
-              fclose (fp);
-              fprintf (stderr,
-                       "nnet_tset_read_from_file: error setting value\n");
-              return EXIT_FAILURE;
-            }
+  if (set->table_valid == TRUE)
+    return EXIT_SUCCESS;
 
-          /* Resets the dimension counter */
-          if (dim_cnt == aux_vector->dimension)
-            dim_cnt = 0;
+  /* Enlarges the table, doubling it to amortize the growth */
+  if (set->table_size < set->nu_elements)
+    {
+      new_table = (TElement *)
+        realloc (set->element_table,
+                 2 * set->nu_elements * sizeof (TElement));
+
+      if (new_table == NULL)
+        {
+          fprintf (stderr, "nnet_tset_index: virtual memory exhausted\n");
+          return EXIT_FAILURE;
         }
+
+      set->element_table = new_table;
+      set->table_size = 2 * set->nu_elements;
     }
 
-  /* Closes the file */
-  errno = 0;
-  if (fclose (fp) == EOF)
+  cur_element = set->first_element;
+
+  for (cur_pos = 0; cur_pos < set->nu_elements && cur_element != NULL;
+       cur_pos++)
     {
-      fprintf (stderr, "nnet_tset_read_from_file: %s\n", strerror (errno));
+      set->element_table[cur_pos] = cur_element;
+      cur_element = cur_element->next;
+    }
+
+  if (cur_pos != set->nu_elements || cur_element != NULL)
+    {
+      fprintf (stderr,
+               "nnet_tset_index: set element count is inconsistent with its element list\n");
       return EXIT_FAILURE;
     }
 
-  /* Optionally update vector statistics */
-  if (update_vector_stats == TRUE)
+  set->table_valid = TRUE;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_tset_compact
+ *
+ * Moves all the elements of the set into a single arena, in the set
+ * order, so that consecutive elements have consecutive inputs and outputs
+ * in memory. The element records are replaced: element pointers taken
+ * before the compaction are no longer valid.
+ */
+int
+nnet_tset_compact (TSet set)
+{
+  TSetArenaPtr arena;           /* new storage */
+  TElement cur_element;         /* current old element */
+  TElement next_element;        /* next old element */
+  TElement new_element;         /* current new element */
+  ElementIndex cur_pos;         /* current element position */
+  UnitIndex output_dimension;   /* arena output dimension */
+  int exit_status = EXIT_SUCCESS;       /* function return status */
+
+
+  /* Check if the set was passed */
+  if (set == NULL)
     {
-      exit_status = nnet_tset_update_vector_stats (set);
+      fprintf (stderr, "nnet_tset_compact: no set passed\n");
+      return EXIT_FAILURE;
+    }
 
-      if (exit_status != EXIT_SUCCESS)
+  /* Trivial case */
+  if (set->nu_elements == 0)
+    return EXIT_SUCCESS;
+
+  /* Checks the element vectors before touching anything */
+  output_dimension = 0;
+
+  for (cur_element = set->first_element; cur_element != NULL;
+       cur_element = cur_element->next)
+    {
+      if (cur_element->input == NULL ||
+          cur_element->input->dimension != set->input_dimension)
         {
           fprintf (stderr,
-                   "nnet_tset_read_from_file: error updating vector statistics\n");
+                   "nnet_tset_compact: element %ld has incompatible input dimension\n",
+                   cur_element->element_index);
           return EXIT_FAILURE;
         }
 
-      /* Optionally regularizes the set elements */
-      if (regularize_inputs == TRUE || regularize_outputs == TRUE)
-        {
-          exit_status =
-            nnet_tset_regularize (set, regularize_inputs, regularize_outputs);
+      if (cur_element->output != NULL)
+        output_dimension = set->output_dimension;
+    }
 
-          if (exit_status != EXIT_SUCCESS)
-            {
-              fprintf (stderr,
-                       "nnet_tset_read_from_file: error ponderating training set\n");
-              return EXIT_FAILURE;
-            }
+  /* Allocates the arena */
+  arena = nnet_tset_arena_create
+    (set->nu_elements, set->input_dimension, output_dimension);
+
+  if (arena == NULL)
+    {
+      fprintf (stderr, "nnet_tset_compact: virtual memory exhausted\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Copies the elements in order, releasing the old ones */
+  cur_element = set->first_element;
+
+  for (cur_pos = 0; cur_pos < set->nu_elements; cur_pos++)
+    {
+      next_element = cur_element->next;
+      new_element = &(arena->elements[cur_pos]);
+
+      new_element->set = set;
+      new_element->element_index = cur_pos + 1;
+      new_element->arena = arena;
+      new_element->next = (cur_pos + 1 < set->nu_elements) ?
+        &(arena->elements[cur_pos + 1]) : NULL;
+
+      new_element->input = &(arena->vectors[2 * cur_pos]);
+      new_element->input->dimension = set->input_dimension;
+      new_element->input->value =
+        &(arena->inputs[cur_pos * set->input_dimension]);
+      memcpy (new_element->input->value, cur_element->input->value,
+              set->input_dimension * sizeof (RValue));
+
+      if (cur_element->output != NULL && output_dimension > 0)
+        {
+          new_element->output = &(arena->vectors[2 * cur_pos + 1]);
+          new_element->output->dimension = output_dimension;
+          new_element->output->value =
+            &(arena->outputs[cur_pos * output_dimension]);
+          memcpy (new_element->output->value, cur_element->output->value,
+                  output_dimension * sizeof (RValue));
         }
+      else
+        new_element->output = NULL;
 
-      /* Updates the vector statistics again */
-      exit_status = nnet_tset_update_vector_stats (set);
+      ++arena->nu_references;
 
-      if (exit_status != EXIT_SUCCESS)
+      if (nnet_tset_element_free (cur_element) != EXIT_SUCCESS)
+        exit_status = EXIT_FAILURE;
+
+      cur_element = next_element;
+    }
+
+  /* Links the new elements to the set */
+  set->first_element = &(arena->elements[0]);
+  set->last_element = &(arena->elements[set->nu_elements - 1]);
+  set->table_valid = FALSE;
+
+  if (exit_status != EXIT_SUCCESS)
+    {
+      fprintf (stderr, "nnet_tset_compact: error releasing old elements\n");
+      return EXIT_FAILURE;
+    }
+
+  return nnet_tset_index (set);
+}
+
+
+
+/*
+ * nnet_tset_set_training_order
+ *
+ * Makes the training functions visit the set elements in a new random
+ * order at each epoch, shuffled in blocks of the given number of elements
+ * (0 or 1 for single elements), or in the set order again
+ */
+int
+nnet_tset_set_training_order (TSet set,
+                              const BoolValue shuffle_each_epoch,
+                              const UsLgIntValue seed,
+                              const ElementIndex block_size)
+{
+  TSetOrderPtr new_order;       /* new training order */
+
+
+  /* Check if the set was passed */
+  if (set == NULL)
+    {
+      fprintf (stderr, "nnet_tset_set_training_order: no set passed\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Back to the set order */
+  if (shuffle_each_epoch == FALSE)
+    {
+      if (set->training_order != NULL)
+        free (set->training_order->positions);
+
+      free (set->training_order);
+      set->training_order = NULL;
+
+      return EXIT_SUCCESS;
+    }
+
+  /* Creates the order, if needed */
+  if (set->training_order == NULL)
+    {
+      new_order = (TSetOrderPtr) malloc (sizeof (nnet_tset_order_type));
+
+      if (new_order == NULL)
         {
           fprintf (stderr,
-                   "nnet_tset_read_from_file: error updating vector statistics after ponderation\n");
+                   "nnet_tset_set_training_order: virtual memory exhausted\n");
           return EXIT_FAILURE;
         }
+
+      new_order->nu_positions = 0;
+      new_order->positions = NULL;
+      set->training_order = new_order;
     }
 
+  set->training_order->seed = seed;
+  set->training_order->block_size = block_size;
+
   return EXIT_SUCCESS;
 }
 
 
 
 /*
- * nnet_tset_create_from_file
+ * nnet_tset_random_permutation
  *
- * Creates a new training set and reads its contents from a file
+ * Fills 'positions' with a random permutation of 0 .. nu_positions - 1,
+ * shuffled in blocks of the given number of consecutive positions (0 or 1
+ * for single positions), which depends only on the seed and the epoch
  */
-TSet
-nnet_tset_create_from_file (const Name name,
-                            const UnitIndex input_dimension,
-                            const UnitIndex output_dimension,
-                            const BoolValue normalize_input,
-                            const BoolValue normalize_output,
-                            const BoolValue update_vector_stats,
-                            const BoolValue regularize_inputs,
-                            const BoolValue regularize_outputs,
-                            const char *file_name)
+int
+nnet_tset_random_permutation (ElementIndex * positions,
+                              const ElementIndex nu_positions,
+                              const ElementIndex block_size,
+                              const UsLgIntValue seed, const DTime epoch)
 {
-  TSet new_set;                 /* new training set */
-  int exit_status;              /* auxiliary function return status */
+  ElementIndex *blocks;         /* block visiting order */
+  ElementIndex nu_blocks;       /* number of blocks */
+  ElementIndex cur_block;       /* current block */
+  ElementIndex block_start;     /* first position of the current block */
+  ElementIndex block_length;    /* elements in the current block */
+  ElementIndex cur_elmt;        /* current element of the block */
+  ElementIndex cur_pos;         /* current position */
+  UsLgIntValue state;           /* generator state */
 
-  /* Creates the new training set */
-  new_set = nnet_tset_create (name, input_dimension, output_dimension);
 
-  if (new_set == NULL)
+  /* Trivial case */
+  if (nu_positions == 0)
+    return EXIT_SUCCESS;
+
+  if (positions == NULL)
     {
-      fprintf (stderr,
-               "nnet_tset_create_from_file: error creating new training set\n");
-      return NULL;
+      fprintf (stderr, "nnet_tset_random_permutation: no positions passed\n");
+      return EXIT_FAILURE;
     }
 
-  /* Reads its contents from the given file */
-  exit_status = nnet_tset_read_from_file (new_set,
-                                          file_name,
-                                          normalize_input,
-                                          normalize_output,
-                                          update_vector_stats,
-                                          regularize_inputs,
-                                          regularize_outputs);
+  /* Seeds the generator with the seed and the epoch (murmur3 finalizer) */
+  state = (seed ^ (0x9E3779B9UL * (epoch + 1))) & 0xFFFFFFFFUL;
+  state ^= state >> 16;
+  state = (state * 0x85EBCA6BUL) & 0xFFFFFFFFUL;
+  state ^= state >> 13;
+  state = (state * 0xC2B2AE35UL) & 0xFFFFFFFFUL;
+  state ^= state >> 16;
 
-  if (exit_status != EXIT_SUCCESS)
+  if (state == 0)
+    state = 0x6D2B79F5UL;
+
+  /* Single positions */
+  if (block_size < 2 || block_size >= nu_positions)
+    {
+      for (cur_pos = 0; cur_pos < nu_positions; cur_pos++)
+        positions[cur_pos] = cur_pos;
+
+      nnet_tset_order_shuffle_range (positions, nu_positions, &state);
+
+      return EXIT_SUCCESS;
+    }
+
+  /* Blocks: shuffles the blocks, then the positions inside each block */
+  nu_blocks = (nu_positions + block_size - 1) / block_size;
+
+  blocks = (ElementIndex *) malloc (nu_blocks * sizeof (ElementIndex));
+
+  if (blocks == NULL)
     {
       fprintf (stderr,
-               "nnet_tset_create_from_file: error reading training set file\n");
+               "nnet_tset_random_permutation: virtual memory exhausted\n");
+      return EXIT_FAILURE;
+    }
 
-      exit_status = nnet_tset_destroy (&new_set, TRUE);
+  for (cur_block = 0; cur_block < nu_blocks; cur_block++)
+    blocks[cur_block] = cur_block;
 
-      if (exit_status != EXIT_SUCCESS)
-        fprintf (stderr,
-                 "nnet_tset_create_from_file: error destroying set\n");
+  nnet_tset_order_shuffle_range (blocks, nu_blocks, &state);
 
-      return NULL;
+  cur_pos = 0;
+
+  for (cur_block = 0; cur_block < nu_blocks; cur_block++)
+    {
+      block_start = blocks[cur_block] * block_size;
+      block_length = nu_positions - block_start;
+
+      if (block_length > block_size)
+        block_length = block_size;
+
+      for (cur_elmt = 0; cur_elmt < block_length; cur_elmt++)
+        positions[cur_pos + cur_elmt] = block_start + cur_elmt;
+
+      nnet_tset_order_shuffle_range
+        (positions + cur_pos, block_length, &state);
+
+      cur_pos += block_length;
     }
 
-  return new_set;
+  free (blocks);
+
+  return EXIT_SUCCESS;
 }
 
 
 
 /*
- * nnet_tset_create_from_list
+ * nnet_tset_shuffle_order
  *
- * Creates a new training set and reads its contents from a file
- * containint a list of files
+ * Generates the training order of the given epoch
  */
-TSet
-nnet_tset_create_from_list (const Name name,
-                            const UnitIndex input_dimension,
-                            const UnitIndex output_dimension,
-                            const BoolValue normalize_input,
-                            const BoolValue normalize_output,
-                            const BoolValue update_vector_stats,
-                            const BoolValue regularize_inputs,
-                            const BoolValue regularize_outputs,
-                            const char *list_file_name)
+int
+nnet_tset_shuffle_order (TSet set, const DTime epoch)
 {
-  TSet t_set = NULL;            /* new training set */
-  TSet aux_set = NULL;          /* auxiliary input training set */
-  FILE *inlist_fd;              /* input list file descriptor */
-  FileName buf = "";            /* input buffer */
-  char *set_file = NULL;        /* current set file name */
+  TSetOrderPtr order;           /* training order */
+  ElementIndex *new_positions;  /* resized permutation */
 
 
-  /* checks if the list file name was actually passed */
-  if (list_file_name == NULL)
+  /* Check if the set was passed */
+  if (set == NULL)
     {
-      fprintf (stderr,
-               "nnet_tset_create_from_list: no input list file name passed\n");
-      return NULL;
+      fprintf (stderr, "nnet_tset_shuffle_order: no set passed\n");
+      return EXIT_FAILURE;
     }
 
-  /* creates the new training set */
-  if (error_if_null
-      (t_set = nnet_tset_create (name, input_dimension, output_dimension),
-       "nnet_tset_create_from_list", "error creating training set\n"))
-    return NULL;
-
-  /* creates an auxiliary training set */
-  if (error_if_null
-      (aux_set = nnet_tset_create (NULL, input_dimension, output_dimension),
-       "nnet_tset_create_from_list",
-       "error creating temporary training set\n"))
-    return NULL;
-
-  /* processes all files in list */
-  if (error_if_null (inlist_fd = fopen (list_file_name, "r"),
-                     "nnet_tset_create_from_list", strerror (errno)))
+  if (set->training_order == NULL)
     {
-      puts ("");
-      return NULL;
+      fprintf (stderr, "nnet_tset_shuffle_order: no training order set\n");
+      return EXIT_FAILURE;
     }
 
+  order = set->training_order;
 
-  while (!feof (inlist_fd))
+  /* Follows the set size */
+  if (order->nu_positions != set->nu_elements)
     {
-      /* Reads the input file name */
-      if (error_if_failure (read_valid_file_line
-                            (inlist_fd, FILE_NAME_SIZE, IGNORE_TOKEN, 1, buf),
-                            "nnet_tset_create_from_list",
-                            "error reading input file name from list '%s'\n",
-                            list_file_name))
-        return NULL;
-
-      /* creates the auxiliary training set with the current file */
-      set_file = buf;
+      new_positions = (ElementIndex *)
+        realloc (order->positions,
+                 (set->nu_elements + 1) * sizeof (ElementIndex));
 
-      if (!feof (inlist_fd))
+      if (new_positions == NULL)
         {
-          if (error_if_failure (nnet_tset_read_from_file
-                                (aux_set, set_file, normalize_input,
-                                 normalize_output, update_vector_stats,
-                                 regularize_inputs, regularize_outputs),
-                                "nnet_tset_create_from_list",
-                                "error reading training set from file '%s'\n",
-                                set_file))
-            return NULL;
-
-          /* merges the auxiliary set with the real training set */
-          if (error_if_failure (nnet_tset_merge (aux_set, t_set),
-                                "nnet_tset_create_from_list",
-                                "error merging training set with file '%s'\n",
-                                set_file))
-            return NULL;
+          fprintf (stderr,
+                   "nnet_tset_shuffle_order: virtual memory exhausted\n");
+          return EXIT_FAILURE;
         }
+
+      order->positions = new_positions;
+      order->nu_positions = set->nu_elements;
     }
 
-  fclose (inlist_fd);
+  /* The element table translates positions into elements */
+  if (nnet_tset_index (set) != EXIT_SUCCESS)
+    {
+      fprintf (stderr, "nnet_tset_shuffle_order: error indexing set\n");
+      return EXIT_FAILURE;
+    }
 
-  /* destroys auxiliary training set */
-  if (error_if_failure (nnet_tset_destroy (&aux_set, TRUE),
-                        "nnet_tset_create_from_list",
-                        "error destroying auxiliary training set\n"))
-    return NULL;
+  return nnet_tset_random_permutation
+    (order->positions, order->nu_positions, order->block_size, order->seed,
+     epoch);
+}
 
-  return t_set;
+
+
+/*
+ * nnet_tset_order_element
+ *
+ * Returns the element at the given position (starting at 1) of the
+ * training order generated by nnet_tset_shuffle_order
+ */
+TElement
+nnet_tset_order_element (const TSet set, const ElementIndex position)
+{
+  /* Check if the set was passed */
+  if (set == NULL || set->training_order == NULL)
+    {
+      fprintf (stderr, "nnet_tset_order_element: no training order passed\n");
+      return NULL;
+    }
+
+  /* Checks the position */
+  if (position < 1 || position > set->training_order->nu_positions ||
+      set->table_valid == FALSE)
+    {
+      fprintf (stderr,
+               "nnet_tset_order_element: invalid position: %ld (%ld elements)\n",
+               position, set->training_order->nu_positions);
+      return NULL;
+    }
+
+  return set->element_table[set->training_order->positions[position - 1]];
 }
 
 
@@ -1642,9 +3021,6 @@ nnet_tset_create_from_list (const Name name,
 TElement
 nnet_tset_goto_element (const TSet set, const ElementIndex index)
 {
-  TElement cur_element;         /* auxiliary training element */
-  ElementIndex cur_index;       /* auxiliary element index */
-
   /* Check if the set was passed */
   if (set == NULL)
     {
@@ -1668,13 +3044,14 @@ nnet_tset_goto_element (const TSet set, const ElementIndex index)
   if (index == set->nu_elements)
     return set->last_element;
 
-  /* Searches the set */
-  cur_element = set->first_element;
-
-  for (cur_index = 1; cur_index <= index; cur_index++)
-    cur_element = cur_element->next;
+  /* Looks the element up in the table */
+  if (nnet_tset_index (set) != EXIT_SUCCESS)
+    {
+      fprintf (stderr, "nnet_tset_goto_element: error indexing set\n");
+      return NULL;
+    }
 
-  return cur_element;
+  return set->element_table[index - 1];
 }
 
 
@@ -19,6 +19,10 @@ typedef enum
 TSetDivisionCriterion;
 
 
+/* Elements accumulated separately before merging the set statistics */
+#define NNET_TSET_STATS_BLOCK 1024
+
+
 
 /******************************************************************************
  *                                                                            *
@@ -47,6 +51,28 @@ extern int nnet_tset_destroy (TSet * set, const BoolValue cascade_elements);
 
 
 
+/*
+ * nnet_tset_create_view
+ *
+ * Creates a view of the given set: a set that shares its elements and
+ * statistics, with its own element table and training order, so that
+ * several networks can be trained on one set at the same time, each in
+ * its own order. The set must not change while it has views, and views
+ * must be destroyed by nnet_tset_destroy_view.
+ */
+extern TSet nnet_tset_create_view (const Name name, const TSet set);
+
+
+
+/*
+ * nnet_tset_destroy_view
+ *
+ * Destroys a previously created view, leaving the viewed set untouched
+ */
+extern int nnet_tset_destroy_view (TSet * view);
+
+
+
 /*
  * nnet_tset_merge
  *
@@ -64,7 +90,8 @@ extern int nnet_tset_merge (TSet orig_set, TSet dest_set);
  * Creates a new training set by the division of an original training set,
  * transferring 'nu_elements' to the new set.
  * The elements can be picked from the beggining of the original set, from
- * the end of the original set or at random.
+ * the end of the original set or at random. Random picks take linear time
+ * and keep the order of the elements left in the original set.
  */
 extern int
 nnet_tset_divide (TSet orig_set,
@@ -78,12 +105,36 @@ nnet_tset_divide (TSet orig_set,
 /*
  * nnet_tset_randomize
  *
- * Shuffles the elements in the given set
+ * Shuffles the elements in the given set, in linear time
  */
 extern int nnet_tset_randomize (TSet set);
 
 
 
+/*
+ * nnet_tset_randomize_positions
+ *
+ * Shuffles the elements in the given set like nnet_tset_randomize, also
+ * returning in 'positions' (if passed) the former table position of the
+ * element now at each table position
+ */
+extern int
+nnet_tset_randomize_positions (TSet set, ElementIndex * positions);
+
+
+
+/*
+ * nnet_tset_permute
+ *
+ * Rearranges the elements in the given set so the element at each table
+ * position comes from the given former table position, repeating an order
+ * returned by nnet_tset_randomize_positions
+ */
+extern int
+nnet_tset_permute (TSet set, const ElementIndex * positions);
+
+
+
 /*
  * nnet_tset_element_create
  *
@@ -157,9 +208,14 @@ nnet_tset_element_transfer_to_set (TElement element,
 /*
  * nnet_tset_update_vector_stats
  *
- * Updates the input and output vector statistics
+ * Updates the input and output vector statistics in a single pass over
+ * the elements. Each block of NNET_TSET_STATS_BLOCK elements is
+ * accumulated on its own, by up to 'nu_threads' threads, and the blocks
+ * are merged in set order, so the result does not depend on the number
+ * of threads.
  */
-extern int nnet_tset_update_vector_stats (const TSet set);
+extern int
+nnet_tset_update_vector_stats (const TSet set, const UsIntValue nu_threads);
 
 
 
@@ -167,7 +223,8 @@ extern int nnet_tset_update_vector_stats (const TSet set);
  * nnet_tset_regularize
  *
  * Subtracts the averages and regularizes the training set input and output
- * vectors according to the inverse standard deviations vectors
+ * vectors according to the inverse standard deviations vectors, in a
+ * single pass over the elements
  */
 extern int
 nnet_tset_regularize (TSet set,
@@ -210,11 +267,49 @@ nnet_tset_create_from_file (const Name name,
 
 
 
+/*
+ * nnet_tset_prepare
+ *
+ * Prepares a set whose elements were created in memory the way sets read
+ * from files are: updates its vector statistics, optionally regularizes
+ * its elements by them, and compacts it
+ */
+extern int
+nnet_tset_prepare (TSet set,
+                   const BoolValue update_vector_stats,
+                   const BoolValue regularize_inputs,
+                   const BoolValue regularize_outputs);
+
+
+
+/*
+ * nnet_tset_read_file_list
+ *
+ * Reads the names of the files listed in the given file, skipping blank
+ * lines and comments
+ */
+extern int
+nnet_tset_read_file_list (const char *list_file_name,
+                          char ***file_names, UsIntValue * nu_files);
+
+
+
+/*
+ * nnet_tset_free_file_list
+ *
+ * Releases a list of file names read by nnet_tset_read_file_list
+ */
+extern void
+nnet_tset_free_file_list (char ***file_names, UsIntValue * nu_files);
+
+
+
 /*
  * nnet_tset_create_from_list
  *
  * Creates a new training set and reads its contents from a file
- * containint a list of files
+ * containint a list of files, parsing up to 'nu_threads' files at once.
+ * The result is the same as reading the files one after another.
  */
 extern TSet
 nnet_tset_create_from_list (const Name name,
@@ -225,14 +320,92 @@ nnet_tset_create_from_list (const Name name,
                             const BoolValue update_vector_stats,
                             const BoolValue regularize_inputs,
                             const BoolValue regularize_outputs,
+                            const UsIntValue nu_threads,
                             const char *list_file_name);
 
 
 
+/*
+ * nnet_tset_index
+ *
+ * Rebuilds the element table, if the element list has changed since it
+ * was last built. Sets shared by several threads should be indexed
+ * beforehand.
+ */
+extern int nnet_tset_index (TSet set);
+
+
+
+/*
+ * nnet_tset_compact
+ *
+ * Moves all the elements of the set into a single arena, in the set
+ * order, so that consecutive elements have consecutive inputs and outputs
+ * in memory. The element records are replaced: element pointers taken
+ * before the compaction are no longer valid.
+ * Sets created from files are compacted after reading.
+ */
+extern int nnet_tset_compact (TSet set);
+
+
+
+/*
+ * nnet_tset_set_training_order
+ *
+ * Makes the training functions visit the set elements in a new random
+ * order at each epoch, shuffled in blocks of the given number of elements
+ * (0 or 1 for single elements), or in the set order again.
+ * The order of each epoch depends only on the seed and the epoch number.
+ */
+extern int
+nnet_tset_set_training_order (TSet set,
+                              const BoolValue shuffle_each_epoch,
+                              const UsLgIntValue seed,
+                              const ElementIndex block_size);
+
+
+
+/*
+ * nnet_tset_random_permutation
+ *
+ * Fills 'positions' with a random permutation of 0 .. nu_positions - 1,
+ * shuffled in blocks of the given number of consecutive positions (0 or 1
+ * for single positions), which depends only on the seed and the epoch
+ */
+extern int
+nnet_tset_random_permutation (ElementIndex * positions,
+                              const ElementIndex nu_positions,
+                              const ElementIndex block_size,
+                              const UsLgIntValue seed, const DTime epoch);
+
+
+
+/*
+ * nnet_tset_shuffle_order
+ *
+ * Generates the training order of the given epoch, in linear time and
+ * without moving any element
+ */
+extern int nnet_tset_shuffle_order (TSet set, const DTime epoch);
+
+
+
+/*
+ * nnet_tset_order_element
+ *
+ * Returns the element at the given position (starting at 1) of the
+ * training order generated by nnet_tset_shuffle_order
+ */
+extern TElement
+nnet_tset_order_element (const TSet set, const ElementIndex position);
+
+
+
 /*
  * nnet_tset_goto_element
  *
- * Returns the element at the given index of the set
+ * Returns the element at the given index of the set, in constant time
+ * while the set is not changed
  */
 extern TElement
 nnet_tset_goto_element (const TSet set, const ElementIndex index);
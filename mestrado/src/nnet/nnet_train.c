@@ -269,6 +269,195 @@ nnet_train_lrate_destroy (LRateFunction * lrate_function)
 
 
 
+/*
+ * nnet_train_schedule_create
+ *
+ * Creates the schedule of the learning rate function, and of the width
+ * function if one is passed, from 'first_epoch' to 'max_epochs', with
+ * 'epoch_steps' steps in each epoch (0 or 1 for a single step)
+ */
+TSchedule
+nnet_train_schedule_create (const LRateFunction lrate_function,
+                            const TScheduleFunction width_function,
+                            void *width_data,
+                            const DTime first_epoch,
+                            const DTime max_epochs,
+                            const ElementIndex epoch_steps)
+{
+  TSchedule new_schedule;       /* new training schedule */
+  ElementIndex nu_values;       /* values of each parameter */
+  ElementIndex cur_value;       /* current value */
+  RValue time;                  /* time of the current value */
+
+
+  /* Checks the parameters */
+  if (lrate_function == NULL)
+    {
+      fprintf (stderr,
+               "nnet_train_schedule_create: no learning rate function passed\n");
+      return NULL;
+    }
+
+  if (first_epoch >= max_epochs)
+    {
+      fprintf (stderr,
+               "nnet_train_schedule_create: empty training horizon\n");
+      return NULL;
+    }
+
+  new_schedule = (TSchedule) malloc (sizeof (nnet_train_schedule_type));
+
+  if (new_schedule == NULL)
+    {
+      fprintf (stderr,
+               "nnet_train_schedule_create: virtual memory exhausted\n");
+      return NULL;
+    }
+
+  new_schedule->lrate_function = lrate_function;
+  new_schedule->width_function = width_function;
+  new_schedule->width_data = width_data;
+  new_schedule->first_epoch = first_epoch;
+  new_schedule->max_epochs = max_epochs;
+  new_schedule->epoch_steps = epoch_steps > 1 ? epoch_steps : 1;
+  new_schedule->cur_epoch = max_epochs;
+  new_schedule->width = NULL;
+
+  /* One value per epoch, or per step of the current epoch */
+  if (new_schedule->epoch_steps == 1)
+    nu_values = (ElementIndex) (max_epochs - first_epoch);
+  else
+    nu_values = new_schedule->epoch_steps;
+
+  new_schedule->etha = (RValue *) malloc (nu_values * sizeof (RValue));
+
+  if (width_function != NULL)
+    new_schedule->width = (RValue *) malloc (nu_values * sizeof (RValue));
+
+  if (new_schedule->etha == NULL ||
+      (width_function != NULL && new_schedule->width == NULL))
+    {
+      fprintf (stderr,
+               "nnet_train_schedule_create: virtual memory exhausted\n");
+      nnet_train_schedule_destroy (&new_schedule);
+      return NULL;
+    }
+
+  /* Single step schedules are filled once for the whole horizon */
+  if (new_schedule->epoch_steps == 1)
+    for (cur_value = 0; cur_value < nu_values; cur_value++)
+      {
+        time = (RValue) (first_epoch + cur_value);
+        new_schedule->etha[cur_value] = function_value (lrate_function, time);
+
+        if (width_function != NULL)
+          new_schedule->width[cur_value] = width_function (width_data, time);
+      }
+
+  return new_schedule;
+}
+
+
+
+/*
+ * nnet_train_schedule_destroy
+ *
+ * Destroys a previously created training schedule
+ */
+int
+nnet_train_schedule_destroy (TSchedule * schedule)
+{
+  /* Checks if the schedule was actually passed */
+  if (schedule == NULL || *schedule == NULL)
+    {
+      fprintf (stderr,
+               "nnet_train_schedule_destroy: no schedule to destroy\n");
+      return EXIT_FAILURE;
+    }
+
+  free ((*schedule)->etha);
+  free ((*schedule)->width);
+  free (*schedule);
+  *schedule = NULL;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_train_stop_create
+ *
+ * Creates a new early stopping rule, checked every 'check_epochs' epochs,
+ * which stops training after 'patience' checks without a relative
+ * improvement of 'min_improvement' on the best validation error
+ */
+TStopRule
+nnet_train_stop_create (const DTime check_epochs,
+                        const DTime patience, const RValue min_improvement)
+{
+  TStopRule new_rule;           /* new early stopping rule */
+
+
+  /* Checks the parameters */
+  if (check_epochs == 0 || patience == 0)
+    {
+      fprintf (stderr,
+               "nnet_train_stop_create: check epochs and patience must be positive\n");
+      return NULL;
+    }
+
+  if (min_improvement < 0.0 || min_improvement >= 1.0)
+    {
+      fprintf (stderr,
+               "nnet_train_stop_create: invalid minimum improvement: %f\n",
+               min_improvement);
+      return NULL;
+    }
+
+  new_rule = (TStopRule) malloc (sizeof (nnet_train_stop_type));
+
+  if (new_rule == NULL)
+    {
+      fprintf (stderr, "nnet_train_stop_create: virtual memory exhausted\n");
+      return NULL;
+    }
+
+  new_rule->check_epochs = check_epochs;
+  new_rule->patience = patience;
+  new_rule->min_improvement = min_improvement;
+  new_rule->best_error = HUGE_VAL;
+  new_rule->best_epoch = 0;
+  new_rule->bad_checks = 0;
+
+  return new_rule;
+}
+
+
+
+/*
+ * nnet_train_stop_destroy
+ *
+ * Destroys a previously created early stopping rule
+ */
+int
+nnet_train_stop_destroy (TStopRule * stop_rule)
+{
+  /* Checks if the rule was actually passed */
+  if (stop_rule == NULL || *stop_rule == NULL)
+    {
+      fprintf (stderr, "nnet_train_stop_destroy: no rule to destroy\n");
+      return EXIT_FAILURE;
+    }
+
+  free (*stop_rule);
+  *stop_rule = NULL;
+
+  return EXIT_SUCCESS;
+}
+
+
+
 /*
  * nnet_train_lrate_value
  *
@@ -322,3 +511,114 @@ nnet_train_lrate_set_parameters (LRateFunction lrate_function,
 
   return EXIT_SUCCESS;
 }
+
+
+
+/*
+ * nnet_train_schedule_epoch
+ *
+ * Points 'etha' and 'width' to the values of the steps of the given epoch,
+ * which stay valid until the schedule is asked for another epoch
+ */
+int
+nnet_train_schedule_epoch (TSchedule schedule, const DTime epoch,
+                           const RValue ** etha, const RValue ** width)
+{
+  ElementIndex cur_step;        /* current step */
+  RValue time;                  /* time of the current step */
+
+
+  /* Checks if the schedule was actually passed */
+  if (schedule == NULL)
+    {
+      fprintf (stderr, "nnet_train_schedule_epoch: no schedule passed\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Checks the epoch against the horizon */
+  if (epoch < schedule->first_epoch || epoch >= schedule->max_epochs)
+    {
+      fprintf (stderr,
+               "nnet_train_schedule_epoch: epoch %ld out of schedule\n",
+               epoch);
+      return EXIT_FAILURE;
+    }
+
+  /* Single step schedules: the values are already there */
+  if (schedule->epoch_steps == 1)
+    {
+      *etha = schedule->etha + (epoch - schedule->first_epoch);
+
+      if (width != NULL)
+        *width = schedule->width == NULL ? NULL :
+          schedule->width + (epoch - schedule->first_epoch);
+
+      return EXIT_SUCCESS;
+    }
+
+  /* Multiple step schedules: fills the epoch steps, at fractional times */
+  if (schedule->cur_epoch != epoch)
+    {
+      for (cur_step = 0; cur_step < schedule->epoch_steps; cur_step++)
+        {
+          time = (RValue) epoch +
+            (RValue) cur_step / (RValue) schedule->epoch_steps;
+
+          schedule->etha[cur_step] =
+            function_value (schedule->lrate_function, time);
+
+          if (schedule->width != NULL)
+            schedule->width[cur_step] =
+              schedule->width_function (schedule->width_data, time);
+        }
+
+      schedule->cur_epoch = epoch;
+    }
+
+  *etha = schedule->etha;
+
+  if (width != NULL)
+    *width = schedule->width;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_train_stop_update
+ *
+ * Records the validation error measured at the given epoch. 'improved'
+ * tells if it is the best error so far, and 'stop' if training should
+ * stop according to the rule.
+ */
+int
+nnet_train_stop_update (TStopRule stop_rule,
+                        const DTime epoch, const RValue error,
+                        BoolValue * improved, BoolValue * stop)
+{
+  /* Checks if the rule was actually passed */
+  if (stop_rule == NULL)
+    {
+      fprintf (stderr, "nnet_train_stop_update: no rule passed\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Only relevant improvements restart the patience count */
+  if (error < stop_rule->best_error * (1.0 - stop_rule->min_improvement))
+    stop_rule->bad_checks = 0;
+  else
+    ++stop_rule->bad_checks;
+
+  *improved = (error < stop_rule->best_error) ? TRUE : FALSE;
+
+  if (*improved == TRUE)
+    {
+      stop_rule->best_error = error;
+      stop_rule->best_epoch = epoch;
+    }
+
+  *stop = (stop_rule->bad_checks >= stop_rule->patience) ? TRUE : FALSE;
+
+  return EXIT_SUCCESS;
+}
@@ -64,6 +64,54 @@ extern int nnet_train_lrate_destroy (LRateFunction * lrate_function);
 
 
 
+/*
+ * nnet_train_stop_create
+ *
+ * Creates a new early stopping rule, checked every 'check_epochs' epochs,
+ * which stops training after 'patience' checks without a relative
+ * improvement of 'min_improvement' on the best validation error
+ */
+extern TStopRule
+nnet_train_stop_create (const DTime check_epochs,
+                        const DTime patience, const RValue min_improvement);
+
+
+
+/*
+ * nnet_train_stop_destroy
+ *
+ * Destroys a previously created early stopping rule
+ */
+extern int nnet_train_stop_destroy (TStopRule * stop_rule);
+
+
+
+
+/*
+ * nnet_train_schedule_create
+ *
+ * Creates the schedule of the learning rate function, and of the width
+ * function if one is passed, from 'first_epoch' to 'max_epochs', with
+ * 'epoch_steps' steps in each epoch (0 or 1 for a single step)
+ */
+extern TSchedule
+nnet_train_schedule_create (const LRateFunction lrate_function,
+                            const TScheduleFunction width_function,
+                            void *width_data,
+                            const DTime first_epoch,
+                            const DTime max_epochs,
+                            const ElementIndex epoch_steps);
+
+
+
+/*
+ * nnet_train_schedule_destroy
+ *
+ * Destroys a previously created training schedule
+ */
+extern int nnet_train_schedule_destroy (TSchedule * schedule);
+
+
 /******************************************************************************
  *                                                                            *
  *                            FUNCTIONAL OPERATIONS                           *
@@ -91,4 +139,29 @@ nnet_train_lrate_set_parameters (LRateFunction lrate_function,
 
 
 
+/*
+ * nnet_train_schedule_epoch
+ *
+ * Points 'etha' and 'width' to the values of the steps of the given epoch,
+ * which stay valid until the schedule is asked for another epoch
+ */
+extern int
+nnet_train_schedule_epoch (TSchedule schedule, const DTime epoch,
+                           const RValue ** etha, const RValue ** width);
+
+
+/*
+ * nnet_train_stop_update
+ *
+ * Records the validation error measured at the given epoch. 'improved'
+ * tells if it is the best error so far, and 'stop' if training should
+ * stop according to the rule.
+ */
+extern int
+nnet_train_stop_update (TStopRule stop_rule,
+                        const DTime epoch, const RValue error,
+                        BoolValue * improved, BoolValue * stop);
+
+
+
 #endif /* __NNET_TRAIN_H_ */
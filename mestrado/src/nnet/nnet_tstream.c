@@ -0,0 +1,840 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <float.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "nnet_types.h"
+#include "nnet_sets.h"
+#include "nnet_tstream.h"
+#include "../vector/vectorstat.h"
+#include "../common/types.h"
+
+/******************************************************************************
+ *                                                                            *
+ *                             PRIVATE OPERATIONS                             *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * nnet_tstream_map_type
+ *
+ * A mapped byte range of a file
+ */
+typedef struct
+{
+  void *address;                /* mapping address */
+  size_t length;                /* mapping length */
+  const char *first;            /* first requested byte */
+  const char *end;              /* one past the last requested byte */
+}
+nnet_tstream_map_type;
+
+
+
+/*
+ * nnet_tstream_map
+ *
+ * Maps the given byte range of a file (the whole file if 'length' is
+ * negative) for reading
+ */
+static int
+nnet_tstream_map (const char *file_name, const long offset, const long length,
+                  nnet_tstream_map_type * map)
+{
+  struct stat file_stat;        /* file status */
+  long page_size;               /* system page size */
+  long map_offset;              /* page aligned mapping offset */
+  long map_length;              /* requested bytes */
+  int fd;                       /* file descriptor */
+
+
+  map->address = NULL;
+  map->length = 0;
+  map->first = NULL;
+  map->end = NULL;
+
+  fd = open (file_name, O_RDONLY);
+
+  if (fd < 0)
+    {
+      fprintf (stderr, "nnet_tstream_map: '%s': %s\n", file_name,
+               strerror (errno));
+      return EXIT_FAILURE;
+    }
+
+  if (fstat (fd, &file_stat) != 0)
+    {
+      fprintf (stderr, "nnet_tstream_map: '%s': %s\n", file_name,
+               strerror (errno));
+      close (fd);
+      return EXIT_FAILURE;
+    }
+
+  map_length = (length < 0) ? (long) file_stat.st_size - offset : length;
+
+  if (offset < 0 || map_length < 0 ||
+      offset + map_length > (long) file_stat.st_size)
+    {
+      fprintf (stderr, "nnet_tstream_map: '%s' has changed\n", file_name);
+      close (fd);
+      return EXIT_FAILURE;
+    }
+
+  /* Empty range */
+  if (map_length == 0)
+    {
+      close (fd);
+      return EXIT_SUCCESS;
+    }
+
+  /* Mappings start at page boundaries */
+  page_size = sysconf (_SC_PAGESIZE);
+  map_offset = (page_size > 0) ? offset - offset % page_size : 0;
+
+  map->length = (size_t) (map_length + offset - map_offset);
+  map->address = mmap (NULL, map->length, PROT_READ, MAP_PRIVATE, fd,
+                       (off_t) map_offset);
+  close (fd);
+
+  if (map->address == MAP_FAILED)
+    {
+      fprintf (stderr, "nnet_tstream_map: '%s': %s\n", file_name,
+               strerror (errno));
+      map->address = NULL;
+      return EXIT_FAILURE;
+    }
+
+  map->first = (const char *) map->address + (offset - map_offset);
+  map->end = map->first + map_length;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_tstream_unmap
+ *
+ * Releases a mapping
+ */
+static void
+nnet_tstream_unmap (nnet_tstream_map_type * map)
+{
+  if (map->address != NULL)
+    munmap (map->address, map->length);
+
+  map->address = NULL;
+
+  return;
+}
+
+
+
+/*
+ * nnet_tstream_parse_line
+ *
+ * Parses the line starting at 'cursor' (element index, component and
+ * value), moving the cursor to the next line. Blank lines and lines
+ * starting with IGNORE_TOKEN are skipped, returning 'valid' FALSE.
+ */
+static int
+nnet_tstream_parse_line (const char **cursor, const char *end,
+                         RValue * fields, BoolValue * valid)
+{
+  char token[NNET_NAME_SIZE];   /* current token */
+  char *token_end;              /* end of the converted token */
+  const char *cur;              /* current character */
+  size_t length;                /* token length */
+  int cur_field;                /* current field */
+
+
+  cur = *cursor;
+  *valid = FALSE;
+
+  /* Strips preceding blanks */
+  while (cur < end && (*cur == ' ' || *cur == '\t' || *cur == '\r'))
+    cur++;
+
+  /* Blank or comment lines */
+  if (cur >= end || *cur == '\n' || *cur == IGNORE_TOKEN)
+    {
+      while (cur < end && *cur != '\n')
+        cur++;
+
+      *cursor = (cur < end) ? cur + 1 : end;
+      return EXIT_SUCCESS;
+    }
+
+  /* Element index, component and value */
+  for (cur_field = 0; cur_field < 3; cur_field++)
+    {
+      while (cur < end && (*cur == ' ' || *cur == '\t'))
+        cur++;
+
+      for (length = 0; cur + length < end && cur[length] != ' ' &&
+           cur[length] != '\t' && cur[length] != '\r' &&
+           cur[length] != '\n' && length < NNET_NAME_SIZE - 1; length++)
+        token[length] = cur[length];
+
+      token[length] = '\0';
+      fields[cur_field] = (RValue) strtod (token, &token_end);
+
+      if (length == 0 || token_end == token)
+        {
+          fprintf (stderr,
+                   "nnet_tstream_parse_line: error reading field %d\n",
+                   cur_field + 1);
+          return EXIT_FAILURE;
+        }
+
+      cur += length;
+    }
+
+  /* Skips the rest of the line */
+  while (cur < end && *cur != '\n')
+    cur++;
+
+  *cursor = (cur < end) ? cur + 1 : end;
+  *valid = TRUE;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_tstream_add_chunk
+ *
+ * Appends a chunk descriptor to the stream
+ */
+static int
+nnet_tstream_add_chunk (TStream stream, ElementIndex * capacity,
+                        const UsIntValue file, const long offset,
+                        const long length, const ElementIndex nu_elements)
+{
+  nnet_tstream_chunk_type *new_chunks;  /* enlarged descriptors */
+
+
+  if (nu_elements == 0)
+    return EXIT_SUCCESS;
+
+  if (stream->nu_chunks == *capacity)
+    {
+      new_chunks = (nnet_tstream_chunk_type *)
+        realloc (stream->chunks,
+                 2 * (*capacity + 1) * sizeof (nnet_tstream_chunk_type));
+
+      if (new_chunks == NULL)
+        {
+          fprintf (stderr,
+                   "nnet_tstream_add_chunk: virtual memory exhausted\n");
+          return EXIT_FAILURE;
+        }
+
+      stream->chunks = new_chunks;
+      *capacity = 2 * (*capacity + 1);
+    }
+
+  stream->chunks[stream->nu_chunks].file = file;
+  stream->chunks[stream->nu_chunks].offset = offset;
+  stream->chunks[stream->nu_chunks].length = length;
+  stream->chunks[stream->nu_chunks].nu_elements = nu_elements;
+  ++stream->nu_chunks;
+
+  stream->nu_elements += nu_elements;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_tstream_scan_file
+ *
+ * Splits the given file of the stream into chunks and, if required,
+ * computes the statistics used to regularize its inputs
+ */
+static int
+nnet_tstream_scan_file (TStream stream, const UsIntValue file,
+                        ElementIndex * capacity)
+{
+  nnet_tstream_map_type map;    /* mapped file */
+  const char *cursor;           /* current line */
+  const char *line;             /* start of the current line */
+  RValue fields[3];             /* element index, component and value */
+  BoolValue valid;              /* line holds a component */
+  RValue old_index = -1.0;      /* index of the current element */
+  UnitIndex nu_components = 0;  /* components read for the element */
+  ElementIndex chunk_elements = 0;      /* elements in the current chunk */
+  long chunk_offset = 0;        /* first byte of the current chunk */
+  VectorAccum accum = NULL;     /* file statistics */
+  RValue *element = NULL;       /* current element values */
+  RValue *average;              /* file averages */
+  RValue *invstddev;            /* file weights */
+  RValue stddev;                /* standard deviation */
+  UnitIndex cur_comp;           /* current component */
+  int exit_status = EXIT_SUCCESS;       /* function return status */
+
+
+  if (stream->regularize_inputs == TRUE)
+    {
+      element = (RValue *) calloc (stream->input_dimension, sizeof (RValue));
+      accum = vcst_accum_create (stream->input_dimension);
+
+      if (element == NULL || accum == NULL)
+        {
+          fprintf (stderr,
+                   "nnet_tstream_scan_file: virtual memory exhausted\n");
+          free (element);
+          if (accum != NULL)
+            vcst_accum_destroy (&accum);
+          return EXIT_FAILURE;
+        }
+    }
+
+  if (nnet_tstream_map (stream->file_names[file], 0, -1, &map) !=
+      EXIT_SUCCESS)
+    {
+      free (element);
+      if (accum != NULL)
+        vcst_accum_destroy (&accum);
+      return EXIT_FAILURE;
+    }
+
+  cursor = map.first;
+
+  while (cursor != NULL && cursor < map.end && exit_status == EXIT_SUCCESS)
+    {
+      line = cursor;
+      exit_status = nnet_tstream_parse_line (&cursor, map.end, fields,
+                                             &valid);
+
+      if (exit_status != EXIT_SUCCESS || valid == FALSE)
+        continue;
+
+      /* A new element starts */
+      if (fields[0] != old_index)
+        {
+          if (old_index >= 0.0 && nu_components != stream->input_dimension)
+            {
+              fprintf (stderr,
+                       "nnet_tstream_scan_file: element %.0f of '%s' is incomplete\n",
+                       old_index, stream->file_names[file]);
+              exit_status = EXIT_FAILURE;
+              continue;
+            }
+
+          /* Adds the previous element to the statistics */
+          if (old_index >= 0.0 && accum != NULL)
+            vcst_accum_add (accum, element);
+
+          /* Closes the current chunk */
+          if (chunk_elements == stream->chunk_size)
+            {
+              exit_status = nnet_tstream_add_chunk
+                (stream, capacity, file, chunk_offset,
+                 (long) (line - map.first) - chunk_offset, chunk_elements);
+
+              chunk_elements = 0;
+            }
+
+          if (chunk_elements == 0)
+            chunk_offset = (long) (line - map.first);
+
+          ++chunk_elements;
+          old_index = fields[0];
+          nu_components = 0;
+        }
+
+      /* Checks and stores the component */
+      if (fields[1] < 0.0 || fields[1] >= (RValue) stream->input_dimension)
+        {
+          fprintf (stderr,
+                   "nnet_tstream_scan_file: invalid component %.0f in '%s'\n",
+                   fields[1], stream->file_names[file]);
+          exit_status = EXIT_FAILURE;
+          continue;
+        }
+
+      if (element != NULL)
+        element[(UnitIndex) fields[1]] = fields[2];
+
+      ++nu_components;
+    }
+
+  /* Last element and chunk */
+  if (exit_status == EXIT_SUCCESS && chunk_elements > 0)
+    {
+      if (nu_components != stream->input_dimension)
+        {
+          fprintf (stderr,
+                   "nnet_tstream_scan_file: element %.0f of '%s' is incomplete\n",
+                   old_index, stream->file_names[file]);
+          exit_status = EXIT_FAILURE;
+        }
+      else
+        {
+          if (accum != NULL)
+            vcst_accum_add (accum, element);
+
+          exit_status = nnet_tstream_add_chunk
+            (stream, capacity, file, chunk_offset,
+             (long) (map.end - map.first) - chunk_offset, chunk_elements);
+        }
+    }
+
+  nnet_tstream_unmap (&map);
+
+  /* Averages and inverse standard deviations, ignoring constant components */
+  if (accum != NULL && accum->samples > 0)
+    {
+      average = stream->averages + file * stream->input_dimension;
+      invstddev = stream->invstddevs + file * stream->input_dimension;
+
+      for (cur_comp = 0; cur_comp < stream->input_dimension; cur_comp++)
+        {
+          average[cur_comp] = accum->average[cur_comp];
+          stddev = sqrt (accum->sqr_diff[cur_comp] / (RValue) accum->samples);
+          invstddev[cur_comp] = (stddev > DBL_EPSILON) ? 1.0 / stddev : stddev;
+        }
+    }
+
+  free (element);
+  if (accum != NULL)
+    vcst_accum_destroy (&accum);
+
+  return exit_status;
+}
+
+
+
+/*
+ * nnet_tstream_load_chunk
+ *
+ * Maps and parses the given chunk into the chunk buffer, regularizing its
+ * inputs if required, and generates the order of its elements in the
+ * current pass
+ */
+static int
+nnet_tstream_load_chunk (TStream stream, const ElementIndex chunk)
+{
+  nnet_tstream_chunk_type *descriptor;  /* chunk descriptor */
+  nnet_tstream_map_type map;    /* mapped chunk */
+  const char *cursor;           /* current line */
+  RValue fields[3];             /* element index, component and value */
+  BoolValue valid;              /* line holds a component */
+  RValue old_index = -1.0;      /* index of the current element */
+  ElementIndex cur_elmt = 0;    /* current element (+1) */
+  UnitIndex cur_comp;           /* current component */
+  RValue *values;               /* current element values */
+  RValue *average;              /* file averages */
+  RValue *invstddev;            /* file weights */
+  int exit_status = EXIT_SUCCESS;       /* function return status */
+
+
+  descriptor = &(stream->chunks[chunk]);
+
+  if (nnet_tstream_map (stream->file_names[descriptor->file],
+                        descriptor->offset, descriptor->length, &map) !=
+      EXIT_SUCCESS)
+    return EXIT_FAILURE;
+
+  cursor = map.first;
+
+  while (cursor != NULL && cursor < map.end && exit_status == EXIT_SUCCESS)
+    {
+      exit_status = nnet_tstream_parse_line (&cursor, map.end, fields,
+                                             &valid);
+
+      if (exit_status != EXIT_SUCCESS || valid == FALSE)
+        continue;
+
+      if (fields[0] != old_index)
+        {
+          old_index = fields[0];
+          ++cur_elmt;
+        }
+
+      if (cur_elmt > descriptor->nu_elements || fields[1] < 0.0 ||
+          fields[1] >= (RValue) stream->input_dimension)
+        {
+          fprintf (stderr, "nnet_tstream_load_chunk: '%s' has changed\n",
+                   stream->file_names[descriptor->file]);
+          exit_status = EXIT_FAILURE;
+          continue;
+        }
+
+      stream->values[(cur_elmt - 1) * stream->input_dimension +
+                     (UnitIndex) fields[1]] = fields[2];
+    }
+
+  nnet_tstream_unmap (&map);
+
+  if (exit_status != EXIT_SUCCESS)
+    return EXIT_FAILURE;
+
+  if (cur_elmt != descriptor->nu_elements)
+    {
+      fprintf (stderr, "nnet_tstream_load_chunk: '%s' has changed\n",
+               stream->file_names[descriptor->file]);
+      return EXIT_FAILURE;
+    }
+
+  /* Regularizes the inputs by the file statistics */
+  if (stream->regularize_inputs == TRUE)
+    {
+      average = stream->averages +
+        descriptor->file * stream->input_dimension;
+      invstddev = stream->invstddevs +
+        descriptor->file * stream->input_dimension;
+
+      for (cur_elmt = 0; cur_elmt < descriptor->nu_elements; cur_elmt++)
+        {
+          values = stream->values + cur_elmt * stream->input_dimension;
+
+          for (cur_comp = 0; cur_comp < stream->input_dimension; cur_comp++)
+            values[cur_comp] =
+              (values[cur_comp] - average[cur_comp]) * invstddev[cur_comp];
+        }
+    }
+
+  stream->nu_loaded = descriptor->nu_elements;
+  stream->cur_element = 0;
+
+  /* Element order */
+  if (stream->shuffle_elements == TRUE)
+    return nnet_tset_random_permutation
+      (stream->element_order, stream->nu_loaded, 0,
+       stream->seed ^ ((0x27D4EB2DUL * (chunk + 1)) & 0xFFFFFFFFUL),
+       stream->pass);
+
+  for (cur_elmt = 0; cur_elmt < stream->nu_loaded; cur_elmt++)
+    stream->element_order[cur_elmt] = cur_elmt;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                            STRUCTURAL OPERATIONS                           *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * nnet_tstream_create
+ *
+ * Creates a new stream over the feature files listed in the given file
+ */
+TStream
+nnet_tstream_create (const UnitIndex input_dimension,
+                     const ElementIndex chunk_size,
+                     const BoolValue regularize_inputs,
+                     const char *list_file_name)
+{
+  TStream new_stream;           /* new stream */
+  ElementIndex chunk_capacity = 0;      /* chunk descriptor capacity */
+  ElementIndex cur_elmt;        /* current buffer element */
+  UsIntValue cur_file;          /* current file */
+  int exit_status = EXIT_SUCCESS;       /* auxiliary function return status */
+
+
+  /* Checks the parameters */
+  if (input_dimension < 1 || chunk_size < 1)
+    {
+      fprintf (stderr, "nnet_tstream_create: invalid dimensions\n");
+      return NULL;
+    }
+
+  if (list_file_name == NULL)
+    {
+      fprintf (stderr, "nnet_tstream_create: no list file name passed\n");
+      return NULL;
+    }
+
+  /* Allocates the new stream */
+  new_stream = (TStream) calloc (1, sizeof (nnet_tstream_type));
+
+  if (new_stream == NULL)
+    {
+      fprintf (stderr, "nnet_tstream_create: virtual memory exhausted\n");
+      return NULL;
+    }
+
+  new_stream->input_dimension = input_dimension;
+  new_stream->chunk_size = chunk_size;
+  new_stream->regularize_inputs = regularize_inputs;
+  new_stream->shuffle_chunks = FALSE;
+  new_stream->shuffle_elements = FALSE;
+
+  /* Reads the file names */
+  if (nnet_tset_read_file_list (list_file_name, &(new_stream->file_names),
+                                &(new_stream->nu_files)) != EXIT_SUCCESS)
+    {
+      fprintf (stderr, "nnet_tstream_create: error reading list '%s'\n",
+               list_file_name);
+      nnet_tstream_destroy (&new_stream);
+      return NULL;
+    }
+
+  /* Scans the files */
+  if (regularize_inputs == TRUE && new_stream->nu_files > 0)
+    {
+      new_stream->averages = (RValue *)
+        malloc (new_stream->nu_files * input_dimension * sizeof (RValue));
+      new_stream->invstddevs = (RValue *)
+        malloc (new_stream->nu_files * input_dimension * sizeof (RValue));
+
+      if (new_stream->averages == NULL || new_stream->invstddevs == NULL)
+        exit_status = EXIT_FAILURE;
+    }
+
+  for (cur_file = 0;
+       cur_file < new_stream->nu_files && exit_status == EXIT_SUCCESS;
+       cur_file++)
+    exit_status =
+      nnet_tstream_scan_file (new_stream, cur_file, &chunk_capacity);
+
+  if (exit_status != EXIT_SUCCESS)
+    {
+      fprintf (stderr, "nnet_tstream_create: error scanning files\n");
+      nnet_tstream_destroy (&new_stream);
+      return NULL;
+    }
+
+  /* Allocates the chunk buffer */
+  new_stream->chunk_order = (ElementIndex *)
+    malloc ((new_stream->nu_chunks + 1) * sizeof (ElementIndex));
+  new_stream->elements = (nnet_training_element_type *)
+    malloc (chunk_size * sizeof (nnet_training_element_type));
+  new_stream->vectors = (vector_type *)
+    malloc (chunk_size * sizeof (vector_type));
+  new_stream->values = (RValue *)
+    malloc (chunk_size * input_dimension * sizeof (RValue));
+  new_stream->element_order = (ElementIndex *)
+    malloc (chunk_size * sizeof (ElementIndex));
+
+  if (new_stream->chunk_order == NULL || new_stream->elements == NULL ||
+      new_stream->vectors == NULL || new_stream->values == NULL ||
+      new_stream->element_order == NULL)
+    {
+      fprintf (stderr, "nnet_tstream_create: virtual memory exhausted\n");
+      nnet_tstream_destroy (&new_stream);
+      return NULL;
+    }
+
+  /* The buffer elements are fixed views over the value matrix */
+  for (cur_elmt = 0; cur_elmt < chunk_size; cur_elmt++)
+    {
+      new_stream->vectors[cur_elmt].dimension = input_dimension;
+      new_stream->vectors[cur_elmt].value =
+        new_stream->values + cur_elmt * input_dimension;
+
+      new_stream->elements[cur_elmt].set = NULL;
+      new_stream->elements[cur_elmt].element_index = cur_elmt + 1;
+      new_stream->elements[cur_elmt].input = &(new_stream->vectors[cur_elmt]);
+      new_stream->elements[cur_elmt].output = NULL;
+      new_stream->elements[cur_elmt].next = NULL;
+      new_stream->elements[cur_elmt].arena = NULL;
+    }
+
+  if (nnet_tstream_rewind (new_stream, 0) != EXIT_SUCCESS)
+    {
+      nnet_tstream_destroy (&new_stream);
+      return NULL;
+    }
+
+  return new_stream;
+}
+
+
+
+/*
+ * nnet_tstream_destroy
+ *
+ * Destroys a previously created stream
+ */
+int
+nnet_tstream_destroy (TStream * stream)
+{
+  /* Checks if the stream was actually passed */
+  if (stream == NULL || *stream == NULL)
+    {
+      fprintf (stderr, "nnet_tstream_destroy: no stream to destroy\n");
+      return EXIT_FAILURE;
+    }
+
+  nnet_tset_free_file_list (&((*stream)->file_names), &((*stream)->nu_files));
+  free ((*stream)->averages);
+  free ((*stream)->invstddevs);
+  free ((*stream)->chunks);
+  free ((*stream)->chunk_order);
+  free ((*stream)->elements);
+  free ((*stream)->vectors);
+  free ((*stream)->values);
+  free ((*stream)->element_order);
+  free (*stream);
+
+  /* Makes it point to NULL */
+  *stream = NULL;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_tstream_set_shuffling
+ *
+ * Selects the chunk and element orders of the following passes
+ */
+int
+nnet_tstream_set_shuffling (TStream stream,
+                            const BoolValue shuffle_chunks,
+                            const BoolValue shuffle_elements,
+                            const UsLgIntValue seed)
+{
+  /* Checks if the stream was actually passed */
+  if (stream == NULL)
+    {
+      fprintf (stderr, "nnet_tstream_set_shuffling: no stream passed\n");
+      return EXIT_FAILURE;
+    }
+
+  stream->shuffle_chunks = shuffle_chunks;
+  stream->shuffle_elements = shuffle_elements;
+  stream->seed = seed;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_tset_create_streamed
+ *
+ * Creates a training set whose elements are streamed from the files
+ * listed in the given file instead of being loaded
+ */
+TSet
+nnet_tset_create_streamed (const Name name,
+                           const UnitIndex input_dimension,
+                           const ElementIndex chunk_size,
+                           const BoolValue regularize_inputs,
+                           const char *list_file_name)
+{
+  TSet new_set;                 /* new training set */
+
+
+  new_set = nnet_tset_create (name, input_dimension, 0);
+
+  if (new_set == NULL)
+    {
+      fprintf (stderr, "nnet_tset_create_streamed: error creating set\n");
+      return NULL;
+    }
+
+  new_set->stream = nnet_tstream_create
+    (input_dimension, chunk_size, regularize_inputs, list_file_name);
+
+  if (new_set->stream == NULL)
+    {
+      fprintf (stderr, "nnet_tset_create_streamed: error creating stream\n");
+      nnet_tset_destroy (&new_set, TRUE);
+      return NULL;
+    }
+
+  return new_set;
+}
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                            FUNCTIONAL OPERATIONS                           *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * nnet_tstream_rewind
+ *
+ * Starts the given pass through the stream
+ */
+int
+nnet_tstream_rewind (TStream stream, const DTime pass)
+{
+  ElementIndex cur_chunk;       /* current chunk */
+
+
+  /* Checks if the stream was actually passed */
+  if (stream == NULL)
+    {
+      fprintf (stderr, "nnet_tstream_rewind: no stream passed\n");
+      return EXIT_FAILURE;
+    }
+
+  stream->pass = pass;
+  stream->cur_chunk = 0;
+  stream->nu_loaded = 0;
+  stream->cur_element = 0;
+
+  /* Chunk order */
+  if (stream->shuffle_chunks == TRUE)
+    return nnet_tset_random_permutation
+      (stream->chunk_order, stream->nu_chunks, 0, stream->seed, pass);
+
+  for (cur_chunk = 0; cur_chunk < stream->nu_chunks; cur_chunk++)
+    stream->chunk_order[cur_chunk] = cur_chunk;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_tstream_next
+ *
+ * Returns the next element of the current pass in 'element', or NULL at
+ * the end of the pass
+ */
+int
+nnet_tstream_next (TStream stream, TElement * element)
+{
+  /* Checks if the stream was actually passed */
+  if (stream == NULL || element == NULL)
+    {
+      fprintf (stderr, "nnet_tstream_next: no stream passed\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Loads the next chunk */
+  while (stream->cur_element >= stream->nu_loaded)
+    {
+      if (stream->cur_chunk >= stream->nu_chunks)
+        {
+          *element = NULL;
+          return EXIT_SUCCESS;
+        }
+
+      if (nnet_tstream_load_chunk
+          (stream, stream->chunk_order[stream->cur_chunk]) != EXIT_SUCCESS)
+        {
+          fprintf (stderr, "nnet_tstream_next: error loading chunk\n");
+          return EXIT_FAILURE;
+        }
+
+      ++stream->cur_chunk;
+    }
+
+  *element =
+    &(stream->elements[stream->element_order[stream->cur_element++]]);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,177 @@
+#ifndef __NNET_TSTREAM_H_
+#define __NNET_TSTREAM_H_ 1
+
+#include "nnet_types.h"
+
+
+/******************************************************************************
+ *                                                                            *
+ *                        PUBLIC DATATYPES AND VARIABLES                      *
+ *                                                                            *
+ ******************************************************************************/
+
+/* Default number of elements loaded at a time */
+#define NNET_TSTREAM_CHUNK_SIZE 4096
+
+
+/*
+ * nnet_tstream_chunk_type
+ *
+ * A run of consecutive elements of one feature file, located by its byte
+ * range in the file
+ */
+typedef struct
+{
+  UsIntValue file;              /* file index in the stream */
+  long offset;                  /* first byte of the chunk */
+  long length;                  /* bytes in the chunk */
+  ElementIndex nu_elements;     /* elements in the chunk */
+}
+nnet_tstream_chunk_type;
+
+
+
+/*
+ * nnet_tstream_type
+ *
+ * Training elements streamed from a list of feature files.
+ * Creating the stream scans every file once, splitting it into chunks of
+ * at most 'chunk_size' elements and, if the inputs are to be regularized,
+ * computing the statistics of each file. Only the chunk descriptors and
+ * the per-file statistics are kept: training passes map one chunk at a
+ * time, parse it into the chunk buffer and unmap it, so the resident
+ * memory is bounded by the chunk size whatever the size of the corpus.
+ * Each pass may visit the chunks in a random order and the elements of
+ * each chunk in a random order, both depending only on the seed and the
+ * pass number.
+ * The elements returned by nnet_tstream_next belong to no set and are
+ * only valid until the next chunk is loaded.
+ */
+typedef struct nnet_tstream_struct
+{
+  UnitIndex input_dimension;    /* element inputs */
+  ElementIndex chunk_size;      /* maximum elements per chunk */
+  BoolValue regularize_inputs;  /* regularize each file by its statistics */
+  ElementIndex nu_elements;     /* elements in all files */
+
+  /* files */
+  UsIntValue nu_files;          /* number of files */
+  char **file_names;            /* file names */
+  RValue *averages;             /* nu_files x input_dimension averages */
+  RValue *invstddevs;           /* nu_files x input_dimension weights */
+
+  /* chunks */
+  ElementIndex nu_chunks;       /* number of chunks */
+  nnet_tstream_chunk_type *chunks;      /* chunk descriptors */
+
+  /* pass order */
+  BoolValue shuffle_chunks;     /* visit the chunks in random order */
+  BoolValue shuffle_elements;   /* visit chunk elements in random order */
+  UsLgIntValue seed;            /* shuffling seed */
+  DTime pass;                   /* current pass */
+  ElementIndex *chunk_order;    /* chunks in visiting order */
+  ElementIndex cur_chunk;       /* next position in chunk_order */
+
+  /* chunk buffer */
+  nnet_training_element_type *elements; /* chunk elements */
+  vector_type *vectors;         /* chunk element inputs */
+  RValue *values;               /* chunk_size x input_dimension values */
+  ElementIndex *element_order;  /* chunk elements in visiting order */
+  ElementIndex nu_loaded;       /* elements in the loaded chunk */
+  ElementIndex cur_element;     /* next position in element_order */
+}
+nnet_tstream_type;
+
+
+/* Symbolic type */
+typedef nnet_tstream_type *TStream;
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                            STRUCTURAL OPERATIONS                           *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * nnet_tstream_create
+ *
+ * Creates a new stream over the feature files listed in the given file,
+ * in the same format read by nnet_tset_create_from_list. If
+ * 'regularize_inputs' is set, the inputs of each file are regularized by
+ * that file's statistics, as done when reading the files into a set.
+ */
+extern TStream
+nnet_tstream_create (const UnitIndex input_dimension,
+                     const ElementIndex chunk_size,
+                     const BoolValue regularize_inputs,
+                     const char *list_file_name);
+
+
+
+/*
+ * nnet_tstream_destroy
+ *
+ * Destroys a previously created stream
+ */
+extern int nnet_tstream_destroy (TStream * stream);
+
+
+
+/*
+ * nnet_tstream_set_shuffling
+ *
+ * Selects the chunk and element orders of the following passes
+ */
+extern int
+nnet_tstream_set_shuffling (TStream stream,
+                            const BoolValue shuffle_chunks,
+                            const BoolValue shuffle_elements,
+                            const UsLgIntValue seed);
+
+
+
+/*
+ * nnet_tset_create_streamed
+ *
+ * Creates a training set whose elements are streamed from the files
+ * listed in the given file instead of being loaded. The set itself holds
+ * no elements: nnet_som_train_set and nnet_lvq_train_set read them from
+ * the stream, which is destroyed with the set.
+ */
+extern TSet
+nnet_tset_create_streamed (const Name name,
+                           const UnitIndex input_dimension,
+                           const ElementIndex chunk_size,
+                           const BoolValue regularize_inputs,
+                           const char *list_file_name);
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                            FUNCTIONAL OPERATIONS                           *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * nnet_tstream_rewind
+ *
+ * Starts the given pass through the stream
+ */
+extern int nnet_tstream_rewind (TStream stream, const DTime pass);
+
+
+
+/*
+ * nnet_tstream_next
+ *
+ * Returns the next element of the current pass in 'element', or NULL at
+ * the end of the pass
+ */
+extern int nnet_tstream_next (TStream stream, TElement * element);
+
+
+
+#endif /* __NNET_TSTREAM_H_ */
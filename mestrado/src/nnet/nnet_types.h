@@ -16,6 +16,10 @@
 #define NNET_BUF_SIZE 1024
 #endif
 
+#ifndef NNET_TSET_ARENA_ALIGN
+#define NNET_TSET_ARENA_ALIGN 64
+#endif
+
 
 /******************************************************************************
  *                                                                            *
@@ -69,6 +73,18 @@ typedef struct nnet_extension_struct *NExtensionPtr;
 typedef struct nnet_training_element_struct *TElementPtr;
 
 
+/* Pointer to Training Set Arena */
+typedef struct nnet_tset_arena_struct *TSetArenaPtr;
+
+
+/* Pointer to Training Order */
+typedef struct nnet_tset_order_struct *TSetOrderPtr;
+
+
+/* Pointer to Training Element Stream */
+typedef struct nnet_tstream_struct *TStreamPtr;
+
+
 
 /******************************************************************************
  *                                                                            *
@@ -360,6 +376,12 @@ typedef RFunction LRateFunction;
  * nnet_training_set_type
  *
  * Training or Test sets
+ * The element table holds the elements by position (table[i] is element
+ * i + 1) for constant time access. It is rebuilt on demand after the
+ * element list changes.
+ * If a training order is set, the training functions visit the elements
+ * in that order instead of the list order. Streamed sets hold no elements:
+ * the training functions read them from the stream instead.
  */
 typedef struct
 {
@@ -371,6 +393,11 @@ typedef struct
   TElementPtr last_element;
   VectorStats input_vector_stats;
   VectorStats output_vector_stats;
+  TElementPtr *element_table;
+  ElementIndex table_size;
+  BoolValue table_valid;
+  TSetOrderPtr training_order;
+  TStreamPtr stream;
 }
 nnet_training_set_type;
 
@@ -391,6 +418,7 @@ typedef struct nnet_training_element_struct
   Vector input;
   Vector output;
   TElementPtr next;
+  TSetArenaPtr arena;
 }
 nnet_training_element_type;
 
@@ -399,6 +427,52 @@ nnet_training_element_type;
 typedef nnet_training_element_type *TElement;
 
 
+/*
+ * nnet_tset_arena_type
+ *
+ * Contiguous storage for a block of training elements: the element
+ * records, their vector headers, an elements x input_dimension matrix of
+ * inputs and an elements x output_dimension matrix of outputs, both
+ * aligned to NNET_TSET_ARENA_ALIGN bytes. Elements stored in an arena
+ * behave like any other, and may move to other sets; the arena is
+ * released when its last element is destroyed.
+ */
+typedef struct nnet_tset_arena_struct
+{
+  ElementIndex nu_elements;     /* number of stored elements */
+  ElementIndex nu_references;   /* stored elements not yet destroyed */
+  UnitIndex input_dimension;    /* input matrix columns */
+  UnitIndex output_dimension;   /* output matrix columns */
+  nnet_training_element_type *elements; /* element records */
+  vector_type *vectors;         /* input and output vector headers */
+  RValue *inputs;               /* aligned input matrix */
+  RValue *outputs;              /* aligned output matrix */
+  void *input_block;            /* input matrix allocation */
+  void *output_block;           /* output matrix allocation */
+}
+nnet_tset_arena_type;
+
+
+/*
+ * nnet_tset_order_type
+ *
+ * Training order of a set: a permutation of its element table positions,
+ * regenerated at each epoch from the seed and the epoch number only, so
+ * the order of any epoch can be reproduced. With blocks of more than one
+ * element, consecutive elements are shuffled together: the blocks are
+ * visited in random order, and the elements of each block in random order
+ * among themselves, which keeps the memory accesses of a block local.
+ */
+typedef struct nnet_tset_order_struct
+{
+  UsLgIntValue seed;            /* random generator seed */
+  ElementIndex block_size;      /* elements per block (0 or 1: no blocks) */
+  ElementIndex nu_positions;    /* permutation size */
+  ElementIndex *positions;      /* table positions in training order */
+}
+nnet_tset_order_type;
+
+
 
 /******************************************************************************
  *                                                                            *
@@ -428,4 +502,69 @@ nnet_training_session_type;
 typedef nnet_training_session_type *TSession;
 
 
+
+/*
+ * nnet_train_stop_type
+ *
+ * Early stopping rule: the validation error is checked every
+ * 'check_epochs' epochs, and training stops after 'patience' checks in a
+ * row without improving on the best error by more than the relative
+ * 'min_improvement'
+ */
+typedef struct
+{
+  DTime check_epochs;           /* epochs between checks */
+  DTime patience;               /* checks without improvement tolerated */
+  RValue min_improvement;       /* relative improvement over the best error */
+  RValue best_error;            /* best validation error so far */
+  DTime best_epoch;             /* epoch of the best error */
+  DTime bad_checks;             /* checks since the last improvement */
+}
+nnet_train_stop_type;
+
+
+/* Symbolic Type */
+typedef nnet_train_stop_type *TStopRule;
+
+
+
+/*
+ * TScheduleFunction
+ *
+ * Value of a training parameter other than the learning rate at the given
+ * (possibly fractional) epoch, such as a neighborhood width
+ */
+typedef RValue (*TScheduleFunction) (void *data, const RValue time);
+
+
+
+/*
+ * nnet_train_schedule_type
+ *
+ * Learning rates and widths of the training steps from 'first_epoch' to
+ * 'max_epochs'. Each epoch has 'epoch_steps' steps: a single one when the
+ * parameters decay once per epoch, or one for each element when they
+ * decay along the epoch. Single step schedules hold the values of every
+ * epoch; multiple step schedules hold the values of the steps of
+ * 'cur_epoch' only. 'width' is NULL when there is no width function.
+ */
+typedef struct
+{
+  LRateFunction lrate_function; /* learning rate function */
+  TScheduleFunction width_function;     /* width function */
+  void *width_data;             /* width function data */
+  DTime first_epoch;            /* first scheduled epoch */
+  DTime max_epochs;             /* end of the training horizon */
+  ElementIndex epoch_steps;     /* steps in each epoch */
+  DTime cur_epoch;              /* epoch of multiple step values */
+  RValue *etha;                 /* learning rates */
+  RValue *width;                /* widths */
+}
+nnet_train_schedule_type;
+
+
+/* Symbolic Type */
+typedef nnet_train_schedule_type *TSchedule;
+
+
 #endif /* nnet_types.h */
@@ -747,39 +747,18 @@ Unit
 nnet_unit_by_index (NNetwork nnet,
                     LayerIndex layer_index, UnitIndex unit_index)
 {
-  static NNetwork last_nnet = NULL;     /* last neural network passed */
-  static LayerIndex last_lindex = 0;    /* last layer index searched */
-  static Layer layer = NULL;    /* unit's layer */
-  static Unit last_unit = NULL; /* last unit returned */
-
+  Layer layer = NULL;           /* unit's layer */
   Unit cur_unit = NULL;         /* current unit */
   BoolValue unit_found = FALSE; /* unit found flag */
 
 
   /* Fetches the layer */
-  if (nnet != last_nnet || layer_index != last_lindex)
-    {
-      layer = nnet_layer_by_index (nnet, layer_index);
-
-      if (layer == NULL)
-        {
-          fprintf (stderr, "nnet_unit_by_index: layer not found\n");
-          return NULL;
-        }
+  layer = nnet_layer_by_index (nnet, layer_index);
 
-      last_nnet = nnet;
-      last_lindex = layer_index;
-      last_unit = NULL;
-    }
-
-  /* A good guess */
-  if (last_unit != NULL)
+  if (layer == NULL)
     {
-      if (last_unit->next->unit_index == unit_index)
-        {
-          last_unit = last_unit->next;
-          return last_unit;
-        }
+      fprintf (stderr, "nnet_unit_by_index: layer not found\n");
+      return NULL;
     }
 
   /* Searches for the unit */
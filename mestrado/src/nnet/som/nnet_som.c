@@ -1,6 +1,8 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <float.h>
+#include <pthread.h>
 #include "nnet_som.h"
 #include "../../errorh/errorh.h"
 #include "../../strutils/strutils.h"
@@ -14,6 +16,9 @@
 #include "../nnet_conns.h"
 #include "../nnet_metrics.h"
 #include "../nnet_train.h"
+#include "../nnet_codebook.h"
+#include "../nnet_sets.h"
+#include "../nnet_tstream.h"
 
 
 
@@ -94,6 +99,30 @@ nnet_som_create (const NNetwork nnet,
       return NULL;
     }
 
+  /* Online training on a single thread by default */
+  som_attr->som_algorithm = SOM_ONLINE;
+  som_attr->nu_threads = 1;
+
+  /* No search index by default */
+  som_attr->index_type = CBIDX_LINEAR;
+  som_attr->index_rebuild_epochs = 0;
+  som_attr->cb_index = NULL;
+
+  /* The propagation codebook is built when first needed */
+  som_attr->inference_cbook = NULL;
+  som_attr->inference_index = NULL;
+  som_attr->inference_users = 0;
+  pthread_mutex_init (&(som_attr->inference_lock), NULL);
+  pthread_cond_init (&(som_attr->inference_idle), NULL);
+
+  /* No winner tracking by default */
+  som_attr->track_winners = FALSE;
+
+  /* The schedule is created on training, decaying once per epoch */
+  som_attr->schedule = NULL;
+  som_attr->step_decay = FALSE;
+  som_attr->time = 0;
+
   /* Creates the SOM extension */
   new_som = (SomNNetwork) malloc (sizeof (nnet_extension_type));
 
@@ -262,6 +291,127 @@ nnet_som_create_nnetwork (SomNNetwork som_nnet,
 
 
 
+/*
+ * nnet_som_set_algorithm
+ *
+ * Selects the training algorithm and the number of threads used by
+ * nnet_som_train_set and nnet_som_propagate_set
+ */
+int
+nnet_som_set_algorithm (SomNNetwork som_nnet,
+                        const SomAlgorithmType som_algorithm,
+                        const UsIntValue nu_threads)
+{
+  SomAttributes som_attr;       /* SOM attributes */
+
+
+  /* Checks if the SOM extension was passed */
+  if (som_nnet == NULL)
+    return error_failure ("nnet_som_set_algorithm",
+                          "no SOM neural network passed\n");
+
+  /* Checks the algorithm */
+  if (som_algorithm != SOM_ONLINE && som_algorithm != SOM_BATCH)
+    return error_failure ("nnet_som_set_algorithm",
+                          "invalid SOM training algorithm (%d)\n",
+                          (int) som_algorithm);
+
+  /* Checks the number of threads */
+  if (nu_threads == 0)
+    return error_failure ("nnet_som_set_algorithm",
+                          "at least one thread is required\n");
+
+  som_attr = (SomAttributes) som_nnet->attr;
+  som_attr->som_algorithm = som_algorithm;
+  som_attr->nu_threads = nu_threads;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_som_set_index
+ *
+ * Selects the search index used to find the winners in batch training
+ * and in nnet_som_propagate_set
+ */
+int
+nnet_som_set_index (SomNNetwork som_nnet,
+                    const CodebookIndexType index_type,
+                    const DTime rebuild_epochs)
+{
+  SomAttributes som_attr;       /* SOM attributes */
+
+
+  /* Checks if the SOM extension was passed */
+  if (som_nnet == NULL)
+    return error_failure ("nnet_som_set_index",
+                          "no SOM neural network passed\n");
+
+  /* Checks the index class */
+  if (index_type != CBIDX_LINEAR && index_type != CBIDX_VPTREE &&
+      index_type != CBIDX_GRAPH)
+    return error_failure ("nnet_som_set_index",
+                          "invalid codebook index class (%d)\n",
+                          (int) index_type);
+
+  som_attr = (SomAttributes) som_nnet->attr;
+
+  /* The current indexes, if any, are built for the previous class */
+  if (som_attr->cb_index != NULL)
+    nnet_cbidx_destroy (&(som_attr->cb_index));
+
+  som_attr->index_type = index_type;
+  som_attr->index_rebuild_epochs = rebuild_epochs;
+
+  return nnet_som_release_codebook (som_nnet);
+}
+
+
+
+/*
+ * nnet_som_set_tracking
+ *
+ * Enables or disables winner tracking in nnet_som_propagate_set
+ */
+int
+nnet_som_set_tracking (SomNNetwork som_nnet, const BoolValue track_winners)
+{
+  /* Checks if the SOM extension was passed */
+  if (som_nnet == NULL)
+    return error_failure ("nnet_som_set_tracking",
+                          "no SOM neural network passed\n");
+
+  ((SomAttributes) som_nnet->attr)->track_winners = track_winners;
+
+  /* The grid of the propagation codebook follows the flag */
+  return nnet_som_release_codebook (som_nnet);
+}
+
+
+
+/*
+ * nnet_som_set_step_decay
+ *
+ * Makes the learning rate and the neighborhood width decay after each
+ * element of the online epochs, instead of once per epoch
+ */
+int
+nnet_som_set_step_decay (SomNNetwork som_nnet, const BoolValue step_decay)
+{
+  /* Checks if the SOM extension was passed */
+  if (som_nnet == NULL)
+    return error_failure ("nnet_som_set_step_decay",
+                          "no SOM neural network passed\n");
+
+  ((SomAttributes) som_nnet->attr)->step_decay = step_decay;
+
+  return EXIT_SUCCESS;
+}
+
+
+
 /*
  * nnet_som_destroy
  *
@@ -318,6 +468,19 @@ nnet_som_destroy (SomNNetwork * som_nnet,
   if (som_attr->lrate_function != NULL)
     function_destroy (&(som_attr->lrate_function));
 
+  /* Destroys the codebook search index */
+  if (som_attr->cb_index != NULL)
+    nnet_cbidx_destroy (&(som_attr->cb_index));
+
+  /* Destroys the propagation codebook */
+  nnet_som_release_codebook (*som_nnet);
+  pthread_mutex_destroy (&(som_attr->inference_lock));
+  pthread_cond_destroy (&(som_attr->inference_idle));
+
+  /* Destroys the training schedule */
+  if (som_attr->schedule != NULL)
+    nnet_train_schedule_destroy (&(som_attr->schedule));
+
   /* Destroys the SOM network itself */
   free (*som_nnet);
 
@@ -503,205 +666,685 @@ nnet_som_propagate_element (const SomNNetwork som_nnet,
 
 
 /*
- * nnet_som_propagate_set
+ * nnet_som_index_codebook
  *
- * Loads and propagates all elements in the given set, returning a list
- * of winner indexes
+ * Attaches the search index selected in the attributes to the given
+ * codebook, creating it if it doesn't exist yet or updating it for the
+ * current codebook rows otherwise
  */
-Vector
-nnet_som_propagate_set (const SomNNetwork som_nnet, const TSet set)
+static int
+nnet_som_index_codebook (const SomAttributes som_attr, Codebook codebook,
+                         CodebookIndex * index)
 {
-  TElement cur_element = NULL;  /* current training element */
-  ElementIndex cur_index = 1;   /* current element counter */
-  Unit winner = NULL;           /* current winner unit */
-  Vector winners = NULL;        /* list of winners indexes */
+  /* Linear scan: nothing to attach */
+  if (som_attr->index_type == CBIDX_LINEAR)
+    return EXIT_SUCCESS;
 
-
-  /* checks if the SOM was actually passed */
-  if (som_nnet == NULL)
+  if (*index == NULL)
     {
-      error_failure ("nnet_som_propagate_set",
-                     "no SOM neural network passed\n");
-      return NULL;
+      if (error_if_null
+          (*index = nnet_cbidx_create
+           (codebook, som_attr->index_type, som_attr->index_rebuild_epochs,
+            NNET_CBIDX_GRAPH_DEGREE, NNET_CBIDX_BEAM_WIDTH),
+           "nnet_som_index_codebook", "error creating codebook index\n"))
+        return EXIT_FAILURE;
     }
+  else if (error_if_failure
+           (nnet_cbidx_update (*index, codebook), "nnet_som_index_codebook",
+            "error updating codebook index\n"))
+    return EXIT_FAILURE;
 
-  /* checks if the training set was actually passed */
-  if (set == NULL)
-    {
-      error_failure ("nnet_som_propagate_set", "no training set passed\n");
-      return NULL;
-    }
+  return nnet_cbidx_attach (*index, codebook);
+}
 
-  /* creates the unit index list */
-  if (error_if_null
-      (winners =
-       vector_create (set->nu_elements), "nnet_som_propagate_set",
-       "error creating list of winner indexes\n"))
-    return NULL;
 
-  /* propagates all elements in the set */
-  cur_element = set->first_element;
 
-  while (cur_element != NULL)
+/*
+ * nnet_som_build_codebook
+ *
+ * Prepares the given codebook, or a snapshot of the output layer weights
+ * if NULL, as the codebook of the propagation functions: sorts its
+ * columns, attaches the selected search index and links the grid if the
+ * winners are tracked. Must be called with the inference lock held.
+ */
+static int
+nnet_som_build_codebook (const SomNNetwork som_nnet, Codebook codebook)
+{
+  SomAttributes som_attr;       /* SOM attributes */
+  int exit_status;              /* auxiliary function return status */
+
+
+  som_attr = (SomAttributes) som_nnet->attr;
+
+  if (codebook == NULL &&
+      error_if_null (codebook =
+                     nnet_cbook_create (som_nnet->nnet->last_layer),
+                     "nnet_som_build_codebook",
+                     "error creating output layer codebook\n"))
+    return EXIT_FAILURE;
+
+  /* No set is known yet: the column order follows the rows alone */
+  exit_status = nnet_cbook_set_order (codebook, NULL);
+
+  if (exit_status == EXIT_SUCCESS)
+    exit_status = nnet_som_index_codebook (som_attr, codebook,
+                                           &(som_attr->inference_index));
+
+  /* Codebooks of mapped models have no unit coordinates */
+  if (exit_status == EXIT_SUCCESS && som_attr->track_winners == TRUE &&
+      codebook->units != NULL)
+    exit_status = nnet_cbook_set_grid (codebook, NNET_CBOOK_GRID_NEIGHBORS);
+
+  if (exit_status != EXIT_SUCCESS)
     {
-      /* propagates current element */
-      if (error_if_failure
-          (nnet_som_propagate_element (som_nnet, cur_element, &winner),
-           "nnet_som_propagate_set", "error propagating element %ld\n",
-           cur_element->element_index))
-        return NULL;
+      if (som_attr->inference_index != NULL)
+        nnet_cbidx_destroy (&(som_attr->inference_index));
 
-      /* sets the winner index in the unit index list */
-      if (error_if_failure
-          (vector_set_value (winners, cur_index, (RValue) winner->unit_index),
-           "nnet_som_propagate_set",
-           "error setting winner index for element %ld\n",
-           cur_element->element_index))
-        return NULL;
-
-      /* goes to the next element */
-      ++cur_index;
-      cur_element = cur_element->next;
+      nnet_cbook_destroy (&codebook);
+
+      return error_failure ("nnet_som_build_codebook",
+                            "error preparing propagation codebook\n");
     }
 
-  return winners;
+  som_attr->inference_cbook = codebook;
+
+  return EXIT_SUCCESS;
 }
 
 
 
 /*
- * nnet_som_train_element
+ * nnet_som_drop_codebook
  *
- * Executes training for one element
+ * Destroys the codebook of the propagation functions and its index. Must
+ * be called with the inference lock held and no propagation using them.
  */
-int
-nnet_som_train_element (SomNNetwork som_nnet,
-                        const TElement element, const RValue learning_rate)
+static void
+nnet_som_drop_codebook (SomAttributes som_attr)
 {
-  Layer input_layer = NULL;     /* SOM input layer */
-  Layer output_layer = NULL;    /* SOM output layer */
-  Unit winner_unit = NULL;      /* winning unit */
-  Unit cur_unit = NULL;         /* current output unit */
-  UsLgIntValue cur_comp;        /* current neighborhood vector component */
-  Vector ngb_vector = NULL;     /* neighborhood vector */
-  Vector weight_vector = NULL;  /* auxiliary weight vector */
-  Vector error_vector = NULL;   /* current unit error vector */
-  RValue ngb_value;             /* neighborhood value */
-  RValue rate;                  /* fraction of the error vector */
-  int exit_status;              /* auxiliary function return status */
+  if (som_attr->inference_index != NULL)
+    nnet_cbidx_destroy (&(som_attr->inference_index));
 
+  if (som_attr->inference_cbook != NULL)
+    nnet_cbook_destroy (&(som_attr->inference_cbook));
 
-  /*************************************************************************
-   *                             PRE-CONDITIONS                            *
-   *************************************************************************/
+  return;
+}
 
-  /* Checks if the network was actually passed */
-  if (som_nnet == NULL)
-    {
-      fprintf (stderr, "nnet_som_train_element: no neural network passed\n");
-      return EXIT_FAILURE;
-    }
 
-  /* Checks if the SOM extension is attached to a neural network */
-  if (som_nnet->nnet == NULL)
-    {
-      fprintf (stderr,
-               "nnet_som_train_element: SOM extension is not attached to a neural network\n");
-      return EXIT_FAILURE;
-    }
 
-  /* Checks if the network has a plausible SOM architecture */
-  if (som_nnet->nnet->nu_layers != 2)
-    {
-      fprintf (stderr,
-               "nnet_som_train_element: a SOM must have two layers\n");
-      return EXIT_FAILURE;
-    }
+/*
+ * nnet_som_inference_codebook
+ *
+ * Returns the codebook of the propagation functions, building it from
+ * the output layer weights if there is none yet. The codebook is kept
+ * until the caller hands it back with nnet_som_return_codebook.
+ */
+static int
+nnet_som_inference_codebook (const SomNNetwork som_nnet,
+                             Codebook * codebook)
+{
+  SomAttributes som_attr;       /* SOM attributes */
+  int exit_status = EXIT_SUCCESS;       /* auxiliary function return status */
 
 
-  /*************************************************************************
-   *                             INITIALIZATION                            *
-   *************************************************************************/
+  som_attr = (SomAttributes) som_nnet->attr;
 
-  /* Sets the auxiliary layer pointers */
-  input_layer = som_nnet->nnet->first_layer;
-  output_layer = som_nnet->nnet->last_layer;
+  pthread_mutex_lock (&(som_attr->inference_lock));
 
-  /* Creates the neighborhood vector */
-  ngb_vector = vector_create (output_layer->nu_units);
+  if (som_attr->inference_cbook == NULL)
+    exit_status = nnet_som_build_codebook (som_nnet, NULL);
 
-  if (ngb_vector == NULL)
-    {
-      fprintf (stderr,
-               "nnet_som_train_element: error creating neighborhood vector\n");
-      return EXIT_FAILURE;
-    }
+  if (exit_status == EXIT_SUCCESS)
+    som_attr->inference_users++;
 
-  /* Creates the auxiliary weight vector */
-  weight_vector = vector_create (input_layer->nu_units);
+  *codebook = som_attr->inference_cbook;
 
-  if (weight_vector == NULL)
-    {
-      fprintf (stderr,
-               "nnet_som_train_element: error creating auxiliary weight vector\n");
-      return EXIT_FAILURE;
-    }
+  pthread_mutex_unlock (&(som_attr->inference_lock));
 
-  /* Creates the auxiliary error vector */
-  error_vector = vector_create (input_layer->nu_units);
+  return exit_status;
+}
 
-  if (error_vector == NULL)
-    {
-      fprintf (stderr,
-               "nnet_som_train_element: error creating auxiliary error vector\n");
-      return EXIT_FAILURE;
-    }
 
 
-  /*************************************************************************
-   *                               COMPETITION                             *
-   *************************************************************************/
+/*
+ * nnet_som_return_codebook
+ *
+ * Hands back a codebook taken by nnet_som_inference_codebook, waking up
+ * whoever waits to release it
+ */
+static void
+nnet_som_return_codebook (const SomNNetwork som_nnet)
+{
+  SomAttributes som_attr;       /* SOM attributes */
 
-  /* Loads the training element, activates the network and find the winner */
-  exit_status = nnet_som_propagate_element (som_nnet, element, &winner_unit);
 
-  if (exit_status != EXIT_SUCCESS)
-    {
-      fprintf (stderr,
-               "nnet_som_train_element: error performing competition\n");
-      return EXIT_FAILURE;
-    }
+  som_attr = (SomAttributes) som_nnet->attr;
 
-  /*
-     printf ("winner: unit %ld\n", winner_unit->unit_index);
-   */
+  pthread_mutex_lock (&(som_attr->inference_lock));
 
-  /*************************************************************************
-   *                               COOPERATION                             *
-   *************************************************************************/
+  if (--som_attr->inference_users == 0)
+    pthread_cond_broadcast (&(som_attr->inference_idle));
 
-  /* Gets the neighborhood vector for the winner unit */
-  exit_status = nnet_som_ngb_vector (som_nnet, winner_unit, ngb_vector);
+  pthread_mutex_unlock (&(som_attr->inference_lock));
 
-  if (exit_status != EXIT_SUCCESS)
+  return;
+}
+
+
+
+/*
+ * nnet_som_fix_codebook
+ *
+ * Sets the codebook searched by the propagation functions: the given one,
+ * which the SOM then owns, or a snapshot of the output layer weights if
+ * NULL. Its column order, search index and grid are built at once, after
+ * the propagations using the previous codebook are over.
+ */
+int
+nnet_som_fix_codebook (SomNNetwork som_nnet, Codebook codebook)
+{
+  SomAttributes som_attr;       /* SOM attributes */
+  int exit_status;              /* auxiliary function return status */
+
+
+  /* Checks if the SOM was actually passed */
+  if (som_nnet == NULL || som_nnet->nnet == NULL)
+    return error_failure ("nnet_som_fix_codebook",
+                          "no SOM neural network passed\n");
+
+  /* Checks the codebook dimensions */
+  if (codebook != NULL &&
+      (codebook->nu_units != som_nnet->nnet->last_layer->nu_units ||
+       codebook->dimension != som_nnet->nnet->first_layer->nu_units))
     {
       fprintf (stderr,
-               "nnet_som_train_element: error getting neighborhood vector\n");
+               "nnet_som_fix_codebook: codebook of %ld rows of dimension %ld doesn't fit the network\n",
+               codebook->nu_units, codebook->dimension);
+      nnet_cbook_destroy (&codebook);
       return EXIT_FAILURE;
     }
 
-  /*
-     printf ("NGB:");
-     vector_info (ngb_vector, stdout);
-   */
+  som_attr = (SomAttributes) som_nnet->attr;
 
-  /*************************************************************************
-   *                                ADAPTION                               *
-   *************************************************************************/
+  pthread_mutex_lock (&(som_attr->inference_lock));
 
-  /* Updates the weights of the output units */
-  cur_unit = output_layer->first_unit;
-  cur_comp = 1;
+  while (som_attr->inference_users > 0)
+    pthread_cond_wait (&(som_attr->inference_idle),
+                       &(som_attr->inference_lock));
+
+  nnet_som_drop_codebook (som_attr);
+  exit_status = nnet_som_build_codebook (som_nnet, codebook);
+
+  pthread_mutex_unlock (&(som_attr->inference_lock));
+
+  return exit_status;
+}
+
+
+
+/*
+ * nnet_som_release_codebook
+ *
+ * Releases the codebook of the propagation functions, once the
+ * propagations using it are over. It is built anew from the output layer
+ * weights on the next propagation.
+ */
+int
+nnet_som_release_codebook (SomNNetwork som_nnet)
+{
+  SomAttributes som_attr;       /* SOM attributes */
+
+
+  /* Checks if the SOM was actually passed */
+  if (som_nnet == NULL)
+    return error_failure ("nnet_som_release_codebook",
+                          "no SOM neural network passed\n");
+
+  som_attr = (SomAttributes) som_nnet->attr;
+
+  pthread_mutex_lock (&(som_attr->inference_lock));
+
+  while (som_attr->inference_users > 0)
+    pthread_cond_wait (&(som_attr->inference_idle),
+                       &(som_attr->inference_lock));
+
+  nnet_som_drop_codebook (som_attr);
+
+  pthread_mutex_unlock (&(som_attr->inference_lock));
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_som_propagate_set
+ *
+ * Propagates all elements in the given set, returning a list of winner
+ * indexes. The winners are searched on the fixed codebook, split among
+ * the threads set in the attributes, so the activations and outputs of
+ * the network units are left untouched.
+ */
+Vector
+nnet_som_propagate_set (const SomNNetwork som_nnet, const TSet set)
+{
+  SomAttributes som_attr = NULL;        /* SOM attributes */
+  Codebook codebook = NULL;     /* output layer codebook */
+  Vector winners = NULL;        /* list of winners indexes */
+
+
+  /* checks if the SOM was actually passed */
+  if (som_nnet == NULL || som_nnet->nnet == NULL)
+    {
+      error_failure ("nnet_som_propagate_set",
+                     "no SOM neural network passed\n");
+      return NULL;
+    }
+
+  /* checks if the training set was actually passed */
+  if (set == NULL)
+    {
+      error_failure ("nnet_som_propagate_set", "no training set passed\n");
+      return NULL;
+    }
+
+  som_attr = (SomAttributes) som_nnet->attr;
+
+  /* the codebook is only read from here on */
+  if (error_if_failure
+      (nnet_som_inference_codebook (som_nnet, &codebook),
+       "nnet_som_propagate_set", "error preparing output layer codebook\n"))
+    return NULL;
+
+  /* creates the unit index list */
+  if (error_if_null
+      (winners =
+       vector_create (set->nu_elements), "nnet_som_propagate_set",
+       "error creating list of winner indexes\n"))
+    {
+      nnet_som_return_codebook (som_nnet);
+      return NULL;
+    }
+
+  /* determines the winners of all elements in the set */
+  if (error_if_failure
+      (nnet_cbook_winners
+       (codebook, set, som_attr->ngb_function->function_class->vector_metric,
+        som_attr->nu_threads, winners), "nnet_som_propagate_set",
+       "error propagating set elements\n"))
+    vector_destroy (&winners);
+
+  nnet_som_return_codebook (som_nnet);
+
+  return winners;
+}
+
+
+
+/*
+ * nnet_som_propagate_states
+ *
+ * Propagates all elements in the given set in order, passing the index
+ * of each winner unit to 'state_function' as soon as it is found
+ */
+int
+nnet_som_propagate_states (const SomNNetwork som_nnet, const TSet set,
+                           const SomStateFunction state_function, void *arg)
+{
+  SomAttributes som_attr = NULL;        /* SOM attributes */
+  Codebook codebook = NULL;     /* output layer codebook */
+  CodebookIndexScratch scratch = NULL;  /* index search working memory */
+  VectorMetric metric;          /* vector metric for activation */
+  BoolValue track;              /* flag: track the previous winner */
+  TElement cur_element;         /* current element */
+  UnitIndex winner;             /* winner row */
+  int exit_status;              /* auxiliary function return status */
+
+
+  /* checks the parameters */
+  if (som_nnet == NULL || som_nnet->nnet == NULL)
+    return error_failure ("nnet_som_propagate_states",
+                          "no SOM neural network passed\n");
+
+  if (set == NULL)
+    return error_failure ("nnet_som_propagate_states",
+                          "no training set passed\n");
+
+  if (state_function == NULL)
+    return error_failure ("nnet_som_propagate_states",
+                          "no state function passed\n");
+
+  som_attr = (SomAttributes) som_nnet->attr;
+  metric = som_attr->ngb_function->function_class->vector_metric;
+
+  /* the codebook is only read from here on */
+  if (error_if_failure
+      (nnet_som_inference_codebook (som_nnet, &codebook),
+       "nnet_som_propagate_states",
+       "error preparing output layer codebook\n"))
+    return EXIT_FAILURE;
+
+  if (codebook->index != NULL &&
+      (scratch = nnet_cbidx_scratch_create (codebook->index)) == NULL)
+    {
+      nnet_som_return_codebook (som_nnet);
+      return EXIT_FAILURE;
+    }
+
+  track = (codebook->grid != NULL &&
+           metric == VECTOR_METR_EUCLIDEAN) ? TRUE : FALSE;
+
+  /* no previous winner at the start of the set */
+  winner = codebook->nu_units;
+  cur_element = set->first_element;
+  exit_status = EXIT_SUCCESS;
+
+  while (exit_status == EXIT_SUCCESS && cur_element != NULL)
+    {
+      if (cur_element->input == NULL ||
+          cur_element->input->dimension != codebook->dimension)
+        exit_status =
+          error_failure ("nnet_som_propagate_states",
+                         "element %ld has incompatible input dimension\n",
+                         cur_element->element_index);
+      else if (track == TRUE)
+        exit_status = nnet_cbook_track
+          (codebook, cur_element->input->value, winner, &winner, NULL, NULL);
+      else
+        exit_status = nnet_cbook_winner
+          (codebook, cur_element->input->value, metric, scratch, &winner,
+           NULL);
+
+      if (exit_status == EXIT_SUCCESS)
+        exit_status =
+          state_function (arg, nnet_cbook_unit_index (codebook, winner));
+
+      cur_element = cur_element->next;
+    }
+
+  if (scratch != NULL)
+    nnet_cbidx_scratch_destroy (&scratch);
+
+  nnet_som_return_codebook (som_nnet);
+
+  return error_if_failure (exit_status, "nnet_som_propagate_states",
+                           "error propagating set elements\n");
+}
+
+
+
+/*
+ * nnet_som_index_recall
+ *
+ * Compares the winners found through the selected search index with the
+ * exact ones for the given set, returning the fraction of matches and the
+ * mean number of distances computed per element
+ */
+int
+nnet_som_index_recall (const SomNNetwork som_nnet, const TSet set,
+                       RValue * recall, RValue * mean_evaluations)
+{
+  Codebook codebook = NULL;     /* output layer codebook */
+  int exit_status;              /* auxiliary function return status */
+
+
+  /* checks if the SOM was actually passed */
+  if (som_nnet == NULL || som_nnet->nnet == NULL)
+    return error_failure ("nnet_som_index_recall",
+                          "no SOM neural network passed\n");
+
+  /* checks if the set was actually passed */
+  if (set == NULL)
+    return error_failure ("nnet_som_index_recall", "no set passed\n");
+
+  if (error_if_failure
+      (nnet_som_inference_codebook (som_nnet, &codebook),
+       "nnet_som_index_recall", "error preparing output layer codebook\n"))
+    return EXIT_FAILURE;
+
+  /* the linear scan is exact and compares every unit */
+  if (codebook->index == NULL)
+    {
+      *recall = 1.0;
+      *mean_evaluations = (RValue) codebook->nu_units;
+      exit_status = EXIT_SUCCESS;
+    }
+  else
+    exit_status = nnet_cbidx_recall (codebook->index, codebook, set, recall,
+                                     mean_evaluations);
+
+  nnet_som_return_codebook (som_nnet);
+
+  return error_if_failure (exit_status, "nnet_som_index_recall",
+                           "error measuring codebook index recall\n");
+}
+
+
+
+/*
+ * nnet_som_tracking_cost
+ *
+ * Returns the mean number of full distance computations per element that
+ * winner tracking costs over the given set, in its current order
+ */
+int
+nnet_som_tracking_cost (const SomNNetwork som_nnet, const TSet set,
+                        RValue * mean_distances)
+{
+  Codebook codebook = NULL;     /* output layer codebook */
+  int exit_status;              /* auxiliary function return status */
+
+
+  /* checks if the SOM was actually passed */
+  if (som_nnet == NULL || som_nnet->nnet == NULL)
+    return error_failure ("nnet_som_tracking_cost",
+                          "no SOM neural network passed\n");
+
+  /* checks if the set was actually passed */
+  if (set == NULL)
+    return error_failure ("nnet_som_tracking_cost", "no set passed\n");
+
+  if (error_if_null
+      (codebook = nnet_cbook_create (som_nnet->nnet->last_layer),
+       "nnet_som_tracking_cost", "error creating output layer codebook\n"))
+    return EXIT_FAILURE;
+
+  exit_status = nnet_cbook_set_order (codebook, set->input_vector_stats);
+
+  if (exit_status == EXIT_SUCCESS)
+    exit_status =
+      nnet_cbook_set_grid (codebook, NNET_CBOOK_GRID_NEIGHBORS);
+
+  if (exit_status == EXIT_SUCCESS)
+    exit_status = nnet_cbook_track_cost (codebook, set, mean_distances);
+
+  nnet_cbook_destroy (&codebook);
+
+  return error_if_failure (exit_status, "nnet_som_tracking_cost",
+                           "error tracking set winners\n");
+}
+
+
+
+/*
+ * nnet_som_quantization_error
+ *
+ * Returns the mean euclidean distance between the elements of the given
+ * set and their winner units' weights, searching the winners like
+ * nnet_som_propagate_set does, with the threads set in the attributes
+ */
+int
+nnet_som_quantization_error (const SomNNetwork som_nnet, const TSet set,
+                             RValue * error)
+{
+  SomAttributes som_attr = NULL;        /* SOM attributes */
+  Codebook codebook = NULL;     /* output layer codebook */
+  int exit_status;              /* auxiliary function return status */
+
+
+  /* checks if the SOM was actually passed */
+  if (som_nnet == NULL || som_nnet->nnet == NULL)
+    return error_failure ("nnet_som_quantization_error",
+                          "no SOM neural network passed\n");
+
+  /* checks if the set was actually passed */
+  if (set == NULL)
+    return error_failure ("nnet_som_quantization_error", "no set passed\n");
+
+  som_attr = (SomAttributes) som_nnet->attr;
+
+  if (error_if_failure
+      (nnet_som_inference_codebook (som_nnet, &codebook),
+       "nnet_som_quantization_error",
+       "error preparing output layer codebook\n"))
+    return EXIT_FAILURE;
+
+  exit_status = nnet_cbook_mean_error
+    (codebook, set, som_attr->ngb_function->function_class->vector_metric,
+     som_attr->nu_threads, nnet_cbook_distance_error, NULL, error);
+
+  nnet_som_return_codebook (som_nnet);
+
+  return error_if_failure (exit_status, "nnet_som_quantization_error",
+                           "error measuring quantization error\n");
+}
+
+
+
+/*
+ * nnet_som_train_element
+ *
+ * Executes training for one element
+ */
+int
+nnet_som_train_element (SomNNetwork som_nnet,
+                        const TElement element, const RValue learning_rate)
+{
+  Layer input_layer = NULL;     /* SOM input layer */
+  Layer output_layer = NULL;    /* SOM output layer */
+  Unit winner_unit = NULL;      /* winning unit */
+  Unit cur_unit = NULL;         /* current output unit */
+  UsLgIntValue cur_comp;        /* current neighborhood vector component */
+  Vector ngb_vector = NULL;     /* neighborhood vector */
+  Vector weight_vector = NULL;  /* auxiliary weight vector */
+  Vector error_vector = NULL;   /* current unit error vector */
+  RValue ngb_value;             /* neighborhood value */
+  RValue rate;                  /* fraction of the error vector */
+  int exit_status;              /* auxiliary function return status */
+
+
+  /*************************************************************************
+   *                             PRE-CONDITIONS                            *
+   *************************************************************************/
+
+  /* Checks if the network was actually passed */
+  if (som_nnet == NULL)
+    {
+      fprintf (stderr, "nnet_som_train_element: no neural network passed\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Checks if the SOM extension is attached to a neural network */
+  if (som_nnet->nnet == NULL)
+    {
+      fprintf (stderr,
+               "nnet_som_train_element: SOM extension is not attached to a neural network\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Checks if the network has a plausible SOM architecture */
+  if (som_nnet->nnet->nu_layers != 2)
+    {
+      fprintf (stderr,
+               "nnet_som_train_element: a SOM must have two layers\n");
+      return EXIT_FAILURE;
+    }
+
+
+  /*************************************************************************
+   *                             INITIALIZATION                            *
+   *************************************************************************/
+
+  /* Sets the auxiliary layer pointers */
+  input_layer = som_nnet->nnet->first_layer;
+  output_layer = som_nnet->nnet->last_layer;
+
+  /* Creates the neighborhood vector */
+  ngb_vector = vector_create (output_layer->nu_units);
+
+  if (ngb_vector == NULL)
+    {
+      fprintf (stderr,
+               "nnet_som_train_element: error creating neighborhood vector\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Creates the auxiliary weight vector */
+  weight_vector = vector_create (input_layer->nu_units);
+
+  if (weight_vector == NULL)
+    {
+      fprintf (stderr,
+               "nnet_som_train_element: error creating auxiliary weight vector\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Creates the auxiliary error vector */
+  error_vector = vector_create (input_layer->nu_units);
+
+  if (error_vector == NULL)
+    {
+      fprintf (stderr,
+               "nnet_som_train_element: error creating auxiliary error vector\n");
+      return EXIT_FAILURE;
+    }
+
+
+  /*************************************************************************
+   *                               COMPETITION                             *
+   *************************************************************************/
+
+  /* Loads the training element, activates the network and find the winner */
+  exit_status = nnet_som_propagate_element (som_nnet, element, &winner_unit);
+
+  if (exit_status != EXIT_SUCCESS)
+    {
+      fprintf (stderr,
+               "nnet_som_train_element: error performing competition\n");
+      return EXIT_FAILURE;
+    }
+
+  /*
+     printf ("winner: unit %ld\n", winner_unit->unit_index);
+   */
+
+  /*************************************************************************
+   *                               COOPERATION                             *
+   *************************************************************************/
+
+  /* Gets the neighborhood vector for the winner unit */
+  exit_status = nnet_som_ngb_vector (som_nnet, winner_unit, ngb_vector);
+
+  if (exit_status != EXIT_SUCCESS)
+    {
+      fprintf (stderr,
+               "nnet_som_train_element: error getting neighborhood vector\n");
+      return EXIT_FAILURE;
+    }
+
+  /*
+     printf ("NGB:");
+     vector_info (ngb_vector, stdout);
+   */
+
+  /*************************************************************************
+   *                                ADAPTION                               *
+   *************************************************************************/
+
+  /* Updates the weights of the output units */
+  cur_unit = output_layer->first_unit;
+  cur_comp = 1;
 
   while (cur_unit != NULL)
     {
@@ -826,11 +1469,437 @@ nnet_som_train_element (SomNNetwork som_nnet,
 
 
 
+/*
+ * nnet_som_batch_job_type
+ *
+ * Work assigned to one thread of the batch map: a range of the training
+ * elements and the private partial sums accumulated over it
+ */
+typedef struct
+{
+  Codebook codebook;            /* shared codebook (read only) */
+  VectorMetric metric;          /* competition metric */
+  TElement *elements;           /* shared array of training elements */
+  ElementIndex first;           /* first element of the range */
+  ElementIndex last;            /* one past the last element of the range */
+  RValue *sums;                 /* sum of the inputs won by each unit */
+  RValue *hits;                 /* number of inputs won by each unit */
+  int exit_status;              /* job return status */
+}
+nnet_som_batch_job_type;
+
+
+
+/*
+ * nnet_som_batch_worker
+ *
+ * Finds the winners of one range of elements and accumulates each input
+ * into the partial sum of its winner
+ */
+static void *
+nnet_som_batch_worker (void *job_ptr)
+{
+  nnet_som_batch_job_type *job; /* this thread's job */
+  CodebookIndexScratch scratch = NULL;  /* index search working memory */
+  ElementIndex cur_element;     /* current element */
+  UnitIndex winner;             /* winner row */
+  UnitIndex dim;                /* input dimension */
+  UnitIndex cur_col;            /* current input component */
+  RValue *input;                /* current input values */
+  RValue *sum;                  /* winner's partial sum */
+
+
+  job = (nnet_som_batch_job_type *) job_ptr;
+  dim = job->codebook->dimension;
+  job->exit_status = EXIT_SUCCESS;
+
+  if (job->codebook->index != NULL &&
+      (scratch = nnet_cbidx_scratch_create (job->codebook->index)) == NULL)
+    {
+      job->exit_status = EXIT_FAILURE;
+      return job_ptr;
+    }
+
+  for (cur_element = job->first; cur_element < job->last; cur_element++)
+    {
+      input = job->elements[cur_element]->input->value;
+
+      /* competition */
+      if (nnet_cbook_winner
+          (job->codebook, input, job->metric, scratch, &winner,
+           NULL) != EXIT_SUCCESS)
+        {
+          job->exit_status = EXIT_FAILURE;
+          break;
+        }
+
+      /* accumulation */
+      sum = &(job->sums[winner * dim]);
+      for (cur_col = 0; cur_col < dim; cur_col++)
+        sum[cur_col] += input[cur_col];
+
+      job->hits[winner] += 1.0;
+    }
+
+  if (scratch != NULL)
+    nnet_cbidx_scratch_destroy (&scratch);
+
+  return job_ptr;
+}
+
+
+
+/*
+ * nnet_som_batch_accumulate
+ *
+ * Runs the batch jobs, each one on its own thread, and reduces their
+ * partial sums into the first job, always in the same order
+ */
+static int
+nnet_som_batch_accumulate (nnet_som_batch_job_type * jobs,
+                           const UsIntValue nu_jobs, pthread_t * threads)
+{
+  UsIntValue nu_started;        /* number of threads actually started */
+  UsIntValue cur_job;           /* current job */
+  UnitIndex nu_values;          /* number of values in the partial sums */
+  UnitIndex cur_value;          /* current partial sum value */
+  UnitIndex cur_row;            /* current codebook row */
+
+
+  /* The single job runs on the calling thread */
+  if (nu_jobs == 1)
+    {
+      nnet_som_batch_worker (&jobs[0]);
+      return jobs[0].exit_status;
+    }
+
+  /* Starts one thread per job */
+  for (nu_started = 0; nu_started < nu_jobs; nu_started++)
+    if (pthread_create (&threads[nu_started], NULL, nnet_som_batch_worker,
+                        &jobs[nu_started]) != 0)
+      break;
+
+  /* Waits for all the threads actually started */
+  for (cur_job = 0; cur_job < nu_started; cur_job++)
+    pthread_join (threads[cur_job], NULL);
+
+  if (nu_started < nu_jobs)
+    return error_failure ("nnet_som_batch_accumulate",
+                          "error creating worker thread %d\n", nu_started);
+
+  /* Reduction */
+  nu_values = jobs[0].codebook->nu_units * jobs[0].codebook->dimension;
+
+  for (cur_job = 0; cur_job < nu_jobs; cur_job++)
+    {
+      if (jobs[cur_job].exit_status != EXIT_SUCCESS)
+        return error_failure ("nnet_som_batch_accumulate",
+                              "error determining winners in job %d\n",
+                              cur_job);
+
+      if (cur_job == 0)
+        continue;
+
+      for (cur_value = 0; cur_value < nu_values; cur_value++)
+        jobs[0].sums[cur_value] += jobs[cur_job].sums[cur_value];
+
+      for (cur_row = 0; cur_row < jobs[0].codebook->nu_units; cur_row++)
+        jobs[0].hits[cur_row] += jobs[cur_job].hits[cur_row];
+    }
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_som_batch_update
+ *
+ * Replaces each prototype in the codebook by the neighborhood-weighted mean
+ * of the accumulated inputs. Units outside the neighborhood of every
+ * winner keep their weights.
+ */
+static int
+nnet_som_batch_update (const NgbFunction ngb_function, Codebook codebook,
+                       const RValue * sums, const RValue * hits,
+                       RValue * numerator)
+{
+  UnitIndex dim;                /* input dimension */
+  UnitIndex cur_row, win_row;   /* codebook rows */
+  UnitIndex cur_col;            /* current input component */
+  RValue denominator;           /* neighborhood-weighted number of inputs */
+  RValue ngb_value;             /* neighborhood function value */
+  RValue *row;                  /* current prototype */
+
+
+  dim = codebook->dimension;
+
+  for (cur_row = 0; cur_row < codebook->nu_units; cur_row++)
+    {
+      memset (numerator, 0, dim * sizeof (RValue));
+      denominator = 0.0;
+
+      for (win_row = 0; win_row < codebook->nu_units; win_row++)
+        {
+          /* only units that won some element contribute */
+          if (hits[win_row] == 0.0)
+            continue;
+
+          if (error_if_failure
+              (nnet_som_ngb_value
+               (ngb_function, codebook->units[win_row]->coord,
+                codebook->units[cur_row]->coord, &ngb_value),
+               "nnet_som_batch_update",
+               "error calculating neighborhood function value\n"))
+            return EXIT_FAILURE;
+
+          if (ngb_value <= DBL_EPSILON)
+            continue;
+
+          denominator += ngb_value * hits[win_row];
+
+          for (cur_col = 0; cur_col < dim; cur_col++)
+            numerator[cur_col] += ngb_value * sums[win_row * dim + cur_col];
+        }
+
+      if (denominator > DBL_EPSILON)
+        {
+          row = nnet_cbook_row (codebook, cur_row);
+
+          for (cur_col = 0; cur_col < dim; cur_col++)
+            row[cur_col] = numerator[cur_col] / denominator;
+        }
+    }
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_som_train_batch
+ *
+ * Executes one batch map epoch over the given training set: winners are
+ * determined for all elements in parallel and each prototype is then
+ * replaced by the neighborhood-weighted mean of the elements
+ */
+int
+nnet_som_train_batch (SomNNetwork som_nnet, const TSet training_set,
+                      const UsIntValue nu_threads)
+{
+  SomAttributes somatt = NULL;  /* SOM attributes */
+  Codebook codebook = NULL;     /* output layer codebook */
+  TElement *elements = NULL;    /* training elements by position */
+  TElement cur_element = NULL;  /* current training element */
+  ElementIndex nu_elements;     /* number of training elements */
+  ElementIndex cur_index;       /* current element position */
+  nnet_som_batch_job_type *jobs = NULL; /* thread jobs */
+  pthread_t *threads = NULL;    /* worker threads */
+  UsIntValue nu_jobs;           /* number of jobs actually used */
+  UsIntValue cur_job;           /* current job */
+  RValue *numerator = NULL;     /* prototype recalculation workspace */
+  int exit_status = EXIT_SUCCESS;       /* function return status */
+
+
+  /*************************************************************************
+   *                             PRE-CONDITIONS                            *
+   *************************************************************************/
+
+  /* Checks if the network was actually passed */
+  if (som_nnet == NULL || som_nnet->nnet == NULL)
+    return error_failure ("nnet_som_train_batch",
+                          "no SOM neural network passed\n");
+
+  /* Checks if the training set was actually passed */
+  if (training_set == NULL)
+    return error_failure ("nnet_som_train_batch", "no training set passed\n");
+
+  /* Checks the number of threads */
+  if (nu_threads == 0)
+    return error_failure ("nnet_som_train_batch",
+                          "at least one thread is required\n");
+
+  /* Nothing to do for an empty set */
+  nu_elements = training_set->nu_elements;
+  if (nu_elements == 0)
+    return EXIT_SUCCESS;
+
+
+  /*************************************************************************
+   *                             INITIALIZATION                            *
+   *************************************************************************/
+
+  somatt = (SomAttributes) som_nnet->attr;
+
+  /* The weights are about to change */
+  if (nnet_som_release_codebook (som_nnet) != EXIT_SUCCESS)
+    return EXIT_FAILURE;
+
+  if (error_if_null
+      (codebook = nnet_cbook_create (som_nnet->nnet->last_layer),
+       "nnet_som_train_batch", "error creating output layer codebook\n"))
+    return EXIT_FAILURE;
+
+  /* Visits the most discriminant input components first */
+  exit_status =
+    nnet_cbook_set_order (codebook, training_set->input_vector_stats);
+
+  /* The index persists across epochs, following the prototypes */
+  if (exit_status == EXIT_SUCCESS)
+    exit_status =
+      nnet_som_index_codebook (somatt, codebook, &(somatt->cb_index));
+
+  nu_jobs = nu_threads;
+  if ((ElementIndex) nu_jobs > nu_elements)
+    nu_jobs = (UsIntValue) nu_elements;
+
+  elements = (TElement *) malloc (nu_elements * sizeof (TElement));
+  jobs = (nnet_som_batch_job_type *)
+    calloc (nu_jobs, sizeof (nnet_som_batch_job_type));
+  threads = (pthread_t *) malloc (nu_jobs * sizeof (pthread_t));
+  numerator = (RValue *) malloc (codebook->dimension * sizeof (RValue));
+
+  if (elements == NULL || jobs == NULL || threads == NULL ||
+      numerator == NULL)
+    exit_status = error_failure ("nnet_som_train_batch",
+                                 "virtual memory exhausted\n");
+
+  /* Indexes the training elements */
+  cur_element = training_set->first_element;
+  cur_index = 0;
+
+  while (exit_status == EXIT_SUCCESS && cur_element != NULL &&
+         cur_index < nu_elements)
+    {
+      if (cur_element->input == NULL ||
+          cur_element->input->dimension != codebook->dimension)
+        exit_status = error_failure ("nnet_som_train_batch",
+                                     "element %ld has incompatible input dimension\n",
+                                     cur_element->element_index);
+
+      elements[cur_index++] = cur_element;
+      cur_element = cur_element->next;
+    }
+
+  if (exit_status == EXIT_SUCCESS && cur_index != nu_elements)
+    exit_status = error_failure ("nnet_som_train_batch",
+                                 "set has less elements than expected\n");
+
+  /* Splits the elements in contiguous ranges, one per job */
+  for (cur_job = 0; exit_status == EXIT_SUCCESS && cur_job < nu_jobs;
+       cur_job++)
+    {
+      jobs[cur_job].codebook = codebook;
+      jobs[cur_job].metric =
+        somatt->ngb_function->function_class->vector_metric;
+      jobs[cur_job].elements = elements;
+      jobs[cur_job].first = nu_elements * cur_job / nu_jobs;
+      jobs[cur_job].last = nu_elements * (cur_job + 1) / nu_jobs;
+      jobs[cur_job].sums = (RValue *)
+        calloc (codebook->nu_units * codebook->dimension, sizeof (RValue));
+      jobs[cur_job].hits = (RValue *)
+        calloc (codebook->nu_units, sizeof (RValue));
+
+      if (jobs[cur_job].sums == NULL || jobs[cur_job].hits == NULL)
+        exit_status = error_failure ("nnet_som_train_batch",
+                                     "virtual memory exhausted\n");
+    }
+
+
+  /*************************************************************************
+   *                                TRAINING                               *
+   *************************************************************************/
+
+  /* Competition and accumulation */
+  if (exit_status == EXIT_SUCCESS)
+    exit_status = nnet_som_batch_accumulate (jobs, nu_jobs, threads);
+
+  /* Prototypes recalculation */
+  if (exit_status == EXIT_SUCCESS)
+    exit_status = nnet_som_batch_update
+      (somatt->ngb_function, codebook, jobs[0].sums, jobs[0].hits,
+       numerator);
+
+  /* Updates the weights of the output units */
+  if (exit_status == EXIT_SUCCESS)
+    exit_status = nnet_cbook_store (codebook);
+
+
+  /*************************************************************************
+   *                              FINALIZATION                             *
+   *************************************************************************/
+
+  if (jobs != NULL)
+    for (cur_job = 0; cur_job < nu_jobs; cur_job++)
+      {
+        free (jobs[cur_job].sums);
+        free (jobs[cur_job].hits);
+      }
+
+  free (jobs);
+  free (threads);
+  free (elements);
+  free (numerator);
+  nnet_cbook_destroy (&codebook);
+
+  return exit_status;
+}
+
+
+
+/*
+ * nnet_som_schedule_width
+ *
+ * Width function of the training schedule: the neighborhood width
+ */
+static RValue
+nnet_som_schedule_width (void *data, const RValue time)
+{
+  return nnet_som_ngb_width ((NgbFunction) data, time);
+}
+
+
+
+/*
+ * nnet_som_train_step
+ *
+ * Trains the element at the given step of the epoch, with the learning
+ * rate and neighborhood width of the step when they decay along the epoch
+ */
+static int
+nnet_som_train_step (SomNNetwork som_nnet, const TElement element,
+                     const RValue * etha, const RValue * width,
+                     const ElementIndex step)
+{
+  SomAttributes somatt;         /* SOM attributes */
+
+
+  somatt = (SomAttributes) som_nnet->attr;
+
+  /* Per epoch decay: the width is already set */
+  if (somatt->schedule->epoch_steps == 1)
+    return nnet_som_train_element (som_nnet, element, etha[0]);
+
+  if (step >= somatt->schedule->epoch_steps)
+    return error_failure ("nnet_som_train_step",
+                          "step %ld out of the epoch schedule\n", step);
+
+  nnet_som_ngb_set_width (somatt->ngb_function, width[step]);
+
+  return nnet_som_train_element (som_nnet, element, etha[step]);
+}
+
+
+
 /*
  * nnet_som_train_set
  *
  * Executes one training pass through all the elements in the given
- * training set
+ * training set, using the SOM training algorithm selected in the
+ * attributes. Online passes follow the set's training order, if any, or
+ * read the elements from the set's stream.
+ * The learning rate and the neighborhood width come from a schedule of
+ * the whole horizon, created on the first pass and when the time is reset.
  */
 int
 nnet_som_train_set (SomNNetwork som_nnet,
@@ -842,12 +1911,16 @@ nnet_som_train_set (SomNNetwork som_nnet,
                     const size_t progress_width,
                     const char progress_character)
 {
-  static DTime t = 0;           /* current training time */
   TElement element = NULL;      /* current element */
+  ElementIndex position;        /* current training order position */
+  ElementIndex step;            /* current epoch step */
+  ElementIndex epoch_steps;     /* schedule steps in each epoch */
   SomAttributes somatt = NULL;  /* SOM attributes */
-  LRateFunction lfunc = NULL;   /* learning rate function */
+  TSchedule schedule = NULL;    /* training schedule */
   NgbFunction nfunc = NULL;     /* neighborhood function */
-  RValue etha = 0.0;            /* current learning rate */
+  const RValue *etha = NULL;    /* learning rates of the epoch */
+  const RValue *width = NULL;   /* neighborhood widths of the epoch */
+  DTime t;                      /* current training time */
 
 
   /* Checks if the network was actually passed */
@@ -863,9 +1936,19 @@ nnet_som_train_set (SomNNetwork som_nnet,
       return error_failure ("nnet_som_train_set", "no training set passed\n");
     }
 
+  /* Initialization */
+  somatt = (SomAttributes) som_nnet->attr;
+  nfunc = somatt->ngb_function;
+
+  /* The weights are about to change */
+  if (nnet_som_release_codebook (som_nnet) != EXIT_SUCCESS)
+    return EXIT_FAILURE;
+
   /* Checks if internal time should be reset */
   if (reset_time == TRUE)
-    t = first_epoch;
+    somatt->time = first_epoch;
+
+  t = somatt->time;
 
   /* Checks if the maximum epochs has been reached */
   if (t >= max_epochs)
@@ -874,13 +1957,49 @@ nnet_som_train_set (SomNNetwork som_nnet,
                             "maximum epochs (%ld) reached\n", max_epochs);
     }
 
-  /* Initialization */
-  somatt = (SomAttributes) som_nnet->attr;
-  lfunc = somatt->lrate_function;
-  nfunc = somatt->ngb_function;
+  /* Batch map epochs need all the elements at once */
+  if (somatt->som_algorithm == SOM_BATCH && training_set->stream != NULL)
+    {
+      return error_failure ("nnet_som_train_set",
+                            "batch map needs an in-memory training set\n");
+    }
+
+  /* Online epochs may decay after each element */
+  epoch_steps = 1;
+
+  if (somatt->step_decay == TRUE && somatt->som_algorithm == SOM_ONLINE)
+    epoch_steps = training_set->stream != NULL ?
+      training_set->stream->nu_elements : training_set->nu_elements;
+
+  if (epoch_steps == 0)
+    epoch_steps = 1;
+
+  /* Schedules the whole horizon, once */
+  schedule = somatt->schedule;
+
+  if (schedule != NULL &&
+      (reset_time == TRUE || schedule->first_epoch != first_epoch ||
+       schedule->max_epochs != max_epochs ||
+       schedule->epoch_steps != epoch_steps ||
+       schedule->lrate_function != somatt->lrate_function ||
+       schedule->width_data != (void *) nfunc))
+    nnet_train_schedule_destroy (&(somatt->schedule));
+
+  if (somatt->schedule == NULL &&
+      error_if_null (somatt->schedule = nnet_train_schedule_create
+                     (somatt->lrate_function, nnet_som_schedule_width,
+                      nfunc, first_epoch, max_epochs, epoch_steps),
+                     "nnet_som_train_set",
+                     "error creating training schedule\n"))
+    return EXIT_FAILURE;
+
+  schedule = somatt->schedule;
 
-  /* Calculates the current learning rate */
-  etha = nnet_train_lrate_value (lfunc, (RValue) t);
+  /* Learning rates and widths of the current epoch */
+  if (error_if_failure (nnet_train_schedule_epoch (schedule, t, &etha, &width),
+                        "nnet_som_train_set",
+                        "error reading training schedule\n"))
+    return EXIT_FAILURE;
 
   /* Updates time in neighborhood function */
   if (error_if_failure (nnet_som_ngb_set_parameter (nfunc, 0, (RValue) t),
@@ -889,6 +2008,8 @@ nnet_som_train_set (SomNNetwork som_nnet,
       EXIT_FAILURE)
     return EXIT_FAILURE;
 
+  nnet_som_ngb_set_width (nfunc, width[0]);
+
   /* Updates progress bar */
   if (output_progress == TRUE)
     {
@@ -900,12 +2021,85 @@ nnet_som_train_set (SomNNetwork som_nnet,
         return EXIT_FAILURE;
     }
 
+  /* Streamed sets: elements are read chunk by chunk */
+  if (training_set->stream != NULL)
+    {
+      if (error_if_failure (nnet_tstream_rewind (training_set->stream, t),
+                            "nnet_som_train_set",
+                            "error rewinding training stream\n"))
+        return EXIT_FAILURE;
+
+      step = 0;
+
+      do
+        {
+          if (error_if_failure
+              (nnet_tstream_next (training_set->stream, &element),
+               "nnet_som_train_set", "error reading training stream\n"))
+            return EXIT_FAILURE;
+
+          /* Trains the current element */
+          if (element != NULL &&
+              error_if_failure (nnet_som_train_step
+                                (som_nnet, element, etha, width, step++),
+                                "nnet_som_train_set",
+                                "error training element\n") == EXIT_FAILURE)
+            return EXIT_FAILURE;
+        }
+      while (element != NULL);
+
+      somatt->time++;
+
+      return EXIT_SUCCESS;
+    }
+
+  /* Batch map: one step for the whole set */
+  if (somatt->som_algorithm == SOM_BATCH)
+    {
+      if (error_if_failure
+          (nnet_som_train_batch (som_nnet, training_set, somatt->nu_threads),
+           "nnet_som_train_set", "error executing batch map epoch\n"))
+        return EXIT_FAILURE;
+
+      somatt->time++;
+
+      return EXIT_SUCCESS;
+    }
+
+  /* Training elements loop, in a new order for each epoch */
+  if (training_set->training_order != NULL)
+    {
+      if (error_if_failure (nnet_tset_shuffle_order (training_set, t),
+                            "nnet_som_train_set",
+                            "error shuffling training order\n"))
+        return EXIT_FAILURE;
+
+      for (position = 1; position <= training_set->nu_elements; position++)
+        {
+          element = nnet_tset_order_element (training_set, position);
+
+          /* Trains the current element */
+          if (error_if_failure (nnet_som_train_step
+                                (som_nnet, element, etha, width,
+                                 position - 1), "nnet_som_train_set",
+                                "error training element\n") == EXIT_FAILURE)
+            return EXIT_FAILURE;
+        }
+
+      somatt->time++;
+
+      return EXIT_SUCCESS;
+    }
+
   /* Training elements loop */
   element = training_set->first_element;
+  step = 0;
+
   while (element != NULL)
     {
       /* Trains the current element */
-      if (error_if_failure (nnet_som_train_element (som_nnet, element, etha),
+      if (error_if_failure (nnet_som_train_step
+                            (som_nnet, element, etha, width, step++),
                             "nnet_som_train_set",
                             "error training element\n") == EXIT_FAILURE)
         return EXIT_FAILURE;
@@ -915,7 +2109,7 @@ nnet_som_train_set (SomNNetwork som_nnet,
     }
 
   /* Increment time and epoch counters */
-  t++;
+  somatt->time++;
 
   return EXIT_SUCCESS;
 }
@@ -1,7 +1,9 @@
 #ifndef __NNET_SOM_H_
 #define __NNET_SOM_H_ 1
 
+#include <pthread.h>
 #include "../nnet_types.h"
+#include "../nnet_cbindex.h"
 #include "nnet_som_ngb.h"
 
 /******************************************************************************
@@ -10,17 +12,59 @@
  *                                                                            *
  ******************************************************************************/
 
+/*
+ * SomAlgorithmType
+ *
+ * SOM Training Algorithm Class
+ * - SOM_ONLINE: Kohonen's sequential rule, weights updated after each element
+ * - SOM_BATCH: batch map, prototypes recomputed once per epoch as the
+ *   neighborhood-weighted mean of the elements won by each unit
+ */
+typedef enum
+{
+  SOM_ONLINE = 0,
+  SOM_BATCH = 1
+}
+SomAlgorithmType;
+
+
+
 /*
  * nnet_som_type
  *
  * Extends the NNetwork type to include SOM-specific attributes:
  * - neighborhood function
  * - learning rate function
+ * - SOM training algorithm
+ * - number of threads used by the parallel operations
+ * - codebook search index used by the batch and set operations
+ * - codebook of the propagation functions and its search index, built
+ *   once for the current weights and released when they are trained, with
+ *   the lock guarding them, the number of propagations using them and the
+ *   condition signalled when there are none left
+ * - winner tracking flag for the propagation of ordered sets
+ * - learning rate and neighborhood width schedule of the training, and
+ *   whether they decay along each online epoch or once per epoch
+ * - current training time
  */
 typedef struct
 {
   NgbFunction ngb_function;
   LRateFunction lrate_function;
+  SomAlgorithmType som_algorithm;
+  UsIntValue nu_threads;
+  CodebookIndexType index_type;
+  DTime index_rebuild_epochs;
+  CodebookIndex cb_index;
+  Codebook inference_cbook;
+  CodebookIndex inference_index;
+  pthread_mutex_t inference_lock;
+  UsIntValue inference_users;
+  pthread_cond_t inference_idle;
+  BoolValue track_winners;
+  TSchedule schedule;
+  BoolValue step_decay;
+  DTime time;
 }
 nnet_som_attr_type;
 
@@ -31,6 +75,16 @@ typedef NExtension SomNNetwork;
 
 
 
+/*
+ * SomStateFunction
+ *
+ * Receives the winner unit index (state) of each propagated element, in
+ * order
+ */
+typedef int (*SomStateFunction) (void *arg, const UnitIndex state);
+
+
+
 /******************************************************************************
  *                                                                            *
  *                             PUBLIC OPERATIONS                              *
@@ -80,6 +134,88 @@ nnet_som_create_nnetwork (SomNNetwork som_nnet,
 
 
 
+/*
+ * nnet_som_set_algorithm
+ *
+ * Selects the training algorithm and the number of threads used by
+ * nnet_som_train_set and nnet_som_propagate_set
+ */
+extern int
+nnet_som_set_algorithm (SomNNetwork som_nnet,
+                        const SomAlgorithmType som_algorithm,
+                        const UsIntValue nu_threads);
+
+
+
+/*
+ * nnet_som_set_index
+ *
+ * Selects the search index used to find the winners in batch training
+ * and in nnet_som_propagate_set. During batch training the index is
+ * rebuilt every 'rebuild_epochs' epochs (0: never) and refreshed in the
+ * others. Online training always compares every unit, since its weights
+ * change after each element.
+ */
+extern int
+nnet_som_set_index (SomNNetwork som_nnet,
+                    const CodebookIndexType index_type,
+                    const DTime rebuild_epochs);
+
+
+
+/*
+ * nnet_som_set_tracking
+ *
+ * Enables or disables winner tracking in nnet_som_propagate_set: the
+ * search for each element starts at the grid neighborhood of the previous
+ * element's winner, which is much cheaper over sets that keep the frames
+ * of an utterance in temporal order. Results are the same either way.
+ */
+extern int
+nnet_som_set_tracking (SomNNetwork som_nnet, const BoolValue track_winners);
+
+
+
+/*
+ * nnet_som_fix_codebook
+ *
+ * Sets the codebook searched by the propagation functions: the given one,
+ * which the SOM then owns (e.g. a mapped model's, see nnet_bin_codebook),
+ * or a snapshot of the output layer weights if NULL. Its column order,
+ * search index and grid are built at once, as selected in the attributes
+ * (codebooks with no units have no grid, so their winners are searched
+ * without tracking). Otherwise the codebook is built on the first
+ * propagation after each training. The previous codebook is replaced once
+ * the propagations using it are over.
+ */
+extern int nnet_som_fix_codebook (SomNNetwork som_nnet, Codebook codebook);
+
+
+
+/*
+ * nnet_som_release_codebook
+ *
+ * Releases the codebook of the propagation functions, once the
+ * propagations using it are over. It is built anew from the output layer
+ * weights on the next propagation. Set and batch training release it;
+ * callers that change the weights by other means (including
+ * nnet_som_train_element) must too.
+ */
+extern int nnet_som_release_codebook (SomNNetwork som_nnet);
+
+
+
+/*
+ * nnet_som_set_step_decay
+ *
+ * Makes the learning rate and the neighborhood width decay after each
+ * element of the online epochs, instead of once per epoch
+ */
+extern int
+nnet_som_set_step_decay (SomNNetwork som_nnet, const BoolValue step_decay);
+
+
+
 /*
  * nnet_som_destroy
  *
@@ -119,18 +255,75 @@ nnet_som_propagate_element (const SomNNetwork som_nnet,
 /*
  * nnet_som_propagate_set
  *
- * Loads and propagates all elements in the given set, returning a list
- * of winner indexes
+ * Propagates all elements in the given set, returning a list of winner
+ * indexes. The winners are searched on the fixed codebook (see
+ * nnet_som_fix_codebook), split among the threads set in the attributes,
+ * so the activations and outputs of the network units are left untouched.
+ * Several propagations may run at once, each holding the codebook until
+ * it is done, but nobody may train the network meanwhile.
  */
 extern Vector
 nnet_som_propagate_set (const SomNNetwork som_nnet, const TSet set);
 
 
 
+/*
+ * nnet_som_propagate_states
+ *
+ * Propagates all elements in the given set in order, passing the index
+ * of each winner unit to 'state_function' as soon as it is found, with
+ * no list of winners in between. The winners are the same
+ * nnet_som_propagate_set finds, searched by the calling thread alone.
+ */
+extern int
+nnet_som_propagate_states (const SomNNetwork som_nnet, const TSet set,
+                           const SomStateFunction state_function, void *arg);
+
+
+
+/*
+ * nnet_som_index_recall
+ *
+ * Compares the winners found through the selected search index with the
+ * exact ones for the given set, returning the fraction of matches and the
+ * mean number of distances computed per element
+ */
+extern int
+nnet_som_index_recall (const SomNNetwork som_nnet, const TSet set,
+                       RValue * recall, RValue * mean_evaluations);
+
+
+
+/*
+ * nnet_som_tracking_cost
+ *
+ * Returns the mean number of full distance computations per element that
+ * winner tracking costs over the given set, in its current order
+ */
+extern int
+nnet_som_tracking_cost (const SomNNetwork som_nnet, const TSet set,
+                        RValue * mean_distances);
+
+
+
+/*
+ * nnet_som_quantization_error
+ *
+ * Returns the mean euclidean distance between the elements of the given
+ * set and their winner units' weights, searching the winners like
+ * nnet_som_propagate_set does, with the threads set in the attributes
+ */
+extern int
+nnet_som_quantization_error (const SomNNetwork som_nnet, const TSet set,
+                             RValue * error);
+
+
+
 /*
  * nnet_som_train_element
  *
- * Executes training for one element
+ * Executes training for one element. The propagation codebook is left
+ * alone: release it once done (see nnet_som_release_codebook).
  */
 extern int
 nnet_som_train_element (SomNNetwork som_nnet,
@@ -138,11 +331,26 @@ nnet_som_train_element (SomNNetwork som_nnet,
 
 
 
+/*
+ * nnet_som_train_batch
+ *
+ * Executes one batch map epoch over the given training set: winners are
+ * determined for all elements in parallel and each prototype is then
+ * replaced by the neighborhood-weighted mean of the elements
+ */
+extern int
+nnet_som_train_batch (SomNNetwork som_nnet, const TSet training_set,
+                      const UsIntValue nu_threads);
+
+
+
 /*
  * nnet_som_train_set
  *
  * Executes one training pass through all the elements in the given
- * training set
+ * training set, using the SOM training algorithm selected in the
+ * attributes. Online passes follow the set's training order, if any, or
+ * read the elements from the set's stream (see nnet_tset_create_streamed).
  */
 extern int
 nnet_som_train_set (SomNNetwork som_nnet,
@@ -20,43 +20,59 @@
  */
 
 /*
- * nnet_som_rctngb
+ * nnet_som_ngb_width_at
  *
- * Rectangular neighborhood function
+ * Width of the neighborhood at the given time, from the parameters
+ * shared by all the neighborhood functions
  */
 static RValue
-nnet_som_rctngb (const RValue distance,
-                 const RFunctionParameters nnet_ngb_par)
+nnet_som_ngb_width_at (const RFunctionParameters nnet_ngb_par,
+                       const RValue time)
 {
-  RValue retval, w_0, w, T1;
-  DTime t;
-  static DTime last_t = 0;
-  static RValue last_w = 0.0;
-  static RValue last_T1 = 0.0;
+  return nnet_ngb_par[1] * exp (-time / nnet_ngb_par[2]);
+}
 
 
-  /* Initialization */
-  t = (DTime) nnet_ngb_par[0];
-  w_0 = nnet_ngb_par[1];
-  T1 = nnet_ngb_par[2];
 
-  /* Static variables */
-  if (t != last_t || fabs (T1 - last_T1) > DBL_EPSILON)
+/*
+ * nnet_som_ngb_kernel
+ *
+ * Neighborhood function of the given type, at the given distance from
+ * the winner, for a neighborhood of the given width
+ */
+static RValue
+nnet_som_ngb_kernel (const RFunctionType type, const RValue distance,
+                     const RValue width)
+{
+  switch (type)
     {
-      /* Recalculate variance */
-      w = w_0 * exp (-(RValue) t / T1);
+    case NNET_SOM_NGB_RECTANGLE:
+      return (RValue)
+        (distance > width - DBL_EPSILON
+         || distance < -width + DBL_EPSILON ? 0.0 : 1.0);
 
-      /* Update the statics */
-      last_t = t;
-      last_w = w;
-      last_T1 = T1;
+    case NNET_SOM_NGB_GAUSSIAN:
+      return (RValue) exp (-sqr (distance) / (2.0 * sqr (width)));
+
+    default:
+      return 0.0;
     }
+}
 
-  retval = (RValue)
-    (distance > last_w - DBL_EPSILON
-     || distance < -last_w + DBL_EPSILON ? 0.0 : 1.0);
 
-  return retval;
+
+/*
+ * nnet_som_rctngb
+ *
+ * Rectangular neighborhood function
+ */
+static RValue
+nnet_som_rctngb (const RValue distance,
+                 const RFunctionParameters nnet_ngb_par)
+{
+  return nnet_som_ngb_kernel
+    (NNET_SOM_NGB_RECTANGLE, distance,
+     nnet_som_ngb_width_at (nnet_ngb_par, (RValue) (DTime) nnet_ngb_par[0]));
 }
 
 
@@ -70,32 +86,9 @@ static RValue
 nnet_som_gssngb (const RValue distance,
                  const RFunctionParameters nnet_ngb_par)
 {
-  RValue retval, r_0, r, T1;
-  DTime t;
-  static DTime last_t = 0;
-  static RValue last_r = 0.0;
-  static RValue last_T1 = 0.0;
-
-  /* Initialization */
-  t = (DTime) nnet_ngb_par[0];
-  r_0 = nnet_ngb_par[1];
-  T1 = nnet_ngb_par[2];
-
-  /* Static variables */
-  if (t != last_t || fabs (T1 - last_T1) > DBL_EPSILON)
-    {
-      /* Recalculate variance */
-      r = r_0 * exp (-((RValue) t) / T1);
-
-      /* Update the statics */
-      last_t = t;
-      last_r = r;
-      last_T1 = T1;
-    }
-
-  retval = (RValue) exp (-sqr (distance) / (2.0 * sqr (last_r)));
-
-  return retval;
+  return nnet_som_ngb_kernel
+    (NNET_SOM_NGB_GAUSSIAN, distance,
+     nnet_som_ngb_width_at (nnet_ngb_par, (RValue) (DTime) nnet_ngb_par[0]));
 }
 
 
@@ -247,6 +240,11 @@ nnet_som_ngb_create_function (const NgbFunctionClass ngb_class,
       return NULL;
     }
 
+  /* Width at the default time */
+  new_function->width = nnet_som_ngb_width (new_function,
+                                            new_function->function->
+                                            parameters[0]);
+
   /* If the parameter vector was passed, sets it */
   if (parameters != NULL)
     {
@@ -300,7 +298,8 @@ nnet_som_ngb_destroy_function (NgbFunction * function)
 /*
  * nnet_som_ngb_value
  *
- * Evaluates the neighborhood function between the two given vectors
+ * Evaluates the neighborhood function between the two given vectors, for
+ * the current neighborhood width
  */
 int
 nnet_som_ngb_value (const NgbFunction function,
@@ -336,7 +335,9 @@ nnet_som_ngb_value (const NgbFunction function,
     }
 
   /* Calculates the value of the neighborhood function */
-  neighborhood = function_value (function->function, distance);
+  neighborhood = nnet_som_ngb_kernel
+    (function->function->function_class->function_type, distance,
+     function->width);
 
   *value = neighborhood;
 
@@ -377,6 +378,10 @@ nnet_som_ngb_set_parameter (NgbFunction function,
       return EXIT_FAILURE;
     }
 
+  /* The width follows the time and the width parameters */
+  function->width =
+    nnet_som_ngb_width (function, function->function->parameters[0]);
+
   return EXIT_SUCCESS;
 }
 
@@ -421,6 +426,47 @@ nnet_som_ngb_set_parameter_vector (NgbFunction function,
       return EXIT_FAILURE;
     }
 
+  /* The width follows the time and the width parameters */
+  function->width =
+    nnet_som_ngb_width (function, function->function->parameters[0]);
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_som_ngb_width
+ *
+ * Returns the width of the neighborhood at the given (possibly
+ * fractional) time, according to the function parameters
+ */
+RValue
+nnet_som_ngb_width (const NgbFunction function, const RValue time)
+{
+  return nnet_som_ngb_width_at (function->function->parameters, time);
+}
+
+
+
+/*
+ * nnet_som_ngb_set_width
+ *
+ * Sets the width of the neighborhood evaluated by nnet_som_ngb_value,
+ * until the next change of the function parameters
+ */
+int
+nnet_som_ngb_set_width (NgbFunction function, const RValue width)
+{
+  /* Checks if the function was actually passed */
+  if (function == NULL)
+    {
+      fprintf (stderr, "nnet_som_ngb_set_width: no function passed\n");
+      return EXIT_FAILURE;
+    }
+
+  function->width = width;
+
   return EXIT_SUCCESS;
 }
 
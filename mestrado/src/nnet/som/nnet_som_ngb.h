@@ -46,12 +46,14 @@ typedef nnet_som_ngb_class_type *NgbFunctionClass;
 /*
  * NgbFunction
  *
- * Neighborhood Functions between two vectors
+ * Neighborhood Functions between two vectors, evaluated for the current
+ * neighborhood width
  */
 typedef struct
 {
   NgbFunctionClass function_class;
   RFunction function;
+  RValue width;
 }
 nnet_som_ngb_function_type;
 
@@ -142,7 +144,8 @@ extern int nnet_som_ngb_destroy_function (NgbFunction * function);
 /*
  * nnet_som_ngb_value
  *
- * Evaluates the neighborhood function between the two given vectors
+ * Evaluates the neighborhood function between the two given vectors, for
+ * the current neighborhood width
  */
 extern int
 nnet_som_ngb_value (const NgbFunction function,
@@ -173,6 +176,27 @@ nnet_som_ngb_set_parameter_vector (NgbFunction function,
 
 
 
+/*
+ * nnet_som_ngb_width
+ *
+ * Returns the width of the neighborhood at the given (possibly
+ * fractional) time, according to the function parameters
+ */
+extern RValue
+nnet_som_ngb_width (const NgbFunction function, const RValue time);
+
+
+
+/*
+ * nnet_som_ngb_set_width
+ *
+ * Sets the width of the neighborhood evaluated by nnet_som_ngb_value,
+ * until the next change of the function parameters
+ */
+extern int nnet_som_ngb_set_width (NgbFunction function, const RValue width);
+
+
+
 /*
  * nnet_som_ngb_function_info
  *
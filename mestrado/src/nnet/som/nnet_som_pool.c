@@ -0,0 +1,272 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "nnet_som_pool.h"
+#include "nnet_som.h"
+#include "../../errorh/errorh.h"
+#include "../nnet_types.h"
+#include "../nnet_sets.h"
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                             PRIVATE DATATYPES                              *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * nnet_som_pool_type
+ *
+ * Jobs being trained by a pool of threads. Thread i trains the jobs from
+ * next[i] to end[i] - 1, from the start; the other threads take the jobs
+ * left at the end of its range.
+ */
+typedef struct
+{
+  nnet_som_job_type *jobs;      /* jobs to train */
+  UsIntValue nu_workers;        /* number of threads */
+  UsIntValue *next;             /* next job of each thread's range */
+  UsIntValue *end;              /* end of each thread's range */
+  pthread_mutex_t lock;         /* protects the ranges */
+  pthread_mutex_t report_lock;  /* serializes job_done and its status */
+  SomJobFunction job_done;      /* called as each job finishes */
+  void *arg;                    /* job_done argument */
+  int status;                   /* job_done status */
+}
+nnet_som_pool_type;
+
+
+
+/*
+ * nnet_som_worker_type
+ *
+ * One thread of a pool
+ */
+typedef struct
+{
+  nnet_som_pool_type *pool;     /* pool of the thread */
+  UsIntValue worker;            /* index of the thread */
+}
+nnet_som_worker_type;
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                             PRIVATE OPERATIONS                             *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * nnet_som_pool_train_job
+ *
+ * Trains the network of one job for all its epochs
+ */
+static int
+nnet_som_pool_train_job (nnet_som_job_type * job)
+{
+  DTime epoch;                  /* current epoch */
+
+
+  for (epoch = 0; epoch < job->max_epochs; epoch++)
+    if (error_if_failure
+        (nnet_som_train_set (job->som_nnet, job->training_set, 0,
+                             job->max_epochs, epoch == 0 ? TRUE : FALSE,
+                             FALSE, 0, ' '), "nnet_som_pool_train_job",
+         "error executing training epoch %ld\n", epoch))
+      return EXIT_FAILURE;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * nnet_som_pool_take
+ *
+ * Takes the next job of the given thread's range or, when it is over,
+ * the last job of the largest range left. Returns FALSE if there are no
+ * jobs left.
+ */
+static BoolValue
+nnet_som_pool_take (nnet_som_pool_type * pool, const UsIntValue worker,
+                    UsIntValue * job_index)
+{
+  UsIntValue cur_worker;        /* current thread */
+  UsIntValue victim;            /* thread with the largest range */
+  UsIntValue left = 0;          /* jobs left in the largest range */
+  BoolValue found = TRUE;       /* flag: job taken */
+
+
+  pthread_mutex_lock (&pool->lock);
+
+  if (pool->next[worker] < pool->end[worker])
+    *job_index = pool->next[worker]++;
+  else
+    {
+      victim = worker;
+
+      for (cur_worker = 0; cur_worker < pool->nu_workers; cur_worker++)
+        if (pool->end[cur_worker] - pool->next[cur_worker] > left)
+          {
+            victim = cur_worker;
+            left = pool->end[cur_worker] - pool->next[cur_worker];
+          }
+
+      if (left > 0)
+        *job_index = --pool->end[victim];
+      else
+        found = FALSE;
+    }
+
+  pthread_mutex_unlock (&pool->lock);
+
+  return found;
+}
+
+
+
+/*
+ * nnet_som_pool_worker
+ *
+ * Trains jobs until there are none left
+ */
+static void *
+nnet_som_pool_worker (void *arg)
+{
+  nnet_som_worker_type *worker = (nnet_som_worker_type *) arg;
+  nnet_som_pool_type *pool = worker->pool;
+  nnet_som_job_type *job;       /* job being trained */
+  UsIntValue job_index;         /* index of the job */
+
+
+  while (nnet_som_pool_take (pool, worker->worker, &job_index) == TRUE)
+    {
+      job = &(pool->jobs[job_index]);
+      job->status = nnet_som_pool_train_job (job);
+
+      /* Reports the trained network; the others may take jobs meanwhile */
+      if (job->status == EXIT_SUCCESS && pool->job_done != NULL)
+        {
+          pthread_mutex_lock (&pool->report_lock);
+
+          if (pool->job_done (pool->arg, job_index) != EXIT_SUCCESS)
+            pool->status = EXIT_FAILURE;
+
+          pthread_mutex_unlock (&pool->report_lock);
+        }
+    }
+
+  return arg;
+}
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                              PUBLIC OPERATIONS                             *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * nnet_som_pool_train
+ *
+ * Trains the networks of the given jobs on a pool of 'nu_threads' threads
+ */
+int
+nnet_som_pool_train (nnet_som_job_type * jobs, const UsIntValue nu_jobs,
+                     const UsIntValue nu_threads,
+                     const SomJobFunction job_done, void *arg)
+{
+  nnet_som_pool_type pool;      /* jobs being trained */
+  nnet_som_worker_type *workers = NULL; /* thread arguments */
+  pthread_t *threads = NULL;    /* pool threads */
+  UsIntValue nu_started = 0;    /* threads started */
+  UsIntValue cur_worker;        /* current thread */
+  UsIntValue cur_job;           /* current job */
+  int exit_status = EXIT_SUCCESS;       /* auxiliary function return status */
+
+
+  /* Checks if the jobs were actually passed */
+  if (jobs == NULL && nu_jobs > 0)
+    return error_failure ("nnet_som_pool_train", "no jobs passed\n");
+
+  if (nu_threads == 0)
+    return error_failure ("nnet_som_pool_train",
+                          "at least one thread is required\n");
+
+  if (nu_jobs == 0)
+    return EXIT_SUCCESS;
+
+  for (cur_job = 0; cur_job < nu_jobs; cur_job++)
+    jobs[cur_job].status = EXIT_FAILURE;
+
+  /* Splits the jobs in consecutive ranges, one per thread */
+  pool.jobs = jobs;
+  pool.nu_workers = (nu_threads < nu_jobs) ? nu_threads : nu_jobs;
+  pool.job_done = job_done;
+  pool.arg = arg;
+  pool.status = EXIT_SUCCESS;
+
+  pool.next = (UsIntValue *) malloc (pool.nu_workers * sizeof (UsIntValue));
+  pool.end = (UsIntValue *) malloc (pool.nu_workers * sizeof (UsIntValue));
+  workers = (nnet_som_worker_type *)
+    malloc (pool.nu_workers * sizeof (nnet_som_worker_type));
+  threads = (pthread_t *) malloc (pool.nu_workers * sizeof (pthread_t));
+
+  if (pool.next == NULL || pool.end == NULL || workers == NULL ||
+      threads == NULL)
+    {
+      free (pool.next);
+      free (pool.end);
+      free (workers);
+      free (threads);
+      return error_failure ("nnet_som_pool_train",
+                            "virtual memory exhausted\n");
+    }
+
+  for (cur_worker = 0; cur_worker < pool.nu_workers; cur_worker++)
+    {
+      pool.next[cur_worker] = nu_jobs * cur_worker / pool.nu_workers;
+      pool.end[cur_worker] = nu_jobs * (cur_worker + 1) / pool.nu_workers;
+      workers[cur_worker].pool = &pool;
+      workers[cur_worker].worker = cur_worker;
+    }
+
+  pthread_mutex_init (&pool.lock, NULL);
+  pthread_mutex_init (&pool.report_lock, NULL);
+
+  /* The single thread is the calling one; threads that fail to start
+     leave their ranges to the others */
+  if (pool.nu_workers > 1)
+    for (nu_started = 0; nu_started < pool.nu_workers; nu_started++)
+      if (pthread_create (&threads[nu_started], NULL, nnet_som_pool_worker,
+                          &workers[nu_started]) != 0)
+        break;
+
+  /* Without threads the jobs are trained here */
+  if (nu_started == 0)
+    nnet_som_pool_worker (&workers[0]);
+
+  for (cur_worker = 0; cur_worker < nu_started; cur_worker++)
+    pthread_join (threads[cur_worker], NULL);
+
+  pthread_mutex_destroy (&pool.lock);
+  pthread_mutex_destroy (&pool.report_lock);
+
+  /* Checks the status of all the jobs */
+  for (cur_job = 0; cur_job < nu_jobs; cur_job++)
+    if (jobs[cur_job].status != EXIT_SUCCESS)
+      exit_status = EXIT_FAILURE;
+
+  if (pool.status != EXIT_SUCCESS)
+    exit_status = EXIT_FAILURE;
+
+  free (pool.next);
+  free (pool.end);
+  free (workers);
+  free (threads);
+
+  return exit_status;
+}
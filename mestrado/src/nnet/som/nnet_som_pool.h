@@ -0,0 +1,70 @@
+#ifndef __NNET_SOM_POOL_H_
+#define __NNET_SOM_POOL_H_ 1
+
+#include "../nnet_types.h"
+#include "nnet_som.h"
+
+/******************************************************************************
+ *                                                                            *
+ *                        PUBLIC DATATYPES AND VARIABLES                      *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * nnet_som_job_type
+ *
+ * One network trained by a pool: the network, the set it is trained on
+ * and the number of epochs. Jobs that train on the same elements should
+ * be given views of one set (see nnet_tset_create_view), each with its
+ * own training order, since the pool trains them at the same time.
+ * The pool stores the training status of the job in 'status'.
+ */
+typedef struct
+{
+  SomNNetwork som_nnet;         /* network to train */
+  TSet training_set;            /* training set or view */
+  DTime max_epochs;             /* training epochs */
+  int status;                   /* training status */
+}
+nnet_som_job_type;
+
+
+/* Symbolic type */
+typedef nnet_som_job_type *SomJob;
+
+
+
+/*
+ * SomJobFunction
+ *
+ * Called by the pool as each job is successfully trained, one call at a
+ * time, with the argument passed to the pool and the index of the job
+ */
+typedef int (*SomJobFunction) (void *arg, const UsIntValue job_index);
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                             PUBLIC OPERATIONS                              *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * nnet_som_pool_train
+ *
+ * Trains the networks of the given jobs on a pool of 'nu_threads'
+ * threads. Each thread owns a range of consecutive jobs, trained from its
+ * start, and takes jobs from the end of the largest range left when its
+ * own range is over, so jobs sharing a set should be consecutive. The
+ * given function, if any, is called as each job finishes. Fails if any job
+ * or call fails; the status of each job tells which.
+ */
+extern int
+nnet_som_pool_train (nnet_som_job_type * jobs, const UsIntValue nu_jobs,
+                     const UsIntValue nu_threads,
+                     const SomJobFunction job_done, void *arg);
+
+
+
+#endif /* __NNET_SOM_POOL_H_ */
@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include "errorh/errorh.h"
+#include "nnet/nnet_types.h"
+#include "nnet/nnet_nnet.h"
+#include "nnet/nnet_files.h"
+#include "nnet/nnet_files_nnet.h"
+#include "nnet/nnet_files_bin.h"
+#include "inparse/inparse.h"
+
+#ifdef __PROG_NAME_
+#undef __PROG_NAME_
+#endif
+#define __PROG_NAME_ "nnet_conv"
+
+
+void
+usage (void)
+{
+  puts ("");
+  puts ("Usage: nnet_conv [-i | --input <file>]");
+  puts ("                 [-o | --output <file>]");
+  puts ("                 [-h | --help]\n");
+  puts ("Options are:\n");
+  puts ("  -i | --input   input neural network file name");
+  puts ("  -o | --output  output neural network file name");
+  puts ("  -h | --help    outputs this help message and exit\n");
+  puts ("Text configuration files are converted to binary models and");
+  puts ("binary models to text configuration files. LVQ networks are");
+  puts ("written to text without their extension.\n");
+
+  return;
+}
+
+
+
+int
+main (int argc, char **argv)
+{
+  char *in_file = NULL;                     /* input network file name */
+  char *out_file = NULL;                    /* output network file name */
+  FILE *in_fd = NULL;                       /* input network file */
+  FILE *out_fd = NULL;                      /* output network file */
+  NNetwork nnet = NULL;                     /* converted network */
+  NNetModel model = NULL;                   /* mapped binary model */
+  BoolValue bin_input = FALSE;              /* flag: binary input */
+
+
+  /* command line parameters */
+  InputParameterSet pset = {
+    {"-h", "--help", BOOL, FALSE, FALSE,
+     {.boolvalue = FALSE}},
+    {"-i", "--input", STRING, FALSE, FALSE,
+     {.stringvalue = (char *) NULL}},
+    {"-o", "--output", STRING, FALSE, FALSE,
+     {.stringvalue = (char *) NULL}},
+  };
+
+  InputParameterList plist = { 3, pset };
+
+
+  /* Parses the command line */
+  if (error_if_failure (inpr_parse (argc, argv, plist), __PROG_NAME_,
+                        "error parsing command line\n"))
+    {
+      usage ();
+      return EXIT_FAILURE;
+    }
+
+  /* Usage request */
+  if (plist.parameter[0].passed == TRUE)
+    {
+      usage ();
+      return EXIT_SUCCESS;
+    }
+
+  in_file = plist.parameter[1].value.stringvalue;
+  out_file = plist.parameter[2].value.stringvalue;
+
+  if (in_file == NULL)
+    return error_failure (__PROG_NAME_, "no input file passed\n");
+
+  if (out_file == NULL)
+    return error_failure (__PROG_NAME_, "no output file passed\n");
+
+  /* Reads the input network */
+  bin_input = nnet_bin_is_model (in_file);
+
+  if (bin_input == TRUE)
+    {
+      if (error_if_null (model = nnet_bin_map (in_file), __PROG_NAME_,
+                         "error mapping binary model '%s'\n", in_file))
+        return EXIT_FAILURE;
+
+      nnet = nnet_bin_create_nnetwork (model);
+
+      if (error_if_failure (nnet_bin_unmap (&model), __PROG_NAME_,
+                            "error unmapping binary model '%s'\n", in_file))
+        return EXIT_FAILURE;
+    }
+  else
+    {
+      if (error_if_null (in_fd = fopen (in_file, "r"),
+                         __PROG_NAME_, strerror (errno)))
+        return EXIT_FAILURE;
+
+      nnet = nnet_file_create_nnetwork (in_fd);
+      fclose (in_fd);
+    }
+
+  if (error_if_null (nnet, __PROG_NAME_,
+                     "error creating neural network using file '%s'\n",
+                     in_file))
+    return EXIT_FAILURE;
+
+  /* Writes the output network in the other format */
+  if (bin_input == TRUE)
+    {
+      if (error_if_null (out_fd = fopen (out_file, "w"),
+                         __PROG_NAME_, strerror (errno)))
+        return EXIT_FAILURE;
+
+      nnet_file_write_nnetwork (nnet, TRUE, TRUE, TRUE, TRUE, TRUE, out_fd);
+
+      if (fclose (out_fd) != 0)
+        return error_failure (__PROG_NAME_, "error writing '%s': %s\n",
+                              out_file, strerror (errno));
+    }
+  else
+    {
+      if (error_if_failure (nnet_bin_write_nnetwork (nnet, out_file),
+                            __PROG_NAME_, "error writing binary model '%s'\n",
+                            out_file))
+        return EXIT_FAILURE;
+    }
+
+  if (error_if_failure
+      (nnet_nnetwork_destroy (&nnet, TRUE, TRUE, TRUE, TRUE),
+       __PROG_NAME_, "error destroying neural network\n"))
+    return EXIT_FAILURE;
+
+  return EXIT_SUCCESS;
+}
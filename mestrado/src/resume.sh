@@ -5,7 +5,8 @@ nice -15 \
 -md data/speech_db/trmaps/ \
 --train \
 --max-epochs 1000 \
---initial-epoch 500 \
+--resume \
 --save-epochs 50 \
+--binary-output \
 -on data/networks/som50.test.net \
--in data/networks/som50.t500.net
+-in data/networks/som50.test.t500.net
@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "errorh/errorh.h"
+#include "ftrxtr/s_smptypes.h"
+#include "ftrxtr/s_samples.h"
+#include "ftrxtr/s_cepstrum.h"
+#include "nnet/nnet_types.h"
+#include "nnet/nnet_sets.h"
+#include "vector/vector.h"
+#include "som_mfcc.h"
+
+
+
+/*
+ * som_mfcc_set
+ *
+ * Creates a training set with one element per MFCC list of the given
+ * index, regularized as the sets read from '.mfcc' files by som_vq are
+ */
+TSet
+som_mfcc_set (const index_list_type mfcc_index, const UnitIndex input_dim,
+              const char *source)
+{
+  index_entry_type cur_entry;               /* current frame */
+  smp_num_samples cur_sample;               /* current coefficient */
+  cmp_complex value;                        /* coefficient value */
+  TSet set = NULL;                          /* new training set */
+  Vector input = NULL;                      /* current element input */
+  int exit_status = EXIT_SUCCESS;           /* auxiliary function return status */
+
+
+  if (error_if_null
+      (set = nnet_tset_create (NULL, input_dim, 0), "som_mfcc_set",
+       "error creating training set\n"))
+    return NULL;
+
+  /* one element per frame */
+  for (cur_entry = mfcc_index.head;
+       cur_entry != NULL && exit_status == EXIT_SUCCESS;
+       cur_entry = cur_entry->next)
+    {
+      if (cur_entry->list->samples != input_dim)
+        {
+          exit_status =
+            error_failure ("som_mfcc_set",
+                           "'%s' has %ld coefficients per frame; the network takes %ld\n",
+                           source, cur_entry->list->samples, input_dim);
+          break;
+        }
+
+      if (error_if_null (input = vector_create (input_dim), "som_mfcc_set",
+                         "error creating element input\n"))
+        {
+          exit_status = EXIT_FAILURE;
+          break;
+        }
+
+      /* sample lists start at 1 */
+      for (cur_sample = 1; cur_sample <= input_dim; cur_sample++)
+        {
+          get_list_value (*(cur_entry->list), cur_sample, &value);
+          input->value[cur_sample - 1] = value.re;
+        }
+
+      if (error_if_null
+          (nnet_tset_element_create (set, NULL, input, NULL, FALSE, FALSE,
+                                     FALSE), "som_mfcc_set",
+           "error creating training element\n"))
+        {
+          vector_destroy (&input);
+          exit_status = EXIT_FAILURE;
+        }
+    }
+
+  if (exit_status == EXIT_SUCCESS)
+    exit_status = nnet_tset_prepare (set, TRUE, TRUE, FALSE);
+
+  if (exit_status != EXIT_SUCCESS)
+    nnet_tset_destroy (&set, TRUE);
+
+  return set;
+}
+
+
+
+/*
+ * som_mfcc_set_from_wav
+ *
+ * Extracts the MFCC's of the given WAV file into a new training set
+ */
+TSet
+som_mfcc_set_from_wav (const char *wav_file, const scep_parameter_type param,
+                       const UnitIndex input_dim)
+{
+  index_list_type file_index;               /* signal of the input file */
+  index_list_type mfcc_index;               /* MFCC lists */
+  TSet set = NULL;                          /* new training set */
+
+
+  if (error_if_failure (create_index (&file_index, NULL),
+                        "som_mfcc_set_from_wav",
+                        "error creating file index\n"))
+    return NULL;
+
+  if (error_if_failure
+      (scep_mfcc_file (wav_file, param, &file_index, &mfcc_index),
+       "som_mfcc_set_from_wav", "error extracting MFCC's from '%s'\n",
+       wav_file))
+    {
+      destroy_index (&file_index);
+      return NULL;
+    }
+
+  destroy_index (&file_index);
+
+  set = som_mfcc_set (mfcc_index, input_dim, wav_file);
+
+  destroy_index (&mfcc_index);
+
+  return set;
+}
+
+
+
+/*
+ * som_mfcc_set_from_samples
+ *
+ * Extracts the MFCC's of the given signal samples into a new training set
+ */
+TSet
+som_mfcc_set_from_samples (const cmp_real * samples,
+                           const smp_num_samples nu_samples,
+                           const cmp_real samples_per_second,
+                           const scep_parameter_type param,
+                           const UnitIndex input_dim)
+{
+  index_list_type mfcc_index;               /* MFCC lists */
+  TSet set = NULL;                          /* new training set */
+
+
+  if (error_if_failure
+      (scep_mfcc_samples (samples, nu_samples, samples_per_second, param,
+                          &mfcc_index), "som_mfcc_set_from_samples",
+       "error extracting MFCC's from %ld samples\n", nu_samples))
+    return NULL;
+
+  set = som_mfcc_set (mfcc_index, input_dim, "samples");
+
+  destroy_index (&mfcc_index);
+
+  return set;
+}
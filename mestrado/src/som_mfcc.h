@@ -0,0 +1,47 @@
+#ifndef __SOM_MFCC_H_
+#define __SOM_MFCC_H_ 1
+
+#include "common/types.h"
+#include "ftrxtr/s_smptypes.h"
+#include "ftrxtr/s_cepstrum.h"
+#include "nnet/nnet_types.h"
+
+/*
+ * som_mfcc_set
+ *
+ * Creates a training set with one element per MFCC list of the given
+ * index, regularized as the sets read from '.mfcc' files by som_vq are.
+ * 'source' names the signal in error messages.
+ */
+extern TSet
+som_mfcc_set (const index_list_type mfcc_index, const UnitIndex input_dim,
+              const char *source);
+
+
+
+/*
+ * som_mfcc_set_from_wav
+ *
+ * Extracts the MFCC's of the given WAV file into a new training set
+ */
+extern TSet
+som_mfcc_set_from_wav (const char *wav_file, const scep_parameter_type param,
+                       const UnitIndex input_dim);
+
+
+
+/*
+ * som_mfcc_set_from_samples
+ *
+ * Extracts the MFCC's of the given signal samples into a new training set
+ */
+extern TSet
+som_mfcc_set_from_samples (const cmp_real * samples,
+                           const smp_num_samples nu_samples,
+                           const cmp_real samples_per_second,
+                           const scep_parameter_type param,
+                           const UnitIndex input_dim);
+
+
+
+#endif /* __SOM_MFCC_H_ */
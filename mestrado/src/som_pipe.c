@@ -0,0 +1,926 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <pthread.h>
+#include "errorh/errorh.h"
+#include "strutils/strutils.h"
+#include "ftrxtr/s_smptypes.h"
+#include "ftrxtr/s_cepstrum.h"
+#include "nnet/som/nnet_som.h"
+#include "nnet/nnet_types.h"
+#include "nnet/nnet_nnet.h"
+#include "nnet/nnet_sets.h"
+#include "nnet/nnet_cbindex.h"
+#include "nnet/nnet_files_nnet.h"
+#include "nnet/nnet_files_bin.h"
+#include "vector/vector.h"
+#include "matrix/matrix.h"
+#include "trmap/trmap.h"
+#include "trmap/trmap_sparse.h"
+#include "trmap/trmap_score.h"
+#include "trmap/trmap_accum.h"
+#include "inparse/inparse.h"
+#include "som_mfcc.h"
+
+#ifdef __PROG_NAME_
+#undef __PROG_NAME_
+#endif
+#define __PROG_NAME_ "som_pipe"
+
+
+
+/*
+ * pipe_item_type
+ *
+ * One input file on its way through the pipeline: the training set of
+ * its MFCC frames, then its transition map and the closest speakers
+ */
+typedef struct
+{
+  char *wav_file;                           /* input WAV file */
+  int status;                               /* EXIT_FAILURE: item failed */
+  TSet set;                                 /* MFCC frames */
+  TMAccumulator accum;                      /* transition map */
+  UsLgIntValue *speaker_ids;                /* closest speakers */
+  RValue *scores;                           /* their distances */
+  UsLgIntValue nu_results;                  /* speakers returned */
+}
+pipe_item_type;
+
+typedef pipe_item_type *PipeItem;
+
+
+
+/*
+ * pipe_queue_type
+ *
+ * Bounded queue of items between two stages. Producers block while the
+ * queue is full; consumers block while it is empty and some producer is
+ * still running. Each producer closes the queue once when it is done.
+ */
+typedef struct
+{
+  PipeItem *items;                          /* circular item buffer */
+  UsIntValue capacity;                      /* buffer size */
+  UsIntValue head;                          /* first item */
+  UsIntValue count;                         /* items queued */
+  UsIntValue nu_producers;                  /* producers still running */
+  pthread_mutex_t lock;                     /* queue lock */
+  pthread_cond_t not_empty;                 /* signaled on push and close */
+  pthread_cond_t not_full;                  /* signaled on pop */
+}
+pipe_queue_type;
+
+typedef pipe_queue_type *PipeQueue;
+
+
+
+/*
+ * extract_context_type
+ *
+ * Feature extraction stage: the extractor threads take the next WAV file
+ * of the list, turn it into a training set and push it downstream
+ */
+typedef struct
+{
+  char **wav_files;                         /* input WAV files */
+  UsIntValue nu_files;                      /* number of files */
+  UsIntValue next_file;                     /* next file to extract */
+  pthread_mutex_t lock;                     /* next file and failures lock */
+  UsIntValue nu_failed;                     /* files left out */
+  scep_parameter_type param;                /* MFCC parameters */
+  UnitIndex input_dim;                      /* coefficients per frame */
+  PipeQueue out;                            /* extracted sets */
+}
+extract_context_type;
+
+
+
+/*
+ * propagate_context_type
+ *
+ * Propagation stage: the sets are propagated through the network, their
+ * winners accumulated into transition maps and the maps scored
+ */
+typedef struct
+{
+  SomNNetwork som_nnet;                     /* SOM network */
+  UnitIndex output_dim;                     /* number of states */
+  BoolValue sparse;                         /* sparse transition maps */
+  TMScorer scorer;                          /* reference maps, or NULL */
+  UsLgIntValue k;                           /* speakers returned */
+  PipeQueue in;                             /* extracted sets */
+  PipeQueue out;                            /* finished maps */
+}
+propagate_context_type;
+
+
+
+void
+usage (void)
+{
+  puts ("");
+  puts ("Usage: som_pipe -in | --input-network <file>");
+  puts ("                -il | --input-list <file>");
+  puts ("                [-md | --map-dir <directory>]");
+  puts ("                [-sm | --sparse-maps]");
+  puts ("                [-rl | --reference-list <file>]");
+  puts ("                [-mt | --metric <l1|chi2|kl>]");
+  puts ("                [-sw | --smoothing <number>]");
+  puts ("                [-k  | --best <number>]");
+  puts ("                [-th | --threads <number>]");
+  puts ("                [-qs | --queue-size <number>]");
+  puts ("                [-ix | --index <linear|vptree|graph>]");
+  puts ("                [-tw | --track-winners]");
+  puts ("                [-h  | --help]\n");
+  puts ("Options are:\n");
+  puts ("  -in | --input-network   input neural network file name (text");
+  puts ("                          configuration or binary model)");
+  puts ("  -il | --input-list      file containing list of WAV file names");
+  puts ("  -md | --map-dir         output directory for the transition maps");
+  puts ("                          (one '.map' file per WAV file)");
+  puts ("  -sm | --sparse-maps     write the transition maps in sparse form");
+  puts ("  -rl | --reference-list  score each map against the reference");
+  puts ("                          maps of the given list: two lines per");
+  puts ("                          speaker, its id and its map file (dense");
+  puts ("                          or sparse)");
+  puts ("  -mt | --metric          scoring distance: l1 (default), chi2 or");
+  puts ("                          kl");
+  puts ("  -sw | --smoothing       count added to every transition when");
+  puts ("                          scoring (default 1.0)");
+  puts ("  -k  | --best            closest speakers reported (default 1)");
+  puts ("  -th | --threads         feature extraction threads");
+  puts ("  -qs | --queue-size      files held between two stages");
+  puts ("                          (default 4)");
+  puts ("  -ix | --index           winner search index: linear (default),");
+  puts ("                          vptree or graph (approximate)");
+  puts ("  -tw | --track-winners   start each state search at the previous");
+  puts ("                          state's grid neighborhood");
+  puts ("  -h  | --help            outputs this help message and exit\n");
+  puts ("The WAV files are turned into MFCC frames, states and transition");
+  puts ("maps in memory, each stage on its own threads, with no");
+  puts ("intermediate files.\n");
+
+  return;
+}
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                                PIPELINE ITEMS                              *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * pipe_item_create
+ *
+ * Creates the item of the given WAV file
+ */
+PipeItem
+pipe_item_create (char *wav_file)
+{
+  PipeItem new_item;                        /* new item */
+
+
+  if (error_if_null
+      (new_item = (PipeItem) malloc (sizeof (pipe_item_type)),
+       "pipe_item_create", "virtual memory exhausted\n"))
+    return NULL;
+
+  new_item->wav_file = wav_file;
+  new_item->status = EXIT_SUCCESS;
+  new_item->set = NULL;
+  new_item->accum = NULL;
+  new_item->speaker_ids = NULL;
+  new_item->scores = NULL;
+  new_item->nu_results = 0;
+
+  return new_item;
+}
+
+
+
+/*
+ * pipe_item_destroy
+ *
+ * Destroys the given item and whatever it still holds
+ */
+void
+pipe_item_destroy (PipeItem * item)
+{
+  if (item == NULL || *item == NULL)
+    return;
+
+  if ((*item)->set != NULL)
+    nnet_tset_destroy (&((*item)->set), TRUE);
+
+  if ((*item)->accum != NULL)
+    trmap_accum_destroy (&((*item)->accum));
+
+  free ((*item)->speaker_ids);
+  free ((*item)->scores);
+  free (*item);
+  *item = NULL;
+
+  return;
+}
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                                BOUNDED QUEUES                              *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * pipe_queue_create
+ *
+ * Creates an empty queue of the given capacity, fed by the given number
+ * of producers
+ */
+PipeQueue
+pipe_queue_create (const UsIntValue capacity, const UsIntValue nu_producers)
+{
+  PipeQueue new_queue;                      /* new queue */
+
+
+  if (error_if_null
+      (new_queue = (PipeQueue) malloc (sizeof (pipe_queue_type)),
+       "pipe_queue_create", "virtual memory exhausted\n"))
+    return NULL;
+
+  if (error_if_null
+      (new_queue->items = (PipeItem *) malloc (capacity * sizeof (PipeItem)),
+       "pipe_queue_create", "virtual memory exhausted\n"))
+    {
+      free (new_queue);
+      return NULL;
+    }
+
+  new_queue->capacity = capacity;
+  new_queue->head = 0;
+  new_queue->count = 0;
+  new_queue->nu_producers = nu_producers;
+
+  pthread_mutex_init (&(new_queue->lock), NULL);
+  pthread_cond_init (&(new_queue->not_empty), NULL);
+  pthread_cond_init (&(new_queue->not_full), NULL);
+
+  return new_queue;
+}
+
+
+
+/*
+ * pipe_queue_destroy
+ *
+ * Destroys the given queue and the items left in it
+ */
+void
+pipe_queue_destroy (PipeQueue * queue)
+{
+  if (queue == NULL || *queue == NULL)
+    return;
+
+  while ((*queue)->count > 0)
+    {
+      pipe_item_destroy (&((*queue)->items[(*queue)->head]));
+      (*queue)->head = ((*queue)->head + 1) % (*queue)->capacity;
+      (*queue)->count--;
+    }
+
+  pthread_mutex_destroy (&((*queue)->lock));
+  pthread_cond_destroy (&((*queue)->not_empty));
+  pthread_cond_destroy (&((*queue)->not_full));
+
+  free ((*queue)->items);
+  free (*queue);
+  *queue = NULL;
+
+  return;
+}
+
+
+
+/*
+ * pipe_queue_push
+ *
+ * Appends the given item to the queue, waiting for room
+ */
+void
+pipe_queue_push (PipeQueue queue, PipeItem item)
+{
+  pthread_mutex_lock (&(queue->lock));
+
+  while (queue->count == queue->capacity)
+    pthread_cond_wait (&(queue->not_full), &(queue->lock));
+
+  queue->items[(queue->head + queue->count) % queue->capacity] = item;
+  queue->count++;
+
+  pthread_cond_signal (&(queue->not_empty));
+  pthread_mutex_unlock (&(queue->lock));
+
+  return;
+}
+
+
+
+/*
+ * pipe_queue_pop
+ *
+ * Removes the first item of the queue, waiting for one. Returns NULL
+ * once the queue is empty and all its producers are done.
+ */
+PipeItem
+pipe_queue_pop (PipeQueue queue)
+{
+  PipeItem item = NULL;                     /* first item */
+
+
+  pthread_mutex_lock (&(queue->lock));
+
+  while (queue->count == 0 && queue->nu_producers > 0)
+    pthread_cond_wait (&(queue->not_empty), &(queue->lock));
+
+  if (queue->count > 0)
+    {
+      item = queue->items[queue->head];
+      queue->head = (queue->head + 1) % queue->capacity;
+      queue->count--;
+
+      pthread_cond_signal (&(queue->not_full));
+    }
+
+  pthread_mutex_unlock (&(queue->lock));
+
+  return item;
+}
+
+
+
+/*
+ * pipe_queue_close
+ *
+ * Tells the queue that one of its producers is done
+ */
+void
+pipe_queue_close (PipeQueue queue)
+{
+  pthread_mutex_lock (&(queue->lock));
+
+  queue->nu_producers--;
+
+  pthread_cond_broadcast (&(queue->not_empty));
+  pthread_mutex_unlock (&(queue->lock));
+
+  return;
+}
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                                    STAGES                                  *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * extract_thread
+ *
+ * Extracts the next WAV file of the list until none is left
+ */
+void *
+extract_thread (void *arg)
+{
+  extract_context_type *ctx = (extract_context_type *) arg;
+  UsIntValue cur_file;                      /* file taken */
+  PipeItem item;                            /* its item */
+
+
+  while (TRUE)
+    {
+      pthread_mutex_lock (&(ctx->lock));
+      cur_file = ctx->next_file++;
+      pthread_mutex_unlock (&(ctx->lock));
+
+      if (cur_file >= ctx->nu_files)
+        break;
+
+      /* The file is left out, but the others are still extracted */
+      if ((item = pipe_item_create (ctx->wav_files[cur_file])) == NULL)
+        {
+          error_failure ("extract_thread", "error processing '%s'\n",
+                         ctx->wav_files[cur_file]);
+
+          pthread_mutex_lock (&(ctx->lock));
+          ctx->nu_failed++;
+          pthread_mutex_unlock (&(ctx->lock));
+          continue;
+        }
+
+      item->set = som_mfcc_set_from_wav (item->wav_file, ctx->param,
+                                         ctx->input_dim);
+
+      if (item->set == NULL)
+        item->status = EXIT_FAILURE;
+
+      pipe_queue_push (ctx->out, item);
+    }
+
+  pipe_queue_close (ctx->out);
+
+  return NULL;
+}
+
+
+
+/*
+ * accumulate_state
+ *
+ * Registers each winner found by nnet_som_propagate_states in the
+ * transition map accumulator
+ */
+int
+accumulate_state (void *arg, const UnitIndex state)
+{
+  return trmap_accum_state ((TMAccumulator) arg, (TMState) state);
+}
+
+
+
+/*
+ * propagate_item
+ *
+ * Builds the transition map of the item's set and scores it against the
+ * references, if any. Sparse maps are compacted and scored in dense form.
+ */
+int
+propagate_item (const propagate_context_type * ctx, PipeItem item)
+{
+  TransitionMap query = NULL;               /* dense map scored */
+  int exit_status;                          /* auxiliary function return status */
+
+
+  if (error_if_null
+      (item->accum = trmap_accum_create (ctx->output_dim, ctx->sparse),
+       "propagate_item", "error creating state transition map\n"))
+    return EXIT_FAILURE;
+
+  if (error_if_failure
+      (nnet_som_propagate_states (ctx->som_nnet, item->set, accumulate_state,
+                                  item->accum), "propagate_item",
+       "error propagating '%s'\n", item->wav_file))
+    return EXIT_FAILURE;
+
+  /* the frames are no longer needed */
+  nnet_tset_destroy (&(item->set), TRUE);
+
+  if (ctx->sparse == TRUE &&
+      error_if_failure (trmap_sparse_compact (item->accum->sparse_map),
+                        "propagate_item", "error compacting map\n"))
+    return EXIT_FAILURE;
+
+  if (ctx->scorer == NULL)
+    return EXIT_SUCCESS;
+
+  item->speaker_ids =
+    (UsLgIntValue *) malloc (ctx->k * sizeof (UsLgIntValue));
+  item->scores = (RValue *) malloc (ctx->k * sizeof (RValue));
+
+  if (item->speaker_ids == NULL || item->scores == NULL)
+    return error_failure ("propagate_item", "virtual memory exhausted\n");
+
+  if (ctx->sparse == TRUE)
+    {
+      if (error_if_null
+          (query = trmap_sparse_to_dense (item->accum->sparse_map),
+           "propagate_item", "error expanding map\n"))
+        return EXIT_FAILURE;
+    }
+  else
+    query = item->accum->map;
+
+  exit_status = trmap_scorer_score (ctx->scorer, query, ctx->k,
+                                    item->speaker_ids, item->scores,
+                                    &(item->nu_results));
+
+  if (query != item->accum->map)
+    trmap_destroy (&query);
+
+  return exit_status;
+}
+
+
+
+/*
+ * propagate_thread
+ *
+ * Turns the extracted sets into transition maps until the extractors are
+ * done
+ */
+void *
+propagate_thread (void *arg)
+{
+  propagate_context_type *ctx = (propagate_context_type *) arg;
+  PipeItem item;                            /* current item */
+
+
+  while ((item = pipe_queue_pop (ctx->in)) != NULL)
+    {
+      if (item->status == EXIT_SUCCESS)
+        item->status = propagate_item (ctx, item);
+
+      pipe_queue_push (ctx->out, item);
+    }
+
+  pipe_queue_close (ctx->out);
+
+  return NULL;
+}
+
+
+
+/*
+ * write_item
+ *
+ * Writes the transition map of the item to the map directory, if given,
+ * and prints its closest speakers
+ */
+int
+write_item (const PipeItem item, const char *tm_dir)
+{
+  char *tm_file = NULL;                     /* map file name */
+  FILE *out_fd = NULL;                      /* map file */
+  UsLgIntValue cur_result;                  /* current speaker */
+  int exit_status = EXIT_SUCCESS;           /* auxiliary function return status */
+
+
+  if (tm_dir != NULL)
+    {
+      if (error_if_null
+          (tm_file = get_file_name (tm_dir, item->wav_file, ".map"),
+           "write_item", "error defining map file name\n"))
+        return EXIT_FAILURE;
+
+      if ((out_fd = fopen (tm_file, "w")) == NULL)
+        exit_status = error_failure ("write_item",
+                                     "error creating map file '%s': %s\n",
+                                     tm_file, strerror (errno));
+      else
+        {
+          if (item->accum->sparse_map != NULL)
+            exit_status = trmap_sparse_write (item->accum->sparse_map,
+                                              out_fd);
+          else
+            matrix_raw_info (item->accum->map, out_fd);
+
+          fclose (out_fd);
+        }
+
+      free (tm_file);
+    }
+
+  if (exit_status == EXIT_SUCCESS && item->scores != NULL)
+    {
+      printf ("%s:", item->wav_file);
+
+      for (cur_result = 0; cur_result < item->nu_results; cur_result++)
+        printf (" %lu (%f)", item->speaker_ids[cur_result],
+                item->scores[cur_result]);
+
+      printf ("\n");
+      fflush (stdout);
+    }
+
+  return exit_status;
+}
+
+
+
+int
+main (int argc, char **argv)
+{
+  char *net_file = NULL;                    /* neural network file name */
+  char *inlist_file = NULL;                 /* input WAV list */
+  char *tm_dir = NULL;                      /* map output directory */
+  char *ref_file = NULL;                    /* reference map list */
+  char **wav_files = NULL;                  /* input WAV files */
+  UsIntValue nu_files = 0;                  /* number of WAV files */
+
+  FILE *net_fd = NULL;                      /* input network file descriptor */
+  NNetwork nnet = NULL;                     /* neural network created */
+  NNetModel model = NULL;                   /* mapped binary model */
+  SomNNetwork som_nnet = NULL;              /* SOM extension */
+  Codebook codebook = NULL;                 /* codebook of the mapping */
+  UnitIndex input_dim;                      /* input layer dimension */
+  UnitIndex output_dim;                     /* output layer dimension */
+
+  BoolValue smap_flag = FALSE;              /* flag: sparse transition maps */
+  TMScoreMetric metric = TMSCORE_L1;        /* scoring distance */
+  RValue smoothing = 1.0;                   /* scoring smoothing count */
+  UsLgIntValue k = 1;                       /* closest speakers reported */
+  UsIntValue nu_threads = 1;                /* extraction threads */
+  UsIntValue queue_size = 4;                /* files between stages */
+  CodebookIndexType idx_type = CBIDX_LINEAR;    /* winner search index */
+  BoolValue trk_flag = FALSE;               /* flag: track winners */
+  TMScorer scorer = NULL;                   /* reference maps */
+
+  extract_context_type ext_ctx;             /* extraction stage */
+  propagate_context_type prp_ctx;           /* propagation stage */
+  PipeQueue sets_queue = NULL;              /* extracted sets */
+  PipeQueue maps_queue = NULL;              /* finished maps */
+  pthread_t *ext_threads = NULL;            /* extraction threads */
+  pthread_t prp_thread;                     /* propagation thread */
+  UsIntValue cur_thread;                    /* current thread */
+  PipeItem item = NULL;                     /* finished item */
+  UsIntValue nu_failed = 0;                 /* files that failed */
+
+
+  /* command line parameters */
+  InputParameterSet pset = {
+    {"-h", "--help", BOOL, FALSE, FALSE,
+     {.boolvalue = FALSE}},
+    {"-in", "--input-network", STRING, FALSE, FALSE,
+     {.stringvalue = (char *) NULL}},
+    {"-il", "--input-list", STRING, FALSE, FALSE,
+     {.stringvalue = (char *) NULL}},
+    {"-md", "--map-dir", STRING, FALSE, FALSE,
+     {.stringvalue = (char *) NULL}},
+    {"-sm", "--sparse-maps", BOOL, FALSE, FALSE,
+     {.boolvalue = FALSE}},
+    {"-rl", "--reference-list", STRING, FALSE, FALSE,
+     {.stringvalue = (char *) NULL}},
+    {"-mt", "--metric", STRING, FALSE, FALSE,
+     {.stringvalue = "l1"}},
+    {"-sw", "--smoothing", REAL, FALSE, FALSE,
+     {.realvalue = 1.0}},
+    {"-k", "--best", UNSIGNED_LONG_INT, FALSE, FALSE,
+     {.uslgintvalue = 1}},
+    {"-th", "--threads", UNSIGNED_LONG_INT, FALSE, FALSE,
+     {.uslgintvalue = 1}},
+    {"-qs", "--queue-size", UNSIGNED_LONG_INT, FALSE, FALSE,
+     {.uslgintvalue = 4}},
+    {"-ix", "--index", STRING, FALSE, FALSE,
+     {.stringvalue = "linear"}},
+    {"-tw", "--track-winners", BOOL, FALSE, FALSE,
+     {.boolvalue = FALSE}},
+  };
+
+  InputParameterList plist = { 13, pset };
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                                 PARAMETERS                                 *
+ *                                                                            *
+ ******************************************************************************/
+
+  /* Parses the command line */
+  if (error_if_failure (inpr_parse (argc, argv, plist), __PROG_NAME_,
+                        "error parsing command line\n"))
+    {
+      usage ();
+      return EXIT_FAILURE;
+    }
+
+  /* Usage request */
+  if (plist.parameter[0].passed == TRUE)
+    {
+      usage ();
+      return EXIT_SUCCESS;
+    }
+
+  net_file = plist.parameter[1].value.stringvalue;
+  inlist_file = plist.parameter[2].value.stringvalue;
+  tm_dir = plist.parameter[3].value.stringvalue;
+  smap_flag = plist.parameter[4].value.boolvalue;
+  ref_file = plist.parameter[5].value.stringvalue;
+  smoothing = plist.parameter[7].value.realvalue;
+  k = plist.parameter[8].value.uslgintvalue;
+  nu_threads = (UsIntValue) plist.parameter[9].value.uslgintvalue;
+  queue_size = (UsIntValue) plist.parameter[10].value.uslgintvalue;
+  trk_flag = plist.parameter[12].value.boolvalue;
+
+  if (net_file == NULL || inlist_file == NULL)
+    {
+      usage ();
+      return error_failure (__PROG_NAME_,
+                            "input network and input list required\n");
+    }
+
+  if (tm_dir == NULL && ref_file == NULL)
+    return error_failure (__PROG_NAME_,
+                          "nothing to do: no map directory or reference list\n");
+
+  if (error_if_failure
+      (trmap_score_metric_by_name (plist.parameter[6].value.stringvalue,
+                                   &metric), __PROG_NAME_,
+       "unknown metric '%s'\n", plist.parameter[6].value.stringvalue))
+    return EXIT_FAILURE;
+
+  if (error_if_failure
+      (nnet_cbidx_type_by_name (plist.parameter[11].value.stringvalue,
+                                &idx_type), __PROG_NAME_,
+       "unknown winner search index '%s'\n",
+       plist.parameter[11].value.stringvalue))
+    return EXIT_FAILURE;
+
+  if (k == 0 || nu_threads == 0 || queue_size == 0)
+    return error_failure (__PROG_NAME_,
+                          "best speakers, threads and queue size must be positive\n");
+
+  if (error_if_failure
+      (nnet_tset_read_file_list (inlist_file, &wav_files, &nu_files),
+       __PROG_NAME_, "error reading input list '%s'\n", inlist_file))
+    return EXIT_FAILURE;
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                           NEURAL NETWORK CREATION                          *
+ *                                                                            *
+ ******************************************************************************/
+
+  /* Creates the network by the configuration file or binary model */
+  if (nnet_bin_is_model (net_file) == TRUE)
+    {
+      if (error_if_null (model = nnet_bin_map (net_file), __PROG_NAME_,
+                         "error mapping binary model '%s'\n", net_file))
+        return EXIT_FAILURE;
+
+      nnet = nnet_bin_create_nnetwork (model);
+
+      /* The winners are searched on the mapped weights, if they can be */
+      if (nnet == NULL ||
+          model->layers[model->header->nu_layers - 1].monotone != TRUE)
+        nnet_bin_unmap (&model);
+    }
+  else
+    {
+      if ((net_fd = fopen (net_file, "r")) == NULL)
+        return error_failure (__PROG_NAME_, "error opening '%s': %s\n",
+                              net_file, strerror (errno));
+
+      nnet = nnet_file_create_nnetwork (net_fd);
+      fclose (net_fd);
+    }
+
+  if (error_if_null
+      (nnet, __PROG_NAME_,
+       "error creating neural network using file '%s'\n", net_file))
+    return EXIT_FAILURE;
+
+  if (nnet->extension == NULL || nnet->extension->index != NNEXT_SOM)
+    return error_failure (__PROG_NAME_, "network in file '%s' is not a SOM\n",
+                          net_file);
+
+  som_nnet = (SomNNetwork) nnet->extension;
+  input_dim = nnet->first_layer->nu_units;
+  output_dim = nnet->last_layer->nu_units;
+
+  if (error_if_failure
+      (nnet_som_set_index (som_nnet, idx_type, 0), __PROG_NAME_,
+       "error selecting winner search index\n"))
+    return EXIT_FAILURE;
+
+  if (error_if_failure
+      (nnet_som_set_tracking (som_nnet, trk_flag), __PROG_NAME_,
+       "error selecting winner tracking\n"))
+    return EXIT_FAILURE;
+
+  /* Codebook and search index shared by all the files */
+  if (model != NULL &&
+      error_if_null (codebook = nnet_bin_codebook (model,
+                                                   model->header->nu_layers),
+                     __PROG_NAME_, "error creating codebook of model '%s'\n",
+                     net_file))
+    return EXIT_FAILURE;
+
+  if (error_if_failure
+      (nnet_som_fix_codebook (som_nnet, codebook), __PROG_NAME_,
+       "error building codebook of model '%s'\n", net_file))
+    return EXIT_FAILURE;
+
+  /* Reference maps */
+  if (ref_file != NULL && error_if_null
+      (scorer = trmap_scorer_create_from_list (ref_file, output_dim, metric,
+                                               smoothing),
+       __PROG_NAME_, "error reading reference list '%s'\n", ref_file))
+    return EXIT_FAILURE;
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                                   PIPELINE                                 *
+ *                                                                            *
+ ******************************************************************************/
+
+  if (error_if_null
+      (sets_queue = pipe_queue_create (queue_size, nu_threads),
+       __PROG_NAME_, "error creating queue\n"))
+    return EXIT_FAILURE;
+
+  if (error_if_null
+      (maps_queue = pipe_queue_create (queue_size, 1), __PROG_NAME_,
+       "error creating queue\n"))
+    return EXIT_FAILURE;
+
+  if (error_if_null
+      (ext_threads = (pthread_t *) malloc (nu_threads * sizeof (pthread_t)),
+       __PROG_NAME_, "virtual memory exhausted\n"))
+    return EXIT_FAILURE;
+
+  ext_ctx.wav_files = wav_files;
+  ext_ctx.nu_files = nu_files;
+  ext_ctx.next_file = 0;
+  ext_ctx.nu_failed = 0;
+  pthread_mutex_init (&(ext_ctx.lock), NULL);
+  scep_default_parameters (&(ext_ctx.param));
+  ext_ctx.input_dim = input_dim;
+  ext_ctx.out = sets_queue;
+
+  prp_ctx.som_nnet = som_nnet;
+  prp_ctx.output_dim = output_dim;
+  prp_ctx.sparse = smap_flag;
+  prp_ctx.scorer = scorer;
+  prp_ctx.k = k;
+  prp_ctx.in = sets_queue;
+  prp_ctx.out = maps_queue;
+
+  /* Extraction and propagation threads */
+  for (cur_thread = 0; cur_thread < nu_threads; cur_thread++)
+    if (pthread_create (&(ext_threads[cur_thread]), NULL, extract_thread,
+                        &ext_ctx) != 0)
+      return error_failure (__PROG_NAME_,
+                            "error creating extraction thread\n");
+
+  if (pthread_create (&prp_thread, NULL, propagate_thread, &prp_ctx) != 0)
+    return error_failure (__PROG_NAME_,
+                          "error creating propagation thread\n");
+
+  /* Writes the maps and scores as they are finished */
+  while ((item = pipe_queue_pop (maps_queue)) != NULL)
+    {
+      if (item->status != EXIT_SUCCESS ||
+          write_item (item, tm_dir) != EXIT_SUCCESS)
+        {
+          error_failure (__PROG_NAME_, "error processing '%s'\n",
+                         item->wav_file);
+          nu_failed++;
+        }
+
+      pipe_item_destroy (&item);
+    }
+
+  for (cur_thread = 0; cur_thread < nu_threads; cur_thread++)
+    pthread_join (ext_threads[cur_thread], NULL);
+
+  pthread_join (prp_thread, NULL);
+
+  nu_failed += ext_ctx.nu_failed;
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                                FINALIZATION                                *
+ *                                                                            *
+ ******************************************************************************/
+
+  pthread_mutex_destroy (&(ext_ctx.lock));
+  free (ext_threads);
+  pipe_queue_destroy (&sets_queue);
+  pipe_queue_destroy (&maps_queue);
+
+  if (scorer != NULL)
+    trmap_scorer_destroy (&scorer);
+
+  if (nu_failed > 0)
+    error_failure (__PROG_NAME_, "%u of %u files failed\n", nu_failed,
+                   nu_files);
+
+  nnet_tset_free_file_list (&wav_files, &nu_files);
+
+  if (error_if_failure
+      (nnet_nnetwork_destroy (&nnet, TRUE, TRUE, TRUE, TRUE),
+       __PROG_NAME_, "error destroying SOM network\n"))
+    return EXIT_FAILURE;
+
+  /* The codebook went with the network: the mapping may go now */
+  if (model != NULL &&
+      error_if_failure (nnet_bin_unmap (&model), __PROG_NAME_,
+                        "error unmapping binary model\n"))
+    return EXIT_FAILURE;
+
+  if (nu_failed > 0)
+    return EXIT_FAILURE;
+
+  return EXIT_SUCCESS;
+}
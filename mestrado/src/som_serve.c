@@ -0,0 +1,1328 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include "errorh/errorh.h"
+#include "strutils/strutils.h"
+#include "ftrxtr/s_smptypes.h"
+#include "ftrxtr/s_cepstrum.h"
+#include "nnet/som/nnet_som.h"
+#include "nnet/nnet_types.h"
+#include "nnet/nnet_nnet.h"
+#include "nnet/nnet_sets.h"
+#include "nnet/nnet_cbindex.h"
+#include "nnet/nnet_files_nnet.h"
+#include "nnet/nnet_files_bin.h"
+#include "trmap/trmap.h"
+#include "trmap/trmap_sparse.h"
+#include "trmap/trmap_score.h"
+#include "trmap/trmap_accum.h"
+#include "inparse/inparse.h"
+#include "som_mfcc.h"
+
+#ifdef __PROG_NAME_
+#undef __PROG_NAME_
+#endif
+#define __PROG_NAME_ "som_serve"
+
+#define __REQUEST_SIZE_ (FILE_NAME_SIZE + 128)
+#define __BUFFER_SIZE_ 65536
+#define __MAX_PCM_SAMPLES_ 67108864
+#define __LISTEN_BACKLOG_ 16
+#define __ACCEPT_RETRIES_ 60
+
+
+
+/*
+ * serve_model_type
+ *
+ * A network kept resident by the server, with the reference maps of its
+ * speakers, if any
+ */
+typedef struct
+{
+  char *name;                               /* name used in the requests */
+  NNetwork nnet;                            /* neural network */
+  SomNNetwork som_nnet;                     /* SOM extension */
+  NNetModel bin_model;                      /* mapping read by the
+                                               codebook, or NULL */
+  UnitIndex input_dim;                      /* input layer dimension */
+  UnitIndex output_dim;                     /* number of states */
+  TMScorer scorer;                          /* reference maps, or NULL */
+}
+serve_model_type;
+
+
+
+/*
+ * serve_context_type
+ *
+ * What the connection threads share: the listening socket, the models
+ * and the feature extraction parameters, all read only
+ */
+typedef struct
+{
+  int listen_fd;                            /* listening socket */
+  serve_model_type *models;                 /* resident models */
+  UsIntValue nu_models;                     /* number of models */
+  scep_parameter_type param;                /* MFCC parameters */
+}
+serve_context_type;
+
+
+
+/*
+ * serve_conn_type
+ *
+ * One client connection: the input read ahead of the requests and the
+ * answer being built
+ */
+typedef struct
+{
+  int fd;                                   /* connection socket */
+  char in[__BUFFER_SIZE_];                  /* input read ahead */
+  size_t in_start;                          /* first unread byte */
+  size_t in_end;                            /* end of the input read */
+  char *out;                                /* answer lines */
+  size_t out_length;                        /* answer length */
+  size_t out_capacity;                      /* answer allocation */
+  UsLgIntValue out_lines;                   /* answer lines */
+}
+serve_conn_type;
+
+
+
+/* Socket removed when the server is interrupted */
+static char *serve_socket_path = NULL;
+
+
+
+void
+usage (void)
+{
+  puts ("");
+  puts ("Usage: som_serve -so | --socket <file>");
+  puts ("                 [-ml | --model-list <file>]");
+  puts ("                 [-in | --input-network <file>]");
+  puts ("                 [-rl | --reference-list <file>]");
+  puts ("                 [-mt | --metric <l1|chi2|kl>]");
+  puts ("                 [-sw | --smoothing <number>]");
+  puts ("                 [-th | --threads <number>]");
+  puts ("                 [-ix | --index <linear|vptree|graph>]");
+  puts ("                 [-tw | --track-winners]");
+  puts ("                 [-h  | --help]\n");
+  puts ("Options are:\n");
+  puts ("  -so | --socket          Unix domain socket to listen on");
+  puts ("  -ml | --model-list      models kept resident: three lines per");
+  puts ("                          model, its name, its network file (text");
+  puts ("                          configuration or binary model) and its");
+  puts ("                          reference list, or '-' for none");
+  puts ("  -in | --input-network   network of a single model named 'default'");
+  puts ("  -rl | --reference-list  reference list of the 'default' model:");
+  puts ("                          two lines per speaker, its id and its");
+  puts ("                          map file (dense or sparse)");
+  puts ("  -mt | --metric          scoring distance: l1 (default), chi2 or");
+  puts ("                          kl");
+  puts ("  -sw | --smoothing       count added to every transition when");
+  puts ("                          scoring (default 1.0)");
+  puts ("  -th | --threads         connections served at once (default 4)");
+  puts ("  -ix | --index           winner search index: linear (default),");
+  puts ("                          vptree or graph (approximate)");
+  puts ("  -tw | --track-winners   start each state search at the previous");
+  puts ("                          state's grid neighborhood");
+  puts ("  -h  | --help            outputs this help message and exit\n");
+  puts ("Requests are lines of text:\n");
+  puts ("  models                           list the resident models");
+  puts ("  states <model> <source>          winner of each frame");
+  puts ("  map <model> <source>             sparse transition map");
+  puts ("  score <model> <k> <source>       k closest speakers");
+  puts ("  quit                             close the connection\n");
+  puts ("where <source> is one of:\n");
+  puts ("  mfcc <file>                      MFCC file, as read by som_vq");
+  puts ("  wav <file>                       WAV file");
+  puts ("  pcm <rate> <samples>             raw signal: the request line is");
+  puts ("                                   followed by <samples> signed");
+  puts ("                                   16-bit little-endian samples\n");
+  puts ("Each answer starts with 'OK <lines> <milliseconds>' and its lines,");
+  puts ("or is a single 'ERROR <message>' line. The milliseconds are the");
+  puts ("time spent on the request.\n");
+
+  return;
+}
+
+
+
+/*
+ * serve_interrupt
+ *
+ * Removes the socket and leaves, on SIGINT and SIGTERM
+ */
+void
+serve_interrupt (int signal_number)
+{
+  if (serve_socket_path != NULL)
+    unlink (serve_socket_path);
+
+  _exit (EXIT_SUCCESS);
+}
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                                    MODELS                                  *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * load_model
+ *
+ * Loads the network of a model and its reference maps, if given
+ */
+int
+load_model (serve_model_type * model, const char *name, const char *net_file,
+            const char *ref_file, const TMScoreMetric metric,
+            const RValue smoothing, const CodebookIndexType idx_type,
+            const BoolValue trk_flag)
+{
+  NNetModel bin_model = NULL;               /* mapped binary model */
+  FILE *net_fd = NULL;                      /* network file */
+  Codebook codebook = NULL;                 /* codebook of the mapping */
+
+
+  model->name = NULL;
+  model->nnet = NULL;
+  model->bin_model = NULL;
+  model->scorer = NULL;
+
+  /* The name is requested as a single word of the request line */
+  if (strlen (name) > NAME_SIZE - 1 || strpbrk (name, " \t") != NULL)
+    return error_failure ("load_model",
+                          "invalid model name '%s': at most %d characters, with no blanks\n",
+                          name, NAME_SIZE - 1);
+
+  if (error_if_null
+      (model->name = (char *) malloc (strlen (name) + 1), "load_model",
+       "virtual memory exhausted\n"))
+    return EXIT_FAILURE;
+
+  strcpy (model->name, name);
+
+  /* Creates the network by the configuration file or binary model */
+  if (nnet_bin_is_model (net_file) == TRUE)
+    {
+      if (error_if_null (bin_model = nnet_bin_map (net_file), "load_model",
+                         "error mapping binary model '%s'\n", net_file))
+        return EXIT_FAILURE;
+
+      model->nnet = nnet_bin_create_nnetwork (bin_model);
+
+      /* The winners are searched on the mapped weights, if they can be */
+      if (model->nnet != NULL &&
+          bin_model->layers[bin_model->header->nu_layers - 1].monotone ==
+          TRUE)
+        model->bin_model = bin_model;
+      else
+        nnet_bin_unmap (&bin_model);
+    }
+  else
+    {
+      if ((net_fd = fopen (net_file, "r")) == NULL)
+        return error_failure ("load_model", "error opening '%s': %s\n",
+                              net_file, strerror (errno));
+
+      model->nnet = nnet_file_create_nnetwork (net_fd);
+      fclose (net_fd);
+    }
+
+  if (error_if_null
+      (model->nnet, "load_model",
+       "error creating neural network using file '%s'\n", net_file))
+    return EXIT_FAILURE;
+
+  if (model->nnet->extension == NULL ||
+      model->nnet->extension->index != NNEXT_SOM)
+    return error_failure ("load_model",
+                          "network in file '%s' is not a SOM\n", net_file);
+
+  model->som_nnet = (SomNNetwork) model->nnet->extension;
+  model->input_dim = model->nnet->first_layer->nu_units;
+  model->output_dim = model->nnet->last_layer->nu_units;
+
+  if (error_if_failure
+      (nnet_som_set_index (model->som_nnet, idx_type, 0), "load_model",
+       "error selecting winner search index\n"))
+    return EXIT_FAILURE;
+
+  if (error_if_failure
+      (nnet_som_set_tracking (model->som_nnet, trk_flag), "load_model",
+       "error selecting winner tracking\n"))
+    return EXIT_FAILURE;
+
+  /* Codebook and search index shared by all the requests */
+  if (model->bin_model != NULL &&
+      error_if_null
+      (codebook = nnet_bin_codebook (model->bin_model,
+                                     model->bin_model->header->nu_layers),
+       "load_model", "error creating codebook of model '%s'\n", net_file))
+    return EXIT_FAILURE;
+
+  if (error_if_failure
+      (nnet_som_fix_codebook (model->som_nnet, codebook), "load_model",
+       "error building codebook of model '%s'\n", net_file))
+    return EXIT_FAILURE;
+
+  /* Reference maps */
+  if (ref_file != NULL && error_if_null
+      (model->scorer =
+       trmap_scorer_create_from_list (ref_file, model->output_dim, metric,
+                                      smoothing), "load_model",
+       "error reading reference list '%s'\n", ref_file))
+    return EXIT_FAILURE;
+
+  printf ("Model '%s': %ld inputs, %ld states, %lu speakers\n", model->name,
+          model->input_dim, model->output_dim,
+          model->scorer != NULL ? model->scorer->nu_speakers : 0);
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * unload_model
+ *
+ * Releases a model loaded by load_model
+ */
+void
+unload_model (serve_model_type * model)
+{
+  if (model->scorer != NULL)
+    trmap_scorer_destroy (&(model->scorer));
+
+  if (model->nnet != NULL)
+    nnet_nnetwork_destroy (&(model->nnet), TRUE, TRUE, TRUE, TRUE);
+
+  /* The codebook went with the network: the mapping may go now */
+  if (model->bin_model != NULL)
+    nnet_bin_unmap (&(model->bin_model));
+
+  free (model->name);
+  model->name = NULL;
+
+  return;
+}
+
+
+
+/*
+ * read_model_field
+ *
+ * Reads the next line of the model list into 'field', skipping blank
+ * lines and comments, and sets 'found' to FALSE if the list ends before
+ * one. Unlike read_valid_file_line, it keeps a last line that has no
+ * newline.
+ */
+int
+read_model_field (FILE * list_fd, char *field, BoolValue * found)
+{
+  *found = FALSE;
+
+  while (*found == FALSE &&
+         fgets (field, FILE_NAME_SIZE + 1, list_fd) != NULL)
+    {
+      if (strchr (field, '\n') == NULL && !feof (list_fd))
+        return error_failure ("read_model_field", "line too long\n");
+
+      ltrim (field);
+      strip_nl (field);
+
+      if (field[0] != '\0' && field[0] != IGNORE_TOKEN)
+        *found = TRUE;
+    }
+
+  if (ferror (list_fd))
+    return error_failure ("read_model_field", "%s\n", strerror (errno));
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * load_model_list
+ *
+ * Loads the models of the given list: three lines per model, its name,
+ * its network file and its reference list, or '-' for none
+ */
+int
+load_model_list (const char *list_file, serve_model_type ** models,
+                 UsIntValue * nu_models, const TMScoreMetric metric,
+                 const RValue smoothing, const CodebookIndexType idx_type,
+                 const BoolValue trk_flag)
+{
+  FILE *list_fd = NULL;                     /* model list file */
+  FileName fields[3];                       /* name, network, references */
+  UsIntValue nu_alloc = 0;                  /* allocated models */
+  UsIntValue cur_field;                     /* current field */
+  BoolValue found = FALSE;                  /* flag: field read */
+  serve_model_type *new_models;             /* enlarged model table */
+  int exit_status = EXIT_SUCCESS;           /* auxiliary function return status */
+
+
+  if ((list_fd = fopen (list_file, "r")) == NULL)
+    return error_failure (__PROG_NAME_, "error opening model list '%s': %s\n",
+                          list_file, strerror (errno));
+
+  while (exit_status == EXIT_SUCCESS && !feof (list_fd))
+    {
+      for (cur_field = 0; cur_field < 3; cur_field++)
+        {
+          if (error_if_failure (read_model_field
+                                (list_fd, fields[cur_field], &found),
+                                __PROG_NAME_,
+                                "error reading model list '%s'\n",
+                                list_file))
+            exit_status = EXIT_FAILURE;
+
+          if (exit_status != EXIT_SUCCESS || found == FALSE)
+            break;
+        }
+
+      if (exit_status != EXIT_SUCCESS || cur_field == 0)
+        break;
+
+      if (cur_field < 3)
+        {
+          exit_status = error_failure (__PROG_NAME_,
+                                       "incomplete model '%s' in model list '%s'\n",
+                                       fields[0], list_file);
+          break;
+        }
+
+      /* grows the table */
+      if (*nu_models == nu_alloc)
+        {
+          nu_alloc = (nu_alloc == 0) ? 8 : 2 * nu_alloc;
+
+          if (error_if_null
+              (new_models = (serve_model_type *)
+               realloc (*models, nu_alloc * sizeof (serve_model_type)),
+               __PROG_NAME_, "virtual memory exhausted\n"))
+            {
+              exit_status = EXIT_FAILURE;
+              break;
+            }
+
+          *models = new_models;
+        }
+
+      exit_status = load_model (&((*models)[*nu_models]), fields[0],
+                                fields[1],
+                                strcmp (fields[2], "-") == 0 ? NULL :
+                                fields[2], metric, smoothing, idx_type,
+                                trk_flag);
+      (*nu_models)++;
+    }
+
+  fclose (list_fd);
+
+  if (exit_status == EXIT_SUCCESS && *nu_models == 0)
+    exit_status = error_failure (__PROG_NAME_,
+                                 "no models in model list '%s'\n",
+                                 list_file);
+
+  return exit_status;
+}
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                                 CONNECTIONS                                *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * conn_read_line
+ *
+ * Reads the next request line, without its line break. Returns
+ * EXIT_FAILURE when the client is gone or the line is too long.
+ */
+int
+conn_read_line (serve_conn_type * conn, char *line, const size_t max_size)
+{
+  size_t length = 0;                        /* line length */
+  ssize_t nu_read;                          /* bytes read */
+  char c;                                   /* current character */
+
+
+  while (TRUE)
+    {
+      if (conn->in_start == conn->in_end)
+        {
+          nu_read = read (conn->fd, conn->in, __BUFFER_SIZE_);
+
+          if (nu_read < 0 && errno == EINTR)
+            continue;
+
+          if (nu_read <= 0)
+            return EXIT_FAILURE;
+
+          conn->in_start = 0;
+          conn->in_end = (size_t) nu_read;
+        }
+
+      c = conn->in[conn->in_start++];
+
+      if (c == '\n')
+        break;
+
+      if (length + 1 >= max_size)
+        return EXIT_FAILURE;
+
+      line[length++] = c;
+    }
+
+  /* lines may end with CR LF */
+  if (length > 0 && line[length - 1] == '\r')
+    length--;
+
+  line[length] = '\0';
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * conn_read_bytes
+ *
+ * Reads exactly 'size' bytes of the input
+ */
+int
+conn_read_bytes (serve_conn_type * conn, unsigned char *bytes,
+                 const size_t size)
+{
+  size_t done = 0;                          /* bytes copied */
+  size_t chunk;                             /* bytes of the read ahead */
+  ssize_t nu_read;                          /* bytes read */
+
+
+  /* the bytes read ahead come first */
+  chunk = conn->in_end - conn->in_start;
+
+  if (chunk > size)
+    chunk = size;
+
+  memcpy (bytes, conn->in + conn->in_start, chunk);
+  conn->in_start += chunk;
+  done = chunk;
+
+  while (done < size)
+    {
+      nu_read = read (conn->fd, bytes + done, size - done);
+
+      if (nu_read < 0 && errno == EINTR)
+        continue;
+
+      if (nu_read <= 0)
+        return EXIT_FAILURE;
+
+      done += (size_t) nu_read;
+    }
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * conn_write
+ *
+ * Writes the given text to the client
+ */
+int
+conn_write (serve_conn_type * conn, const char *text, const size_t length)
+{
+  size_t done = 0;                          /* bytes written */
+  ssize_t nu_written;                       /* bytes written at once */
+
+
+  while (done < length)
+    {
+      nu_written = write (conn->fd, text + done, length - done);
+
+      if (nu_written < 0 && errno == EINTR)
+        continue;
+
+      if (nu_written <= 0)
+        return EXIT_FAILURE;
+
+      done += (size_t) nu_written;
+    }
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * conn_append
+ *
+ * Appends a line to the answer being built
+ */
+int
+conn_append (serve_conn_type * conn, const char *line)
+{
+  size_t length;                            /* line length */
+  size_t new_capacity;                      /* enlarged capacity */
+  char *new_out;                            /* enlarged answer */
+
+
+  length = strlen (line);
+
+  if (conn->out_length + length + 1 > conn->out_capacity)
+    {
+      new_capacity = (conn->out_capacity == 0) ? 4096 : conn->out_capacity;
+
+      while (conn->out_length + length + 1 > new_capacity)
+        new_capacity *= 2;
+
+      if ((new_out = (char *) realloc (conn->out, new_capacity)) == NULL)
+        return error_failure ("conn_append", "virtual memory exhausted\n");
+
+      conn->out = new_out;
+      conn->out_capacity = new_capacity;
+    }
+
+  memcpy (conn->out + conn->out_length, line, length);
+  conn->out_length += length;
+  conn->out[conn->out_length++] = '\n';
+  conn->out_lines++;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * conn_answer
+ *
+ * Sends the answer built, or the given error message
+ */
+int
+conn_answer (serve_conn_type * conn, const char *error,
+             const double milliseconds)
+{
+  char header[__REQUEST_SIZE_ + 64];        /* answer header */
+
+
+  if (error != NULL)
+    {
+      sprintf (header, "ERROR %.*s\n", __REQUEST_SIZE_, error);
+      return conn_write (conn, header, strlen (header));
+    }
+
+  sprintf (header, "OK %lu %.3f\n", conn->out_lines, milliseconds);
+
+  if (conn_write (conn, header, strlen (header)) != EXIT_SUCCESS)
+    return EXIT_FAILURE;
+
+  return conn_write (conn, conn->out, conn->out_length);
+}
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                                   REQUESTS                                 *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * elapsed_milliseconds
+ *
+ * Milliseconds since the given time
+ */
+double
+elapsed_milliseconds (const struct timeval *start)
+{
+  struct timeval now;                       /* current time */
+
+
+  gettimeofday (&now, NULL);
+
+  return (now.tv_sec - start->tv_sec) * 1000.0 +
+    (now.tv_usec - start->tv_usec) / 1000.0;
+}
+
+
+
+/*
+ * append_state
+ *
+ * Appends each winner found by nnet_som_propagate_states to the answer
+ */
+int
+append_state (void *arg, const UnitIndex state)
+{
+  char line[32];                            /* state line */
+
+
+  sprintf (line, "%ld", state);
+
+  return conn_append ((serve_conn_type *) arg, line);
+}
+
+
+
+/*
+ * accumulate_state
+ *
+ * Registers each winner found by nnet_som_propagate_states in the
+ * transition map accumulator
+ */
+int
+accumulate_state (void *arg, const UnitIndex state)
+{
+  return trmap_accum_state ((TMAccumulator) arg, (TMState) state);
+}
+
+
+
+/*
+ * read_source
+ *
+ * Creates the training set of the source of a request: an MFCC file, a
+ * WAV file or raw samples following the request line. Sets 'error' to
+ * the message for the client on failure, and 'broken' if the connection
+ * can no longer be trusted.
+ */
+TSet
+read_source (const serve_context_type * ctx, serve_conn_type * conn,
+             const serve_model_type * model, const char *source,
+             const char *argument, const char **error, BoolValue * broken)
+{
+  TSet set = NULL;                          /* new training set */
+  RValue rate;                              /* samples per second */
+  UsLgIntValue nu_samples;                  /* number of samples */
+  UsLgIntValue cur_sample;                  /* current sample */
+  unsigned char *bytes = NULL;              /* raw samples */
+  cmp_real *samples = NULL;                 /* samples */
+  long value;                               /* current sample value */
+
+
+  if (strcmp (source, "mfcc") == 0)
+    {
+      if ((set = nnet_tset_create_from_file
+           (NULL, model->input_dim, 0, FALSE, FALSE, TRUE, TRUE, FALSE,
+            argument)) == NULL)
+        *error = "error reading MFCC file";
+
+      return set;
+    }
+
+  if (strcmp (source, "wav") == 0)
+    {
+      if ((set = som_mfcc_set_from_wav (argument, ctx->param,
+                                        model->input_dim)) == NULL)
+        *error = "error extracting MFCC's from WAV file";
+
+      return set;
+    }
+
+  if (strcmp (source, "pcm") != 0)
+    {
+      *error = "unknown source";
+      return NULL;
+    }
+
+  /* raw samples: the payload must be read, or the connection is lost */
+  if (sscanf (argument, "%lf %lu", &rate, &nu_samples) != 2 ||
+      rate <= 0.0 || nu_samples == 0 || nu_samples > __MAX_PCM_SAMPLES_)
+    {
+      *error = "invalid raw signal rate or size";
+      *broken = TRUE;
+      return NULL;
+    }
+
+  bytes = (unsigned char *) malloc (2 * nu_samples);
+  samples = (cmp_real *) malloc (nu_samples * sizeof (cmp_real));
+
+  if (bytes == NULL || samples == NULL)
+    {
+      *error = "virtual memory exhausted";
+      *broken = TRUE;
+    }
+  else if (conn_read_bytes (conn, bytes, 2 * nu_samples) != EXIT_SUCCESS)
+    {
+      *error = "incomplete raw signal";
+      *broken = TRUE;
+    }
+  else
+    {
+      /* signed 16-bit little-endian samples */
+      for (cur_sample = 0; cur_sample < nu_samples; cur_sample++)
+        {
+          value = (long) bytes[2 * cur_sample] |
+            ((long) bytes[2 * cur_sample + 1] << 8);
+
+          if (value >= 32768)
+            value -= 65536;
+
+          samples[cur_sample] = (cmp_real) value;
+        }
+
+      if ((set = som_mfcc_set_from_samples (samples, nu_samples, rate,
+                                            ctx->param,
+                                            model->input_dim)) == NULL)
+        *error = "error extracting MFCC's from raw signal";
+    }
+
+  free (bytes);
+  free (samples);
+
+  return set;
+}
+
+
+
+/*
+ * answer_set
+ *
+ * Builds the answer of a states, map or score request on the given set
+ */
+int
+answer_set (const serve_model_type * model, serve_conn_type * conn,
+            const char *command, const UsLgIntValue k, const TSet set,
+            const char **error)
+{
+  TMAccumulator accum = NULL;               /* transition map */
+  SparseTransitionMap map;                  /* compacted sparse map */
+  UsLgIntValue *speaker_ids = NULL;         /* closest speakers */
+  RValue *scores = NULL;                    /* their distances */
+  UsLgIntValue nu_results = 0;              /* speakers returned */
+  UsLgIntValue cur_result;                  /* current speaker */
+  TMState origin;                           /* current origin state */
+  UsLgIntValue pos;                         /* current transition */
+  char line[128];                           /* answer line */
+  int exit_status = EXIT_SUCCESS;           /* auxiliary function return status */
+
+
+  /* the states go straight to the answer */
+  if (strcmp (command, "states") == 0)
+    {
+      if (nnet_som_propagate_states (model->som_nnet, set, append_state,
+                                     conn) != EXIT_SUCCESS)
+        *error = "error propagating set";
+
+      return *error == NULL ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+  /* maps are sparse; scored maps are dense, as the references are */
+  if ((accum = trmap_accum_create
+       (model->output_dim, strcmp (command, "map") == 0)) == NULL)
+    {
+      *error = "error creating transition map";
+      return EXIT_FAILURE;
+    }
+
+  if (nnet_som_propagate_states (model->som_nnet, set, accumulate_state,
+                                 accum) != EXIT_SUCCESS)
+    {
+      *error = "error propagating set";
+      exit_status = EXIT_FAILURE;
+    }
+  else if (accum->sparse_map != NULL)
+    {
+      map = accum->sparse_map;
+
+      if (trmap_sparse_compact (map) != EXIT_SUCCESS)
+        {
+          *error = "error compacting transition map";
+          exit_status = EXIT_FAILURE;
+        }
+
+      /* same lines as trmap_sparse_write */
+      if (exit_status == EXIT_SUCCESS)
+        {
+          sprintf (line, "%ld %ld", map->dimension, map->nu_transitions);
+          exit_status = conn_append (conn, line);
+        }
+
+      for (origin = 0;
+           origin < map->dimension && exit_status == EXIT_SUCCESS; origin++)
+        for (pos = map->row_start[origin];
+             pos < map->row_start[origin + 1] && exit_status == EXIT_SUCCESS;
+             pos++)
+          {
+            sprintf (line, "%ld %ld %f", origin + 1,
+                     map->destinations[pos] + 1, map->counts[pos]);
+            exit_status = conn_append (conn, line);
+          }
+
+      if (exit_status != EXIT_SUCCESS && *error == NULL)
+        *error = "virtual memory exhausted";
+    }
+  else
+    {
+      speaker_ids = (UsLgIntValue *) malloc (k * sizeof (UsLgIntValue));
+      scores = (RValue *) malloc (k * sizeof (RValue));
+
+      if (speaker_ids == NULL || scores == NULL)
+        {
+          *error = "virtual memory exhausted";
+          exit_status = EXIT_FAILURE;
+        }
+      else if (trmap_scorer_score (model->scorer, accum->map, k, speaker_ids,
+                                   scores, &nu_results) != EXIT_SUCCESS)
+        {
+          *error = "error scoring transition map";
+          exit_status = EXIT_FAILURE;
+        }
+
+      for (cur_result = 0;
+           cur_result < nu_results && exit_status == EXIT_SUCCESS;
+           cur_result++)
+        {
+          sprintf (line, "%lu %f", speaker_ids[cur_result],
+                   scores[cur_result]);
+          exit_status = conn_append (conn, line);
+        }
+
+      if (exit_status != EXIT_SUCCESS && *error == NULL)
+        *error = "virtual memory exhausted";
+
+      free (speaker_ids);
+      free (scores);
+    }
+
+  trmap_accum_destroy (&accum);
+
+  return exit_status;
+}
+
+
+
+/*
+ * serve_request
+ *
+ * Answers one request line. Returns EXIT_FAILURE when the connection
+ * must be closed.
+ */
+int
+serve_request (const serve_context_type * ctx, serve_conn_type * conn,
+               const char *request)
+{
+  char command[16] = "";                    /* request command */
+  char model_name[NAME_SIZE] = "";          /* requested model */
+  char source[16] = "";                     /* source type */
+  const char *argument;                     /* source argument */
+  const serve_model_type *model = NULL;     /* requested model */
+  UsLgIntValue k = 0;                       /* speakers requested */
+  UsIntValue cur_model;                     /* current model */
+  int pos = 0;                              /* parsed characters */
+  struct timeval start;                     /* request start */
+  const char *error = NULL;                 /* message for the client */
+  BoolValue broken = FALSE;                 /* flag: connection lost */
+  TSet set = NULL;                          /* set of the source */
+  char line[NAME_SIZE + 64];                /* answer line */
+  double milliseconds;                      /* time spent */
+  int exit_status;                          /* auxiliary function return status */
+
+
+  gettimeofday (&start, NULL);
+
+  conn->out_length = 0;
+  conn->out_lines = 0;
+
+  if (sscanf (request, "%15s%n", command, &pos) != 1)
+    return EXIT_SUCCESS;
+
+  request += pos;
+
+  if (strcmp (command, "quit") == 0)
+    return EXIT_FAILURE;
+
+  if (strcmp (command, "models") == 0)
+    {
+      for (cur_model = 0; cur_model < ctx->nu_models && error == NULL;
+           cur_model++)
+        {
+          model = &(ctx->models[cur_model]);
+          sprintf (line, "%.*s %ld %ld %lu", NAME_SIZE - 1, model->name,
+                   model->input_dim, model->output_dim,
+                   model->scorer != NULL ? model->scorer->nu_speakers : 0);
+
+          if (conn_append (conn, line) != EXIT_SUCCESS)
+            error = "virtual memory exhausted";
+        }
+
+      return conn_answer (conn, error, elapsed_milliseconds (&start));
+    }
+
+  if (strcmp (command, "states") != 0 && strcmp (command, "map") != 0 &&
+      strcmp (command, "score") != 0)
+    return conn_answer (conn, "unknown command", 0.0);
+
+  /* model (up to NAME_SIZE - 1 characters), number of speakers and
+     source */
+  if (sscanf (request, "%63s%n", model_name, &pos) != 1)
+    return conn_answer (conn, "no model given", 0.0);
+
+  request += pos;
+
+  if (strcmp (command, "score") == 0)
+    {
+      if (sscanf (request, "%lu%n", &k, &pos) != 1 || k == 0)
+        return conn_answer (conn, "invalid number of speakers", 0.0);
+
+      request += pos;
+    }
+
+  if (sscanf (request, "%15s%n", source, &pos) != 1)
+    return conn_answer (conn, "no source given", 0.0);
+
+  for (argument = request + pos; *argument == ' ' || *argument == '\t';
+       argument++)
+    ;
+
+  for (cur_model = 0; cur_model < ctx->nu_models && model == NULL;
+       cur_model++)
+    if (strcmp (ctx->models[cur_model].name, model_name) == 0)
+      model = &(ctx->models[cur_model]);
+
+  /* the raw samples of a refused request are not read: the client
+     is disconnected */
+  if (model == NULL)
+    error = "unknown model";
+  else if (strcmp (command, "score") == 0 && model->scorer == NULL)
+    error = "model has no reference maps";
+
+  if (error != NULL)
+    {
+      exit_status = conn_answer (conn, error, 0.0);
+      return strcmp (source, "pcm") == 0 ? EXIT_FAILURE : exit_status;
+    }
+
+  set = read_source (ctx, conn, model, source, argument, &error, &broken);
+
+  if (set != NULL && error == NULL)
+    answer_set (model, conn, command, k, set, &error);
+
+  if (set != NULL)
+    nnet_tset_destroy (&set, TRUE);
+
+  milliseconds = elapsed_milliseconds (&start);
+
+  printf ("%s %s %s: %s, %.3f ms\n", command, model->name, source,
+          error == NULL ? "OK" : error, milliseconds);
+  fflush (stdout);
+
+  exit_status = conn_answer (conn, error, milliseconds);
+
+  if (broken == TRUE)
+    return EXIT_FAILURE;
+
+  return exit_status;
+}
+
+
+
+/*
+ * serve_thread
+ *
+ * Accepts connections and answers their requests, one connection at a
+ * time
+ */
+void *
+serve_thread (void *arg)
+{
+  serve_context_type *ctx = (serve_context_type *) arg;
+  serve_conn_type *conn = NULL;             /* current connection */
+  char request[__REQUEST_SIZE_];            /* current request */
+  unsigned int nu_failures = 0;             /* accept failures in a row */
+
+
+  if (error_if_null
+      (conn = (serve_conn_type *) malloc (sizeof (serve_conn_type)),
+       "serve_thread", "virtual memory exhausted\n"))
+    return NULL;
+
+  conn->out = NULL;
+  conn->out_capacity = 0;
+
+  while (TRUE)
+    {
+      if ((conn->fd = accept (ctx->listen_fd, NULL, NULL)) < 0)
+        {
+          if (errno == EINTR || errno == ECONNABORTED)
+            continue;
+
+          /* Out of descriptors or memory: waits for other connections to
+             close, once a second, before giving up */
+          if ((errno == EMFILE || errno == ENFILE || errno == ENOBUFS ||
+               errno == ENOMEM) && nu_failures < __ACCEPT_RETRIES_)
+            {
+              if (nu_failures == 0)
+                error_failure ("serve_thread",
+                               "error accepting connection: %s; retrying\n",
+                               strerror (errno));
+              nu_failures++;
+              sleep (1);
+              continue;
+            }
+
+          /* Any other error would repeat at once: the thread stops */
+          error_failure ("serve_thread",
+                         "error accepting connection: %s; thread stopped\n",
+                         strerror (errno));
+          break;
+        }
+
+      nu_failures = 0;
+      conn->in_start = 0;
+      conn->in_end = 0;
+
+      while (conn_read_line (conn, request, __REQUEST_SIZE_) == EXIT_SUCCESS)
+        if (serve_request (ctx, conn, request) != EXIT_SUCCESS)
+          break;
+
+      close (conn->fd);
+    }
+
+  free (conn->out);
+  free (conn);
+
+  return NULL;
+}
+
+
+
+int
+main (int argc, char **argv)
+{
+  char *socket_file = NULL;                 /* socket path */
+  char *list_file = NULL;                   /* model list */
+  char *net_file = NULL;                    /* default model network */
+  char *ref_file = NULL;                    /* default model references */
+
+  TMScoreMetric metric = TMSCORE_L1;        /* scoring distance */
+  RValue smoothing = 1.0;                   /* scoring smoothing count */
+  UsIntValue nu_threads = 4;                /* connections served at once */
+  CodebookIndexType idx_type = CBIDX_LINEAR;    /* winner search index */
+  BoolValue trk_flag = FALSE;               /* flag: track winners */
+
+  serve_context_type ctx;                   /* shared by the threads */
+  struct sockaddr_un address;               /* socket address */
+  pthread_t *threads = NULL;                /* connection threads */
+  UsIntValue cur_thread;                    /* current thread */
+  UsIntValue cur_model;                     /* current model */
+  int exit_status = EXIT_SUCCESS;           /* auxiliary function return status */
+
+
+  /* command line parameters */
+  InputParameterSet pset = {
+    {"-h", "--help", BOOL, FALSE, FALSE,
+     {.boolvalue = FALSE}},
+    {"-so", "--socket", STRING, FALSE, FALSE,
+     {.stringvalue = (char *) NULL}},
+    {"-ml", "--model-list", STRING, FALSE, FALSE,
+     {.stringvalue = (char *) NULL}},
+    {"-in", "--input-network", STRING, FALSE, FALSE,
+     {.stringvalue = (char *) NULL}},
+    {"-rl", "--reference-list", STRING, FALSE, FALSE,
+     {.stringvalue = (char *) NULL}},
+    {"-mt", "--metric", STRING, FALSE, FALSE,
+     {.stringvalue = "l1"}},
+    {"-sw", "--smoothing", REAL, FALSE, FALSE,
+     {.realvalue = 1.0}},
+    {"-th", "--threads", UNSIGNED_LONG_INT, FALSE, FALSE,
+     {.uslgintvalue = 4}},
+    {"-ix", "--index", STRING, FALSE, FALSE,
+     {.stringvalue = "linear"}},
+    {"-tw", "--track-winners", BOOL, FALSE, FALSE,
+     {.boolvalue = FALSE}},
+  };
+
+  InputParameterList plist = { 10, pset };
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                                 PARAMETERS                                 *
+ *                                                                            *
+ ******************************************************************************/
+
+  /* Parses the command line */
+  if (error_if_failure (inpr_parse (argc, argv, plist), __PROG_NAME_,
+                        "error parsing command line\n"))
+    {
+      usage ();
+      return EXIT_FAILURE;
+    }
+
+  /* Usage request */
+  if (plist.parameter[0].passed == TRUE)
+    {
+      usage ();
+      return EXIT_SUCCESS;
+    }
+
+  socket_file = plist.parameter[1].value.stringvalue;
+  list_file = plist.parameter[2].value.stringvalue;
+  net_file = plist.parameter[3].value.stringvalue;
+  ref_file = plist.parameter[4].value.stringvalue;
+  smoothing = plist.parameter[6].value.realvalue;
+  nu_threads = (UsIntValue) plist.parameter[7].value.uslgintvalue;
+  trk_flag = plist.parameter[9].value.boolvalue;
+
+  if (socket_file == NULL || (list_file == NULL && net_file == NULL))
+    {
+      usage ();
+      return error_failure (__PROG_NAME_,
+                            "socket and model list or input network required\n");
+    }
+
+  if (list_file != NULL && (net_file != NULL || ref_file != NULL))
+    return error_failure (__PROG_NAME_,
+                          "give either a model list or a single model\n");
+
+  if (strlen (socket_file) >= sizeof (address.sun_path))
+    return error_failure (__PROG_NAME_, "socket path too long: '%s'\n",
+                          socket_file);
+
+  if (error_if_failure
+      (trmap_score_metric_by_name (plist.parameter[5].value.stringvalue,
+                                   &metric), __PROG_NAME_,
+       "unknown metric '%s'\n", plist.parameter[5].value.stringvalue))
+    return EXIT_FAILURE;
+
+  if (error_if_failure
+      (nnet_cbidx_type_by_name (plist.parameter[8].value.stringvalue,
+                                &idx_type), __PROG_NAME_,
+       "unknown winner search index '%s'\n",
+       plist.parameter[8].value.stringvalue))
+    return EXIT_FAILURE;
+
+  if (nu_threads == 0)
+    return error_failure (__PROG_NAME_, "at least one thread required\n");
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                                    MODELS                                  *
+ *                                                                            *
+ ******************************************************************************/
+
+  ctx.models = NULL;
+  ctx.nu_models = 0;
+  scep_default_parameters (&(ctx.param));
+
+  if (list_file != NULL)
+    exit_status = load_model_list (list_file, &(ctx.models), &(ctx.nu_models),
+                                   metric, smoothing, idx_type, trk_flag);
+  else if (error_if_null
+           (ctx.models = (serve_model_type *) malloc
+            (sizeof (serve_model_type)), __PROG_NAME_,
+            "virtual memory exhausted\n"))
+    exit_status = EXIT_FAILURE;
+  else
+    {
+      ctx.nu_models = 1;
+      exit_status = load_model (ctx.models, "default", net_file, ref_file,
+                                metric, smoothing, idx_type, trk_flag);
+    }
+
+  if (exit_status != EXIT_SUCCESS)
+    return error_failure (__PROG_NAME_, "error loading the models\n");
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                                    SERVER                                  *
+ *                                                                            *
+ ******************************************************************************/
+
+  memset (&address, 0, sizeof (address));
+  address.sun_family = AF_UNIX;
+  strcpy (address.sun_path, socket_file);
+
+  if ((ctx.listen_fd = socket (AF_UNIX, SOCK_STREAM, 0)) < 0)
+    return error_failure (__PROG_NAME_, "error creating socket: %s\n",
+                          strerror (errno));
+
+  if (bind (ctx.listen_fd, (struct sockaddr *) &address,
+            sizeof (address)) != 0)
+    return error_failure (__PROG_NAME_, "error binding socket '%s': %s\n",
+                          socket_file, strerror (errno));
+
+  if (listen (ctx.listen_fd, __LISTEN_BACKLOG_) != 0)
+    {
+      exit_status = error_failure (__PROG_NAME_,
+                                   "error listening on socket '%s': %s\n",
+                                   socket_file, strerror (errno));
+      unlink (socket_file);
+      return exit_status;
+    }
+
+  /* Clients that leave early must not stop the server */
+  serve_socket_path = socket_file;
+  signal (SIGPIPE, SIG_IGN);
+  signal (SIGINT, serve_interrupt);
+  signal (SIGTERM, serve_interrupt);
+
+  if (error_if_null
+      (threads = (pthread_t *) malloc (nu_threads * sizeof (pthread_t)),
+       __PROG_NAME_, "virtual memory exhausted\n"))
+    exit_status = EXIT_FAILURE;
+
+  for (cur_thread = 0;
+       cur_thread < nu_threads && exit_status == EXIT_SUCCESS; cur_thread++)
+    if (pthread_create (&(threads[cur_thread]), NULL, serve_thread, &ctx) !=
+        0)
+      exit_status = error_failure (__PROG_NAME_,
+                                   "error creating connection thread\n");
+
+  if (exit_status == EXIT_SUCCESS)
+    {
+      printf ("Listening on '%s' with %u threads\n", socket_file,
+              nu_threads);
+      fflush (stdout);
+
+      /* The threads serve until the server is interrupted, or until they
+         can no longer accept connections */
+      for (cur_thread = 0; cur_thread < nu_threads; cur_thread++)
+        pthread_join (threads[cur_thread], NULL);
+    }
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                                FINALIZATION                                *
+ *                                                                            *
+ ******************************************************************************/
+
+  close (ctx.listen_fd);
+  unlink (socket_file);
+  free (threads);
+
+  for (cur_model = 0; cur_model < ctx.nu_models; cur_model++)
+    unload_model (&(ctx.models[cur_model]));
+
+  free (ctx.models);
+
+  return exit_status;
+}
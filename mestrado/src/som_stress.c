@@ -0,0 +1,376 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "errorh/errorh.h"
+#include "ftrxtr/s_smptypes.h"
+#include "ftrxtr/s_cepstrum.h"
+#include "ftrxtr/s_fft.h"
+#include "nnet/som/nnet_som.h"
+#include "nnet/nnet_types.h"
+#include "nnet/nnet_nnet.h"
+#include "nnet/nnet_sets.h"
+#include "nnet/nnet_codebook.h"
+#include "nnet/nnet_cbindex.h"
+#include "nnet/nnet_files_nnet.h"
+#include "som_mfcc.h"
+
+#ifdef __PROG_NAME_
+#undef __PROG_NAME_
+#endif
+#define __PROG_NAME_ "som_stress"
+
+#define __NU_RUNS_ 12
+#define __NU_SETUPS_ 3
+#define __NU_INPUTS_ 16
+#define __NU_UNITS_ 16
+#define __NU_SAMPLES_ 110250
+#define __SAMPLE_RATE_ 22050.0
+#define __EPOCHS_ 4
+
+
+
+/*
+ * Network configuration parsed by every run: a 16 x 16 SOM, whose weights
+ * are then set to the same values in all of them
+ */
+static const char stress_config[] =
+  "<neural network>\n"
+  "  neural network name: SOM Stress\n"
+  "  neural network extension: SOM\n"
+  "</neural network>\n"
+  "\n"
+  "<som extension>\n"
+  "  neighborhood function: Gaussian\n"
+  "  neighborhood function parameters: 3 0.000000 4.000000 8.000000\n"
+  "  learning rate function: Exponential Decay\n"
+  "  learning rate function parameters: 2 0.10000 8.000000\n"
+  "</som extension>\n"
+  "\n"
+  "<layer>\n"
+  "  layer name: Input\n"
+  "  layer index: 1\n"
+  "  layer class: Input\n"
+  "  layer default units: 16\n"
+  "  activation class: Pass-through\n"
+  "</layer>\n"
+  "\n"
+  "<layer>\n"
+  "  layer name: Output\n"
+  "  layer index: 2\n"
+  "  layer class: Output\n"
+  "  layer default units: 16\n"
+  "  activation class: Linear\n"
+  "  activation parameters: 2 1.0 0.0\n"
+  "  distribution vector: 2 4.0 4.0\n"
+  "  increment vector: 2 1.0 1.0\n"
+  "</layer>\n"
+  "\n"
+  "<layer connection>\n"
+  "  origin layer: 1\n"
+  "  destination layer: 2\n"
+  "  initial weight: 0.0\n"
+  "  initialization method: Gaussian Random\n"
+  "  initialization parameters: 2 0.0 0.05\n"
+  "</layer connection>\n";
+
+
+
+/*
+ * stress_setup_type
+ *
+ * Training options of a run
+ */
+typedef struct
+{
+  SomAlgorithmType algorithm;               /* training algorithm */
+  UsIntValue nu_threads;                    /* batch training threads */
+  CodebookIndexType index_type;             /* winner search index */
+}
+stress_setup_type;
+
+static const stress_setup_type stress_setups[__NU_SETUPS_] = {
+  {SOM_ONLINE, 1, CBIDX_LINEAR},
+  {SOM_BATCH, 2, CBIDX_VPTREE},
+  {SOM_BATCH, 2, CBIDX_GRAPH}
+};
+
+
+
+/*
+ * stress_run_type
+ *
+ * One run: extracts the MFCC's of the test signal, reads the network
+ * configuration and trains the network, leaving its weights and
+ * quantization error
+ */
+typedef struct
+{
+  const cmp_real *samples;                  /* test signal */
+  const stress_setup_type *setup;           /* training options */
+  RValue *weights;                          /* trained weights */
+  RValue error;                             /* final quantization error */
+  int status;                               /* EXIT_FAILURE: run failed */
+}
+stress_run_type;
+
+
+
+/*
+ * stress_signal
+ *
+ * Fills the test signal: a chirp over pseudo-random noise, in the range
+ * of 8-bit samples
+ */
+void
+stress_signal (cmp_real * samples)
+{
+  unsigned long state = 12345;              /* noise generator */
+  unsigned long cur_sample;                 /* current sample */
+  RValue t;                                 /* sample time */
+
+
+  for (cur_sample = 0; cur_sample < __NU_SAMPLES_; cur_sample++)
+    {
+      state = (state * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+      t = (RValue) cur_sample / __SAMPLE_RATE_;
+      samples[cur_sample] =
+        64.0 * sin (2.0 * PI * (200.0 + 800.0 * t) * t) +
+        (RValue) (state % 17) - 8.0;
+    }
+
+  return;
+}
+
+
+
+/*
+ * stress_network
+ *
+ * Reads the network configuration and sets its weights to fixed values,
+ * since the configured initialization draws from rand ()
+ */
+NNetwork
+stress_network (void)
+{
+  FILE *config_fd = NULL;                   /* configuration stream */
+  NNetwork nnet = NULL;                     /* network read */
+  Codebook codebook = NULL;                 /* its weights */
+  UnitIndex cur_weight;                     /* current weight */
+
+
+  if (error_if_null (config_fd = tmpfile (), "stress_network",
+                     "error creating configuration file\n"))
+    return NULL;
+
+  fputs (stress_config, config_fd);
+  rewind (config_fd);
+
+  nnet = nnet_file_create_nnetwork (config_fd);
+  fclose (config_fd);
+
+  if (error_if_null (nnet, "stress_network",
+                     "error creating neural network\n"))
+    return NULL;
+
+  if (error_if_null (codebook = nnet_cbook_create (nnet->last_layer),
+                     "stress_network", "error creating codebook\n"))
+    return NULL;
+
+  for (cur_weight = 0; cur_weight < codebook->nu_units * codebook->dimension;
+       cur_weight++)
+    codebook->weights[cur_weight] = sin ((RValue) cur_weight);
+
+  if (error_if_failure (nnet_cbook_store (codebook), "stress_network",
+                        "error storing weights\n"))
+    return NULL;
+
+  nnet_cbook_destroy (&codebook);
+
+  return nnet;
+}
+
+
+
+/*
+ * stress_run
+ *
+ * Executes one run
+ */
+void *
+stress_run (void *arg)
+{
+  stress_run_type *run = (stress_run_type *) arg;
+  scep_parameter_type param;                /* MFCC parameters */
+  TSet set = NULL;                          /* MFCC frames */
+  NNetwork nnet = NULL;                     /* network trained */
+  SomNNetwork som_nnet = NULL;              /* its SOM extension */
+  Codebook codebook = NULL;                 /* trained weights */
+  DTime epoch;                              /* current epoch */
+
+
+  run->status = EXIT_FAILURE;
+
+  scep_default_parameters (&param);
+
+  if (error_if_null
+      (set = som_mfcc_set_from_samples (run->samples, __NU_SAMPLES_,
+                                        __SAMPLE_RATE_, param,
+                                        __NU_INPUTS_), "stress_run",
+       "error extracting MFCC's\n"))
+    return NULL;
+
+  if ((nnet = stress_network ()) == NULL)
+    return NULL;
+
+  som_nnet = (SomNNetwork) nnet->extension;
+
+  if (error_if_failure
+      (nnet_som_set_algorithm (som_nnet, run->setup->algorithm,
+                               run->setup->nu_threads), "stress_run",
+       "error selecting SOM training algorithm\n") ||
+      error_if_failure
+      (nnet_som_set_index (som_nnet, run->setup->index_type, 2),
+       "stress_run", "error selecting winner search index\n"))
+    return NULL;
+
+  for (epoch = 0; epoch < __EPOCHS_; epoch++)
+    if (error_if_failure
+        (nnet_som_train_set (som_nnet, set, 0, __EPOCHS_,
+                             epoch == 0 ? TRUE : FALSE, FALSE, 0, ' '),
+         "stress_run", "error executing training epoch %ld\n", epoch))
+      return NULL;
+
+  if (error_if_failure
+      (nnet_som_quantization_error (som_nnet, set, &(run->error)),
+       "stress_run", "error computing quantization error\n"))
+    return NULL;
+
+  if (error_if_null (codebook = nnet_cbook_create (nnet->last_layer),
+                     "stress_run", "error creating codebook\n"))
+    return NULL;
+
+  memcpy (run->weights, codebook->weights,
+          codebook->nu_units * codebook->dimension * sizeof (RValue));
+
+  nnet_cbook_destroy (&codebook);
+  nnet_nnetwork_destroy (&nnet, TRUE, TRUE, TRUE, TRUE);
+  nnet_tset_destroy (&set, TRUE);
+
+  run->status = EXIT_SUCCESS;
+
+  return NULL;
+}
+
+
+
+/*
+ * main
+ *
+ * Runs each training setup once alone and then several times at once,
+ * checking that every concurrent run gives exactly the weights and the
+ * quantization error of the lone run. Extraction (sfft_exec_index),
+ * configuration parsing and SOM training all run in every thread.
+ */
+int
+main (void)
+{
+  cmp_real *samples = NULL;                 /* test signal */
+  stress_run_type refs[__NU_SETUPS_];       /* lone runs */
+  stress_run_type runs[__NU_RUNS_];         /* concurrent runs */
+  pthread_t threads[__NU_RUNS_];            /* their threads */
+  size_t nu_weights = __NU_UNITS_ * __NU_INPUTS_;  /* network weights */
+  UsIntValue cur_run;                       /* current run */
+  UsIntValue nu_started = 0;                /* threads started */
+  UsIntValue nu_failed = 0;                 /* runs that failed */
+
+
+  if (error_if_null
+      (samples = (cmp_real *) malloc (__NU_SAMPLES_ * sizeof (cmp_real)),
+       __PROG_NAME_, "virtual memory exhausted\n"))
+    return EXIT_FAILURE;
+
+  stress_signal (samples);
+
+  /* Lone runs */
+  for (cur_run = 0; cur_run < __NU_SETUPS_; cur_run++)
+    {
+      refs[cur_run].samples = samples;
+      refs[cur_run].setup = &(stress_setups[cur_run]);
+
+      if (error_if_null
+          (refs[cur_run].weights =
+           (RValue *) malloc (nu_weights * sizeof (RValue)), __PROG_NAME_,
+           "virtual memory exhausted\n"))
+        return EXIT_FAILURE;
+
+      stress_run (&(refs[cur_run]));
+
+      if (refs[cur_run].status != EXIT_SUCCESS)
+        return error_failure (__PROG_NAME_, "lone run %u failed\n", cur_run);
+    }
+
+  /* Concurrent runs */
+  for (cur_run = 0; cur_run < __NU_RUNS_; cur_run++)
+    {
+      runs[cur_run].samples = samples;
+      runs[cur_run].setup = &(stress_setups[cur_run % __NU_SETUPS_]);
+      runs[cur_run].status = EXIT_FAILURE;
+
+      if (error_if_null
+          (runs[cur_run].weights =
+           (RValue *) malloc (nu_weights * sizeof (RValue)), __PROG_NAME_,
+           "virtual memory exhausted\n"))
+        return EXIT_FAILURE;
+    }
+
+  for (nu_started = 0; nu_started < __NU_RUNS_; nu_started++)
+    if (pthread_create (&(threads[nu_started]), NULL, stress_run,
+                        &(runs[nu_started])) != 0)
+      {
+        error_failure (__PROG_NAME_, "error creating run thread\n");
+        break;
+      }
+
+  for (cur_run = 0; cur_run < nu_started; cur_run++)
+    pthread_join (threads[cur_run], NULL);
+
+  /* Checks the concurrent runs against the lone ones */
+  for (cur_run = 0; cur_run < __NU_RUNS_; cur_run++)
+    {
+      if (runs[cur_run].status != EXIT_SUCCESS)
+        {
+          error_failure (__PROG_NAME_, "run %u failed\n", cur_run);
+          nu_failed++;
+        }
+      else if (memcmp (runs[cur_run].weights,
+                       refs[cur_run % __NU_SETUPS_].weights,
+                       nu_weights * sizeof (RValue)) != 0 ||
+               runs[cur_run].error != refs[cur_run % __NU_SETUPS_].error)
+        {
+          error_failure (__PROG_NAME_,
+                         "run %u differs from its lone run\n", cur_run);
+          nu_failed++;
+        }
+
+      free (runs[cur_run].weights);
+    }
+
+  for (cur_run = 0; cur_run < __NU_SETUPS_; cur_run++)
+    {
+      printf ("Setup %u: quantization error %f\n", cur_run,
+              refs[cur_run].error);
+      free (refs[cur_run].weights);
+    }
+
+  free (samples);
+
+  if (nu_failed > 0 || nu_started < __NU_RUNS_)
+    return error_failure (__PROG_NAME_, "%u of %u concurrent runs failed\n",
+                          nu_failed, __NU_RUNS_);
+
+  printf ("%u concurrent runs match the lone runs\n", __NU_RUNS_);
+
+  return EXIT_SUCCESS;
+}
@@ -7,16 +7,23 @@
 #include "errorh/errorh.h"
 #include "strutils/strutils.h"
 #include "nnet/som/nnet_som.h"
+#include "nnet/som/nnet_som_pool.h"
 #include "nnet/nnet_types.h"
 #include "nnet/nnet_nnet.h"
 #include "nnet/nnet_actv.h"
 #include "nnet/nnet_weights.h"
 #include "nnet/nnet_sets.h"
+#include "nnet/nnet_tstream.h"
 #include "nnet/nnet_train.h"
+#include "nnet/nnet_codebook.h"
 #include "nnet/nnet_files.h"
 #include "nnet/nnet_files_nnet.h"
+#include "nnet/nnet_files_bin.h"
+#include "nnet/nnet_ckpt.h"
 #include "vector/vector.h"
 #include "trmap/trmap.h"
+#include "trmap/trmap_sparse.h"
+#include "trmap/trmap_accum.h"
 #include "inparse/inparse.h"
 
 #ifdef __PROG_NAME_
@@ -34,6 +41,46 @@ typedef enum
 file_mode_type;
 
 
+
+/*
+ * multi_model_type
+ *
+ * Networks trained together by the multi-model mode: the speaker, files
+ * and training job of each network, the training sets shared by the jobs,
+ * the training options and the speaker network table written as the
+ * networks finish
+ */
+typedef struct
+{
+  UsIntValue nu_jobs;                       /* number of networks */
+  UsLgIntValue *spk_ids;                    /* speaker of each network */
+  char **net_files;                         /* input network files */
+  char **set_files;                         /* training input lists */
+  char **tr_net_files;                      /* trained network files */
+  NNetwork *nnets;                          /* networks */
+  nnet_som_job_type *jobs;                  /* training jobs, by set */
+  UsIntValue *job_nets;                     /* network of each job */
+  UsIntValue nu_sets;                       /* distinct training sets */
+  TSet *sets;                               /* shared training sets */
+  UsIntValue *net_sets;                     /* set of each network */
+
+  SomAlgorithmType algorithm;               /* SOM training algorithm */
+  UsIntValue nu_threads;                    /* pool and reading threads */
+  CodebookIndexType index_type;             /* winner search index */
+  DTime index_rebuild;                      /* index rebuild epochs */
+  BoolValue track_winners;                  /* track winners */
+  BoolValue step_decay;                     /* decay after each element */
+  UsLgIntValue shuffle_seed;                /* training order seed */
+  ElementIndex shuffle_block;               /* training order block size */
+  DTime max_epochs;                         /* training epochs */
+  BoolValue binary;                         /* write binary models */
+
+  FILE *db_fd;                              /* network table records */
+  UsIntValue nu_records;                    /* records written */
+}
+multi_model_type;
+
+
 void
 usage (void)
 {
@@ -51,11 +98,30 @@ usage (void)
   puts ("              [-e  | --max-epochs <number>]");
   puts ("              [-ie | --initial-epoch <number>]");
   puts ("              [-se | --save-epochs <number>]");
+  puts ("              [-ta | --train-algorithm <online|batch>]");
+  puts ("              [-th | --threads <number>]");
+  puts ("              [-ix | --index <linear|vptree|graph>]");
+  puts ("              [-ir | --index-rebuild <number>]");
+  puts ("              [-tw | --track-winners]");
+  puts ("              [-rs | --reshuffle <seed>]");
+  puts ("              [-rb | --reshuffle-block <number>]");
+  puts ("              [-st | --stream <number>]");
+  puts ("              [-vs | --validation-size <number>]");
+  puts ("              [-ve | --validation-epochs <number>]");
+  puts ("              [-pt | --patience <number>]");
+  puts ("              [-mi | --min-improvement <number>]");
+  puts ("              [-ed | --element-decay]");
+  puts ("              [-bo | --binary-output]");
+  puts ("              [-rt | --resume]");
+  puts ("              [-mm | --multi-model <file>]");
+  puts ("              [-nt | --network-table <file>]");
+  puts ("              [-sm | --sparse-maps]");
   puts ("              [-h  | --help]\n");
   puts ("Options are:\n");
   puts ("  -fp | --file-preffix    common name for single network, input,");
   puts ("                          output, and transition map file names");
-  puts ("  -in | --input-network   input neural network file name");
+  puts ("  -in | --input-network   input neural network file name (text");
+  puts ("                          configuration or binary model)");
   puts ("  -on | --output-network  output trained neural network file name");
   puts ("  -i  | --input           input training set file name");
   puts ("  -il | --input-list      file containing list of input file names");
@@ -68,6 +134,53 @@ usage (void)
   puts ("  -e  | --max-epochs      maximum training epochs");
   puts ("  -ie | --initial-epoch   initial epoch for resume training");
   puts ("  -se | --save-epochs     save network status each n epochs");
+  puts ("  -ta | --train-algorithm online (default) or batch map training");
+  puts ("  -th | --threads         threads for batch training, states,");
+  puts ("                          reading input lists and multi-model");
+  puts ("                          training");
+  puts ("  -ix | --index           winner search index for batch training");
+  puts ("                          and states: linear (default), vptree or");
+  puts ("                          graph (approximate)");
+  puts ("  -ir | --index-rebuild   rebuild the index each n batch epochs");
+  puts ("  -tw | --track-winners   start each state search at the previous");
+  puts ("                          state's grid neighborhood");
+  puts ("  -rs | --reshuffle       visit the training set in a new order each");
+  puts ("                          online epoch, from the given seed");
+  puts ("  -rb | --reshuffle-block reshuffle blocks of n consecutive elements");
+  puts ("  -st | --stream          read the input list n elements at a time");
+  puts ("                          during online training instead of loading");
+  puts ("                          it (n = 0: default chunk size)");
+  puts ("  -vs | --validation-size hold out n training elements to measure");
+  puts ("                          the quantization error while training");
+  puts ("  -ve | --validation-epochs measure the validation error each n");
+  puts ("                          epochs (default 10)");
+  puts ("  -pt | --patience        stop after n validation checks without");
+  puts ("                          improvement, keeping the best weights");
+  puts ("                          (default 5)");
+  puts ("  -mi | --min-improvement minimum relative error decrease counted");
+  puts ("                          as improvement (default 0.0)");
+  puts ("  -ed | --element-decay   decay the learning rate and neighborhood");
+  puts ("                          width after each element of the online");
+  puts ("                          epochs instead of once per epoch");
+  puts ("  -bo | --binary-output   write the trained and savepoint networks");
+  puts ("                          as binary models; binary savepoints");
+  puts ("                          hold the training state for --resume");
+  puts ("  -rt | --resume          resume training exactly from the binary");
+  puts ("                          savepoint given as input network, with");
+  puts ("                          its epoch and training options");
+  puts ("  -mm | --multi-model     train all the networks of the given job");
+  puts ("                          list at the same time, --threads at a");
+  puts ("                          time; each job is four lines: speaker");
+  puts ("                          id, input network, input list and");
+  puts ("                          trained network. Each input list is");
+  puts ("                          read once and visited in a new order");
+  puts ("                          each epoch by each of its networks");
+  puts ("  -nt | --network-table   speaker network table (.ctl, with its .db");
+  puts ("                          records) written as the networks of");
+  puts ("                          --multi-model finish");
+  puts ("  -sm | --sparse-maps     write the transition maps in sparse form:");
+  puts ("                          dimension and number of transitions,");
+  puts ("                          then 'origin destination count' lines");
   puts ("  -h  | --help            outputs this help message and exit\n");
 
   return;
@@ -75,6 +188,582 @@ usage (void)
 
 
 
+/*
+ * multi_model_read_jobs
+ *
+ * Reads the networks of the multi-model mode from the given job list.
+ * Each network is given by four lines: the speaker id, the input network,
+ * the training input list and the trained network file names.
+ */
+int
+multi_model_read_jobs (const char *job_file, multi_model_type * mm)
+{
+  FILE *job_fd = NULL;                      /* job list file */
+  FileName buf = "";                        /* job list line */
+  char **fields[3];                         /* file name fields */
+  UsIntValue nu_alloc = 0;                  /* allocated networks */
+  UsIntValue cur_field;                     /* current field */
+  char *end = NULL;                         /* end of the speaker id */
+  int exit_status = EXIT_SUCCESS;           /* auxiliary function return status */
+
+
+  if (error_if_null (job_fd = fopen (job_file, "r"), __PROG_NAME_,
+                     "error opening job list '%s': %s\n", job_file,
+                     strerror (errno)))
+    return EXIT_FAILURE;
+
+  mm->nu_jobs = 0;
+
+  while (exit_status == EXIT_SUCCESS && !feof (job_fd))
+    {
+      /* speaker id */
+      if (error_if_failure (read_valid_file_line
+                            (job_fd, FILE_NAME_SIZE, IGNORE_TOKEN, 1, buf),
+                            __PROG_NAME_, "error reading job list '%s'\n",
+                            job_file))
+        exit_status = EXIT_FAILURE;
+
+      if (exit_status != EXIT_SUCCESS || feof (job_fd))
+        break;
+
+      /* grows the tables */
+      if (mm->nu_jobs == nu_alloc)
+        {
+          nu_alloc = (nu_alloc == 0) ? 16 : 2 * nu_alloc;
+
+          mm->spk_ids = (UsLgIntValue *)
+            realloc (mm->spk_ids, nu_alloc * sizeof (UsLgIntValue));
+          mm->net_files = (char **)
+            realloc (mm->net_files, nu_alloc * sizeof (char *));
+          mm->set_files = (char **)
+            realloc (mm->set_files, nu_alloc * sizeof (char *));
+          mm->tr_net_files = (char **)
+            realloc (mm->tr_net_files, nu_alloc * sizeof (char *));
+
+          if (mm->spk_ids == NULL || mm->net_files == NULL ||
+              mm->set_files == NULL || mm->tr_net_files == NULL)
+            {
+              exit_status = error_failure (__PROG_NAME_, strerror (errno));
+              break;
+            }
+        }
+
+      mm->spk_ids[mm->nu_jobs] = strtoul (buf, &end, 10);
+
+      if (end == buf || *end != '\0')
+        {
+          exit_status = error_failure (__PROG_NAME_,
+                                       "invalid speaker id '%s' in job list '%s'\n",
+                                       buf, job_file);
+          break;
+        }
+
+      /* file names */
+      fields[0] = &(mm->net_files[mm->nu_jobs]);
+      fields[1] = &(mm->set_files[mm->nu_jobs]);
+      fields[2] = &(mm->tr_net_files[mm->nu_jobs]);
+
+      for (cur_field = 0; cur_field < 3; cur_field++)
+        *fields[cur_field] = NULL;
+
+      mm->nu_jobs++;
+
+      for (cur_field = 0; cur_field < 3 && exit_status == EXIT_SUCCESS;
+           cur_field++)
+        {
+          if (error_if_failure (read_valid_file_line
+                                (job_fd, FILE_NAME_SIZE, IGNORE_TOKEN, 1,
+                                 buf), __PROG_NAME_,
+                                "error reading job list '%s'\n", job_file))
+            exit_status = EXIT_FAILURE;
+          else if (feof (job_fd))
+            exit_status = error_failure (__PROG_NAME_,
+                                         "incomplete job for speaker %lu in job list '%s'\n",
+                                         mm->spk_ids[mm->nu_jobs - 1],
+                                         job_file);
+          else if (error_if_null
+                   (*fields[cur_field] =
+                    (char *) malloc (strlen (buf) + 1), __PROG_NAME_,
+                    strerror (errno)))
+            exit_status = EXIT_FAILURE;
+          else
+            strcpy (*fields[cur_field], buf);
+        }
+    }
+
+  fclose (job_fd);
+
+  if (exit_status == EXIT_SUCCESS && mm->nu_jobs == 0)
+    exit_status = error_failure (__PROG_NAME_, "no jobs in job list '%s'\n",
+                                 job_file);
+
+  return exit_status;
+}
+
+
+
+/*
+ * multi_model_create_table
+ *
+ * Writes the control file of the speaker network table to the given file
+ * and opens its records file, named after it with the '.db' extension
+ */
+int
+multi_model_create_table (const char *table_file, multi_model_type * mm)
+{
+  FILE *ctl_fd = NULL;                      /* table control file */
+  char *db_file = NULL;                     /* table records file */
+  char *db_name = NULL;                     /* records file name */
+
+
+  if (error_if_null (db_file = get_file_name (NULL, table_file, ".db"),
+                     __PROG_NAME_, "error defining table records file name\n"))
+    return EXIT_FAILURE;
+
+  db_name = strrchr (db_file, '/');
+  db_name = (db_name == NULL) ? db_file : db_name + 1;
+
+  if (error_if_null (ctl_fd = fopen (table_file, "w"), __PROG_NAME_,
+                     "error creating table file '%s': %s\n", table_file,
+                     strerror (errno)))
+    {
+      free (db_file);
+      return EXIT_FAILURE;
+    }
+
+  fprintf (ctl_fd, "SOM_VQ: SPEAKER SPECIFIC SOM NETWORKS\n");
+  fprintf (ctl_fd, "%s\n", db_name);
+  fprintf (ctl_fd, "SPK_ID\nUNSIGNED_LONG_INT\nTRUE\n\n");
+  fprintf (ctl_fd, "SPK_TRAINED_NETFILE\nSTRING\nTRUE\n\n");
+  fprintf (ctl_fd, "SPK_TRAINING_TABLE\nSTRING\nFALSE\n");
+
+  if (fclose (ctl_fd) != 0)
+    {
+      error_failure (__PROG_NAME_, "error writing table file '%s': %s\n",
+                     table_file, strerror (errno));
+      free (db_file);
+      return EXIT_FAILURE;
+    }
+
+  if (error_if_null (mm->db_fd = fopen (db_file, "w"), __PROG_NAME_,
+                     "error creating table file '%s': %s\n", db_file,
+                     strerror (errno)))
+    {
+      free (db_file);
+      return EXIT_FAILURE;
+    }
+
+  free (db_file);
+  mm->nu_records = 0;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * multi_model_job_done
+ *
+ * Writes the network of a finished job and its record of the speaker
+ * network table, called by the training pool one job at a time
+ */
+int
+multi_model_job_done (void *arg, const UsIntValue job_index)
+{
+  multi_model_type *mm = (multi_model_type *) arg;
+  UsIntValue net;                           /* network of the job */
+  FILE *tr_net_fd = NULL;                   /* trained network file */
+
+
+  net = mm->job_nets[job_index];
+
+  /* trained network */
+  if (mm->binary == TRUE)
+    {
+      if (error_if_failure
+          (nnet_bin_write_nnetwork (mm->nnets[net], mm->tr_net_files[net]),
+           __PROG_NAME_, "error writing trained network file '%s'\n",
+           mm->tr_net_files[net]))
+        return EXIT_FAILURE;
+    }
+  else
+    {
+      if (error_if_null (tr_net_fd = fopen (mm->tr_net_files[net], "w"),
+                         __PROG_NAME_,
+                         "error creating trained network file '%s'\n",
+                         mm->tr_net_files[net]))
+        return EXIT_FAILURE;
+
+      nnet_file_write_nnetwork (mm->nnets[net], TRUE, TRUE, TRUE, TRUE, TRUE,
+                                tr_net_fd);
+
+      if (fclose (tr_net_fd) != 0)
+        return error_failure (__PROG_NAME_,
+                              "error writing trained network file '%s'\n",
+                              mm->tr_net_files[net]);
+    }
+
+  printf ("Speaker %lu: network '%s' trained\n", mm->spk_ids[net],
+          mm->tr_net_files[net]);
+  fflush (stdout);
+
+  /* network table record, blank line separated */
+  if (mm->db_fd != NULL)
+    {
+      if (mm->nu_records > 0)
+        fputc ('\n', mm->db_fd);
+
+      fprintf (mm->db_fd, "%lu\n%s\n%s\n", mm->spk_ids[net],
+               mm->tr_net_files[net], mm->set_files[net]);
+
+      if (fflush (mm->db_fd) != 0)
+        return error_failure (__PROG_NAME_,
+                              "error writing network table record: %s\n",
+                              strerror (errno));
+
+      mm->nu_records++;
+    }
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * multi_model_train
+ *
+ * Multi-model mode: trains all the networks of the given job list at the
+ * same time on a pool of threads. Each distinct training input list is
+ * read once and shared by the networks trained on it, each visiting it
+ * in its own order. The speaker network table, if given, gets a record
+ * as each network finishes.
+ */
+int
+multi_model_train (const char *job_file, const char *table_file,
+                   multi_model_type * mm)
+{
+  NNetModel model = NULL;                   /* mapped binary model */
+  FILE *net_fd = NULL;                      /* input network file */
+  NNetwork nnet = NULL;                     /* current network */
+  SomNNetwork som_nnet = NULL;              /* SOM extension */
+  UnitIndex input_dim;                      /* input layer dimension */
+  UsIntValue cur_net;                       /* current network */
+  UsIntValue cur_set;                       /* current set */
+  UsIntValue cur_job = 0;                   /* current job */
+  TSet view = NULL;                         /* view of a shared set */
+  time_t t_start, t_stop;                   /* training start and stop times */
+  int exit_status;                          /* auxiliary function return status */
+
+
+  if (error_if_failure (multi_model_read_jobs (job_file, mm), __PROG_NAME_,
+                        "error reading job list '%s'\n", job_file))
+    return EXIT_FAILURE;
+
+  mm->nnets = (NNetwork *) calloc (mm->nu_jobs, sizeof (NNetwork));
+  mm->jobs = (nnet_som_job_type *)
+    calloc (mm->nu_jobs, sizeof (nnet_som_job_type));
+  mm->job_nets = (UsIntValue *) malloc (mm->nu_jobs * sizeof (UsIntValue));
+  mm->sets = (TSet *) calloc (mm->nu_jobs, sizeof (TSet));
+  mm->net_sets = (UsIntValue *) malloc (mm->nu_jobs * sizeof (UsIntValue));
+
+  if (mm->nnets == NULL || mm->jobs == NULL || mm->job_nets == NULL ||
+      mm->sets == NULL || mm->net_sets == NULL)
+    return error_failure (__PROG_NAME_, strerror (errno));
+
+  /* Creates the networks in list order: random weights follow it */
+  for (cur_net = 0; cur_net < mm->nu_jobs; cur_net++)
+    {
+      printf ("Using file '%s' to create neural network... ",
+              mm->net_files[cur_net]);
+      fflush (stdout);
+
+      nnet = NULL;
+
+      if (nnet_bin_is_model (mm->net_files[cur_net]) == TRUE)
+        {
+          if ((model = nnet_bin_map (mm->net_files[cur_net])) != NULL)
+            {
+              nnet = nnet_bin_create_nnetwork (model);
+              nnet_bin_unmap (&model);
+            }
+        }
+      else if ((net_fd = fopen (mm->net_files[cur_net], "r")) != NULL)
+        {
+          nnet = nnet_file_create_nnetwork (net_fd);
+          fclose (net_fd);
+        }
+
+      if (nnet == NULL || nnet->extension == NULL ||
+          nnet->extension->index != NNEXT_SOM)
+        {
+          puts ("FAILED");
+          return error_failure (__PROG_NAME_,
+                                "error creating SOM network using file '%s'\n",
+                                mm->net_files[cur_net]);
+        }
+
+      puts ("OK");
+      mm->nnets[cur_net] = nnet;
+      som_nnet = (SomNNetwork) nnet->extension;
+
+      /* the pool threads train the networks: one thread each */
+      if (error_if_failure
+          (nnet_som_set_algorithm (som_nnet, mm->algorithm, 1),
+           __PROG_NAME_, "error selecting SOM training algorithm\n") ||
+          error_if_failure
+          (nnet_som_set_index (som_nnet, mm->index_type, mm->index_rebuild),
+           __PROG_NAME_, "error selecting winner search index\n") ||
+          error_if_failure
+          (nnet_som_set_tracking (som_nnet, mm->track_winners),
+           __PROG_NAME_, "error selecting winner tracking\n") ||
+          error_if_failure
+          (nnet_som_set_step_decay (som_nnet, mm->step_decay),
+           __PROG_NAME_, "error selecting learning rate decay\n"))
+        return EXIT_FAILURE;
+    }
+
+  /* Reads each distinct training input list once */
+  mm->nu_sets = 0;
+
+  for (cur_net = 0; cur_net < mm->nu_jobs; cur_net++)
+    {
+      input_dim = mm->nnets[cur_net]->first_layer->nu_units;
+
+      for (cur_set = 0; cur_set < cur_net; cur_set++)
+        if (strcmp (mm->set_files[cur_set], mm->set_files[cur_net]) == 0)
+          break;
+
+      if (cur_set < cur_net)
+        {
+          mm->net_sets[cur_net] = mm->net_sets[cur_set];
+
+          if (mm->sets[mm->net_sets[cur_net]]->input_dimension != input_dim)
+            return error_failure (__PROG_NAME_,
+                                  "network '%s' has %ld inputs, set '%s' has %ld\n",
+                                  mm->net_files[cur_net], input_dim,
+                                  mm->set_files[cur_net],
+                                  mm->sets[mm->net_sets[cur_net]]->
+                                  input_dimension);
+          continue;
+        }
+
+      printf ("Using file '%s' as input file list... ",
+              mm->set_files[cur_net]);
+      fflush (stdout);
+
+      if (error_if_null (mm->sets[mm->nu_sets] = nnet_tset_create_from_list
+                         ("SOM Training Set", input_dim, 0, FALSE, FALSE,
+                          TRUE, TRUE, FALSE, mm->nu_threads,
+                          mm->set_files[cur_net]), __PROG_NAME_,
+                         "error creating training set from file '%s'\n",
+                         mm->set_files[cur_net]))
+        {
+          puts ("FAILED");
+          return EXIT_FAILURE;
+        }
+
+      puts ("OK");
+      mm->net_sets[cur_net] = mm->nu_sets++;
+    }
+
+  /* One job per network, those of each set together */
+  for (cur_set = 0; cur_set < mm->nu_sets; cur_set++)
+    for (cur_net = 0; cur_net < mm->nu_jobs; cur_net++)
+      {
+        if (mm->net_sets[cur_net] != cur_set)
+          continue;
+
+        if (error_if_null
+            (view = nnet_tset_create_view (NULL, mm->sets[cur_set]),
+             __PROG_NAME_, "error creating training set view\n"))
+          return EXIT_FAILURE;
+
+        /* the shared set can't be randomized: each view is shuffled, in
+           orders of its own drawn from the seed and the network's
+           position in the job list */
+        if (error_if_failure
+            (nnet_tset_set_training_order (view, TRUE,
+                                           mm->shuffle_seed ^
+                                           (0x85EBCA6BUL * (cur_net + 1)),
+                                           mm->shuffle_block),
+             __PROG_NAME_, "error setting training order\n"))
+          return EXIT_FAILURE;
+
+        mm->jobs[cur_job].som_nnet =
+          (SomNNetwork) mm->nnets[cur_net]->extension;
+        mm->jobs[cur_job].training_set = view;
+        mm->jobs[cur_job].max_epochs = mm->max_epochs;
+        mm->job_nets[cur_job] = cur_net;
+        cur_job++;
+      }
+
+  /* Speaker network table */
+  mm->db_fd = NULL;
+
+  if (table_file != NULL &&
+      error_if_failure (multi_model_create_table (table_file, mm),
+                        __PROG_NAME_, "error creating network table\n"))
+    return EXIT_FAILURE;
+
+  /* Trains all the networks */
+  t_start = time (NULL);
+  printf ("Starting %s SOM training of %u networks on %u sets "
+          "(%u threads, maximum epochs = %ld)\n",
+          mm->algorithm == SOM_BATCH ? "batch" : "online", mm->nu_jobs,
+          mm->nu_sets, mm->nu_threads, mm->max_epochs);
+  printf ("Neural network training started at %s", ctime (&t_start));
+  fflush (stdout);
+
+  exit_status = nnet_som_pool_train (mm->jobs, mm->nu_jobs, mm->nu_threads,
+                                     multi_model_job_done, mm);
+
+  t_stop = time (NULL);
+  printf ("Neural network training finished at %s", ctime (&t_stop));
+  printf ("Training stage lasted %ld seconds\n",
+          (long) difftime (t_stop, t_start));
+
+  for (cur_job = 0; cur_job < mm->nu_jobs; cur_job++)
+    if (mm->jobs[cur_job].status != EXIT_SUCCESS)
+      fprintf (stderr, "%s: speaker %lu: network '%s' was not trained\n",
+               __PROG_NAME_, mm->spk_ids[mm->job_nets[cur_job]],
+               mm->net_files[mm->job_nets[cur_job]]);
+
+  if (mm->db_fd != NULL && fclose (mm->db_fd) != 0)
+    exit_status = error_failure (__PROG_NAME_,
+                                 "error writing network table: %s\n",
+                                 strerror (errno));
+
+  /* Finalization */
+  for (cur_job = 0; cur_job < mm->nu_jobs; cur_job++)
+    nnet_tset_destroy_view (&(mm->jobs[cur_job].training_set));
+
+  for (cur_set = 0; cur_set < mm->nu_sets; cur_set++)
+    nnet_tset_destroy (&(mm->sets[cur_set]), TRUE);
+
+  for (cur_net = 0; cur_net < mm->nu_jobs; cur_net++)
+    {
+      nnet_nnetwork_destroy (&(mm->nnets[cur_net]), TRUE, TRUE, TRUE, TRUE);
+      free (mm->net_files[cur_net]);
+      free (mm->set_files[cur_net]);
+      free (mm->tr_net_files[cur_net]);
+    }
+
+  free (mm->spk_ids);
+  free (mm->net_files);
+  free (mm->set_files);
+  free (mm->tr_net_files);
+  free (mm->nnets);
+  free (mm->jobs);
+  free (mm->job_nets);
+  free (mm->sets);
+  free (mm->net_sets);
+
+  return exit_status;
+}
+
+
+
+/*
+ * accumulate_state
+ *
+ * Registers each winner found by nnet_som_propagate_states in the
+ * transition map accumulator
+ */
+int
+accumulate_state (void *arg, const UnitIndex state)
+{
+  return trmap_accum_state ((TMAccumulator) arg, (TMState) state);
+}
+
+
+
+/*
+ * write_set_states
+ *
+ * Propagates the given set, writing its transition map to 'tm_file' and
+ * its list of states to 'sl_file', when given. The map is accumulated as
+ * the winners are found, dense (one count per line, destination state
+ * major) or sparse (only the transitions that happened); the list of
+ * winners is built only when the states file is requested.
+ */
+int
+write_set_states (const SomNNetwork som_nnet, const TSet set,
+                  const UnitIndex dimension, const char *tm_file,
+                  const char *sl_file, const BoolValue sparse)
+{
+  TMAccumulator accum = NULL;               /* transition map accumulator */
+  Vector winners = NULL;                    /* list of states */
+  FILE *out_fd = NULL;                      /* output file */
+  int exit_status = EXIT_SUCCESS;           /* auxiliary function return status */
+
+
+  if (tm_file != NULL && error_if_null
+      (accum = trmap_accum_create (dimension, sparse), "write_set_states",
+       "error creating state transition map\n"))
+    return EXIT_FAILURE;
+
+  /* propagates the set */
+  if (sl_file != NULL)
+    {
+      if (error_if_null
+          (winners = nnet_som_propagate_set (som_nnet, set),
+           "write_set_states", "error propagating training set\n"))
+        exit_status = EXIT_FAILURE;
+      else if (accum != NULL)
+        exit_status = trmap_accum_vector (accum, winners);
+    }
+  else
+    exit_status = nnet_som_propagate_states (som_nnet, set, accumulate_state,
+                                             accum);
+
+  /* writes state transition map to file */
+  if (exit_status == EXIT_SUCCESS && accum != NULL)
+    {
+      if ((out_fd = fopen (tm_file, "w")) == NULL)
+        exit_status = error_failure ("write_set_states",
+                                     "error creating map file '%s': %s\n",
+                                     tm_file, strerror (errno));
+      else
+        {
+          if (sparse == TRUE)
+            {
+              exit_status = trmap_sparse_compact (accum->sparse_map);
+
+              if (exit_status == EXIT_SUCCESS)
+                exit_status = trmap_sparse_write (accum->sparse_map, out_fd);
+            }
+          else
+            matrix_raw_info (accum->map, out_fd);
+
+          fclose (out_fd);
+        }
+    }
+
+  /* writes states list to file */
+  if (exit_status == EXIT_SUCCESS && winners != NULL)
+    {
+      if ((out_fd = fopen (sl_file, "w")) == NULL)
+        exit_status = error_failure ("write_set_states",
+                                     "error creating states file '%s': %s\n",
+                                     sl_file, strerror (errno));
+      else
+        {
+          vector_raw_info (winners, out_fd);
+          fclose (out_fd);
+        }
+    }
+
+  if (accum != NULL)
+    trmap_accum_destroy (&accum);
+
+  if (winners != NULL)
+    vector_destroy (&winners);
+
+  return exit_status;
+}
+
+
+
 int
 main (int argc, char **argv)
 {
@@ -104,15 +793,15 @@ main (int argc, char **argv)
 
   FILE *net_fd = NULL;                      /* input network file descriptor */
   FILE *tr_net_fd = NULL;                   /* trained network file descriptor */
-  FILE *sv_net_fd = NULL;                   /* savepoint network file descriptor */
-  FILE *tm_fd = NULL;                       /* transition map file descriptor */
-  FILE *sl_fd = NULL;                       /* status list file descriptor */
   FILE *inlist_fd = NULL;                   /* input list file descriptor */
+  FileName buf = "";                        /* input list file name buffer */
 
   BoolValue tm_flag = FALSE;                /* flag: output transition map to file */
   BoolValue sl_flag = FALSE;                /* flag: output status list to file */
+  BoolValue smap_flag = FALSE;              /* flag: sparse transition maps */
 
   NNetwork nnet = NULL;                     /* neural network created */
+  NNetModel model = NULL;                   /* mapped binary model */
   SomNNetwork som_nnet = NULL;              /* SOM extension */
   /*SomAttributes som_attr = NULL;*/        /* SOM attributes */
   /*LRateFunction lrate_function = NULL;*/  /* learning rate function */
@@ -121,6 +810,36 @@ main (int argc, char **argv)
   UnitIndex output_dim;                     /* output layer dimension */
 
   BoolValue trn_flag = FALSE;               /* flag: execute training */
+  SomAlgorithmType trn_algorithm = SOM_ONLINE;  /* SOM training algorithm */
+  UsIntValue nu_threads = 1;                /* number of training threads */
+  CodebookIndexType idx_type = CBIDX_LINEAR;    /* winner search index */
+  DTime idx_rebuild = 0;                    /* index rebuild epochs */
+  RValue idx_recall;                        /* index recall */
+  RValue idx_evaluations;                   /* index distances per search */
+  BoolValue trk_flag = FALSE;               /* flag: track winners */
+  RValue trk_distances;                     /* tracking distances per search */
+  BoolValue shf_flag = FALSE;               /* flag: reshuffle each epoch */
+  UsLgIntValue shf_seed = 0;                /* reshuffling seed */
+  ElementIndex shf_block = 0;               /* reshuffling block size */
+  BoolValue str_flag = FALSE;               /* flag: stream the input list */
+  BoolValue dec_flag = FALSE;               /* flag: decay after each element */
+  BoolValue bin_flag = FALSE;               /* flag: write binary models */
+  ElementIndex str_chunk = 0;               /* elements read at a time */
+  ElementIndex val_size = 0;                /* validation set size */
+  DTime val_epochs = 10;                    /* validation check epochs */
+  DTime val_patience = 5;                   /* checks without improvement */
+  RValue val_improvement = 0.0;             /* minimum relative improvement */
+  RValue val_error;                         /* validation quantization error */
+  BoolValue val_improved = FALSE;           /* flag: best validation error */
+  BoolValue val_stop = FALSE;               /* flag: stop training */
+  TStopRule stop_rule = NULL;               /* early stopping rule */
+  Codebook best_codebook = NULL;            /* best validated weights */
+  NNetCheckpoint checkpoint = NULL;         /* background savepoints */
+  BoolValue res_flag = FALSE;               /* flag: resume training */
+  NNetResume resume = NULL;                 /* resumed training state */
+  nnet_ckpt_state_type tr_state;            /* savepoint training state */
+  ElementIndex *positions = NULL;           /* initial training set order */
+  ElementIndex nu_positions = 0;            /* initial training set size */
   BoolValue rst_flag = TRUE;                /* flag: reset initial epoch */
   DTime epoch = 0;                          /* current epoch */
   DTime max_epochs;                         /* maximum training epochs */
@@ -129,13 +848,13 @@ main (int argc, char **argv)
   /*DTime max_epochs_order;*/               /* number of digits of max_epochs */
   TSet t_set = NULL;                        /* training set */
   TSet aux_set = NULL;                      /* auxiliary training set */
+  TSet v_set = NULL;                        /* validation set */
   time_t t_start, t_stop;                   /* training start and stop times */
   double training_duration;                 /* training duration */
 
-  Vector winners = NULL;                    /* list of states */
-  TransitionMap trmap = NULL;               /* state transition map */
-
   file_mode_type file_mode;                 /* single/multi-file input */
+  multi_model_type mm;                      /* multi-model networks */
+  int exit_status;                          /* auxiliary function return status */
 
 
   /* command line parameters */
@@ -168,9 +887,45 @@ main (int argc, char **argv)
      {.uslgintvalue = 0}},
     {"-ie", "--initial-epoch", UNSIGNED_LONG_INT, FALSE, FALSE,
      {.uslgintvalue = 0}},
+    {"-ta", "--train-algorithm", STRING, FALSE, FALSE,
+     {.stringvalue = "online"}},
+    {"-th", "--threads", UNSIGNED_LONG_INT, FALSE, FALSE,
+     {.uslgintvalue = 1}},
+    {"-ix", "--index", STRING, FALSE, FALSE,
+     {.stringvalue = "linear"}},
+    {"-ir", "--index-rebuild", UNSIGNED_LONG_INT, FALSE, FALSE,
+     {.uslgintvalue = 0}},
+    {"-tw", "--track-winners", BOOL, FALSE, FALSE,
+     {.boolvalue = FALSE}},
+    {"-rs", "--reshuffle", UNSIGNED_LONG_INT, FALSE, FALSE,
+     {.uslgintvalue = 0}},
+    {"-rb", "--reshuffle-block", UNSIGNED_LONG_INT, FALSE, FALSE,
+     {.uslgintvalue = 0}},
+    {"-st", "--stream", UNSIGNED_LONG_INT, FALSE, FALSE,
+     {.uslgintvalue = 0}},
+    {"-vs", "--validation-size", UNSIGNED_LONG_INT, FALSE, FALSE,
+     {.uslgintvalue = 0}},
+    {"-ve", "--validation-epochs", UNSIGNED_LONG_INT, FALSE, FALSE,
+     {.uslgintvalue = 10}},
+    {"-pt", "--patience", UNSIGNED_LONG_INT, FALSE, FALSE,
+     {.uslgintvalue = 5}},
+    {"-mi", "--min-improvement", REAL, FALSE, FALSE,
+     {.realvalue = 0.0}},
+    {"-ed", "--element-decay", BOOL, FALSE, FALSE,
+     {.boolvalue = FALSE}},
+    {"-bo", "--binary-output", BOOL, FALSE, FALSE,
+     {.boolvalue = FALSE}},
+    {"-rt", "--resume", BOOL, FALSE, FALSE,
+     {.boolvalue = FALSE}},
+    {"-mm", "--multi-model", STRING, FALSE, FALSE,
+     {.stringvalue = (char *) NULL}},
+    {"-nt", "--network-table", STRING, FALSE, FALSE,
+     {.stringvalue = (char *) NULL}},
+    {"-sm", "--sparse-maps", BOOL, FALSE, FALSE,
+     {.boolvalue = FALSE}},
   };
 
-  InputParameterList plist = { 14, pset };
+  InputParameterList plist = { 32, pset };
 
 
 
@@ -277,6 +1032,103 @@ main (int argc, char **argv)
   /* first epoch */
   first_epoch = (DTime) plist.parameter[13].value.uslgintvalue;
 
+  /* training algorithm */
+  if (strcmp (plist.parameter[14].value.stringvalue, "online") == 0)
+    trn_algorithm = SOM_ONLINE;
+  else if (strcmp (plist.parameter[14].value.stringvalue, "batch") == 0)
+    trn_algorithm = SOM_BATCH;
+  else
+    return error_failure (__PROG_NAME_, "unknown training algorithm '%s'\n",
+                          plist.parameter[14].value.stringvalue);
+
+  /* number of training threads */
+  nu_threads = (UsIntValue) plist.parameter[15].value.uslgintvalue;
+
+  /* winner search index */
+  if (error_if_failure
+      (nnet_cbidx_type_by_name (plist.parameter[16].value.stringvalue,
+                                &idx_type), __PROG_NAME_,
+       "unknown winner search index '%s'\n",
+       plist.parameter[16].value.stringvalue))
+    return EXIT_FAILURE;
+
+  /* index rebuild epochs */
+  idx_rebuild = (DTime) plist.parameter[17].value.uslgintvalue;
+
+  /* winner tracking */
+  if (plist.parameter[18].passed == TRUE)
+    trk_flag = TRUE;
+
+  /* per-epoch reshuffling */
+  if (plist.parameter[19].passed == TRUE)
+    shf_flag = TRUE;
+
+  shf_seed = (UsLgIntValue) plist.parameter[19].value.uslgintvalue;
+  shf_block = (ElementIndex) plist.parameter[20].value.uslgintvalue;
+
+  /* streamed input list */
+  if (plist.parameter[21].passed == TRUE)
+    str_flag = TRUE;
+
+  str_chunk = (ElementIndex) plist.parameter[21].value.uslgintvalue;
+
+  if (str_chunk == 0)
+    str_chunk = NNET_TSTREAM_CHUNK_SIZE;
+
+  /* validation set and early stopping */
+  val_size = (ElementIndex) plist.parameter[22].value.uslgintvalue;
+  val_epochs = (DTime) plist.parameter[23].value.uslgintvalue;
+  val_patience = (DTime) plist.parameter[24].value.uslgintvalue;
+  val_improvement = plist.parameter[25].value.realvalue;
+
+  /* per-element decay */
+  if (plist.parameter[26].passed == TRUE)
+    dec_flag = TRUE;
+
+  /* binary output networks */
+  if (plist.parameter[27].passed == TRUE)
+    bin_flag = TRUE;
+
+  /* resumed training */
+  if (plist.parameter[28].passed == TRUE)
+    res_flag = TRUE;
+
+  /* sparse transition maps */
+  if (plist.parameter[31].passed == TRUE)
+    smap_flag = TRUE;
+
+  /* Multi-model training */
+  if (plist.parameter[29].passed == TRUE)
+    {
+      if (res_flag == TRUE || str_flag == TRUE || val_size > 0 ||
+          save_epochs > 0)
+        return error_failure (__PROG_NAME_,
+                              "multi-model training can't resume, stream, validate or save savepoints\n");
+
+      if (nu_threads == 0)
+        return error_failure (__PROG_NAME_,
+                              "at least one thread is required\n");
+
+      memset (&mm, 0, sizeof (multi_model_type));
+      mm.algorithm = trn_algorithm;
+      mm.nu_threads = nu_threads;
+      mm.index_type = idx_type;
+      mm.index_rebuild = idx_rebuild;
+      mm.track_winners = trk_flag;
+      mm.step_decay = dec_flag;
+      mm.shuffle_seed = shf_seed;
+      mm.shuffle_block = shf_block;
+      mm.max_epochs = max_epochs;
+      mm.binary = bin_flag;
+
+      return multi_model_train (plist.parameter[29].value.stringvalue,
+                                plist.parameter[30].value.stringvalue, &mm);
+    }
+
+  if (plist.parameter[30].passed == TRUE)
+    return error_failure (__PROG_NAME_,
+                          "network tables are written by multi-model training\n");
+
   /* Running single or multi-file? */
   if (inlist_file != NULL)
     file_mode = MULTI_FILE;
@@ -289,7 +1141,7 @@ main (int argc, char **argv)
       if (set_file == NULL)
         return error_failure (__PROG_NAME_, "no input file passed\n");
 
-      if (sl_file == NULL)
+      if (sl_file == NULL && tm_file == NULL)
         return error_failure (__PROG_NAME_, "no output file passed\n");
     }
 
@@ -305,6 +1157,20 @@ main (int argc, char **argv)
   if (save_epochs > max_epochs)
     return error_failure (__PROG_NAME_, "savepoint epochs out of range\n");
 
+  if (nu_threads == 0)
+    return error_failure (__PROG_NAME_, "at least one thread is required\n");
+
+  if (val_size > 0 && str_flag == TRUE)
+    return error_failure (__PROG_NAME_,
+                          "streamed input lists can't hold out a validation set\n");
+
+  if (res_flag == TRUE && trn_flag == FALSE)
+    return error_failure (__PROG_NAME_, "resuming requires training\n");
+
+  if (res_flag == TRUE && plist.parameter[13].passed == TRUE)
+    return error_failure (__PROG_NAME_,
+                          "resumed training starts at the checkpoint epoch\n");
+
   /*
   if (first_epoch < 0)
     return error_failure (__PROG_NAME_, "negative initial epoch\n");
@@ -328,19 +1194,53 @@ main (int argc, char **argv)
  *                                                                            *
  ******************************************************************************/
 
-  /* Creates the network by the configuration file */
-  if (net_file != NULL)
+  /* Creates the network by the configuration file or binary model */
+  printf ("Using file '%s' to create neural network... ", net_file);
+  fflush (stdout);
+
+  if (nnet_bin_is_model (net_file) == TRUE)
     {
+      if (error_if_null (model = nnet_bin_map (net_file), __PROG_NAME_,
+                         "error mapping binary model '%s'\n", net_file))
+        {
+          puts ("FAILED");
+          return EXIT_FAILURE;
+        }
+
+      nnet = nnet_bin_create_nnetwork (model);
+
+      /* training state of the checkpoint */
+      if (res_flag == TRUE &&
+          error_if_null (resume = nnet_ckpt_resume_create (model),
+                         __PROG_NAME_, "no training state in '%s'\n",
+                         net_file))
+        {
+          puts ("FAILED");
+          nnet_bin_unmap (&model);
+          return EXIT_FAILURE;
+        }
+
+      if (error_if_failure (nnet_bin_unmap (&model), __PROG_NAME_,
+                            "error unmapping binary model '%s'\n",
+                            net_file))
+        return EXIT_FAILURE;
+    }
+  else
+    {
+      if (res_flag == TRUE)
+        return error_failure (__PROG_NAME_,
+                              "only binary savepoints can be resumed\n");
+
       if (error_if_null (net_fd = fopen (net_file, "r"),
                          __PROG_NAME_, strerror (errno)))
         return EXIT_FAILURE;
-    }
 
-  printf ("Using file '%s' to create neural network... ", net_file);
-  fflush (stdout);
+      nnet = nnet_file_create_nnetwork (net_fd);
+      fclose (net_fd);
+    }
 
   if (error_if_null
-      (nnet = nnet_file_create_nnetwork (net_fd), __PROG_NAME_,
+      (nnet, __PROG_NAME_,
        "error creating neural network using file '%s'\n", net_file))
     {
       puts ("FAILED");
@@ -348,7 +1248,6 @@ main (int argc, char **argv)
     }
   else
     {
-      fclose (net_fd);
       puts ("OK");
       fflush (stdout);
     }
@@ -360,6 +1259,77 @@ main (int argc, char **argv)
   input_dim = nnet->first_layer->nu_units;
   output_dim = nnet->last_layer->nu_units;
 
+  /* Resumed training follows the options of the checkpoint */
+  if (resume != NULL)
+    {
+      if (resume->state.algorithm != SOM_ONLINE &&
+          resume->state.algorithm != SOM_BATCH)
+        return error_failure (__PROG_NAME_,
+                              "checkpoint has unknown training algorithm %lu\n",
+                              resume->state.algorithm);
+
+      if (resume->state.index_type != CBIDX_LINEAR &&
+          resume->state.index_type != CBIDX_VPTREE &&
+          resume->state.index_type != CBIDX_GRAPH)
+        return error_failure (__PROG_NAME_,
+                              "checkpoint has unknown winner search index %lu\n",
+                              resume->state.index_type);
+
+      if (resume->state.nu_threads == 0 ||
+          resume->state.nu_threads != (UsIntValue) resume->state.nu_threads)
+        return error_failure (__PROG_NAME_,
+                              "checkpoint has invalid number of threads %lu\n",
+                              resume->state.nu_threads);
+
+      first_epoch = (DTime) resume->state.time;
+      trn_algorithm = (SomAlgorithmType) resume->state.algorithm;
+      nu_threads = (UsIntValue) resume->state.nu_threads;
+      idx_type = (CodebookIndexType) resume->state.index_type;
+      idx_rebuild = (DTime) resume->state.index_rebuild;
+      dec_flag = (BoolValue) resume->state.step_decay;
+      shf_flag = (BoolValue) resume->state.shuffle;
+      shf_seed = resume->state.shuffle_seed;
+      shf_block = (ElementIndex) resume->state.shuffle_block;
+      str_flag = (BoolValue) resume->state.stream;
+      str_chunk = (ElementIndex) resume->state.stream_chunk;
+      val_size = (ElementIndex) resume->state.validation_size;
+      val_epochs = (DTime) resume->state.validation_epochs;
+      val_patience = (DTime) resume->state.patience;
+      val_improvement = resume->state.min_improvement;
+
+      if (first_epoch >= max_epochs)
+        return error_failure (__PROG_NAME_,
+                              "checkpoint already trained %ld epochs\n",
+                              first_epoch);
+
+      if (str_flag == TRUE && file_mode != MULTI_FILE)
+        return error_failure (__PROG_NAME_,
+                              "checkpoint was trained on a streamed input list\n");
+
+      printf ("Resuming training at epoch %ld with the checkpoint options\n",
+              first_epoch);
+    }
+
+  if (error_if_failure
+      (nnet_som_set_algorithm (som_nnet, trn_algorithm, nu_threads),
+       __PROG_NAME_, "error selecting SOM training algorithm\n"))
+    return EXIT_FAILURE;
+
+  if (error_if_failure
+      (nnet_som_set_index (som_nnet, idx_type, idx_rebuild),
+       __PROG_NAME_, "error selecting winner search index\n"))
+    return EXIT_FAILURE;
+
+  if (error_if_failure
+      (nnet_som_set_tracking (som_nnet, trk_flag),
+       __PROG_NAME_, "error selecting winner tracking\n"))
+    return EXIT_FAILURE;
+
+  if (error_if_failure
+      (nnet_som_set_step_decay (som_nnet, dec_flag),
+       __PROG_NAME_, "error selecting learning rate decay\n"))
+    return EXIT_FAILURE;
+
 
 /******************************************************************************
  *                                                                            *
@@ -393,9 +1363,15 @@ main (int argc, char **argv)
       printf ("Using file '%s' as input file list... ", inlist_file);
       fflush (stdout);
 
-      if (error_if_null (t_set = nnet_tset_create_from_list
-                         ("SOM Training Set", input_dim, 0, FALSE, FALSE,
-                          TRUE, TRUE, FALSE, inlist_file), __PROG_NAME_,
+      if (str_flag == TRUE)
+        t_set = nnet_tset_create_streamed
+          ("SOM Training Set", input_dim, str_chunk, TRUE, inlist_file);
+      else
+        t_set = nnet_tset_create_from_list
+          ("SOM Training Set", input_dim, 0, FALSE, FALSE,
+           TRUE, TRUE, FALSE, nu_threads, inlist_file);
+
+      if (error_if_null (t_set, __PROG_NAME_,
                          "error creating training set from file '%s'\n",
                          inlist_file))
         {
@@ -408,19 +1384,110 @@ main (int argc, char **argv)
         }
     }
 
-  /* randomizes training set elements */
-  printf ("Randomizing training set... ");
-  fflush (stdout);
-
-  if (error_if_failure (nnet_tset_randomize (t_set), __PROG_NAME_,
-                        "error randomizing training set\n"))
+  /* streamed sets are shuffled chunk by chunk as they are read */
+  if (t_set->stream != NULL)
     {
-      puts ("FAILED");
-      return EXIT_FAILURE;
+      if (error_if_failure
+          (nnet_tstream_set_shuffling (t_set->stream, TRUE, TRUE, shf_seed),
+           __PROG_NAME_, "error setting training stream order\n"))
+        return EXIT_FAILURE;
     }
   else
     {
-      puts ("OK");
+      nu_positions = t_set->nu_elements;
+
+      if (resume != NULL)
+        {
+          /* repeats the order of the interrupted run */
+          printf ("Restoring training set order... ");
+          fflush (stdout);
+
+          if (resume->state.nu_positions != nu_positions)
+            {
+              puts ("FAILED");
+              return error_failure (__PROG_NAME_,
+                                    "checkpoint was trained on %ld elements\n",
+                                    resume->state.nu_positions);
+            }
+
+          positions = resume->positions;
+          exit_status = nnet_tset_permute (t_set, positions);
+        }
+      else
+        {
+          /* randomizes training set elements */
+          printf ("Randomizing training set... ");
+          fflush (stdout);
+
+          if (error_if_null
+              (positions = (ElementIndex *)
+               malloc (nu_positions * sizeof (ElementIndex)),
+               __PROG_NAME_, strerror (errno)))
+            return EXIT_FAILURE;
+
+          exit_status = nnet_tset_randomize_positions (t_set, positions);
+        }
+
+      if (error_if_failure (exit_status, __PROG_NAME_,
+                            "error ordering training set\n"))
+        {
+          puts ("FAILED");
+          return EXIT_FAILURE;
+        }
+      else
+        {
+          puts ("OK");
+        }
+
+      /* holds out the validation set */
+      if (val_size > 0 && trn_flag == TRUE)
+        {
+          if (val_size >= t_set->nu_elements)
+            return error_failure (__PROG_NAME_,
+                                  "validation set larger than the training set\n");
+
+          if (error_if_failure
+              (nnet_tset_divide (t_set, &v_set, "validation", val_size,
+                                 PICK_FROM_END), __PROG_NAME_,
+               "error holding out validation set\n"))
+            return EXIT_FAILURE;
+
+          if (error_if_null
+              (stop_rule = nnet_train_stop_create (val_epochs, val_patience,
+                                                   val_improvement),
+               __PROG_NAME_, "error creating early stopping rule\n"))
+            return EXIT_FAILURE;
+
+          if (error_if_null
+              (best_codebook = nnet_cbook_create (nnet->last_layer),
+               __PROG_NAME_, "error creating best weights codebook\n"))
+            return EXIT_FAILURE;
+
+          /* early stopping state of the interrupted run */
+          if (resume != NULL)
+            {
+              if (resume->state.nu_best_weights !=
+                  best_codebook->nu_units * best_codebook->dimension)
+                return error_failure (__PROG_NAME_,
+                                      "invalid best weights in checkpoint\n");
+
+              stop_rule->best_error = resume->state.best_error;
+              stop_rule->best_epoch = (DTime) resume->state.best_epoch;
+              stop_rule->bad_checks = (DTime) resume->state.bad_checks;
+
+              memcpy (best_codebook->weights, resume->best_weights,
+                      resume->state.nu_best_weights * sizeof (RValue));
+            }
+
+          printf ("Holding out %ld elements for validation\n",
+                  v_set->nu_elements);
+        }
+
+      /* per-epoch training order */
+      if (error_if_failure
+          (nnet_tset_set_training_order (t_set, shf_flag, shf_seed, shf_block),
+           __PROG_NAME_, "error setting training order\n"))
+        return EXIT_FAILURE;
     }
 
 
@@ -435,10 +1502,44 @@ main (int argc, char **argv)
     {
       /* Performs network training stage */
       t_start = time (NULL);
-      printf ("Starting SOM training (maximum epochs = %ld)\n", max_epochs);
+      printf ("Starting %s SOM training (maximum epochs = %ld)\n",
+              trn_algorithm == SOM_BATCH ? "batch" : "online", max_epochs);
       printf ("Neural network training started at %s", ctime (&t_start));
       fflush (stdout);
 
+      /* savepoints are written by a background thread */
+      if (save_epochs > 0 && tr_net_file != NULL)
+        {
+          if (error_if_null
+              (checkpoint = nnet_ckpt_create (nnet, bin_flag), __PROG_NAME_,
+               "error creating savepoint checkpoints\n"))
+            return EXIT_FAILURE;
+
+          /* binary savepoints can be resumed */
+          if (bin_flag == TRUE &&
+              error_if_failure
+              (nnet_ckpt_set_training (checkpoint, positions, nu_positions,
+                                       best_codebook), __PROG_NAME_,
+               "error setting savepoint training state\n"))
+            return EXIT_FAILURE;
+
+          memset (&tr_state, 0, sizeof (nnet_ckpt_state_type));
+          tr_state.algorithm = trn_algorithm;
+          tr_state.nu_threads = nu_threads;
+          tr_state.index_type = idx_type;
+          tr_state.index_rebuild = idx_rebuild;
+          tr_state.step_decay = dec_flag;
+          tr_state.shuffle = shf_flag;
+          tr_state.shuffle_seed = shf_seed;
+          tr_state.shuffle_block = shf_block;
+          tr_state.stream = str_flag;
+          tr_state.stream_chunk = str_chunk;
+          tr_state.validation_size = val_size;
+          tr_state.validation_epochs = val_epochs;
+          tr_state.patience = val_patience;
+          tr_state.min_improvement = val_improvement;
+        }
+
       for (epoch = first_epoch; epoch < max_epochs; epoch++)
         {
           /* time reset */
@@ -455,8 +1556,50 @@ main (int argc, char **argv)
                "error executing training epoch %ld\n", epoch))
             return EXIT_FAILURE;
 
+          /* checks the validation error */
+          if (stop_rule != NULL && (epoch + 1) % val_epochs == 0)
+            {
+              if (error_if_failure
+                  (nnet_som_quantization_error (som_nnet, v_set, &val_error),
+                   __PROG_NAME_, "error measuring validation error\n"))
+                return EXIT_FAILURE;
+
+              if (error_if_failure
+                  (nnet_train_stop_update (stop_rule, epoch, val_error,
+                                           &val_improved, &val_stop),
+                   __PROG_NAME_, "error updating early stopping rule\n"))
+                return EXIT_FAILURE;
+
+              printf ("\nEpoch %ld: validation quantization error %f%s\n",
+                      epoch, val_error, val_improved == TRUE ? " (best)" : "");
+
+              /* keeps the best weights so far */
+              if (val_improved == TRUE &&
+                  error_if_failure (nnet_cbook_load (best_codebook),
+                                    __PROG_NAME_,
+                                    "error saving best weights\n"))
+                return EXIT_FAILURE;
+
+              if (val_stop == TRUE)
+                {
+                  printf
+                    ("Validation error stopped improving: restoring epoch %ld weights\n",
+                     stop_rule->best_epoch);
+
+                  if (error_if_failure
+                      (nnet_cbook_store (best_codebook), __PROG_NAME_,
+                       "error restoring best weights\n") ||
+                      error_if_failure
+                      (nnet_som_release_codebook (som_nnet), __PROG_NAME_,
+                       "error releasing propagation codebook\n"))
+                    return EXIT_FAILURE;
+
+                  break;
+                }
+            }
+
           /* checks if savepoint is reached */
-          if (save_epochs > first_epoch && tr_net_file != NULL)
+          if (checkpoint != NULL)
             {
               if (epoch % save_epochs == 0 && epoch > 0)
                 {
@@ -465,21 +1608,34 @@ main (int argc, char **argv)
                   sv_net_file =
                     get_file_name (tr_net_dir, tr_net_base, sv_fext);
 
-                  /* creates savepoint file */
-                  if (error_if_null
-                      (sv_net_fd = fopen (sv_net_file, "w"), __PROG_NAME_,
-                       "error creating savepoint network file\n"))
-                    return EXIT_FAILURE;
+                  /* training state after this epoch */
+                  tr_state.time = epoch + 1;
+
+                  if (stop_rule != NULL)
+                    {
+                      tr_state.best_error = stop_rule->best_error;
+                      tr_state.best_epoch = stop_rule->best_epoch;
+                      tr_state.bad_checks = stop_rule->bad_checks;
+                    }
 
-                  /* writes the current neural network to savepoint file */
-                  nnet_file_write_nnetwork (nnet, TRUE, TRUE, TRUE, TRUE,
-                                            TRUE, sv_net_fd);
+                  /* writes the current weights in the background */
+                  if (error_if_failure
+                      (nnet_ckpt_save (checkpoint, sv_net_file,
+                                       bin_flag == TRUE ? &tr_state : NULL),
+                       __PROG_NAME_, "error saving savepoint network file\n"))
+                    return EXIT_FAILURE;
 
-                  fclose (sv_net_fd);
+                  free (sv_net_file);
                 }
             }
         }
 
+      /* waits for the last savepoint */
+      if (checkpoint != NULL &&
+          error_if_failure (nnet_ckpt_destroy (&checkpoint), __PROG_NAME_,
+                            "error writing savepoint network file\n"))
+        return EXIT_FAILURE;
+
       t_stop = time (NULL);
       printf ("Neural network training finished at %s", ctime (&t_stop));
 
@@ -487,6 +1643,19 @@ main (int argc, char **argv)
       training_duration = difftime (t_stop, t_start);
       printf ("Training stage lasted %ld seconds\n",
               (long) training_duration);
+
+      /* returns the validation elements to the training set */
+      if (v_set != NULL)
+        {
+          if (error_if_failure
+              (nnet_tset_merge (v_set, t_set), __PROG_NAME_,
+               "error merging validation set\n"))
+            return EXIT_FAILURE;
+
+          nnet_tset_destroy (&v_set, TRUE);
+          nnet_train_stop_destroy (&stop_rule);
+          nnet_cbook_destroy (&best_codebook);
+        }
     }
 
 
@@ -497,56 +1666,54 @@ main (int argc, char **argv)
  *                                                                            *
  ******************************************************************************/
 
+  /* Checks the winner search index against the exact search */
+  if (idx_type != CBIDX_LINEAR && file_mode == SINGLE_FILE &&
+      (sl_flag == TRUE || tm_flag == TRUE))
+    {
+      if (error_if_failure
+          (nnet_som_index_recall (som_nnet, t_set, &idx_recall,
+                                  &idx_evaluations), __PROG_NAME_,
+           "error checking winner search index\n"))
+        return EXIT_FAILURE;
+
+      printf ("Winner search index recall: %f (%f of %ld distances)\n",
+              idx_recall, idx_evaluations, output_dim);
+    }
+
+  /* Reports the winner tracking cost */
+  if (trk_flag == TRUE && file_mode == SINGLE_FILE &&
+      (sl_flag == TRUE || tm_flag == TRUE))
+    {
+      if (error_if_failure
+          (nnet_som_tracking_cost (som_nnet, t_set, &trk_distances),
+           __PROG_NAME_, "error checking winner tracking\n"))
+        return EXIT_FAILURE;
+
+      printf ("Winner tracking cost: %f of %ld distances\n",
+              trk_distances, output_dim);
+    }
+
   /* Loops through the training elements */
   if (sl_flag == TRUE || tm_flag == TRUE)
     {
       /* single/multi file */
       if (file_mode == SINGLE_FILE)
         {
-          /* generate the status list */
-          if (error_if_null
-              (winners = nnet_som_propagate_set (som_nnet, t_set),
-               __PROG_NAME_, "error propagating training set\n"))
-            return EXIT_FAILURE;
-
-          /* constructs the transition map */
           if (tm_flag == TRUE)
-            {
-              /* constructs transition map from winner indexes vector */
-              if (error_if_null
-                  (trmap =
-                   trmap_create_from_vector (output_dim, winners),
-                   __PROG_NAME_, "error creating state transition map\n"))
-                return EXIT_FAILURE;
+            printf
+              ("Using file '%s' to generate state transition map\n",
+               tm_file);
 
-              /* Writes state transition map to file */
-              printf
-                ("Using file '%s' to generate state transition map\n",
-                 tm_file);
-              tm_fd = fopen (tm_file, "w");
-              matrix_raw_info (trmap, tm_fd);
-              fclose (tm_fd);
-
-              /* Destroys state transition map */
-              if (error_if_failure
-                  (trmap_destroy (&trmap), __PROG_NAME_,
-                   "error destroying transition map\n"))
-                return EXIT_FAILURE;
-            }
-
-          /* writes states list to file */
           if (sl_flag == TRUE)
-            {
-              printf ("Using file '%s' to generate states list\n", sl_file);
-              sl_fd = fopen (sl_file, "w");
-              vector_raw_info (winners, sl_fd);
-              fclose (sl_fd);
-            }
+            printf ("Using file '%s' to generate states list\n", sl_file);
 
-          /* Destroys states list */
+          /* writes the transition map and states list */
           if (error_if_failure
-              (vector_destroy (&winners), __PROG_NAME_,
-               "error destroying states list\n"))
+              (write_set_states (som_nnet, t_set, output_dim,
+                                 tm_flag == TRUE ? tm_file : NULL,
+                                 sl_flag == TRUE ? sl_file : NULL,
+                                 smap_flag), __PROG_NAME_,
+               "error writing states of training set\n"))
             return EXIT_FAILURE;
         }
       else
@@ -581,62 +1748,31 @@ main (int argc, char **argv)
                        set_file))
                     return EXIT_FAILURE;
 
-                  /* generate the status list */
-                  if (error_if_null
-                      (winners =
-                       nnet_som_propagate_set (som_nnet, aux_set),
-                       __PROG_NAME_, "error propagating training set\n"))
+                  tm_file = NULL;
+                  sl_file = NULL;
+
+                  /* determines the transition map file name */
+                  if (tm_flag == TRUE && error_if_null
+                      (tm_file = get_file_name (tm_dir, set_file, tm_fext),
+                       __PROG_NAME_, "error defining map file name\n"))
                     return EXIT_FAILURE;
 
-                  /* constructs the transition map */
-                  if (tm_flag == TRUE)
-                    {
-                      /* determines the transition map file name */
-                      if (error_if_null
-                          (tm_file = get_file_name
-                           (tm_dir, set_file, tm_fext),
-                           __PROG_NAME_, "error defining map file name\n"))
-                        return EXIT_FAILURE;;
-
-                      /* constructs transition map from winners vector */
-                      if (error_if_null
-                          (trmap = trmap_create_from_vector
-                           (output_dim, winners), __PROG_NAME_,
-                           "error creating state transition map\n"))
-                        return EXIT_FAILURE;
-
-                      /* Writes state transition map to file */
-                      tm_fd = fopen (tm_file, "w");
-                      matrix_raw_info (trmap, tm_fd);
-                      fclose (tm_fd);
-
-                      /* Destroys state transition map */
-                      if (error_if_failure (trmap_destroy (&trmap),
-                                            __PROG_NAME_,
-                                            "error destroying transition map\n"))
-                        return EXIT_FAILURE;
-                      free (tm_file);
-                    }
+                  /* determines the states file name */
+                  if (sl_flag == TRUE && error_if_null
+                      (sl_file = get_file_name (sl_dir, set_file, sl_fext),
+                       __PROG_NAME_, "error defining states file name\n"))
+                    return EXIT_FAILURE;
+
+                  /* writes the transition map and states list */
+                  if (error_if_failure
+                      (write_set_states (som_nnet, aux_set, output_dim,
+                                         tm_file, sl_file, smap_flag),
+                       __PROG_NAME_,
+                       "error writing states of '%s'\n", set_file))
+                    return EXIT_FAILURE;
 
-                  if (sl_flag == TRUE)
-                  {
-                    /* determines the transition map file name */
-                    if (error_if_null
-                        (sl_file = get_file_name
-                         (sl_dir, set_file, sl_fext),
-                         __PROG_NAME_, "error defining states file name\n"))
-                      return EXIT_FAILURE;;
-
-                    /* writes states list to file */
-                    if (error_if_null
-                        (sl_fd = fopen (sl_file, "w"),
-                         __PROG_NAME_, "error creating states file\n"))
-                      return EXIT_FAILURE;;
-                    vector_raw_info (winners, sl_fd);
-                    fclose (sl_fd);
-
-                    free (sl_file);
-                  }
+                  free (tm_file);
+                  free (sl_file);
                 }
             }
         }
@@ -649,7 +1785,23 @@ main (int argc, char **argv)
  ******************************************************************************/
 
   /* Writes the trained network file */
-  if (tr_net_file != NULL && trn_flag == TRUE)
+  if (tr_net_file != NULL && trn_flag == TRUE && bin_flag == TRUE)
+    {
+      printf ("Using file '%s' to write trained neural network model... ",
+              tr_net_file);
+      fflush (stdout);
+
+      if (error_if_failure
+          (nnet_bin_write_nnetwork (nnet, tr_net_file), __PROG_NAME_,
+           "error writing trained network file\n"))
+        {
+          puts ("FAILED");
+          return EXIT_FAILURE;
+        }
+
+      puts ("OK");
+    }
+  else if (tr_net_file != NULL && trn_flag == TRUE)
     {
       if (error_if_null
           (tr_net_fd =
@@ -684,6 +1836,12 @@ main (int argc, char **argv)
       puts ("OK");
     }
 
+  /* Destroys the resumed training state */
+  if (resume != NULL)
+    nnet_ckpt_resume_destroy (&resume);
+  else
+    free (positions);
+
   /* Destroys the training set */
   printf ("Destroying training set... ");
   fflush (stdout);
@@ -365,13 +365,19 @@ get_file_name (const char *dir, const char *filename,
       if (dir[strlen (dir) - 1] == '/')
         file_name_size += strlen (dir);
       else
-        file_name_size += strlen (dir) - 1;
+        file_name_size += strlen (dir) + 1;
     }
 
   file_name_size += strlen (filename);
 
+  /* file names may have no extension to replace */
   if (new_extension != NULL)
-    file_name_size += strlen (new_extension) - strlen (file_extension);
+    {
+      file_name_size += strlen (new_extension);
+
+      if (file_extension != NULL)
+        file_name_size -= strlen (file_extension);
+    }
 
   /* allocates new file name */
   file_name_new = (char *) malloc (file_name_size);
@@ -612,7 +618,8 @@ getsafe_dword (FILE * in_file)
 /*
  * display_progress
  *
- * Displays progress of a process as a character representation
+ * Displays progress of a process as a character representation.
+ * Keeps the state of the bar being drawn: not to be shared by threads.
  */
 int
 display_progress (const long min, const long max, const long cur,
@@ -141,7 +141,8 @@ extern unsigned long getsafe_dword (FILE * in_file);
 /*
  * display_progress
  *
- * Displays progress of a process as a character representation
+ * Displays progress of a process as a character representation.
+ * Keeps the state of the bar being drawn: not to be shared by threads.
  */
 extern int
 display_progress (const long min, const long max, const long cur,
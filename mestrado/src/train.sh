@@ -5,5 +5,6 @@ nice -15 \
 -md data/speech_db/trmaps/ \
 --train --max-epochs 1000 \
 --save-epochs 50 \
+--binary-output \
 -on data/networks/som50.test.net \
 -in data/networks/som50.net
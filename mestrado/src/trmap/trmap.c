@@ -1,4 +1,7 @@
+#include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <string.h>
 #include "../common/types.h"
 #include "../errorh/errorh.h"
 #include "../vector/vector.h"
@@ -179,3 +182,58 @@ trmap_create_from_vector (const TMState dimension, const Vector input)
 
   return map;
 }
+
+
+
+/*
+ * trmap_create_from_file
+ *
+ * Creates a new transition map, reading its values from a file written
+ * by matrix_raw_info: one value per line, row by row
+ */
+TransitionMap
+trmap_create_from_file (const TMState dimension, const char *file_name)
+{
+  TransitionMap map = NULL;     /* new transition map */
+  FILE *map_fd = NULL;          /* map file */
+  TMState row, col;             /* current row and column */
+  int exit_status = EXIT_SUCCESS;       /* auxiliary function return status */
+
+
+  /* checks if the file name was actually passed */
+  if (file_name == NULL)
+    {
+      error_failure ("trmap_create_from_file", "no file name passed\n");
+      return NULL;
+    }
+
+  if ((map_fd = fopen (file_name, "r")) == NULL)
+    {
+      error_failure ("trmap_create_from_file", "error opening '%s': %s\n",
+                     file_name, strerror (errno));
+      return NULL;
+    }
+
+  if (error_if_null
+      (map = trmap_create (dimension, 0.0), "trmap_create_from_file",
+       "error creating new transition map\n"))
+    {
+      fclose (map_fd);
+      return NULL;
+    }
+
+  for (row = 0; row < dimension && exit_status == EXIT_SUCCESS; row++)
+    for (col = 0; col < dimension && exit_status == EXIT_SUCCESS; col++)
+      if (fscanf (map_fd, "%lf", &(map->elements[row][col])) != 1)
+        exit_status =
+          error_failure ("trmap_create_from_file",
+                         "'%s' has less than %ld x %ld values\n", file_name,
+                         dimension, dimension);
+
+  fclose (map_fd);
+
+  if (exit_status != EXIT_SUCCESS)
+    trmap_destroy (&map);
+
+  return map;
+}
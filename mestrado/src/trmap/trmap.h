@@ -84,4 +84,15 @@ trmap_create_from_vector (const TMState dimension, const Vector input);
 
 
 
+/*
+ * trmap_create_from_file
+ *
+ * Creates a new transition map, reading its values from a file written
+ * by matrix_raw_info
+ */
+extern TransitionMap
+trmap_create_from_file (const TMState dimension, const char *file_name);
+
+
+
 #endif /* __TRMAP_H_ */
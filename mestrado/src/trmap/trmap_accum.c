@@ -0,0 +1,281 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "../common/types.h"
+#include "../errorh/errorh.h"
+#include "../vector/vector.h"
+#include "trmap.h"
+#include "trmap_sparse.h"
+#include "trmap_score.h"
+#include "trmap_accum.h"
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                              PUBLIC OPERATIONS                             *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * trmap_accum_create
+ *
+ * Creates a new accumulator with an empty map of the given dimension,
+ * sparse or dense
+ */
+TMAccumulator
+trmap_accum_create (const TMState dimension, const BoolValue sparse)
+{
+  TMAccumulator new_accum;      /* new accumulator */
+
+
+  new_accum = (TMAccumulator) malloc (sizeof (trmap_accum_type));
+
+  if (new_accum == NULL)
+    {
+      error_failure ("trmap_accum_create", "virtual memory exhausted\n");
+      return NULL;
+    }
+
+  new_accum->dimension = dimension;
+  new_accum->previous = 0;
+  new_accum->nu_transitions = 0;
+  new_accum->map = NULL;
+  new_accum->sparse_map = NULL;
+  new_accum->live = NULL;
+
+  if (sparse == TRUE)
+    new_accum->sparse_map = trmap_sparse_create (dimension);
+  else
+    new_accum->map = trmap_create (dimension, 0.0);
+
+  if (new_accum->map == NULL && new_accum->sparse_map == NULL)
+    {
+      error_failure ("trmap_accum_create",
+                     "error creating new transition map\n");
+      free (new_accum);
+      return NULL;
+    }
+
+  return new_accum;
+}
+
+
+
+/*
+ * trmap_accum_destroy
+ *
+ * Destroys a previously created accumulator, its map and live scores
+ */
+int
+trmap_accum_destroy (TMAccumulator * accum)
+{
+  /* Checks if the accumulator was actually passed */
+  if (accum == NULL || *accum == NULL)
+    return error_failure ("trmap_accum_destroy",
+                          "no accumulator to destroy\n");
+
+  if ((*accum)->live != NULL)
+    trmap_live_destroy (&((*accum)->live));
+
+  if ((*accum)->map != NULL)
+    trmap_destroy (&((*accum)->map));
+
+  if ((*accum)->sparse_map != NULL)
+    trmap_sparse_destroy (&((*accum)->sparse_map));
+
+  free (*accum);
+  *accum = NULL;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * trmap_accum_attach_scorer
+ *
+ * Keeps live scores of the (dense) map against the speakers of the given
+ * scorer, replacing the live scores kept so far
+ */
+int
+trmap_accum_attach_scorer (TMAccumulator accum, const TMScorer scorer)
+{
+  /* Checks the parameters */
+  if (accum == NULL)
+    return error_failure ("trmap_accum_attach_scorer",
+                          "no accumulator passed\n");
+
+  if (accum->map == NULL)
+    return error_failure ("trmap_accum_attach_scorer",
+                          "live scores need a dense map\n");
+
+  if (accum->live != NULL)
+    trmap_live_destroy (&(accum->live));
+
+  if (error_if_null
+      (accum->live = trmap_live_create (scorer, accum->map),
+       "trmap_accum_attach_scorer", "error creating live scores\n"))
+    return EXIT_FAILURE;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * trmap_accum_state
+ *
+ * Registers the transition from the previous state to the given one.
+ * Dense maps are updated in place, with no matrix bounds checks beyond
+ * the state's own.
+ */
+int
+trmap_accum_state (TMAccumulator accum, const TMState state)
+{
+  TMState previous;             /* origin of the transition */
+
+
+  /* Checks the parameters */
+  if (accum == NULL)
+    return error_failure ("trmap_accum_state", "no accumulator passed\n");
+
+  if (state < 1 || state > accum->dimension)
+    return error_failure ("trmap_accum_state", "invalid state: %ld\n",
+                          state);
+
+  previous = accum->previous;
+  accum->previous = state;
+
+  /* The first state of a sequence has no transition */
+  if (previous == 0)
+    return EXIT_SUCCESS;
+
+  if (accum->map != NULL)
+    accum->map->elements[state - 1][previous - 1] += 1.0;
+  else if (error_if_failure
+           (trmap_sparse_transition (accum->sparse_map, previous, state),
+            "trmap_accum_state",
+            "error registering transition from state %ld to state %ld\n",
+            previous, state))
+    return EXIT_FAILURE;
+
+  accum->nu_transitions++;
+
+  if (accum->live != NULL)
+    return trmap_live_update (accum->live, accum->map, previous);
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * trmap_accum_vector
+ *
+ * Registers the states of the given vector, in order
+ */
+int
+trmap_accum_vector (TMAccumulator accum, const Vector states)
+{
+  UsLgIntValue cur_comp;        /* current vector component */
+
+
+  /* Checks if the vector was actually passed */
+  if (states == NULL)
+    return error_failure ("trmap_accum_vector", "no states vector passed\n");
+
+  for (cur_comp = 0; cur_comp < states->dimension; cur_comp++)
+    if (error_if_failure
+        (trmap_accum_state (accum, (TMState) states->value[cur_comp]),
+         "trmap_accum_vector", "error registering state %ld\n",
+         cur_comp + 1))
+      return EXIT_FAILURE;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * trmap_accum_restart
+ *
+ * Starts a new sequence of states: the next state has no previous one
+ */
+int
+trmap_accum_restart (TMAccumulator accum)
+{
+  /* Checks if the accumulator was actually passed */
+  if (accum == NULL)
+    return error_failure ("trmap_accum_restart", "no accumulator passed\n");
+
+  accum->previous = 0;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * trmap_accum_reset
+ *
+ * Clears the map and the live scores and starts a new sequence of states.
+ * A sparse map, which may have been compacted, is created anew.
+ */
+int
+trmap_accum_reset (TMAccumulator accum)
+{
+  TMState origin;               /* current origin state */
+
+
+  /* Checks if the accumulator was actually passed */
+  if (accum == NULL)
+    return error_failure ("trmap_accum_reset", "no accumulator passed\n");
+
+  accum->previous = 0;
+  accum->nu_transitions = 0;
+
+  if (accum->sparse_map != NULL)
+    {
+      trmap_sparse_destroy (&(accum->sparse_map));
+
+      if (error_if_null
+          (accum->sparse_map = trmap_sparse_create (accum->dimension),
+           "trmap_accum_reset", "error creating new transition map\n"))
+        return EXIT_FAILURE;
+
+      return EXIT_SUCCESS;
+    }
+
+  if (error_if_failure
+      (trmap_reset (accum->map, 0.0), "trmap_accum_reset",
+       "error clearing transition map\n"))
+    return EXIT_FAILURE;
+
+  if (accum->live != NULL)
+    for (origin = 1; origin <= accum->dimension; origin++)
+      if (trmap_live_update (accum->live, accum->map, origin) !=
+          EXIT_SUCCESS)
+        return EXIT_FAILURE;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * trmap_accum_best
+ *
+ * Returns the 'k' speakers closest to the map so far, closest first
+ */
+int
+trmap_accum_best (const TMAccumulator accum, const UsLgIntValue k,
+                  UsLgIntValue * speaker_ids, RValue * scores,
+                  UsLgIntValue * nu_results)
+{
+  /* Checks the parameters */
+  if (accum == NULL || accum->live == NULL)
+    return error_failure ("trmap_accum_best",
+                          "no accumulator with live scores passed\n");
+
+  return trmap_live_best (accum->live, k, speaker_ids, scores, nu_results);
+}
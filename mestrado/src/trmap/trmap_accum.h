@@ -0,0 +1,135 @@
+#ifndef __TRMAP_ACCUM_H_
+#define __TRMAP_ACCUM_H_ 1
+
+#include "../common/types.h"
+#include "../vector/vector.h"
+#include "trmap.h"
+#include "trmap_sparse.h"
+#include "trmap_score.h"
+
+
+/******************************************************************************
+ *                                                                            *
+ *                     TRANSITION MAP ACCUMULATOR DATATYPES                   *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * trmap_accum_type
+ *
+ * Builds a transition map from a stream of states, one state at a time,
+ * as the winners are found. Each state registers the transition from the
+ * previous one. The map is either dense or sparse; a dense map may also
+ * keep live scores against the speakers of a scorer, updated with each
+ * state.
+ */
+typedef struct
+{
+  TMState dimension;            /* number of states */
+  TMState previous;             /* last state (0: none yet) */
+  UsLgIntValue nu_transitions;  /* transitions registered */
+  TransitionMap map;            /* dense map, or NULL */
+  SparseTransitionMap sparse_map;       /* sparse map, or NULL */
+  TMLiveScore live;             /* live speaker scores, or NULL */
+}
+trmap_accum_type;
+
+
+/* Symbolic type */
+typedef trmap_accum_type *TMAccumulator;
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                            STRUCTURAL OPERATIONS                           *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * trmap_accum_create
+ *
+ * Creates a new accumulator with an empty map of the given dimension,
+ * sparse or dense
+ */
+extern TMAccumulator
+trmap_accum_create (const TMState dimension, const BoolValue sparse);
+
+
+
+/*
+ * trmap_accum_destroy
+ *
+ * Destroys a previously created accumulator, its map and live scores
+ */
+extern int trmap_accum_destroy (TMAccumulator * accum);
+
+
+
+/*
+ * trmap_accum_attach_scorer
+ *
+ * Keeps live scores of the (dense) map against the speakers of the given
+ * scorer, from the transitions registered so far on
+ */
+extern int
+trmap_accum_attach_scorer (TMAccumulator accum, const TMScorer scorer);
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                            FUNCTIONAL OPERATIONS                           *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * trmap_accum_state
+ *
+ * Registers the transition from the previous state to the given one
+ * (starting at 1)
+ */
+extern int trmap_accum_state (TMAccumulator accum, const TMState state);
+
+
+
+/*
+ * trmap_accum_vector
+ *
+ * Registers the states of the given vector, in order
+ */
+extern int trmap_accum_vector (TMAccumulator accum, const Vector states);
+
+
+
+/*
+ * trmap_accum_restart
+ *
+ * Starts a new sequence of states: the next state has no previous one
+ */
+extern int trmap_accum_restart (TMAccumulator accum);
+
+
+
+/*
+ * trmap_accum_reset
+ *
+ * Clears the map and the live scores and starts a new sequence of states
+ */
+extern int trmap_accum_reset (TMAccumulator accum);
+
+
+
+/*
+ * trmap_accum_best
+ *
+ * Returns the 'k' speakers closest to the map so far, closest first
+ */
+extern int
+trmap_accum_best (const TMAccumulator accum, const UsLgIntValue k,
+                  UsLgIntValue * speaker_ids, RValue * scores,
+                  UsLgIntValue * nu_results);
+
+
+
+#endif /* __TRMAP_ACCUM_H_ */
@@ -0,0 +1,1041 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include "../common/types.h"
+#include "../errorh/errorh.h"
+#include "../matrix/matrix.h"
+#include "trmap.h"
+#include "trmap_sparse.h"
+#include "trmap_score.h"
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                             PRIVATE OPERATIONS                             *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * trmap_score_aligned_block
+ *
+ * Allocates room for the given number of values, returning its first
+ * address aligned to TRMAP_SCORE_ALIGN bytes. The allocated block, which
+ * must be freed instead, is returned in 'block'.
+ */
+static RValue *
+trmap_score_aligned_block (const size_t nu_values, void **block)
+{
+  size_t misalignment;          /* bytes past the last aligned address */
+
+
+  *block = malloc (nu_values * sizeof (RValue) + TRMAP_SCORE_ALIGN);
+
+  if (*block == NULL)
+    return NULL;
+
+  misalignment = (size_t) *block % TRMAP_SCORE_ALIGN;
+
+  if (misalignment == 0)
+    return (RValue *) *block;
+
+  return (RValue *) ((char *) *block + TRMAP_SCORE_ALIGN - misalignment);
+}
+
+
+
+/*
+ * trmap_score_row_probabilities
+ *
+ * Stores the smoothed probabilities of the transitions from the given
+ * origin state (starting at 0) of the map in 'row'. An origin state with
+ * no transitions and no smoothing gets zero probabilities.
+ */
+static void
+trmap_score_row_probabilities (const TransitionMap map,
+                               const TMState dimension, const TMState origin,
+                               const RValue smoothing, RValue * row)
+{
+  TMState dest;                 /* destination state (row) */
+  RValue total;                 /* smoothed transitions from the origin */
+
+
+  total = smoothing * (RValue) dimension;
+
+  for (dest = 0; dest < dimension; dest++)
+    {
+      row[dest] = map->elements[dest][origin] + smoothing;
+      total += map->elements[dest][origin];
+    }
+
+  if (total > 0.0)
+    for (dest = 0; dest < dimension; dest++)
+      row[dest] /= total;
+  else
+    for (dest = 0; dest < dimension; dest++)
+      row[dest] = 0.0;
+}
+
+
+
+/*
+ * trmap_score_probabilities
+ *
+ * Stores the smoothed transition probabilities of the given map in
+ * 'probs', origin state major
+ */
+static int
+trmap_score_probabilities (const TransitionMap map, const TMState dimension,
+                           const RValue smoothing, RValue * probs)
+{
+  TMState origin;               /* origin state (column) */
+
+
+  /* Checks if the map was actually passed */
+  if (map == NULL)
+    return error_failure ("trmap_score_probabilities",
+                          "no transition map passed\n");
+
+  if (map->rows != dimension || map->columns != dimension)
+    return error_failure ("trmap_score_probabilities",
+                          "map has %ldx%ld states, expected %ld\n",
+                          map->rows, map->columns, dimension);
+
+  for (origin = 0; origin < dimension; origin++)
+    trmap_score_row_probabilities (map, dimension, origin, smoothing,
+                                   &(probs[origin * dimension]));
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * trmap_score_l1
+ *
+ * Sum of the absolute differences of two probability vectors.
+ * The kernels keep four independent partial sums, which the compiler can
+ * map to vector registers without reordering any single sum.
+ */
+static RValue
+trmap_score_l1 (const RValue * q, const RValue * r, const size_t n)
+{
+  RValue s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;        /* partial sums */
+  size_t i;                     /* current value */
+
+
+  for (i = 0; i + 4 <= n; i += 4)
+    {
+      s0 += fabs (q[i] - r[i]);
+      s1 += fabs (q[i + 1] - r[i + 1]);
+      s2 += fabs (q[i + 2] - r[i + 2]);
+      s3 += fabs (q[i + 3] - r[i + 3]);
+    }
+
+  for (; i < n; i++)
+    s0 += fabs (q[i] - r[i]);
+
+  return (s0 + s1) + (s2 + s3);
+}
+
+
+
+/*
+ * trmap_score_chi_term
+ *
+ * Chi-square term of two probabilities. The difference is zero when the
+ * sum is, so adding DBL_MIN to the sum keeps the term zero then, with no
+ * branch; it vanishes against any sum of normal probabilities.
+ */
+static RValue
+trmap_score_chi_term (const RValue q, const RValue r)
+{
+  return (q - r) * (q - r) / (q + r + DBL_MIN);
+}
+
+
+
+/*
+ * trmap_score_chi_square
+ *
+ * Symmetric chi-square distance of two probability vectors
+ */
+static RValue
+trmap_score_chi_square (const RValue * q, const RValue * r, const size_t n)
+{
+  RValue s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;        /* partial sums */
+  size_t i;                     /* current value */
+
+
+  for (i = 0; i + 4 <= n; i += 4)
+    {
+      s0 += trmap_score_chi_term (q[i], r[i]);
+      s1 += trmap_score_chi_term (q[i + 1], r[i + 1]);
+      s2 += trmap_score_chi_term (q[i + 2], r[i + 2]);
+      s3 += trmap_score_chi_term (q[i + 3], r[i + 3]);
+    }
+
+  for (; i < n; i++)
+    s0 += trmap_score_chi_term (q[i], r[i]);
+
+  return (s0 + s1) + (s2 + s3);
+}
+
+
+
+/*
+ * trmap_score_dot
+ *
+ * Dot product of a probability vector and a log-probability vector
+ */
+static RValue
+trmap_score_dot (const RValue * q, const RValue * log_r, const size_t n)
+{
+  RValue s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;        /* partial sums */
+  size_t i;                     /* current value */
+
+
+  for (i = 0; i + 4 <= n; i += 4)
+    {
+      s0 += q[i] * log_r[i];
+      s1 += q[i + 1] * log_r[i + 1];
+      s2 += q[i + 2] * log_r[i + 2];
+      s3 += q[i + 3] * log_r[i + 3];
+    }
+
+  for (; i < n; i++)
+    s0 += q[i] * log_r[i];
+
+  return (s0 + s1) + (s2 + s3);
+}
+
+
+
+/*
+ * trmap_score_keep
+ *
+ * Inserts a speaker score in the 'k' best results found so far, kept
+ * sorted closest first, if it is one of them
+ */
+static void
+trmap_score_keep (const RValue score, const UsLgIntValue speaker_id,
+                  const UsLgIntValue k, UsLgIntValue * speaker_ids,
+                  RValue * scores, UsLgIntValue * nu_results)
+{
+  UsLgIntValue pos;             /* insertion position in the results */
+
+
+  if (*nu_results == k && score >= scores[k - 1])
+    return;
+
+  pos = (*nu_results < k) ? (*nu_results)++ : k - 1;
+
+  while (pos > 0 && scores[pos - 1] > score)
+    {
+      scores[pos] = scores[pos - 1];
+      speaker_ids[pos] = speaker_ids[pos - 1];
+      pos--;
+    }
+
+  scores[pos] = score;
+  speaker_ids[pos] = speaker_id;
+}
+
+
+
+/*
+ * trmap_score_term
+ *
+ * Term of the given metric for one pair of probabilities
+ */
+static RValue
+trmap_score_term (const TMScoreMetric metric, const RValue q, const RValue r)
+{
+  switch (metric)
+    {
+    case TMSCORE_L1:
+      return fabs (q - r);
+
+    case TMSCORE_CHI_SQUARE:
+      return trmap_score_chi_term (q, r);
+
+    default:
+      return (q > 0.0) ? q * log (q / r) : 0.0;
+    }
+}
+
+
+
+/*
+ * trmap_score_sparse_row
+ *
+ * Distance between the transitions from one origin state of two sparse
+ * maps. Only the destinations stored in either row are visited: the
+ * others have no count in both maps, so they all share the term of the
+ * two smoothed zero probabilities, which is counted once for all.
+ */
+static RValue
+trmap_score_sparse_row (const SparseTransitionMap query,
+                        const SparseTransitionMap reference,
+                        const TMState origin, const TMScoreMetric metric,
+                        const RValue smoothing)
+{
+  RValue q_scale = 0.0;         /* inverse of the smoothed query total */
+  RValue r_scale = 0.0;         /* inverse of the smoothed reference total */
+  RValue total;                 /* smoothed transitions from the origin */
+  UsLgIntValue i, i_end;        /* positions of the query row */
+  UsLgIntValue j, j_end;        /* positions of the reference row */
+  TMState visited = 0;          /* destinations stored in either row */
+  RValue q, r;                  /* probabilities of the current destination */
+  RValue distance = 0.0;        /* distance of the row */
+
+
+  total = query->totals[origin] + smoothing * (RValue) query->dimension;
+  if (total > 0.0)
+    q_scale = 1.0 / total;
+
+  total = reference->totals[origin] + smoothing * (RValue) query->dimension;
+  if (total > 0.0)
+    r_scale = 1.0 / total;
+
+  i = query->row_start[origin];
+  i_end = query->row_start[origin + 1];
+  j = reference->row_start[origin];
+  j_end = reference->row_start[origin + 1];
+
+  /* Merges the two rows by destination */
+  while (i < i_end || j < j_end)
+    {
+      q = smoothing;
+      r = smoothing;
+
+      if (j == j_end || (i < i_end &&
+                         query->destinations[i] <
+                         reference->destinations[j]))
+        q += query->counts[i++];
+      else if (i == i_end ||
+               reference->destinations[j] < query->destinations[i])
+        r += reference->counts[j++];
+      else
+        {
+          q += query->counts[i++];
+          r += reference->counts[j++];
+        }
+
+      distance += trmap_score_term (metric, q * q_scale, r * r_scale);
+      visited++;
+    }
+
+  if (visited < query->dimension)
+    distance += (RValue) (query->dimension - visited) *
+      trmap_score_term (metric, smoothing * q_scale, smoothing * r_scale);
+
+  return distance;
+}
+
+
+
+/*
+ * trmap_live_row
+ *
+ * Updates the distances of the transitions from the given origin state
+ * (starting at 0) of the map to the same origin of every speaker
+ */
+static void
+trmap_live_row (TMLiveScore live, const TransitionMap map,
+                const TMState origin)
+{
+  const TMScorer scorer = live->scorer;        /* reference maps */
+  size_t dimension;             /* number of states */
+  const RValue *reference;      /* reference row */
+  RValue entropy = 0.0;         /* sum of q log q of the row */
+  UsLgIntValue cur_spk;         /* current speaker */
+  size_t i;                     /* current value */
+
+
+  dimension = (size_t) scorer->dimension;
+
+  trmap_score_row_probabilities (map, scorer->dimension, origin,
+                                 scorer->smoothing, live->probs);
+
+  if (scorer->metric == TMSCORE_KL)
+    for (i = 0; i < dimension; i++)
+      if (live->probs[i] > 0.0)
+        entropy += live->probs[i] * log (live->probs[i]);
+
+  for (cur_spk = 0; cur_spk < live->nu_speakers; cur_spk++)
+    {
+      reference = &(scorer->references[(cur_spk * dimension + origin) *
+                                       dimension]);
+
+      switch (scorer->metric)
+        {
+        case TMSCORE_L1:
+          live->row_scores[cur_spk * dimension + origin] =
+            trmap_score_l1 (live->probs, reference, dimension);
+          break;
+
+        case TMSCORE_CHI_SQUARE:
+          live->row_scores[cur_spk * dimension + origin] =
+            trmap_score_chi_square (live->probs, reference, dimension);
+          break;
+
+        default:
+          live->row_scores[cur_spk * dimension + origin] =
+            entropy - trmap_score_dot (live->probs, reference, dimension);
+          break;
+        }
+    }
+}
+
+
+
+/*
+ * trmap_score_read_line
+ *
+ * Reads the next line of a list that is neither blank nor a comment,
+ * without its leading spaces and line break. Returns EXIT_FAILURE at the
+ * end of the list.
+ */
+static int
+trmap_score_read_line (FILE * list_fd, char *line)
+{
+  char *start;                  /* first character of the line */
+  size_t length;                /* line length */
+
+
+  while (fgets (line, FILE_NAME_SIZE, list_fd) != NULL)
+    {
+      for (start = line; *start == ' ' || *start == '\t'; start++)
+        ;
+
+      length = strlen (start);
+
+      while (length > 0 &&
+             (start[length - 1] == '\n' || start[length - 1] == '\r'))
+        start[--length] = '\0';
+
+      if (length > 0 && *start != IGNORE_TOKEN)
+        {
+          memmove (line, start, length + 1);
+          return EXIT_SUCCESS;
+        }
+    }
+
+  return EXIT_FAILURE;
+}
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                              PUBLIC OPERATIONS                             *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * trmap_scorer_create
+ *
+ * Creates a new scorer of maps of the given dimension, with no speakers
+ */
+TMScorer
+trmap_scorer_create (const TMState dimension, const TMScoreMetric metric,
+                     const RValue smoothing)
+{
+  TMScorer new_scorer;          /* new scorer */
+
+
+  if (dimension < 1)
+    {
+      error_failure ("trmap_scorer_create", "invalid dimension: %ld\n",
+                     dimension);
+      return NULL;
+    }
+
+  if (metric != TMSCORE_L1 && metric != TMSCORE_CHI_SQUARE &&
+      metric != TMSCORE_KL)
+    {
+      error_failure ("trmap_scorer_create", "invalid metric\n");
+      return NULL;
+    }
+
+  if (smoothing < 0.0 || (metric == TMSCORE_KL && smoothing <= 0.0))
+    {
+      error_failure ("trmap_scorer_create",
+                     "invalid smoothing for this metric: %f\n", smoothing);
+      return NULL;
+    }
+
+  new_scorer = (TMScorer) malloc (sizeof (trmap_scorer_type));
+
+  if (new_scorer == NULL)
+    {
+      error_failure ("trmap_scorer_create", "virtual memory exhausted\n");
+      return NULL;
+    }
+
+  new_scorer->dimension = dimension;
+  new_scorer->metric = metric;
+  new_scorer->smoothing = smoothing;
+  new_scorer->nu_speakers = 0;
+  new_scorer->capacity = 0;
+  new_scorer->speaker_ids = NULL;
+  new_scorer->references = NULL;
+  new_scorer->block = NULL;
+
+  return new_scorer;
+}
+
+
+
+/*
+ * trmap_scorer_destroy
+ *
+ * Destroys a previously created scorer
+ */
+int
+trmap_scorer_destroy (TMScorer * scorer)
+{
+  /* Checks if the scorer was actually passed */
+  if (scorer == NULL || *scorer == NULL)
+    return error_failure ("trmap_scorer_destroy", "no scorer to destroy\n");
+
+  free ((*scorer)->speaker_ids);
+  free ((*scorer)->block);
+  free (*scorer);
+  *scorer = NULL;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * trmap_scorer_add
+ *
+ * Adds the reference map of the given speaker to the scorer. The tensor
+ * doubles its capacity when full.
+ */
+int
+trmap_scorer_add (TMScorer scorer, const UsLgIntValue speaker_id,
+                  const TransitionMap map)
+{
+  size_t map_size;              /* values of one map */
+  UsLgIntValue new_capacity;    /* enlarged capacity */
+  UsLgIntValue *new_ids;        /* enlarged speaker ids */
+  RValue *new_references;       /* enlarged tensor */
+  void *new_block;              /* enlarged tensor allocation */
+  RValue *reference;            /* values of the new map */
+  size_t i;                     /* current value */
+
+
+  /* Checks if the scorer was actually passed */
+  if (scorer == NULL)
+    return error_failure ("trmap_scorer_add", "no scorer passed\n");
+
+  map_size = (size_t) scorer->dimension * (size_t) scorer->dimension;
+
+  /* Enlarges the tensor */
+  if (scorer->nu_speakers == scorer->capacity)
+    {
+      new_capacity = (scorer->capacity == 0) ? 16 : 2 * scorer->capacity;
+
+      new_ids = (UsLgIntValue *)
+        realloc (scorer->speaker_ids, new_capacity * sizeof (UsLgIntValue));
+
+      if (new_ids == NULL)
+        return error_failure ("trmap_scorer_add",
+                              "virtual memory exhausted\n");
+
+      scorer->speaker_ids = new_ids;
+
+      new_references =
+        trmap_score_aligned_block (new_capacity * map_size, &new_block);
+
+      if (new_references == NULL)
+        return error_failure ("trmap_scorer_add",
+                              "virtual memory exhausted\n");
+
+      if (scorer->nu_speakers > 0)
+        memcpy (new_references, scorer->references,
+                scorer->nu_speakers * map_size * sizeof (RValue));
+
+      free (scorer->block);
+      scorer->references = new_references;
+      scorer->block = new_block;
+      scorer->capacity = new_capacity;
+    }
+
+  reference = &(scorer->references[scorer->nu_speakers * map_size]);
+
+  if (error_if_failure
+      (trmap_score_probabilities (map, scorer->dimension, scorer->smoothing,
+                                  reference), "trmap_scorer_add",
+       "error normalizing map of speaker %lu\n", speaker_id))
+    return EXIT_FAILURE;
+
+  /* KL divergences need the logarithms only */
+  if (scorer->metric == TMSCORE_KL)
+    for (i = 0; i < map_size; i++)
+      reference[i] = log (reference[i]);
+
+  scorer->speaker_ids[scorer->nu_speakers] = speaker_id;
+  scorer->nu_speakers++;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * trmap_scorer_create_from_list
+ *
+ * Creates a scorer with the reference maps of the given list: two lines
+ * per speaker, its id and its map file, dense or sparse. Blank lines and
+ * comments are skipped.
+ */
+TMScorer
+trmap_scorer_create_from_list (const char *list_file_name,
+                               const TMState dimension,
+                               const TMScoreMetric metric,
+                               const RValue smoothing)
+{
+  TMScorer scorer = NULL;       /* new scorer */
+  TransitionMap map = NULL;     /* current reference map */
+  FILE *list_fd = NULL;         /* reference list */
+  FileName line = "";           /* current line */
+  UsLgIntValue speaker_id;      /* current speaker */
+  char *end = NULL;             /* end of the speaker id */
+  int exit_status = EXIT_SUCCESS;       /* auxiliary function return status */
+
+
+  /* checks if the file name was actually passed */
+  if (list_file_name == NULL)
+    {
+      error_failure ("trmap_scorer_create_from_list",
+                     "no file name passed\n");
+      return NULL;
+    }
+
+  if ((list_fd = fopen (list_file_name, "r")) == NULL)
+    {
+      error_failure ("trmap_scorer_create_from_list",
+                     "error opening '%s': %s\n", list_file_name,
+                     strerror (errno));
+      return NULL;
+    }
+
+  if (error_if_null
+      (scorer = trmap_scorer_create (dimension, metric, smoothing),
+       "trmap_scorer_create_from_list", "error creating scorer\n"))
+    {
+      fclose (list_fd);
+      return NULL;
+    }
+
+  while (exit_status == EXIT_SUCCESS &&
+         trmap_score_read_line (list_fd, line) == EXIT_SUCCESS)
+    {
+      speaker_id = strtoul (line, &end, 10);
+
+      if (end == line || *end != '\0')
+        exit_status =
+          error_failure ("trmap_scorer_create_from_list",
+                         "invalid speaker id '%s' in '%s'\n", line,
+                         list_file_name);
+      else if (trmap_score_read_line (list_fd, line) != EXIT_SUCCESS)
+        exit_status =
+          error_failure ("trmap_scorer_create_from_list",
+                         "no map for speaker %lu in '%s'\n", speaker_id,
+                         list_file_name);
+      else if ((map = trmap_sparse_read_dense (dimension, line)) == NULL)
+        exit_status = EXIT_FAILURE;
+      else
+        {
+          exit_status = trmap_scorer_add (scorer, speaker_id, map);
+          trmap_destroy (&map);
+        }
+    }
+
+  fclose (list_fd);
+
+  if (exit_status == EXIT_SUCCESS && scorer->nu_speakers == 0)
+    exit_status = error_failure ("trmap_scorer_create_from_list",
+                                 "no speakers in '%s'\n", list_file_name);
+
+  if (exit_status != EXIT_SUCCESS)
+    trmap_scorer_destroy (&scorer);
+
+  return scorer;
+}
+
+
+
+/*
+ * trmap_scorer_score
+ *
+ * Scores the given query map against all the speakers, returning the 'k'
+ * closest ones, closest first
+ */
+int
+trmap_scorer_score (const TMScorer scorer, const TransitionMap query,
+                    const UsLgIntValue k, UsLgIntValue * speaker_ids,
+                    RValue * scores, UsLgIntValue * nu_results)
+{
+  size_t map_size;              /* values of one map */
+  RValue *probs;                /* query probabilities */
+  void *block;                  /* query probabilities allocation */
+  RValue entropy = 0.0;         /* sum of q log q of the query */
+  RValue score;                 /* distance to the current speaker */
+  UsLgIntValue cur_spk;         /* current speaker */
+  const RValue *reference;      /* current reference map */
+  size_t i;                     /* current value */
+
+
+  /* Checks the parameters */
+  if (scorer == NULL)
+    return error_failure ("trmap_scorer_score", "no scorer passed\n");
+
+  if (speaker_ids == NULL || scores == NULL || nu_results == NULL)
+    return error_failure ("trmap_scorer_score", "no results passed\n");
+
+  *nu_results = 0;
+
+  if (k == 0 || scorer->nu_speakers == 0)
+    return EXIT_SUCCESS;
+
+  map_size = (size_t) scorer->dimension * (size_t) scorer->dimension;
+
+  /* Normalizes the query once */
+  if (error_if_null (probs = trmap_score_aligned_block (map_size, &block),
+                     "trmap_scorer_score", "virtual memory exhausted\n"))
+    return EXIT_FAILURE;
+
+  if (error_if_failure
+      (trmap_score_probabilities (query, scorer->dimension, scorer->smoothing,
+                                  probs), "trmap_scorer_score",
+       "error normalizing query map\n"))
+    {
+      free (block);
+      return EXIT_FAILURE;
+    }
+
+  if (scorer->metric == TMSCORE_KL)
+    for (i = 0; i < map_size; i++)
+      if (probs[i] > 0.0)
+        entropy += probs[i] * log (probs[i]);
+
+  /* One pass over the reference tensor, keeping the k closest */
+  for (cur_spk = 0; cur_spk < scorer->nu_speakers; cur_spk++)
+    {
+      reference = &(scorer->references[cur_spk * map_size]);
+
+      switch (scorer->metric)
+        {
+        case TMSCORE_L1:
+          score = trmap_score_l1 (probs, reference, map_size);
+          break;
+
+        case TMSCORE_CHI_SQUARE:
+          score = trmap_score_chi_square (probs, reference, map_size);
+          break;
+
+        default:
+          score = entropy - trmap_score_dot (probs, reference, map_size);
+          break;
+        }
+
+      trmap_score_keep (score, scorer->speaker_ids[cur_spk], k, speaker_ids,
+                        scores, nu_results);
+    }
+
+  free (block);
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * trmap_score_metric_by_name
+ *
+ * Gets the metric with the given name: "l1", "chi2" or "kl"
+ */
+int
+trmap_score_metric_by_name (const char *name, TMScoreMetric * metric)
+{
+  if (name == NULL)
+    return error_failure ("trmap_score_metric_by_name", "no name passed\n");
+
+  if (strcmp (name, "l1") == 0)
+    *metric = TMSCORE_L1;
+  else if (strcmp (name, "chi2") == 0)
+    *metric = TMSCORE_CHI_SQUARE;
+  else if (strcmp (name, "kl") == 0)
+    *metric = TMSCORE_KL;
+  else
+    return error_failure ("trmap_score_metric_by_name",
+                          "unknown metric '%s'\n", name);
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * trmap_score_sparse_distance
+ *
+ * Distance between the smoothed transition probabilities of two compacted
+ * sparse maps, visiting only the transitions stored in them
+ */
+int
+trmap_score_sparse_distance (const SparseTransitionMap query,
+                             const SparseTransitionMap reference,
+                             const TMScoreMetric metric,
+                             const RValue smoothing, RValue * distance)
+{
+  TMState origin;               /* current origin state */
+
+
+  /* Checks the parameters */
+  if (query == NULL || reference == NULL || query->compacted == FALSE ||
+      reference->compacted == FALSE)
+    return error_failure ("trmap_score_sparse_distance",
+                          "no compacted transition maps passed\n");
+
+  if (query->dimension != reference->dimension)
+    return error_failure ("trmap_score_sparse_distance",
+                          "maps have %ld and %ld states\n",
+                          query->dimension, reference->dimension);
+
+  if (metric != TMSCORE_L1 && metric != TMSCORE_CHI_SQUARE &&
+      metric != TMSCORE_KL)
+    return error_failure ("trmap_score_sparse_distance", "invalid metric\n");
+
+  if (smoothing < 0.0 || (metric == TMSCORE_KL && smoothing <= 0.0))
+    return error_failure ("trmap_score_sparse_distance",
+                          "invalid smoothing for this metric: %f\n",
+                          smoothing);
+
+  if (distance == NULL)
+    return error_failure ("trmap_score_sparse_distance",
+                          "no distance passed\n");
+
+  *distance = 0.0;
+
+  for (origin = 0; origin < query->dimension; origin++)
+    *distance += trmap_score_sparse_row (query, reference, origin, metric,
+                                         smoothing);
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * trmap_score_sparse
+ *
+ * Scores the given sparse query map against the sparse reference maps of
+ * all the speakers, returning the 'k' closest ones, closest first
+ */
+int
+trmap_score_sparse (const SparseTransitionMap query,
+                    const SparseTransitionMap * references,
+                    const UsLgIntValue * reference_ids,
+                    const UsLgIntValue nu_references,
+                    const TMScoreMetric metric, const RValue smoothing,
+                    const UsLgIntValue k, UsLgIntValue * speaker_ids,
+                    RValue * scores, UsLgIntValue * nu_results)
+{
+  RValue score;                 /* distance to the current speaker */
+  UsLgIntValue cur_spk;         /* current speaker */
+
+
+  /* Checks the parameters */
+  if (references == NULL && nu_references > 0)
+    return error_failure ("trmap_score_sparse", "no references passed\n");
+
+  if (speaker_ids == NULL || scores == NULL || nu_results == NULL)
+    return error_failure ("trmap_score_sparse", "no results passed\n");
+
+  *nu_results = 0;
+
+  if (k == 0)
+    return EXIT_SUCCESS;
+
+  for (cur_spk = 0; cur_spk < nu_references; cur_spk++)
+    {
+      if (error_if_failure
+          (trmap_score_sparse_distance (query, references[cur_spk], metric,
+                                        smoothing, &score),
+           "trmap_score_sparse", "error scoring speaker %lu\n",
+           reference_ids[cur_spk]))
+        return EXIT_FAILURE;
+
+      trmap_score_keep (score, reference_ids[cur_spk], k, speaker_ids,
+                        scores, nu_results);
+    }
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * trmap_live_create
+ *
+ * Creates the live scores of the given map against the speakers of the
+ * scorer
+ */
+TMLiveScore
+trmap_live_create (const TMScorer scorer, const TransitionMap map)
+{
+  TMLiveScore new_live;         /* new live scores */
+  TMState origin;               /* current origin state */
+
+
+  /* Checks the parameters */
+  if (scorer == NULL || map == NULL)
+    {
+      error_failure ("trmap_live_create", "no scorer or map passed\n");
+      return NULL;
+    }
+
+  if (map->rows != scorer->dimension || map->columns != scorer->dimension)
+    {
+      error_failure ("trmap_live_create",
+                     "map has %ldx%ld states, expected %ld\n", map->rows,
+                     map->columns, scorer->dimension);
+      return NULL;
+    }
+
+  new_live = (TMLiveScore) malloc (sizeof (trmap_live_type));
+
+  if (new_live == NULL)
+    {
+      error_failure ("trmap_live_create", "virtual memory exhausted\n");
+      return NULL;
+    }
+
+  new_live->scorer = scorer;
+  new_live->nu_speakers = scorer->nu_speakers;
+  new_live->row_scores = (RValue *)
+    malloc ((new_live->nu_speakers * scorer->dimension + 1) *
+            sizeof (RValue));
+  new_live->probs =
+    trmap_score_aligned_block ((size_t) scorer->dimension, &new_live->block);
+
+  if (new_live->row_scores == NULL || new_live->probs == NULL)
+    {
+      error_failure ("trmap_live_create", "virtual memory exhausted\n");
+      free (new_live->row_scores);
+      free (new_live->block);
+      free (new_live);
+      return NULL;
+    }
+
+  for (origin = 0; origin < scorer->dimension; origin++)
+    trmap_live_row (new_live, map, origin);
+
+  return new_live;
+}
+
+
+
+/*
+ * trmap_live_destroy
+ *
+ * Destroys previously created live scores
+ */
+int
+trmap_live_destroy (TMLiveScore * live)
+{
+  /* Checks if the live scores were actually passed */
+  if (live == NULL || *live == NULL)
+    return error_failure ("trmap_live_destroy",
+                          "no live scores to destroy\n");
+
+  free ((*live)->row_scores);
+  free ((*live)->block);
+  free (*live);
+  *live = NULL;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * trmap_live_update
+ *
+ * Updates the live scores after the transitions from the given origin
+ * state of the map changed
+ */
+int
+trmap_live_update (TMLiveScore live, const TransitionMap map,
+                   const TMState origin)
+{
+  /* Checks the parameters */
+  if (live == NULL || map == NULL)
+    return error_failure ("trmap_live_update",
+                          "no live scores or map passed\n");
+
+  if (origin < 1 || origin > live->scorer->dimension)
+    return error_failure ("trmap_live_update", "invalid state: %ld\n",
+                          origin);
+
+  trmap_live_row (live, map, origin - 1);
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * trmap_live_best
+ *
+ * Returns the 'k' speakers closest to the map so far, closest first
+ */
+int
+trmap_live_best (const TMLiveScore live, const UsLgIntValue k,
+                 UsLgIntValue * speaker_ids, RValue * scores,
+                 UsLgIntValue * nu_results)
+{
+  size_t dimension;             /* number of states */
+  const RValue *row_scores;     /* row distances of the current speaker */
+  RValue score;                 /* distance to the current speaker */
+  UsLgIntValue cur_spk;         /* current speaker */
+  size_t i;                     /* current row */
+
+
+  /* Checks the parameters */
+  if (live == NULL)
+    return error_failure ("trmap_live_best", "no live scores passed\n");
+
+  if (speaker_ids == NULL || scores == NULL || nu_results == NULL)
+    return error_failure ("trmap_live_best", "no results passed\n");
+
+  *nu_results = 0;
+
+  if (k == 0)
+    return EXIT_SUCCESS;
+
+  dimension = (size_t) live->scorer->dimension;
+
+  for (cur_spk = 0; cur_spk < live->nu_speakers; cur_spk++)
+    {
+      row_scores = &(live->row_scores[cur_spk * dimension]);
+      score = 0.0;
+
+      for (i = 0; i < dimension; i++)
+        score += row_scores[i];
+
+      trmap_score_keep (score, live->scorer->speaker_ids[cur_spk], k,
+                        speaker_ids, scores, nu_results);
+    }
+
+  return EXIT_SUCCESS;
+}
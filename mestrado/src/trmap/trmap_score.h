@@ -0,0 +1,258 @@
+#ifndef __TRMAP_SCORE_H_
+#define __TRMAP_SCORE_H_ 1
+
+#include "../common/types.h"
+#include "trmap.h"
+#include "trmap_sparse.h"
+
+
+/******************************************************************************
+ *                                                                            *
+ *                          SPEAKER SCORING DATATYPES                         *
+ *                                                                            *
+ ******************************************************************************/
+
+/* Alignment of the reference tensor */
+#ifndef TRMAP_SCORE_ALIGN
+#define TRMAP_SCORE_ALIGN 64
+#endif
+
+
+
+/*
+ * TMScoreMetric
+ *
+ * Distance between the transition probabilities of two maps
+ * - TMSCORE_L1: sum of the absolute differences
+ * - TMSCORE_CHI_SQUARE: symmetric chi-square, sum of (q - r)^2 / (q + r)
+ * - TMSCORE_KL: Kullback-Leibler divergence of the reference from the
+ *   query, sum of q log (q / r)
+ */
+typedef enum
+{
+  TMSCORE_L1 = 0,
+  TMSCORE_CHI_SQUARE = 1,
+  TMSCORE_KL = 2
+}
+TMScoreMetric;
+
+
+
+/*
+ * trmap_scorer_type
+ *
+ * Reference transition maps of a speaker population, scored together.
+ * Each map is stored as its transition probabilities: for each origin
+ * state, the probability of each destination state, smoothed by adding
+ * 'smoothing' to every count. The maps make one contiguous tensor of
+ * nu_speakers x dimension x dimension values, origin state major, aligned
+ * to TRMAP_SCORE_ALIGN bytes, so that scoring a query is one pass over
+ * memory. KL scorers store the logarithms of the probabilities instead,
+ * reducing each divergence to a dot product.
+ */
+typedef struct
+{
+  TMState dimension;            /* number of states */
+  TMScoreMetric metric;         /* distance */
+  RValue smoothing;             /* count added to each transition */
+  UsLgIntValue nu_speakers;     /* reference maps */
+  UsLgIntValue capacity;        /* allocated reference maps */
+  UsLgIntValue *speaker_ids;    /* speaker of each map */
+  RValue *references;           /* aligned reference tensor */
+  void *block;                  /* reference tensor allocation */
+}
+trmap_scorer_type;
+
+
+/* Symbolic type */
+typedef trmap_scorer_type *TMScorer;
+
+
+
+/*
+ * trmap_live_type
+ *
+ * Distances of a map that is still growing to the speakers of a scorer,
+ * kept by origin state: a new transition changes the probabilities of
+ * its origin only, so only that row is scored again. The scorer is
+ * shared and must get no more speakers while it is in use.
+ */
+typedef struct
+{
+  TMScorer scorer;              /* reference maps */
+  UsLgIntValue nu_speakers;     /* speakers scored */
+  RValue *row_scores;           /* nu_speakers x dimension row distances */
+  RValue *probs;                /* probabilities of one origin state */
+  void *block;                  /* probabilities allocation */
+}
+trmap_live_type;
+
+
+/* Symbolic type */
+typedef trmap_live_type *TMLiveScore;
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                            STRUCTURAL OPERATIONS                           *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * trmap_scorer_create
+ *
+ * Creates a new scorer of maps of the given dimension, with no speakers.
+ * KL scorers need a positive smoothing, so that no probability is zero.
+ */
+extern TMScorer
+trmap_scorer_create (const TMState dimension, const TMScoreMetric metric,
+                     const RValue smoothing);
+
+
+
+/*
+ * trmap_scorer_destroy
+ *
+ * Destroys a previously created scorer
+ */
+extern int trmap_scorer_destroy (TMScorer * scorer);
+
+
+
+/*
+ * trmap_scorer_add
+ *
+ * Adds the reference map of the given speaker to the scorer
+ */
+extern int
+trmap_scorer_add (TMScorer scorer, const UsLgIntValue speaker_id,
+                  const TransitionMap map);
+
+
+
+/*
+ * trmap_scorer_create_from_list
+ *
+ * Creates a scorer with the reference maps of the given list: two lines
+ * per speaker, its id and its map file (dense or sparse)
+ */
+extern TMScorer
+trmap_scorer_create_from_list (const char *list_file_name,
+                               const TMState dimension,
+                               const TMScoreMetric metric,
+                               const RValue smoothing);
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                            FUNCTIONAL OPERATIONS                           *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * trmap_scorer_score
+ *
+ * Scores the given query map against all the speakers, returning the 'k'
+ * closest ones (or all, if fewer) in 'speaker_ids' and their distances in
+ * 'scores', closest first. 'nu_results' gets the number of speakers
+ * returned. Scorers may be shared by threads scoring at once.
+ */
+extern int
+trmap_scorer_score (const TMScorer scorer, const TransitionMap query,
+                    const UsLgIntValue k, UsLgIntValue * speaker_ids,
+                    RValue * scores, UsLgIntValue * nu_results);
+
+
+
+/*
+ * trmap_score_sparse_distance
+ *
+ * Distance between the smoothed transition probabilities of two compacted
+ * sparse maps of the same dimension, equal to the one the scorer would
+ * find between their dense forms. Only the transitions stored in either
+ * map are visited.
+ */
+extern int
+trmap_score_sparse_distance (const SparseTransitionMap query,
+                             const SparseTransitionMap reference,
+                             const TMScoreMetric metric,
+                             const RValue smoothing, RValue * distance);
+
+
+
+/*
+ * trmap_score_sparse
+ *
+ * Scores the given sparse query map against the sparse reference maps of
+ * 'nu_references' speakers, identified by 'reference_ids', returning the
+ * 'k' closest ones as trmap_scorer_score does
+ */
+extern int
+trmap_score_sparse (const SparseTransitionMap query,
+                    const SparseTransitionMap * references,
+                    const UsLgIntValue * reference_ids,
+                    const UsLgIntValue nu_references,
+                    const TMScoreMetric metric, const RValue smoothing,
+                    const UsLgIntValue k, UsLgIntValue * speaker_ids,
+                    RValue * scores, UsLgIntValue * nu_results);
+
+
+
+/*
+ * trmap_live_create
+ *
+ * Creates the live scores of the given dense map against the speakers of
+ * the scorer
+ */
+extern TMLiveScore
+trmap_live_create (const TMScorer scorer, const TransitionMap map);
+
+
+
+/*
+ * trmap_live_destroy
+ *
+ * Destroys previously created live scores
+ */
+extern int trmap_live_destroy (TMLiveScore * live);
+
+
+
+/*
+ * trmap_live_update
+ *
+ * Updates the live scores after the transitions from the given origin
+ * state (starting at 1) of the map changed. Costs one row per speaker.
+ */
+extern int
+trmap_live_update (TMLiveScore live, const TransitionMap map,
+                   const TMState origin);
+
+
+
+/*
+ * trmap_live_best
+ *
+ * Returns the 'k' speakers closest to the map so far, closest first, as
+ * trmap_scorer_score would for the map as it is now
+ */
+extern int
+trmap_live_best (const TMLiveScore live, const UsLgIntValue k,
+                 UsLgIntValue * speaker_ids, RValue * scores,
+                 UsLgIntValue * nu_results);
+
+
+
+/*
+ * trmap_score_metric_by_name
+ *
+ * Gets the metric with the given name: "l1", "chi2" or "kl"
+ */
+extern int
+trmap_score_metric_by_name (const char *name, TMScoreMetric * metric);
+
+
+
+#endif /* __TRMAP_SCORE_H_ */
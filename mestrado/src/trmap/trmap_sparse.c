@@ -0,0 +1,642 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include "../common/types.h"
+#include "../errorh/errorh.h"
+#include "../vector/vector.h"
+#include "../matrix/matrix.h"
+#include "trmap.h"
+#include "trmap_sparse.h"
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                             PRIVATE DATATYPES                              *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * trmap_sparse_entry_type
+ *
+ * Transition of one row, while the rows are sorted
+ */
+typedef struct
+{
+  TMState destination;          /* destination of the transition */
+  RValue count;                 /* count of the transition */
+}
+trmap_sparse_entry_type;
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                             PRIVATE OPERATIONS                             *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * trmap_sparse_slot
+ *
+ * First slot to probe for the given key (Fibonacci hashing; the number
+ * of slots is a power of two)
+ */
+static UsLgIntValue
+trmap_sparse_slot (const UsLgIntValue key, const UsLgIntValue nu_slots)
+{
+  return (key * 2654435761UL) & (nu_slots - 1);
+}
+
+
+
+/*
+ * trmap_sparse_resize
+ *
+ * Moves the accumulated transitions to a table of the given number of
+ * slots
+ */
+static int
+trmap_sparse_resize (SparseTransitionMap map, const UsLgIntValue nu_slots)
+{
+  UsLgIntValue *new_keys;       /* keys of the new table */
+  RValue *new_counts;           /* counts of the new table */
+  UsLgIntValue old_slot;        /* slot of the old table */
+  UsLgIntValue slot;            /* slot of the new table */
+
+
+  new_keys = (UsLgIntValue *) calloc (nu_slots, sizeof (UsLgIntValue));
+  new_counts = (RValue *) malloc (nu_slots * sizeof (RValue));
+
+  if (new_keys == NULL || new_counts == NULL)
+    {
+      free (new_keys);
+      free (new_counts);
+      return error_failure ("trmap_sparse_resize",
+                            "virtual memory exhausted\n");
+    }
+
+  for (old_slot = 0; old_slot < map->nu_slots; old_slot++)
+    if (map->keys[old_slot] != 0)
+      {
+        slot = trmap_sparse_slot (map->keys[old_slot], nu_slots);
+
+        while (new_keys[slot] != 0)
+          slot = (slot + 1) & (nu_slots - 1);
+
+        new_keys[slot] = map->keys[old_slot];
+        new_counts[slot] = map->slot_counts[old_slot];
+      }
+
+  free (map->keys);
+  free (map->slot_counts);
+  map->keys = new_keys;
+  map->slot_counts = new_counts;
+  map->nu_slots = nu_slots;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * trmap_sparse_add
+ *
+ * Adds 'count' to the transition from state s1 to state s2. The table
+ * doubles when it gets half full.
+ */
+static int
+trmap_sparse_add (SparseTransitionMap map, const TMState s1,
+                  const TMState s2, const RValue count)
+{
+  UsLgIntValue key;             /* key of the transition */
+  UsLgIntValue slot;            /* current slot */
+
+
+  if (map->compacted == TRUE)
+    return error_failure ("trmap_sparse_add",
+                          "map already compacted\n");
+
+  if (s1 < 1 || s1 > map->dimension || s2 < 1 || s2 > map->dimension)
+    return error_failure ("trmap_sparse_add",
+                          "invalid transition from state %ld to state %ld\n",
+                          s1, s2);
+
+  key = (s1 - 1) * map->dimension + s2;
+  slot = trmap_sparse_slot (key, map->nu_slots);
+
+  while (map->keys[slot] != 0 && map->keys[slot] != key)
+    slot = (slot + 1) & (map->nu_slots - 1);
+
+  if (map->keys[slot] == key)
+    {
+      map->slot_counts[slot] += count;
+      return EXIT_SUCCESS;
+    }
+
+  map->keys[slot] = key;
+  map->slot_counts[slot] = count;
+  map->nu_used++;
+
+  if (2 * map->nu_used > map->nu_slots)
+    return trmap_sparse_resize (map, 2 * map->nu_slots);
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * trmap_sparse_compare
+ *
+ * Compares the destinations of two transitions, for qsort
+ */
+static int
+trmap_sparse_compare (const void *a, const void *b)
+{
+  const trmap_sparse_entry_type *ea = (const trmap_sparse_entry_type *) a;
+  const trmap_sparse_entry_type *eb = (const trmap_sparse_entry_type *) b;
+
+
+  if (ea->destination < eb->destination)
+    return -1;
+
+  return (ea->destination > eb->destination) ? 1 : 0;
+}
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                              PUBLIC OPERATIONS                             *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * trmap_sparse_create
+ *
+ * Creates a new, empty sparse transition map
+ */
+SparseTransitionMap
+trmap_sparse_create (const TMState dimension)
+{
+  SparseTransitionMap new_map;  /* new sparse map */
+
+
+  if (dimension < 1)
+    {
+      error_failure ("trmap_sparse_create", "invalid dimension: %ld\n",
+                     dimension);
+      return NULL;
+    }
+
+  new_map = (SparseTransitionMap) malloc (sizeof (trmap_sparse_type));
+
+  if (new_map == NULL)
+    {
+      error_failure ("trmap_sparse_create", "virtual memory exhausted\n");
+      return NULL;
+    }
+
+  new_map->dimension = dimension;
+  new_map->compacted = FALSE;
+  new_map->nu_slots = TRMAP_SPARSE_INITIAL_SLOTS;
+  new_map->nu_used = 0;
+  new_map->keys = (UsLgIntValue *)
+    calloc (new_map->nu_slots, sizeof (UsLgIntValue));
+  new_map->slot_counts = (RValue *)
+    malloc (new_map->nu_slots * sizeof (RValue));
+  new_map->nu_transitions = 0;
+  new_map->row_start = NULL;
+  new_map->destinations = NULL;
+  new_map->counts = NULL;
+  new_map->totals = NULL;
+
+  if (new_map->keys == NULL || new_map->slot_counts == NULL)
+    {
+      error_failure ("trmap_sparse_create", "virtual memory exhausted\n");
+      trmap_sparse_destroy (&new_map);
+      return NULL;
+    }
+
+  return new_map;
+}
+
+
+
+/*
+ * trmap_sparse_destroy
+ *
+ * Destroys a previously created sparse transition map
+ */
+int
+trmap_sparse_destroy (SparseTransitionMap * map)
+{
+  /* Checks if the map was actually passed */
+  if (map == NULL || *map == NULL)
+    return error_failure ("trmap_sparse_destroy",
+                          "no transition map to destroy\n");
+
+  free ((*map)->keys);
+  free ((*map)->slot_counts);
+  free ((*map)->row_start);
+  free ((*map)->destinations);
+  free ((*map)->counts);
+  free ((*map)->totals);
+  free (*map);
+  *map = NULL;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * trmap_sparse_compact
+ *
+ * Turns the accumulated transitions into compressed sparse rows: the
+ * transitions are counted and placed by origin, each row is sorted by
+ * destination and the hash table is released
+ */
+int
+trmap_sparse_compact (SparseTransitionMap map)
+{
+  trmap_sparse_entry_type *entries;     /* transitions placed by origin */
+  UsLgIntValue *fill;           /* next position of each row */
+  UsLgIntValue slot;            /* current slot */
+  UsLgIntValue pos;             /* current position */
+  TMState origin;               /* current origin (row) */
+
+
+  /* Checks if the map was actually passed */
+  if (map == NULL)
+    return error_failure ("trmap_sparse_compact",
+                          "no transition map passed\n");
+
+  if (map->compacted == TRUE)
+    return EXIT_SUCCESS;
+
+  map->nu_transitions = map->nu_used;
+  map->row_start = (UsLgIntValue *)
+    calloc (map->dimension + 1, sizeof (UsLgIntValue));
+  map->totals = (RValue *) calloc (map->dimension, sizeof (RValue));
+  map->destinations = (TMState *)
+    malloc ((map->nu_used + 1) * sizeof (TMState));
+  map->counts = (RValue *) malloc ((map->nu_used + 1) * sizeof (RValue));
+  entries = (trmap_sparse_entry_type *)
+    malloc ((map->nu_used + 1) * sizeof (trmap_sparse_entry_type));
+  fill = (UsLgIntValue *) malloc (map->dimension * sizeof (UsLgIntValue));
+
+  if (map->row_start == NULL || map->totals == NULL ||
+      map->destinations == NULL || map->counts == NULL || entries == NULL ||
+      fill == NULL)
+    {
+      free (entries);
+      free (fill);
+      free (map->row_start);
+      free (map->totals);
+      free (map->destinations);
+      free (map->counts);
+      map->row_start = NULL;
+      map->totals = NULL;
+      map->destinations = NULL;
+      map->counts = NULL;
+      return error_failure ("trmap_sparse_compact",
+                            "virtual memory exhausted\n");
+    }
+
+  /* Row sizes and totals */
+  for (slot = 0; slot < map->nu_slots; slot++)
+    if (map->keys[slot] != 0)
+      {
+        origin = (map->keys[slot] - 1) / map->dimension;
+        map->row_start[origin + 1]++;
+        map->totals[origin] += map->slot_counts[slot];
+      }
+
+  for (origin = 0; origin < map->dimension; origin++)
+    {
+      map->row_start[origin + 1] += map->row_start[origin];
+      fill[origin] = map->row_start[origin];
+    }
+
+  /* Places each transition in its row */
+  for (slot = 0; slot < map->nu_slots; slot++)
+    if (map->keys[slot] != 0)
+      {
+        origin = (map->keys[slot] - 1) / map->dimension;
+        pos = fill[origin]++;
+        entries[pos].destination = (map->keys[slot] - 1) % map->dimension;
+        entries[pos].count = map->slot_counts[slot];
+      }
+
+  for (origin = 0; origin < map->dimension; origin++)
+    if (map->row_start[origin + 1] - map->row_start[origin] > 1)
+      qsort (&(entries[map->row_start[origin]]),
+             map->row_start[origin + 1] - map->row_start[origin],
+             sizeof (trmap_sparse_entry_type), trmap_sparse_compare);
+
+  for (pos = 0; pos < map->nu_transitions; pos++)
+    {
+      map->destinations[pos] = entries[pos].destination;
+      map->counts[pos] = entries[pos].count;
+    }
+
+  free (entries);
+  free (fill);
+  free (map->keys);
+  free (map->slot_counts);
+  map->keys = NULL;
+  map->slot_counts = NULL;
+  map->nu_slots = 0;
+  map->compacted = TRUE;
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * trmap_sparse_transition
+ *
+ * Registers a new transition from state s1 to state s2 in the given map
+ */
+int
+trmap_sparse_transition (SparseTransitionMap map, const TMState s1,
+                         const TMState s2)
+{
+  /* Checks if the map was actually passed */
+  if (map == NULL)
+    return error_failure ("trmap_sparse_transition",
+                          "no transition map passed\n");
+
+  return trmap_sparse_add (map, s1, s2, 1.0);
+}
+
+
+
+/*
+ * trmap_sparse_create_from_vector
+ *
+ * Creates a new, compacted sparse transition map, based on an input vector
+ * of states
+ */
+SparseTransitionMap
+trmap_sparse_create_from_vector (const TMState dimension, const Vector input)
+{
+  SparseTransitionMap map = NULL;       /* new sparse map */
+  TMState s1 = 0, s2 = 0;       /* last states */
+  UsLgIntValue cur_comp;        /* current vector component */
+
+
+  /* checks if the vector was actually passed */
+  if (input == NULL)
+    {
+      error_failure ("trmap_sparse_create_from_vector",
+                     "no input vector passed\n");
+      return NULL;
+    }
+
+  if (error_if_null
+      (map = trmap_sparse_create (dimension),
+       "trmap_sparse_create_from_vector",
+       "error creating new transition map\n"))
+    return NULL;
+
+  /* registers all transitions in the vector */
+  for (cur_comp = 1; cur_comp <= input->dimension; cur_comp++)
+    {
+      s2 = (TMState) input->value[cur_comp - 1];
+
+      if (cur_comp > 1 && error_if_failure
+          (trmap_sparse_add (map, s1, s2, 1.0),
+           "trmap_sparse_create_from_vector",
+           "error setting transition from state %ld to state %ld\n", s1, s2))
+        {
+          trmap_sparse_destroy (&map);
+          return NULL;
+        }
+
+      s1 = s2;
+    }
+
+  if (error_if_failure
+      (trmap_sparse_compact (map), "trmap_sparse_create_from_vector",
+       "error compacting transition map\n"))
+    {
+      trmap_sparse_destroy (&map);
+      return NULL;
+    }
+
+  return map;
+}
+
+
+
+/*
+ * trmap_sparse_to_dense
+ *
+ * Creates a dense transition map with the transitions of the given
+ * compacted map
+ */
+TransitionMap
+trmap_sparse_to_dense (const SparseTransitionMap map)
+{
+  TransitionMap dense = NULL;   /* new dense map */
+  TMState origin;               /* current origin (column) */
+  UsLgIntValue pos;             /* current position */
+
+
+  /* Checks if the map was actually passed */
+  if (map == NULL || map->compacted == FALSE)
+    {
+      error_failure ("trmap_sparse_to_dense",
+                     "no compacted transition map passed\n");
+      return NULL;
+    }
+
+  if (error_if_null
+      (dense = trmap_create (map->dimension, 0.0), "trmap_sparse_to_dense",
+       "error creating new transition map\n"))
+    return NULL;
+
+  for (origin = 0; origin < map->dimension; origin++)
+    for (pos = map->row_start[origin]; pos < map->row_start[origin + 1];
+         pos++)
+      dense->elements[map->destinations[pos]][origin] = map->counts[pos];
+
+  return dense;
+}
+
+
+
+/*
+ * trmap_sparse_write
+ *
+ * Writes the given compacted map to a sparse map file
+ */
+int
+trmap_sparse_write (const SparseTransitionMap map, FILE * output_fd)
+{
+  TMState origin;               /* current origin */
+  UsLgIntValue pos;             /* current position */
+
+
+  /* Checks the parameters */
+  if (map == NULL || map->compacted == FALSE)
+    return error_failure ("trmap_sparse_write",
+                          "no compacted transition map passed\n");
+
+  if (output_fd == NULL)
+    return error_failure ("trmap_sparse_write", "no output file passed\n");
+
+  fprintf (output_fd, "%ld %ld\n", map->dimension, map->nu_transitions);
+
+  for (origin = 0; origin < map->dimension; origin++)
+    for (pos = map->row_start[origin]; pos < map->row_start[origin + 1];
+         pos++)
+      fprintf (output_fd, "%ld %ld %f\n", origin + 1,
+               map->destinations[pos] + 1, map->counts[pos]);
+
+  if (ferror (output_fd))
+    return error_failure ("trmap_sparse_write",
+                          "error writing transition map: %s\n",
+                          strerror (errno));
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/*
+ * trmap_sparse_create_from_file
+ *
+ * Creates a new, compacted sparse transition map from a sparse map file.
+ * Transitions may come in any order; repeated ones are added.
+ */
+SparseTransitionMap
+trmap_sparse_create_from_file (const char *file_name)
+{
+  SparseTransitionMap map = NULL;       /* new sparse map */
+  FILE *map_fd = NULL;          /* map file */
+  TMState dimension;            /* number of states */
+  UsLgIntValue nu_transitions;  /* transitions in the file */
+  UsLgIntValue cur_trans;       /* current transition */
+  TMState s1, s2;               /* states of the current transition */
+  RValue count;                 /* count of the current transition */
+  int exit_status = EXIT_SUCCESS;       /* auxiliary function return status */
+
+
+  /* checks if the file name was actually passed */
+  if (file_name == NULL)
+    {
+      error_failure ("trmap_sparse_create_from_file",
+                     "no file name passed\n");
+      return NULL;
+    }
+
+  if ((map_fd = fopen (file_name, "r")) == NULL)
+    {
+      error_failure ("trmap_sparse_create_from_file", "error opening '%s': %s\n",
+                     file_name, strerror (errno));
+      return NULL;
+    }
+
+  if (fscanf (map_fd, "%lu %lu", &dimension, &nu_transitions) != 2)
+    {
+      error_failure ("trmap_sparse_create_from_file",
+                     "'%s' has no sparse map header\n", file_name);
+      fclose (map_fd);
+      return NULL;
+    }
+
+  if (error_if_null
+      (map = trmap_sparse_create (dimension),
+       "trmap_sparse_create_from_file", "error creating new transition map\n"))
+    {
+      fclose (map_fd);
+      return NULL;
+    }
+
+  for (cur_trans = 0;
+       cur_trans < nu_transitions && exit_status == EXIT_SUCCESS; cur_trans++)
+    {
+      if (fscanf (map_fd, "%lu %lu %lf", &s1, &s2, &count) != 3)
+        exit_status =
+          error_failure ("trmap_sparse_create_from_file",
+                         "'%s' has less than %ld transitions\n", file_name,
+                         nu_transitions);
+      else
+        exit_status = trmap_sparse_add (map, s1, s2, count);
+    }
+
+  fclose (map_fd);
+
+  if (exit_status == EXIT_SUCCESS)
+    exit_status = trmap_sparse_compact (map);
+
+  if (exit_status != EXIT_SUCCESS)
+    trmap_sparse_destroy (&map);
+
+  return map;
+}
+
+
+
+/*
+ * trmap_sparse_read_dense
+ *
+ * Reads a map file written in either form, returning the map in dense
+ * form. Sparse map files are told apart by their header, which holds two
+ * numbers where the first line of a dense file holds a single value.
+ */
+TransitionMap
+trmap_sparse_read_dense (const TMState dimension, const char *file_name)
+{
+  SparseTransitionMap sparse_map = NULL;        /* sparse map read */
+  TransitionMap map = NULL;     /* dense map */
+  FILE *map_fd = NULL;          /* map file */
+  FileName line = "";           /* first line */
+  RValue first, second;         /* first line values */
+
+
+  /* checks if the file name was actually passed */
+  if (file_name == NULL)
+    {
+      error_failure ("trmap_sparse_read_dense", "no file name passed\n");
+      return NULL;
+    }
+
+  if ((map_fd = fopen (file_name, "r")) == NULL)
+    {
+      error_failure ("trmap_sparse_read_dense", "error opening '%s': %s\n",
+                     file_name, strerror (errno));
+      return NULL;
+    }
+
+  if (fgets (line, FILE_NAME_SIZE, map_fd) == NULL)
+    line[0] = '\0';
+
+  fclose (map_fd);
+
+  if (sscanf (line, "%lf %lf", &first, &second) != 2)
+    return trmap_create_from_file (dimension, file_name);
+
+  if (error_if_null
+      (sparse_map = trmap_sparse_create_from_file (file_name),
+       "trmap_sparse_read_dense", "error reading sparse map '%s'\n",
+       file_name))
+    return NULL;
+
+  if (sparse_map->dimension != dimension)
+    error_failure ("trmap_sparse_read_dense",
+                   "'%s' has %ld states instead of %ld\n", file_name,
+                   sparse_map->dimension, dimension);
+  else
+    map = trmap_sparse_to_dense (sparse_map);
+
+  trmap_sparse_destroy (&sparse_map);
+
+  return map;
+}
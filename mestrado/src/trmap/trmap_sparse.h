@@ -0,0 +1,164 @@
+#ifndef __TRMAP_SPARSE_H_
+#define __TRMAP_SPARSE_H_ 1
+
+#include <stdio.h>
+#include "../common/types.h"
+#include "../vector/vector.h"
+#include "trmap.h"
+
+
+/******************************************************************************
+ *                                                                            *
+ *                       SPARSE TRANSITION MAPS DATATYPES                     *
+ *                                                                            *
+ ******************************************************************************/
+
+/* Initial slots of the accumulation table (a power of two) */
+#ifndef TRMAP_SPARSE_INITIAL_SLOTS
+#define TRMAP_SPARSE_INITIAL_SLOTS 64
+#endif
+
+
+
+/*
+ * trmap_sparse_type
+ *
+ * Transition map that stores only the transitions that happened.
+ * While it is built, the transitions are counted in an open addressing
+ * hash table keyed by (origin, destination). Compacting the map turns it
+ * into compressed sparse rows, one row per origin state: row o holds its
+ * destinations (ascending) and counts at positions row_start[o] to
+ * row_start[o + 1] - 1, and totals[o] is the sum of its counts. States
+ * start at 1, as in TransitionMap; the rows and destinations stored
+ * start at 0. A compacted map takes no more transitions.
+ */
+typedef struct
+{
+  TMState dimension;            /* number of states */
+  BoolValue compacted;          /* compressed sparse rows built */
+
+  /* accumulation */
+  UsLgIntValue nu_slots;        /* hash table slots */
+  UsLgIntValue nu_used;         /* slots in use */
+  UsLgIntValue *keys;           /* origin * dimension + destination + 1 */
+  RValue *slot_counts;          /* counts of the slots */
+
+  /* compressed sparse rows */
+  UsLgIntValue nu_transitions;  /* distinct transitions stored */
+  UsLgIntValue *row_start;      /* first position of each origin */
+  TMState *destinations;        /* destination of each position */
+  RValue *counts;               /* count of each position */
+  RValue *totals;               /* transitions from each origin */
+}
+trmap_sparse_type;
+
+
+/* Symbolic type */
+typedef trmap_sparse_type *SparseTransitionMap;
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                            STRUCTURAL OPERATIONS                           *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * trmap_sparse_create
+ *
+ * Creates a new, empty sparse transition map
+ */
+extern SparseTransitionMap trmap_sparse_create (const TMState dimension);
+
+
+
+/*
+ * trmap_sparse_destroy
+ *
+ * Destroys a previously created sparse transition map
+ */
+extern int trmap_sparse_destroy (SparseTransitionMap * map);
+
+
+
+/*
+ * trmap_sparse_compact
+ *
+ * Turns the accumulated transitions into compressed sparse rows
+ */
+extern int trmap_sparse_compact (SparseTransitionMap map);
+
+
+
+/******************************************************************************
+ *                                                                            *
+ *                            FUNCTIONAL OPERATIONS                           *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * trmap_sparse_transition
+ *
+ * Registers a new transition from state s1 to state s2 in the given map
+ */
+extern int
+trmap_sparse_transition (SparseTransitionMap map, const TMState s1,
+                         const TMState s2);
+
+
+
+/*
+ * trmap_sparse_create_from_vector
+ *
+ * Creates a new, compacted sparse transition map, based on an input vector
+ * of states
+ */
+extern SparseTransitionMap
+trmap_sparse_create_from_vector (const TMState dimension, const Vector input);
+
+
+
+/*
+ * trmap_sparse_to_dense
+ *
+ * Creates a dense transition map with the transitions of the given
+ * compacted map
+ */
+extern TransitionMap trmap_sparse_to_dense (const SparseTransitionMap map);
+
+
+
+/*
+ * trmap_sparse_write
+ *
+ * Writes the given compacted map to a sparse map file: a line with the
+ * dimension and the number of transitions, then one line per transition
+ * with its origin and destination states (starting at 1) and its count
+ */
+extern int
+trmap_sparse_write (const SparseTransitionMap map, FILE * output_fd);
+
+
+
+/*
+ * trmap_sparse_create_from_file
+ *
+ * Creates a new, compacted sparse transition map from a sparse map file
+ */
+extern SparseTransitionMap trmap_sparse_create_from_file (const char *file_name);
+
+
+
+/*
+ * trmap_sparse_read_dense
+ *
+ * Reads a map file of the given dimension, dense or sparse, returning the
+ * map in dense form
+ */
+extern TransitionMap
+trmap_sparse_read_dense (const TMState dimension, const char *file_name);
+
+
+
+#endif /* __TRMAP_SPARSE_H_ */
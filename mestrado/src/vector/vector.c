@@ -556,6 +556,7 @@ vector_normalize (Vector vector1, Vector vector2)
   UsLgIntValue cur_dim;         /* value array elements */
   RValue cur_value1, cur_value2;        /* current dimension value */
   RValue norm1, norm2;          /* norm of the array */
+  istt_stat_type stat;          /* component statistics */
   int exit_status;              /* auxiliary function return status */
 
 
@@ -610,7 +611,7 @@ vector_normalize (Vector vector1, Vector vector2)
     }
 
   /* Initializes the statistics */
-  istt_clear_stat ();
+  istt_clear_stat (&stat);
 
   /* Adds the vector components to the statistics */
   for (cur_dim = 1; cur_dim <= dim; cur_dim++)
@@ -646,12 +647,12 @@ vector_normalize (Vector vector1, Vector vector2)
           }
 
       /* Adds to the statistics */
-      istt_add_stat (cur_value1, cur_value2);
+      istt_add_stat (&stat, cur_value1, cur_value2);
     }
 
   /* Gets the norm of the arrays */
-  norm1 = (RValue) sqrt (istt_sum_sqr_x ());
-  norm2 = (RValue) sqrt (istt_sum_sqr_y ());
+  norm1 = (RValue) sqrt (istt_sum_sqr_x (&stat));
+  norm2 = (RValue) sqrt (istt_sum_sqr_y (&stat));
 
   /* Sets the new values for the dimensions */
   for (cur_dim = 1; cur_dim <= dim; cur_dim++)
@@ -892,6 +893,7 @@ vector_metric (const Vector v1, const Vector v2,
   UsLgIntValue cur_component;   /* current vector component */
   RValue cur_v1, cur_v2;        /* current component values */
   RValue cur_pond;              /* current ponderation coefficient value */
+  istt_stat_type stat;          /* component statistics */
   int exit_status;              /* auxiliary function return status */
 
 
@@ -921,7 +923,7 @@ vector_metric (const Vector v1, const Vector v2,
       }
 
   /* Initialize the statistics */
-  istt_clear_stat ();
+  istt_clear_stat (&stat);
 
   /* Calculates the distance */
   for (cur_component = 1; cur_component <= v1->dimension; cur_component++)
@@ -962,12 +964,12 @@ vector_metric (const Vector v1, const Vector v2,
             }
 
           /* Adds the values to the statistics */
-          istt_add_stat (cur_pond * cur_v1, cur_pond * cur_v2);
+          istt_add_stat (&stat, cur_pond * cur_v1, cur_pond * cur_v2);
         }
       else
         {
           /* Adds the values to the statistics */
-          istt_add_stat (cur_v1, cur_v2);
+          istt_add_stat (&stat, cur_v1, cur_v2);
         }
     }
 
@@ -975,11 +977,11 @@ vector_metric (const Vector v1, const Vector v2,
   switch (metric)
     {
     case VECTOR_METR_EUCLIDEAN:
-      *result = sqrt (istt_sum_sqr_diff_xy ());
+      *result = sqrt (istt_sum_sqr_diff_xy (&stat));
       break;
 
     case VECTOR_METR_INNER_PRODUCT:
-      *result = istt_sum_xy ();
+      *result = istt_sum_xy (&stat);
       break;
 
     default:
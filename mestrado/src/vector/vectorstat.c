@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <math.h>
 #include <float.h>
@@ -8,594 +9,481 @@
 
 /******************************************************************************
  *                                                                            *
- *                              PRIVATE VARIABLES                             *
+ *                              PRIVATE OPERATIONS                            *
  *                                                                            *
  ******************************************************************************/
 
 /*
- * Internal parameters
+ * vcst_copy_values
+ *
+ * Copies the given statistic values of an accumulator into a vector
  */
-static UsLgIntValue int_samples = 0;    /* number of samples */
-static UsLgIntValue int_dim = 0;        /* vector dimension */
+static int
+vcst_copy_values (const VectorAccum accum, const RValue * values, Vector v,
+                  const char *caller)
+{
+  /* Checks if the accumulator was actually passed */
+  if (accum == NULL)
+    {
+      fprintf (stderr, "%s: no accumulator passed\n", caller);
+      return EXIT_FAILURE;
+    }
+
+  /* Checks dimensional compatibility */
+  if (v == NULL || v->dimension != accum->dimension)
+    {
+      fprintf (stderr, "%s: incompatible vector passed\n", caller);
+      return EXIT_FAILURE;
+    }
 
+  memcpy (v->value, values, accum->dimension * sizeof (RValue));
 
-/*
- * Internal vectors
- */
-static Vector zvector = NULL;   /* zeroes vector */
-static Vector int_sum = NULL;   /* sum vector */
-static Vector int_max = NULL;   /* maximums vector */
-static Vector int_min = NULL;   /* minimums vector */
-static Vector int_avg = NULL;   /* average vector */
-static Vector int_avg_old = NULL;       /* previous average vector */
-static Vector int_sqr_diff = NULL;      /* sum of difference to average */
-static Vector int_sum_sqr = NULL;       /* sum of squares vector */
+  return EXIT_SUCCESS;
+}
 
 
 
 /******************************************************************************
  *                                                                            *
- *                              PRIVATE OPERATIONS                            *
+ *                              PUBLIC OPERATIONS                             *
  *                                                                            *
  ******************************************************************************/
 
 /*
- * vcst_create_all_vectors
+ * vcst_samples
  *
- * Allocates all the internal vectors
+ * Returns the current number of observations of the accumulator
  */
-static void
-vcst_create_all_vectors (const UsLgIntValue dim)
+UsLgIntValue
+vcst_samples (const VectorAccum accum)
 {
-  UsLgIntValue cur_comp;        /* current vector component */
-  int exit_status;              /* auxiliary function return status */
-
-
-  /* Dimension must be valid */
-  if (dim == 0)
-    return;
-
-  /* Vectors must not exist */
-  if (int_dim != 0)
-    return;
-
-  /* Creates the vectors */
-  zvector = vector_create (dim);
-  int_sum = vector_create (dim);
-  int_avg = vector_create (dim);
-  int_avg_old = vector_create (dim);
-  int_max = vector_create (dim);
-  int_min = vector_create (dim);
-  int_sqr_diff = vector_create (dim);
-  int_sum_sqr = vector_create (dim);
-
-  if (zvector == NULL || int_sum == NULL || int_avg == NULL ||
-      int_avg_old == NULL || int_max == NULL || int_min == NULL ||
-      int_sqr_diff == NULL || int_sum_sqr == NULL)
-    {
-      fprintf (stderr,
-               "vcst_create_all_vectors: error creating internal vectors\n");
-      return;
-    }
-
-  /* Initializes the zeroes vector */
-  for (cur_comp = 1; cur_comp <= dim; cur_comp++)
-    {
-      exit_status = vector_set_value (zvector, cur_comp, 0.0);
-
-      if (exit_status != EXIT_SUCCESS)
-        {
-          fprintf (stderr,
-                   "vcst_create_all_vectors: error initializing zeroes vector\n");
-          return;
-        }
-    }
-
-  /* Initializes all vectors with the zeroes vector */
-  exit_status = vector_copy (zvector, int_sum);
-  exit_status &= vector_copy (zvector, int_avg);
-  exit_status &= vector_copy (zvector, int_avg_old);
-  exit_status &= vector_copy (zvector, int_max);
-  exit_status &= vector_copy (zvector, int_min);
-  exit_status &= vector_copy (zvector, int_sqr_diff);
-  exit_status &= vector_copy (zvector, int_sum_sqr);
-
-  if (exit_status != EXIT_SUCCESS)
-    fprintf (stderr,
-             "vcst_create_all_vectors: error initializing internal vectors\n");
-
-  return;
+  return (accum != NULL) ? accum->samples : 0;
 }
 
 
 
 /*
- * vcst_destroy_all_vectors
+ * vcst_average
  *
- * Destroys all internal vectors
+ * Returns the average vector of the accumulator
  */
-static void
-vcst_destroy_all_vectors (void)
+int
+vcst_average (const VectorAccum accum, Vector v)
 {
-  int exit_status;              /* auxiliary function return status */
-
+  if (accum == NULL)
+    return vcst_copy_values (NULL, NULL, v, "vcst_average");
 
-  /* Vectors must exist */
-  if (int_dim == 0)
-    return;
-
-  /* Destroys the vectors */
-  exit_status = vector_destroy (&zvector);
-  exit_status &= vector_destroy (&int_sum);
-  exit_status &= vector_destroy (&int_avg);
-  exit_status &= vector_destroy (&int_avg_old);
-  exit_status &= vector_destroy (&int_max);
-  exit_status &= vector_destroy (&int_min);
-  exit_status &= vector_destroy (&int_sqr_diff);
-  exit_status &= vector_destroy (&int_sum_sqr);
-
-  if (exit_status != EXIT_SUCCESS)
-    fprintf (stderr,
-             "vcst_destroy_all_vectors: error destroying internal vectors\n");
-
-  return;
+  return vcst_copy_values (accum, accum->average, v, "vcst_average");
 }
 
 
 
 /*
- * vcst_get_component_values
+ * vcst_variance
  *
- * Gets the values of the given components of the internal vectors
+ * Returns the variance vector of the accumulator
  */
-static int
-vcst_get_component_values (const UsLgIntValue component,
-                           RValue * cur_sum, RValue * cur_avg,
-                           RValue * cur_avg_old,
-                           RValue * cur_max, RValue * cur_min,
-                           RValue * cur_sqr_diff, RValue * cur_sum_sqr)
+int
+vcst_variance (const VectorAccum accum, Vector v)
 {
-  int exit_status;              /* auxiliary function return status */
+  UsLgIntValue cur_comp;        /* current vector component */
 
-  /* Gets the values */
-  exit_status = vector_get_value (int_sum, component, cur_sum);
-  exit_status &= vector_get_value (int_avg, component, cur_avg);
-  exit_status &= vector_get_value (int_avg_old, component, cur_avg_old);
-  exit_status &= vector_get_value (int_max, component, cur_max);
-  exit_status &= vector_get_value (int_min, component, cur_min);
-  exit_status &= vector_get_value (int_sqr_diff, component, cur_sqr_diff);
-  exit_status &= vector_get_value (int_sum_sqr, component, cur_sum_sqr);
 
-  if (exit_status != EXIT_SUCCESS)
+  if (vcst_samples (accum) == 0)
     {
-      fprintf (stderr,
-               "vcst_get_component_values: error getting values for component %ld\n",
-               component);
+      fprintf (stderr, "vcst_variance: no observations added\n");
       return EXIT_FAILURE;
     }
 
+  /* Divides the squared differences by the number of samples */
+  if (vcst_copy_values (accum, accum->sqr_diff, v, "vcst_variance") !=
+      EXIT_SUCCESS)
+    return EXIT_FAILURE;
+
+  for (cur_comp = 0; cur_comp < v->dimension; cur_comp++)
+    v->value[cur_comp] /= (RValue) accum->samples;
+
   return EXIT_SUCCESS;
 }
 
 
 
 /*
- * vcst_set_component_values
+ * vcst_stddev
  *
- * Sets the values of the given components of the internal vectors
+ * Returns the standard deviation vector of the accumulator
  */
-static int
-vcst_set_component_values (const UsLgIntValue component,
-                           const RValue cur_sum, const RValue cur_avg,
-                           const RValue cur_max, const RValue cur_min,
-                           const RValue cur_sqr_diff,
-                           const RValue cur_sum_sqr)
+int
+vcst_stddev (const VectorAccum accum, Vector v)
 {
-  int exit_status;              /* auxiliary function return status */
+  UsLgIntValue cur_comp;        /* current vector component */
 
-  /* Gets the values */
-  exit_status = vector_set_value (int_sum, component, cur_sum);
-  exit_status &= vector_set_value (int_avg, component, cur_avg);
-  exit_status &= vector_set_value (int_max, component, cur_max);
-  exit_status &= vector_set_value (int_min, component, cur_min);
-  exit_status &= vector_set_value (int_sqr_diff, component, cur_sqr_diff);
-  exit_status &= vector_set_value (int_sum_sqr, component, cur_sum_sqr);
 
-  if (exit_status != EXIT_SUCCESS)
+  /* Calculates the variance vector */
+  if (vcst_variance (accum, v) != EXIT_SUCCESS)
     {
       fprintf (stderr,
-               "vcst_set_component_values: error setting values for component %ld\n",
-               component);
+               "vcst_stddev: error calculating standard deviation vector\n");
       return EXIT_FAILURE;
     }
 
+  /* Takes the square root of each component */
+  for (cur_comp = 0; cur_comp < v->dimension; cur_comp++)
+    v->value[cur_comp] = sqrt (v->value[cur_comp]);
+
   return EXIT_SUCCESS;
 }
 
 
 
-/******************************************************************************
- *                                                                            *
- *                              PUBLIC OPERATIONS                             *
- *                                                                            *
- ******************************************************************************/
-
 /*
- * vcst_init_stat
- *
- * Initializes all the internal statistic vectors, setting the internal
- * dimension.
+ * vcst_max
  *
- * If the internal dimension is passed 0, all internal vectors will be
- * destroyed
+ * Returns the maximum component values vector of the accumulator
  */
-void
-vcst_init_stat (const UsLgIntValue dim)
+int
+vcst_max (const VectorAccum accum, Vector v)
 {
-  /* If the vectors already exist, destroy them */
-  if (int_dim > 0)
-    vcst_destroy_all_vectors ();
+  if (accum == NULL)
+    return vcst_copy_values (NULL, NULL, v, "vcst_max");
 
-  /* If a new valid dimension was passed, recreates the vectors */
-  if (dim > 0)
-    vcst_create_all_vectors (dim);
-
-  /* Sets the number of samples and the internal dimension */
-  int_samples = 0;
-  int_dim = dim;
-
-  return;
+  return vcst_copy_values (accum, accum->max, v, "vcst_max");
 }
 
 
 
 /*
- * vcst_add_stat
+ * vcst_min
  *
- * Adds a new observation
+ * Returns the minimum component values vector of the accumulator
  */
 int
-vcst_add_stat (const Vector v)
+vcst_min (const VectorAccum accum, Vector v)
 {
-  UsLgIntValue cur_comp;        /* current component */
-  RValue cur_val;               /* current component value */
-  RValue cur_sum;               /* sum vector */
-  RValue cur_avg;               /* average vector */
-  RValue cur_avg_old;           /* previous average vector */
-  RValue cur_max;               /* maximums vector */
-  RValue cur_min;               /* minimums vector */
-  RValue cur_sqr_diff;          /* sum of squared difference to average */
-  RValue cur_sum_sqr;           /* sum of squares vector */
-  int exit_status;              /* auxiliary function return status */
-
+  if (accum == NULL)
+    return vcst_copy_values (NULL, NULL, v, "vcst_min");
 
-  /* Checks if the vector was actually passed */
-  if (v == NULL)
-    {
-      fprintf (stderr, "vcst_add_stat: no vector passed\n");
-      return EXIT_FAILURE;
-    }
-
-  /* Checks if the statistics are initialized */
-  if (int_dim == 0)
-    {
-      fprintf (stderr, "vcst_add_stat: vector statistics not initialized\n");
-      return EXIT_FAILURE;
-    }
-
-  /* Checks dimensional compatibility */
-  if (v->dimension != int_dim)
-    {
-      fprintf (stderr,
-               "vcst_add_stat: incompatible dimensions: dim(v) = %ld; internal dimension = %ld\n",
-               v->dimension, int_dim);
-      return EXIT_FAILURE;
-    }
-
-  /* Stores the old averages */
-  exit_status = vector_copy (int_avg, int_avg_old);
-
-  if (exit_status != EXIT_SUCCESS)
-    {
-      fprintf (stderr, "vcst_add_stat: error backing up averages\n");
-      return EXIT_FAILURE;
-    }
-
-  /* Adds statistics for each dimension */
-  for (cur_comp = 1; cur_comp <= int_dim; cur_comp++)
-    {
-      /* Gets the current component value of the given vector */
-      exit_status = vector_get_value (v, cur_comp, &cur_val);
-
-      if (exit_status != EXIT_SUCCESS)
-        {
-          fprintf (stderr,
-                   "vcst_add_stat: error getting value for the given vector component %ld\n",
-                   cur_comp);
-          return EXIT_FAILURE;
-        }
-
-      /* Gets the current internal vectors component values */
-      exit_status = vcst_get_component_values
-        (cur_comp, &cur_sum, &cur_avg, &cur_avg_old,
-         &cur_max, &cur_min, &cur_sqr_diff, &cur_sum_sqr);
-
-      if (exit_status != EXIT_SUCCESS)
-        {
-          fprintf (stderr,
-                   "vcst_add_stat: error getting vector component values for component %ld\n",
-                   cur_comp);
-          return EXIT_FAILURE;
-        }
-
-      cur_avg = ((RValue) int_samples * cur_avg + cur_val)
-        / ((RValue) int_samples + 1.0);
-
-      /*
-       * Accumulators
-       */
-      cur_sum += cur_val;
-      cur_sum_sqr += sqr (cur_val);
-
-      /*
-       * Square Differences
-       */
-      cur_sqr_diff +=
-        (RValue) int_samples / sqr ((RValue) int_samples + 1.0)
-        * sqr (cur_avg_old - cur_val) + sqr (cur_avg - cur_val);
-
-      /*
-       * Maxima and minima
-       */
-      if (int_samples == 0)
-        {
-          cur_min = cur_val;
-          cur_max = cur_val;
-        }
-      else
-        {
-          cur_min = (cur_min - cur_val < DBL_EPSILON ? cur_min : cur_val);
-          cur_max = (cur_max - cur_val > DBL_EPSILON ? cur_max : cur_val);
-        }
-
-      /* Updates the internal vectors component values */
-      exit_status = vcst_set_component_values
-        (cur_comp, cur_sum, cur_avg, cur_max, cur_min,
-         cur_sqr_diff, cur_sum_sqr);
-
-      if (exit_status != EXIT_SUCCESS)
-        {
-          fprintf (stderr,
-                   "vcst_add_stat: error setting internal vector component %ld value\n",
-                   cur_comp);
-          return EXIT_FAILURE;
-        }
-    }
-
-  /*
-   * Number of observations
-   */
-  int_samples++;
-
-  return EXIT_SUCCESS;
+  return vcst_copy_values (accum, accum->min, v, "vcst_min");
 }
 
 
 
 /*
- * vcst_samples
+ * vcst_sum
  *
- * Returns the current number of observations
+ * Returns the component sum vector of the accumulator
  */
-UsLgIntValue
-vcst_samples (void)
+int
+vcst_sum (const VectorAccum accum, Vector v)
 {
-  return int_samples;
+  if (accum == NULL)
+    return vcst_copy_values (NULL, NULL, v, "vcst_sum");
+
+  return vcst_copy_values (accum, accum->sum, v, "vcst_sum");
 }
 
 
 
 /*
- * vcst_average
+ * vcst_sum_sqr
  *
- * Returns the average vector
+ * Returns the sum of the squared components vector of the accumulator
  */
 int
-vcst_average (Vector v)
+vcst_sum_sqr (const VectorAccum accum, Vector v)
 {
-  return vector_copy (int_avg, v);
-}
+  if (accum == NULL)
+    return vcst_copy_values (NULL, NULL, v, "vcst_sum_sqr");
 
+  return vcst_copy_values (accum, accum->sum_sqr, v, "vcst_sum_sqr");
+}
 
 
 /*
- * vcst_variance
+ * vcst_invstd_pond
  *
- * Returns the variance vector
+ * Returns the inverse standard deviations vector of the accumulator
+ * (standard deviation ponderation vector)
  */
 int
-vcst_variance (Vector v)
+vcst_invstddev (const VectorAccum accum, Vector v)
 {
-  int exit_status;              /* auxiliary function return status */
+  UsLgIntValue cur_comp;        /* current vector component */
 
 
-  if (int_samples > 0)
-    {
-      /* Copies the sum of squared differences to average */
-      exit_status = vector_copy (int_sqr_diff, v);
-
-      if (exit_status != EXIT_SUCCESS)
-        {
-          fprintf (stderr,
-                   "vcst_variance: error calculating variance vector\n");
-          return EXIT_FAILURE;
-        }
-
-      /* Divides the differences of the components by the number of samples */
-      exit_status = vector_scalar_multiply (v, 1.0 / (RValue) int_samples, v);
-
-      if (exit_status != EXIT_SUCCESS)
-        {
-          fprintf (stderr,
-                   "vcst_variance: error calculating variance vector\n");
-          return EXIT_FAILURE;
-        }
-    }
-  else
+  /* Copies the standard deviation vector */
+  if (vcst_stddev (accum, v) != EXIT_SUCCESS)
     {
-      fprintf (stderr, "vcst_variance: no observations added\n");
+      fprintf (stderr,
+               "vcst_invstd_pond: error calculating ponderation vector\n");
       return EXIT_FAILURE;
     }
 
+  /* Inverts the components, ignoring constant components */
+  for (cur_comp = 0; cur_comp < v->dimension; cur_comp++)
+    if (v->value[cur_comp] > DBL_EPSILON)
+      v->value[cur_comp] = 1.0 / v->value[cur_comp];
+
   return EXIT_SUCCESS;
 }
 
 
 
 /*
- * vcst_stddev
+ * vcst_accum_create
  *
- * Returns the standard deviation vector
+ * Creates a new, empty statistics accumulator
  */
-int
-vcst_stddev (Vector v)
+VectorAccum
+vcst_accum_create (const UsLgIntValue dim)
 {
-  int exit_status;              /* auxiliary function return status */
+  VectorAccum new_accum;        /* new accumulator */
+  RValue *block;                /* storage of all the arrays */
 
 
-  if (int_samples > 0)
+  /* Checks if the dimension is valid */
+  if (dim < 1)
     {
-      /* Calculates the variance vector */
-      exit_status = vcst_variance (v);
-
-      if (exit_status != EXIT_SUCCESS)
-        {
-          fprintf (stderr,
-                   "vcst_stddev: error calculating standard deviation vector\n");
-          return EXIT_FAILURE;
-        }
-
-      /* Takes the square root of each component */
-      exit_status = vector_sqrt (v, v);
-
-      if (exit_status != EXIT_SUCCESS)
-        {
-          fprintf (stderr,
-                   "vcst_stddev: error taking square root of components\n");
-          return EXIT_FAILURE;
-        }
+      fprintf (stderr, "vcst_accum_create: invalid dimension: %ld\n", dim);
+      return NULL;
     }
-  else
+
+  new_accum = (VectorAccum) malloc (sizeof (vcst_accum_type));
+  block = (RValue *) malloc (6 * dim * sizeof (RValue));
+
+  if (new_accum == NULL || block == NULL)
     {
-      fprintf (stderr, "vcst_stddev: no observations added\n");
-      return EXIT_FAILURE;
+      fprintf (stderr, "vcst_accum_create: virtual memory exhausted\n");
+      free (new_accum);
+      free (block);
+      return NULL;
     }
 
-  return EXIT_SUCCESS;
+  new_accum->dimension = dim;
+  new_accum->max = block;
+  new_accum->min = block + dim;
+  new_accum->sum = block + 2 * dim;
+  new_accum->sum_sqr = block + 3 * dim;
+  new_accum->average = block + 4 * dim;
+  new_accum->sqr_diff = block + 5 * dim;
+
+  vcst_accum_reset (new_accum);
+
+  return new_accum;
 }
 
 
 
 /*
- * vcst_max
+ * vcst_accum_destroy
  *
- * Returns the maximum component values vector
+ * Destroys a previously created statistics accumulator
  */
 int
-vcst_max (Vector v)
+vcst_accum_destroy (VectorAccum * accum)
 {
-  return vector_copy (int_max, v);
+  /* Checks if the accumulator was actually passed */
+  if (accum == NULL || *accum == NULL)
+    {
+      fprintf (stderr, "vcst_accum_destroy: no accumulator passed\n");
+      return EXIT_FAILURE;
+    }
+
+  /* The arrays share one block */
+  free ((*accum)->max);
+  free (*accum);
+
+  /* Makes it point to NULL */
+  *accum = NULL;
+
+  return EXIT_SUCCESS;
 }
 
 
 
 /*
- * vcst_min
+ * vcst_accum_reset
  *
- * Returns the minimum component values vector
+ * Discards all the observations of the accumulator
  */
-int
-vcst_min (Vector v)
+void
+vcst_accum_reset (VectorAccum accum)
 {
-  return vector_copy (int_min, v);
+  UsLgIntValue cur_comp;        /* current component */
+
+
+  if (accum == NULL)
+    return;
+
+  accum->samples = 0;
+
+  for (cur_comp = 0; cur_comp < 6 * accum->dimension; cur_comp++)
+    accum->max[cur_comp] = 0.0;
+
+  return;
 }
 
 
 
 /*
- * vcst_sum
+ * vcst_accum_add
  *
- * Returns the component sum vector
+ * Adds a new observation, given by the accumulator's dimension values
  */
-int
-vcst_sum (Vector v)
+void
+vcst_accum_add (VectorAccum accum, const RValue * values)
 {
-  return vector_copy (int_sum, v);
+  UsLgIntValue cur_comp;        /* current component */
+  RValue samples;               /* number of observations, this one included */
+  RValue value;                 /* current component value */
+  RValue delta;                 /* difference to the previous average */
+
+
+  samples = (RValue) (accum->samples + 1);
+
+  for (cur_comp = 0; cur_comp < accum->dimension; cur_comp++)
+    {
+      value = values[cur_comp];
+
+      /* Welford's update of the average and squared differences */
+      delta = value - accum->average[cur_comp];
+      accum->average[cur_comp] += delta / samples;
+      accum->sqr_diff[cur_comp] += delta * (value - accum->average[cur_comp]);
+
+      /* Accumulators */
+      accum->sum[cur_comp] += value;
+      accum->sum_sqr[cur_comp] += value * value;
+
+      /* Maxima and minima */
+      if (accum->samples == 0 || value < accum->min[cur_comp])
+        accum->min[cur_comp] = value;
+
+      if (accum->samples == 0 || value > accum->max[cur_comp])
+        accum->max[cur_comp] = value;
+    }
+
+  accum->samples++;
+
+  return;
 }
 
 
 
 /*
- * vcst_sum_sqr
+ * vcst_accum_merge
  *
- * Returns the sum of the squared components vector
+ * Adds the observations of 'other' to the accumulator
  */
 int
-vcst_sum_sqr (Vector v)
+vcst_accum_merge (VectorAccum accum, const VectorAccum other)
 {
-  return vector_copy (int_sum_sqr, v);
+  UsLgIntValue cur_comp;        /* current component */
+  RValue samples;               /* observations in both accumulators */
+  RValue weight;                /* share of the other's observations */
+  RValue delta;                 /* difference between the averages */
+
+
+  /* Checks if the accumulators were actually passed */
+  if (accum == NULL || other == NULL)
+    {
+      fprintf (stderr, "vcst_accum_merge: no accumulator passed\n");
+      return EXIT_FAILURE;
+    }
+
+  if (accum->dimension != other->dimension)
+    {
+      fprintf (stderr, "vcst_accum_merge: incompatible dimensions\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Trivial cases */
+  if (other->samples == 0)
+    return EXIT_SUCCESS;
+
+  if (accum->samples == 0)
+    {
+      memcpy (accum->max, other->max,
+              6 * accum->dimension * sizeof (RValue));
+      accum->samples = other->samples;
+      return EXIT_SUCCESS;
+    }
+
+  /* Chan's combination of averages and squared differences */
+  samples = (RValue) (accum->samples + other->samples);
+  weight = (RValue) other->samples / samples;
+
+  for (cur_comp = 0; cur_comp < accum->dimension; cur_comp++)
+    {
+      delta = other->average[cur_comp] - accum->average[cur_comp];
+      accum->average[cur_comp] += delta * weight;
+      accum->sqr_diff[cur_comp] += other->sqr_diff[cur_comp] +
+        delta * delta * (RValue) accum->samples * weight;
+
+      accum->sum[cur_comp] += other->sum[cur_comp];
+      accum->sum_sqr[cur_comp] += other->sum_sqr[cur_comp];
+
+      if (other->min[cur_comp] < accum->min[cur_comp])
+        accum->min[cur_comp] = other->min[cur_comp];
+
+      if (other->max[cur_comp] > accum->max[cur_comp])
+        accum->max[cur_comp] = other->max[cur_comp];
+    }
+
+  accum->samples += other->samples;
+
+  return EXIT_SUCCESS;
 }
 
 
+
 /*
- * vcst_invstd_pond
+ * vcst_accum_store
  *
- * Returns the inverse standard deviations vector
- * (standard deviation ponderation vector)
+ * Updates the vectors in the set with the accumulated statistics
  */
 int
-vcst_invstddev (Vector v)
+vcst_accum_store (const VectorAccum accum, VectorStats vstats)
 {
-  UsLgIntValue cur_comp;        /* current vector component */
-  RValue cur_value;             /* current vector component value */
-  int exit_status;              /* auxiliary function return status */
+  UsLgIntValue cur_comp;        /* current component */
+  RValue stddev;                /* standard deviation */
 
-  /* Copies the standard deviation vector */
-  exit_status = vcst_stddev (v);
 
-  if (exit_status != EXIT_SUCCESS)
+  /* Checks if the accumulator and the set of vectors were passed */
+  if (accum == NULL || vstats == NULL)
     {
       fprintf (stderr,
-               "vcst_invstd_pond: error calculating ponderation vector\n");
+               "vcst_accum_store: no accumulator or statistic vectors set passed\n");
       return EXIT_FAILURE;
     }
 
-  for (cur_comp = 1; cur_comp <= int_dim; cur_comp++)
+  if (accum->dimension != vstats->dimension)
     {
-      /* Gets the component value */
-      exit_status = vector_get_value (v, cur_comp, &cur_value);
-
-      if (exit_status != EXIT_SUCCESS)
-        {
-          fprintf (stderr,
-                   "vcst_invstd_pond: error getting standard deviation value for component %ld\n",
-                   cur_comp);
-          return EXIT_FAILURE;
-        }
-
-      /* Inverts the component, ignoring constant component */
-      if (cur_value > DBL_EPSILON)
-        {
-          exit_status = vector_set_value (v, cur_comp, 1.0 / cur_value);
-
-          if (exit_status != EXIT_SUCCESS)
-            {
-              fprintf (stderr,
-                       "vcst_invstd_pond: error setting ponderation vector component %ld\n",
-                       cur_comp);
-              return EXIT_FAILURE;
-            }
-        }
+      fprintf (stderr, "vcst_accum_store: incompatible dimensions\n");
+      return EXIT_FAILURE;
+    }
+
+  if (accum->samples == 0)
+    {
+      fprintf (stderr, "vcst_accum_store: no observations added\n");
+      return EXIT_FAILURE;
+    }
+
+  for (cur_comp = 0; cur_comp < accum->dimension; cur_comp++)
+    {
+      vstats->max->value[cur_comp] = accum->max[cur_comp];
+      vstats->min->value[cur_comp] = accum->min[cur_comp];
+      vstats->sum->value[cur_comp] = accum->sum[cur_comp];
+      vstats->sum_sqr->value[cur_comp] = accum->sum_sqr[cur_comp];
+      vstats->average->value[cur_comp] = accum->average[cur_comp];
+      vstats->variance->value[cur_comp] =
+        accum->sqr_diff[cur_comp] / (RValue) accum->samples;
+
+      stddev = sqrt (vstats->variance->value[cur_comp]);
+      vstats->stddev->value[cur_comp] = stddev;
+
+      /* Inverts the component, ignoring constant components */
+      vstats->invstddev->value[cur_comp] =
+        (stddev > DBL_EPSILON) ? 1.0 / stddev : stddev;
     }
 
   return EXIT_SUCCESS;
@@ -706,81 +594,6 @@ vcst_stats_destroy (VectorStats * vstats)
 
 
 
-/*
- * vcst_stats_update
- *
- * Updates the vectors in the set with the current statistics
- */
-int
-vcst_stats_update (VectorStats vstats)
-{
-  /* Checks if the set of vectors was passed */
-  if (vstats == NULL)
-    {
-      fprintf (stderr,
-               "vcst_stats_update: no statistic vectors set passed\n");
-      return EXIT_FAILURE;
-    }
-
-  /* Updates each statistic vector */
-  if (vcst_max (vstats->max) != EXIT_SUCCESS)
-    {
-      fprintf (stderr, "vcst_stats_update: error updating maximums vector\n");
-      return EXIT_FAILURE;
-    }
-
-  if (vcst_min (vstats->min) != EXIT_SUCCESS)
-    {
-      fprintf (stderr, "vcst_stats_update: error updating minimums vector\n");
-      return EXIT_FAILURE;
-    }
-
-  if (vcst_sum (vstats->sum) != EXIT_SUCCESS)
-    {
-      fprintf (stderr, "vcst_stats_update: error updating sums vector\n");
-      return EXIT_FAILURE;
-    }
-
-  if (vcst_sum_sqr (vstats->sum_sqr) != EXIT_SUCCESS)
-    {
-      fprintf (stderr,
-               "vcst_stats_update: error updating squared sums vector\n");
-      return EXIT_FAILURE;
-    }
-
-  if (vcst_average (vstats->average) != EXIT_SUCCESS)
-    {
-      fprintf (stderr, "vcst_stats_update: error updating averages vector\n");
-      return EXIT_FAILURE;
-    }
-
-  if (vcst_variance (vstats->variance) != EXIT_SUCCESS)
-    {
-      fprintf (stderr,
-               "vcst_stats_update: error updating variances vector\n");
-      return EXIT_FAILURE;
-    }
-
-  if (vcst_stddev (vstats->stddev) != EXIT_SUCCESS)
-    {
-      fprintf (stderr,
-               "vcst_stats_update: error updating standard deviations vector\n");
-      return EXIT_FAILURE;
-    }
-
-  if (vcst_invstddev (vstats->invstddev) != EXIT_SUCCESS)
-    {
-      fprintf (stderr,
-               "vcst_stats_update: error updating inverse standard deviations vector\n");
-      return EXIT_FAILURE;
-    }
-
-
-  return EXIT_SUCCESS;
-}
-
-
-
 /*
  * vcst_stats_info
  *
@@ -35,113 +35,118 @@ typedef vcst_stats_type *VectorStats;
 
 
 
-/******************************************************************************
- *                                                                            *
- *                             PUBLIC OPERATIONS                              *
- *                                                                            *
- ******************************************************************************/
-
 /*
- * vcst_init_stat
- *
- * Initializes all the internal statistic vectors, setting the internal
- * dimension.
+ * vcst_accum_type
  *
- * If the internal dimension is passed 0, all internal vectors will be
- * destroyed
+ * Running statistics of a sequence of observations, kept in plain arrays.
+ * Observations are added by Welford's method, and accumulators built over
+ * disjoint parts of a sample may be merged (Chan et al.), so the
+ * statistics of a large sample may be computed by parts and by several
+ * threads, each with its own accumulator.
  */
-extern void vcst_init_stat (const UsLgIntValue dim);
+typedef struct
+{
+  UsLgIntValue dimension;       /* observation dimension */
+  UsLgIntValue samples;         /* number of observations */
+  RValue *max;                  /* maxima */
+  RValue *min;                  /* minima */
+  RValue *sum;                  /* sums */
+  RValue *sum_sqr;              /* sums of squares */
+  RValue *average;              /* averages */
+  RValue *sqr_diff;             /* sums of squared differences to average */
+}
+vcst_accum_type;
 
+/* Symbolic Type */
+typedef vcst_accum_type *VectorAccum;
 
 
-/*
- * vcst_add_stat
- *
- * Adds a new observation
- */
-extern int vcst_add_stat (const Vector v);
-
 
+/******************************************************************************
+ *                                                                            *
+ *                             PUBLIC OPERATIONS                              *
+ *                                                                            *
+ ******************************************************************************/
 
 /*
  * vcst_samples
  *
- * Returns the current number of observations
+ * Returns the current number of observations of the accumulator
  */
-extern UsLgIntValue vcst_samples (void);
+extern UsLgIntValue vcst_samples (const VectorAccum accum);
 
 
 
 /*
  * vcst_average
  *
- * Returns the average vector
+ * Returns the average vector of the accumulator
  */
-extern int vcst_average (Vector v);
+extern int vcst_average (const VectorAccum accum, Vector v);
 
 
 
 /*
  * vcst_variance
  *
- * Returns the variance vector
+ * Returns the variance vector of the accumulator
  */
-extern int vcst_variance (Vector v);
+extern int vcst_variance (const VectorAccum accum, Vector v);
 
 
 
 /*
  * vcst_stddev
  *
- * Returns the standard deviation vector
+ * Returns the standard deviation vector of the accumulator
  */
-extern int vcst_stddev (Vector v);
+extern int vcst_stddev (const VectorAccum accum, Vector v);
 
 
 
 /*
  * vcst_max
  *
- * Returns the maximum component values vector
+ * Returns the maximum component values vector of the accumulator
  */
-extern int vcst_max (Vector v);
+extern int vcst_max (const VectorAccum accum, Vector v);
 
 
 
 /*
  * vcst_min
  *
- * Returns the minimum component values vector
+ * Returns the minimum component values vector of the accumulator
  */
-extern int vcst_min (Vector v);
+extern int vcst_min (const VectorAccum accum, Vector v);
 
 
 
 /*
  * vcst_sum
  *
- * Returns the component sum vector
+ * Returns the component sum vector of the accumulator
  */
-extern int vcst_sum (Vector v);
+extern int vcst_sum (const VectorAccum accum, Vector v);
 
 
 
 /*
  * vcst_sum_sqr
  *
- * Returns the sum of the squared components vector
+ * Returns the sum of the squared components vector of the accumulator
  */
-extern int vcst_sum_sqr (Vector v);
+extern int vcst_sum_sqr (const VectorAccum accum, Vector v);
 
 
 
 /*
  * vcst_invstddev
  *
- * Returns the inverse standard deviations vector
+ * Returns the inverse standard deviations vector of the accumulator
  * (standard deviation ponderation vector)
  */
-extern int vcst_invstddev (Vector v);
+extern int vcst_invstddev (const VectorAccum accum, Vector v);
 
 
 
@@ -164,11 +169,57 @@ extern int vcst_stats_destroy (VectorStats * vstats);
 
 
 /*
- * vcst_stats_update
+ * vcst_accum_create
+ *
+ * Creates a new, empty statistics accumulator
+ */
+extern VectorAccum vcst_accum_create (const UsLgIntValue dim);
+
+
+
+/*
+ * vcst_accum_destroy
+ *
+ * Destroys a previously created statistics accumulator
+ */
+extern int vcst_accum_destroy (VectorAccum * accum);
+
+
+
+/*
+ * vcst_accum_reset
+ *
+ * Discards all the observations of the accumulator
+ */
+extern void vcst_accum_reset (VectorAccum accum);
+
+
+
+/*
+ * vcst_accum_add
+ *
+ * Adds a new observation, given by the accumulator's dimension values
+ */
+extern void vcst_accum_add (VectorAccum accum, const RValue * values);
+
+
+
+/*
+ * vcst_accum_merge
+ *
+ * Adds the observations of 'other' to the accumulator
+ */
+extern int vcst_accum_merge (VectorAccum accum, const VectorAccum other);
+
+
+
+/*
+ * vcst_accum_store
  *
- * Updates the vectors in the set with the current statistics
+ * Updates the vectors in the set with the accumulated statistics
  */
-extern int vcst_stats_update (VectorStats vstats);
+extern int
+vcst_accum_store (const VectorAccum accum, VectorStats vstats);
 
 
 